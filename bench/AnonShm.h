@@ -0,0 +1,58 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __ANON_SHM_H__
+#define __ANON_SHM_H__
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+/**
+ * 匿名共享内存，进程退出后自动释放
+ */
+class AnonShm
+{
+public:
+    AnonShm() : _addr(NULL), _size(0) {}
+
+    ~AnonShm()
+    {
+        if (_addr != NULL)
+        {
+            munmap(_addr, _size);
+        }
+    }
+
+    void *create(size_t size)
+    {
+        _addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (_addr == MAP_FAILED)
+        {
+            _addr = NULL;
+            throw runtime_error("mmap anonymous shared memory failed: " + string(strerror(errno)));
+        }
+        _size = size;
+        return _addr;
+    }
+
+private:
+    void *_addr;
+    size_t _size;
+};
+
+#endif
@@ -0,0 +1,538 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// 共享内存hash引擎基准测试的公共部分: 命令行参数、key/value生成和匿名共享内存。
+// 结果由Google Benchmark输出，加上--benchmark_format=json或--benchmark_out=xxx.json即为json格式。
+
+#ifndef __BENCH_COMMON_H__
+#define __BENCH_COMMON_H__
+
+#include <sys/mman.h>
+#include <time.h>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "AnonShm.h"
+#include "BenchRandom.h"
+
+using namespace std;
+
+struct BenchOptions
+{
+    BenchOptions()
+        : shmSize(256 * 1024 * 1024),
+          jmemNum(10),
+          fill(0.8),
+          keyMin(16),
+          keyMax(16),
+          valueMin(128),
+          valueMax(128),
+          zipf(0.99),
+          keyCount(0),
+          syncBatch(10000),
+          hashRatio(2),
+          ukPerMk(4)
+    {
+        threads.push_back(1);
+    }
+
+    size_t shmSize;          // 每个引擎使用的内存大小
+    unsigned int jmemNum;    // HashMapMallocDCache的内存块个数
+    double fill;             // 预填充的内存使用率
+    size_t keyMin;           // key长度范围
+    size_t keyMax;
+    size_t valueMin;         // value长度范围
+    size_t valueMax;
+    double zipf;             // zipf分布的参数，0为均匀分布
+    size_t keyCount;         // 预填充的key个数，0表示按fill填充
+    size_t syncBatch;        // 每轮回写前置脏的记录数
+    float hashRatio;         // chunk数据块/hash项比值
+    size_t ukPerMk;          // TC_Multi_HashMap_Malloc每个主key下的联合key个数
+    vector<int> threads;     // 测试的线程数
+
+    string desc() const
+    {
+        ostringstream os;
+        os << "shm_size=" << shmSize << " jmem_num=" << jmemNum << " fill=" << fill << " key_size=" << keyMin << ":"
+           << keyMax << " value_size=" << valueMin << ":" << valueMax << " zipf=" << zipf << " key_count=" << keyCount
+           << " sync_batch=" << syncBatch << " hash_ratio=" << hashRatio << " uk_per_mk=" << ukPerMk;
+        return os.str();
+    }
+};
+
+/**
+ * 解析并移除引擎相关的参数，其余参数留给Google Benchmark
+ * --shm_size=256M --jmem_num=10 --fill=0.8 --key_size=16:64 --value_size=64:1K
+ * --zipf=0.99 --key_count=0 --sync_batch=10000 --hash_ratio=2 --uk_per_mk=4 --threads=1,2,4,8
+ */
+inline void parseBenchOptions(int *argc, char **argv, BenchOptions &opt)
+{
+    int n = 1;
+    for (int i = 1; i < *argc; ++i)
+    {
+        string arg = argv[i];
+        string::size_type pos = arg.find('=');
+        string name = arg.substr(0, pos);
+        string value = (pos == string::npos) ? "" : arg.substr(pos + 1);
+
+        if (name == "--shm_size")
+            opt.shmSize = parseSize(value);
+        else if (name == "--jmem_num")
+            opt.jmemNum = unsigned(atoi(value.c_str()));
+        else if (name == "--fill")
+            opt.fill = atof(value.c_str());
+        else if (name == "--key_size")
+            parseRange(value, opt.keyMin, opt.keyMax);
+        else if (name == "--value_size")
+            parseRange(value, opt.valueMin, opt.valueMax);
+        else if (name == "--zipf")
+            opt.zipf = atof(value.c_str());
+        else if (name == "--key_count")
+            opt.keyCount = parseSize(value);
+        else if (name == "--sync_batch")
+            opt.syncBatch = parseSize(value);
+        else if (name == "--hash_ratio")
+            opt.hashRatio = float(atof(value.c_str()));
+        else if (name == "--uk_per_mk")
+            opt.ukPerMk = parseSize(value);
+        else if (name == "--threads")
+        {
+            opt.threads.clear();
+            istringstream is(value);
+            string item;
+            while (getline(is, item, ','))
+            {
+                if (atoi(item.c_str()) > 0)
+                {
+                    opt.threads.push_back(atoi(item.c_str()));
+                }
+            }
+            if (opt.threads.empty())
+            {
+                opt.threads.push_back(1);
+            }
+        }
+        else
+        {
+            argv[n++] = argv[i];
+            continue;
+        }
+    }
+    *argc = n;
+
+    if (opt.jmemNum == 0 || opt.fill <= 0 || opt.fill > 1 || opt.keyMin == 0 || opt.shmSize == 0 || opt.ukPerMk == 0 ||
+        opt.syncBatch == 0)
+    {
+        throw runtime_error("invalid bench options: " + opt.desc());
+    }
+}
+
+/**
+ * key/value生成。第i个key的内容和长度是固定的，方便各线程、各轮测试访问同一批数据
+ */
+class KeySpace
+{
+public:
+    explicit KeySpace(const BenchOptions &opt) : _opt(opt)
+    {
+        std::mt19937_64 rng(20190508);
+        std::uniform_int_distribution<size_t> size(opt.valueMin, opt.valueMax);
+        string pool(opt.valueMax, 'v');
+        for (size_t i = 0; i < pool.size(); ++i)
+        {
+            pool[i] = char('a' + rng() % 26);
+        }
+        for (size_t i = 0; i < VALUE_POOL_SIZE; ++i)
+        {
+            _values.push_back(pool.substr(0, size(rng)));
+        }
+    }
+
+    string key(uint64_t i) const
+    {
+        char buf[32];
+        int len = snprintf(buf, sizeof(buf), "k%019llu", (unsigned long long)i);
+        size_t keyLen = _opt.keyMin;
+        if (_opt.keyMax > _opt.keyMin)
+        {
+            keyLen += mix(i) % (_opt.keyMax - _opt.keyMin + 1);
+        }
+
+        string k(buf, len);
+        if (k.size() > keyLen)
+        {
+            // 保留低位，保证不同的key截断后仍不相同
+            k = k.substr(k.size() - keyLen);
+        }
+        else
+        {
+            k.append(keyLen - k.size(), '#');
+        }
+        return k;
+    }
+
+    const string &value(uint64_t i) const { return _values[mix(i + 1) % _values.size()]; }
+
+    static uint64_t mix(uint64_t x) { return benchMix(x); }
+
+private:
+    static const size_t VALUE_POOL_SIZE = 64;
+
+    const BenchOptions &_opt;
+    vector<string> _values;
+};
+
+/**
+ * 每个测试线程一个独立种子
+ */
+inline uint64_t nextSeed()
+{
+    static std::atomic<uint64_t> seed(1);
+    return KeySpace::mix(seed.fetch_add(1));
+}
+
+/**
+ * 各引擎的测试适配类需要提供以下接口(key都用KeySpace中的下标表示):
+ *   typedef ... Stash;                              erase淘汰出的记录，用于测试后恢复
+ *   bool needLock();                                引擎本身是否无锁，无锁时多线程测试要加进程内锁
+ *   std::mutex &mutex();
+ *   bool insert(uint64_t i);                        预填充，内存不够时返回false
+ *   double fillRatio();                             内存使用率
+ *   int get(uint64_t i, bool bCheckExpire, uint32_t iNow);  返回GET_HIT/GET_MISS/GET_EXPIRED
+ *   void set(uint64_t i, size_t salt, bool bDirty);
+ *   void del(uint64_t i);
+ *   void erase(uint64_t i, Stash &stash);           淘汰一条记录
+ *   void restore(uint64_t i, Stash &stash);         恢复erase/del的记录: stash非空时恢复其中全部记录，否则恢复i
+ *   void syncBegin();
+ *   bool syncStep(uint32_t iNow);                   回写一条记录，整轮完成返回true
+ */
+enum
+{
+    GET_HIT = 0,
+    GET_MISS,
+    GET_EXPIRED,
+};
+
+// 下标为奇数的key在预填充时设置一个早已过去的过期时间，用于测试过期检查
+inline uint32_t benchExpireTime(uint64_t i)
+{
+    return (i & 1) ? 1000 : 0;
+}
+
+template<typename Engine>
+class EngineBench
+{
+public:
+    EngineBench(const string &name, Engine *engine, const BenchOptions &opt)
+        : _name(name), _engine(engine), _opt(opt), _count(0), _zipf(1, 0, 0)
+    {
+    }
+
+    /**
+     * 按fill或key_count预填充，返回填充的key个数
+     */
+    size_t prefill()
+    {
+        size_t n = 0;
+        while ((_opt.keyCount == 0 || n < _opt.keyCount) && _engine->fillRatio() < _opt.fill)
+        {
+            if (!_engine->insert(n))
+            {
+                break;
+            }
+            ++n;
+        }
+        _count = n;
+        _zipf = ZipfGenerator(_count, _opt.zipf, 0);
+        return n;
+    }
+
+    void registerAll()
+    {
+        if (_count == 0)
+        {
+            throw runtime_error(_name + " prefill no key, shm_size too small?");
+        }
+
+        benchmark::AddCustomContext(_name + "_keys", to_string(_count));
+        benchmark::AddCustomContext(_name + "_fill", to_string(_engine->fillRatio()));
+
+        for (size_t t = 0; t < _opt.threads.size(); ++t)
+        {
+            int threads = _opt.threads[t];
+            add("get", &EngineBench::benchGet, threads);
+            add("miss", &EngineBench::benchMiss, threads);
+            add("set", &EngineBench::benchSet, threads);
+            add("del", &EngineBench::benchDel, threads);
+            add("erase", &EngineBench::benchErase, threads);
+            add("expire", &EngineBench::benchExpire, threads);
+        }
+        // 回写是单线程顺序扫描，与线程数无关
+        add("sync", &EngineBench::benchSync, 1);
+    }
+
+private:
+    typedef void (EngineBench::*BenchFunc)(benchmark::State &);
+
+    struct Runner
+    {
+        EngineBench *bench;
+        BenchFunc func;
+
+        void operator()(benchmark::State &state) const { (bench->*func)(state); }
+    };
+
+    void add(const string &op, BenchFunc func, int threads)
+    {
+        Runner runner;
+        runner.bench = this;
+        runner.func = func;
+        benchmark::RegisterBenchmark((_name + "/" + op).c_str(), runner)->Threads(threads)->UseRealTime();
+    }
+
+    // 多线程时为无锁的引擎加锁
+    void lock(benchmark::State &state, std::unique_lock<std::mutex> &guard)
+    {
+        if (_engine->needLock() && state.threads() > 1)
+        {
+            guard = std::unique_lock<std::mutex>(_engine->mutex());
+        }
+    }
+
+    // 每个线程负责key空间中互不重叠的一段，用于会修改数据的del/erase
+    uint64_t rangeBegin(benchmark::State &state) const { return _count * state.thread_index() / state.threads(); }
+
+    uint64_t rangeSize(benchmark::State &state) const
+    {
+        uint64_t n = _count / state.threads();
+        return n > 0 ? n : 1;
+    }
+
+    void benchGet(benchmark::State &state)
+    {
+        ZipfGenerator zipf(_zipf);
+        zipf.reseed(nextSeed());
+
+        size_t hits = 0;
+        for (auto _ : state)
+        {
+            uint64_t i = zipf.next();
+            std::unique_lock<std::mutex> guard;
+            lock(state, guard);
+            if (_engine->get(i, false, 0) == GET_HIT)
+            {
+                ++hits;
+            }
+        }
+        setRatio(state, "hit_ratio", hits);
+    }
+
+    // 访问不存在的key，下标从预填充个数开始，测试未命中时遍历hash链的开销
+    void benchMiss(benchmark::State &state)
+    {
+        ZipfGenerator zipf(_zipf);
+        zipf.reseed(nextSeed());
+
+        size_t hits = 0;
+        for (auto _ : state)
+        {
+            uint64_t i = _count + zipf.next();
+            std::unique_lock<std::mutex> guard;
+            lock(state, guard);
+            if (_engine->get(i, false, 0) == GET_HIT)
+            {
+                ++hits;
+            }
+        }
+        setRatio(state, "hit_ratio", hits);
+    }
+
+    void benchSet(benchmark::State &state)
+    {
+        ZipfGenerator zipf(_zipf);
+        zipf.reseed(nextSeed());
+
+        size_t salt = 0;
+        for (auto _ : state)
+        {
+            uint64_t i = zipf.next();
+            std::unique_lock<std::mutex> guard;
+            lock(state, guard);
+            _engine->set(i, ++salt, true);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void benchExpire(benchmark::State &state)
+    {
+        ZipfGenerator zipf(_zipf);
+        zipf.reseed(nextSeed());
+
+        uint32_t iNow = uint32_t(time(NULL));
+        size_t expired = 0;
+        for (auto _ : state)
+        {
+            uint64_t i = zipf.next();
+            std::unique_lock<std::mutex> guard;
+            lock(state, guard);
+            if (_engine->get(i, true, iNow) == GET_EXPIRED)
+            {
+                ++expired;
+            }
+        }
+        setRatio(state, "expired_ratio", expired);
+    }
+
+    void benchDel(benchmark::State &state)
+    {
+        uint64_t begin = rangeBegin(state), size = rangeSize(state);
+        size_t batch = std::min<size_t>(_opt.syncBatch, size);
+        typename Engine::Stash stash;
+
+        size_t n = 0;
+        for (auto _ : state)
+        {
+            uint64_t i = begin + (n % size);
+            {
+                std::unique_lock<std::mutex> guard;
+                lock(state, guard);
+                _engine->del(i);
+            }
+
+            if (++n % batch == 0)
+            {
+                state.PauseTiming();
+                restore(state, begin, size, n - batch, n, stash);
+                state.ResumeTiming();
+            }
+        }
+        restore(state, begin, size, n - n % batch, n, stash);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void benchErase(benchmark::State &state)
+    {
+        uint64_t begin = rangeBegin(state), size = rangeSize(state);
+        size_t batch = std::min<size_t>(_opt.syncBatch, size);
+        typename Engine::Stash stash;
+
+        size_t n = 0;
+        for (auto _ : state)
+        {
+            uint64_t i = begin + (n % size);
+            {
+                std::unique_lock<std::mutex> guard;
+                lock(state, guard);
+                _engine->erase(i, stash);
+            }
+
+            if (++n % batch == 0)
+            {
+                state.PauseTiming();
+                restore(state, begin, size, n - batch, n, stash);
+                state.ResumeTiming();
+            }
+        }
+        restore(state, begin, size, n - n % batch, n, stash);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    /**
+     * 每轮先置脏sync_batch条记录(不计时)，再计时完整扫描一遍回写链
+     */
+    void benchSync(benchmark::State &state)
+    {
+        size_t batch = std::min<size_t>(_opt.syncBatch, _count);
+        size_t synced = 0;
+        uint64_t next = 0;
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            for (size_t j = 0; j < batch; ++j)
+            {
+                _engine->set(next++ % _count, 0, true);
+            }
+            _engine->syncBegin();
+            state.ResumeTiming();
+
+            uint32_t iNow = uint32_t(time(NULL)) + 1;
+            while (!_engine->syncStep(iNow))
+            {
+                ++synced;
+            }
+        }
+        state.SetItemsProcessed(synced);
+    }
+
+    void restore(benchmark::State &state, uint64_t begin, uint64_t size, size_t from, size_t to,
+                 typename Engine::Stash &stash)
+    {
+        std::unique_lock<std::mutex> guard;
+        lock(state, guard);
+        for (size_t j = from; j < to; ++j)
+        {
+            _engine->restore(begin + (j % size), stash);
+        }
+    }
+
+    void setRatio(benchmark::State &state, const string &name, size_t n)
+    {
+        double ratio = state.iterations() > 0 ? double(n) / state.iterations() : 0;
+        state.counters[name] = benchmark::Counter(ratio, benchmark::Counter::kAvgThreads);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+private:
+    string _name;
+    Engine *_engine;
+    const BenchOptions &_opt;
+    size_t _count;
+    ZipfGenerator _zipf;
+};
+
+/**
+ * 解析参数并初始化Google Benchmark，返回false表示参数错误
+ */
+inline bool initBench(int *argc, char **argv, BenchOptions &opt)
+{
+    try
+    {
+        parseBenchOptions(argc, argv, opt);
+    }
+    catch (exception &ex)
+    {
+        cerr << ex.what() << endl;
+        return false;
+    }
+
+    benchmark::Initialize(argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(*argc, argv))
+    {
+        return false;
+    }
+
+    benchmark::AddCustomContext("dcache_bench_options", opt.desc());
+    return true;
+}
+
+#endif
@@ -0,0 +1,146 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// 基准测试和压测工具共用的随机数工具: 大小解析、64位混淆和zipf分布，不依赖Google Benchmark。
+
+#ifndef __BENCH_RANDOM_H__
+#define __BENCH_RANDOM_H__
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+using namespace std;
+
+/**
+ * 64位混淆(murmur3的fmix64)，用于打散连续的下标
+ */
+inline uint64_t benchMix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// 解析带K/M/G后缀的大小
+inline size_t parseSize(const string &s)
+{
+    char *end = NULL;
+    double v = strtod(s.c_str(), &end);
+    switch (end && *end ? *end : ' ')
+    {
+    case 'G':
+    case 'g':
+        v *= 1024;
+        // fall through
+    case 'M':
+    case 'm':
+        v *= 1024;
+        // fall through
+    case 'K':
+    case 'k':
+        v *= 1024;
+        break;
+    default:
+        break;
+    }
+    return size_t(v);
+}
+
+// 解析"min:max"或单个数值
+inline void parseRange(const string &s, size_t &min, size_t &max)
+{
+    string::size_type pos = s.find(':');
+    min = parseSize(s.substr(0, pos));
+    max = (pos == string::npos) ? min : parseSize(s.substr(pos + 1));
+    if (max < min)
+    {
+        std::swap(min, max);
+    }
+}
+
+/**
+ * zipf分布的key下标生成(Gray等人的方法)，theta为0时为均匀分布。
+ * 热点key经过mix打散，避免集中在相邻的下标上。
+ * zeta的计算是O(n)的，各测试线程拷贝同一个生成器再用reseed换种子
+ */
+class ZipfGenerator
+{
+public:
+    ZipfGenerator(uint64_t n, double theta, uint64_t seed)
+        : _n(n > 0 ? n : 1), _theta(theta), _zetan(0), _alpha(0), _eta(0), _rng(seed), _uniform(0.0, 1.0)
+    {
+        // 该方法要求theta<1
+        if (_theta >= 1)
+        {
+            _theta = 0.9999;
+        }
+        if (_theta > 0)
+        {
+            _zetan = zeta(_n, _theta);
+            double zeta2 = zeta(2, _theta);
+            _alpha = 1.0 / (1.0 - _theta);
+            _eta = (1 - pow(2.0 / _n, 1 - _theta)) / (1 - zeta2 / _zetan);
+        }
+    }
+
+    void reseed(uint64_t seed) { _rng.seed(seed); }
+
+    uint64_t next()
+    {
+        uint64_t rank;
+        if (_theta <= 0)
+        {
+            rank = _rng() % _n;
+        }
+        else
+        {
+            double u = _uniform(_rng);
+            double uz = u * _zetan;
+            if (uz < 1.0)
+                rank = 0;
+            else if (uz < 1.0 + pow(0.5, _theta))
+                rank = 1;
+            else
+                rank = uint64_t(_n * pow(_eta * u - _eta + 1, _alpha)) % _n;
+        }
+        return benchMix(rank) % _n;
+    }
+
+private:
+    static double zeta(uint64_t n, double theta)
+    {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i)
+        {
+            sum += 1.0 / pow(double(i), theta);
+        }
+        return sum;
+    }
+
+private:
+    uint64_t _n;
+    double _theta;
+    double _zetan;
+    double _alpha;
+    double _eta;
+    std::mt19937_64 _rng;
+    std::uniform_real_distribution<double> _uniform;
+};
+
+#endif
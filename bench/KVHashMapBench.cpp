@@ -0,0 +1,334 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// KVCacheServer的共享内存引擎基准测试:
+// TC_HashMapMalloc直接建在匿名共享内存上；HashMapMallocDCache按JmemNum分块，带信号量锁，与线上g_sHashMap一致。
+// Probe/*对比TC_HashMapMalloc只用hash链(chain)和带指纹数组(fingerprint)时按key查找命中、未命中的代价。
+
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+#include <unistd.h>
+#include "servant/Application.h"
+#include "tc_hashmap_malloc.h"
+#include "dcache_jmem_hashmap_malloc.h"
+#include "BenchCommon.h"
+
+using namespace tars;
+using namespace DCache;
+
+/**
+ * TC_HashMapMalloc，引擎本身无锁
+ */
+class RawHashMapEngine
+{
+public:
+    typedef vector<TC_HashMapMalloc::BlockData> Stash;
+
+    RawHashMapEngine(const BenchOptions &opt, const KeySpace &keys, bool bFingerprint = false) : _keys(keys)
+    {
+        _map.initHashRadio(opt.hashRatio);
+        _map.initFingerprint(bFingerprint);
+        _map.initAvgDataSize(uint32_t(opt.keyMin + (opt.valueMin + opt.valueMax) / 2));
+        _map.create(_shm.create(opt.shmSize), opt.shmSize);
+        _map.setAutoErase(false);
+        _map.setSyncTime(0);
+    }
+
+    bool needLock() { return true; }
+
+    std::mutex &mutex() { return _mutex; }
+
+    bool insert(uint64_t i)
+    {
+        vector<TC_HashMapMalloc::BlockData> vtData;
+        return _map.set(_keys.key(i), _keys.value(i), benchExpireTime(i), 0, false, vtData) == TC_HashMapMalloc::RT_OK;
+    }
+
+    double fillRatio() { return double(_map.getMapHead()._iUsedDataMem) / _map.getDataMemSize(); }
+
+    int get(uint64_t i, bool bCheckExpire, uint32_t iNow)
+    {
+        string v;
+        int iRet = _map.get(_keys.key(i), v, bCheckExpire, iNow);
+        if (iRet == TC_HashMapMalloc::RT_OK)
+        {
+            return GET_HIT;
+        }
+        return iRet == TC_HashMapMalloc::RT_DATA_EXPIRED ? GET_EXPIRED : GET_MISS;
+    }
+
+    void set(uint64_t i, size_t salt, bool bDirty)
+    {
+        vector<TC_HashMapMalloc::BlockData> vtData;
+        _map.set(_keys.key(i), _keys.value(i + salt), benchExpireTime(i), 0, bDirty, vtData);
+    }
+
+    void del(uint64_t i)
+    {
+        TC_HashMapMalloc::BlockData data;
+        _map.del(_keys.key(i), data);
+    }
+
+    // 从LRU尾部淘汰一条，与EraseThread的淘汰路径一致
+    void erase(uint64_t i, Stash &stash)
+    {
+        TC_HashMapMalloc::BlockData data;
+        if (_map.erase(1, data, false) == TC_HashMapMalloc::RT_ERASE_OK)
+        {
+            stash.push_back(data);
+        }
+    }
+
+    void restore(uint64_t i, Stash &stash)
+    {
+        vector<TC_HashMapMalloc::BlockData> vtData;
+        if (stash.empty())
+        {
+            _map.set(_keys.key(i), _keys.value(i), benchExpireTime(i), 0, false, vtData);
+            return;
+        }
+
+        for (size_t j = 0; j < stash.size(); ++j)
+        {
+            _map.set(stash[j]._key, stash[j]._value, stash[j]._expiret, 0, stash[j]._dirty, vtData);
+        }
+        stash.clear();
+    }
+
+    void syncBegin() { _map.sync(); }
+
+    bool syncStep(uint32_t iNow)
+    {
+        TC_HashMapMalloc::BlockData data;
+        return _map.sync(iNow, data) == TC_HashMapMalloc::RT_OK;
+    }
+
+    TC_HashMapMalloc &map() { return _map; }
+
+private:
+    const KeySpace &_keys;
+    AnonShm _shm;
+    TC_HashMapMalloc _map;
+    std::mutex _mutex;
+};
+
+/**
+ * 按key查找的代价，单线程，key均匀随机，不修改Get链也不拷贝value:
+ * hit/miss用checkDirty查找已有/不存在的key，chain为探测的hash桶上的平均链表长度
+ */
+class ProbeBench
+{
+public:
+    ProbeBench(const string &name, const KeySpace &keys, TC_HashMapMalloc &map, size_t count)
+        : _name(name), _keys(keys), _map(map), _count(count)
+    {
+    }
+
+    void registerAll()
+    {
+        add("hit", &ProbeBench::benchHit);
+        add("miss", &ProbeBench::benchMiss);
+    }
+
+private:
+    typedef void (ProbeBench::*BenchFunc)(benchmark::State &);
+
+    struct Runner
+    {
+        ProbeBench *bench;
+        BenchFunc func;
+
+        void operator()(benchmark::State &state) const { (bench->*func)(state); }
+    };
+
+    void add(const string &op, BenchFunc func)
+    {
+        Runner runner;
+        runner.bench = this;
+        runner.func = func;
+        benchmark::RegisterBenchmark(("Probe/" + _name + "/" + op).c_str(), runner);
+    }
+
+    // 预先生成key，计时部分不包含key的构造
+    void probe(benchmark::State &state, uint64_t iBase)
+    {
+        std::mt19937_64 rng(nextSeed());
+        uint64_t iChain = 0;
+        vector<string> vtKey(PROBE_KEYS);
+        for (size_t i = 0; i < vtKey.size(); ++i)
+        {
+            vtKey[i] = _keys.key(iBase + rng() % _count);
+            iChain += _map.item(_map.getHashIndex(vtKey[i]))->_iListCount;
+        }
+
+        size_t i = 0, hits = 0;
+        for (auto _ : state)
+        {
+            if (_map.checkDirty(vtKey[i++ % PROBE_KEYS]) != TC_HashMapMalloc::RT_NO_DATA)
+            {
+                ++hits;
+            }
+        }
+        state.counters["chain"] = double(iChain) / vtKey.size();
+        state.counters["hit_ratio"] = state.iterations() > 0 ? double(hits) / state.iterations() : 0;
+    }
+
+    void benchHit(benchmark::State &state) { probe(state, 0); }
+
+    // 下标从预填充个数开始的key都不存在
+    void benchMiss(benchmark::State &state) { probe(state, _count); }
+
+private:
+    enum
+    {
+        PROBE_KEYS = 1 << 16
+    };
+
+    string _name;
+    const KeySpace &_keys;
+    TC_HashMapMalloc &_map;
+    size_t _count;
+};
+
+/**
+ * HashMapMallocDCache，每个jmem一个信号量锁。
+ * 只能用SysV共享内存，attach后立即标记删除，退出时删除信号量
+ */
+class DCacheHashMapEngine
+{
+public:
+    typedef HashMapMallocDCache<SemLockPolicyDCache, ShmStorePolicyDCache> HashMap;
+    typedef vector<int> Stash;
+
+    DCacheHashMapEngine(const BenchOptions &opt, const KeySpace &keys) : _keys(keys)
+    {
+        _key = key_t(0x5dc00000 | (getpid() & 0xfffff));
+
+        _map.init(opt.jmemNum);
+        _map.initHashRadio(opt.hashRatio);
+        _map.initAvgDataSize(opt.keyMin + (opt.valueMin + opt.valueMax) / 2);
+        _map.initLock(_key, opt.jmemNum, -1);
+        _map.initStore(_key, opt.shmSize);
+        _map.setAutoErase(false);
+        _map.setSyncTime(0);
+
+        int iShmID = shmget(_key, 0, 0);
+        if (iShmID != -1)
+        {
+            shmctl(iShmID, IPC_RMID, NULL);
+        }
+    }
+
+    ~DCacheHashMapEngine()
+    {
+        int iSemID = semget(_key, 0, 0);
+        if (iSemID != -1)
+        {
+            semctl(iSemID, 0, IPC_RMID);
+        }
+    }
+
+    bool needLock() { return false; }
+
+    std::mutex &mutex() { return _mutex; }
+
+    bool insert(uint64_t i)
+    {
+        return _map.set(_keys.key(i), _keys.value(i), false, benchExpireTime(i)) == TC_HashMapMalloc::RT_OK;
+    }
+
+    double fillRatio() { return double(_map.getUsedDataMem()) / _map.getDataMemSize(); }
+
+    int get(uint64_t i, bool bCheckExpire, uint32_t iNow)
+    {
+        string v;
+        int iRet = _map.get(_keys.key(i), v, bCheckExpire, iNow);
+        if (iRet == TC_HashMapMalloc::RT_OK)
+        {
+            return GET_HIT;
+        }
+        return iRet == TC_HashMapMalloc::RT_DATA_EXPIRED ? GET_EXPIRED : GET_MISS;
+    }
+
+    void set(uint64_t i, size_t salt, bool bDirty) { _map.set(_keys.key(i), _keys.value(i + salt), bDirty, benchExpireTime(i)); }
+
+    void del(uint64_t i) { _map.del(_keys.key(i)); }
+
+    // 按key淘汰干净数据，与CacheImp中erase接口一致
+    void erase(uint64_t i, Stash &stash) { _map.erase(_keys.key(i)); }
+
+    void restore(uint64_t i, Stash &stash) { _map.set(_keys.key(i), _keys.value(i), false, benchExpireTime(i)); }
+
+    void syncBegin() { _map.sync(); }
+
+    bool syncStep(uint32_t iNow)
+    {
+        SyncAll canSync;
+        return _map.syncOnce(iNow, canSync) == TC_HashMapMalloc::RT_OK;
+    }
+
+private:
+    struct SyncAll
+    {
+        bool operator()(const string &k) { return true; }
+    };
+
+    const KeySpace &_keys;
+    key_t _key;
+    HashMap _map;
+    std::mutex _mutex;
+};
+
+int main(int argc, char **argv)
+{
+    BenchOptions opt;
+    if (!initBench(&argc, argv, opt))
+    {
+        return 1;
+    }
+
+    try
+    {
+        KeySpace keys(opt);
+
+        RawHashMapEngine rawEngine(opt, keys);
+        EngineBench<RawHashMapEngine> rawBench("TC_HashMapMalloc", &rawEngine, opt);
+        size_t rawCount = rawBench.prefill();
+        rawBench.registerAll();
+
+        ProbeBench chainProbe("chain", keys, rawEngine.map(), rawCount);
+        chainProbe.registerAll();
+
+        // 带指纹数组的同样数据
+        RawHashMapEngine fpEngine(opt, keys, true);
+        EngineBench<RawHashMapEngine> fpBench("TC_HashMapMalloc_fingerprint", &fpEngine, opt);
+        ProbeBench fpProbe("fingerprint", keys, fpEngine.map(), fpBench.prefill());
+        fpProbe.registerAll();
+
+        DCacheHashMapEngine dcacheEngine(opt, keys);
+        EngineBench<DCacheHashMapEngine> dcacheBench("HashMapMallocDCache", &dcacheEngine, opt);
+        dcacheBench.prefill();
+        dcacheBench.registerAll();
+
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+    }
+    catch (exception &ex)
+    {
+        cerr << "bench failed: " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
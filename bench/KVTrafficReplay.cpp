@@ -0,0 +1,195 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// KVCacheServer采集文件的回放，key按hash分到jmem_num个TC_HashMapMalloc中，与HashMapMallocDCache一致
+
+#include "servant/Application.h"
+#include "tc_hashmap_malloc.h"
+#include "TrafficReplay.h"
+
+using namespace tars;
+using namespace DCache;
+
+class KVReplayEngine
+{
+public:
+    KVReplayEngine(const ReplayOptions &opt, size_t shmSize) : _readThrough(opt.readThrough)
+    {
+        size_t jmemSize = shmSize / opt.jmemNum;
+        for (unsigned i = 0; i < opt.jmemNum; ++i)
+        {
+            _shm.push_back(new AnonShm());
+            _map.push_back(new TC_HashMapMalloc());
+            _map[i]->initHashRadio(opt.hashRatio);
+            _map[i]->initAvgDataSize(uint32_t(opt.valueSize + 16));
+            _map[i]->create(_shm[i]->create(jmemSize), jmemSize);
+            // 与CacheServer一致，内存不够时不自动淘汰，由淘汰线程按使用率淘汰
+            _map[i]->setAutoErase(false);
+        }
+    }
+
+    ~KVReplayEngine()
+    {
+        for (size_t i = 0; i < _map.size(); ++i)
+        {
+            delete _map[i];
+            delete _shm[i];
+        }
+    }
+
+    static TrafficServerType serverType() { return TST_KV; }
+
+    void replay(const TrafficRecord &r, size_t valueSize, ReplayStat &stat)
+    {
+        TC_HashMapMalloc &map = *_map[r.keyHash % _map.size()];
+        string k = replayKey(r.keyHash, r.keySize);
+        string v;
+        TC_HashMapMalloc::BlockData data;
+
+        switch (r.op)
+        {
+        case TOP_GET:
+        {
+            ++stat.gets;
+            int iRet = map.get(k, v);
+            if (iRet == TC_HashMapMalloc::RT_OK || iRet == TC_HashMapMalloc::RT_ONLY_KEY)
+            {
+                ++stat.replayHits;
+            }
+            else if (_readThrough)
+            {
+                // DB中没有数据时CacheServer只写入key
+                write(map, k, r.result == TRS_ONLY_KEY ? -1 : int(valueSize), stat);
+            }
+            break;
+        }
+        case TOP_INSERT:
+            if (map.get(k, v) != TC_HashMapMalloc::RT_OK)
+            {
+                write(map, k, int(valueSize), stat);
+            }
+            break;
+        case TOP_SET:
+        case TOP_UPDATE:
+            if (r.result != TRS_ERROR)
+            {
+                write(map, k, int(valueSize), stat);
+            }
+            break;
+        case TOP_DEL:
+        case TOP_ERASE:
+            map.del(k, data);
+            break;
+        default:
+            break;
+        }
+    }
+
+    int useRatio()
+    {
+        int iMax = 0;
+        for (size_t i = 0; i < _map.size(); ++i)
+        {
+            iMax = max(iMax, int(_map[i]->getMapHead()._iUsedDataMem * 100 / _map[i]->getDataMemSize()));
+        }
+        return iMax;
+    }
+
+    size_t eraseTo(int ratio)
+    {
+        size_t iCount = 0;
+        for (size_t i = 0; i < _map.size(); ++i)
+        {
+            TC_HashMapMalloc::BlockData data;
+            for (size_t n = 0; n < _map[i]->size(); ++n)
+            {
+                int iRet = _map[i]->erase(ratio, data, false);
+                if (iRet == TC_HashMapMalloc::RT_OK || iRet == TC_HashMapMalloc::RT_READONLY)
+                {
+                    break;
+                }
+                if (iRet == TC_HashMapMalloc::RT_ERASE_OK || iRet == TC_HashMapMalloc::RT_ONLY_KEY)
+                {
+                    ++iCount;
+                }
+            }
+        }
+        return iCount;
+    }
+
+    size_t usedMem()
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < _map.size(); ++i)
+        {
+            n += _map[i]->getMapHead()._iUsedDataMem;
+        }
+        return n;
+    }
+
+    size_t dataMem()
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < _map.size(); ++i)
+        {
+            n += _map[i]->getDataMemSize();
+        }
+        return n;
+    }
+
+    size_t elementCount()
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < _map.size(); ++i)
+        {
+            n += _map[i]->size();
+        }
+        return n;
+    }
+
+private:
+    // valueSize小于0时只写key
+    void write(TC_HashMapMalloc &map, const string &k, int valueSize, ReplayStat &stat)
+    {
+        vector<TC_HashMapMalloc::BlockData> vtData;
+        int iRet = valueSize < 0 ? map.set(k, vtData) : map.set(k, string(valueSize, 'v'), 0, 0, false, vtData);
+        ++stat.writes;
+        if (iRet == TC_HashMapMalloc::RT_NO_MEMORY)
+        {
+            ++stat.noMemory;
+        }
+    }
+
+private:
+    bool _readThrough;
+    vector<AnonShm*> _shm;
+    vector<TC_HashMapMalloc*> _map;
+};
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        ReplayOptions opt;
+        if (!parseReplayOptions(argc, argv, opt))
+        {
+            return 1;
+        }
+        return runReplay<KVReplayEngine>(opt) == 0 ? 0 : 1;
+    }
+    catch (exception &ex)
+    {
+        cerr << "exception: " << ex.what() << endl;
+        return 1;
+    }
+}
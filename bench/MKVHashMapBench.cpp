@@ -0,0 +1,445 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// MKVCacheServer的共享内存引擎基准测试: TC_Multi_HashMap_Malloc直接建在匿名共享内存上，主key为hash类型。
+// 第i个key映射为主key key(i / uk_per_mk)和联合key i % uk_per_mk。
+// Compact/*对比value的tars编码与紧凑编码(CompactRecord)的转换、读字段和条件判断的代价。
+// ZSet/*为单独的zset类型引擎，测试一个大主key下按排名、分值读取的代价，成员个数为1K/100K。
+
+#include "servant/Application.h"
+#include "tc_multi_hashmap_malloc.h"
+#include "MKCacheUtil.h"
+#include "MKCompactRecord.h"
+#include "BenchCommon.h"
+
+using namespace tars;
+using namespace DCache;
+
+/**
+ * TC_Multi_HashMap_Malloc，引擎本身无锁
+ */
+class MultiHashMapEngine
+{
+public:
+    typedef vector<TC_Multi_HashMap_Malloc::Value> Stash;
+
+    MultiHashMapEngine(const BenchOptions &opt, const KeySpace &keys) : _keys(keys), _ukPerMk(opt.ukPerMk)
+    {
+        _map.initMainKeySize(0);
+        _map.initHashRatio(opt.hashRatio);
+        _map.initMainKeyHashRatio(opt.hashRatio * opt.ukPerMk);
+        _map.initDataSize(opt.keyMin + (opt.valueMin + opt.valueMax) / 2);
+        _map.create(_shm.create(opt.shmSize), opt.shmSize, TC_Multi_HashMap_Malloc::MainKey::HASH_TYPE);
+        _map.setAutoErase(false);
+        _map.setSyncTime(0);
+    }
+
+    bool needLock() { return true; }
+
+    std::mutex &mutex() { return _mutex; }
+
+    bool insert(uint64_t i) { return doSet(i, _keys.value(i), false) == TC_Multi_HashMap_Malloc::RT_OK; }
+
+    double fillRatio() { return double(_map.getMapHead()._iUsedDataMem) / _map.getDataMemSize(); }
+
+    int get(uint64_t i, bool bCheckExpire, uint32_t iNow)
+    {
+        string mk = mainKey(i), uk = unionKey(i);
+        TC_Multi_HashMap_Malloc::Value v;
+        int iRet = _map.get(mk, uk, _map.getHashFunctor()(mk + uk), v, bCheckExpire, iNow);
+        if (iRet == TC_Multi_HashMap_Malloc::RT_OK)
+        {
+            return GET_HIT;
+        }
+        return iRet == TC_Multi_HashMap_Malloc::RT_DATA_EXPIRED ? GET_EXPIRED : GET_MISS;
+    }
+
+    void set(uint64_t i, size_t salt, bool bDirty) { doSet(i, _keys.value(i + salt), bDirty); }
+
+    void del(uint64_t i)
+    {
+        TC_Multi_HashMap_Malloc::Value data;
+        _map.del(mainKey(i), unionKey(i), data);
+    }
+
+    // 从LRU尾部淘汰，一次可能淘汰整个主key下的数据
+    void erase(uint64_t i, Stash &stash)
+    {
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        _map.erase(1, vtData, false);
+        stash.insert(stash.end(), vtData.begin(), vtData.end());
+    }
+
+    void restore(uint64_t i, Stash &stash)
+    {
+        if (stash.empty())
+        {
+            doSet(i, _keys.value(i), false);
+            return;
+        }
+
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        for (size_t j = 0; j < stash.size(); ++j)
+        {
+            const TC_Multi_HashMap_Malloc::Value &v = stash[j];
+            _map.set(v._mkey, v._ukey, _map.getHashFunctor()(v._mkey + v._ukey), v._value, v._iExpireTime, 0, v._dirty,
+                     TC_Multi_HashMap_Malloc::AUTO_DATA, true, false, TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+        }
+        stash.clear();
+    }
+
+    void syncBegin() { _map.sync(); }
+
+    bool syncStep(uint32_t iNow)
+    {
+        TC_Multi_HashMap_Malloc::Value data;
+        return _map.sync(iNow, data) == TC_Multi_HashMap_Malloc::RT_OK;
+    }
+
+private:
+    string mainKey(uint64_t i) const { return _keys.key(i / _ukPerMk); }
+
+    string unionKey(uint64_t i) const { return TC_Common::tostr(i % _ukPerMk); }
+
+    int doSet(uint64_t i, const string &value, bool bDirty)
+    {
+        string mk = mainKey(i), uk = unionKey(i);
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        return _map.set(mk, uk, _map.getHashFunctor()(mk + uk), value, benchExpireTime(i), 0, bDirty,
+                        TC_Multi_HashMap_Malloc::AUTO_DATA, true, false, TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+    }
+
+private:
+    const KeySpace &_keys;
+    size_t _ukPerMk;
+    AnonShm _shm;
+    TC_Multi_HashMap_Malloc _map;
+    std::mutex _mutex;
+};
+
+/**
+ * zset类型的TC_Multi_HashMap_Malloc，一个主key下zset_size个成员，成员i的分值为i，
+ * 奇数成员带过期时间，其中一半已过期，用于对比带过期检查时从头逐个遍历的代价
+ */
+class ZSetBench
+{
+public:
+    ZSetBench() : _size(0), _now(0) {}
+
+    static const size_t ZSET_SHM_SIZE = 64 * 1024 * 1024;
+    static const size_t ZSET_RANGE = 10;
+
+    void registerAll()
+    {
+        const int64_t sizes[] = { 1000, 100000 };
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+        {
+            add("range", &ZSetBench::benchRange, sizes[i]);
+            add("range_expire", &ZSetBench::benchRangeExpire, sizes[i]);
+            add("limit", &ZSetBench::benchLimit, sizes[i]);
+            add("rank", &ZSetBench::benchRank, sizes[i]);
+            add("score", &ZSetBench::benchScore, sizes[i]);
+        }
+    }
+
+private:
+    typedef void (ZSetBench::*BenchFunc)(benchmark::State &);
+
+    struct Runner
+    {
+        ZSetBench *bench;
+        BenchFunc func;
+
+        void operator()(benchmark::State &state) const { (bench->*func)(state); }
+    };
+
+    void add(const string &op, BenchFunc func, int64_t size)
+    {
+        Runner runner;
+        runner.bench = this;
+        runner.func = func;
+        benchmark::RegisterBenchmark(("ZSet/" + op).c_str(), runner)->Arg(size);
+    }
+
+    // 按成员个数重建，同一成员个数的各测试项共用
+    void prepare(size_t size)
+    {
+        if (_size == size)
+        {
+            return;
+        }
+
+        _map.reset(new TC_Multi_HashMap_Malloc());
+        _shm.reset(new AnonShm());
+        _map->initMainKeySize(0);
+        _map->initHashRatio(2);
+        _map->initMainKeyHashRatio(8);
+        _map->initDataSize(32);
+        _map->create(_shm->create(ZSET_SHM_SIZE), ZSET_SHM_SIZE, TC_Multi_HashMap_Malloc::MainKey::ZSET_TYPE);
+        _map->setAutoErase(false);
+
+        _now = time(NULL);
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        for (size_t i = 0; i < size; ++i)
+        {
+            string v = member(i);
+            uint32_t iExpireTime = 0;
+            if (i % 2 == 1)
+            {
+                iExpireTime = (i % 4 == 1) ? _now - 100 : _now + 3600;
+            }
+            int iRet = _map->addZSet(MK, v, _map->getHashFunctor()(MK + v), double(i), iExpireTime, 0, false, false,
+                                     TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+            if (iRet != TC_Multi_HashMap_Malloc::RT_OK)
+            {
+                throw runtime_error("addZSet failed, ret:" + TC_Common::tostr(iRet));
+            }
+        }
+        _size = size;
+    }
+
+    static string member(size_t i) { return "member" + TC_Common::tostr(i); }
+
+    // 从中间排名读取ZSET_RANGE个，不检查过期
+    void benchRange(benchmark::State &state)
+    {
+        prepare(state.range(0));
+        uint64_t iStart = _size / 2;
+        for (auto _ : state)
+        {
+            list<TC_Multi_HashMap_Malloc::Value> vtData;
+            _map->getZSet(MK, iStart, iStart + ZSET_RANGE - 1, true, 0, vtData);
+            benchmark::DoNotOptimize(vtData);
+        }
+    }
+
+    // 同上，带过期检查，已过期的成员不占排名，需要从头逐个遍历
+    void benchRangeExpire(benchmark::State &state)
+    {
+        prepare(state.range(0));
+        uint64_t iStart = _size / 2;
+        for (auto _ : state)
+        {
+            list<TC_Multi_HashMap_Malloc::Value> vtData;
+            _map->getZSet(MK, iStart, iStart + ZSET_RANGE - 1, true, _now, vtData);
+            benchmark::DoNotOptimize(vtData);
+        }
+    }
+
+    void benchLimit(benchmark::State &state)
+    {
+        prepare(state.range(0));
+        size_t iStart = _size / 2;
+        for (auto _ : state)
+        {
+            list<TC_Multi_HashMap_Malloc::Value> vtData;
+            _map->getZSetLimit(MK, iStart, ZSET_RANGE, true, _now, vtData);
+            benchmark::DoNotOptimize(vtData);
+        }
+    }
+
+    void benchRank(benchmark::State &state)
+    {
+        prepare(state.range(0));
+        size_t i = 0;
+        for (auto _ : state)
+        {
+            // 只取未过期的偶数成员
+            string v = member((KeySpace::mix(i++) % _size) & ~size_t(1));
+            long iPos = 0;
+            _map->getRankZSet(MK, v, _map->getHashFunctor()(MK + v), true, _now, iPos);
+            benchmark::DoNotOptimize(iPos);
+        }
+    }
+
+    void benchScore(benchmark::State &state)
+    {
+        prepare(state.range(0));
+        double iMin = double(_size / 2);
+        for (auto _ : state)
+        {
+            list<TC_Multi_HashMap_Malloc::Value> vtData;
+            _map->getZSetByScore(MK, iMin, iMin + ZSET_RANGE - 1, _now, vtData);
+            benchmark::DoNotOptimize(vtData);
+        }
+    }
+
+private:
+    static const string MK;
+
+    size_t _size;
+    uint32_t _now;
+    std::unique_ptr<AnonShm> _shm;
+    std::unique_ptr<TC_Multi_HashMap_Malloc> _map;
+};
+
+const string ZSetBench::MK = "zset";
+
+/**
+ * value为6个int、1个double和2个string字段，读取和判断最后一个int字段(tag 6)，
+ * tars编码需从头跳过前面的字段，紧凑编码按偏移直接读取
+ */
+class CompactBench
+{
+public:
+    CompactBench()
+    {
+        TC_Multi_HashMap_Malloc::FieldConf fieldConf;
+        tars::TarsOutputStream<tars::BufferWriter> os;
+        for (uint8_t tag = 0; tag < 9; ++tag)
+        {
+            string sName = "f" + TC_Common::tostr((int)tag);
+            TC_Multi_HashMap_Malloc::FieldInfo info;
+            info.tag = tag;
+            info.bRequire = true;
+            info.lengthInDB = 0;
+            if (tag < 7)
+            {
+                info.type = (tag == 3) ? "double" : "int";
+                info.defValue = "0";
+                if (tag == 3)
+                    os.write(tars::Double(tag * 1.5), tag);
+                else
+                    os.write(tars::Int32(tag * 100000), tag);
+            }
+            else
+            {
+                info.type = "string";
+                info.defValue = "";
+                os.write(string(32, char('a' + tag)), tag);
+            }
+            fieldConf.vtValueName.push_back(sName);
+            fieldConf.mpFieldType[sName] = 2;
+            fieldConf.mpFieldInfo[sName] = info;
+        }
+
+        HashMap::CompactRecord::getInstance()->init(fieldConf, true, "");
+        _tars.assign(os.getBuffer(), os.getLength());
+        _compact = HashMap::CompactRecord::getInstance()->fromTars(_tars);
+    }
+
+    void registerAll()
+    {
+        benchmark::AddCustomContext("compact_tars_size", to_string(_tars.size()));
+        benchmark::AddCustomContext("compact_size", to_string(_compact.size()));
+
+        add("encode", &CompactBench::benchEncode);
+        add("decode", &CompactBench::benchDecode);
+        add("read_tars", &CompactBench::benchReadTars);
+        add("read_compact", &CompactBench::benchReadCompact);
+        add("judge_tars", &CompactBench::benchJudgeTars);
+        add("judge_compact", &CompactBench::benchJudgeCompact);
+    }
+
+private:
+    typedef void (CompactBench::*BenchFunc)(benchmark::State &);
+
+    struct Runner
+    {
+        CompactBench *bench;
+        BenchFunc func;
+
+        void operator()(benchmark::State &state) const { (bench->*func)(state); }
+    };
+
+    void add(const string &op, BenchFunc func)
+    {
+        Runner runner;
+        runner.bench = this;
+        runner.func = func;
+        benchmark::RegisterBenchmark(("Compact/" + op).c_str(), runner);
+    }
+
+    void benchEncode(benchmark::State &state)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(HashMap::CompactRecord::getInstance()->fromTars(_tars));
+        }
+    }
+
+    void benchDecode(benchmark::State &state)
+    {
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(HashMap::CompactRecord::getInstance()->toTars(_compact));
+        }
+    }
+
+    void read(benchmark::State &state, const string &sValue)
+    {
+        for (auto _ : state)
+        {
+            HashMap::TarsDecode decode;
+            decode.setBuffer(sValue);
+            benchmark::DoNotOptimize(decode.read(6, "int", "0", true));
+        }
+    }
+
+    void judge(benchmark::State &state, const string &sValue)
+    {
+        for (auto _ : state)
+        {
+            HashMap::TarsDecode decode;
+            decode.setBuffer(sValue);
+            benchmark::DoNotOptimize(HashMap::judgeValue(decode, "300000", DCache::GE, "int", 6, "0", true));
+        }
+    }
+
+    void benchReadTars(benchmark::State &state) { read(state, _tars); }
+
+    void benchReadCompact(benchmark::State &state) { read(state, _compact); }
+
+    void benchJudgeTars(benchmark::State &state) { judge(state, _tars); }
+
+    void benchJudgeCompact(benchmark::State &state) { judge(state, _compact); }
+
+private:
+    string _tars;
+    string _compact;
+};
+
+int main(int argc, char **argv)
+{
+    BenchOptions opt;
+    if (!initBench(&argc, argv, opt))
+    {
+        return 1;
+    }
+
+    try
+    {
+        KeySpace keys(opt);
+
+        MultiHashMapEngine engine(opt, keys);
+        EngineBench<MultiHashMapEngine> bench("TC_Multi_HashMap_Malloc", &engine, opt);
+        bench.prefill();
+        bench.registerAll();
+
+        ZSetBench zsetBench;
+        zsetBench.registerAll();
+
+        CompactBench compactBench;
+        compactBench.registerAll();
+
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+    }
+    catch (exception &ex)
+    {
+        cerr << "bench failed: " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
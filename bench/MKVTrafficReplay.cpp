@@ -0,0 +1,141 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// MKVCacheServer(hash类型)采集文件的回放，引擎为TC_Multi_HashMap_Malloc
+
+#include "servant/Application.h"
+#include "tc_multi_hashmap_malloc.h"
+#include "TrafficReplay.h"
+
+using namespace tars;
+using namespace DCache;
+
+class MKVReplayEngine
+{
+public:
+    MKVReplayEngine(const ReplayOptions &opt, size_t shmSize) : _readThrough(opt.readThrough)
+    {
+        _map.initMainKeySize(0);
+        _map.initHashRatio(opt.hashRatio);
+        _map.initMainKeyHashRatio(opt.hashRatio * opt.ukPerMk);
+        _map.initDataSize(opt.valueSize + 16);
+        _map.create(_shm.create(shmSize), shmSize, TC_Multi_HashMap_Malloc::MainKey::HASH_TYPE);
+        // 与MKVCacheServer一致，内存不够时不自动淘汰，由淘汰线程按使用率淘汰
+        _map.setAutoErase(false);
+    }
+
+    static TrafficServerType serverType() { return TST_MKV; }
+
+    void replay(const TrafficRecord &r, size_t valueSize, ReplayStat &stat)
+    {
+        string mk = replayKey(r.keyHash, r.keySize);
+        size_t iCount = 0;
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+
+        switch (r.op)
+        {
+        case TOP_GET_MK:
+        {
+            ++stat.gets;
+            int iRet = _map.get(mk, iCount);
+            if (iRet == TC_Multi_HashMap_Malloc::RT_OK && iCount > 0)
+            {
+                ++stat.replayHits;
+            }
+            else if (_readThrough)
+            {
+                // 不知道主key下的数据条数，按一条写入
+                write(mk, "0", valueSize, TC_Multi_HashMap_Malloc::FULL_DATA, stat);
+            }
+            break;
+        }
+        case TOP_INSERT:
+            if (r.result != TRS_ERROR)
+            {
+                write(mk, replayKey(r.subKeyHash, r.subKeySize), valueSize, TC_Multi_HashMap_Malloc::AUTO_DATA, stat);
+            }
+            break;
+        case TOP_UPDATE_MK:
+            // 更新后的数据长度未知，只更新主key的访问时间
+            _map.get(mk, iCount);
+            break;
+        case TOP_DEL_MK:
+        case TOP_ERASE_MK:
+            _map.del(mk, vtData);
+            break;
+        default:
+            break;
+        }
+    }
+
+    int useRatio() { return int(_map.getMapHead()._iUsedDataMem * 100 / _map.getDataMemSize()); }
+
+    size_t eraseTo(int ratio)
+    {
+        size_t iCount = 0;
+        for (size_t n = 0; n < _map.size(); ++n)
+        {
+            vector<TC_Multi_HashMap_Malloc::Value> vtData;
+            int iRet = _map.erase(ratio, vtData, false);
+            iCount += vtData.size();
+            if (iRet == TC_Multi_HashMap_Malloc::RT_OK || iRet == TC_Multi_HashMap_Malloc::RT_READONLY)
+            {
+                break;
+            }
+        }
+        return iCount;
+    }
+
+    size_t usedMem() { return _map.getMapHead()._iUsedDataMem; }
+
+    size_t dataMem() { return _map.getDataMemSize(); }
+
+    size_t elementCount() { return _map.size(); }
+
+private:
+    void write(const string &mk, const string &uk, size_t valueSize, TC_Multi_HashMap_Malloc::DATATYPE eType,
+               ReplayStat &stat)
+    {
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        int iRet = _map.set(mk, uk, _map.getHashFunctor()(mk + uk), string(valueSize, 'v'), 0, 0, false, eType, true,
+                            false, TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+        ++stat.writes;
+        if (iRet == TC_Multi_HashMap_Malloc::RT_NO_MEMORY)
+        {
+            ++stat.noMemory;
+        }
+    }
+
+private:
+    bool _readThrough;
+    AnonShm _shm;
+    TC_Multi_HashMap_Malloc _map;
+};
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        ReplayOptions opt;
+        if (!parseReplayOptions(argc, argv, opt))
+        {
+            return 1;
+        }
+        return runReplay<MKVReplayEngine>(opt) == 0 ? 0 : 1;
+    }
+    catch (exception &ex)
+    {
+        cerr << "exception: " << ex.what() << endl;
+        return 1;
+    }
+}
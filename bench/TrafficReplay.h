@@ -0,0 +1,316 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// 流量回放的公共部分: 命令行参数、读采集文件、淘汰和结果统计。
+// 采集文件只有key的hash和长度，回放时用hash还原出长度相同的key，value用指定长度的固定内容填充。
+
+#ifndef __TRAFFIC_REPLAY_H__
+#define __TRAFFIC_REPLAY_H__
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TrafficTrace.h"
+#include "AnonShm.h"
+#include "BenchRandom.h"
+
+using namespace std;
+
+struct ReplayOptions
+{
+    size_t shmSize;          // 内存大小，按采样率缩小前的值
+    unsigned jmemNum;        // KV按key的hash分成的内存块个数
+    float hashRatio;         // chunk数据块/hash项比值
+    size_t ukPerMk;          // MKV每个主key下平均的联合key个数，用于主key的hash比
+    size_t valueSize;        // 读穿透时不知道数据长度的key使用的value长度
+    int eraseRatio;          // 内存使用率超过该值时淘汰，对应/Main/Cache<EraseRadio>
+    uint32_t eraseInterval;  // 检查淘汰的间隔(采集文件中的时间，秒)，对应/Main/Cache<EraseInterval>
+    bool readThrough;        // 读不命中时写入数据，模拟从DB加载
+    bool scaleShm;           // 按采样率缩小内存
+    vector<string> files;
+
+    ReplayOptions()
+        : shmSize(256 * 1024 * 1024), jmemNum(10), hashRatio(2), ukPerMk(4), valueSize(128), eraseRatio(95),
+          eraseInterval(5), readThrough(true), scaleShm(true)
+    {
+    }
+};
+
+// 目录下的.trace文件按文件名排序，即按采集时间排序
+inline void listTraceFiles(const string &path, vector<string> &files)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {
+        throw runtime_error("cannot access " + path);
+    }
+
+    if (!S_ISDIR(st.st_mode))
+    {
+        files.push_back(path);
+        return;
+    }
+
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL)
+    {
+        throw runtime_error("cannot open dir " + path);
+    }
+
+    vector<string> vtFile;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+    {
+        string name = ent->d_name;
+        if (name.size() > 6 && name.compare(name.size() - 6, 6, ".trace") == 0)
+        {
+            vtFile.push_back(path + "/" + name);
+        }
+    }
+    closedir(dir);
+
+    sort(vtFile.begin(), vtFile.end());
+    files.insert(files.end(), vtFile.begin(), vtFile.end());
+}
+
+/**
+ * --shm_size=256M --jmem_num=10 --hash_ratio=2 --uk_per_mk=4 --value_size=128
+ * --erase_ratio=95 --erase_interval=5 --read_through=Y --scale_shm=Y file_or_dir ...
+ */
+inline bool parseReplayOptions(int argc, char **argv, ReplayOptions &opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0)
+        {
+            listTraceFiles(arg, opt.files);
+            continue;
+        }
+
+        string::size_type pos = arg.find('=');
+        string name = arg.substr(0, pos);
+        string value = (pos == string::npos) ? "" : arg.substr(pos + 1);
+
+        if (name == "--shm_size")
+            opt.shmSize = parseSize(value);
+        else if (name == "--jmem_num")
+            opt.jmemNum = unsigned(atoi(value.c_str()));
+        else if (name == "--hash_ratio")
+            opt.hashRatio = float(atof(value.c_str()));
+        else if (name == "--uk_per_mk")
+            opt.ukPerMk = parseSize(value);
+        else if (name == "--value_size")
+            opt.valueSize = parseSize(value);
+        else if (name == "--erase_ratio")
+            opt.eraseRatio = atoi(value.c_str());
+        else if (name == "--erase_interval")
+            opt.eraseInterval = uint32_t(atoi(value.c_str()));
+        else if (name == "--read_through")
+            opt.readThrough = (value == "Y" || value == "y");
+        else if (name == "--scale_shm")
+            opt.scaleShm = (value == "Y" || value == "y");
+        else
+        {
+            cerr << "unknown option: " << arg << endl;
+            return false;
+        }
+    }
+
+    if (opt.files.empty() || opt.jmemNum == 0 || opt.shmSize == 0 || opt.ukPerMk == 0 || opt.eraseRatio <= 0 ||
+        opt.eraseRatio > 100)
+    {
+        cerr << "usage: " << argv[0] << " [--shm_size=256M] [--jmem_num=10] [--hash_ratio=2] [--uk_per_mk=4]"
+             << " [--value_size=128] [--erase_ratio=95] [--erase_interval=5] [--read_through=Y] [--scale_shm=Y]"
+             << " file_or_dir ..." << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * 由hash还原key: 前8字节为hash，不足的补'#'。
+ * key短于8字节时不同的key可能还原成同一个，对命中率的影响可忽略
+ */
+inline string replayKey(uint64_t hash, uint16_t size)
+{
+    string k((const char *)&hash, sizeof(hash));
+    if (size == 0 || size == sizeof(hash))
+    {
+        return k;
+    }
+    return size < sizeof(hash) ? k.substr(0, size) : k.append(size - sizeof(hash), '#');
+}
+
+struct ReplayStat
+{
+    uint64_t records;
+    uint64_t gets;           // 读请求数(TOP_GET和TOP_GET_MK)
+    uint64_t traceHits;      // 采集时命中的读请求数
+    uint64_t replayHits;     // 回放时命中的读请求数
+    uint64_t writes;
+    uint64_t noMemory;       // 内存不够写入失败
+    uint64_t erased;         // 淘汰的记录数
+    uint64_t opCount[TOP_ERASE_MK + 1];
+
+    ReplayStat() { memset(this, 0, sizeof(*this)); }
+};
+
+inline uint64_t replayNowUs()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return uint64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+}
+
+/**
+ * 引擎适配类需要提供以下接口:
+ *   Engine(const ReplayOptions &opt, size_t shmSize);
+ *   static TrafficServerType serverType();
+ *   void replay(const TrafficRecord &r, size_t valueSize, ReplayStat &stat);  回放一条记录，读请求更新gets/replayHits
+ *   int useRatio();                                内存使用率，百分比
+ *   size_t eraseTo(int ratio);                     从LRU尾部淘汰到使用率低于ratio，返回淘汰的记录数
+ *   size_t usedMem(); size_t dataMem(); size_t elementCount();
+ */
+template <typename Engine>
+int runReplay(const ReplayOptions &opt)
+{
+    ReplayStat stat;
+    TrafficTraceReader reader;
+    Engine *engine = NULL;
+    uint32_t iSampleRate = 0;
+    uint64_t iFirstUs = 0, iLastUs = 0, iLastEraseUs = 0;
+
+    // 记录过的value长度，读穿透时按原长度写入
+    unordered_map<uint64_t, uint32_t> mValueSize;
+
+    uint64_t iBegin = replayNowUs();
+    for (size_t f = 0; f < opt.files.size(); ++f)
+    {
+        if (reader.open(opt.files[f]) != 0)
+        {
+            cerr << reader.getError() << endl;
+            delete engine;
+            return -1;
+        }
+
+        const TrafficTraceHeader &header = reader.getHeader();
+        if (header.serverType != Engine::serverType())
+        {
+            cerr << opt.files[f] << " is captured from another server type" << endl;
+            delete engine;
+            return -1;
+        }
+
+        if (engine == NULL)
+        {
+            iSampleRate = header.sampleRate;
+            size_t shmSize = opt.scaleShm ? opt.shmSize / max<uint32_t>(iSampleRate, 1) : opt.shmSize;
+            cout << "sample rate: 1/" << iSampleRate << ", shm size: " << shmSize << endl;
+            engine = new Engine(opt, shmSize);
+        }
+        else if (header.sampleRate != iSampleRate)
+        {
+            cerr << opt.files[f] << " has different sample rate " << header.sampleRate << endl;
+            delete engine;
+            return -1;
+        }
+
+        TrafficRecord r;
+        while (reader.next(r))
+        {
+            if (r.op < TOP_GET || r.op > TOP_ERASE_MK)
+            {
+                continue;
+            }
+
+            if (iFirstUs == 0)
+            {
+                iFirstUs = iLastEraseUs = r.timeUs;
+            }
+            iLastUs = r.timeUs;
+
+            // 与EraseThread一致: 每EraseInterval秒检查一次，超过使用率后淘汰到使用率以下
+            if (r.timeUs >= iLastEraseUs + uint64_t(opt.eraseInterval) * 1000000)
+            {
+                iLastEraseUs = r.timeUs;
+                if (engine->useRatio() >= opt.eraseRatio)
+                {
+                    stat.erased += engine->eraseTo(opt.eraseRatio);
+                }
+            }
+
+            uint64_t iKey = r.keyHash ^ (uint64_t(r.subKeyHash) << 32);
+            size_t valueSize = opt.valueSize;
+            if (r.valueSize > 0)
+            {
+                mValueSize[iKey] = r.valueSize;
+                valueSize = r.valueSize;
+            }
+            else if (r.op == TOP_GET || r.op == TOP_GET_MK)
+            {
+                unordered_map<uint64_t, uint32_t>::const_iterator it = mValueSize.find(iKey);
+                if (it != mValueSize.end())
+                {
+                    valueSize = it->second;
+                }
+            }
+
+            ++stat.records;
+            ++stat.opCount[r.op];
+            if ((r.op == TOP_GET || r.op == TOP_GET_MK) && (r.result == TRS_HIT || r.result == TRS_ONLY_KEY))
+            {
+                ++stat.traceHits;
+            }
+            engine->replay(r, valueSize, stat);
+        }
+        reader.close();
+    }
+    uint64_t iCost = replayNowUs() - iBegin;
+
+    if (engine == NULL)
+    {
+        cerr << "no trace file" << endl;
+        return -1;
+    }
+
+    static const char *opNames[] = {"", "get", "set", "insert", "update", "del", "erase", "getMK", "updateMK", "delMK",
+                                    "eraseMK"};
+    cout << "records: " << stat.records << ", trace duration: " << (iLastUs - iFirstUs) / 1000000 << "s"
+         << ", replay cost: " << iCost / 1000 << "ms, ops/s: " << (iCost > 0 ? stat.records * 1000000 / iCost : 0)
+         << endl;
+    for (int op = TOP_GET; op <= TOP_ERASE_MK; ++op)
+    {
+        if (stat.opCount[op] > 0)
+        {
+            cout << "  " << opNames[op] << ": " << stat.opCount[op] << endl;
+        }
+    }
+    cout << "hit ratio: trace " << (stat.gets > 0 ? double(stat.traceHits) / stat.gets : 0) << ", replay "
+         << (stat.gets > 0 ? double(stat.replayHits) / stat.gets : 0) << " (" << stat.gets << " gets)" << endl
+         << "memory: used " << engine->usedMem() << " / " << engine->dataMem() << ", elements: "
+         << engine->elementCount() << endl
+         << "erased: " << stat.erased << ", no memory: " << stat.noMemory << " (" << stat.writes << " writes)" << endl;
+
+    delete engine;
+    return 0;
+}
+
+#endif
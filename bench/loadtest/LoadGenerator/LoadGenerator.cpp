@@ -0,0 +1,455 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "util/tc_common.h"
+#include "LoadGenerator.h"
+
+/**
+ * 每个请求一个回调对象，记录请求类型和排定的发送时间
+ */
+class LoadCallback : public ProxyPrxCallback
+{
+public:
+    LoadCallback(LoadGenerator *gen, LoadOp op, int64_t scheduleUs) : _gen(gen), _op(op), _scheduleUs(scheduleUs) {}
+
+    virtual void callback_getKV(tars::Int32 ret, const GetKVRsp &rsp) { _gen->onResponse(_op, _scheduleUs, ret, false); }
+    virtual void callback_getKV_exception(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, true); }
+
+    virtual void callback_getKVBatch(tars::Int32 ret, const GetKVBatchRsp &rsp) { _gen->onResponse(_op, _scheduleUs, ret, false); }
+    virtual void callback_getKVBatch_exception(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, true); }
+
+    virtual void callback_setKV(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, false); }
+    virtual void callback_setKV_exception(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, true); }
+
+    virtual void callback_getMKV(tars::Int32 ret, const GetMKVRsp &rsp) { _gen->onResponse(_op, _scheduleUs, ret, false); }
+    virtual void callback_getMKV_exception(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, true); }
+
+    virtual void callback_insertMKV(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, false); }
+    virtual void callback_insertMKV_exception(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, true); }
+
+    virtual void callback_addZSet(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, false); }
+    virtual void callback_addZSet_exception(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, true); }
+
+    virtual void callback_getZSetByPos(tars::Int32 ret, const BatchEntry &rsp) { _gen->onResponse(_op, _scheduleUs, ret, false); }
+    virtual void callback_getZSetByPos_exception(tars::Int32 ret) { _gen->onResponse(_op, _scheduleUs, ret, true); }
+
+private:
+    LoadGenerator *_gen;
+    LoadOp _op;
+    int64_t _scheduleUs;
+};
+
+LoadGenerator::LoadGenerator(const LoadOptions &opt)
+    : _opt(opt),
+      _totalWeight(0),
+      _zipf(opt.keyCount, opt.zipf, 20190508),
+      _measureBeginUs(0),
+      _measureEndUs(0),
+      _inflight(0),
+      _prefillFail(0)
+{
+}
+
+const char *LoadGenerator::opName(int op)
+{
+    static const char *names[OP_COUNT] = {"getKV", "getKVBatch", "setKV", "getMKV", "insertMKV", "addZSet", "getZSetByPos"};
+    return (op >= 0 && op < OP_COUNT) ? names[op] : "unknown";
+}
+
+int LoadGenerator::init()
+{
+    if (_opt.proxyObj.empty() || _opt.keyCount == 0 || _opt.rate == 0 || _opt.senderThreads == 0 || _opt.ukPerMk == 0)
+    {
+        cerr << "invalid options: proxy, key_count, rate, threads and uk_per_mk are required" << endl;
+        return -1;
+    }
+
+    // 解析请求比例，格式: op:weight,op:weight
+    vector<string> vtItem = TC_Common::sepstr<string>(_opt.mix, ",");
+    for (size_t i = 0; i < vtItem.size(); ++i)
+    {
+        vector<string> vtPair = TC_Common::sepstr<string>(vtItem[i], ":");
+        uint64_t weight = vtPair.size() > 1 ? TC_Common::strto<uint64_t>(vtPair[1]) : 1;
+
+        int op = 0;
+        for (; op < OP_COUNT; ++op)
+        {
+            if (TC_Common::trim(vtPair[0]) == opName(op))
+            {
+                break;
+            }
+        }
+        if (op == OP_COUNT)
+        {
+            cerr << "unknown op in mix: " << vtItem[i] << endl;
+            return -1;
+        }
+
+        const string &sModule = (op <= OP_SET_KV) ? _opt.kvModule : (op <= OP_INSERT_MKV ? _opt.mkvModule : _opt.zsetModule);
+        if (sModule.empty())
+        {
+            cerr << "op " << opName(op) << " needs its module name, see --kv_module/--mkv_module/--zset_module" << endl;
+            return -1;
+        }
+
+        if (weight > 0)
+        {
+            _totalWeight += weight;
+            _opWeight.push_back(make_pair(LoadOp(op), _totalWeight));
+        }
+    }
+    if (_totalWeight == 0)
+    {
+        cerr << "empty op mix" << endl;
+        return -1;
+    }
+
+    // value池，第i个key的value固定，方便对比多次压测
+    std::mt19937_64 rng(20190508);
+    std::uniform_int_distribution<size_t> size(_opt.valueMin, _opt.valueMax);
+    string pool(_opt.valueMax, 'v');
+    for (size_t i = 0; i < pool.size(); ++i)
+    {
+        pool[i] = char('a' + rng() % 26);
+    }
+    for (size_t i = 0; i < 64; ++i)
+    {
+        _values.push_back(pool.substr(0, size(rng)));
+    }
+
+    _comm = new Communicator();
+    _comm->setProperty("asyncthread", TC_Common::tostr(_opt.asyncThreads));
+    _proxyPrx = _comm->stringToProxy<ProxyPrx>(_opt.proxyObj);
+    _proxyPrx->tars_timeout(_opt.timeout);
+
+    return 0;
+}
+
+string LoadGenerator::key(uint64_t i) const
+{
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "k%012llu", (unsigned long long)i);
+    return string(buf, len);
+}
+
+LoadOp LoadGenerator::pickOp(uint64_t r) const
+{
+    r %= _totalWeight;
+    for (size_t i = 0; i < _opWeight.size(); ++i)
+    {
+        if (r < _opWeight[i].second)
+        {
+            return _opWeight[i].first;
+        }
+    }
+    return _opWeight.back().first;
+}
+
+void LoadGenerator::issue(LoadOp op, uint64_t i, ZipfGenerator &zipf, int64_t scheduleUs)
+{
+    ++_inflight;
+    ProxyPrxCallbackPtr cb = new LoadCallback(this, op, scheduleUs);
+
+    try
+    {
+        switch (op)
+        {
+        case OP_GET_KV:
+        {
+            GetKVReq req;
+            req.moduleName = _opt.kvModule;
+            req.keyItem = key(i);
+            _proxyPrx->async_getKV(cb, req);
+            break;
+        }
+        case OP_GET_KV_BATCH:
+        {
+            GetKVBatchReq req;
+            req.moduleName = _opt.kvModule;
+            req.keys.push_back(key(i));
+            for (size_t j = 1; j < _opt.batch; ++j)
+            {
+                req.keys.push_back(key(zipf.next()));
+            }
+            _proxyPrx->async_getKVBatch(cb, req);
+            break;
+        }
+        case OP_SET_KV:
+        {
+            SetKVReq req;
+            req.moduleName = _opt.kvModule;
+            req.data.keyItem = key(i);
+            req.data.value = value(i);
+            req.data.dirty = true;
+            _proxyPrx->async_setKV(cb, req);
+            break;
+        }
+        case OP_GET_MKV:
+        {
+            GetMKVReq req;
+            req.moduleName = _opt.mkvModule;
+            req.mainKey = key(i / _opt.ukPerMk);
+            req.field = "*";
+            _proxyPrx->async_getMKV(cb, req);
+            break;
+        }
+        case OP_INSERT_MKV:
+        {
+            InsertMKVReq req;
+            req.moduleName = _opt.mkvModule;
+            req.data.mainKey = key(i / _opt.ukPerMk);
+            req.data.mpValue["uk"].op = DCache::SET;
+            req.data.mpValue["uk"].value = TC_Common::tostr(i % _opt.ukPerMk);
+            req.data.mpValue["value"].op = DCache::SET;
+            req.data.mpValue["value"].value = value(i);
+            req.data.dirty = true;
+            req.data.replace = true;
+            _proxyPrx->async_insertMKV(cb, req);
+            break;
+        }
+        case OP_ADD_ZSET:
+        {
+            AddZSetReq req;
+            req.moduleName = _opt.zsetModule;
+            req.value.mainKey = key(i / _opt.ukPerMk);
+            req.value.data["member"].op = DCache::SET;
+            req.value.data["member"].value = "m" + TC_Common::tostr(i % _opt.ukPerMk);
+            req.value.expireTime = 0;
+            req.value.dirty = true;
+            req.score = double(benchMix(i) % 100000);
+            _proxyPrx->async_addZSet(cb, req);
+            break;
+        }
+        case OP_GET_ZSET_BY_POS:
+        {
+            GetZsetByPosReq req;
+            req.moduleName = _opt.zsetModule;
+            req.mainKey = key(i / _opt.ukPerMk);
+            req.field = "*";
+            req.start = 0;
+            req.end = int64_t(_opt.zsetRange) - 1;
+            req.positiveOrder = true;
+            _proxyPrx->async_getZSetByPos(cb, req);
+            break;
+        }
+        default:
+            --_inflight;
+            break;
+        }
+    }
+    catch (exception &ex)
+    {
+        // 发送队列满等同步抛出的异常，按调用异常统计
+        onResponse(op, scheduleUs, -1, true);
+    }
+}
+
+void LoadGenerator::onResponse(LoadOp op, int64_t scheduleUs, int iRet, bool bException)
+{
+    int64_t nowUs = TC_Common::now2us();
+    bool bFail = bException || (iRet < 0 && iRet != ET_NO_DATA);
+
+    if (scheduleUs >= _measureBeginUs && scheduleUs < _measureEndUs)
+    {
+        TC_LockT<TC_ThreadMutex> lock(_statMutex);
+        OpStat &stat = _stat[op];
+        stat.hist.record(uint64_t(nowUs > scheduleUs ? nowUs - scheduleUs : 0));
+        if (!bFail && iRet == ET_NO_DATA)
+        {
+            ++stat.noData;
+        }
+        else if (!bFail)
+        {
+            ++stat.succ;
+        }
+        else
+        {
+            ++stat.fail;
+            ++stat.errCodes[(bException ? "exception:" : "ret:") + TC_Common::tostr(iRet)];
+        }
+    }
+    else if (scheduleUs == 0 && bFail)
+    {
+        ++_prefillFail;
+    }
+
+    --_inflight;
+}
+
+void LoadGenerator::waitInflight(uint32_t limit)
+{
+    while (_inflight >= limit)
+    {
+        usleep(100);
+    }
+}
+
+void LoadGenerator::prefill()
+{
+    int64_t beginUs = TC_Common::now2us();
+    size_t total = 0;
+    LoadOp ops[3] = {OP_SET_KV, OP_INSERT_MKV, OP_ADD_ZSET};
+    const string *modules[3] = {&_opt.kvModule, &_opt.mkvModule, &_opt.zsetModule};
+
+    for (size_t j = 0; j < 3; ++j)
+    {
+        if (modules[j]->empty())
+        {
+            continue;
+        }
+        for (uint64_t i = 0; i < _opt.keyCount; ++i)
+        {
+            waitInflight(_opt.maxInflight);
+            issue(ops[j], i, _zipf, 0);
+        }
+        total += _opt.keyCount;
+    }
+    waitInflight(1);
+
+    cout << "prefill " << total << " records in " << (TC_Common::now2us() - beginUs) / 1000 << "ms, failed:" << _prefillFail << endl;
+}
+
+void LoadGenerator::sendLoop(uint32_t index)
+{
+    std::mt19937_64 rng(benchMix(index + 1));
+    ZipfGenerator zipf(_zipf);
+    zipf.reseed(benchMix(index + 100));
+
+    // 各发送线程交错排定，合起来为均匀的rate
+    double intervalUs = 1000000.0 * _opt.senderThreads / _opt.rate;
+    int64_t beginUs = _measureBeginUs - int64_t(_opt.warmup) * 1000000;
+    double offsetUs = 1000000.0 * index / _opt.rate;
+
+    for (uint64_t n = 0;; ++n)
+    {
+        int64_t scheduleUs = beginUs + int64_t(offsetUs + n * intervalUs);
+        if (scheduleUs >= _measureEndUs)
+        {
+            break;
+        }
+
+        int64_t nowUs = TC_Common::now2us();
+        if (scheduleUs > nowUs + 50)
+        {
+            usleep(useconds_t(scheduleUs - nowUs));
+        }
+
+        LoadOp op = pickOp(rng());
+        if (_inflight >= _opt.maxInflight)
+        {
+            // 在途请求过多说明服务端已经跟不上，丢弃并计数，不阻塞后续的排定
+            if (scheduleUs >= _measureBeginUs)
+            {
+                TC_LockT<TC_ThreadMutex> lock(_statMutex);
+                ++_stat[op].dropped;
+            }
+            continue;
+        }
+
+        issue(op, zipf.next(), zipf, scheduleUs);
+    }
+}
+
+void LoadGenerator::run()
+{
+    // 留出启动线程的时间
+    int64_t startUs = TC_Common::now2us() + 100000;
+    _measureBeginUs = startUs + int64_t(_opt.warmup) * 1000000;
+    _measureEndUs = _measureBeginUs + int64_t(_opt.duration) * 1000000;
+
+    vector<std::thread *> vtThread;
+    for (uint32_t i = 0; i < _opt.senderThreads; ++i)
+    {
+        vtThread.push_back(new std::thread(&LoadGenerator::sendLoop, this, i));
+    }
+    for (size_t i = 0; i < vtThread.size(); ++i)
+    {
+        vtThread[i]->join();
+        delete vtThread[i];
+    }
+
+    // 等待在途请求返回或超时
+    int64_t deadlineUs = TC_Common::now2us() + int64_t(_opt.timeout) * 1000 + 1000000;
+    while (_inflight > 0 && TC_Common::now2us() < deadlineUs)
+    {
+        usleep(1000);
+    }
+
+    report(double(_opt.duration));
+}
+
+void LoadGenerator::report(double elapsedSec)
+{
+    TC_LockT<TC_ThreadMutex> lock(_statMutex);
+
+    OpStat total;
+    ostringstream text, json;
+    json << "{\"options\":{\"proxy\":\"" << _opt.proxyObj << "\",\"mix\":\"" << _opt.mix << "\",\"rate\":" << _opt.rate
+         << ",\"duration\":" << _opt.duration << ",\"warmup\":" << _opt.warmup << ",\"key_count\":" << _opt.keyCount
+         << ",\"value_size\":\"" << _opt.valueMin << ":" << _opt.valueMax << "\",\"zipf\":" << _opt.zipf
+         << ",\"batch\":" << _opt.batch << ",\"uk_per_mk\":" << _opt.ukPerMk << ",\"max_inflight\":" << _opt.maxInflight
+         << "},\"ops\":{";
+
+    bool bFirst = true;
+    for (int op = 0; op < OP_COUNT; ++op)
+    {
+        const OpStat &stat = _stat[op];
+        uint64_t done = stat.succ + stat.noData + stat.fail;
+        if (done == 0 && stat.dropped == 0)
+        {
+            continue;
+        }
+
+        total.hist.merge(stat.hist);
+        total.succ += stat.succ;
+        total.noData += stat.noData;
+        total.fail += stat.fail;
+        total.dropped += stat.dropped;
+
+        text << opName(op) << ": qps=" << uint64_t(done / elapsedSec) << "|succ=" << stat.succ << "|nodata=" << stat.noData
+             << "|fail=" << stat.fail << "|dropped=" << stat.dropped << "|latency(us) " << stat.hist.summary() << endl;
+        for (map<string, uint64_t>::const_iterator it = stat.errCodes.begin(); it != stat.errCodes.end(); ++it)
+        {
+            text << "    " << it->first << " count=" << it->second << endl;
+        }
+
+        json << (bFirst ? "" : ",") << "\"" << opName(op) << "\":{\"qps\":" << done / elapsedSec << ",\"succ\":" << stat.succ
+             << ",\"nodata\":" << stat.noData << ",\"fail\":" << stat.fail << ",\"dropped\":" << stat.dropped
+             << ",\"latency_us\":" << stat.hist.toJson() << "}";
+        bFirst = false;
+    }
+
+    uint64_t totalDone = total.succ + total.noData + total.fail;
+    text << "total: qps=" << uint64_t(totalDone / elapsedSec) << "|target=" << _opt.rate << "|succ=" << total.succ
+         << "|nodata=" << total.noData << "|fail=" << total.fail << "|dropped=" << total.dropped << "|latency(us) "
+         << total.hist.summary() << endl;
+    json << "},\"total\":{\"qps\":" << totalDone / elapsedSec << ",\"succ\":" << total.succ << ",\"nodata\":" << total.noData
+         << ",\"fail\":" << total.fail << ",\"dropped\":" << total.dropped << ",\"latency_us\":" << total.hist.toJson() << "}}";
+
+    cout << text.str();
+
+    if (!_opt.jsonFile.empty())
+    {
+        ofstream out(_opt.jsonFile.c_str());
+        out << json.str() << endl;
+        if (!out)
+        {
+            cerr << "write json result to " << _opt.jsonFile << " failed" << endl;
+        }
+    }
+}
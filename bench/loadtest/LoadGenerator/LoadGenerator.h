@@ -0,0 +1,177 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __LOAD_GENERATOR_H__
+#define __LOAD_GENERATOR_H__
+
+#include <atomic>
+#include <random>
+#include <map>
+#include <string>
+#include <vector>
+#include "servant/Communicator.h"
+#include "util/tc_thread_mutex.h"
+#include "Proxy.h"
+#include "LatencyHistogram.h"
+#include "BenchRandom.h"
+
+using namespace tars;
+using namespace DCache;
+
+enum LoadOp
+{
+    OP_GET_KV = 0,
+    OP_GET_KV_BATCH,
+    OP_SET_KV,
+    OP_GET_MKV,
+    OP_INSERT_MKV,
+    OP_ADD_ZSET,
+    OP_GET_ZSET_BY_POS,
+    OP_COUNT
+};
+
+struct LoadOptions
+{
+    LoadOptions()
+        : rate(10000),
+          duration(60),
+          warmup(5),
+          senderThreads(2),
+          asyncThreads(4),
+          maxInflight(20000),
+          timeout(3000),
+          keyCount(100000),
+          valueMin(128),
+          valueMax(128),
+          zipf(0.99),
+          batch(10),
+          ukPerMk(4),
+          zsetRange(10),
+          prefill(false)
+    {
+    }
+
+    string proxyObj;        // ProxyObj，可带endpoint直连
+    string kvModule;        // KV模块名
+    string mkvModule;       // MKV hash模块名，字段为mk/uk/value
+    string zsetModule;      // MKV zset模块名，字段为mk/member
+    string mix;             // 请求比例，如getKV:80,setKV:20
+    uint32_t rate;          // 目标请求速率(次/秒)
+    uint32_t duration;      // 统计时长(秒)
+    uint32_t warmup;        // 预热时长(秒)，不计入统计
+    uint32_t senderThreads; // 发送线程数
+    uint32_t asyncThreads;  // communicator的异步回调线程数
+    uint32_t maxInflight;   // 在途请求上限，超过时丢弃本次请求并计数
+    uint32_t timeout;       // 请求超时(毫秒)
+    size_t keyCount;        // key个数
+    size_t valueMin;        // value长度范围
+    size_t valueMax;
+    double zipf;            // zipf分布参数，0为均匀分布
+    size_t batch;           // getKVBatch每次的key个数
+    size_t ukPerMk;         // 每个主key下的联合key/成员个数
+    size_t zsetRange;       // getZSetByPos每次读取的成员个数
+    bool prefill;           // 开始前是否通过Proxy预先写入全部数据
+    string jsonFile;        // json结果输出文件，为空时只打印文本
+};
+
+/**
+ * 开环压测：请求按固定速率排定发送时间，不等待前一个请求返回，
+ * 延时从排定的发送时间算起，服务端变慢时排队的时间也计入延时，避免coordinated omission
+ */
+class LoadGenerator
+{
+public:
+    LoadGenerator(const LoadOptions &opt);
+
+    /**
+     * 解析请求比例、创建Proxy代理
+     * @return int, 0成功，其他失败
+     */
+    int init();
+
+    /**
+     * 预先写入全部数据，只在prefill为true时调用
+     */
+    void prefill();
+
+    /**
+     * 按目标速率运行warmup + duration秒并输出结果
+     */
+    void run();
+
+    /**
+     * 请求返回时由回调调用，排定时间不在统计区间内的请求只减少在途计数
+     * @param scheduleUs, 请求排定的发送时间
+     * @param bException, true表示tars调用异常(超时、网络错误等)，iRet为tars的错误码
+     */
+    void onResponse(LoadOp op, int64_t scheduleUs, int iRet, bool bException);
+
+    static const char *opName(int op);
+
+private:
+    struct OpStat
+    {
+        OpStat() : succ(0), noData(0), fail(0), dropped(0) {}
+
+        LatencyHistogram hist;
+        uint64_t succ;
+        uint64_t noData;
+        uint64_t fail;
+        uint64_t dropped;
+        map<string, uint64_t> errCodes;
+    };
+
+    void sendLoop(uint32_t index);
+
+    LoadOp pickOp(uint64_t r) const;
+
+    /**
+     * 异步发送一个请求
+     * @param i, key下标，MKV按i / ukPerMk取主key
+     * @param zipf, getKVBatch用来选取其余的key
+     */
+    void issue(LoadOp op, uint64_t i, ZipfGenerator &zipf, int64_t scheduleUs);
+
+    // 阻塞直到在途请求数低于上限
+    void waitInflight(uint32_t limit);
+
+    string key(uint64_t i) const;
+
+    const string &value(uint64_t i) const { return _values[benchMix(i + 1) % _values.size()]; }
+
+    void report(double elapsedSec);
+
+private:
+    LoadOptions _opt;
+    CommunicatorPtr _comm;
+    ProxyPrx _proxyPrx;
+
+    // 请求比例的累计权重
+    vector<pair<LoadOp, uint64_t> > _opWeight;
+    uint64_t _totalWeight;
+
+    vector<string> _values;
+    ZipfGenerator _zipf;
+
+    // 统计开始和结束时间，排定时间在此区间外的请求不统计
+    int64_t _measureBeginUs;
+    int64_t _measureEndUs;
+
+    std::atomic<uint32_t> _inflight;
+    std::atomic<uint64_t> _prefillFail;
+
+    TC_ThreadMutex _statMutex;
+    OpStat _stat[OP_COUNT];
+};
+
+#endif
@@ -0,0 +1,105 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <iostream>
+#include "util/tc_option.h"
+#include "LoadGenerator.h"
+
+static void usage(const char *name)
+{
+    cout << "usage: " << name << " --proxy=<ProxyObj@endpoint> [options]" << endl
+         << "  --kv_module=<name>          KV module for getKV/getKVBatch/setKV" << endl
+         << "  --mkv_module=<name>         MKV hash module (fields mk/uk/value) for getMKV/insertMKV" << endl
+         << "  --zset_module=<name>        MKV zset module (fields mk/member) for addZSet/getZSetByPos" << endl
+         << "  --mix=getKV:80,setKV:20     op weights, ops: getKV,getKVBatch,setKV,getMKV,insertMKV,addZSet,getZSetByPos" << endl
+         << "  --rate=10000                target requests per second (open loop)" << endl
+         << "  --duration=60 --warmup=5    measured and warmup seconds" << endl
+         << "  --threads=2                 sender threads" << endl
+         << "  --async_threads=4           communicator callback threads" << endl
+         << "  --max_inflight=20000        requests beyond this are dropped and counted" << endl
+         << "  --timeout=3000              request timeout in ms" << endl
+         << "  --key_count=100000 --value_size=128 (or min:max) --zipf=0.99" << endl
+         << "  --batch=10 --uk_per_mk=4 --zset_range=10" << endl
+         << "  --prefill=Y                 write all keys through the proxy before the run" << endl
+         << "  --json=<file>               also write the result as json" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    TC_Option option;
+    option.decode(argc, argv);
+    if (option.hasParam("help") || option.getValue("proxy").empty())
+    {
+        usage(argv[0]);
+        return option.hasParam("help") ? 0 : 1;
+    }
+
+    LoadOptions opt;
+    opt.proxyObj = option.getValue("proxy");
+    opt.kvModule = option.getValue("kv_module");
+    opt.mkvModule = option.getValue("mkv_module");
+    opt.zsetModule = option.getValue("zset_module");
+    opt.mix = option.hasParam("mix") ? option.getValue("mix") : "getKV:80,setKV:20";
+
+    if (option.hasParam("rate"))
+        opt.rate = TC_Common::strto<uint32_t>(option.getValue("rate"));
+    if (option.hasParam("duration"))
+        opt.duration = TC_Common::strto<uint32_t>(option.getValue("duration"));
+    if (option.hasParam("warmup"))
+        opt.warmup = TC_Common::strto<uint32_t>(option.getValue("warmup"));
+    if (option.hasParam("threads"))
+        opt.senderThreads = TC_Common::strto<uint32_t>(option.getValue("threads"));
+    if (option.hasParam("async_threads"))
+        opt.asyncThreads = TC_Common::strto<uint32_t>(option.getValue("async_threads"));
+    if (option.hasParam("max_inflight"))
+        opt.maxInflight = TC_Common::strto<uint32_t>(option.getValue("max_inflight"));
+    if (option.hasParam("timeout"))
+        opt.timeout = TC_Common::strto<uint32_t>(option.getValue("timeout"));
+    if (option.hasParam("key_count"))
+        opt.keyCount = parseSize(option.getValue("key_count"));
+    if (option.hasParam("value_size"))
+        parseRange(option.getValue("value_size"), opt.valueMin, opt.valueMax);
+    if (option.hasParam("zipf"))
+        opt.zipf = TC_Common::strto<double>(option.getValue("zipf"));
+    if (option.hasParam("batch"))
+        opt.batch = parseSize(option.getValue("batch"));
+    if (option.hasParam("uk_per_mk"))
+        opt.ukPerMk = parseSize(option.getValue("uk_per_mk"));
+    if (option.hasParam("zset_range"))
+        opt.zsetRange = parseSize(option.getValue("zset_range"));
+    opt.prefill = (option.getValue("prefill") == "Y" || option.getValue("prefill") == "y");
+    opt.jsonFile = option.getValue("json");
+
+    try
+    {
+        LoadGenerator generator(opt);
+        if (generator.init() != 0)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+
+        if (opt.prefill)
+        {
+            generator.prefill();
+        }
+        generator.run();
+    }
+    catch (exception &ex)
+    {
+        cerr << "load test failed: " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "MockDbAccessImp.h"
+
+tars::Int32 MockDbAccessImp::get(const string &keyItem, string &value, tars::Int32 &expireTime, tars::TarsCurrentPtr current)
+{
+    g_app.simulateLatency();
+    return g_app.getKV(keyItem, value, expireTime);
+}
+
+tars::Int32 MockDbAccessImp::set(const string &keyItem, const string &value, tars::Int32 expireTime, tars::TarsCurrentPtr current)
+{
+    g_app.simulateLatency();
+    return g_app.setKV(keyItem, value, expireTime);
+}
+
+tars::Int32 MockDbAccessImp::del(const string &keyItem, tars::TarsCurrentPtr current)
+{
+    g_app.simulateLatency();
+    return g_app.delKV(keyItem);
+}
+
+tars::Int32 MockDbAccessImp::select(const string &mainKey,
+                                    const string &field,
+                                    const vector<DbCondition> &vtCond,
+                                    vector<map<string, string> > &vtData,
+                                    tars::TarsCurrentPtr current)
+{
+    g_app.simulateLatency();
+    return g_app.select(mainKey, field, vtCond, vtData);
+}
+
+tars::Int32 MockDbAccessImp::replace(const string &mainKey,
+                                     const map<string, DbUpdateValue> &mpValue,
+                                     const vector<DbCondition> &vtCond,
+                                     tars::TarsCurrentPtr current)
+{
+    g_app.simulateLatency();
+    return g_app.replace(mainKey, mpValue, vtCond);
+}
+
+tars::Int32 MockDbAccessImp::delCond(const string &mainKey, const vector<DbCondition> &vtCond, tars::TarsCurrentPtr current)
+{
+    g_app.simulateLatency();
+    return g_app.delCond(mainKey, vtCond);
+}
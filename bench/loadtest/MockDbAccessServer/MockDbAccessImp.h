@@ -0,0 +1,56 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __MOCK_DBACCESS_IMP_H__
+#define __MOCK_DBACCESS_IMP_H__
+
+#include "DbAccess.h"
+#include "MockDbAccessServer.h"
+
+using namespace tars;
+using namespace std;
+using namespace DCache;
+
+/**
+ * 所有接口先模拟数据库耗时，再转到MockDbAccessServer的内存数据上
+ */
+class MockDbAccessImp : public DCache::DbAccess
+{
+public:
+    MockDbAccessImp() = default;
+    virtual ~MockDbAccessImp() = default;
+    virtual void initialize() {};
+    virtual void destroy() {};
+
+public:
+    virtual tars::Int32 get(const string &keyItem, string &value, tars::Int32 &expireTime, tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 set(const string &keyItem, const string &value, tars::Int32 expireTime, tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 del(const string &keyItem, tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 select(const string &mainKey,
+                               const string &field,
+                               const vector<DbCondition> &vtCond,
+                               vector<map<string, string> > &vtData,
+                               tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 replace(const string &mainKey,
+                                const map<string, DbUpdateValue> &mpValue,
+                                const vector<DbCondition> &vtCond,
+                                tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 delCond(const string &mainKey, const vector<DbCondition> &vtCond, tars::TarsCurrentPtr current);
+};
+
+#endif
@@ -0,0 +1,299 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <unistd.h>
+#include "MockDbAccessServer.h"
+#include "MockDbAccessImp.h"
+
+MockDbAccessServer g_app;
+
+void MockDbAccessServer::initialize()
+{
+    //加载配置文件
+    addConfig("MockDbAccessServer.conf");
+
+    TC_Config conf;
+    conf.parseFile(ServerConfig::BasePath + "MockDbAccessServer.conf");
+
+    _latencyBase = TC_Common::strto<uint32_t>(conf.get("/Main/Latency<Base>", "1000"));
+    _latencyJitter = TC_Common::strto<uint32_t>(conf.get("/Main/Latency<Jitter>", "0"));
+
+    //增加对象
+    addServant<MockDbAccessImp>(ServerConfig::Application + "." + ServerConfig::ServerName + ".DbAccessObj");
+
+    TLOGDEBUG("MockDbAccessServer::initialize succ, latency base:" << _latencyBase << "us jitter:" << _latencyJitter << "us" << endl);
+}
+
+void MockDbAccessServer::simulateLatency()
+{
+    static __thread unsigned int seed = 0;
+    if (seed == 0)
+    {
+        seed = (unsigned int)(pthread_self()) ^ (unsigned int)(TNOWMS);
+    }
+
+    uint32_t iSleep = _latencyBase;
+    if (_latencyJitter > 0)
+    {
+        iSleep += rand_r(&seed) % _latencyJitter;
+    }
+    if (iSleep > 0)
+    {
+        usleep(iSleep);
+    }
+}
+
+int MockDbAccessServer::getKV(const string &keyItem, string &value, int &expireTime)
+{
+    TC_LockT<TC_ThreadMutex> lock(_mutex);
+    map<string, KVRecord>::const_iterator it = _kvData.find(keyItem);
+    if (it == _kvData.end())
+    {
+        return eDbRecordNotExist;
+    }
+    value = it->second.value;
+    expireTime = it->second.expireTime;
+    return eDbSucc;
+}
+
+int MockDbAccessServer::setKV(const string &keyItem, const string &value, int expireTime)
+{
+    TC_LockT<TC_ThreadMutex> lock(_mutex);
+    KVRecord &record = _kvData[keyItem];
+    record.value = value;
+    record.expireTime = expireTime;
+    return eDbSucc;
+}
+
+int MockDbAccessServer::delKV(const string &keyItem)
+{
+    TC_LockT<TC_ThreadMutex> lock(_mutex);
+    _kvData.erase(keyItem);
+    return eDbSucc;
+}
+
+int MockDbAccessServer::select(const string &mainKey, const string &field, const vector<DbCondition> &vtCond, vector<map<string, string> > &vtData)
+{
+    vector<string> vtField;
+    if (field != "*")
+    {
+        vtField = TC_Common::sepstr<string>(field, ",");
+    }
+
+    TC_LockT<TC_ThreadMutex> lock(_mutex);
+    map<string, RecordList>::const_iterator it = _mkvData.find(mainKey);
+    if (it == _mkvData.end())
+    {
+        return 0;
+    }
+
+    const RecordList &records = it->second;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (!matchCond(records[i], vtCond))
+        {
+            continue;
+        }
+
+        if (vtField.empty())
+        {
+            vtData.push_back(records[i]);
+            continue;
+        }
+
+        map<string, string> data;
+        for (size_t j = 0; j < vtField.size(); ++j)
+        {
+            map<string, string>::const_iterator itField = records[i].find(vtField[j]);
+            if (itField != records[i].end())
+            {
+                data[vtField[j]] = itField->second;
+            }
+        }
+        vtData.push_back(data);
+    }
+
+    return int(vtData.size());
+}
+
+int MockDbAccessServer::replace(const string &mainKey, const map<string, DbUpdateValue> &mpValue, const vector<DbCondition> &vtCond)
+{
+    // hash类型的条件为主key和联合key；list/set/zset只有主key条件，数据本身即是唯一键
+    vector<DbCondition> vtKeyCond = vtCond;
+    if (vtCond.size() <= 1)
+    {
+        for (map<string, DbUpdateValue>::const_iterator it = mpValue.begin(); it != mpValue.end(); ++it)
+        {
+            if (it->first == "sDCacheExpireTime" || it->first == "sDCacheZSetScore")
+            {
+                continue;
+            }
+
+            DbCondition cond;
+            cond.fieldName = it->first;
+            cond.op = DCache::EQ;
+            cond.value = it->second.value;
+            cond.type = it->second.type;
+            vtKeyCond.push_back(cond);
+        }
+    }
+
+    TC_LockT<TC_ThreadMutex> lock(_mutex);
+    RecordList &records = _mkvData[mainKey];
+
+    // 与replace into一致，唯一键命中则整条替换，否则插入
+    map<string, string> *pRecord = NULL;
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (matchCond(records[i], vtKeyCond))
+        {
+            pRecord = &records[i];
+            break;
+        }
+    }
+    if (pRecord == NULL)
+    {
+        records.push_back(map<string, string>());
+        pRecord = &records.back();
+        for (size_t i = 0; i < vtCond.size(); ++i)
+        {
+            (*pRecord)[vtCond[i].fieldName] = vtCond[i].value;
+        }
+    }
+
+    for (map<string, DbUpdateValue>::const_iterator it = mpValue.begin(); it != mpValue.end(); ++it)
+    {
+        string &sValue = (*pRecord)[it->first];
+        if (it->second.op == DCache::ADD || it->second.op == DCache::SUB)
+        {
+            int64_t iOld = TC_Common::strto<int64_t>(sValue);
+            int64_t iDelta = TC_Common::strto<int64_t>(it->second.value);
+            sValue = TC_Common::tostr(it->second.op == DCache::ADD ? iOld + iDelta : iOld - iDelta);
+        }
+        else
+        {
+            sValue = it->second.value;
+        }
+    }
+
+    return 1;
+}
+
+int MockDbAccessServer::delCond(const string &mainKey, const vector<DbCondition> &vtCond)
+{
+    TC_LockT<TC_ThreadMutex> lock(_mutex);
+    map<string, RecordList>::iterator it = _mkvData.find(mainKey);
+    if (it == _mkvData.end())
+    {
+        return 0;
+    }
+
+    RecordList &records = it->second;
+    int iDelCount = 0;
+    for (size_t i = 0; i < records.size();)
+    {
+        if (matchCond(records[i], vtCond))
+        {
+            records[i].swap(records.back());
+            records.pop_back();
+            ++iDelCount;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    if (records.empty())
+    {
+        _mkvData.erase(it);
+    }
+
+    return iDelCount;
+}
+
+bool MockDbAccessServer::matchCond(const map<string, string> &record, const vector<DbCondition> &vtCond)
+{
+    for (size_t i = 0; i < vtCond.size(); ++i)
+    {
+        const DbCondition &cond = vtCond[i];
+        map<string, string>::const_iterator it = record.find(cond.fieldName);
+        if (it == record.end())
+        {
+            return false;
+        }
+
+        int iCmp = 0;
+        if (cond.type == DCache::INT)
+        {
+            int64_t iLeft = TC_Common::strto<int64_t>(it->second);
+            int64_t iRight = TC_Common::strto<int64_t>(cond.value);
+            iCmp = iLeft < iRight ? -1 : (iLeft > iRight ? 1 : 0);
+        }
+        else
+        {
+            iCmp = it->second.compare(cond.value);
+        }
+
+        bool bMatch = true;
+        switch (cond.op)
+        {
+        case DCache::EQ:
+            bMatch = (iCmp == 0);
+            break;
+        case DCache::NE:
+            bMatch = (iCmp != 0);
+            break;
+        case DCache::GT:
+            bMatch = (iCmp > 0);
+            break;
+        case DCache::LT:
+            bMatch = (iCmp < 0);
+            break;
+        case DCache::LE:
+            bMatch = (iCmp <= 0);
+            break;
+        case DCache::GE:
+            bMatch = (iCmp >= 0);
+            break;
+        default:
+            break;
+        }
+        if (!bMatch)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void MockDbAccessServer::destroyApp()
+{
+    TLOGDEBUG("MockDbAccessServer::destroyApp succ." << endl);
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        g_app.main(argc, argv);
+
+        g_app.waitForShutdown();
+    }
+    catch(exception &ex)
+    {
+        cerr<< ex.what() << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __MOCK_DBACCESS_SERVER_H_
+#define __MOCK_DBACCESS_SERVER_H_
+
+#include "servant/Application.h"
+#include "util/tc_thread_mutex.h"
+#include "DbAccess.h"
+
+using namespace tars;
+using namespace DCache;
+
+/**
+ * 压测用的DbAccessServer替身，数据保存在进程内存中。
+ * 每次调用按配置sleep一段时间模拟数据库耗时，进程重启后数据丢失
+ **/
+class MockDbAccessServer : public Application
+{
+public:
+    /**
+     * 析构函数
+     **/
+    virtual ~MockDbAccessServer() {};
+
+    /**
+     * 初始化, 进程只会调用一次
+     **/
+    virtual void initialize();
+
+    /**
+     * 析构, 进程退出时会调用一次
+     **/
+    virtual void destroyApp();
+
+    /**
+     * 按/Main/Latency的配置sleep，模拟一次数据库访问
+     */
+    void simulateLatency();
+
+    int getKV(const string &keyItem, string &value, int &expireTime);
+
+    int setKV(const string &keyItem, const string &value, int expireTime);
+
+    int delKV(const string &keyItem);
+
+    int select(const string &mainKey, const string &field, const vector<DbCondition> &vtCond, vector<map<string, string> > &vtData);
+
+    int replace(const string &mainKey, const map<string, DbUpdateValue> &mpValue, const vector<DbCondition> &vtCond);
+
+    int delCond(const string &mainKey, const vector<DbCondition> &vtCond);
+
+private:
+    struct KVRecord
+    {
+        string value;
+        int expireTime;
+    };
+
+    typedef vector<map<string, string> > RecordList;
+
+    static bool matchCond(const map<string, string> &record, const vector<DbCondition> &vtCond);
+
+private:
+    // 模拟的数据库耗时，单位us
+    uint32_t _latencyBase;
+    uint32_t _latencyJitter;
+
+    TC_ThreadMutex _mutex;
+    map<string, KVRecord> _kvData;
+    map<string, RecordList> _mkvData;
+};
+
+extern MockDbAccessServer g_app;
+
+#endif
@@ -0,0 +1,165 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "MockRouterImp.h"
+
+tars::Int32 MockRouterImp::getRouterInfo(const string &moduleName,
+                                         PackTable &packTable,
+                                         tars::TarsCurrentPtr current)
+{
+    if (!g_app.getPackTable(moduleName, packTable))
+    {
+        TLOGERROR("MockRouterImp::getRouterInfo module not found:" << moduleName << endl);
+        return ROUTER_INFO_ERR;
+    }
+    return ROUTER_SUCC;
+}
+
+tars::Int32 MockRouterImp::getRouterInfoFromCache(const string &moduleName,
+                                                  PackTable &packTable,
+                                                  tars::TarsCurrentPtr current)
+{
+    return getRouterInfo(moduleName, packTable, current);
+}
+
+tars::Int32 MockRouterImp::getTransRouterInfo(const string &moduleName,
+                                              tars::Int32 &transInfoListVer,
+                                              vector<TransferInfo> &transferingInfoList,
+                                              PackTable &packTable,
+                                              tars::TarsCurrentPtr current)
+{
+    transInfoListVer = TRANSFER_CLEAN_VERSION;
+    transferingInfoList.clear();
+    return getRouterInfo(moduleName, packTable, current);
+}
+
+tars::Int32 MockRouterImp::getRouterDelta(const string &moduleName,
+                                          tars::Int32 fromVersion,
+                                          RouterDelta &delta,
+                                          tars::TarsCurrentPtr current)
+{
+    PackTable packTable;
+    if (!g_app.getPackTable(moduleName, packTable))
+    {
+        return ROUTER_INFO_ERR;
+    }
+
+    // 路由表不会变化，版本不同时让调用方全量拉取
+    if (fromVersion != packTable.info.version)
+    {
+        return ROUTER_NEED_FULL;
+    }
+
+    delta.fromVersion = fromVersion;
+    delta.toVersion = packTable.info.version;
+    delta.info = packTable.info;
+    return ROUTER_SUCC;
+}
+
+tars::Int32 MockRouterImp::getVersion(const std::string &moduleName, tars::TarsCurrentPtr current)
+{
+    PackTable packTable;
+    if (!g_app.getPackTable(moduleName, packTable))
+    {
+        return ROUTER_INFO_ERR;
+    }
+    return packTable.info.version;
+}
+
+tars::Int32 MockRouterImp::getRouterVersion(const string &moduleName,
+                                            tars::Int32 &version,
+                                            tars::TarsCurrentPtr current)
+{
+    PackTable packTable;
+    if (!g_app.getPackTable(moduleName, packTable))
+    {
+        return ROUTER_INFO_ERR;
+    }
+    version = packTable.info.version;
+    return ROUTER_SUCC;
+}
+
+tars::Int32 MockRouterImp::getRouterVersionBatch(const vector<string> &moduleList,
+                                                 map<string, tars::Int32> &mapModuleVersion,
+                                                 tars::TarsCurrentPtr current)
+{
+    for (size_t i = 0; i < moduleList.size(); ++i)
+    {
+        PackTable packTable;
+        if (g_app.getPackTable(moduleList[i], packTable))
+        {
+            mapModuleVersion[moduleList[i]] = packTable.info.version;
+        }
+    }
+    return ROUTER_SUCC;
+}
+
+tars::Int32 MockRouterImp::heartBeatReport(const string &moduleName,
+                                           const string &groupName,
+                                           const string &serverName,
+                                           tars::TarsCurrentPtr current)
+{
+    return ROUTER_SUCC;
+}
+
+tars::Int32 MockRouterImp::getModuleList(vector<string> &moduleList, tars::TarsCurrentPtr current)
+{
+    moduleList = g_app.getModuleList();
+    return ROUTER_SUCC;
+}
+
+tars::Int32 MockRouterImp::recoverMirrorStat(const string &moduleName,
+                                             const string &groupName,
+                                             const string &mirrorIdc,
+                                             string &err,
+                                             tars::TarsCurrentPtr current)
+{
+    err = "not supported by MockRouterServer";
+    return ROUTER_SYS_ERR;
+}
+
+tars::Int32 MockRouterImp::switchByGroup(const string &moduleName,
+                                         const string &groupName,
+                                         bool bForceSwitch,
+                                         tars::Int32 iDifBinlogTime,
+                                         string &err,
+                                         tars::TarsCurrentPtr current)
+{
+    err = "not supported by MockRouterServer";
+    return ROUTER_SYS_ERR;
+}
+
+tars::Int32 MockRouterImp::getIdcInfo(const string &moduleName,
+                                      const MachineInfo &machineInfo,
+                                      IDCInfo &idcInfo,
+                                      tars::TarsCurrentPtr current)
+{
+    idcInfo.idc = "sz";
+    return ROUTER_SUCC;
+}
+
+tars::Int32 MockRouterImp::serviceRestartReport(const string &moduleName,
+                                                const string &groupName,
+                                                tars::TarsCurrentPtr current)
+{
+    return ROUTER_SUCC;
+}
+
+tars::Bool MockRouterImp::procAdminCommand(const string &command,
+                                           const string &params,
+                                           string &result,
+                                           tars::TarsCurrentPtr current)
+{
+    result = "not supported by MockRouterServer";
+    return false;
+}
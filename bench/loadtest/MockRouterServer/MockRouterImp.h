@@ -0,0 +1,100 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __MOCK_ROUTER_IMP_H__
+#define __MOCK_ROUTER_IMP_H__
+
+#include "Router.h"
+#include "MockRouterServer.h"
+
+using namespace tars;
+using namespace std;
+using namespace DCache;
+
+/**
+ * 只实现Cache和Proxy读路由、上报心跳用到的接口，管理类接口返回ROUTER_SYS_ERR
+ */
+class MockRouterImp : public Router
+{
+public:
+    MockRouterImp() = default;
+    virtual ~MockRouterImp() = default;
+    virtual void initialize() {};
+    virtual void destroy() {};
+
+public:
+    virtual tars::Int32 getRouterInfo(const string &moduleName,
+                                      PackTable &packTable,
+                                      tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getRouterInfoFromCache(const string &moduleName,
+                                               PackTable &packTable,
+                                               tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getTransRouterInfo(const string &moduleName,
+                                           tars::Int32 &transInfoListVer,
+                                           vector<TransferInfo> &transferingInfoList,
+                                           PackTable &packTable,
+                                           tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getRouterDelta(const string &moduleName,
+                                       tars::Int32 fromVersion,
+                                       RouterDelta &delta,
+                                       tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getVersion(const std::string &moduleName, tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getRouterVersion(const string &moduleName,
+                                         tars::Int32 &version,
+                                         tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getRouterVersionBatch(const vector<string> &moduleList,
+                                              map<string, tars::Int32> &mapModuleVersion,
+                                              tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 heartBeatReport(const string &moduleName,
+                                        const string &groupName,
+                                        const string &serverName,
+                                        tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getModuleList(vector<string> &moduleList, tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 recoverMirrorStat(const string &moduleName,
+                                          const string &groupName,
+                                          const string &mirrorIdc,
+                                          string &err,
+                                          tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 switchByGroup(const string &moduleName,
+                                      const string &groupName,
+                                      bool bForceSwitch,
+                                      tars::Int32 iDifBinlogTime,
+                                      string &err,
+                                      tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 getIdcInfo(const string &moduleName,
+                                   const MachineInfo &machineInfo,
+                                   IDCInfo &idcInfo,
+                                   tars::TarsCurrentPtr current);
+
+    virtual tars::Int32 serviceRestartReport(const string &moduleName,
+                                             const string &groupName,
+                                             tars::TarsCurrentPtr current);
+
+    virtual tars::Bool procAdminCommand(const string &command,
+                                        const string &params,
+                                        string &result,
+                                        tars::TarsCurrentPtr current);
+};
+
+#endif
@@ -0,0 +1,145 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "MockRouterServer.h"
+#include "MockRouterImp.h"
+
+MockRouterServer g_app;
+
+void MockRouterServer::initialize()
+{
+    //加载配置文件
+    addConfig("MockRouterServer.conf");
+
+    TC_Config conf;
+    conf.parseFile(ServerConfig::BasePath + "MockRouterServer.conf");
+
+    // 与UnpackTable一致，页数为0xffffffff / PageSize向上取整，页号从0开始
+    uint32_t pageSize = TC_Common::strto<uint32_t>(conf.get("/Main<PageSize>", "10000"));
+    if (pageSize == 0)
+    {
+        throw runtime_error("MockRouterServer::initialize invalid PageSize");
+    }
+    uint32_t pageCount = 0xffffffff / pageSize + (0xffffffff % pageSize > 0 ? 1 : 0);
+
+    vector<string> vModule = conf.getDomainVector("/Main/Module");
+    for (size_t i = 0; i < vModule.size(); ++i)
+    {
+        loadModule(conf, vModule[i], pageCount);
+    }
+
+    if (_moduleList.empty())
+    {
+        throw runtime_error("MockRouterServer::initialize no module configured in /Main/Module");
+    }
+
+    //增加对象
+    addServant<MockRouterImp>(ServerConfig::Application + "." + ServerConfig::ServerName + ".RouterObj");
+
+    TLOGDEBUG("MockRouterServer::initialize succ, module:" << TC_Common::tostr(_moduleList.begin(), _moduleList.end(), "|") << endl);
+}
+
+void MockRouterServer::loadModule(const TC_Config &conf, const string &moduleName, uint32_t pageCount)
+{
+    string sPath = "/Main/Module/" + moduleName;
+    vector<string> vGroup = conf.getDomainVector(sPath);
+    if (vGroup.empty())
+    {
+        throw runtime_error("MockRouterServer::loadModule no group configured for module:" + moduleName);
+    }
+
+    PackTable packTable;
+    packTable.info.id = int(_moduleList.size()) + 1;
+    packTable.info.moduleName = moduleName;
+    packTable.info.version = 1;
+    packTable.info.switch_status = 0;
+
+    uint32_t pagePerGroup = pageCount / vGroup.size();
+    for (size_t i = 0; i < vGroup.size(); ++i)
+    {
+        string sGroupPath = sPath + "/" + vGroup[i];
+        string sIdc = conf.get(sGroupPath + "<Idc>", "sz");
+
+        ServerInfo server;
+        server.id = int(i) + 1;
+        server.serverName = conf.get(sGroupPath + "<ServerName>");
+        server.ip = conf.get(sGroupPath + "<Ip>", "127.0.0.1");
+        server.CacheServant = conf.get(sGroupPath + "<CacheServant>");
+        server.WCacheServant = conf.get(sGroupPath + "<WCacheServant>");
+        server.BinLogServant = conf.get(sGroupPath + "<BinLogServant>");
+        server.RouteClientServant = conf.get(sGroupPath + "<RouteClientServant>");
+        server.idc = sIdc;
+        server.ServerStatus = "M";
+        server.moduleName = moduleName;
+        server.groupName = vGroup[i];
+        server.status = 0;
+        if (server.serverName.empty() || server.CacheServant.empty() || server.WCacheServant.empty())
+        {
+            throw runtime_error("MockRouterServer::loadModule ServerName/CacheServant/WCacheServant required in " + sGroupPath);
+        }
+
+        GroupInfo group;
+        group.id = int(i) + 1;
+        group.moduleName = moduleName;
+        group.groupName = vGroup[i];
+        group.masterServer = server.serverName;
+        group.accessStatus = 0;
+        group.idcList[sIdc].push_back(server.serverName);
+
+        RecordInfo record;
+        record.id = int(i) + 1;
+        record.moduleName = moduleName;
+        record.fromPageNo = int(i * pagePerGroup);
+        record.toPageNo = (i == vGroup.size() - 1) ? int(pageCount - 1) : int((i + 1) * pagePerGroup - 1);
+        record.groupName = vGroup[i];
+
+        packTable.serverList[server.serverName] = server;
+        packTable.groupList[group.groupName] = group;
+        packTable.recordList.push_back(record);
+    }
+
+    _moduleList.push_back(moduleName);
+    _packTables[moduleName] = packTable;
+}
+
+bool MockRouterServer::getPackTable(const string &moduleName, PackTable &packTable) const
+{
+    map<string, PackTable>::const_iterator it = _packTables.find(moduleName);
+    if (it == _packTables.end())
+    {
+        return false;
+    }
+    packTable = it->second;
+    return true;
+}
+
+void MockRouterServer::destroyApp()
+{
+    TLOGDEBUG("MockRouterServer::destroyApp succ." << endl);
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        g_app.main(argc, argv);
+
+        g_app.waitForShutdown();
+    }
+    catch(exception &ex)
+    {
+        cerr<< ex.what() << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,66 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __MOCK_ROUTER_SERVER_H_
+#define __MOCK_ROUTER_SERVER_H_
+
+#include "servant/Application.h"
+#include "util/tc_config.h"
+#include "RouterShare.h"
+
+using namespace tars;
+using namespace DCache;
+
+/**
+ * 压测用的RouterServer替身，不依赖数据库，由配置生成固定的路由表。
+ * 每个模块的页按组平均分配，路由表不会变化，也不会主动推送给Cache和Proxy
+ **/
+class MockRouterServer : public Application
+{
+public:
+    /**
+     * 析构函数
+     **/
+    virtual ~MockRouterServer() {};
+
+    /**
+     * 初始化, 进程只会调用一次
+     **/
+    virtual void initialize();
+
+    /**
+     * 析构, 进程退出时会调用一次
+     **/
+    virtual void destroyApp();
+
+    /**
+     * 获取模块的路由表，模块不存在时返回false
+     */
+    bool getPackTable(const string &moduleName, PackTable &packTable) const;
+
+    const vector<string> &getModuleList() const { return _moduleList; }
+
+private:
+    /**
+     * 根据配置/Main/Module/<模块名>生成路由表
+     */
+    void loadModule(const TC_Config &conf, const string &moduleName, uint32_t pageCount);
+
+private:
+    vector<string> _moduleList;
+    map<string, PackTable> _packTables;
+};
+
+extern MockRouterServer g_app;
+
+#endif
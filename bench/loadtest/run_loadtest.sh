@@ -0,0 +1,189 @@
+#!/bin/bash
+# 在本机启动MockRouterServer、MockDbAccessServer、KVCacheServer、MKVCacheServer(hash和zset各一个)和ProxyServer，
+# 用loadtest-LoadGenerator压测Proxy，结束后停止所有服务。
+# 用法: run_loadtest.sh <编译输出的bin目录> [LoadGenerator参数...]
+# 环境变量:
+#   WORK_DIR            工作目录，存放各服务的配置、数据和日志，默认/tmp/dcache-loadtest
+#   PORT_BASE           起始端口，每个服务占用10个端口，默认17000
+#   SHM_SIZE            每个Cache的共享内存大小，默认512M
+#   AVG_DATA_SIZE       Cache的平均数据大小，默认128
+#   SYNC_INTERVAL       Cache回写脏数据的间隔(秒)，默认60
+#   DB_LATENCY_BASE     MockDbAccessServer每次访问的耗时(微秒)，默认1000
+#   DB_LATENCY_JITTER   在基础耗时上增加的随机耗时上限(微秒)，默认1000
+#   CACHE_THREADS       Cache和Proxy每个adapter的线程数，默认4
+#   LOG_LEVEL           tars日志级别，默认ERROR
+
+set -e
+
+if [ $# -lt 1 ]; then
+    sed -n '2,15p' "$0" | sed 's/^# \{0,1\}//'
+    exit 1
+fi
+
+BIN_DIR=$(cd "$1" && pwd)
+shift
+
+CONF_DIR=$(cd "$(dirname "$0")/conf" && pwd)
+WORK_DIR=${WORK_DIR:-/tmp/dcache-loadtest}
+PORT_BASE=${PORT_BASE:-17000}
+SHM_SIZE=${SHM_SIZE:-512M}
+AVG_DATA_SIZE=${AVG_DATA_SIZE:-128}
+SYNC_INTERVAL=${SYNC_INTERVAL:-60}
+DB_LATENCY_BASE=${DB_LATENCY_BASE:-1000}
+DB_LATENCY_JITTER=${DB_LATENCY_JITTER:-1000}
+CACHE_THREADS=${CACHE_THREADS:-4}
+LOG_LEVEL=${LOG_LEVEL:-ERROR}
+
+# 端口分配: 服务块内依次为各adapter，块内最后一个端口为admin端口
+ROUTER_BLOCK=$((PORT_BASE))
+DB_BLOCK=$((PORT_BASE + 10))
+KV_BLOCK=$((PORT_BASE + 20))
+MKV_BLOCK=$((PORT_BASE + 30))
+ZSET_BLOCK=$((PORT_BASE + 40))
+PROXY_BLOCK=$((PORT_BASE + 50))
+
+# Cache的adapter顺序，与下面的端口替换一致
+CACHE_OBJS="RouterClientObj BackUpObj CacheObj WCacheObj BinLogObj ControlAckObj"
+
+PIDS=""
+
+cleanup()
+{
+    for pid in $PIDS; do
+        kill "$pid" 2>/dev/null || true
+    done
+    wait 2>/dev/null || true
+}
+trap cleanup EXIT INT TERM
+
+# 替换业务配置中的占位符
+# $1 源文件 $2 目标文件 $3 共享内存key
+render_conf()
+{
+    sed -e "s/@ROUTER_PORT@/${ROUTER_BLOCK}/g" \
+        -e "s/@DB_PORT@/${DB_BLOCK}/g" \
+        -e "s/@KV_ROUTERCLIENT_PORT@/$((KV_BLOCK + 0))/g" \
+        -e "s/@KV_CACHE_PORT@/$((KV_BLOCK + 2))/g" \
+        -e "s/@KV_WCACHE_PORT@/$((KV_BLOCK + 3))/g" \
+        -e "s/@KV_BINLOG_PORT@/$((KV_BLOCK + 4))/g" \
+        -e "s/@MKV_ROUTERCLIENT_PORT@/$((MKV_BLOCK + 0))/g" \
+        -e "s/@MKV_CACHE_PORT@/$((MKV_BLOCK + 2))/g" \
+        -e "s/@MKV_WCACHE_PORT@/$((MKV_BLOCK + 3))/g" \
+        -e "s/@MKV_BINLOG_PORT@/$((MKV_BLOCK + 4))/g" \
+        -e "s/@ZSET_ROUTERCLIENT_PORT@/$((ZSET_BLOCK + 0))/g" \
+        -e "s/@ZSET_CACHE_PORT@/$((ZSET_BLOCK + 2))/g" \
+        -e "s/@ZSET_WCACHE_PORT@/$((ZSET_BLOCK + 3))/g" \
+        -e "s/@ZSET_BINLOG_PORT@/$((ZSET_BLOCK + 4))/g" \
+        -e "s/@SHM_KEY@/${3:-0}/g" \
+        -e "s/@SHM_SIZE@/${SHM_SIZE}/g" \
+        -e "s/@AVG_DATA_SIZE@/${AVG_DATA_SIZE}/g" \
+        -e "s/@SYNC_INTERVAL@/${SYNC_INTERVAL}/g" \
+        -e "s/@DB_LATENCY_BASE@/${DB_LATENCY_BASE}/g" \
+        -e "s/@DB_LATENCY_JITTER@/${DB_LATENCY_JITTER}/g" \
+        "$1" > "$2"
+}
+
+# 生成tars框架配置，不依赖registry、node和config等框架服务
+# $1 服务名 $2 端口块 $3 adapter线程数 $4... servant名(不含DCache.<服务名>.)
+gen_tars_conf()
+{
+    local server=$1 block=$2 threads=$3
+    shift 3
+    local dir=${WORK_DIR}/${server}
+    mkdir -p "${dir}/conf" "${dir}/data" "${dir}/log"
+
+    {
+        echo "<tars>"
+        echo "  <application>"
+        echo "    enableset=n"
+        echo "    setdivision=NULL"
+        echo "    <client>"
+        echo "      locator="
+        echo "      sync-invoke-timeout=3000"
+        echo "      async-invoke-timeout=5000"
+        echo "      refresh-endpoint-interval=60000"
+        echo "      report-interval=60000"
+        echo "      asyncthread=${threads}"
+        echo "      modulename=DCache.${server}"
+        echo "    </client>"
+        echo "    <server>"
+        echo "      app=DCache"
+        echo "      server=${server}"
+        echo "      localip=127.0.0.1"
+        echo "      local=tcp -h 127.0.0.1 -p $((block + 9)) -t 10000"
+        echo "      basepath=${dir}/conf/"
+        echo "      datapath=${dir}/data/"
+        echo "      logpath=${dir}/log/"
+        echo "      logsize=100M"
+        echo "      lognum=5"
+        echo "      logLevel=${LOG_LEVEL}"
+        echo "      deactivating-timeout=3000"
+        local i=0
+        for obj in "$@"; do
+            local adapter=DCache.${server}.${obj}Adapter
+            echo "      <${adapter}>"
+            echo "        allow"
+            echo "        endpoint=tcp -h 127.0.0.1 -p $((block + i)) -t 60000"
+            echo "        handlegroup=${adapter}"
+            echo "        maxconns=100000"
+            echo "        protocol=tars"
+            echo "        queuecap=1000000"
+            echo "        queuetimeout=60000"
+            echo "        servant=DCache.${server}.${obj}"
+            echo "        threads=${threads}"
+            echo "      </${adapter}>"
+            i=$((i + 1))
+        done
+        echo "    </server>"
+        echo "  </application>"
+        echo "</tars>"
+    } > "${dir}/conf/tars.conf"
+}
+
+# $1 可执行文件名 $2 服务名
+start_server()
+{
+    local dir=${WORK_DIR}/$2
+    "${BIN_DIR}/$1" --config="${dir}/conf/tars.conf" > "${dir}/log/stdout.log" 2>&1 &
+    PIDS="$PIDS $!"
+    echo "started $2 ($1) pid $!"
+}
+
+rm -rf "${WORK_DIR}"
+mkdir -p "${WORK_DIR}"
+
+gen_tars_conf LoadTestRouter ${ROUTER_BLOCK} 2 RouterObj
+render_conf "${CONF_DIR}/MockRouterServer.conf" "${WORK_DIR}/LoadTestRouter/conf/MockRouterServer.conf"
+
+# MockDbAccessServer每次调用都会sleep，线程数决定了能并发的数据库请求数
+gen_tars_conf LoadTestDbAccess ${DB_BLOCK} 32 DbAccessObj
+render_conf "${CONF_DIR}/MockDbAccessServer.conf" "${WORK_DIR}/LoadTestDbAccess/conf/MockDbAccessServer.conf"
+
+gen_tars_conf LoadTestKVCache1 ${KV_BLOCK} ${CACHE_THREADS} ${CACHE_OBJS}
+render_conf "${CONF_DIR}/CacheServer.conf" "${WORK_DIR}/LoadTestKVCache1/conf/CacheServer.conf" $((PORT_BASE * 10 + 1))
+
+gen_tars_conf LoadTestMKVCache1 ${MKV_BLOCK} ${CACHE_THREADS} ${CACHE_OBJS}
+render_conf "${CONF_DIR}/MKCacheServer-hash.conf" "${WORK_DIR}/LoadTestMKVCache1/conf/MKCacheServer.conf" $((PORT_BASE * 10 + 2))
+
+gen_tars_conf LoadTestZSetCache1 ${ZSET_BLOCK} ${CACHE_THREADS} ${CACHE_OBJS}
+render_conf "${CONF_DIR}/MKCacheServer-zset.conf" "${WORK_DIR}/LoadTestZSetCache1/conf/MKCacheServer.conf" $((PORT_BASE * 10 + 3))
+
+gen_tars_conf LoadTestProxy ${PROXY_BLOCK} ${CACHE_THREADS} ProxyObj RouterClientObj
+render_conf "${CONF_DIR}/ProxyServer.conf" "${WORK_DIR}/LoadTestProxy/conf/ProxyServer.conf"
+
+start_server MockRouterServer LoadTestRouter
+start_server MockDbAccessServer LoadTestDbAccess
+sleep 1
+
+start_server KVCacheServer LoadTestKVCache1
+start_server MKVCacheServer LoadTestMKVCache1
+start_server MKVCacheServer LoadTestZSetCache1
+sleep 3
+
+start_server ProxyServer LoadTestProxy
+# 等Proxy从Router拉取全部模块的路由
+sleep 5
+
+"${BIN_DIR}/loadtest-LoadGenerator" \
+    --proxy="DCache.LoadTestProxy.ProxyObj@tcp -h 127.0.0.1 -p ${PROXY_BLOCK}" \
+    --kv_module=LoadTestKV --mkv_module=LoadTestMKV --zset_module=LoadTestZSet "$@"
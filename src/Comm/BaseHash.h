@@ -18,6 +18,16 @@
 
 using namespace std;
 
+/**
+ * 模块使用的key hash函数编号，记录在路由ModuleInfo和共享内存头中，
+ * 路由页号和hash桶都依赖hash值，模块创建后不能再修改
+ */
+enum HashType
+{
+    HASH_TYPE_NORMAL = 0,   // one-at-a-time，兼容原有模块
+    HASH_TYPE_FAST = 1,     // FastHash，按8字节读取，长key更快
+};
+
 class P_Hash
 {
 public:
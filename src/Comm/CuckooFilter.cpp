@@ -0,0 +1,207 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <algorithm>
+#include "CuckooFilter.h"
+
+CuckooFilter::CuckooFilter()
+    : _cur(0), _bucketMask(0), _maxCount(0), _rand(2463534242U)
+{
+    _gen[0].count = 0;
+    _gen[1].count = 0;
+}
+
+void CuckooFilter::init(size_t iCapacity)
+{
+    //按90%的装载率计算需要的桶个数
+    size_t iBucketNum = 1;
+    while (iBucketNum * SLOT_NUM * 9 / 10 < iCapacity)
+    {
+        iBucketNum <<= 1;
+    }
+
+    _bucketMask = iBucketNum - 1;
+    _maxCount = std::max<size_t>(iBucketNum * SLOT_NUM * 9 / 10, 1);
+    for (int i = 0; i < 2; ++i)
+    {
+        _gen[i].slots.assign(iBucketNum * SLOT_NUM, 0);
+        _gen[i].count = 0;
+    }
+    _cur = 0;
+}
+
+bool CuckooFilter::findInBucket(const Generation &gen, size_t i, uint16_t fp)
+{
+    const uint16_t *p = &gen.slots[i * SLOT_NUM];
+    return p[0] == fp || p[1] == fp || p[2] == fp || p[3] == fp;
+}
+
+bool CuckooFilter::insertToBucket(Generation &gen, size_t i, uint16_t fp)
+{
+    uint16_t *p = &gen.slots[i * SLOT_NUM];
+    for (size_t j = 0; j < SLOT_NUM; ++j)
+    {
+        if (p[j] == 0)
+        {
+            p[j] = fp;
+            ++gen.count;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t CuckooFilter::eraseFromBucket(Generation &gen, size_t i, uint16_t fp)
+{
+    uint16_t *p = &gen.slots[i * SLOT_NUM];
+    size_t iNum = 0;
+    for (size_t j = 0; j < SLOT_NUM; ++j)
+    {
+        if (p[j] == fp)
+        {
+            p[j] = 0;
+            ++iNum;
+        }
+    }
+    gen.count -= iNum;
+    return iNum;
+}
+
+bool CuckooFilter::insert(Generation &gen, size_t i1, uint16_t fp)
+{
+    if (insertToBucket(gen, i1, fp))
+    {
+        return true;
+    }
+
+    size_t i = altIndex(i1, fp);
+    if (insertToBucket(gen, i, fp))
+    {
+        return true;
+    }
+
+    for (int n = 0; n < MAX_KICKS; ++n)
+    {
+        //xorshift32
+        _rand ^= _rand << 13;
+        _rand ^= _rand >> 17;
+        _rand ^= _rand << 5;
+
+        //与桶中随机一个指纹交换，被踢出的指纹放到它的另一个桶
+        uint16_t &slot = gen.slots[i * SLOT_NUM + _rand % SLOT_NUM];
+        std::swap(fp, slot);
+        i = altIndex(i, fp);
+        if (insertToBucket(gen, i, fp))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CuckooFilter::add(uint64_t h)
+{
+    if (_gen[0].slots.empty())
+    {
+        return false;
+    }
+
+    size_t i1 = size_t(h) & _bucketMask;
+    uint16_t fp = fingerprint(h);
+    Generation &gen = _gen[_cur];
+
+    if (findInBucket(gen, i1, fp) || findInBucket(gen, altIndex(i1, fp), fp))
+    {
+        return true;
+    }
+
+    if (!insert(gen, i1, fp) || gen.count >= _maxCount)
+    {
+        rotate();
+        return false;
+    }
+    return true;
+}
+
+bool CuckooFilter::contains(uint64_t h) const
+{
+    if (_gen[0].slots.empty())
+    {
+        return false;
+    }
+
+    size_t i1 = size_t(h) & _bucketMask;
+    uint16_t fp = fingerprint(h);
+    size_t i2 = altIndex(i1, fp);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (_gen[i].count > 0 && (findInBucket(_gen[i], i1, fp) || findInBucket(_gen[i], i2, fp)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CuckooFilter::erase(uint64_t h)
+{
+    if (_gen[0].slots.empty())
+    {
+        return false;
+    }
+
+    size_t i1 = size_t(h) & _bucketMask;
+    uint16_t fp = fingerprint(h);
+    size_t i2 = altIndex(i1, fp);
+    size_t iNum = 0;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (_gen[i].count > 0)
+        {
+            iNum += eraseFromBucket(_gen[i], i1, fp);
+            if (i2 != i1)
+            {
+                iNum += eraseFromBucket(_gen[i], i2, fp);
+            }
+        }
+    }
+    return iNum > 0;
+}
+
+void CuckooFilter::rotate()
+{
+    _cur = 1 - _cur;
+    std::fill(_gen[_cur].slots.begin(), _gen[_cur].slots.end(), 0);
+    _gen[_cur].count = 0;
+}
+
+void CuckooFilter::clear()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        std::fill(_gen[i].slots.begin(), _gen[i].slots.end(), 0);
+        _gen[i].count = 0;
+    }
+}
+
+double CuckooFilter::fpp() const
+{
+    if (_gen[0].slots.empty())
+    {
+        return 0;
+    }
+    return double(2 * SLOT_NUM) * size() / _gen[0].slots.size() / 65535;
+}
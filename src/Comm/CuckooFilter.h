@@ -0,0 +1,128 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _CUCKOO_FILTER_H_
+#define _CUCKOO_FILTER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 分代的cuckoo filter，每个元素只保存16位指纹，每个桶4个槽位，元素可以删除。
+ * 元素由调用方传入的64位hash值表示：低位选桶，高16位为指纹。
+ * 分两代保存，新元素写入当前代，当前代写满或调用rotate时当前代变为旧代、原旧代丢弃，
+ * 因此元素最少保留一代、最多保留两代的时间。
+ * 踢出次数用完时丢弃最后被踢出的指纹，只适合丢失元素可以接受的场景(如缓存不存在的key)。
+ * 不加锁，多线程时由调用方加锁
+ */
+class CuckooFilter
+{
+public:
+    CuckooFilter();
+
+    /**
+     * 初始化并清空，桶个数按2的幂向上取整，实际容量不小于iCapacity
+     * @param iCapacity, 每代可保存的元素个数
+     */
+    void init(size_t iCapacity);
+
+    /**
+     * 加入元素，已在当前代中时不重复加入
+     * @return bool, false表示当前代已满，已自动切换一代
+     */
+    bool add(uint64_t h);
+
+    bool contains(uint64_t h) const;
+
+    /**
+     * 从两代中删除元素
+     * @return bool, 元素(或指纹相同的元素)存在并已删除
+     */
+    bool erase(uint64_t h);
+
+    /**
+     * 当前代变为旧代，清空新的当前代
+     */
+    void rotate();
+
+    void clear();
+
+    /**
+     * 两代的元素个数
+     */
+    size_t size() const { return _gen[0].count + _gen[1].count; }
+
+    /**
+     * 每代可保存的元素个数
+     */
+    size_t capacity() const { return _maxCount; }
+
+    size_t memSize() const { return _gen[0].slots.size() * sizeof(uint16_t) * 2; }
+
+    /**
+     * 按当前装载率估算的误判率，每次查找最多比较两代各8个槽位，
+     * 每个非空槽位的误判概率为1/65535
+     */
+    double fpp() const;
+
+protected:
+    struct Generation
+    {
+        vector<uint16_t> slots;
+        size_t count;
+    };
+
+    static uint16_t fingerprint(uint64_t h)
+    {
+        uint16_t fp = uint16_t(h >> 48);
+        return fp == 0 ? 1 : fp;
+    }
+
+    size_t altIndex(size_t i, uint16_t fp) const
+    {
+        return (i ^ (size_t(fp) * 0x5bd1e995)) & _bucketMask;
+    }
+
+    static bool findInBucket(const Generation &gen, size_t i, uint16_t fp);
+
+    static bool insertToBucket(Generation &gen, size_t i, uint16_t fp);
+
+    static size_t eraseFromBucket(Generation &gen, size_t i, uint16_t fp);
+
+    /**
+     * 写入当前代，两个桶都满时踢出已有指纹
+     * @return bool, false表示踢出次数用完，丢弃了一个指纹
+     */
+    bool insert(Generation &gen, size_t i1, uint16_t fp);
+
+protected:
+    static const size_t SLOT_NUM = 4;
+    static const int MAX_KICKS = 500;
+
+    // _gen[_cur]为当前代，另一个为旧代
+    Generation _gen[2];
+    int _cur;
+
+    size_t _bucketMask;
+
+    // 每代最多保存的元素个数，为槽位数的90%，超过后踢出失败的概率快速上升
+    size_t _maxCount;
+
+    // 踢出时选择槽位用的随机数
+    uint32_t _rand;
+};
+
+#endif
@@ -0,0 +1,127 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <string.h>
+#include "FastHash.h"
+
+namespace
+{
+    const uint64_t _SECRET0 = 0xa0761d6478bd642fULL;
+    const uint64_t _SECRET1 = 0xe7037ed1a0b428dbULL;
+    const uint64_t _SECRET2 = 0x8ebc6af09c88c6e3ULL;
+    const uint64_t _SECRET3 = 0x589965cc75374cc3ULL;
+
+    inline uint64_t read8(const uint8_t *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint64_t read4(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    // 1~3字节
+    inline uint64_t read3(const uint8_t *p, size_t k)
+    {
+        return (uint64_t(p[0]) << 16) | (uint64_t(p[k >> 1]) << 8) | p[k - 1];
+    }
+
+    // 128位乘法，高低64位异或
+    inline uint64_t mix(uint64_t a, uint64_t b)
+    {
+        __uint128_t r = __uint128_t(a) * b;
+        return uint64_t(r) ^ uint64_t(r >> 64);
+    }
+}
+
+size_t FastHash::HashRawInt(const int key)
+{
+    return hash(&key, sizeof(int));
+}
+
+size_t FastHash::HashRawLong(const long long key)
+{
+    return hash(&key, sizeof(long long));
+}
+
+size_t FastHash::HashRawString(const string &key)
+{
+    return hash(key.c_str(), key.length());
+}
+
+uint32_t FastHash::hash(const void *data, size_t len)
+{
+    uint64_t h = hash64(data, len);
+    uint32_t value = uint32_t(h ^ (h >> 32));
+
+    return value == 0 ? 1 : value;
+}
+
+uint64_t FastHash::hash64(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    seed = mix(_SECRET0 ^ len ^ seed, _SECRET1);
+    uint64_t a, b;
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            size_t off = (len >> 3) << 2;
+            a = (read4(p) << 32) | read4(p + off);
+            b = (read4(p + len - 4) << 32) | read4(p + len - 4 - off);
+        }
+        else if (len > 0)
+        {
+            a = read3(p, len);
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
+    }
+    else
+    {
+        size_t i = len;
+        if (i > 48)
+        {
+            // 三路并行混合，减少乘法之间的依赖
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = mix(read8(p) ^ _SECRET1, read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ _SECRET2, read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ _SECRET3, read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16)
+        {
+            seed = mix(read8(p) ^ _SECRET1, read8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+
+    return mix(_SECRET1 ^ len, mix(a ^ _SECRET1, b ^ seed));
+}
@@ -0,0 +1,48 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _FASTHASH_H
+#define _FASTHASH_H
+
+#include <stdint.h>
+#include "BaseHash.h"
+
+/**
+ * wyhash风格的字符串hash，每次读取8字节并做64位乘法混合，
+ * 对100字节以上的key比NormalHash的逐字节计算快很多。
+ * 结果折叠为32位，与NormalHash一样不会返回0。
+ * 按小端字节序读取，proxy与cache server需运行在相同字节序的机器上
+ */
+class FastHash : public P_Hash
+{
+public:
+    FastHash() {};
+    virtual ~FastHash() {};
+
+    virtual size_t HashRawInt(const int key);
+    virtual size_t HashRawLong(const long long key);
+    virtual size_t HashRawString(const string &key);
+
+    /**
+     * 计算任意内存的hash值
+     */
+    static uint32_t hash(const void *data, size_t len);
+
+    /**
+     * 64位hash值，不同的seed得到相互独立的hash，
+     * seed为0时折叠后与hash()的结果相同
+     */
+    static uint64_t hash64(const void *data, size_t len, uint64_t seed = 0);
+};
+
+#endif
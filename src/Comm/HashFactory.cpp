@@ -11,36 +11,35 @@
 * either express or implied. See the License for the specific language governing permissions
 * and limitations under the License.
 */
-#include "MKHash.h"
+#include "NormalHash.h"
+#include "FastHash.h"
+#include "HashFactory.h"
 
-unsigned int MKHash::HashRawString(const string &key)
+P_Hash* HashFactory::getHash(int hashType)
 {
-    const char *ptr = key.c_str();
-    size_t key_length = key.length();
-    unsigned int value = 0;
+    static NormalHash normalHash;
+    static FastHash fastHash;
 
-    while (key_length--)
+    switch (hashType)
     {
-        value += *ptr++;
-        value += (value << 10);
-        value ^= (value >> 6);
+    case HASH_TYPE_NORMAL:
+        return &normalHash;
+    case HASH_TYPE_FAST:
+        return &fastHash;
+    default:
+        return NULL;
     }
-    value += (value << 3);
-    value ^= (value >> 11);
-    value += (value << 15);
-
-    return value == 0 ? 1 : value;
 }
 
-unsigned int MKHash::HashMK(const string &key)
+const char* HashFactory::getHashName(int hashType)
 {
-    unsigned int uHash = HashRawString(key);
-
-    return uHash;
-}
-
-unsigned int MKHash::HashMKUK(const string &key)
-{
-    unsigned int uHash = HashRawString(key);
-    return uHash;
+    switch (hashType)
+    {
+    case HASH_TYPE_NORMAL:
+        return "normal";
+    case HASH_TYPE_FAST:
+        return "fast";
+    default:
+        return "unknown";
+    }
 }
@@ -0,0 +1,40 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _HASHFACTORY_H
+#define _HASHFACTORY_H
+
+#include "BaseHash.h"
+
+/**
+ * 按HashType获取hash实例。
+ * hash类无状态，返回的是进程内共享的静态实例，调用方不能delete，
+ * 路由重载时直接切换指针即可
+ */
+class HashFactory
+{
+public:
+    /**
+     * @return 不支持的类型返回NULL
+     */
+    static P_Hash* getHash(int hashType);
+
+    static bool isValidHashType(int hashType)
+    {
+        return hashType == HASH_TYPE_NORMAL || hashType == HASH_TYPE_FAST;
+    }
+
+    static const char* getHashName(int hashType);
+};
+
+#endif
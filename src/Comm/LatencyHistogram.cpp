@@ -0,0 +1,128 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <assert.h>
+#include <sstream>
+#include "LatencyHistogram.h"
+
+LatencyHistogram::LatencyHistogram(uint64_t maxValue, int subBucketBits)
+    : _maxValue(maxValue), _subBucketBits(subBucketBits), _totalCount(0), _sum(0), _min(UINT64_MAX), _max(0)
+{
+    if (_subBucketBits < 2)
+    {
+        _subBucketBits = 2;
+    }
+    else if (_subBucketBits > 16)
+    {
+        _subBucketBits = 16;
+    }
+    if (_maxValue < 1)
+    {
+        _maxValue = 1;
+    }
+
+    _subBucketCount = uint64_t(1) << _subBucketBits;
+    _subBucketHalf = _subBucketCount / 2;
+    _counts.resize(indexOf(_maxValue) + 1, 0);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    assert(other._counts.size() == _counts.size() && other._subBucketBits == _subBucketBits);
+
+    for (size_t i = 0; i < _counts.size(); ++i)
+    {
+        _counts[i] += other._counts[i];
+    }
+    _totalCount += other._totalCount;
+    _sum += other._sum;
+    if (other._min < _min)
+    {
+        _min = other._min;
+    }
+    if (other._max > _max)
+    {
+        _max = other._max;
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    _counts.assign(_counts.size(), 0);
+    _totalCount = 0;
+    _sum = 0;
+    _min = UINT64_MAX;
+    _max = 0;
+}
+
+uint64_t LatencyHistogram::highestValueAt(size_t index) const
+{
+    if (index < _subBucketCount)
+    {
+        return index;
+    }
+
+    uint64_t shift = (index - _subBucketCount) / _subBucketHalf + 1;
+    uint64_t sub = (index - _subBucketCount) % _subBucketHalf + _subBucketHalf;
+    return ((sub + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const
+{
+    if (_totalCount == 0)
+    {
+        return 0;
+    }
+
+    if (percentile > 100)
+    {
+        percentile = 100;
+    }
+
+    uint64_t target = uint64_t(percentile / 100 * _totalCount + 0.5);
+    if (target == 0)
+    {
+        target = 1;
+    }
+
+    uint64_t accumulated = 0;
+    for (size_t i = 0; i < _counts.size(); ++i)
+    {
+        accumulated += _counts[i];
+        if (accumulated >= target)
+        {
+            // 桶内最大值可能超过实际记录的最大值
+            uint64_t value = highestValueAt(i);
+            return value < _max ? value : _max;
+        }
+    }
+
+    return _max;
+}
+
+string LatencyHistogram::summary() const
+{
+    ostringstream os;
+    os << "count=" << count() << "|min=" << min() << "|mean=" << uint64_t(mean()) << "|p50=" << percentile(50)
+       << "|p90=" << percentile(90) << "|p99=" << percentile(99) << "|p999=" << percentile(99.9) << "|max=" << max();
+    return os.str();
+}
+
+string LatencyHistogram::toJson() const
+{
+    ostringstream os;
+    os << "{\"count\":" << count() << ",\"min\":" << min() << ",\"mean\":" << mean() << ",\"p50\":" << percentile(50)
+       << ",\"p90\":" << percentile(90) << ",\"p99\":" << percentile(99) << ",\"p999\":" << percentile(99.9)
+       << ",\"p9999\":" << percentile(99.99) << ",\"max\":" << max() << "}";
+    return os.str();
+}
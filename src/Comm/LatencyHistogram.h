@@ -0,0 +1,119 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _LATENCY_HISTOGRAM_H_
+#define _LATENCY_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * HDR风格的延时直方图(对数分段+段内线性分桶)。
+ * 每个2的幂区间分为subBucketCount/2个桶，相对误差不超过2/subBucketCount，
+ * 默认128个子桶，误差<1.6%，记录1us~60s只需约2.8K个计数。
+ * 不加锁，多线程时每个线程各用一个，汇总时merge。
+ */
+class LatencyHistogram
+{
+public:
+    /**
+     * @param maxValue, 可记录的最大值，超过的值按maxValue记录
+     * @param subBucketBits, 子桶个数的位数，子桶个数为2^subBucketBits
+     */
+    explicit LatencyHistogram(uint64_t maxValue = 60000000, int subBucketBits = 7);
+
+    /**
+     * 记录一个值
+     */
+    void record(uint64_t value)
+    {
+        if (value > _maxValue)
+        {
+            value = _maxValue;
+        }
+        ++_counts[indexOf(value)];
+        ++_totalCount;
+        _sum += value;
+        if (value < _min)
+        {
+            _min = value;
+        }
+        if (value > _max)
+        {
+            _max = value;
+        }
+    }
+
+    /**
+     * 合并另一个直方图，两者的参数必须相同
+     */
+    void merge(const LatencyHistogram &other);
+
+    void reset();
+
+    /**
+     * 返回百分位对应的值(桶内最大值)
+     * @param percentile, 0~100
+     */
+    uint64_t percentile(double percentile) const;
+
+    uint64_t count() const { return _totalCount; }
+
+    uint64_t min() const { return _totalCount > 0 ? _min : 0; }
+
+    uint64_t max() const { return _max; }
+
+    double mean() const { return _totalCount > 0 ? double(_sum) / _totalCount : 0; }
+
+    /**
+     * 常用统计值，格式: count=|min=|mean=|p50=|p90=|p99=|p999=|max=
+     */
+    string summary() const;
+
+    /**
+     * 输出json对象，包含常用统计值
+     */
+    string toJson() const;
+
+private:
+    size_t indexOf(uint64_t value) const
+    {
+        if (value < _subBucketCount)
+        {
+            return size_t(value);
+        }
+
+        // value >> shift落在[subBucketCount/2, subBucketCount)
+        int shift = 63 - __builtin_clzll(value) - (_subBucketBits - 1);
+        return size_t(_subBucketCount + (uint64_t(shift) - 1) * _subBucketHalf + ((value >> shift) - _subBucketHalf));
+    }
+
+    // 下标对应桶内的最大值
+    uint64_t highestValueAt(size_t index) const;
+
+private:
+    uint64_t _maxValue;
+    int _subBucketBits;
+    uint64_t _subBucketCount;
+    uint64_t _subBucketHalf;
+    vector<uint64_t> _counts;
+    uint64_t _totalCount;
+    uint64_t _sum;
+    uint64_t _min;
+    uint64_t _max;
+};
+
+#endif
@@ -156,4 +156,55 @@ bool StringUtil::parseString(const string& str, vector<string>& res)
     return true;
 }
 
+bool StringUtil::matchPattern(const string& str, const string& pattern)
+{
+    size_t s = 0, p = 0;
+    //最近一个*的位置和它匹配到的字符串位置，失配时让*多匹配一个字符重试
+    size_t starP = string::npos, starS = 0;
+
+    while (s < str.length())
+    {
+        if (p < pattern.length() && pattern[p] == '*')
+        {
+            starP = p++;
+            starS = s;
+            continue;
+        }
+
+        if (p < pattern.length())
+        {
+            char c = pattern[p];
+            size_t next = p + 1;
+            if (c == '\\' && next < pattern.length())
+            {
+                c = pattern[next++];
+            }
+            else if (c == '?')
+            {
+                ++s;
+                p = next;
+                continue;
+            }
+
+            if (c == str[s])
+            {
+                ++s;
+                p = next;
+                continue;
+            }
+        }
 
+        if (starP == string::npos)
+        {
+            return false;
+        }
+        p = starP + 1;
+        s = ++starS;
+    }
+
+    while (p < pattern.length() && pattern[p] == '*')
+    {
+        ++p;
+    }
+    return p == pattern.length();
+}
@@ -54,6 +54,15 @@ public:
     */
     static bool parseString(const string& str, vector<string>& res);
 
+    /**
+     * glob风格的匹配，*匹配任意个字符，?匹配一个字符，反斜杠转义下一个字符
+     * @param str, 要匹配的字符串，可以包含\0
+     * @param pattern, 匹配模式
+     *
+     * @return bool
+     */
+    static bool matchPattern(const string& str, const string& pattern);
+
 public:
 
     const static size_t GZIP_MIN_STR_LEN;
@@ -0,0 +1,284 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <errno.h>
+#include <algorithm>
+#include "util/tc_file.h"
+#include "TrafficCapture.h"
+
+TrafficCapture::TrafficCapture()
+    : _enable(false), _terminate(false), _serverType(TST_KV), _sampleRate(100), _maxFileSize(64 * 1024 * 1024),
+      _maxFileNum(10), _maxBufferCount(65536), _fp(NULL), _curFileSize(0), _recordCount(0), _dropCount(0)
+{
+}
+
+TrafficCapture::~TrafficCapture()
+{
+    closeFile();
+}
+
+void TrafficCapture::init(const TC_Config &conf, TrafficServerType serverType)
+{
+    string sEnable = conf.get("/Main/Capture<Enable>", "N");
+
+    uint32_t iSampleRate = TC_Common::strto<uint32_t>(conf.get("/Main/Capture<SampleRate>", "100"));
+    if (iSampleRate == 0)
+    {
+        iSampleRate = 1;
+    }
+
+    {
+        Lock lock(*this);
+        _serverType = serverType;
+        _sampleRate = iSampleRate;
+        _dir = conf.get("/Main/Capture<Dir>", ServerConfig::DataPath + "capture");
+        _prefix = ServerConfig::Application + "." + ServerConfig::ServerName;
+        _maxFileSize = TC_Common::strto<size_t>(conf.get("/Main/Capture<MaxFileSize>", "64")) * 1024 * 1024;
+        _maxFileNum = TC_Common::strto<size_t>(conf.get("/Main/Capture<MaxFileNum>", "10"));
+        _maxBufferCount = TC_Common::strto<size_t>(conf.get("/Main/Capture<MaxBufferCount>", "65536"));
+        _enable = (sEnable == "Y" || sEnable == "y");
+    }
+
+    TLOGDEBUG("TrafficCapture::init enable:" << _enable << "|sampleRate:" << _sampleRate << "|dir:" << _dir
+              << "|maxFileSize:" << _maxFileSize << "|maxFileNum:" << _maxFileNum << endl);
+
+    if (_enable && !isAlive())
+    {
+        _terminate = false;
+        start();
+    }
+}
+
+void TrafficCapture::terminate()
+{
+    {
+        Lock lock(*this);
+        _enable = false;
+        _terminate = true;
+        notifyAll();
+    }
+
+    if (isAlive())
+    {
+        getThreadControl().join();
+    }
+}
+
+void TrafficCapture::append(TrafficOp op, uint64_t keyHash, size_t keySize, uint32_t subKeyHash, size_t subKeySize, uint32_t valueSize, TrafficResult result)
+{
+    TrafficRecord record;
+    record.timeUs = nowUs();
+    record.keyHash = keyHash;
+    record.subKeyHash = subKeyHash;
+    record.valueSize = valueSize;
+    record.keySize = keySize > 0xffff ? 0xffff : uint16_t(keySize);
+    record.subKeySize = subKeySize > 0xffff ? 0xffff : uint16_t(subKeySize);
+    record.op = uint8_t(op);
+    record.result = uint8_t(result);
+    record.reserved = 0;
+
+    Lock lock(*this);
+    if (_buffer.size() >= _maxBufferCount)
+    {
+        ++_dropCount;
+        return;
+    }
+    _buffer.push_back(record);
+    ++_recordCount;
+}
+
+void TrafficCapture::run()
+{
+    while (!_terminate)
+    {
+        try
+        {
+            {
+                Lock lock(*this);
+                timedWait(1000);
+            }
+
+            flush();
+        }
+        catch (exception &ex)
+        {
+            TLOGERROR("TrafficCapture::run exception:" << ex.what() << endl);
+        }
+        catch (...)
+        {
+            TLOGERROR("TrafficCapture::run unknown exception" << endl);
+        }
+    }
+
+    flush();
+    closeFile();
+}
+
+void TrafficCapture::flush()
+{
+    // 与接口线程交换缓冲区，两个缓冲区轮流使用，避免反复分配内存
+    vector<TrafficRecord> &vtRecord = _writeBuffer;
+    vtRecord.clear();
+    {
+        Lock lock(*this);
+        vtRecord.swap(_buffer);
+    }
+
+    if (vtRecord.empty())
+    {
+        if (!_enable)
+        {
+            closeFile();
+        }
+        return;
+    }
+
+    if (_fp == NULL && openFile() != 0)
+    {
+        Lock lock(*this);
+        _dropCount += vtRecord.size();
+        return;
+    }
+
+    size_t iWrite = fwrite(&vtRecord[0], sizeof(TrafficRecord), vtRecord.size(), _fp);
+    fflush(_fp);
+    {
+        Lock lock(*this);
+        _curFileSize += iWrite * sizeof(TrafficRecord);
+    }
+    if (iWrite != vtRecord.size())
+    {
+        TLOGERROR("TrafficCapture::flush write " << _curFile << " error:" << strerror(errno) << endl);
+        closeFile();
+    }
+    else if (_curFileSize >= _maxFileSize)
+    {
+        closeFile();
+    }
+}
+
+int TrafficCapture::openFile()
+{
+    string sDir, sPrefix;
+    TrafficTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    {
+        Lock lock(*this);
+        sDir = _dir;
+        sPrefix = _prefix;
+        header.serverType = uint8_t(_serverType);
+        header.sampleRate = _sampleRate;
+    }
+
+    if (!TC_File::makeDirRecursive(sDir))
+    {
+        TLOGERROR("TrafficCapture::openFile create dir " << sDir << " error" << endl);
+        return -1;
+    }
+
+    string sFile = sDir + "/" + sPrefix + "_" + TC_Common::now2str("%Y%m%d%H%M%S") + ".trace";
+    for (int i = 1; TC_File::isFileExist(sFile); ++i)
+    {
+        sFile = sDir + "/" + sPrefix + "_" + TC_Common::now2str("%Y%m%d%H%M%S") + "_" + TC_Common::tostr(i) + ".trace";
+    }
+
+    _fp = fopen(sFile.c_str(), "wb");
+    if (_fp == NULL)
+    {
+        TLOGERROR("TrafficCapture::openFile open " << sFile << " error:" << strerror(errno) << endl);
+        return -1;
+    }
+
+    memcpy(header.magic, TRAFFIC_TRACE_MAGIC, sizeof(TRAFFIC_TRACE_MAGIC));
+    header.version = TRAFFIC_TRACE_VERSION;
+    header.recordSize = sizeof(TrafficRecord);
+    header.startTimeUs = nowUs();
+    if (fwrite(&header, sizeof(header), 1, _fp) != 1)
+    {
+        TLOGERROR("TrafficCapture::openFile write header to " << sFile << " error:" << strerror(errno) << endl);
+        fclose(_fp);
+        _fp = NULL;
+        return -1;
+    }
+
+    {
+        Lock lock(*this);
+        _curFile = sFile;
+        _curFileSize = sizeof(header);
+    }
+    TLOGDEBUG("TrafficCapture::openFile " << sFile << endl);
+
+    removeOldFiles();
+    return 0;
+}
+
+void TrafficCapture::closeFile()
+{
+    if (_fp != NULL)
+    {
+        fclose(_fp);
+        _fp = NULL;
+
+        Lock lock(*this);
+        _curFile = "";
+        _curFileSize = 0;
+    }
+}
+
+void TrafficCapture::removeOldFiles()
+{
+    string sDir, sPrefix;
+    size_t iMaxFileNum;
+    {
+        Lock lock(*this);
+        sDir = _dir;
+        sPrefix = _prefix + "_";
+        iMaxFileNum = _maxFileNum;
+    }
+
+    if (iMaxFileNum == 0)
+    {
+        return;
+    }
+
+    vector<string> vtAll, vtTrace;
+    TC_File::listDirectory(sDir, vtAll, false);
+    for (size_t i = 0; i < vtAll.size(); ++i)
+    {
+        string sName = TC_File::extractFileName(vtAll[i]);
+        if (sName.compare(0, sPrefix.size(), sPrefix) == 0 && TC_File::extractFileExt(sName) == "trace")
+        {
+            vtTrace.push_back(vtAll[i]);
+        }
+    }
+
+    // 文件名中带时间，按文件名排序即按时间排序
+    sort(vtTrace.begin(), vtTrace.end());
+    for (size_t i = 0; i + iMaxFileNum < vtTrace.size(); ++i)
+    {
+        TLOGDEBUG("TrafficCapture::removeOldFiles " << vtTrace[i] << endl);
+        TC_File::removeFile(vtTrace[i], false);
+    }
+}
+
+string TrafficCapture::status()
+{
+    Lock lock(*this);
+    ostringstream os;
+    os << "enable: " << (_enable ? "Y" : "N") << endl
+       << "sample rate: 1/" << _sampleRate << endl
+       << "dir: " << _dir << endl
+       << "current file: " << _curFile << ", size: " << _curFileSize << endl
+       << "records: " << _recordCount << ", dropped: " << _dropCount << ", buffered: " << _buffer.size() << endl;
+    return os.str();
+}
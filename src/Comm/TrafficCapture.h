@@ -0,0 +1,150 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _TRAFFIC_CAPTURE_H_
+#define _TRAFFIC_CAPTURE_H_
+
+#include <sys/time.h>
+#include "servant/Application.h"
+#include "util/tc_config.h"
+#include "util/tc_singleton.h"
+#include "util/tc_thread.h"
+#include "TrafficTrace.h"
+
+using namespace tars;
+
+/**
+ * CacheServer流量采集。
+ * 按key的hash采样，被采中的key的所有操作都会记录，回放时命中率与原始流量一致；
+ * 接口线程只把记录追加到内存缓冲区，由采集线程每秒写入文件，缓冲区满时丢弃，不会阻塞接口线程。
+ * 文件超过MaxFileSize后切换新文件，只保留最近MaxFileNum个
+ */
+class TrafficCapture : public TC_Singleton<TrafficCapture>, public TC_Thread, public TC_ThreadLock
+{
+public:
+    TrafficCapture();
+
+    ~TrafficCapture();
+
+    /**
+     * 读取/Main/Capture配置，初始化和reload时调用，开启时启动采集线程
+     * @param serverType, TST_KV或TST_MKV
+     */
+    void init(const TC_Config &conf, TrafficServerType serverType);
+
+    /**
+     * 停止采集线程，写完缓冲区中的记录
+     */
+    void terminate();
+
+    bool isEnable() const { return _enable; }
+
+    /**
+     * 记录一次操作，未开启采集或key未被采中时直接返回
+     */
+    void record(TrafficOp op, const string &key, uint32_t valueSize, TrafficResult result)
+    {
+        if (!_enable)
+        {
+            return;
+        }
+
+        uint64_t keyHash = trafficKeyHash(key);
+        if (keyHash % _sampleRate == 0)
+        {
+            append(op, keyHash, key.size(), 0, 0, valueSize, result);
+        }
+    }
+
+    /**
+     * 记录一次MKV操作，按主key采样
+     */
+    void record(TrafficOp op, const string &mainKey, const string &subKey, uint32_t valueSize, TrafficResult result)
+    {
+        if (!_enable)
+        {
+            return;
+        }
+
+        uint64_t keyHash = trafficKeyHash(mainKey);
+        if (keyHash % _sampleRate == 0)
+        {
+            append(op, keyHash, mainKey.size(), uint32_t(trafficKeyHash(subKey)), subKey.size(), valueSize, result);
+        }
+    }
+
+    /**
+     * 采集状态，用于admin命令
+     */
+    string status();
+
+protected:
+    virtual void run();
+
+    void append(TrafficOp op, uint64_t keyHash, size_t keySize, uint32_t subKeyHash, size_t subKeySize, uint32_t valueSize, TrafficResult result);
+
+    // 把缓冲区写入文件，必要时切换文件
+    void flush();
+
+    int openFile();
+
+    void closeFile();
+
+    // 删除超出个数的旧文件，当前文件也计算在内
+    void removeOldFiles();
+
+    static uint64_t nowUs()
+    {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        return uint64_t(tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+protected:
+    bool _enable;
+
+    bool _terminate;
+
+    TrafficServerType _serverType;
+
+    uint32_t _sampleRate;
+
+    string _dir;
+
+    // 文件名前缀，为服务名
+    string _prefix;
+
+    size_t _maxFileSize;
+
+    size_t _maxFileNum;
+
+    // 缓冲区最多保存的记录数
+    size_t _maxBufferCount;
+
+    vector<TrafficRecord> _buffer;
+
+    // 采集线程写文件用的缓冲区，与_buffer交换
+    vector<TrafficRecord> _writeBuffer;
+
+    FILE *_fp;
+
+    string _curFile;
+
+    size_t _curFileSize;
+
+    uint64_t _recordCount;
+
+    uint64_t _dropCount;
+};
+
+#endif
@@ -0,0 +1,179 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _TRAFFIC_TRACE_H_
+#define _TRAFFIC_TRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * 流量采集文件格式，CacheServer写入，回放工具读取。
+ * 每个文件由一个TrafficTraceHeader和若干定长的TrafficRecord组成，字节序为本机字节序。
+ * 只记录key的hash和长度，不记录key和value的内容
+ */
+
+#define TRAFFIC_TRACE_MAGIC "DCTRACE"
+#define TRAFFIC_TRACE_VERSION 1
+
+enum TrafficServerType
+{
+    TST_KV = 0,
+    TST_MKV = 1
+};
+
+enum TrafficOp
+{
+    TOP_GET = 1,     // 读一条数据，MKV为主key+联合key
+    TOP_SET,         // 写一条数据
+    TOP_INSERT,      // 数据不存在时写入
+    TOP_UPDATE,      // 数据存在时更新，valueSize为更新后的大小
+    TOP_DEL,         // 删除一条数据(包括DB)
+    TOP_ERASE,       // 从内存中淘汰一条数据
+    TOP_GET_MK,      // 按主key读
+    TOP_UPDATE_MK,   // 按主key条件更新
+    TOP_DEL_MK,      // 按主key条件删除
+    TOP_ERASE_MK     // 从内存中淘汰整个主key
+};
+
+enum TrafficResult
+{
+    TRS_HIT = 0,     // 读命中或写成功
+    TRS_MISS,        // 数据不在内存中或已过期
+    TRS_ONLY_KEY,    // 只有key没有数据
+    TRS_ERROR        // 其他错误
+};
+
+#pragma pack(1)
+
+struct TrafficTraceHeader
+{
+    char magic[8];
+    uint16_t version;
+    uint16_t recordSize;
+    uint8_t serverType;
+    uint8_t reserved[3];
+    // 按key的hash采样，每sampleRate个key记录1个
+    uint32_t sampleRate;
+    uint64_t startTimeUs;
+    uint32_t reserved2;
+};
+
+struct TrafficRecord
+{
+    uint64_t timeUs;
+    uint64_t keyHash;
+    uint32_t subKeyHash;
+    uint32_t valueSize;
+    uint16_t keySize;
+    uint16_t subKeySize;
+    uint8_t op;
+    uint8_t result;
+    uint16_t reserved;
+};
+
+#pragma pack()
+
+/**
+ * FNV-1a 64位hash，用于采样和回放时还原key，跨进程、跨版本保持不变
+ */
+inline uint64_t trafficKeyHash(const char *data, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+inline uint64_t trafficKeyHash(const string &key)
+{
+    return trafficKeyHash(key.data(), key.size());
+}
+
+/**
+ * 顺序读取一个采集文件
+ */
+class TrafficTraceReader
+{
+public:
+    TrafficTraceReader() : _fp(NULL) {}
+
+    ~TrafficTraceReader() { close(); }
+
+    /**
+     * 打开文件并校验文件头
+     * @return 0 成功，其他失败，错误信息见getError()
+     */
+    int open(const string &file)
+    {
+        close();
+        _fp = fopen(file.c_str(), "rb");
+        if (_fp == NULL)
+        {
+            _error = "open " + file + " failed";
+            return -1;
+        }
+
+        if (fread(&_header, sizeof(_header), 1, _fp) != 1)
+        {
+            _error = file + " has no header";
+            close();
+            return -1;
+        }
+
+        if (memcmp(_header.magic, TRAFFIC_TRACE_MAGIC, sizeof(TRAFFIC_TRACE_MAGIC)) != 0
+                || _header.version != TRAFFIC_TRACE_VERSION || _header.recordSize != sizeof(TrafficRecord))
+        {
+            _error = file + " is not a traffic trace file of version " + char('0' + TRAFFIC_TRACE_VERSION);
+            close();
+            return -1;
+        }
+        return 0;
+    }
+
+    /**
+     * 读下一条记录，文件结束或文件末尾不完整时返回false
+     */
+    bool next(TrafficRecord &record)
+    {
+        return _fp != NULL && fread(&record, sizeof(record), 1, _fp) == 1;
+    }
+
+    void close()
+    {
+        if (_fp != NULL)
+        {
+            fclose(_fp);
+            _fp = NULL;
+        }
+    }
+
+    const TrafficTraceHeader &getHeader() const { return _header; }
+
+    const string &getError() const { return _error; }
+
+private:
+    FILE *_fp;
+    TrafficTraceHeader _header;
+    string _error;
+};
+
+#endif
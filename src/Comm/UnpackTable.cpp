@@ -11,6 +11,7 @@
 * either express or implied. See the License for the specific language governing permissions
 * and limitations under the License.
 */
+#include <algorithm>
 #include "UnpackTable.h"
 
 int g_iSlaveFlag = 0;//备机可读的轮询标志
@@ -29,14 +30,16 @@ namespace DCache
     UnpackTable::UnpackTable() : _lrInfo(NULL), _lrInfo1(NULL), _init(false), _iLastLoadTime(0),
         _pageSize(__pageSize), _allPageCount(__allPageCount), _reloadTime(__reloadTime)
     {
-        _hash = new NormalHash();
+        _hashType = HASH_TYPE_NORMAL;
+        _hash = HashFactory::getHash(_hashType);
     }
 
     UnpackTable::UnpackTable(const UnpackTable& r) : _lrInfo(NULL), _lrInfo1(NULL), _init(false),
         _iLastLoadTime(0), _pageSize(__pageSize), _allPageCount(__allPageCount),
         _reloadTime(__reloadTime)
     {
-        _hash = new NormalHash();
+        _hashType = HASH_TYPE_NORMAL;
+        _hash = HashFactory::getHash(_hashType);
         string tmpServer = r.getSelfServer();
         _pageSize = getPageSize();
         _reloadTime = getReloadTime();
@@ -50,9 +53,6 @@ namespace DCache
 
         delete _lrInfo1;
         _lrInfo1 = NULL;
-
-        delete _hash;
-        _hash = NULL;
     }
 
     //////////////////////////////////////////////////////
@@ -66,6 +66,21 @@ namespace DCache
         uint32_t uAllPageCount = __max / uPageSize + (__max % uPageSize > 0 ? 1 : 0);
         int64_t i64ReloadTime = reloadTime > 0 ? reloadTime : _reloadTime;
 
+        P_Hash* pHash = HashFactory::getHash(packTable.info.hashType);
+        if (pHash == NULL)
+        {
+            TLOGERROR("UnpackTable::init module:" << packTable.info.moduleName << " invalid hash type:" << packTable.info.hashType << endl);
+            return RET_INVALID_HASH_TYPE;
+        }
+
+        // cache server的数据按hash分布在页和hash桶中，运行中不能切换hash函数
+        if (_init && !_selfServer.empty() && packTable.info.hashType != _hashType)
+        {
+            TLOGERROR("UnpackTable::init module:" << packTable.info.moduleName << " hash type changed from " << _hashType
+                      << " to " << packTable.info.hashType << ", reject" << endl);
+            return RET_HASH_TYPE_MISMATCH;
+        }
+
         tmpLRInfo = new LocalRouterInfo(uAllPageCount);
 
         // 加载服务器组及服务器信息
@@ -183,6 +198,9 @@ namespace DCache
         _lrInfo = newLRInfo;
         delete oldLRInfo;
 
+        _hash = pHash;
+        _hashType = packTable.info.hashType;
+
         // 记录初始化参数
         if (!_init)
         {
@@ -213,6 +231,66 @@ namespace DCache
         return init(packTable, _selfServer, _pageSize, _reloadTime, transferingInfoList);
     }
 
+    int UnpackTable::reloadByDelta(const RouterDelta& delta)
+    {
+        if (_lrInfo == NULL)
+        {
+            return RET_DELTA_MISMATCH;
+        }
+
+        PackTable packTable;
+        int iRet = applyDelta(_lrInfo->packTable, delta, packTable);
+        if (iRet != RET_SUCC)
+        {
+            return iRet;
+        }
+
+        return reload(packTable);
+    }
+
+    int UnpackTable::applyDelta(const PackTable& from, const RouterDelta& delta, PackTable& to)
+    {
+        if (from.info.version != delta.fromVersion || from.info.moduleName != delta.info.moduleName)
+        {
+            return RET_DELTA_MISMATCH;
+        }
+
+        to = from;
+        to.info = delta.info;
+
+        for (size_t i = 0; i < delta.delRecordList.size(); ++i)
+        {
+            vector<RecordInfo>::iterator it = std::find(to.recordList.begin(), to.recordList.end(), delta.delRecordList[i]);
+            if (it == to.recordList.end())
+            {
+                // 本地路由与服务端记录的起始版本内容不一致
+                return RET_DELTA_MISMATCH;
+            }
+            to.recordList.erase(it);
+        }
+        to.recordList.insert(to.recordList.end(), delta.addRecordList.begin(), delta.addRecordList.end());
+
+        for (size_t i = 0; i < delta.delGroupList.size(); ++i)
+        {
+            to.groupList.erase(delta.delGroupList[i]);
+        }
+        for (map<string, GroupInfo>::const_iterator it = delta.updateGroupList.begin(); it != delta.updateGroupList.end(); ++it)
+        {
+            to.groupList[it->first] = it->second;
+        }
+
+        for (size_t i = 0; i < delta.delServerList.size(); ++i)
+        {
+            to.serverList.erase(delta.delServerList[i]);
+        }
+        for (map<string, ServerInfo>::const_iterator it = delta.updateServerList.begin(); it != delta.updateServerList.end(); ++it)
+        {
+            to.serverList[it->first] = it->second;
+        }
+
+        return RET_SUCC;
+    }
+
     int UnpackTable::getMasterByHash(uint32_t hash, ServerInfo& serverInfo) const
     {
         __UNPACK_TRY__
@@ -598,7 +676,7 @@ namespace DCache
         return _hash->HashRawLong(key);
     }
 
-    size_t UnpackTable::hashKey(string key) const
+    size_t UnpackTable::hashKey(const string &key) const
     {
         return _hash->HashRawString(key);
     }
@@ -19,6 +19,7 @@
 #include "util/tc_file.h"
 #include "util/tc_thread.h"
 #include "NormalHash.h"
+#include "HashFactory.h"
 
 using namespace std;
 using namespace tars;
@@ -80,6 +81,9 @@ namespace DCache
             RET_NOT_FOUND_DEST_MASTER = -10, 	// 找不着目的迁移master
             RET_NOT_FOUND_DEST_SLAVE = -11, 	// 找不着目的迁移slave
             RET_GROUP_READONLY = -12, //组只读状态
+            RET_DELTA_MISMATCH = -13,	// 增量路由的起始版本与本地路由版本不一致
+            RET_INVALID_HASH_TYPE = -14,	// 不支持的hash类型
+            RET_HASH_TYPE_MISMATCH = -15,	// cache server重载的路由hash类型与已加载的不一致
             RET_EXCEPTION = -99,	// 异常
             RET_NOT_TRANSFERING = 1	// 没有正在迁移，非异常
         };
@@ -171,6 +175,19 @@ namespace DCache
 
         int reload(const PackTable& packTable, const vector<TransferInfo>& transferingInfoList = vector<TransferInfo>());
 
+        /**
+         * 在当前路由上应用增量路由并重新加载
+         * @param delta 增量路由，起始版本必须是当前路由的版本
+         * @return int RET_SUCC, RET_DELTA_MISMATCH, 其他同reload
+         */
+        int reloadByDelta(const RouterDelta& delta);
+
+        /**
+         * 在路由表from上应用增量路由，得到增量目标版本的路由表
+         * @return int RET_SUCC, RET_DELTA_MISMATCH
+         */
+        static int applyDelta(const PackTable& from, const RouterDelta& delta, PackTable& to);
+
         /**
          * 获取key对应的服务器ServerInfo
          * @param key key值
@@ -182,13 +199,21 @@ namespace DCache
         };
 
         template<typename T> int getIdcServer(T key, const string &sIdc, bool bSlaveReadAble, ServerInfo &serverInfo) const
+        {
+            return getIdcServerByHash(hashKey(key), sIdc, bSlaveReadAble, serverInfo);
+        };
+
+        /**
+         * 获取hash对应的sIdc中的服务器ServerInfo
+         * @param hash hash值
+         * @return ServerInfo, RET_SUCC, RET_NOT_FOUND_SERVER, RET_NOT_FOUND_GROUP
+         */
+        int getIdcServerByHash(uint32_t hash, const string &sIdc, bool bSlaveReadAble, ServerInfo &serverInfo) const
         {
             __UNPACK_TRY__
 
             int iRet = RET_SUCC;
 
-            uint32_t hash = hashKey(key);
-
             // 取得页号
             uint32_t pageNo = hash / _pageSize;
             assert(pageNo <= _allPageCount);
@@ -381,6 +406,14 @@ namespace DCache
             return _selfServer;
         }
 
+        /**
+         * 获取模块的hash类型，见HashType
+         */
+        int getHashType() const
+        {
+            return _hashType;
+        }
+
         /*
         * 获取页大小
         */
@@ -481,7 +514,7 @@ namespace DCache
          * @param key
          * @return size_t
          */
-        size_t hashKey(string key) const;
+        size_t hashKey(const string &key) const;
 
         /**
          * 获取页号
@@ -493,6 +526,11 @@ namespace DCache
             return (hashKey(key) / _pageSize);
         };
 
+        size_t getPageNoByHash(uint32_t hash) const
+        {
+            return (hash / _pageSize);
+        };
+
     private:
         LocalRouterInfo* _lrInfo;	// 本地路由信息
         LocalRouterInfo* _lrInfo1;	// 备份，用于路由重载切换
@@ -500,7 +538,8 @@ namespace DCache
         string _selfServer;	// 保存本机名称
         bool _init;	// 是否已初始化标志
         int64_t _iLastLoadTime;	// 最后路由加载时间
-        P_Hash* _hash;	// hash处理类
+        P_Hash* _hash;	// hash处理类，HashFactory的共享实例，不用释放
+        int _hashType;	// 模块的hash类型
 
         TC_ThreadLock _lock;	// 加载路由时加锁
 
@@ -20,6 +20,7 @@
 #include "UnpackTable.h"
 #include "StringUtil.h"
 #include "Common.h"
+#include "TrafficCapture.h"
 
 using namespace std;
 using namespace tars;
@@ -59,7 +60,7 @@ public:
         size_t uCount = _limitKeyRange.size();
         if (uCount > 0)
         {
-            unsigned int hashVal = hashCounter.HashRawString(k);
+            unsigned int hashVal = g_route_table.hashKey(k);
             for (size_t i = 0; i < uCount; ++i)
             {
                 if (hashVal >= _limitKeyRange[i].lower && hashVal <= _limitKeyRange[i].upper)
@@ -92,7 +93,6 @@ public:
         return _canSyncCount;
     }
 private:
-    NormalHash hashCounter;
     TC_ThreadLock _lock;
     vector<KeyLimit> _limitKeyRange;
     volatile size_t _canSyncCount;
@@ -182,6 +182,25 @@ private:
 
 };
 
+/**
+ * hashmap返回值转换为流量采集的结果
+ */
+inline TrafficResult trafficResult(int iRet)
+{
+    switch (iRet)
+    {
+    case TC_HashMapMalloc::RT_OK:
+        return TRS_HIT;
+    case TC_HashMapMalloc::RT_NO_DATA:
+    case TC_HashMapMalloc::RT_DATA_EXPIRED:
+        return TRS_MISS;
+    case TC_HashMapMalloc::RT_ONLY_KEY:
+        return TRS_ONLY_KEY;
+    default:
+        return TRS_ERROR;
+    }
+}
+
 typedef void(*sighandler_t)(int);
 inline pid_t pox_system(const char *cmd_line)
 {
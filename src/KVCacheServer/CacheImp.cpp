@@ -68,142 +68,104 @@ bool CacheImp::reloadConf(const string& command, const string& params, string& r
     return true;
 }
 
-tars::Int32 CacheImp::checkString(const std::string& moduleName, const string& keyItem)
+tars::Int32 CacheImp::checkKey(const DCache::CheckKeyReq &req, DCache::CheckKeyRsp &rsp, tars::TarsCurrentPtr current)
 {
+    OpTrace trace(LOP_CHECK_KEY, req.keys.empty() ? req.moduleName : req.keys[0]);
     try
     {
-        if (moduleName != _moduleName)
+        if (req.moduleName != _moduleName)
         {
             //返回模块错误
-            TLOGERROR("CacheImp::checkString: moduleName error" << endl);
+            TLOGERROR("CacheImp::checkKey: moduleName error" << endl);
             return ET_MODULE_NAME_INVALID;
         }
-        //检查key是否是在自己服务范围内
-        if (!g_route_table.isMySelf(keyItem))
+
+        size_t keyCount = req.keys.size();
+        for (size_t i = 0; i < keyCount; ++i)
         {
-            //返回模块错误
-            TLOGERROR("CacheImp::checkString: " << keyItem << " is not in self area" << endl);
-            return ET_KEY_AREA_ERR;
+            //检查key是否是在自己服务范围内
+            if (!g_route_table.isMySelf(req.keys[i]))
+            {
+                TLOGERROR("CacheImp::checkKey: " << req.keys[i] << " is not in self area" << endl);
+                map<string, string>& context = current->getContext();
+                //API直连模式，返回增量更新路由
+                if (VALUE_YES == context[GET_ROUTE])
+                {
+                    RspUpdateServant updateServant;
+                    map<string, string> rspContext;
+                    rspContext[ROUTER_UPDATED] = "";
+                    int ret = RouterHandle::getInstance()->getUpdateServant(req.keys, true, "", updateServant);
+                    if (ret != 0)
+                    {
+                        TLOGERROR(__FUNCTION__ << ":getUpdatedRoute error:" << ret << endl);
+                    }
+                    else
+                    {
+                        RouterHandle::getInstance()->updateServant2Str(updateServant, rspContext[ROUTER_UPDATED]);
+                        current->setResponseContext(rspContext);
+                    }
+                }
+                return ET_KEY_AREA_ERR;
+            }
         }
 
-        g_app.ppReport(PPReport::SRP_GET_CNT, 1);
+        g_app.ppReport(PPReport::SRP_GET_CNT, keyCount);
 
-        int iRet;
+        //按jmem分组批量检查数据状态
+        vector<BatchGetItem> vtItem;
         if (g_app.gstat()->isExpireEnabled())
         {
-            iRet = g_sHashMap.checkDirty(keyItem, true, TC_TimeProvider::getInstance()->getNow());
-        }
-        else
-        {
-            iRet = g_sHashMap.checkDirty(keyItem);
-        }
-
-        if (iRet == TC_HashMapMalloc::RT_OK)
-        {
-            return ET_SUCC;
-        }
-        else if (iRet == TC_HashMapMalloc::RT_NO_DATA || iRet == TC_HashMapMalloc::RT_DATA_EXPIRED)
-        {
-            return ET_NO_DATA;
-        }
-        else if (iRet == TC_HashMapMalloc::RT_ONLY_KEY)
-        {
-            return ET_ONLY_KEY;
-        }
-        else if (iRet == TC_HashMapMalloc::RT_DIRTY_DATA)
-        {
-            return ET_DIRTY_DATA;
+            g_sHashMap.getBatch(req.keys, vtItem, true, true, TC_TimeProvider::getInstance()->getNow());
         }
         else
         {
-            TLOGERROR("CacheImp::checkString hashmap.checkDirty(" << keyItem << ") error:" << iRet << endl);
-            g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
-            return ET_SYS_ERR;
+            g_sHashMap.getBatch(req.keys, vtItem, true);
         }
-    }
-    catch (const std::exception &ex)
-    {
-        TLOGERROR("CacheImp::checkString exception: " << ex.what() << ", key = " << keyItem << endl);
-    }
-    catch (...)
-    {
-        TLOGERROR("CacheImp::checkString unkown exception, key = " << keyItem << endl);
-    }
 
-    return ET_SYS_ERR;
-}
-
-tars::Int32 CacheImp::checkKey(const DCache::CheckKeyReq &req, DCache::CheckKeyRsp &rsp, tars::TarsCurrentPtr current)
-{
-    try
-    {
-        size_t keyCount = req.keys.size();
         for (size_t i = 0; i < keyCount; ++i)
         {
-            const string &sKeyItem = req.keys[i];
-            int iRet = checkString(req.moduleName, sKeyItem);
-            if (ET_SERVER_TYPE_ERR == iRet || ET_MODULE_NAME_INVALID == iRet
-                    || ET_KEY_AREA_ERR == iRet || ET_SYS_ERR == iRet)
-            {
-                TLOGERROR("WCacheImp::checkKey error,key:" << sKeyItem << " ret:" << iRet << endl);
-                if (ET_KEY_AREA_ERR == iRet)
-                {
-                    map<string, string>& context = current->getContext();
-                    //API直连模式，返回增量更新路由
-                    if (VALUE_YES == context[GET_ROUTE])
-                    {
-                        RspUpdateServant updateServant;
-                        map<string, string> rspContext;
-                        rspContext[ROUTER_UPDATED] = "";
-                        int ret = RouterHandle::getInstance()->getUpdateServant(req.keys, true, "", updateServant);
-                        if (ret != 0)
-                        {
-                            TLOGERROR(__FUNCTION__ << ":getUpdatedRoute error:" << ret << endl);
-                        }
-                        else
-                        {
-                            RouterHandle::getInstance()->updateServant2Str(updateServant, rspContext[ROUTER_UPDATED]);
-                            current->setResponseContext(rspContext);
-                        }
-                    }
-                }
-                return iRet;
-            }
-
+            int iRet = vtItem[i].ret;
             SKeyStatus stat;
-            if (ET_SUCC == iRet)
+            if (iRet == TC_HashMapMalloc::RT_OK)
             {
                 stat.exist = true;
                 stat.dirty = false;
             }
-            else if (ET_DIRTY_DATA == iRet)
+            else if (iRet == TC_HashMapMalloc::RT_DIRTY_DATA)
             {
                 stat.exist = true;
                 stat.dirty = true;
             }
-            else
+            else if (iRet == TC_HashMapMalloc::RT_NO_DATA || iRet == TC_HashMapMalloc::RT_DATA_EXPIRED || iRet == TC_HashMapMalloc::RT_ONLY_KEY)
             {
                 stat.exist = false;
                 stat.dirty = false;
             }
+            else
+            {
+                TLOGERROR("CacheImp::checkKey hashmap.checkDirty(" << req.keys[i] << ") error:" << iRet << endl);
+                g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
+                return ET_SYS_ERR;
+            }
 
-            rsp.keyStat[sKeyItem] = stat;
+            rsp.keyStat[req.keys[i]] = stat;
         }
         return ET_SUCC;
     }
     catch (const std::exception &ex)
     {
-        TLOGERROR("WCacheImp::checkKey exception: " << ex.what() << endl);
+        TLOGERROR("CacheImp::checkKey exception: " << ex.what() << endl);
     }
     catch (...)
     {
-        TLOGERROR("WCacheImp::checkKey unkown exception" << endl);
+        TLOGERROR("CacheImp::checkKey unkown exception" << endl);
     }
     return ET_SYS_ERR;
 }
 
 tars::Int32 CacheImp::getKV(const DCache::GetKVReq &req, DCache::GetKVRsp &rsp, tars::TarsCurrentPtr current)
 {
+    OpTrace trace(LOP_GET_KV, req.keyItem);
     return getValueExp(req.moduleName, req.keyItem, rsp.value, rsp.ver, rsp.expireTime, current);
 }
 
@@ -212,6 +174,7 @@ tars::Int32 CacheImp::getKVBatch(const DCache::GetKVBatchReq &req, DCache::GetKV
     const string &moduleName = req.moduleName;
     const vector<std::string>& vtKeyItem = req.keys;
     vector<SKeyValue>& vtValue = rsp.values;
+    OpTrace trace(LOP_GET_KV_BATCH, vtKeyItem.empty() ? moduleName : vtKeyItem[0]);
 
     if (moduleName != _moduleName)
     {
@@ -225,65 +188,80 @@ tars::Int32 CacheImp::getKVBatch(const DCache::GetKVBatchReq &req, DCache::GetKV
     g_app.ppReport(PPReport::SRP_GET_CNT, keyCount);
     for (size_t i = 0; i < keyCount; ++i)
     {
-        try
+        //检查key是否是在自己服务范围内
+        if (!g_route_table.isMySelf(vtKeyItem[i]))
         {
-            //检查key是否是在自己服务范围内
-            if (!g_route_table.isMySelf(vtKeyItem[i]))
+            //返回模块错误
+            TLOGERROR("CacheImp::getKVBatch: " << vtKeyItem[i] << " is not in self area" << endl);
+            map<string, string>& context = current->getContext();
+            //API直连模式，返回增量更新路由
+            if (VALUE_YES == context[GET_ROUTE])
             {
-                //返回模块错误
-                TLOGERROR("CacheImp::getKVBatch: " << vtKeyItem[i] << " is not in self area" << endl);
-                map<string, string>& context = current->getContext();
-                //API直连模式，返回增量更新路由
-                if (VALUE_YES == context[GET_ROUTE])
+                RspUpdateServant updateServant;
+                map<string, string> rspContext;
+                rspContext[ROUTER_UPDATED] = "";
+                int ret = RouterHandle::getInstance()->getUpdateServant(vtKeyItem, false, context[API_IDC], updateServant);
+                if (ret != 0)
                 {
-                    RspUpdateServant updateServant;
-                    map<string, string> rspContext;
-                    rspContext[ROUTER_UPDATED] = "";
-                    int ret = RouterHandle::getInstance()->getUpdateServant(vtKeyItem, false, context[API_IDC], updateServant);
-                    if (ret != 0)
-                    {
-                        TLOGERROR(__FUNCTION__ << ":getUpdatedRoute error:" << ret << endl);
-                    }
-                    else
-                    {
-                        RouterHandle::getInstance()->updateServant2Str(updateServant, rspContext[ROUTER_UPDATED]);
-                        current->setResponseContext(rspContext);
-                    }
+                    TLOGERROR(__FUNCTION__ << ":getUpdatedRoute error:" << ret << endl);
+                }
+                else
+                {
+                    RouterHandle::getInstance()->updateServant2Str(updateServant, rspContext[ROUTER_UPDATED]);
+                    current->setResponseContext(rspContext);
                 }
-                return ET_KEY_AREA_ERR;
             }
+            return ET_KEY_AREA_ERR;
+        }
+    }
 
-            g_app.gstat()->tryHit(_hitIndex);
-            string sValue;
-            uint32_t iSynTime, iExpireTime;
-            uint8_t iVersion;
+    //按jmem分组批量读，每个jmem只加一次锁
+    vector<BatchGetItem> vtItem;
+    try
+    {
+        if (g_app.gstat()->isExpireEnabled())
+        {
+            g_sHashMap.getBatch(vtKeyItem, vtItem, false, true, TC_TimeProvider::getInstance()->getNow());
+        }
+        else
+        {
+            g_sHashMap.getBatch(vtKeyItem, vtItem, false);
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        TLOGERROR("CacheImp::getKVBatch exception: " << ex.what() << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
+    catch (...)
+    {
+        TLOGERROR("CacheImp::getKVBatch unkown exception" << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
 
-            int iRet;
-            if (g_app.gstat()->isExpireEnabled())
-            {
-                iRet = g_sHashMap.get(vtKeyItem[i], sValue, iSynTime, iExpireTime, iVersion, true, TC_TimeProvider::getInstance()->getNow());
-            }
-            else
-            {
-                iRet = g_sHashMap.get(vtKeyItem[i], sValue, iSynTime, iExpireTime, iVersion);
-            }
+    for (size_t i = 0; i < keyCount; ++i)
+    {
+        g_app.gstat()->tryHit(_hitIndex);
+        BatchGetItem &item = vtItem[i];
+        int iRet = item.ret;
+        TrafficCapture::getInstance()->record(TOP_GET, vtKeyItem[i], item.value.size(), trafficResult(iRet));
 
-            if (iRet == TC_HashMapMalloc::RT_OK)
-            {
-                SKeyValue sKeyValue;
-                sKeyValue.keyItem = vtKeyItem[i];
-                sKeyValue.value = sValue;
-                sKeyValue.ret = VALUE_SUCC;
-                sKeyValue.ver = iVersion;
-                sKeyValue.expireTime = iExpireTime;
-                vtValue.push_back(sKeyValue);
-                g_app.gstat()->hit(_hitIndex);
-            }
-            else if (iRet == TC_HashMapMalloc::RT_NO_DATA)
-            {
-                vtNoCacheKey.push_back(vtKeyItem[i]);
-            }
-            else if (iRet == TC_HashMapMalloc::RT_ONLY_KEY)
+        if (iRet == TC_HashMapMalloc::RT_OK)
+        {
+            SKeyValue sKeyValue;
+            sKeyValue.keyItem = vtKeyItem[i];
+            sKeyValue.value.swap(item.value);
+            sKeyValue.ret = VALUE_SUCC;
+            sKeyValue.ver = item.version;
+            sKeyValue.expireTime = item.expireTime;
+            vtValue.push_back(sKeyValue);
+            g_app.gstat()->hit(_hitIndex);
+        }
+        else if (iRet == TC_HashMapMalloc::RT_NO_DATA)
+        {
+            if (NegativeCache::getInstance()->check(vtKeyItem[i]))
             {
                 SKeyValue sKeyValue;
                 sKeyValue.keyItem = vtKeyItem[i];
@@ -293,37 +271,40 @@ tars::Int32 CacheImp::getKVBatch(const DCache::GetKVBatchReq &req, DCache::GetKV
                 sKeyValue.expireTime = 0;
                 vtValue.push_back(sKeyValue);
                 g_app.gstat()->hit(_hitIndex);
-                TLOGDEBUG("CacheImp::getKVBatch RT_ONLY_KEY, key = " << vtKeyItem[i] << endl);
-            }
-            else if (iRet == TC_HashMapMalloc::RT_DATA_EXPIRED)
-            {
-                SKeyValue sKeyValue;
-                sKeyValue.keyItem = vtKeyItem[i];
-                sKeyValue.value = "";
-                sKeyValue.ret = VALUE_NO_DATA;
-                sKeyValue.ver = iVersion;
-                sKeyValue.expireTime = 0;
-                vtValue.push_back(sKeyValue);
-                g_app.gstat()->hit(_hitIndex);
-                TLOGDEBUG("CacheImp::getKVBatch RT_DATA_EXPIRED, key = " << vtKeyItem[i] << endl);
             }
             else
             {
-                TLOGERROR("CacheImp::getKVBatch hashmap.get(" << vtKeyItem[i] << ") error:" << iRet << endl);
-                g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
-                return ET_SYS_ERR;
+                vtNoCacheKey.push_back(vtKeyItem[i]);
             }
         }
-        catch (const std::exception &ex)
+        else if (iRet == TC_HashMapMalloc::RT_ONLY_KEY)
         {
-            TLOGERROR("CacheImp::getKVBatch exception: " << ex.what() << ", key = " << vtKeyItem[i] << endl);
-            g_app.ppReport(PPReport::SRP_EX, 1);
-            return ET_SYS_ERR;
+            SKeyValue sKeyValue;
+            sKeyValue.keyItem = vtKeyItem[i];
+            sKeyValue.value = "";
+            sKeyValue.ret = VALUE_NO_DATA;
+            sKeyValue.ver = 1;
+            sKeyValue.expireTime = 0;
+            vtValue.push_back(sKeyValue);
+            g_app.gstat()->hit(_hitIndex);
+            TLOGDEBUG("CacheImp::getKVBatch RT_ONLY_KEY, key = " << vtKeyItem[i] << endl);
         }
-        catch (...)
+        else if (iRet == TC_HashMapMalloc::RT_DATA_EXPIRED)
         {
-            TLOGERROR("CacheImp::getKVBatch unkown exception, key = " << vtKeyItem[i] << endl);
-            g_app.ppReport(PPReport::SRP_EX, 1);
+            SKeyValue sKeyValue;
+            sKeyValue.keyItem = vtKeyItem[i];
+            sKeyValue.value = "";
+            sKeyValue.ret = VALUE_NO_DATA;
+            sKeyValue.ver = item.version;
+            sKeyValue.expireTime = 0;
+            vtValue.push_back(sKeyValue);
+            g_app.gstat()->hit(_hitIndex);
+            TLOGDEBUG("CacheImp::getKVBatch RT_DATA_EXPIRED, key = " << vtKeyItem[i] << endl);
+        }
+        else
+        {
+            TLOGERROR("CacheImp::getKVBatch hashmap.get(" << vtKeyItem[i] << ") error:" << iRet << endl);
+            g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
             return ET_SYS_ERR;
         }
     }
@@ -454,6 +435,81 @@ tars::Int32 CacheImp::getAllKeys(const DCache::GetAllKeysReq &req, DCache::GetAl
     return ET_SUCC;
 }
 
+tars::Int32 CacheImp::scanKeys(const DCache::ScanKeysReq &req, DCache::ScanKeysRsp &rsp, tars::TarsCurrentPtr current)
+{
+    TLOGDEBUG("CacheImp::scanKeys: cursor:" << req.cursor << " count:" << req.count << " match:" << req.match << " timeLimit:" << req.timeLimit << endl);
+
+    if (req.moduleName != _moduleName)
+    {
+        //返回模块错误
+        TLOGERROR("CacheImp::scanKeys: moduleName error!" << req.moduleName << endl);
+        return ET_MODULE_NAME_INVALID;
+    }
+
+    //cursor为下一个要遍历的hash桶的位置，各jmem的桶依次排列
+    if ((req.cursor < 0) || (req.cursor > UINT32_MAX) || (req.count <= 0) || (req.timeLimit < 0))
+    {
+        TLOGERROR("[CacheImp::scanKeys]: condition error" << endl);
+        return ET_INPUT_PARAM_ERROR;
+    }
+
+    rsp.cursor = 0;
+
+    try
+    {
+        SHashMap::dcache_hash_iterator it = g_sHashMap.hashByPos(req.cursor);
+
+        int64_t iBeginMs = TC_TimeProvider::getInstance()->getNowMs();
+        tars::Int64 iPos = req.cursor;
+        vector<string> vtKey;
+        while (it != g_sHashMap.hashEnd())
+        {
+            vtKey.clear();
+            it->getKey(vtKey);
+            ++it;
+            ++iPos;
+
+            for (size_t i = 0; i < vtKey.size(); ++i)
+            {
+                if (req.match.empty() || StringUtil::matchPattern(vtKey[i], req.match))
+                {
+                    rsp.keys.push_back(vtKey[i]);
+                }
+            }
+
+            if (iPos - req.cursor >= req.count)
+            {
+                break;
+            }
+
+            //每遍历64个桶检查一次耗时
+            if ((req.timeLimit > 0) && ((iPos - req.cursor) % 64 == 0) && (TC_TimeProvider::getInstance()->getNowMs() - iBeginMs >= req.timeLimit))
+            {
+                break;
+            }
+        }
+
+        if (it != g_sHashMap.hashEnd())
+        {
+            rsp.cursor = iPos;
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        TLOGERROR("CacheImp::scanKeys exception: " << ex.what() << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
+    catch (...)
+    {
+        TLOGERROR("CacheImp::scanKeys unkown exception" << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
+
+    return ET_SUCC;
+}
+
 bool CacheImp::isTransSrc(int pageNo)
 {
     ServerInfo srcServer;
@@ -538,6 +594,7 @@ tars::Int32 CacheImp::getValueExp(const std::string & moduleName, const std::str
         {
             iRet = g_sHashMap.get(keyItem, value, iSynTime, iExpireTime, iVersion);
         }
+        TrafficCapture::getInstance()->record(TOP_GET, keyItem, value.size(), trafficResult(iRet));
 
         if (iRet == TC_HashMapMalloc::RT_OK)
         {
@@ -548,6 +605,13 @@ tars::Int32 CacheImp::getValueExp(const std::string & moduleName, const std::str
         }
         else if (iRet == TC_HashMapMalloc::RT_NO_DATA)
         {
+            //已知DB中不存在，与OnlyKey一样处理
+            if (NegativeCache::getInstance()->check(keyItem))
+            {
+                g_app.gstat()->hit(_hitIndex);
+                return ET_NO_DATA;
+            }
+
             if (accessDB && _tcConf["/Main/DbAccess<DBFlag>"] == "Y"  && _readDB)
             {
                 TLOGDEBUG("CacheImp::getValueExp async db, key = " << keyItem << endl);
@@ -50,12 +50,10 @@ public:
     virtual tars::Int32 getKV(const DCache::GetKVReq &req, DCache::GetKVRsp &rsp, tars::TarsCurrentPtr current);
     virtual tars::Int32 getKVBatch(const DCache::GetKVBatchReq &req, DCache::GetKVBatchRsp &rsp, tars::TarsCurrentPtr current);
     virtual tars::Int32 getAllKeys(const DCache::GetAllKeysReq &req, DCache::GetAllKeysRsp &rsp, tars::TarsCurrentPtr current);
+    virtual tars::Int32 scanKeys(const DCache::ScanKeysReq &req, DCache::ScanKeysRsp &rsp, tars::TarsCurrentPtr current);
 
     virtual tars::Int32 getSyncTime(tars::TarsCurrentPtr current);
 
-
-    tars::Int32 checkString(const std::string& moduleName, const string& keyItem);
-
 protected:
     //判断是否是迁移源地址
     bool isTransSrc(int pageNo);
@@ -12,6 +12,8 @@
 * and limitations under the License.
 */
 #include <sys/resource.h>
+#include <algorithm>
+#include <functional>
 #include "CacheServer.h"
 #include "CacheImp.h"
 #include "WCacheImp.h"
@@ -661,11 +663,23 @@ void CacheServer::initialize()
     TARS_ADD_ADMIN_CMD_NORMAL("setalldirty", CacheServer::setAllDirty);
     TARS_ADD_ADMIN_CMD_NORMAL("clearcache", CacheServer::clearCache);
     TARS_ADD_ADMIN_CMD_NORMAL("key", CacheServer::showKey);
+    TARS_ADD_ADMIN_CMD_NORMAL("latency", CacheServer::showLatency);
+    TARS_ADD_ADMIN_CMD_NORMAL("capture", CacheServer::showCapture);
+    TARS_ADD_ADMIN_CMD_NORMAL("fragstat", CacheServer::showFragStat);
+    TARS_ADD_ADMIN_CMD_NORMAL("sizeclass", CacheServer::showSizeClass);
+    TARS_ADD_ADMIN_CMD_NORMAL("compress", CacheServer::showCompress);
+    TARS_ADD_ADMIN_CMD_NORMAL("traindict", CacheServer::trainDict);
+    TARS_ADD_ADMIN_CMD_NORMAL("negfilter", CacheServer::showNegFilter);
 
 
     int iRet = _ppReport.init();
     assert(iRet == 0);
 
+    LatencyStat::getInstance()->init(_tcConf);
+    TrafficCapture::getInstance()->init(_tcConf, TST_KV);
+    ValueCompressor::getInstance()->init(_tcConf);
+    NegativeCache::getInstance()->init(_tcConf);
+
     iRet = _gStat.init();
     assert(iRet == 0);
 
@@ -707,8 +721,10 @@ void CacheServer::initialize()
     _gStat.setGroupName(groupinfo.groupName);
     TLOGDEBUG("CacheServer::initialize groupName:" << groupinfo.groupName << endl);
 
-    //hashmap初始化
-    NormalHash *pHash = new NormalHash();
+    //hashmap初始化，hash函数使用路由中模块的hash类型，与proxy路由时一致
+    int iHashType = g_route_table.getHashType();
+    P_Hash *pHash = HashFactory::getHash(iHashType);
+    TLOGDEBUG("CacheServer::initialize hash type:" << HashFactory::getHashName(iHashType) << endl);
 //    typedef size_t(NormalHash::*TpMem)(const string &);
 
     bool bCreate = false;
@@ -858,10 +874,14 @@ void CacheServer::initialize()
     unsigned int shmNum = TC_Common::strto<unsigned int>(_tcConf.get("/Main/Cache<JmemNum>", "10"));
     g_sHashMap.init(shmNum);
     g_sHashMap.initHashRadio(atof(_tcConf["/Main/Cache<HashRadio>"].c_str()));
+    g_sHashMap.initFingerprint(_tcConf.get("/Main/Cache<Fingerprint>", "N") == "Y");
     g_sHashMap.initAvgDataSize(TC_Common::strto<unsigned int>(_tcConf["/Main/Cache<AvgDataSize>"]));
+    g_sHashMap.initHashType(iHashType);
     g_sHashMap.initLock(key, shmNum, -1);
     TLOGDEBUG("CacheServer::initialize, initLock finish" << endl);
 
+    initSizeClass();
+
     g_sHashMap.initStore(key, n);
 
     TLOGDEBUG("CacheServer::initialize, initStore finish" << endl);
@@ -869,9 +889,12 @@ void CacheServer::initialize()
     TLOGDEBUG("g_sHashMap.setToDoFunctor" << endl);
     g_sHashMap.setToDoFunctor(&_todoFunctor);
 
-    TC_HashMapMalloc::hash_functor cmd = std::bind(&NormalHash::HashRawString, pHash, std::placeholders::_1); //(pHash, static_cast<TpMem>(&NormalHash::HashRawString));
+    TC_HashMapMalloc::hash_functor cmd = std::bind(&P_Hash::HashRawString, pHash, std::placeholders::_1); //(pHash, static_cast<TpMem>(&NormalHash::HashRawString));
     g_sHashMap.setHashFunctor(cmd);
     g_sHashMap.setAutoErase(false);
+    //不开启压缩也要设置，之前压缩过的数据需要解压
+    g_sHashMap.setValueCodec(ValueCompressor::getInstance());
+    g_sHashMap.setAbsentKeyFilter(NegativeCache::getInstance());
 
 
     //生成binlog文件
@@ -996,6 +1019,9 @@ void CacheServer::initialize()
     _syncThread.init(ServerConfig::BasePath + "CacheServer.conf");
     _syncThread.createThread();
 
+    _defragThread.init(ServerConfig::BasePath + "CacheServer.conf");
+    _defragThread.createThread();
+
     _heartBeatThread.createThread();
     string sMasterConAddr = RouterHandle::getInstance()->getConnectHbAddr();
     if (!sMasterConAddr.empty())
@@ -1048,6 +1074,13 @@ bool CacheServer::help(const string& command, const string& params, string& resu
     result += "calculateData: 统计未被访问数据大小\n";
     result += "setalldirty：将cache内全部数据设置成脏数据\n";
     result += "clearcache：清空cache，危险操作，请三思\n";
+    result += "latency: 接口延时统计，参数phase显示各阶段耗时，slow显示慢请求，reset清空统计\n";
+    result += "capture: 流量采集状态\n";
+    result += "fragstat: 内存碎片整理状态和各尺寸类别的内存使用情况\n";
+    result += "sizeclass: 数据尺寸分布和按分布推导的尺寸类别\n";
+    result += "compress: value压缩的状态和压缩率\n";
+    result += "traindict [采样个数]: 用cache中采样的value训练压缩字典\n";
+    result += "negfilter: 不存在key的过滤器的状态和误判率\n";
     return true;
 }
 
@@ -1167,13 +1200,19 @@ bool CacheServer::reloadConf(const string& command, const string& params, string
     _todoFunctor.reload();
 
     g_sHashMap.setSyncTime(TC_Common::strto<unsigned int>(_tcConf["/Main/Cache<SyncTime>"]));
+    initSizeClass();
 
     _syncBinlogThread.reload();
     _timerThread.reload();
     _syncThread.reload();
     _syncAllThread.reload();
+    _defragThread.reload();
     _eraseDataInPageFunc.reload(_tcConf);
     _binlogTimeThread.reload();
+    LatencyStat::getInstance()->init(_tcConf);
+    TrafficCapture::getInstance()->init(_tcConf, TST_KV);
+    ValueCompressor::getInstance()->init(_tcConf);
+    NegativeCache::getInstance()->init(_tcConf);
 
     string sStartExpireThread = _tcConf.get("/Main/Cache<StartExpireThread>", "N");
     if (sStartExpireThread == "Y" || sStartExpireThread == "y")
@@ -1241,6 +1280,131 @@ bool CacheServer::showVer(const string& command, const string& params, string& r
     return true;
 }
 
+bool CacheServer::showLatency(const string& command, const string& params, string& result)
+{
+    result = LatencyStat::getInstance()->command(params);
+    return true;
+}
+
+bool CacheServer::showCapture(const string& command, const string& params, string& result)
+{
+    result = TrafficCapture::getInstance()->status();
+    return true;
+}
+
+bool CacheServer::showFragStat(const string& command, const string& params, string& result)
+{
+    result = _defragThread.status();
+    return true;
+}
+
+bool CacheServer::showCompress(const string& command, const string& params, string& result)
+{
+    result = ValueCompressor::getInstance()->status();
+    return true;
+}
+
+bool CacheServer::showNegFilter(const string& command, const string& params, string& result)
+{
+    result = NegativeCache::getInstance()->status();
+    return true;
+}
+
+bool CacheServer::trainDict(const string& command, const string& params, string& result)
+{
+    size_t iSampleNum = TC_Common::strto<size_t>(TC_Common::trim(params));
+    if (iSampleNum == 0)
+    {
+        iSampleNum = 1000;
+    }
+
+    size_t iHashCount = g_sHashMap.getHashCount();
+    if (iHashCount == 0 || g_sHashMap.size() == 0)
+    {
+        result = "no data in cache";
+        return true;
+    }
+
+    //随机取hash桶采样，每个value最多取4K，桶为空时多取几次
+    const size_t iMaxSampleSize = 4096;
+    vector<string> vtSample;
+    for (size_t i = 0; i < iSampleNum * 4 && vtSample.size() < iSampleNum; ++i)
+    {
+        SHashMap::dcache_hash_iterator it = g_sHashMap.hashByPos(rand() % iHashCount);
+        if (it == g_sHashMap.hashEnd())
+        {
+            continue;
+        }
+
+        vector<pair<string, string> > vtData;
+        it->get(vtData);
+        for (size_t j = 0; j < vtData.size() && vtSample.size() < iSampleNum; ++j)
+        {
+            if (!vtData[j].second.empty())
+            {
+                vtSample.push_back(vtData[j].second.substr(0, iMaxSampleSize));
+            }
+        }
+    }
+
+    uint32_t iDictId = 0;
+    string sErr;
+    if (ValueCompressor::getInstance()->trainDict(vtSample, iDictId, sErr) != 0)
+    {
+        result = "train dict failed: " + sErr;
+        TLOGERROR("CacheServer::trainDict " << result << endl);
+        return true;
+    }
+
+    result = "train dict succ, samples: " + TC_Common::tostr(vtSample.size()) + ", dict: " + TC_Common::tostr(iDictId);
+    return true;
+}
+
+bool CacheServer::showSizeClass(const string& command, const string& params, string& result)
+{
+    vector<uint64_t> vtHist;
+    vector<size_t> vtClassSize;
+    uint64_t iWaste = 0;
+    g_sHashMap.getSizeClassInfo(vtHist, vtClassSize, iWaste);
+
+    uint64_t iAllocNum = 0;
+    uint64_t iAllocSize = 0;
+    vector<pair<uint64_t, size_t> > vtTop;
+    for (size_t i = 0; i < vtHist.size(); ++i)
+    {
+        if (vtHist[i] > 0)
+        {
+            iAllocNum += vtHist[i];
+            iAllocSize += vtHist[i] * SizeMap::HistBucketSize(i);
+            vtTop.push_back(make_pair(vtHist[i], SizeMap::HistBucketSize(i)));
+        }
+    }
+    sort(vtTop.begin(), vtTop.end(), greater<pair<uint64_t, size_t> >());
+
+    uint32_t iMaxWaste = TC_Common::strto<uint32_t>(_tcConf.get("/Main/Cache<SizeClassMaxWaste>", "25"));
+    vector<size_t> vtLearn;
+    SizeMap::LearnClassSize(vtHist, iMaxWaste, vtLearn);
+    SizeMap learnMap;
+    learnMap.Init(vtLearn);
+    uint64_t iLearnWaste = learnMap.EstimateWaste(vtHist);
+
+    ostringstream os;
+    os << "allocations: " << iAllocNum << ", requested bytes: " << iAllocSize << endl;
+    os << "current waste: " << iWaste << " bytes, " << (iAllocSize > 0 ? iWaste * 100 / iAllocSize : 0) << "%" << endl;
+    os << "learned waste: " << iLearnWaste << " bytes, " << (iAllocSize > 0 ? iLearnWaste * 100 / iAllocSize : 0) << "%" << endl;
+    os << "current size class(" << vtClassSize.size() << "): " << TC_Common::tostr(vtClassSize.begin(), vtClassSize.end(), ",") << endl;
+    os << "learned size class(" << vtLearn.size() << "): " << TC_Common::tostr(vtLearn.begin(), vtLearn.end(), ",") << endl;
+    os << "top sizes:" << endl;
+    os << "size\tcount\tpercent" << endl;
+    for (size_t i = 0; i < vtTop.size() && i < 20; ++i)
+    {
+        os << "<=" << vtTop[i].second << "\t" << vtTop[i].first << "\t" << vtTop[i].first * 100 / iAllocNum << "%" << endl;
+    }
+
+    result = os.str();
+    return true;
+}
+
 bool CacheServer::showKey(const string& command, const string& params, string& result)
 {
     result = _shmKey;
@@ -1287,6 +1451,7 @@ bool CacheServer::clearCache(const string& command, const string& params, string
     if (certified)
     {
         g_sHashMap.clear();
+        NegativeCache::getInstance()->clear();
     }
 
     result = "clear cache successfully";
@@ -1294,6 +1459,23 @@ bool CacheServer::clearCache(const string& command, const string& params, string
     return true;
 }
 
+void CacheServer::initSizeClass()
+{
+    vector<size_t> vtClassSize = TC_Common::sepstr<size_t>(_tcConf.get("/Main/Cache<SizeClass>", ""), ",; ");
+    string sAuto = _tcConf.get("/Main/Cache<SizeClassAuto>", "N");
+    bool bAuto = (sAuto == "Y" || sAuto == "y");
+    uint32_t iMaxWaste = TC_Common::strto<uint32_t>(_tcConf.get("/Main/Cache<SizeClassMaxWaste>", "25"));
+
+    if (!g_sHashMap.initSizeClass(vtClassSize, bAuto, iMaxWaste))
+    {
+        TLOGERROR("CacheServer::initSizeClass invalid SizeClass, use default size class" << endl);
+        vtClassSize.clear();
+        g_sHashMap.initSizeClass(vtClassSize, bAuto, iMaxWaste);
+    }
+
+    TLOGDEBUG("CacheServer::initSizeClass size class num:" << vtClassSize.size() << "|auto:" << bAuto << "|max waste:" << iMaxWaste << endl);
+}
+
 bool CacheServer::isAllInSlaveCreatingStatus()
 {
     return (_syncBinlogThread.isInSlaveCreatingStatus() && _binlogTimeThread.isInSlaveCreatingStatus() && _timerThread.isInSlaveCreatingStatus());
@@ -1378,6 +1560,9 @@ void CacheServer::WriteToFile(const string &content, const string &logFile)
 
     unsigned int iContentSize = content.size();
 
+    //统计写binlog耗时，包括等待binlog文件锁
+    PhaseTimer phaseTimer(LPH_BINLOG);
+
     //先加锁
     TC_ThreadLock::Lock lock(g_app._binlogLock);
 
@@ -1469,6 +1654,7 @@ string CacheServer::formatCacheHead(vector<TC_HashMapMalloc::tagMapHead> &tmpHea
     s += "命中次数：" + TC_Common::tostr(totalHitCount) + "\n";
     s += "AvgDataSize: " + TC_Common::tostr(tmpHead[0]._iAvgDataSize) + "\n";
     s += "HashRadio: " + TC_Common::tostr(tmpHead[0]._fRadio) + "\n";
+    s += "HashType: " + TC_Common::tostr((int)tmpHead[0]._cHashType) + "\n";
     return s;
 }
 
@@ -1726,18 +1912,20 @@ CacheServer::destroyApp()
     _eraseThread.stop();
     _syncThread.stop();
     _syncAllThread.stop();
+    _defragThread.stop();
     _createBinlogFileThread.stop();
     _heartBeatThread.stop();
 
     _dumpThread.stop();
     _slaveCreateThread.stop();
+    TrafficCapture::getInstance()->terminate();
 
     if ((_tcConf["/Main/Cache<StartExpireThread>"] == "Y" || _tcConf["/Main/Cache<StartExpireThread>"] == "y"))
     {
         _expireThread->stop();
     }
 
-    while (_syncBinlogThread.isRuning() || _binlogTimeThread.isRuning() || _timerThread.isRuning() || _syncAllThread.isRuning() || _syncThread.isRuning() || _eraseThread.isRuning() || _slaveCreateThread.isRuning() || _dumpThread.isRuning())
+    while (_syncBinlogThread.isRuning() || _binlogTimeThread.isRuning() || _timerThread.isRuning() || _syncAllThread.isRuning() || _syncThread.isRuning() || _eraseThread.isRuning() || _slaveCreateThread.isRuning() || _dumpThread.isRuning() || _defragThread.isRuning())
     {
         usleep(10000);
     }
@@ -27,9 +27,13 @@
 #include "NormalHash.h"
 #include "CacheGlobe.h"
 #include "ExpireThread.h"
+#include "DefragThread.h"
 #include "BinLogTimeThread.h"
 #include "SlaveCreateThread.h"
 #include "DumpThread.h"
+#include "LatencyStat.h"
+#include "ValueCompressor.h"
+#include "NegativeCache.h"
 #include "../ConfigServer/Config.h"
 
 using namespace std;
@@ -216,6 +220,62 @@ public:
     */
     bool showVer(const string& command, const string& params, string& result);
 
+    /**
+    *通过admin端口查看接口延时统计
+    *   command: 命令字为 "latency"
+    *	params:	空为各接口总耗时，phase为各阶段耗时，slow为最近的慢请求，reset为清空统计
+    *	result:	统计结果
+    */
+    bool showLatency(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口查看流量采集状态，采集通过/Main/Capture配置开关，reload生效
+    *   command: 命令字为 "capture"
+    *	params:	空
+    *	result:	采集状态
+    */
+    bool showCapture(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口查看碎片整理状态和各尺寸类别的内存使用情况
+    *   command: 命令字为 "fragstat"
+    *	params:	空
+    *	result:	碎片统计
+    */
+    bool showFragStat(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口查看数据区的尺寸分布，以及当前尺寸类别和按分布推导的尺寸类别的内部碎片
+    *   command: 命令字为 "sizeclass"
+    *	params:	空
+    *	result:	推导出的尺寸类别可直接配置到/Main/Cache<SizeClass>
+    */
+    bool showSizeClass(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口查看value压缩的状态和压缩率
+    *   command: 命令字为 "compress"
+    *	params:	空
+    *	result:	压缩统计
+    */
+    bool showCompress(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口查看不存在key的过滤器的状态和误判率
+    *   command: 命令字为 "negfilter"
+    *	params:	空
+    *	result:	过滤器统计
+    */
+    bool showNegFilter(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口用cache中随机采样的value训练压缩字典，训练后新写入的数据使用新字典
+    *   command: 命令字为 "traindict"
+    *	params:	采样的value个数，默认1000
+    *	result:	新字典id
+    */
+    bool trainDict(const string& command, const string& params, string& result);
+
     /**
     *通过admin端口删除指定页范围内的数据
     *   command: 命令字为 "erasedatainpage"
@@ -358,6 +418,11 @@ protected:
 
     string formatCacheHead(vector<TC_HashMapMalloc::tagMapHead> &tmpHead);
 
+    /**
+    *读取/Main/Cache的SizeClass配置，设置数据区的尺寸类别，配置不合法时使用默认尺寸类别
+    */
+    void initSizeClass();
+
 protected:
     TC_Config _tcConf;
 
@@ -384,6 +449,9 @@ protected:
     //清除过期线程的线程类
     ExpireThread*  _expireThread;
 
+    //内存碎片整理线程类
+    DefragThread _defragThread;
+
     //定时生成binlog文件线程
     CreateBinlogFileThread _createBinlogFileThread;
 
@@ -65,13 +65,44 @@ void CBQueue::erase(const string &mainKey)
     _keyParamQueue.erase(mainKey);
 }
 
+void DbAccessCallback::reportDbLatency(bool bDel)
+{
+    if (!LatencyStat::getInstance()->isEnable())
+    {
+        return;
+    }
+
+    LatencyOp op;
+    if (bDel)
+    {
+        op = _batchReq ? LOP_DEL_KV_BATCH : LOP_DEL_KV;
+    }
+    else if (_type == "add")
+    {
+        op = LOP_INSERT_KV;
+    }
+    else if (_type == "updateEx")
+    {
+        op = LOP_UPDATE_KV;
+    }
+    else
+    {
+        op = _batchReq ? LOP_GET_KV_BATCH : LOP_GET_KV;
+    }
+    LatencyStat::getInstance()->recordDb(op, LatencyStat::nowUs() - _beginUs, _key);
+}
+
 void DbAccessCallback::callback_get(tars::Int32 ret, const std::string &value, tars::Int32 iExpireTime)
 {
+    reportDbLatency(false);
     //TLOGDEBUG("DbAccessCallback::callback_get return iret = " << ret << " , key = " << _key << endl);
     try
     {
         if (ret == eDbSucc)
         {
+            //抽样校验的key或过滤器中过时的key
+            NegativeCache::getInstance()->onDbData(_key);
+
             if (_batchReq)
             {
                 if (_pParam->bEnd)
@@ -342,7 +373,19 @@ void DbAccessCallback::callback_get(tars::Int32 ret, const std::string &value, t
                 }
             }
 
-            if (_saveOnlyKey)
+            if (_type != "add" && NegativeCache::getInstance()->isEnable())
+            {
+                //开启过滤器时不再保存OnlyKey，也不写binlog
+                NegativeCache::getInstance()->add(_key);
+
+                //查询DB期间key可能已经写入cache，写入时的删除发生在加入之前
+                int iRet = g_sHashMap.checkDirty(_key);
+                if (iRet == TC_HashMapMalloc::RT_OK || iRet == TC_HashMapMalloc::RT_DIRTY_DATA)
+                {
+                    NegativeCache::getInstance()->onWrite(_key);
+                }
+            }
+            else if (_saveOnlyKey)
             {
                 try
                 {
@@ -445,6 +488,7 @@ void DbAccessCallback::callback_get(tars::Int32 ret, const std::string &value, t
 
 void DbAccessCallback::callback_get_exception(tars::Int32 ret)
 {
+    reportDbLatency(false);
     TLOGERROR("DbAccessCallback::callback_get_exception ret =" << ret << ", key = " << _key << endl);
     g_app.ppReport(PPReport::SRP_DB_EX, 1);
 
@@ -501,6 +545,7 @@ void DbAccessCallback::callback_get_exception(tars::Int32 ret)
 
 void DbAccessCallback::callback_del(tars::Int32 ret)
 {
+    reportDbLatency(true);
     TLOGDEBUG("DbAccessCallback::callback_del return iret = " << ret << " , key = " << _key << endl);
     try
     {
@@ -599,6 +644,7 @@ void DbAccessCallback::callback_del(tars::Int32 ret)
 
 void DbAccessCallback::callback_del_exception(tars::Int32 ret)
 {
+    reportDbLatency(true);
     TLOGERROR("DbAccessCallback::callback_del_exception ret =" << ret << ", key = " << _key << endl);
     g_app.ppReport(PPReport::SRP_DB_EX, 1);
 
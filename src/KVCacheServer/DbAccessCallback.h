@@ -164,22 +164,22 @@ struct DbAccessCallback : public DbAccessPrxCallback
 {
     //定义构造函数，保存上下文
     DbAccessCallback(TarsCurrentPtr &current, const string &sKey, const string &sBinLogFile, bool bSaveOnlyKey, bool bBatch, bool bRecordBinLog, bool bRecordKeyBinlog, string type, DbAccessCBParamPtr pParam) :
-        _current(current), _key(sKey), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _cbParam(pParam), _type(type) {}
+        _current(current), _key(sKey), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _cbParam(pParam), _type(type), _beginUs(LatencyStat::nowUs()) {}
 
     DbAccessCallback(TarsCurrentPtr &current, const string &sKey, const string &sBinLogFile, bool bSaveOnlyKey, bool bBatch, bool bRecordBinLog, bool bRecordKeyBinlog, BatchParamPtr pParam) :
-        _current(current), _key(sKey), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pParam(pParam), _type("") {}
+        _current(current), _key(sKey), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pParam(pParam), _type(""), _beginUs(LatencyStat::nowUs()) {}
 
     DbAccessCallback(TarsCurrentPtr &current, const string &sKey, const string &sBinLogFile, bool bSaveOnlyKey, bool bBatch, bool bRecordBinLog, bool bRecordKeyBinlog, BatchParamPtr pParam, string type, const string &sValue, bool dirty, tars::Int32 expireTimeSecond) :
-        _current(current), _key(sKey), _value(sValue), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pParam(pParam), _type(type), _dirty(dirty), _expireTimeSecond(expireTimeSecond) {}
+        _current(current), _key(sKey), _value(sValue), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pParam(pParam), _type(type), _dirty(dirty), _expireTimeSecond(expireTimeSecond), _beginUs(LatencyStat::nowUs()) {}
 
     DbAccessCallback(TarsCurrentPtr &current, const string & sKey, const string &sBinLogFile, bool bSaveOnlyKey, bool bBatch, bool bRecordBinLog, bool bRecordKeyBinlog, BatchParamPtr pParam, string type, const string &sValue, bool dirty, tars::Int32 expireTimeSecond, enum Op option) :
-        _current(current), _key(sKey), _value(sValue), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pParam(pParam), _type(type), _dirty(dirty), _expireTimeSecond(expireTimeSecond), _option(option) {}
+        _current(current), _key(sKey), _value(sValue), _binlogFile(sBinLogFile), _saveOnlyKey(bSaveOnlyKey), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pParam(pParam), _type(type), _dirty(dirty), _expireTimeSecond(expireTimeSecond), _option(option), _beginUs(LatencyStat::nowUs()) {}
 
     DbAccessCallback(TarsCurrentPtr &current, const string &sKey, const string &sBinLogFile, bool bRecordBinLog, bool bRecordKeyBinlog) :
-        _current(current), _key(sKey), _binlogFile(sBinLogFile), _batchReq(false), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog) {}
+        _current(current), _key(sKey), _binlogFile(sBinLogFile), _batchReq(false), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _beginUs(LatencyStat::nowUs()) {}
 
     DbAccessCallback(TarsCurrentPtr &current, const string &sKey, const string &sBinLogFile, bool bBatch, bool bRecordBinLog, bool bRecordKeyBinlog, DelBatchParamPtr pParam) :
-        _current(current), _key(sKey), _binlogFile(sBinLogFile), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pDelParam(pParam) {}
+        _current(current), _key(sKey), _binlogFile(sBinLogFile), _batchReq(bBatch), _isRecordBinLog(bRecordBinLog), _isRecordKeyBinLog(bRecordKeyBinlog), _pDelParam(pParam), _beginUs(LatencyStat::nowUs()) {}
 
 
     //回调函数,Key类型为string，返回带过期时间@2016.3.18
@@ -194,6 +194,9 @@ struct DbAccessCallback : public DbAccessPrxCallback
 
     void response_del();
 
+    //统计从发起请求到回调的耗时
+    void reportDbLatency(bool bDel);
+
     TarsCurrentPtr _current;
     string _key;
     string _value;
@@ -209,6 +212,7 @@ struct DbAccessCallback : public DbAccessPrxCallback
     bool _dirty;
     tars::Int32 _expireTimeSecond;
     enum Op _option;
+    uint64_t _beginUs;
 };
 
 /////////////////////////////////////////////////////
@@ -0,0 +1,186 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "DefragThread.h"
+#include "CacheServer.h"
+
+void DefragThread::init(const string &sConf)
+{
+    _config = sConf;
+    _tcConf.parseFile(_config);
+    loadConf();
+
+    TLOGDEBUG("DefragThread::init succ" << endl);
+}
+
+void DefragThread::reload()
+{
+    _tcConf.parseFile(_config);
+    loadConf();
+
+    TLOGDEBUG("DefragThread::reload succ" << endl);
+}
+
+void DefragThread::loadConf()
+{
+    string sEnable = _tcConf.get("/Main/Cache<DefragEnable>", "N");
+    _enable = (sEnable == "Y" || sEnable == "y") ? true : false;
+
+    _sparseRatio = TC_Common::strto<uint32_t>(_tcConf.get("/Main/Cache<DefragSparseRatio>", "30"));
+    if (_sparseRatio > 100)
+    {
+        _sparseRatio = 100;
+    }
+    _triggerRatio = TC_Common::strto<size_t>(_tcConf.get("/Main/Cache<DefragTriggerRatio>", "20"));
+    _checkInterval = TC_Common::strto<int>(_tcConf.get("/Main/Cache<DefragInterval>", "300"));
+    _defragSpeed = TC_Common::strto<size_t>(_tcConf.get("/Main/Cache<DefragSpeed>", "10000"));
+
+    TLOGDEBUG("DefragThread::loadConf enable:" << _enable << "|sparseRatio:" << _sparseRatio << "|triggerRatio:" << _triggerRatio
+              << "|interval:" << _checkInterval << "|speed:" << _defragSpeed << endl);
+}
+
+void DefragThread::createThread()
+{
+    //创建线程
+    pthread_t thread;
+
+    if (!_isRuning)
+    {
+        if (pthread_create(&thread, NULL, Run, (void*)this) != 0)
+        {
+            TLOGERROR("Create DefragThread fail" << endl);
+        }
+    }
+    else
+    {
+        TLOGDEBUG("DefragThread is running, can not be create again" << endl);
+    }
+}
+
+void* DefragThread::Run(void* arg)
+{
+    pthread_detach(pthread_self());
+    DefragThread* pthis = (DefragThread*)arg;
+    pthis->setRuning(true);
+    pthis->setStart(true);
+
+    time_t tLastCheck = TC_TimeProvider::getInstance()->getNow();
+    while (pthis->isStart())
+    {
+        time_t tNow = TC_TimeProvider::getInstance()->getNow();
+        if (pthis->_enable && tNow - tLastCheck >= pthis->_checkInterval)
+        {
+            try
+            {
+                pthis->_lastFragRatio = pthis->getFragRatio();
+                if (pthis->_lastFragRatio >= pthis->_triggerRatio)
+                {
+                    pthis->defrag();
+                }
+            }
+            catch (const std::exception &ex)
+            {
+                TLOGERROR("DefragThread::Run exception: " << ex.what() << endl);
+            }
+            tLastCheck = tNow;
+        }
+
+        sleep(1);
+    }
+    pthis->setRuning(false);
+    return NULL;
+}
+
+size_t DefragThread::getFragRatio()
+{
+    vector<TC_Page::tagSizeClassStat> vtStat;
+    size_t iFreePageNum = 0;
+    g_sHashMap.getSizeClassStat(_sparseRatio, vtStat, iFreePageNum);
+
+    size_t iStranded = 0;
+    for (size_t i = 0; i < vtStat.size(); ++i)
+    {
+        iStranded += (vtStat[i]._iObjectNum - vtStat[i]._iUsedObjectNum) * vtStat[i]._iObjectSize;
+    }
+
+    size_t iDataMemSize = g_sHashMap.getDataMemSize();
+    return iDataMemSize == 0 ? 0 : iStranded * 100 / iDataMemSize;
+}
+
+void DefragThread::defrag()
+{
+    time_t tBegin = TC_TimeProvider::getInstance()->getNow();
+    size_t iFragRatio = _lastFragRatio;
+
+    size_t iCount = 0;
+    size_t iMoved = 0;
+    SHashMap::dcache_hash_iterator it = g_sHashMap.hashBegin();
+    TLOGDEBUG("DefragThread::defrag start, frag ratio:" << iFragRatio << "%" << endl);
+    while (isStart() && _enable && it != g_sHashMap.hashEnd())
+    {
+        time_t tNow = TC_TimeProvider::getInstance()->getNow();
+        if (_defragSpeed > 0 && tBegin == tNow && iCount >= _defragSpeed)
+        {
+            usleep(10000);
+            continue;
+        }
+
+        if (tBegin < tNow)
+        {
+            iCount = 0;
+            tBegin = tNow;
+        }
+
+        //每次只锁一个hash桶
+        uint32_t n = it->defrag(_sparseRatio);
+        ++it;
+
+        iCount += n;
+        iMoved += n;
+    }
+
+    _movedCount += iMoved;
+    ++_passCount;
+    _lastFragRatio = getFragRatio();
+
+    TLOGDEBUG("DefragThread::defrag " << (isStart() && _enable ? "finish" : "by stop") << ", moved:" << iMoved
+              << ", frag ratio:" << iFragRatio << "% -> " << _lastFragRatio << "%" << endl);
+}
+
+string DefragThread::status()
+{
+    vector<TC_Page::tagSizeClassStat> vtStat;
+    size_t iFreePageNum = 0;
+    g_sHashMap.getSizeClassStat(_sparseRatio, vtStat, iFreePageNum);
+
+    ostringstream os;
+    os << "enable: " << (_enable ? "Y" : "N") << ", sparse ratio: " << _sparseRatio << "%, trigger ratio: " << _triggerRatio << "%" << endl
+       << "last frag ratio: " << _lastFragRatio << "%, passes: " << _passCount << ", moved: " << _movedCount << endl
+       << "free pages: " << iFreePageNum << " (" << iFreePageNum * kPageSize << " bytes)" << endl
+       << "class\tsize\tspans\tpages\tobjects\tused\tused%\tsparse\tfree bytes" << endl;
+
+    for (size_t i = 0; i < vtStat.size(); ++i)
+    {
+        const TC_Page::tagSizeClassStat &stat = vtStat[i];
+        if (stat._iSpanNum == 0)
+        {
+            continue;
+        }
+
+        os << i << "\t" << stat._iObjectSize << "\t" << stat._iSpanNum << "\t" << stat._iPageNum << "\t" << stat._iObjectNum
+           << "\t" << stat._iUsedObjectNum << "\t" << stat._iUsedObjectNum * 100 / stat._iObjectNum << "\t" << stat._iSparseSpanNum
+           << "\t" << (stat._iObjectNum - stat._iUsedObjectNum) * stat._iObjectSize << endl;
+    }
+
+    return os.str();
+}
@@ -0,0 +1,122 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _DEFRAGTHREAD_H_
+#define _DEFRAGTHREAD_H_
+
+#include <iostream>
+#include "servant/Application.h"
+#include "CacheGlobe.h"
+
+/**
+ * 内存碎片整理线程类
+ * 数据大小变化后空闲内存会滞留在原来的尺寸类别中，其他类别无法使用。
+ * 碎片率超过阈值时逐个hash桶把稀疏span上的内存块搬到同类别更满的span上，
+ * span被搬空后归还到页堆供其他类别使用
+ */
+class DefragThread
+{
+public:
+    DefragThread() : _isStart(false), _isRuning(false), _enable(false), _sparseRatio(30), _triggerRatio(20), _checkInterval(300), _defragSpeed(10000), _lastFragRatio(0), _movedCount(0), _passCount(0) {}
+    ~DefragThread() {}
+
+    /*
+    *线程run
+    */
+    static void* Run(void* arg);
+
+    /*
+    *初始化
+    */
+    void init(const string &sConf);
+
+    /*
+    *重载配置
+    */
+    void reload();
+
+    /*
+    *生成线程
+    */
+    void createThread();
+
+    /*
+    *碎片整理状态和各尺寸类别的内存使用情况，用于admin命令
+    */
+    string status();
+
+    void setStart(bool bStart) {
+        _isStart = bStart;
+    }
+
+    /*
+    *停止线程
+    */
+    void stop() {
+        _isStart = false;
+    }
+
+    bool isStart() {
+        return _isStart;
+    }
+
+    bool isRuning() {
+        return _isRuning;
+    }
+
+    void setRuning(bool bRuning) {
+        _isRuning = bRuning;
+    }
+
+protected:
+    /*
+    *读取配置
+    */
+    void loadConf();
+
+    /*
+    *碎片率，已划分给各尺寸类别但未分配出去的内存占数据内存的百分比
+    */
+    size_t getFragRatio();
+
+    /*
+    *遍历所有hash桶整理一遍
+    */
+    void defrag();
+
+protected:
+    //线程启动停止标志
+    bool _isStart;
+    //线程当前状态
+    bool _isRuning;
+    TC_Config _tcConf;
+    string _config;
+    //是否开启碎片整理
+    bool _enable;
+    //span的使用率(百分比)低于该值时搬迁其上的内存块
+    uint32_t _sparseRatio;
+    //碎片率(百分比)达到该值时开始整理
+    size_t _triggerRatio;
+    //检查碎片率的时间间隔(秒)
+    int _checkInterval;
+    //每秒最多搬迁的内存块个数，0表示不限制
+    size_t _defragSpeed;
+    //最近一次检查的碎片率
+    size_t _lastFragRatio;
+    //累计搬迁的内存块个数
+    size_t _movedCount;
+    //累计整理的遍数
+    size_t _passCount;
+};
+
+#endif
@@ -0,0 +1,415 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <string.h>
+#include <sstream>
+#include "LatencyStat.h"
+#include "jmem_hashmap_malloc/dcache_sem_mutex.h"
+
+// 单个请求最大记录10s
+#define LATENCY_MAX_US 10000000
+
+__thread LatencyStat::ThreadSlot *LatencyStat::_threadSlot = NULL;
+
+__thread OpTrace *OpTrace::_current = NULL;
+
+static const char *g_opNames[LOP_COUNT] =
+{
+    "getKV", "getKVBatch", "checkKey", "setKV", "setKVBatch", "insertKV",
+    "updateKV", "updateKVBatch", "eraseKV", "eraseKVBatch", "delKV", "delKVBatch"
+};
+
+static const char *g_phaseNames[LPH_COUNT] =
+{
+    "total", "lock", "lookup", "binlog", "db", "other"
+};
+
+LatencyStat::HistTable::HistTable()
+{
+    memset(hist, 0, sizeof(hist));
+}
+
+LatencyStat::HistTable::~HistTable()
+{
+    for (int i = 0; i < LOP_COUNT; ++i)
+    {
+        for (int j = 0; j < LPH_COUNT; ++j)
+        {
+            delete hist[i][j];
+        }
+    }
+}
+
+LatencyHistogram *LatencyStat::HistTable::get(int op, int phase)
+{
+    if (hist[op][phase] == NULL)
+    {
+        hist[op][phase] = new LatencyHistogram(LATENCY_MAX_US);
+    }
+    return hist[op][phase];
+}
+
+void LatencyStat::HistTable::merge(const HistTable &other)
+{
+    for (int i = 0; i < LOP_COUNT; ++i)
+    {
+        for (int j = 0; j < LPH_COUNT; ++j)
+        {
+            if (other.hist[i][j] != NULL && other.hist[i][j]->count() > 0)
+            {
+                get(i, j)->merge(*other.hist[i][j]);
+            }
+        }
+    }
+}
+
+void LatencyStat::HistTable::reset()
+{
+    for (int i = 0; i < LOP_COUNT; ++i)
+    {
+        for (int j = 0; j < LPH_COUNT; ++j)
+        {
+            if (hist[i][j] != NULL)
+            {
+                hist[i][j]->reset();
+            }
+        }
+    }
+}
+
+LatencyStat::LatencyStat()
+    : _enable(true), _slowThreshold(50000), _slowSampleRate(1), _slowLogSize(200)
+{
+}
+
+LatencyStat::~LatencyStat()
+{
+    for (size_t i = 0; i < _slots.size(); ++i)
+    {
+        delete _slots[i];
+    }
+}
+
+void LatencyStat::init(const TC_Config &conf)
+{
+    string sEnable = conf.get("/Main/Latency<Enable>", "Y");
+    _enable = (sEnable == "Y" || sEnable == "y");
+
+    _slowThreshold = TC_Common::strto<uint64_t>(conf.get("/Main/Latency<SlowThreshold>", "50")) * 1000;
+
+    _slowSampleRate = TC_Common::strto<uint32_t>(conf.get("/Main/Latency<SlowSampleRate>", "1"));
+    if (_slowSampleRate == 0)
+    {
+        _slowSampleRate = 1;
+    }
+
+    size_t iSlowLogSize = TC_Common::strto<size_t>(conf.get("/Main/Latency<SlowLogSize>", "200"));
+    {
+        TC_LockT<TC_ThreadMutex> lock(_slowMutex);
+        _slowLogSize = iSlowLogSize;
+        while (_slowRecords.size() > _slowLogSize)
+        {
+            _slowRecords.pop_front();
+        }
+    }
+
+    TLOGDEBUG("LatencyStat::init enable:" << _enable << "|slowThreshold(us):" << _slowThreshold
+              << "|slowSampleRate:" << _slowSampleRate << "|slowLogSize:" << _slowLogSize << endl);
+}
+
+LatencyStat::ThreadSlot *LatencyStat::getSlot()
+{
+    if (_threadSlot == NULL)
+    {
+        ThreadSlot *slot = new ThreadSlot();
+        slot->slowSeq = 0;
+
+        TC_LockT<TC_ThreadMutex> lock(_slotMutex);
+        _slots.push_back(slot);
+        _threadSlot = slot;
+    }
+    return _threadSlot;
+}
+
+void LatencyStat::record(LatencyOp op, const uint64_t phase[LPH_COUNT], const string &key)
+{
+    ThreadSlot *slot = getSlot();
+    {
+        TC_LockT<TC_ThreadMutex> lock(slot->mutex);
+        for (int i = 0; i < LPH_COUNT; ++i)
+        {
+            // 总耗时总是记录，其余阶段没有经过时不记录
+            if (i == LPH_TOTAL || phase[i] > 0)
+            {
+                slot->table.get(op, i)->record(phase[i]);
+            }
+        }
+    }
+
+    if (_slowThreshold > 0 && phase[LPH_TOTAL] >= _slowThreshold)
+    {
+        recordSlow(slot, op, phase, key);
+    }
+}
+
+void LatencyStat::recordDb(LatencyOp op, uint64_t us, const string &key)
+{
+    ThreadSlot *slot = getSlot();
+    {
+        TC_LockT<TC_ThreadMutex> lock(slot->mutex);
+        slot->table.get(op, LPH_DB)->record(us);
+    }
+
+    if (_slowThreshold > 0 && us >= _slowThreshold)
+    {
+        uint64_t phase[LPH_COUNT] = { 0 };
+        phase[LPH_DB] = us;
+        recordSlow(slot, op, phase, key);
+    }
+}
+
+void LatencyStat::recordSlow(ThreadSlot *slot, int op, const uint64_t phase[LPH_COUNT], const string &key)
+{
+    // 采样计数只在本线程使用，无需加锁
+    if ((slot->slowSeq++ % _slowSampleRate) != 0)
+    {
+        return;
+    }
+
+    SlowRecord rec;
+    rec.time = TNOW;
+    rec.op = op;
+    rec.key = key;
+    memcpy(rec.phase, phase, sizeof(rec.phase));
+
+    ostringstream os;
+    os << opName(op) << "|" << key;
+    for (int i = 0; i < LPH_COUNT; ++i)
+    {
+        os << "|" << phaseName(i) << "=" << phase[i];
+    }
+    FDLOG("slowrequest") << os.str() << endl;
+
+    TC_LockT<TC_ThreadMutex> lock(_slowMutex);
+    if (_slowLogSize == 0)
+    {
+        return;
+    }
+    while (_slowRecords.size() >= _slowLogSize)
+    {
+        _slowRecords.pop_front();
+    }
+    _slowRecords.push_back(rec);
+}
+
+void LatencyStat::collect(HistTable &table, bool bDrain)
+{
+    vector<ThreadSlot*> vtSlot;
+    {
+        TC_LockT<TC_ThreadMutex> lock(_slotMutex);
+        vtSlot = _slots;
+    }
+
+    for (size_t i = 0; i < vtSlot.size(); ++i)
+    {
+        TC_LockT<TC_ThreadMutex> lock(vtSlot[i]->mutex);
+        table.merge(vtSlot[i]->table);
+        if (bDrain)
+        {
+            vtSlot[i]->table.reset();
+        }
+    }
+}
+
+void LatencyStat::reportProperty(const string &name, uint64_t value)
+{
+    map<string, PropertyReportPtr>::iterator it = _properties.find(name);
+    if (it == _properties.end())
+    {
+        PropertyReportPtr srp = Application::getCommunicator()->getStatReport()->createPropertyReport(name, PropertyReport::avg());
+        if (!srp)
+        {
+            TLOGERROR("LatencyStat::reportProperty createPropertyReport error, name:" << name << endl);
+            return;
+        }
+        it = _properties.insert(make_pair(name, srp)).first;
+    }
+    it->second->report(int(value));
+}
+
+void LatencyStat::report()
+{
+    HistTable interval;
+    collect(interval, true);
+
+    {
+        TC_LockT<TC_ThreadMutex> lock(_totalMutex);
+        _total.merge(interval);
+    }
+
+    // 只上报本周期有请求的接口，属性在第一次上报时创建
+    for (int i = 0; i < LOP_COUNT; ++i)
+    {
+        LatencyHistogram *pTotal = interval.hist[i][LPH_TOTAL];
+        if (pTotal != NULL && pTotal->count() > 0)
+        {
+            string sPrefix = string("Latency_") + opName(i) + "_";
+            reportProperty(sPrefix + "p50", pTotal->percentile(50));
+            reportProperty(sPrefix + "p99", pTotal->percentile(99));
+            reportProperty(sPrefix + "p999", pTotal->percentile(99.9));
+            reportProperty(sPrefix + "max", pTotal->max());
+        }
+
+        for (int j = LPH_LOCK; j < LPH_COUNT; ++j)
+        {
+            LatencyHistogram *pPhase = interval.hist[i][j];
+            if (pPhase != NULL && pPhase->count() > 0)
+            {
+                reportProperty(string("Latency_") + opName(i) + "_" + phaseName(j) + "_p99", pPhase->percentile(99));
+            }
+        }
+    }
+}
+
+string LatencyStat::showHist(const HistTable &table, bool bPhase)
+{
+    ostringstream os;
+    os << "latency(us) since start or last reset:" << endl;
+    for (int i = 0; i < LOP_COUNT; ++i)
+    {
+        for (int j = LPH_TOTAL; j < (bPhase ? LPH_COUNT : LPH_TOTAL + 1); ++j)
+        {
+            const LatencyHistogram *pHist = table.hist[i][j];
+            if (pHist != NULL && pHist->count() > 0)
+            {
+                os << opName(i) << "." << phaseName(j) << "|" << pHist->summary() << endl;
+            }
+        }
+    }
+    return os.str();
+}
+
+string LatencyStat::showSlow()
+{
+    ostringstream os;
+    os << "slow requests, threshold(us):" << _slowThreshold << ", sample rate: 1/" << _slowSampleRate << endl;
+
+    TC_LockT<TC_ThreadMutex> lock(_slowMutex);
+    for (size_t i = 0; i < _slowRecords.size(); ++i)
+    {
+        const SlowRecord &rec = _slowRecords[i];
+        os << TC_Common::tm2str(rec.time) << "|" << opName(rec.op) << "|" << rec.key;
+        for (int j = 0; j < LPH_COUNT; ++j)
+        {
+            os << "|" << phaseName(j) << "=" << rec.phase[j];
+        }
+        os << endl;
+    }
+    return os.str();
+}
+
+void LatencyStat::reset()
+{
+    vector<ThreadSlot*> vtSlot;
+    {
+        TC_LockT<TC_ThreadMutex> lock(_slotMutex);
+        vtSlot = _slots;
+    }
+    for (size_t i = 0; i < vtSlot.size(); ++i)
+    {
+        TC_LockT<TC_ThreadMutex> lock(vtSlot[i]->mutex);
+        vtSlot[i]->table.reset();
+    }
+
+    {
+        TC_LockT<TC_ThreadMutex> lock(_totalMutex);
+        _total.reset();
+    }
+
+    TC_LockT<TC_ThreadMutex> lock(_slowMutex);
+    _slowRecords.clear();
+}
+
+string LatencyStat::command(const string &params)
+{
+    string sParam = TC_Common::trim(params);
+    if (sParam == "slow")
+    {
+        return showSlow();
+    }
+    else if (sParam == "reset")
+    {
+        reset();
+        return "latency statistics reset";
+    }
+    else if (sParam != "" && sParam != "phase")
+    {
+        return "usage: latency [phase|slow|reset]";
+    }
+
+    if (!_enable)
+    {
+        return "latency statistics disabled, set /Main/Latency<Enable> to Y";
+    }
+
+    // 累计数据加上还未汇总的各线程数据
+    HistTable table;
+    {
+        TC_LockT<TC_ThreadMutex> lock(_totalMutex);
+        table.merge(_total);
+    }
+    collect(table, false);
+
+    return showHist(table, sParam == "phase");
+}
+
+const char *LatencyStat::opName(int op)
+{
+    return (op >= 0 && op < LOP_COUNT) ? g_opNames[op] : "unknown";
+}
+
+const char *LatencyStat::phaseName(int phase)
+{
+    return (phase >= 0 && phase < LPH_COUNT) ? g_phaseNames[phase] : "unknown";
+}
+
+OpTrace::OpTrace(LatencyOp op, const string &key) : _op(op), _key(key), _active(false), _begin(0)
+{
+    if (_current != NULL || !LatencyStat::getInstance()->isEnable())
+    {
+        return;
+    }
+
+    memset(_phase, 0, sizeof(_phase));
+    _active = true;
+    _current = this;
+    DCache::DCache_SemMutex::setTimeCounter(&_phase[LPH_LOCK], &_phase[LPH_LOOKUP]);
+    _begin = LatencyStat::nowUs();
+}
+
+OpTrace::~OpTrace()
+{
+    if (!_active)
+    {
+        return;
+    }
+
+    _phase[LPH_TOTAL] = LatencyStat::nowUs() - _begin;
+    DCache::DCache_SemMutex::setTimeCounter(NULL, NULL);
+    _current = NULL;
+
+    uint64_t iKnown = _phase[LPH_LOCK] + _phase[LPH_LOOKUP] + _phase[LPH_BINLOG];
+    _phase[LPH_OTHER] = _phase[LPH_TOTAL] > iKnown ? _phase[LPH_TOTAL] - iKnown : 0;
+
+    LatencyStat::getInstance()->record(_op, _phase, _key);
+}
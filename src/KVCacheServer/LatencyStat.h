@@ -0,0 +1,249 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _LATENCY_STAT_H_
+#define _LATENCY_STAT_H_
+
+#include <time.h>
+#include <deque>
+#include "servant/Application.h"
+#include "util/tc_config.h"
+#include "util/tc_singleton.h"
+#include "util/tc_thread_mutex.h"
+#include "LatencyHistogram.h"
+
+using namespace tars;
+using namespace std;
+
+/**
+ * 统计延时的接口
+ */
+enum LatencyOp
+{
+    LOP_GET_KV = 0,
+    LOP_GET_KV_BATCH,
+    LOP_CHECK_KEY,
+    LOP_SET_KV,
+    LOP_SET_KV_BATCH,
+    LOP_INSERT_KV,
+    LOP_UPDATE_KV,
+    LOP_UPDATE_KV_BATCH,
+    LOP_ERASE_KV,
+    LOP_ERASE_KV_BATCH,
+    LOP_DEL_KV,
+    LOP_DEL_KV_BATCH,
+    LOP_COUNT
+};
+
+/**
+ * 请求内的阶段
+ * LPH_TOTAL: 接口总耗时(不含异步访问DB)
+ * LPH_LOCK: 等待jmem信号量锁
+ * LPH_LOOKUP: 持有jmem锁的时间，即在hashmap中查找、拷贝或写入数据，由DCache_SemMutex统计
+ * LPH_BINLOG: 写binlog文件(含binlog文件锁)
+ * LPH_DB: 异步访问DbAccess，从发起请求到回调
+ * LPH_OTHER: 其余耗时，如参数、路由检查和组包
+ */
+enum LatencyPhase
+{
+    LPH_TOTAL = 0,
+    LPH_LOCK,
+    LPH_LOOKUP,
+    LPH_BINLOG,
+    LPH_DB,
+    LPH_OTHER,
+    LPH_COUNT
+};
+
+/**
+ * CacheServer接口延时统计。
+ * 每个线程各自一份直方图，只在本线程写入，统计线程汇总时才加锁，热路径上的锁不会有竞争；
+ * TimerThread每分钟汇总一次并上报PropertyServer，admin命令"latency"查看累计结果和慢请求。
+ * 慢请求按SlowSampleRate采样，保存最近SlowLogSize条各阶段耗时
+ */
+class LatencyStat : public TC_Singleton<LatencyStat>
+{
+public:
+    LatencyStat();
+
+    ~LatencyStat();
+
+    /**
+     * 读取/Main/Latency配置，初始化和reload时调用
+     */
+    void init(const TC_Config &conf);
+
+    bool isEnable() const { return _enable; }
+
+    /**
+     * 记录一次请求，phase为各阶段耗时(微秒)
+     */
+    void record(LatencyOp op, const uint64_t phase[LPH_COUNT], const string &key);
+
+    /**
+     * 记录一次异步访问DB的耗时(微秒)
+     */
+    void recordDb(LatencyOp op, uint64_t us, const string &key);
+
+    /**
+     * 汇总各线程数据并上报PropertyServer，由TimerThread每分钟调用
+     */
+    void report();
+
+    /**
+     * admin命令"latency"
+     *   params: 空显示各接口总耗时；"phase"显示各阶段耗时；"slow"显示最近的慢请求；"reset"清空统计
+     */
+    string command(const string &params);
+
+    static const char *opName(int op);
+
+    static const char *phaseName(int phase);
+
+    /**
+     * 单调时钟，微秒
+     */
+    static uint64_t nowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
+
+protected:
+    /**
+     * 按(接口, 阶段)存放的直方图，用到时才分配
+     */
+    struct HistTable
+    {
+        HistTable();
+        ~HistTable();
+
+        LatencyHistogram *get(int op, int phase);
+        void merge(const HistTable &other);
+        void reset();
+
+        LatencyHistogram *hist[LOP_COUNT][LPH_COUNT];
+    };
+
+    struct ThreadSlot
+    {
+        TC_ThreadMutex mutex;
+        HistTable table;
+        uint32_t slowSeq;
+    };
+
+    struct SlowRecord
+    {
+        time_t time;
+        int op;
+        string key;
+        uint64_t phase[LPH_COUNT];
+    };
+
+    ThreadSlot *getSlot();
+
+    // 汇总各线程数据到table，bDrain为true时清空各线程数据
+    void collect(HistTable &table, bool bDrain);
+
+    void recordSlow(ThreadSlot *slot, int op, const uint64_t phase[LPH_COUNT], const string &key);
+
+    void reportProperty(const string &name, uint64_t value);
+
+    string showHist(const HistTable &table, bool bPhase);
+
+    string showSlow();
+
+    void reset();
+
+protected:
+    bool _enable;
+
+    // 慢请求阈值(微秒)，为0时不记录慢请求
+    uint64_t _slowThreshold;
+
+    // 慢请求采样率，每N条记录1条
+    uint32_t _slowSampleRate;
+
+    // 保存的慢请求条数
+    size_t _slowLogSize;
+
+    TC_ThreadMutex _slotMutex;
+    vector<ThreadSlot*> _slots;
+
+    // report时从各线程汇总的累计数据
+    TC_ThreadMutex _totalMutex;
+    HistTable _total;
+
+    TC_ThreadMutex _slowMutex;
+    deque<SlowRecord> _slowRecords;
+
+    map<string, PropertyReportPtr> _properties;
+
+    static __thread ThreadSlot *_threadSlot;
+};
+
+/**
+ * 一次请求的计时，在接口入口处构造，析构时记录。
+ * 同一线程上已有计时对象时(接口内部互相调用)不重复统计；key须在对象生命周期内有效
+ */
+class OpTrace
+{
+public:
+    OpTrace(LatencyOp op, const string &key);
+
+    ~OpTrace();
+
+    void addPhase(LatencyPhase phase, uint64_t us) { _phase[phase] += us; }
+
+    /**
+     * 当前线程上正在计时的请求，没有时返回NULL
+     */
+    static OpTrace *current() { return _current; }
+
+private:
+    LatencyOp _op;
+    const string &_key;
+    bool _active;
+    uint64_t _begin;
+    uint64_t _phase[LPH_COUNT];
+
+    static __thread OpTrace *_current;
+};
+
+/**
+ * 对当前请求的某个阶段计时，当前线程上没有OpTrace时什么都不做
+ */
+class PhaseTimer
+{
+public:
+    explicit PhaseTimer(LatencyPhase phase) : _phase(phase), _trace(OpTrace::current())
+    {
+        _begin = _trace ? LatencyStat::nowUs() : 0;
+    }
+
+    ~PhaseTimer()
+    {
+        if (_trace)
+        {
+            _trace->addPhase(_phase, LatencyStat::nowUs() - _begin);
+        }
+    }
+
+private:
+    LatencyPhase _phase;
+    OpTrace *_trace;
+    uint64_t _begin;
+};
+
+#endif
@@ -0,0 +1,283 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <string.h>
+#include "FastHash.h"
+#include "NegativeCache.h"
+
+// 与选jmem的hash使用不同的seed，避免同一jmem的key集中在少数桶
+#define NEGATIVE_HASH_SEED 0x9E3779B97F4A7C15ULL
+
+NegativeCache::NegativeCache()
+    : _enable(false), _shardNum(0), _shards(NULL), _capacity(0), _ageSecond(600), _verifyRate(1000),
+      _checkCount(0), _hitCount(0), _verifyCount(0), _addCount(0), _wrongCount(0)
+{
+    memset(&_lastStat, 0, sizeof(_lastStat));
+}
+
+NegativeCache::~NegativeCache()
+{
+    delete[] _shards;
+}
+
+void NegativeCache::init(const TC_Config &conf)
+{
+    string sEnable = conf.get("/Main/NegativeFilter<Enable>", "N");
+    bool bEnable = (sEnable == "Y" || sEnable == "y");
+
+    size_t iCapacity = TC_Common::strto<size_t>(conf.get("/Main/NegativeFilter<Capacity>", "1000000"));
+    if (iCapacity == 0)
+    {
+        iCapacity = 1000000;
+    }
+
+    _ageSecond = TC_Common::strto<uint32_t>(conf.get("/Main/NegativeFilter<AgeSecond>", "600"));
+    _verifyRate = TC_Common::strto<uint32_t>(conf.get("/Main/NegativeFilter<VerifyRate>", "1000"));
+
+    if (_shards == NULL)
+    {
+        _shardNum = TC_Common::strto<size_t>(conf.get("/Main/NegativeFilter<ShardNum>", "16"));
+        if (_shardNum == 0)
+        {
+            _shardNum = 1;
+        }
+        _shards = new Shard[_shardNum];
+    }
+
+    if (bEnable)
+    {
+        //关闭期间的写入没有通知过滤器，重新开启时要清空
+        if (!_enable || iCapacity != _capacity)
+        {
+            size_t iShardCapacity = (iCapacity + _shardNum - 1) / _shardNum;
+            for (size_t i = 0; i < _shardNum; ++i)
+            {
+                TC_LockT<TC_ThreadMutex> lock(_shards[i].mutex);
+                _shards[i].filter.init(iShardCapacity);
+                _shards[i].rotateTime = TNOW;
+            }
+            _capacity = iCapacity;
+        }
+        _enable = true;
+    }
+    else if (_enable)
+    {
+        _enable = false;
+
+        //释放过滤器的内存
+        for (size_t i = 0; i < _shardNum; ++i)
+        {
+            TC_LockT<TC_ThreadMutex> lock(_shards[i].mutex);
+            _shards[i].filter.init(0);
+        }
+        _capacity = 0;
+    }
+
+    TLOGDEBUG("NegativeCache::init enable:" << _enable << "|shardNum:" << _shardNum << "|capacity:" << _capacity
+              << "|ageSecond:" << _ageSecond << "|verifyRate:" << _verifyRate << endl);
+}
+
+uint64_t NegativeCache::hash(const string &k)
+{
+    return FastHash::hash64(k.c_str(), k.length(), NEGATIVE_HASH_SEED);
+}
+
+void NegativeCache::tryRotate(Shard &shard, time_t tNow)
+{
+    uint32_t iAgeSecond = _ageSecond;
+    if (iAgeSecond > 0 && tNow - shard.rotateTime >= (time_t)iAgeSecond)
+    {
+        shard.filter.rotate();
+        shard.rotateTime = tNow;
+    }
+}
+
+bool NegativeCache::check(const string &k)
+{
+    if (!_enable)
+    {
+        return false;
+    }
+
+    ++_checkCount;
+
+    uint64_t h = hash(k);
+    Shard &shard = getShard(h);
+    {
+        TC_LockT<TC_ThreadMutex> lock(shard.mutex);
+        tryRotate(shard, TNOW);
+        if (!shard.filter.contains(h))
+        {
+            return false;
+        }
+    }
+
+    uint64_t iHit = ++_hitCount;
+    uint32_t iVerifyRate = _verifyRate;
+    if (iVerifyRate > 0 && iHit % iVerifyRate == 0)
+    {
+        ++_verifyCount;
+        return false;
+    }
+    return true;
+}
+
+void NegativeCache::add(const string &k)
+{
+    if (!_enable)
+    {
+        return;
+    }
+
+    ++_addCount;
+
+    uint64_t h = hash(k);
+    Shard &shard = getShard(h);
+
+    TC_LockT<TC_ThreadMutex> lock(shard.mutex);
+    tryRotate(shard, TNOW);
+    if (!shard.filter.add(h))
+    {
+        TLOGDEBUG("NegativeCache::add shard full, rotate, size:" << shard.filter.size() << endl);
+        shard.rotateTime = TNOW;
+    }
+}
+
+bool NegativeCache::erase(const string &k)
+{
+    uint64_t h = hash(k);
+    Shard &shard = getShard(h);
+
+    TC_LockT<TC_ThreadMutex> lock(shard.mutex);
+    return shard.filter.erase(h);
+}
+
+void NegativeCache::onWrite(const string &k)
+{
+    if (_enable)
+    {
+        erase(k);
+    }
+}
+
+void NegativeCache::onDbData(const string &k)
+{
+    if (_enable && erase(k))
+    {
+        ++_wrongCount;
+        TLOGDEBUG("NegativeCache::onDbData key in filter but exist in db, key = " << k << endl);
+    }
+}
+
+void NegativeCache::clear()
+{
+    for (size_t i = 0; i < _shardNum; ++i)
+    {
+        TC_LockT<TC_ThreadMutex> lock(_shards[i].mutex);
+        _shards[i].filter.clear();
+    }
+}
+
+void NegativeCache::getStat(Stat &stat) const
+{
+    stat.checkCount = _checkCount.load();
+    stat.hitCount = _hitCount.load();
+    stat.verifyCount = _verifyCount.load();
+    stat.addCount = _addCount.load();
+    stat.wrongCount = _wrongCount.load();
+}
+
+void NegativeCache::getFilterStat(size_t &iSize, size_t &iMemSize, double &dFpp)
+{
+    iSize = 0;
+    iMemSize = 0;
+    dFpp = 0;
+    for (size_t i = 0; i < _shardNum; ++i)
+    {
+        TC_LockT<TC_ThreadMutex> lock(_shards[i].mutex);
+        iSize += _shards[i].filter.size();
+        iMemSize += _shards[i].filter.memSize();
+        dFpp += _shards[i].filter.fpp();
+    }
+    if (_shardNum > 0)
+    {
+        dFpp /= _shardNum;
+    }
+}
+
+void NegativeCache::reportProperty(const string &name, uint64_t value)
+{
+    map<string, PropertyReportPtr>::iterator it = _properties.find(name);
+    if (it == _properties.end())
+    {
+        PropertyReportPtr srp = Application::getCommunicator()->getStatReport()->createPropertyReport(name, PropertyReport::avg());
+        if (!srp)
+        {
+            TLOGERROR("NegativeCache::reportProperty createPropertyReport error, name:" << name << endl);
+            return;
+        }
+        it = _properties.insert(make_pair(name, srp)).first;
+    }
+    it->second->report(int(value));
+}
+
+void NegativeCache::report()
+{
+    Stat stat;
+    getStat(stat);
+
+    if (_enable)
+    {
+        size_t iSize, iMemSize;
+        double dFpp;
+        getFilterStat(iSize, iMemSize, dFpp);
+
+        uint64_t iHit = stat.hitCount - _lastStat.hitCount;
+        uint64_t iVerify = stat.verifyCount - _lastStat.verifyCount;
+
+        //不查DB直接返回的次数
+        reportProperty("NegativeFilterHit", iHit - iVerify);
+        reportProperty("NegativeFilterKeys", iSize);
+        //按装载率估算的误判率和抽样校验得到的误判率，单位为百万分之一
+        reportProperty("NegativeFilterFPRate_ppm", uint64_t(dFpp * 1000000));
+        if (iVerify > 0)
+        {
+            reportProperty("NegativeFilterWrongRate_ppm", (stat.wrongCount - _lastStat.wrongCount) * 1000000 / iVerify);
+        }
+    }
+
+    _lastStat = stat;
+}
+
+string NegativeCache::status()
+{
+    Stat stat;
+    getStat(stat);
+
+    size_t iSize, iMemSize;
+    double dFpp;
+    getFilterStat(iSize, iMemSize, dFpp);
+
+    ostringstream os;
+    os << "enable: " << (_enable ? "Y" : "N") << ", shards: " << _shardNum << ", capacity: " << _capacity
+       << ", age second: " << _ageSecond << ", verify rate: " << _verifyRate << endl
+       << "keys: " << iSize << ", mem bytes: " << iMemSize << ", estimated fpp: " << dFpp << endl
+       << "checked: " << stat.checkCount << ", hit: " << stat.hitCount << ", verified: " << stat.verifyCount
+       << ", wrong: " << stat.wrongCount << ", added: " << stat.addCount;
+    if (stat.verifyCount > 0)
+    {
+        os << ", wrong rate: " << double(stat.wrongCount) / stat.verifyCount;
+    }
+    os << endl;
+    return os.str();
+}
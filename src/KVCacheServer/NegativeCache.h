@@ -0,0 +1,147 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _NEGATIVE_CACHE_H_
+#define _NEGATIVE_CACHE_H_
+
+#include <atomic>
+#include "servant/Application.h"
+#include "util/tc_config.h"
+#include "util/tc_singleton.h"
+#include "util/tc_thread_mutex.h"
+#include "jmem_hashmap_malloc/dcache_jmem_hashmap_malloc.h"
+#include "CuckooFilter.h"
+
+using namespace tars;
+using namespace std;
+using namespace DCache;
+
+/**
+ * DB中不存在的key的过滤器，开启后代替OnlyKey数据防止穿透DB。
+ * OnlyKey每个key要占用一个完整的数据块并参与淘汰，过滤器每个key只占几个字节。
+ * key按hash分到多个分片，每个分片一个分代的cuckoo filter和一把锁；
+ * 超过AgeSecond或写满时切换一代，key最多保留两代的时间，DB中后来写入的数据最迟这时可以读到。
+ * 只在cache中没有数据时查询过滤器，误判不会掩盖cache中的数据，只会把DB中存在的key当作不存在；
+ * 按VerifyRate抽样放过命中的请求去查DB，统计实际的误判率。
+ * 过滤器在进程内存中，不写binlog，重启或主备切换后重新积累
+ */
+class NegativeCache : public TC_Singleton<NegativeCache>, public AbsentKeyFilter
+{
+public:
+    NegativeCache();
+
+    ~NegativeCache();
+
+    /**
+     * 读取/Main/NegativeFilter配置，初始化和reload时调用
+     */
+    void init(const TC_Config &conf);
+
+    bool isEnable() const { return _enable; }
+
+    /**
+     * cache中没有数据时调用，判断key是否已知在DB中不存在
+     * @return bool, true表示不存在，不需要查DB；抽样校验的请求返回false
+     */
+    bool check(const string &k);
+
+    /**
+     * DB中查不到key时调用
+     */
+    void add(const string &k);
+
+    /**
+     * key写入cache后删除，由hashmap调用
+     */
+    virtual void onWrite(const string &k);
+
+    /**
+     * DB中查到key时调用，key在过滤器中说明误判或者已过时
+     */
+    void onDbData(const string &k);
+
+    void clear();
+
+    /**
+     * 上报命中数和误判率，由TimerThread每分钟调用
+     */
+    void report();
+
+    /**
+     * admin命令"negfilter"显示的统计
+     */
+    string status();
+
+protected:
+    struct Shard
+    {
+        TC_ThreadMutex mutex;
+        CuckooFilter filter;
+        time_t rotateTime;
+    };
+
+    struct Stat
+    {
+        uint64_t checkCount;
+        uint64_t hitCount;
+        uint64_t verifyCount;
+        uint64_t addCount;
+        uint64_t wrongCount;
+    };
+
+    Shard &getShard(uint64_t h) { return _shards[(h >> 32) % _shardNum]; }
+
+    // 超过AgeSecond时切换一代，调用时需持有分片的锁
+    void tryRotate(Shard &shard, time_t tNow);
+
+    // 从分片中删除key，返回key是否在过滤器中
+    bool erase(const string &k);
+
+    void getStat(Stat &stat) const;
+
+    // 各分片的key个数、内存和按装载率估算的平均误判率
+    void getFilterStat(size_t &iSize, size_t &iMemSize, double &dFpp);
+
+    void reportProperty(const string &name, uint64_t value);
+
+    static uint64_t hash(const string &k);
+
+protected:
+    std::atomic<bool> _enable;
+
+    // 分片个数只在第一次初始化时读取
+    size_t _shardNum;
+    Shard *_shards;
+
+    // 总容量，平均分到各分片
+    size_t _capacity;
+
+    std::atomic<uint32_t> _ageSecond;
+
+    // 每VerifyRate次命中放过一次去查DB，0表示不校验
+    std::atomic<uint32_t> _verifyRate;
+
+    // 累计统计
+    std::atomic<uint64_t> _checkCount;
+    std::atomic<uint64_t> _hitCount;
+    std::atomic<uint64_t> _verifyCount;
+    std::atomic<uint64_t> _addCount;
+    std::atomic<uint64_t> _wrongCount;
+
+    // 上次上报时的统计，用于计算每分钟的增量
+    Stat _lastStat;
+
+    map<string, PropertyReportPtr> _properties;
+};
+
+#endif
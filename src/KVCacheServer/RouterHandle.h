@@ -30,12 +30,11 @@ public:
     }
     bool operator()(const string &k)
     {
-        if (hashCounter.HashRawString(k) == hashKey)
+        if (g_route_table.hashKey(k) == hashKey)
             return true;
         return false;
     }
 protected:
-    NormalHash hashCounter;
     unsigned int hashKey;
 };
 
@@ -191,6 +190,12 @@ private:
     */
     void updateCSyncKeyLimit();
 
+    /*
+    *拉取相对fromVersion的增量路由，并在当前路由上生成新版本的路由表
+    *返回0成功，失败时调用者需全量拉取
+    */
+    int getRouterByDelta(int fromVersion, PackTable &packTable);
+
     /*
     *Get迁移目的地址
     */
@@ -212,6 +217,7 @@ private:
     string _routeFile;
     string _routeObj;
     RouterPrx _routePrx;
+    RouterPrx _heartbeatPrx; // 上报心跳使用的proxy，Router配置了独立的心跳obj时与_routePrx不同
     //路由分页大小
     unsigned int _pageSize;
 
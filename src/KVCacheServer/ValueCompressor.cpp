@@ -0,0 +1,629 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <arpa/inet.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include "util/tc_file.h"
+#include "ValueCompressor.h"
+
+// 训练字典时按8字节片段统计出现次数，统计表按hash索引，不保存片段本身
+#define DICT_GRAM_SIZE 8
+#define DICT_GRAM_TABLE_BITS 20
+// 组成字典的片段长度
+#define DICT_SEGMENT_SIZE 32
+// zlib窗口大小，字典超过时只有最后32K有效
+#define DICT_MAX_SIZE 32768
+
+__thread ValueCompressor::ThreadStream *ValueCompressor::_threadStream = NULL;
+
+// 8字节片段在统计表中的位置
+static inline size_t gramIndex(const char *p)
+{
+    uint64_t iGram;
+    memcpy(&iGram, p, sizeof(iGram));
+    return (iGram * 0x9E3779B97F4A7C15ULL) >> (64 - DICT_GRAM_TABLE_BITS);
+}
+
+ValueCompressor::ThreadStream::ThreadStream()
+    : deflaterInit(false), inflaterInit(false), level(0)
+{
+    memset(&deflater, 0, sizeof(deflater));
+    memset(&inflater, 0, sizeof(inflater));
+}
+
+ValueCompressor::ThreadStream::~ThreadStream()
+{
+    if (deflaterInit)
+    {
+        deflateEnd(&deflater);
+    }
+    if (inflaterInit)
+    {
+        inflateEnd(&inflater);
+    }
+}
+
+ValueCompressor::ValueCompressor()
+    : _enable(false), _minSize(256), _level(1), _dictSize(8192), _activeDict(NULL), _dictNum(0),
+      _compressCount(0), _skipCount(0), _rawBytes(0), _compressBytes(0), _compressUs(0),
+      _uncompressCount(0), _uncompressUs(0), _uncompressErr(0)
+{
+    memset(&_lastStat, 0, sizeof(_lastStat));
+}
+
+ValueCompressor::~ValueCompressor()
+{
+    for (size_t i = 0; i < _streams.size(); ++i)
+    {
+        delete _streams[i];
+    }
+}
+
+void ValueCompressor::init(const TC_Config &conf)
+{
+    string sEnable = conf.get("/Main/Compress<Enable>", "N");
+
+    int iLevel = TC_Common::strto<int>(conf.get("/Main/Compress<Level>", "1"));
+    if (iLevel < 1 || iLevel > 9)
+    {
+        iLevel = 1;
+    }
+
+    size_t iDictSize = TC_Common::strto<size_t>(conf.get("/Main/Compress<DictSize>", "8192"));
+    if (iDictSize > DICT_MAX_SIZE)
+    {
+        iDictSize = DICT_MAX_SIZE;
+    }
+
+    _minSize = TC_Common::strto<size_t>(conf.get("/Main/Compress<MinSize>", "256"));
+    _level = iLevel;
+
+    {
+        TC_LockT<TC_ThreadMutex> lock(_dictMutex);
+        _dictSize = iDictSize;
+        _dictDir = conf.get("/Main/Compress<DictDir>", ServerConfig::DataPath + "dict");
+    }
+
+    //先加载字典再开启压缩，已压缩的数据无论是否开启都需要能解压
+    loadDicts();
+    _enable = (sEnable == "Y" || sEnable == "y");
+
+    const Dict *pDict = _activeDict.load();
+    TLOGDEBUG("ValueCompressor::init enable:" << _enable.load() << "|level:" << _level.load() << "|minSize:" << _minSize.load()
+              << "|dictDir:" << _dictDir << "|dictNum:" << _dictNum.load() << "|activeDict:" << (pDict == NULL ? 0 : pDict->id) << endl);
+}
+
+ValueCompressor::ThreadStream *ValueCompressor::getStream()
+{
+    if (_threadStream == NULL)
+    {
+        ThreadStream *ts = new ThreadStream();
+
+        TC_LockT<TC_ThreadMutex> lock(_streamMutex);
+        _streams.push_back(ts);
+        _threadStream = ts;
+    }
+    return _threadStream;
+}
+
+bool ValueCompressor::compress(const string &v, string &out, uint32_t &iDictId)
+{
+    if (!_enable.load() || v.size() < _minSize.load() || v.empty())
+    {
+        return false;
+    }
+
+    uint64_t iBegin = nowUs();
+
+    ThreadStream *ts = getStream();
+    z_stream &zs = ts->deflater;
+    int iLevel = _level.load();
+    if (!ts->deflaterInit || ts->level != iLevel)
+    {
+        if (ts->deflaterInit)
+        {
+            deflateEnd(&zs);
+            ts->deflaterInit = false;
+        }
+
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, iLevel, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            TLOGERROR("ValueCompressor::compress deflateInit2 error, level:" << iLevel << endl);
+            return false;
+        }
+        ts->deflaterInit = true;
+        ts->level = iLevel;
+    }
+    else
+    {
+        deflateReset(&zs);
+    }
+
+    const Dict *pDict = _activeDict.load();
+    if (pDict != NULL && deflateSetDictionary(&zs, (const Bytef *)pDict->data.data(), pDict->data.size()) != Z_OK)
+    {
+        TLOGERROR("ValueCompressor::compress deflateSetDictionary error, dict:" << pDict->id << endl);
+        return false;
+    }
+
+    //4字节原始长度 + deflate数据
+    uLong iBound = deflateBound(&zs, v.size());
+    out.resize(sizeof(uint32_t) + iBound);
+    uint32_t iRawLen = htonl(uint32_t(v.size()));
+    memcpy(&out[0], &iRawLen, sizeof(uint32_t));
+
+    zs.next_in = (Bytef *)v.data();
+    zs.avail_in = v.size();
+    zs.next_out = (Bytef *)&out[sizeof(uint32_t)];
+    zs.avail_out = iBound;
+
+    int iRet = deflate(&zs, Z_FINISH);
+    size_t iOutLen = sizeof(uint32_t) + zs.total_out;
+
+    _compressUs += nowUs() - iBegin;
+
+    //至少省下1/8才值得读取时解压，还要算上hashmap保存的字典id
+    if (iRet != Z_STREAM_END || iOutLen + sizeof(uint32_t) > v.size() - v.size() / 8)
+    {
+        ++_skipCount;
+        return false;
+    }
+
+    out.resize(iOutLen);
+    iDictId = (pDict == NULL ? 0 : pDict->id);
+
+    ++_compressCount;
+    _rawBytes += v.size();
+    _compressBytes += iOutLen;
+    return true;
+}
+
+bool ValueCompressor::uncompress(const string &in, uint32_t iDictId, string &out)
+{
+    uint64_t iBegin = nowUs();
+
+    if (in.size() <= sizeof(uint32_t))
+    {
+        ++_uncompressErr;
+        return false;
+    }
+
+    uint32_t iRawLen;
+    memcpy(&iRawLen, in.data(), sizeof(uint32_t));
+    iRawLen = ntohl(iRawLen);
+
+    //deflate的压缩率不会超过1032:1，超过说明数据已损坏
+    size_t iDataLen = in.size() - sizeof(uint32_t);
+    if (iRawLen == 0 || iRawLen > iDataLen * 1032)
+    {
+        ++_uncompressErr;
+        TLOGERROR("ValueCompressor::uncompress bad length:" << iRawLen << "|size:" << in.size() << endl);
+        return false;
+    }
+
+    const Dict *pDict = NULL;
+    if (iDictId != 0)
+    {
+        pDict = findDict(iDictId);
+        if (pDict == NULL)
+        {
+            ++_uncompressErr;
+            TLOGERROR("ValueCompressor::uncompress dict not found:" << iDictId << endl);
+            return false;
+        }
+    }
+
+    ThreadStream *ts = getStream();
+    z_stream &zs = ts->inflater;
+    if (!ts->inflaterInit)
+    {
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+        {
+            ++_uncompressErr;
+            TLOGERROR("ValueCompressor::uncompress inflateInit2 error" << endl);
+            return false;
+        }
+        ts->inflaterInit = true;
+    }
+    else
+    {
+        inflateReset(&zs);
+    }
+
+    if (pDict != NULL && inflateSetDictionary(&zs, (const Bytef *)pDict->data.data(), pDict->data.size()) != Z_OK)
+    {
+        ++_uncompressErr;
+        TLOGERROR("ValueCompressor::uncompress inflateSetDictionary error, dict:" << iDictId << endl);
+        return false;
+    }
+
+    out.resize(iRawLen);
+    zs.next_in = (Bytef *)in.data() + sizeof(uint32_t);
+    zs.avail_in = iDataLen;
+    zs.next_out = (Bytef *)&out[0];
+    zs.avail_out = iRawLen;
+
+    int iRet = inflate(&zs, Z_FINISH);
+    if (iRet != Z_STREAM_END || zs.total_out != iRawLen)
+    {
+        ++_uncompressErr;
+        TLOGERROR("ValueCompressor::uncompress inflate error:" << iRet << "|dict:" << iDictId << endl);
+        return false;
+    }
+
+    ++_uncompressCount;
+    _uncompressUs += nowUs() - iBegin;
+    return true;
+}
+
+const ValueCompressor::Dict *ValueCompressor::findDict(uint32_t iDictId) const
+{
+    size_t iNum = _dictNum.load(std::memory_order_acquire);
+    for (size_t i = 0; i < iNum; ++i)
+    {
+        if (_dicts[i].id == iDictId)
+        {
+            return &_dicts[i];
+        }
+    }
+    return NULL;
+}
+
+const ValueCompressor::Dict *ValueCompressor::addDict(const string &sDict)
+{
+    uint32_t iDictId = dictId(sDict);
+
+    TC_LockT<TC_ThreadMutex> lock(_dictMutex);
+    const Dict *pDict = findDict(iDictId);
+    if (pDict != NULL)
+    {
+        return pDict;
+    }
+
+    size_t iNum = _dictNum.load();
+    if (iNum >= MAX_DICT_NUM)
+    {
+        return NULL;
+    }
+
+    _dicts[iNum].id = iDictId;
+    _dicts[iNum].data = sDict;
+    _dictNum.store(iNum + 1, std::memory_order_release);
+    return &_dicts[iNum];
+}
+
+void ValueCompressor::loadDicts()
+{
+    string sDir;
+    {
+        TC_LockT<TC_ThreadMutex> lock(_dictMutex);
+        sDir = _dictDir;
+    }
+
+    if (!TC_File::isFileExist(sDir))
+    {
+        return;
+    }
+
+    vector<string> vtFile;
+    TC_File::listDirectory(sDir, vtFile, false);
+    for (size_t i = 0; i < vtFile.size(); ++i)
+    {
+        string sName = TC_File::extractFileName(vtFile[i]);
+        if (TC_File::extractFileExt(sName) != "dict")
+        {
+            continue;
+        }
+
+        string sDict = TC_File::load2str(vtFile[i]);
+        if (sDict.empty() || TC_Common::tostr(dictId(sDict)) + ".dict" != sName)
+        {
+            TLOGERROR("ValueCompressor::loadDicts bad dict file:" << vtFile[i] << endl);
+            continue;
+        }
+
+        if (addDict(sDict) == NULL)
+        {
+            TLOGERROR("ValueCompressor::loadDicts too many dicts, skip:" << vtFile[i] << endl);
+        }
+    }
+
+    string sActive = TC_Common::trim(TC_File::load2str(sDir + "/active"));
+    if (!sActive.empty())
+    {
+        const Dict *pDict = findDict(TC_Common::strto<uint32_t>(sActive));
+        if (pDict == NULL)
+        {
+            TLOGERROR("ValueCompressor::loadDicts active dict not found:" << sActive << endl);
+        }
+        else
+        {
+            _activeDict.store(pDict);
+        }
+    }
+}
+
+int ValueCompressor::saveDict(const Dict &dict, string &sErr)
+{
+    string sDir;
+    {
+        TC_LockT<TC_ThreadMutex> lock(_dictMutex);
+        sDir = _dictDir;
+    }
+
+    if (!TC_File::makeDirRecursive(sDir))
+    {
+        sErr = "create dir " + sDir + " error";
+        return -1;
+    }
+
+    string sFile = sDir + "/" + TC_Common::tostr(dict.id) + ".dict";
+    try
+    {
+        if (!TC_File::isFileExist(sFile))
+        {
+            TC_File::save2file(sFile + ".tmp", dict.data);
+            if (rename((sFile + ".tmp").c_str(), sFile.c_str()) != 0)
+            {
+                sErr = "rename " + sFile + " error:" + strerror(errno);
+                return -1;
+            }
+        }
+        TC_File::save2file(sDir + "/active", TC_Common::tostr(dict.id));
+    }
+    catch (exception &ex)
+    {
+        sErr = string("save dict error:") + ex.what();
+        return -1;
+    }
+
+    return 0;
+}
+
+int ValueCompressor::trainDict(const vector<string> &vtSample, uint32_t &iDictId, string &sErr)
+{
+    size_t iDictSize;
+    {
+        TC_LockT<TC_ThreadMutex> lock(_dictMutex);
+        iDictSize = _dictSize;
+    }
+
+    string sDict;
+    buildDict(vtSample, iDictSize, sDict);
+    if (sDict.empty())
+    {
+        sErr = "no repeated content in samples";
+        return -1;
+    }
+
+    const Dict *pDict = addDict(sDict);
+    if (pDict == NULL)
+    {
+        sErr = "too many dicts, remove unused dict files and restart";
+        return -1;
+    }
+
+    //字典落盘后才使用，否则重启后用它压缩的数据无法解压
+    if (saveDict(*pDict, sErr) != 0)
+    {
+        return -1;
+    }
+
+    _activeDict.store(pDict);
+    iDictId = pDict->id;
+
+    TLOGDEBUG("ValueCompressor::trainDict samples:" << vtSample.size() << "|dict:" << iDictId << "|size:" << sDict.size() << endl);
+    return 0;
+}
+
+void ValueCompressor::buildDict(const vector<string> &vtSample, size_t iDictSize, string &sDict)
+{
+    sDict.clear();
+
+    //统计每个8字节片段在所有样本中出现的次数
+    const size_t iTableSize = size_t(1) << DICT_GRAM_TABLE_BITS;
+    vector<uint16_t> vtCount(iTableSize, 0);
+    for (size_t i = 0; i < vtSample.size(); ++i)
+    {
+        const string &s = vtSample[i];
+        for (size_t j = 0; j + DICT_GRAM_SIZE <= s.size(); ++j)
+        {
+            uint16_t &iCount = vtCount[gramIndex(s.data() + j)];
+            if (iCount < 0xffff)
+            {
+                ++iCount;
+            }
+        }
+    }
+
+    //按片段中重复出现的内容给每个32字节的段打分
+    struct Segment
+    {
+        uint64_t score;
+        uint32_t sample;
+        uint32_t pos;
+
+        bool operator<(const Segment &other) const { return score > other.score; }
+    };
+
+    vector<Segment> vtSegment;
+    for (size_t i = 0; i < vtSample.size(); ++i)
+    {
+        const string &s = vtSample[i];
+        for (size_t pos = 0; pos + DICT_SEGMENT_SIZE <= s.size(); pos += DICT_SEGMENT_SIZE / 2)
+        {
+            Segment seg;
+            seg.score = 0;
+            seg.sample = i;
+            seg.pos = pos;
+            for (size_t j = pos; j + DICT_GRAM_SIZE <= pos + DICT_SEGMENT_SIZE; ++j)
+            {
+                uint16_t iCount = vtCount[gramIndex(s.data() + j)];
+                if (iCount > 1)
+                {
+                    seg.score += iCount - 1;
+                }
+            }
+            if (seg.score > 0)
+            {
+                vtSegment.push_back(seg);
+            }
+        }
+    }
+    sort(vtSegment.begin(), vtSegment.end());
+
+    //按分数从高到低选段，一半以上内容已在字典中的段跳过
+    vector<bool> vtCovered(iTableSize, false);
+    vector<const Segment *> vtPicked;
+    size_t iTotal = 0;
+    const size_t iGramNum = DICT_SEGMENT_SIZE - DICT_GRAM_SIZE + 1;
+    for (size_t i = 0; i < vtSegment.size() && iTotal + DICT_SEGMENT_SIZE <= iDictSize; ++i)
+    {
+        const string &s = vtSample[vtSegment[i].sample];
+        size_t iNew = 0;
+        for (size_t j = vtSegment[i].pos; j < vtSegment[i].pos + iGramNum; ++j)
+        {
+            if (!vtCovered[gramIndex(s.data() + j)])
+            {
+                ++iNew;
+            }
+        }
+        if (iNew * 2 < iGramNum)
+        {
+            continue;
+        }
+
+        for (size_t j = vtSegment[i].pos; j < vtSegment[i].pos + iGramNum; ++j)
+        {
+            vtCovered[gramIndex(s.data() + j)] = true;
+        }
+        vtPicked.push_back(&vtSegment[i]);
+        iTotal += DICT_SEGMENT_SIZE;
+    }
+
+    //deflate匹配距离越近编码越短，分数高的放在字典尾部
+    for (size_t i = vtPicked.size(); i > 0; --i)
+    {
+        sDict.append(vtSample[vtPicked[i - 1]->sample], vtPicked[i - 1]->pos, DICT_SEGMENT_SIZE);
+    }
+}
+
+void ValueCompressor::getStat(Stat &stat) const
+{
+    stat.compressCount = _compressCount.load();
+    stat.skipCount = _skipCount.load();
+    stat.rawBytes = _rawBytes.load();
+    stat.compressBytes = _compressBytes.load();
+    stat.compressUs = _compressUs.load();
+    stat.uncompressCount = _uncompressCount.load();
+    stat.uncompressUs = _uncompressUs.load();
+    stat.uncompressErr = _uncompressErr.load();
+}
+
+void ValueCompressor::reportProperty(const string &name, uint64_t value)
+{
+    map<string, PropertyReportPtr>::iterator it = _properties.find(name);
+    if (it == _properties.end())
+    {
+        PropertyReportPtr srp = Application::getCommunicator()->getStatReport()->createPropertyReport(name, PropertyReport::avg());
+        if (!srp)
+        {
+            TLOGERROR("ValueCompressor::reportProperty createPropertyReport error, name:" << name << endl);
+            return;
+        }
+        it = _properties.insert(make_pair(name, srp)).first;
+    }
+    it->second->report(int(value));
+}
+
+void ValueCompressor::report()
+{
+    Stat stat;
+    getStat(stat);
+
+    uint64_t iCompress = stat.compressCount - _lastStat.compressCount;
+    uint64_t iTry = iCompress + stat.skipCount - _lastStat.skipCount;
+    uint64_t iRawBytes = stat.rawBytes - _lastStat.rawBytes;
+    uint64_t iCompressBytes = stat.compressBytes - _lastStat.compressBytes;
+    uint64_t iUncompress = stat.uncompressCount - _lastStat.uncompressCount;
+
+    if (iRawBytes > 0)
+    {
+        //压缩后占原始大小的百分比，和节省的内存
+        reportProperty("CompressRatio", iCompressBytes * 100 / iRawBytes);
+        reportProperty("CompressSaved_KB", (iRawBytes - iCompressBytes) / 1024);
+    }
+    if (iTry > 0)
+    {
+        reportProperty("CompressAvgUs", (stat.compressUs - _lastStat.compressUs) / iTry);
+    }
+    if (iUncompress > 0)
+    {
+        reportProperty("UncompressAvgUs", (stat.uncompressUs - _lastStat.uncompressUs) / iUncompress);
+    }
+    if (stat.uncompressErr != _lastStat.uncompressErr)
+    {
+        reportProperty("UncompressError", stat.uncompressErr - _lastStat.uncompressErr);
+    }
+
+    _lastStat = stat;
+}
+
+string ValueCompressor::status()
+{
+    Stat stat;
+    getStat(stat);
+
+    const Dict *pDict = _activeDict.load();
+
+    ostringstream os;
+    os << "enable: " << (_enable.load() ? "Y" : "N") << ", level: " << _level.load() << ", min size: " << _minSize.load() << endl
+       << "dict dir: " << _dictDir << ", dicts: " << _dictNum.load()
+       << ", active dict: " << (pDict == NULL ? 0 : pDict->id) << " (" << (pDict == NULL ? 0 : pDict->data.size()) << " bytes)" << endl
+       << "compressed: " << stat.compressCount << ", skipped: " << stat.skipCount
+       << ", raw bytes: " << stat.rawBytes << ", compressed bytes: " << stat.compressBytes;
+    if (stat.compressBytes > 0)
+    {
+        os << ", ratio: " << double(stat.rawBytes) / stat.compressBytes;
+    }
+    os << endl;
+    if (stat.compressCount + stat.skipCount > 0)
+    {
+        os << "compress avg us: " << stat.compressUs / (stat.compressCount + stat.skipCount) << endl;
+    }
+    os << "uncompressed: " << stat.uncompressCount << ", errors: " << stat.uncompressErr;
+    if (stat.uncompressCount > 0)
+    {
+        os << ", uncompress avg us: " << stat.uncompressUs / stat.uncompressCount;
+    }
+    os << endl;
+    return os.str();
+}
+
+uint32_t ValueCompressor::dictId(const string &sDict)
+{
+    uint32_t iDictId = adler32(adler32(0, Z_NULL, 0), (const Bytef *)sDict.data(), sDict.size());
+    return iDictId == 0 ? 1 : iDictId;
+}
+
+uint64_t ValueCompressor::nowUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,179 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _VALUE_COMPRESSOR_H_
+#define _VALUE_COMPRESSOR_H_
+
+#include <zlib.h>
+#include <atomic>
+#include "servant/Application.h"
+#include "util/tc_config.h"
+#include "util/tc_singleton.h"
+#include "util/tc_thread_mutex.h"
+#include "jmem_hashmap_malloc/tc_hashmap_malloc.h"
+
+using namespace tars;
+using namespace std;
+using namespace DCache;
+
+/**
+ * CacheServer的value压缩。
+ * 用zlib的raw deflate压缩，可以使用按本模块数据训练的预置字典，对大量结构相似的小value(json/pb)压缩率提升明显。
+ * 压缩后的格式为4字节原始长度(网络字节序)+deflate数据，字典id为字典的adler32，由hashmap保存在value之后。
+ * 字典保存在DictDir目录下，文件名为字典id，启动时全部加载，保证已压缩的数据一直可以解压；
+ * 新训练的字典只用于之后写入的数据。
+ * 压缩在写入jmem加锁前进行，解压在读取jmem释放锁后进行，会被多个线程同时调用，小于MinSize的value不压缩
+ */
+class ValueCompressor : public TC_Singleton<ValueCompressor>, public TC_HashMapMalloc::ValueCodec
+{
+public:
+    ValueCompressor();
+
+    ~ValueCompressor();
+
+    /**
+     * 读取/Main/Compress配置，加载字典，初始化和reload时调用
+     */
+    void init(const TC_Config &conf);
+
+    bool isEnable() const { return _enable.load(); }
+
+    virtual bool compress(const string &v, string &out, uint32_t &iDictId);
+
+    virtual bool uncompress(const string &in, uint32_t iDictId, string &out);
+
+    /**
+     * 用采样的value训练字典，保存到DictDir并作为之后压缩使用的字典
+     * @param vtSample, 采样的value
+     * @param iDictId, 返回新字典的id
+     * @return int, 0成功
+     */
+    int trainDict(const vector<string> &vtSample, uint32_t &iDictId, string &sErr);
+
+    /**
+     * 从采样的value中选出出现最多的片段组成字典，出现越多的片段越靠近字典尾部
+     * @param iDictSize, 字典最大长度
+     */
+    static void buildDict(const vector<string> &vtSample, size_t iDictSize, string &sDict);
+
+    /**
+     * 上报压缩率和压缩、解压耗时，由TimerThread每分钟调用
+     */
+    void report();
+
+    /**
+     * admin命令"compress"显示的统计
+     */
+    string status();
+
+protected:
+    /**
+     * 每个线程一份zlib流，避免每次压缩都分配几百K的内存
+     */
+    struct ThreadStream
+    {
+        ThreadStream();
+        ~ThreadStream();
+
+        z_stream deflater;
+        z_stream inflater;
+        bool deflaterInit;
+        bool inflaterInit;
+        int level;
+    };
+
+    struct Dict
+    {
+        uint32_t id;
+        string data;
+    };
+
+    struct Stat
+    {
+        uint64_t compressCount;
+        uint64_t skipCount;
+        uint64_t rawBytes;
+        uint64_t compressBytes;
+        uint64_t compressUs;
+        uint64_t uncompressCount;
+        uint64_t uncompressUs;
+        uint64_t uncompressErr;
+    };
+
+    ThreadStream *getStream();
+
+    // 按id查找字典，字典只增加不删除，不需要加锁
+    const Dict *findDict(uint32_t iDictId) const;
+
+    // 加入字典并返回，已存在时返回已有的，字典个数达到上限返回NULL
+    const Dict *addDict(const string &sDict);
+
+    void loadDicts();
+
+    int saveDict(const Dict &dict, string &sErr);
+
+    void getStat(Stat &stat) const;
+
+    void reportProperty(const string &name, uint64_t value);
+
+    // 字典id为字典内容的adler32，保留0表示没有字典
+    static uint32_t dictId(const string &sDict);
+
+    static uint64_t nowUs();
+
+protected:
+    static const size_t MAX_DICT_NUM = 64;
+
+    // 压缩不在jmem锁内，reload时会被并发读取
+    std::atomic<bool> _enable;
+
+    // 小于该长度的value不压缩
+    std::atomic<size_t> _minSize;
+
+    // zlib压缩级别
+    std::atomic<int> _level;
+
+    // 训练字典的最大长度
+    size_t _dictSize;
+
+    string _dictDir;
+
+    // 压缩使用的字典，为NULL时不使用字典
+    std::atomic<const Dict*> _activeDict;
+
+    TC_ThreadMutex _dictMutex;
+    Dict _dicts[MAX_DICT_NUM];
+    std::atomic<size_t> _dictNum;
+
+    TC_ThreadMutex _streamMutex;
+    vector<ThreadStream*> _streams;
+
+    // 累计统计，压缩后变小的才计入压缩次数和字节数
+    std::atomic<uint64_t> _compressCount;
+    std::atomic<uint64_t> _skipCount;
+    std::atomic<uint64_t> _rawBytes;
+    std::atomic<uint64_t> _compressBytes;
+    std::atomic<uint64_t> _compressUs;
+    std::atomic<uint64_t> _uncompressCount;
+    std::atomic<uint64_t> _uncompressUs;
+    std::atomic<uint64_t> _uncompressErr;
+
+    // 上次上报时的统计，用于计算每分钟的增量
+    Stat _lastStat;
+
+    map<string, PropertyReportPtr> _properties;
+
+    static __thread ThreadStream *_threadStream;
+};
+
+#endif
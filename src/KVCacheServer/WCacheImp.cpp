@@ -145,6 +145,7 @@ bool WCacheImp::reloadConf(const string& command, const string& params, string&
 
 tars::Int32 WCacheImp::setKV(const DCache::SetKVReq &req, tars::TarsCurrentPtr current)
 {
+    OpTrace trace(LOP_SET_KV, req.data.keyItem);
     TLOGDEBUG("[WCacheImp::" << __FUNCTION__ << "]|" << req.moduleName << "|"
               << req.data.keyItem << "|" << (int)req.data.version << "|" << req.data.dirty
               << "|" << req.data.expireTimeSecond << endl);
@@ -155,6 +156,7 @@ tars::Int32 WCacheImp::setKV(const DCache::SetKVReq &req, tars::TarsCurrentPtr c
 
 tars::Int32 WCacheImp::setKVBatch(const DCache::SetKVBatchReq &req, DCache::SetKVBatchRsp &rsp, tars::TarsCurrentPtr current)
 {
+    OpTrace trace(LOP_SET_KV_BATCH, req.data.empty() ? req.moduleName : req.data[0].keyItem);
     if (g_app.gstat()->serverType() != MASTER)
     {
         //SLAVE状态下不提供接口服务
@@ -255,6 +257,7 @@ tars::Int32 WCacheImp::setKVBatch(const DCache::SetKVBatchReq &req, DCache::SetK
             {
                 iRet = g_sHashMap.set(keyItem, vIt->value, dirty, vIt->expireTimeSecond, vIt->version);
             }
+            TrafficCapture::getInstance()->record(TOP_SET, keyItem, vIt->value.size(), trafficResult(iRet));
             if (iRet != TC_HashMapMalloc::RT_OK)
             {
                 if (iRet == TC_HashMapMalloc::RT_DATA_VER_MISMATCH)
@@ -316,6 +319,7 @@ tars::Int32 WCacheImp::setKVBatch(const DCache::SetKVBatchReq &req, DCache::SetK
 tars::Int32 WCacheImp::insertKV(const DCache::SetKVReq &req, tars::TarsCurrentPtr current)
 {
     const string &keyItem = req.data.keyItem;
+    OpTrace trace(LOP_INSERT_KV, keyItem);
     const string &value = req.data.value;
     bool dirty = req.data.dirty;
     uint32_t expireTimeSecond = req.data.expireTimeSecond;
@@ -376,6 +380,7 @@ tars::Int32 WCacheImp::insertKV(const DCache::SetKVReq &req, tars::TarsCurrentPt
         uint8_t iVersion;
         string sValuetmp;
         int iRet = g_sHashMap.get(keyItem, sValuetmp, iSynTime, iExpireTime, iVersion);
+        TrafficCapture::getInstance()->record(TOP_INSERT, keyItem, value.size(), trafficResult(iRet));
 
         if (iRet == TC_HashMapMalloc::RT_OK)
         {
@@ -385,7 +390,8 @@ tars::Int32 WCacheImp::insertKV(const DCache::SetKVReq &req, tars::TarsCurrentPt
         }
         else if (iRet == TC_HashMapMalloc::RT_NO_DATA)
         {
-            if (_existDB && _readDB)
+            //已知DB中不存在时不需要查DB，直接写入
+            if (_existDB && _readDB && !NegativeCache::getInstance()->check(keyItem))
             {
                 TLOGDEBUG("WCacheImp::insertKV async db in insertKV, key = " << keyItem << endl);
 
@@ -502,6 +508,7 @@ tars::Int32 WCacheImp::insertKV(const DCache::SetKVReq &req, tars::TarsCurrentPt
 tars::Int32 WCacheImp::updateKV(const DCache::UpdateKVReq &req, DCache::UpdateKVRsp &rsp, tars::TarsCurrentPtr current)
 {
     const std::string &keyItem = req.data.keyItem;
+    OpTrace trace(LOP_UPDATE_KV, keyItem);
     const std::string &value = req.data.value;
     bool dirty = req.data.dirty;
     uint32_t expireTimeSecond = req.data.expireTimeSecond;
@@ -593,6 +600,7 @@ tars::Int32 WCacheImp::updateKV(const DCache::UpdateKVReq &req, DCache::UpdateKV
         {
             iRet = g_sHashMap.update(keyItem, value, option, dirty, expireTimeSecond, false, -1, retValue);
         }
+        TrafficCapture::getInstance()->record(TOP_UPDATE, keyItem, retValue.size(), trafficResult(iRet));
 
         if (iRet == TC_HashMapMalloc::RT_OK)
         {
@@ -600,7 +608,7 @@ tars::Int32 WCacheImp::updateKV(const DCache::UpdateKVReq &req, DCache::UpdateKV
         }
         else if (iRet == TC_HashMapMalloc::RT_NO_DATA)
         {
-            if (_existDB && _readDB)
+            if (_existDB && _readDB && !NegativeCache::getInstance()->check(keyItem))
             {
                 TLOGDEBUG("WCacheImp::updateKV async db, key = " << keyItem << endl);
 
@@ -756,9 +764,197 @@ tars::Int32 WCacheImp::updateKV(const DCache::UpdateKVReq &req, DCache::UpdateKV
     return ET_SUCC;
 }
 
+tars::Int32 WCacheImp::updateKVBatch(const DCache::UpdateKVBatchReq &req, DCache::UpdateKVBatchRsp &rsp, tars::TarsCurrentPtr current)
+{
+    OpTrace trace(LOP_UPDATE_KV_BATCH, req.data.empty() ? req.moduleName : req.data[0].keyItem);
+    if (g_app.gstat()->serverType() != MASTER)
+    {
+        //SLAVE状态下不提供接口服务
+        TLOGERROR("WCacheImp::updateKVBatch: ServerType is not Master" << endl);
+        return ET_SERVER_TYPE_ERR;
+    }
+    if (req.moduleName != _moduleName)
+    {
+        //返回模块错误
+        TLOGERROR("WCacheImp::updateKVBatch: moduleName error" << endl);
+        return ET_MODULE_NAME_INVALID;
+    }
+
+    DCache::Op option = req.option;
+    if (option != ADD && option != SUB && option != ADD_INSERT && option != SUB_INSERT)
+    {
+        TLOGERROR("WCacheImp::updateKVBatch: option error " << option << endl);
+        return ET_INPUT_PARAM_ERROR;
+    }
+
+    const vector<SSetKeyValue>& keyValue = req.data;
+    map<std::string, tars::Int32>& keyResult = rsp.keyResult;
+
+    g_app.ppReport(PPReport::SRP_SET_CNT, keyValue.size());
+    vector<SSetKeyValue>::const_iterator vIt = keyValue.begin();
+    for (int iIndex = 0; vIt != keyValue.end(); ++vIt, ++iIndex)
+    {
+        bool dirty = vIt->dirty;
+        const string& keyItem = vIt->keyItem;
+        const string& value = vIt->value;
+        string retValue;
+
+        try
+        {
+            size_t iKeyLength = keyItem.length();
+            if (iKeyLength > _maxKeyLengthInDB)
+            {
+                TLOGERROR("WCacheImp::updateKVBatch: " << keyItem << " keylength:" << iKeyLength << "limit:" << _maxKeyLengthInDB << endl);
+                g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
+                keyResult[keyItem] = ET_PARAM_TOO_LONG;
+                continue;
+            }
+            //迁移时禁止set，由于迁移时允许set的逻辑有漏洞，在解决漏洞之前禁止Set
+            if (g_route_table.isTransfering(keyItem))
+            {
+                int iPageNo = g_route_table.getPageNo(keyItem);
+                if (isTransSrc(iPageNo))
+                {
+                    TLOGERROR("WCacheImp::updateKVBatch: " << keyItem << " forbid set" << endl);
+                    keyResult[keyItem] = ET_FORBID_OPT;
+                    continue;
+                }
+            }
+
+            //检查key是否是在自己服务范围内
+            if (!g_route_table.isMySelf(keyItem))
+            {
+                //返回模块错误
+                TLOGERROR("WCacheImp::updateKVBatch: " << keyItem << " is not in self area" << endl);
+                TLOGERROR(g_route_table.toString() << endl);
+                map<string, string>& context = current->getContext();
+                //API直连模式，返回增量更新路由
+                if (VALUE_YES == context[GET_ROUTE])
+                {
+                    //只返回剩余的key，已更新完成的不返回
+                    vector<string> vtKeys;
+                    vector<int> vtIndex;
+                    while (vIt != keyValue.end())
+                    {
+                        vtKeys.push_back(vIt->keyItem);
+                        vtIndex.push_back(iIndex);
+                        ++vIt;
+                        ++iIndex;
+                    }
+
+                    RspUpdateServant updateServant;
+                    map<string, string> rspContext;
+                    rspContext[ROUTER_UPDATED] = "";
+                    int ret = RouterHandle::getInstance()->getUpdateServant(vtKeys, vtIndex, true, "", updateServant);
+                    if (ret != 0)
+                    {
+                        TLOGERROR(__FUNCTION__ << ":getUpdatedRoute error:" << ret << endl);
+                    }
+                    else
+                    {
+                        RouterHandle::getInstance()->updateServant2Str(updateServant, rspContext[ROUTER_UPDATED]);
+                        current->setResponseContext(rspContext);
+                    }
+                }
+                return ET_KEY_AREA_ERR;
+            }
+
+            if (!IsDigit(value))
+            {
+                TLOGERROR("WCacheImp::updateKVBatch: update value is not digit! " << keyItem << "|" << value << endl);
+                keyResult[keyItem] = ET_INPUT_PARAM_ERROR;
+                continue;
+            }
+
+            if (!dirty)
+            {
+                if (_existDB)
+                {
+                    dirty = true;
+                }
+            }
+
+            int iRet;
+            if (g_app.gstat()->isExpireEnabled())
+            {
+                iRet = g_sHashMap.update(keyItem, value, option, dirty, vIt->expireTimeSecond, true, TC_TimeProvider::getInstance()->getNow(), retValue);
+            }
+            else
+            {
+                iRet = g_sHashMap.update(keyItem, value, option, dirty, vIt->expireTimeSecond, false, -1, retValue);
+            }
+            TrafficCapture::getInstance()->record(TOP_UPDATE, keyItem, retValue.size(), trafficResult(iRet));
+
+            if (iRet != TC_HashMapMalloc::RT_OK)
+            {
+                g_app.gstat()->hit(_hitIndex);
+                if (iRet == TC_HashMapMalloc::RT_NO_DATA || iRet == TC_HashMapMalloc::RT_ONLY_KEY || iRet == TC_HashMapMalloc::RT_DATA_EXPIRED)
+                {
+                    //开启读DB时也不去DB加载，由调用方改用updateKV
+                    TLOGDEBUG("WCacheImp::updateKVBatch no data, key = " << keyItem << "|" << iRet << endl);
+                    keyResult[keyItem] = ET_NO_DATA;
+                }
+                else if (iRet == TC_HashMapMalloc::RT_DATATYPE_ERR || iRet == TC_HashMapMalloc::RT_DECODE_ERR)
+                {
+                    TLOGERROR("WCacheImp::updateKVBatch RT_DATATYPE_ERR, key = " << keyItem << endl);
+                    keyResult[keyItem] = ET_PARAM_OP_ERR;
+                }
+                else if (iRet == TC_HashMapMalloc::RT_NO_MEMORY)
+                {
+                    TLOGERROR("WCacheImp::updateKVBatch RT_NO_MEMORY, key = " << keyItem << endl);
+                    keyResult[keyItem] = ET_MEM_FULL;
+                }
+                else
+                {
+                    TLOGERROR("WCacheImp::updateKVBatch hashmap.update(" << keyItem << ") error:" << iRet << endl);
+                    g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
+                    keyResult[keyItem] = ET_SYS_ERR;
+                }
+                continue;
+            }
+            g_app.gstat()->hit(_hitIndex);
+        }
+        catch (const std::exception & ex)
+        {
+            TLOGERROR("WCacheImp::updateKVBatch exception: " << ex.what() << " , key = " << keyItem << endl);
+            g_app.ppReport(PPReport::SRP_EX, 1);
+            keyResult[keyItem] = ET_SYS_ERR;
+            continue;
+        }
+        catch (...)
+        {
+            TLOGERROR("WCacheImp::updateKVBatch unkown_exception, key = " << keyItem << endl);
+            g_app.ppReport(PPReport::SRP_EX, 1);
+            keyResult[keyItem] = ET_SYS_ERR;
+            continue;
+        }
+
+        //写Binlog，按更新后的值记录set，与旧版本的备机兼容
+        if (_isRecordBinLog)
+        {
+            TBinLogEncode logEncode;
+            CacheServer::WriteToFile(logEncode.Encode(BINLOG_SET, dirty, keyItem, retValue, vIt->expireTimeSecond) + "\n", _binlogFile);
+            if (g_app.gstat()->serverType() == MASTER)
+                g_app.gstat()->setBinlogTime(0, TNOW);
+        }
+        if (_isRecordKeyBinLog)
+        {
+            TBinLogEncode logEncode;
+            CacheServer::WriteToFile(logEncode.EncodeSetKey(keyItem) + "\n", _keyBinlogFile);
+            if (g_app.gstat()->serverType() == MASTER)
+                g_app.gstat()->setBinlogTime(0, TNOW);
+        }
+        keyResult[keyItem] = ET_SUCC;
+        rsp.retValue[keyItem] = retValue;
+    }
+
+    return ET_SUCC;
+}
+
 tars::Int32 WCacheImp::eraseKV(const DCache::RemoveKVReq &req, tars::TarsCurrentPtr current)
 {
     const string &keyItem = req.keyInfo.keyItem;
+    OpTrace trace(LOP_ERASE_KV, keyItem);
     try
     {
         if (g_app.gstat()->serverType() != MASTER)
@@ -809,6 +1005,7 @@ tars::Int32 WCacheImp::eraseKV(const DCache::RemoveKVReq &req, tars::TarsCurrent
         }
 
         iRet = g_sHashMap.erase(keyItem, req.keyInfo.version);
+        TrafficCapture::getInstance()->record(TOP_ERASE, keyItem, 0, trafficResult(iRet));
 
         if (iRet == TC_HashMapMalloc::RT_DATA_VER_MISMATCH)
         {
@@ -863,6 +1060,7 @@ tars::Int32 WCacheImp::eraseKV(const DCache::RemoveKVReq &req, tars::TarsCurrent
 
 tars::Int32 WCacheImp::eraseKVBatch(const DCache::RemoveKVBatchReq &req, DCache::RemoveKVBatchRsp &rsp, tars::TarsCurrentPtr current)
 {
+    OpTrace trace(LOP_ERASE_KV_BATCH, req.data.empty() ? req.moduleName : req.data[0].keyItem);
     if (g_app.gstat()->serverType() != MASTER)
     {
         //SLAVE状态下不提供接口服务
@@ -928,6 +1126,7 @@ tars::Int32 WCacheImp::eraseKVBatch(const DCache::RemoveKVBatchReq &req, DCache:
             }
 
             iRet = g_sHashMap.erase(keyItem, version);
+            TrafficCapture::getInstance()->record(TOP_ERASE, keyItem, 0, trafficResult(iRet));
 
             if (iRet != TC_HashMapMalloc::RT_OK)
             {
@@ -990,6 +1189,7 @@ tars::Int32 WCacheImp::eraseKVBatch(const DCache::RemoveKVBatchReq &req, DCache:
 tars::Int32 WCacheImp::delKV(const DCache::RemoveKVReq &req, tars::TarsCurrentPtr current)
 {
     const string &keyItem = req.keyInfo.keyItem;
+    OpTrace trace(LOP_DEL_KV, keyItem);
     try
     {
         if (g_app.gstat()->serverType() != MASTER)
@@ -1038,6 +1238,7 @@ tars::Int32 WCacheImp::delKV(const DCache::RemoveKVReq &req, tars::TarsCurrentPt
         }
 
         int iRet = g_sHashMap.del(keyItem, req.keyInfo.version);
+        TrafficCapture::getInstance()->record(TOP_DEL, keyItem, 0, trafficResult(iRet));
 
         if (iRet == TC_HashMapMalloc::RT_DATA_VER_MISMATCH)
         {
@@ -1103,6 +1304,7 @@ tars::Int32 WCacheImp::delKV(const DCache::RemoveKVReq &req, tars::TarsCurrentPt
 
 tars::Int32 WCacheImp::delKVBatch(const DCache::RemoveKVBatchReq &req, DCache::RemoveKVBatchRsp &rsp, tars::TarsCurrentPtr current)
 {
+    OpTrace trace(LOP_DEL_KV_BATCH, req.data.empty() ? req.moduleName : req.data[0].keyItem);
     if (req.moduleName != _moduleName)
     {
         //返回模块错误
@@ -1161,6 +1363,7 @@ tars::Int32 WCacheImp::delKVBatch(const DCache::RemoveKVBatchReq &req, DCache::R
             }
 
             int iRet = g_sHashMap.del(keyItem, version);
+            TrafficCapture::getInstance()->record(TOP_DEL, keyItem, 0, trafficResult(iRet));
 
             if (iRet == TC_HashMapMalloc::RT_OK || iRet == TC_HashMapMalloc::RT_NO_DATA)
             {
@@ -1352,6 +1555,7 @@ tars::Int32 WCacheImp::setStringKey(const std::string & moduleName, const std::s
         {
             iRet = g_sHashMap.set(keyItem, value, dirty, expireTimeSecond, ver);
         }
+        TrafficCapture::getInstance()->record(TOP_SET, keyItem, value.size(), trafficResult(iRet));
         if (iRet != TC_HashMapMalloc::RT_OK)
         {
             TLOGERROR("WCacheImp::setStringKey hashmap.set(" << keyItem << ") error:" << iRet << endl);
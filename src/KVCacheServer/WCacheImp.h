@@ -53,6 +53,7 @@ public:
     virtual tars::Int32 insertKV(const DCache::SetKVReq &req, tars::TarsCurrentPtr current);
 
     virtual tars::Int32 updateKV(const DCache::UpdateKVReq &req, DCache::UpdateKVRsp &rsp, tars::TarsCurrentPtr current);
+    virtual tars::Int32 updateKVBatch(const DCache::UpdateKVBatchReq &req, DCache::UpdateKVBatchRsp &rsp, tars::TarsCurrentPtr current);
 
     virtual tars::Int32 eraseKV(const DCache::RemoveKVReq &req, tars::TarsCurrentPtr current);
     virtual tars::Int32 eraseKVBatch(const DCache::RemoveKVBatchReq &req, DCache::RemoveKVBatchRsp &rsp, tars::TarsCurrentPtr current);
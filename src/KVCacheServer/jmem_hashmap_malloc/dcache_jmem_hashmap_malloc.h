@@ -17,11 +17,25 @@
 #include "jmem_hashmap_malloc.h"
 #include "tc_hashmap_malloc.h"
 #include "util/tc_shm.h"
-#include "NormalHash.h"
+#include "HashFactory.h"
 #include <math.h>
 
 namespace DCache
 {
+    /**
+     * 记录DB中不存在的key的过滤器，key写入cache后通知过滤器删除该key
+     */
+    class AbsentKeyFilter
+    {
+    public:
+        virtual ~AbsentKeyFilter() {}
+
+        /**
+         * key写入成功后调用，在jmem锁外
+         */
+        virtual void onWrite(const string &k) = 0;
+    };
+
     template<typename LockPolicy,
         template<class, class> class StorePolicy>
     class HashMapMallocDCache
@@ -172,9 +186,9 @@ namespace DCache
 
         typedef DCacheJmemHashIterator dcache_hash_iterator;
     public:
-        HashMapMallocDCache()
+        HashMapMallocDCache() : _bAutoSizeClass(false), _iSizeClassMaxWaste(25), _pAbsentFilter(NULL)
         {
-            _pHash = new NormalHash();
+            _pHash = HashFactory::getHash(HASH_TYPE_NORMAL);
         }
         ~HashMapMallocDCache()
         {
@@ -185,10 +199,6 @@ namespace DCache
                     delete _hashMapVec[i];
                 }
             }
-            if (_pHash != NULL)
-            {
-                delete _pHash;
-            }
         }
         void init(unsigned int jmemNum)
         {
@@ -208,6 +218,17 @@ namespace DCache
 
             }
         }
+        /**
+         * 各jmem是否在hash桶后面建指纹数组，只对新建的共享内存生效，须在initStore之前调用
+         */
+        void initFingerprint(bool bFingerprint)
+        {
+            for (size_t i = 0; i < _jmemNum; i++)
+            {
+                _hashMapVec[i]->initFingerprint(bFingerprint);
+            }
+        }
+
         void initAvgDataSize(size_t iAvgDataSize)
         {
             for (size_t i = 0; i < _jmemNum; i++)
@@ -216,6 +237,46 @@ namespace DCache
             }
         }
 
+        /**
+         * 设置key的hash类型，用于选择jmem并写入各jmem的头部，须在initStore之前调用
+         * @return 不支持的hash类型返回false
+         */
+        bool initHashType(int iHashType)
+        {
+            P_Hash *pHash = HashFactory::getHash(iHashType);
+            if (pHash == NULL)
+            {
+                return false;
+            }
+            _pHash = pHash;
+            for (size_t i = 0; i < _jmemNum; i++)
+            {
+                _hashMapVec[i]->initHashType((char)iHashType);
+            }
+            return true;
+        }
+
+        /**
+         * 设置各jmem数据区的尺寸类别，create时写入，clear重建时更换，须在initLock之后调用
+         * @param vtClassSize, 尺寸列表，为空时使用默认尺寸类别
+         * @param bAuto, clear时是否按运行期间统计的尺寸分布重新推导，各jmem使用相同的结果
+         * @param iMaxWaste, 推导时相邻尺寸允许的最大间距(百分比)
+         * @return bool, vtClassSize不合法时返回false
+         */
+        bool initSizeClass(const vector<size_t> &vtClassSize, bool bAuto, uint32_t iMaxWaste)
+        {
+            for (size_t i = 0; i < _jmemNum; i++)
+            {
+                if (!_hashMapVec[i]->initSizeClass(vtClassSize))
+                {
+                    return false;
+                }
+            }
+            _bAutoSizeClass = bAuto;
+            _iSizeClassMaxWaste = iMaxWaste;
+            return true;
+        }
+
         void initStore(key_t keyShm, size_t length)
         {
             TLOGDEBUG("initStore start" << endl);
@@ -275,6 +336,22 @@ namespace DCache
             }
             TLOGDEBUG("setHashFunctor finish" << endl);
         }
+        void setValueCodec(TC_HashMapMalloc::ValueCodec *pCodec)
+        {
+            for (size_t i = 0; i < _jmemNum; i++)
+            {
+                _hashMapVec[i]->setValueCodec(pCodec);
+            }
+            TLOGDEBUG("setValueCodec finish" << endl);
+        }
+        /**
+         * 设置不存在key的过滤器，set/update成功后从过滤器中删除key，
+         * 业务写入和binlog同步都经过这里，保证写入的key不会再被判断为不存在
+         */
+        void setAbsentKeyFilter(AbsentKeyFilter *pFilter)
+        {
+            _pAbsentFilter = pFilter;
+        }
         void setAutoErase(bool bAutoErase)
         {
             for (size_t i = 0; i < _jmemNum; i++)
@@ -288,9 +365,17 @@ namespace DCache
         {
             return _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->eraseByForce(k);
         }
+        /**
+         * 按k计算一次hash，同时用于选jmem和计算hash桶，要求setHashFunctor设置的是同一hash函数。
+         * hash不从外部传入，请求中带的hash不能决定数据的存放位置
+         */
         int set(const string& k, const string& v, bool bDirty = true, uint32_t iExpireTime = 0, uint8_t iVersion = 0, bool bCheckExpire = false, uint32_t iNowTime = -1)
         {
-            return _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->set(k, v, bDirty, iExpireTime, iVersion, bCheckExpire, iNowTime);
+            uint32_t iHash = _pHash->HashRawString(k);
+            JmemHashMap *pJmem = _hashMapVec[iHash % _jmemNum];
+            int ret = pJmem->set(k, pJmem->getHashIndexByHash(iHash), v, bDirty, iExpireTime, iVersion, bCheckExpire, iNowTime);
+            notifyWrite(k, ret);
+            return ret;
         }
 
         int set(const string& k, uint8_t iVersion = 0)
@@ -301,7 +386,9 @@ namespace DCache
 //        int update(const string& k, const string& v, Op option, bool bDirty = true, uint32_t iExpireTime = 0, bool bCheckExpire = false, uint32_t iNowTime = -1, string &retValue = "")
 	    int update(const string& k, const string& v, Op option, bool bDirty, uint32_t iExpireTime , bool bCheckExpire, uint32_t iNowTime , string &retValue)
 	    {
-            return _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->update(k, v, option, bDirty, iExpireTime, bCheckExpire, iNowTime, retValue);
+            int ret = _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->update(k, v, option, bDirty, iExpireTime, bCheckExpire, iNowTime, retValue);
+            notifyWrite(k, ret);
+            return ret;
         }
 
         int del(const string& k)
@@ -319,9 +406,14 @@ namespace DCache
             return _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->delExpire(k);
         }
 
+        /**
+         * 同set，按k计算一次hash
+         */
         int get(const string& k, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire = false, uint32_t iNowTime = -1)
         {
-            return _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->get(k, v, iSyncTime, iExpireTime, iVersion, bCheckExpire, iNowTime);
+            uint32_t iHash = _pHash->HashRawString(k);
+            JmemHashMap *pJmem = _hashMapVec[iHash % _jmemNum];
+            return pJmem->get(k, pJmem->getHashIndexByHash(iHash), v, iSyncTime, iExpireTime, iVersion, bCheckExpire, iNowTime);
         }
 
         int get(const string& k, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool& bDirty, bool bCheckExpire = false, uint32_t iNowTime = -1)
@@ -339,6 +431,34 @@ namespace DCache
             return _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->checkDirty(k, bCheckExpire, iNowTime);
         }
 
+        /**
+         * 批量获取数据，vtItem[i]为vtKey[i]的结果，返回值与get/checkDirty相同。
+         * 按jmem分组后每组只加一次锁(大批量时分段加锁)，见JmemHashMapMalloc::getBatch
+         * 每个key的hash只计算一次，同时用于选jmem和计算hash桶，要求同set
+         * @param bCheckDirty, 为true时同checkDirty只检查数据状态
+         */
+        void getBatch(const vector<string> &vtKey, vector<BatchGetItem> &vtItem, bool bCheckDirty, bool bCheckExpire = false, uint32_t iNowTime = -1)
+        {
+            vtItem.clear();
+            vtItem.resize(vtKey.size());
+
+            vector<vector<BatchGetItem*> > vtJmemItem(_jmemNum);
+            for (size_t i = 0; i < vtKey.size(); ++i)
+            {
+                vtItem[i].key = &vtKey[i];
+                vtItem[i].hash = _pHash->HashRawString(vtKey[i]);
+                vtJmemItem[vtItem[i].hash % _jmemNum].push_back(&vtItem[i]);
+            }
+
+            for (unsigned int i = 0; i < _jmemNum; ++i)
+            {
+                if (!vtJmemItem[i].empty())
+                {
+                    _hashMapVec[i]->getBatch(vtJmemItem[i], bCheckDirty, bCheckExpire, iNowTime);
+                }
+            }
+        }
+
         int erase(const string& k)
         {
             return _hashMapVec[_pHash->HashRawString(k) % _jmemNum]->erase(k);
@@ -400,6 +520,32 @@ namespace DCache
 
         void clear()
         {
+            //数据要全部清空, 按统计的尺寸分布更换尺寸类别, 统计的分配次数太少时不更换
+            if (_bAutoSizeClass)
+            {
+                vector<uint64_t> vtHist;
+                vector<size_t> vtClassSize;
+                uint64_t iWaste = 0;
+                getSizeClassInfo(vtHist, vtClassSize, iWaste);
+
+                uint64_t iSampleNum = 0;
+                for (size_t i = 0; i < vtHist.size(); i++)
+                {
+                    iSampleNum += vtHist[i];
+                }
+
+                if (iSampleNum >= MIN_SIZE_CLASS_SAMPLE)
+                {
+                    SizeMap::LearnClassSize(vtHist, _iSizeClassMaxWaste, vtClassSize);
+                    TLOGDEBUG("HashMapMallocDCache::clear learn size class:" << TC_Common::tostr(vtClassSize.begin(), vtClassSize.end(), ",") << endl);
+                    for (size_t i = 0; i < _jmemNum; i++)
+                    {
+                        _hashMapVec[i]->initSizeClass(vtClassSize);
+                        _hashMapVec[i]->resetSizeHist();
+                    }
+                }
+            }
+
             for (size_t i = 0; i < _jmemNum; i++)
             {
                 _hashMapVec[i]->clear();
@@ -549,6 +695,56 @@ namespace DCache
             }
             return dataMemSize;
         }
+        /**
+         * 按尺寸类别统计所有jmem的数据内存使用情况
+         * @param iSparseRatio, 还有空闲内存块且使用率(百分比)低于该值的span计为稀疏span
+         * @param vtStat, 下标为尺寸类别
+         * @param iFreePageNum, 空闲的页数
+         */
+        void getSizeClassStat(uint32_t iSparseRatio, vector<TC_Page::tagSizeClassStat> &vtStat, size_t &iFreePageNum)
+        {
+            vtStat.clear();
+            iFreePageNum = 0;
+            for (size_t i = 0; i < _jmemNum; i++)
+            {
+                vector<TC_Page::tagSizeClassStat> vtJmemStat;
+                size_t iJmemFreePageNum = 0;
+                _hashMapVec[i]->getSizeClassStat(iSparseRatio, vtJmemStat, iJmemFreePageNum);
+
+                if (vtStat.size() < vtJmemStat.size())
+                {
+                    vtStat.resize(vtJmemStat.size());
+                }
+                for (size_t cl = 0; cl < vtJmemStat.size(); ++cl)
+                {
+                    vtStat[cl]._iObjectSize = vtJmemStat[cl]._iObjectSize;
+                    vtStat[cl]._iSpanNum += vtJmemStat[cl]._iSpanNum;
+                    vtStat[cl]._iPageNum += vtJmemStat[cl]._iPageNum;
+                    vtStat[cl]._iObjectNum += vtJmemStat[cl]._iObjectNum;
+                    vtStat[cl]._iUsedObjectNum += vtJmemStat[cl]._iUsedObjectNum;
+                    vtStat[cl]._iSparseSpanNum += vtJmemStat[cl]._iSparseSpanNum;
+                }
+                iFreePageNum += iJmemFreePageNum;
+            }
+        }
+
+        /**
+         * 所有jmem尺寸类别的使用情况
+         * @param vtHist, 进程启动以来请求分配的尺寸直方图, 下标见SizeMap::HistIndex
+         * @param vtClassSize, 当前使用的尺寸列表(最后一个jmem的)
+         * @param iWaste, 按直方图估算的内部碎片字节数
+         */
+        void getSizeClassInfo(vector<uint64_t> &vtHist, vector<size_t> &vtClassSize, uint64_t &iWaste)
+        {
+            vtHist.clear();
+            vtClassSize.clear();
+            iWaste = 0;
+            for (size_t i = 0; i < _jmemNum; i++)
+            {
+                _hashMapVec[i]->getSizeClassInfo(vtHist, vtClassSize, iWaste);
+            }
+        }
+
         size_t getMemSize()
         {
             size_t iMemSize = 0;
@@ -673,11 +869,25 @@ namespace DCache
             delete[] pBuffer;
             if (iLen == _shm.size())
             {
+                //文件中的尺寸类别可能与当前的不同
+                for (size_t i = 0; i < _jmemNum; i++)
+                {
+                    _hashMapVec[i]->reconnectData();
+                }
                 return TC_HashMapMalloc::RT_OK;
             }
 
             return TC_HashMapMalloc::RT_LOAL_FILE_ERR;
         }
+    private:
+        void notifyWrite(const string& k, int ret)
+        {
+            if (ret == TC_HashMapMalloc::RT_OK && _pAbsentFilter != NULL)
+            {
+                _pAbsentFilter->onWrite(k);
+            }
+        }
+
     private:
         vector<JmemHashMap *> _hashMapVec;
         //jmem个数
@@ -687,7 +897,19 @@ namespace DCache
         //信号量集
         typename LockPolicy::Mutex _Mutex;
 
-        NormalHash * _pHash;
+        // HashFactory的共享实例，不用释放
+        P_Hash * _pHash;
+
+        // clear时是否按尺寸分布推导尺寸类别
+        bool _bAutoSizeClass;
+
+        // 推导尺寸类别时相邻尺寸允许的最大间距(百分比)
+        uint32_t _iSizeClassMaxWaste;
+
+        // 推导尺寸类别至少需要的分配次数
+        static const uint64_t MIN_SIZE_CLASS_SAMPLE = 10000;
+
+        AbsentKeyFilter *_pAbsentFilter;
     };
 }
 
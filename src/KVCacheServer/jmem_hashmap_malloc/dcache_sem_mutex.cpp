@@ -14,10 +14,21 @@
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 #include "dcache_sem_mutex.h"
 
 namespace DCache
 {
+    __thread uint64_t *DCache_SemMutex::_waitCounter = NULL;
+    __thread uint64_t *DCache_SemMutex::_holdCounter = NULL;
+    __thread uint64_t DCache_SemMutex::_lockedAt = 0;
+
+    static inline uint64_t monotonicUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
 
     DCache_SemMutex::DCache_SemMutex()
     {
@@ -98,6 +109,8 @@ namespace DCache
             size_t nsops = 2;
 
             int ret = -1;
+            uint64_t *pCounter = _waitCounter;
+            uint64_t iBegin = pCounter ? monotonicUs() : 0;
 
             do
             {
@@ -105,6 +118,15 @@ namespace DCache
 
             } while ((ret == -1) && (errno == EINTR));
 
+            if (pCounter || _holdCounter)
+            {
+                _lockedAt = monotonicUs();
+                if (pCounter)
+                {
+                    *pCounter += _lockedAt - iBegin;
+                }
+            }
+
             return ret;
         }
         else
@@ -125,11 +147,21 @@ namespace DCache
             }
             int ret = -1;
             size_t nsops = _semNum * 2;
+            uint64_t *pCounter = _waitCounter;
+            uint64_t iBegin = pCounter ? monotonicUs() : 0;
             do
             {
                 ret = semop(_semID, sops, nsops);
 
             } while ((ret == -1) && (errno == EINTR));
+            if (pCounter || _holdCounter)
+            {
+                _lockedAt = monotonicUs();
+                if (pCounter)
+                {
+                    *pCounter += _lockedAt - iBegin;
+                }
+            }
             free(sops);
             return ret;
         }
@@ -137,6 +169,12 @@ namespace DCache
 
     int DCache_SemMutex::unwlock() const
     {
+        if (_holdCounter && _lockedAt > 0)
+        {
+            *_holdCounter += monotonicUs() - _lockedAt;
+            _lockedAt = 0;
+        }
+
         if (_index != -1)
         {
             //解除排他锁
@@ -17,6 +17,7 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
+#include <stdint.h>
 #include "util/tc_lock.h"
 #include <semaphore.h>
 
@@ -101,6 +102,13 @@ struct DCache_SemMutex_Exception : public tars::TC_Lock_Exception
         */
         int unlock() const { return unwlock(); };
 
+        /**
+        * 设置当前线程的锁耗时累加器(微秒)，NULL为不统计
+        * @param pWait, 累加等锁耗时
+        * @param pHold, 累加持锁耗时，即在hashmap中查找、拷贝或写入数据的耗时
+        */
+        static void setTimeCounter(uint64_t *pWait, uint64_t *pHold) { _waitCounter = pWait; _holdCounter = pHold; }
+
         //信号量编号
         short _index;
 
@@ -120,6 +128,12 @@ struct DCache_SemMutex_Exception : public tars::TC_Lock_Exception
        */
         int _semNum;
 
+        /**
+        * 当前线程的锁耗时累加器和加锁成功的时间
+        */
+        static __thread uint64_t *_waitCounter;
+        static __thread uint64_t *_holdCounter;
+        static __thread uint64_t _lockedAt;
 
     };
 
@@ -139,6 +139,26 @@ namespace DCache
      > 注意:hash_iterator对应的其实是一个hash桶链, 每次获取数据其实会获取桶链上面的所有数据
     */
 
+    /**
+     * 批量读中的一个key，JmemHashMapMalloc::getBatch的输入和输出
+     */
+    struct BatchGetItem
+    {
+        BatchGetItem() : key(NULL), hash(0), index(0), ret(TC_HashMapMalloc::RT_OK), syncTime(0), expireTime(0), version(1) {}
+
+        const string *key;
+        // key的hash，同时用于选jmem和计算hash桶
+        uint32_t hash;
+        // key在所属jmem中的hash桶下标
+        uint32_t index;
+        // 与get/checkDirty的返回值相同
+        int ret;
+        string value;
+        uint32_t syncTime;
+        uint32_t expireTime;
+        uint8_t version;
+    };
+
     template<typename LockPolicy,
         template<class, class> class StorePolicy>
     class JmemHashMapMalloc : public StorePolicy<TC_HashMapMalloc, LockPolicy>
@@ -612,8 +632,14 @@ namespace DCache
                     _item.get(vtData);
                 }
 
+                //释放锁后再解压
                 for (size_t i = 0; i < vtData.size(); i++)
                 {
+                    if (!_item.decodeValue(vtData[i]))
+                    {
+                        continue;
+                    }
+
                     try
                     {
                         typename ToDoFunctor::DataRecord stDataRecord;
@@ -644,8 +670,14 @@ namespace DCache
                     _item.getAllData(vtData);
                 }
 
+                //释放锁后再解压
                 for (size_t i = 0; i < vtData.size(); i++)
                 {
+                    if (!_item.decodeValue(vtData[i]))
+                    {
+                        continue;
+                    }
+
                     try
                     {
                         typename ToDoFunctor::DataRecord stDataRecord;
@@ -687,6 +719,11 @@ namespace DCache
 
                 for (size_t i = 0; i < vtData.size(); i++)
                 {
+                    if (!_item.decodeValue(vtData[i]))
+                    {
+                        continue;
+                    }
+
                     pair<string, string> pk;
 
                     try
@@ -718,6 +755,11 @@ namespace DCache
 
                 for (size_t i = 0; i < vtData.size(); i++)
                 {
+                    if (!_item.decodeValue(vtData[i]))
+                    {
+                        continue;
+                    }
+
                     pair<string, string> pk;
 
                     try
@@ -770,6 +812,22 @@ namespace DCache
                 }
             }
 
+            /**
+             * 碎片整理, 搬迁当前桶下位于稀疏span上的内存块
+             * @param iSparseRatio, span的使用率(百分比)低于该值时搬迁
+             *
+             * @return uint32_t, 搬迁的内存块个数
+             */
+            uint32_t defrag(uint32_t iSparseRatio)
+            {
+                uint32_t iMoved = 0;
+                {
+                    TC_LockT<typename LockPolicy::Mutex> lock(_lock->mutex());
+                    _item.defrag(iSparseRatio, iMoved);
+                }
+                return iMoved;
+            }
+
         protected:
             TC_HashMapMalloc::HashMapItem _item;
             JhmLockPtr              _lock;
@@ -952,6 +1010,20 @@ namespace DCache
          */
         void initHashRadio(float fRadio) { this->_t.initHashRadio(fRadio); }
 
+        /**
+         * 是否在hash桶后面建指纹数组, 必须在create之前调用, connect时按内存头部的记录
+         *
+         * @param bFingerprint
+         */
+        void initFingerprint(bool bFingerprint) { this->_t.initFingerprint(bFingerprint); }
+
+        /**
+         * 设置key的hash类型, 必须在create/connect之前调用
+         *
+         * @param cHashType
+         */
+        void initHashType(char cHashType) { this->_t.initHashType(cHashType); }
+
         /**
          * 设置hash方式
          * @param hash_of
@@ -969,6 +1041,16 @@ namespace DCache
          */
         TC_HashMapMalloc::hash_functor &getHashFunctor() { return this->_t.getHashFunctor(); }
 
+        /**
+         * 设置value压缩
+         * @param pCodec
+         */
+        void setValueCodec(TC_HashMapMalloc::ValueCodec *pCodec)
+        {
+            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            this->_t.setValueCodec(pCodec);
+        }
+
         /**
          * 设置淘汰操作类
          * @param erase_of
@@ -986,6 +1068,56 @@ namespace DCache
             return this->_t.getDataMemSize();
         }
 
+        /**
+         * 按尺寸类别统计数据内存的使用情况
+         * @param iSparseRatio, 还有空闲内存块且使用率(百分比)低于该值的span计为稀疏span
+         * @param vtStat, 下标为尺寸类别
+         * @param iFreePageNum, 空闲的页数
+         */
+        void getSizeClassStat(uint32_t iSparseRatio, vector<TC_Page::tagSizeClassStat> &vtStat, size_t &iFreePageNum)
+        {
+            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            this->_t.getSizeClassStat(iSparseRatio, vtStat, iFreePageNum);
+        }
+
+        /**
+         * 设置数据区的尺寸类别, create时使用, 之后在clear重建时更换, 须在initLock之后调用
+         * @param vtClassSize, 尺寸列表, 为空时使用默认尺寸类别
+         * @return bool, 尺寸列表不合法时返回false
+         */
+        bool initSizeClass(const vector<size_t> &vtClassSize)
+        {
+            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            return this->_t.initSizeClass(vtClassSize);
+        }
+
+        /**
+         * 尺寸类别的使用情况, 参数见TC_HashMapMalloc::getSizeClassInfo
+         */
+        void getSizeClassInfo(vector<uint64_t> &vtHist, vector<size_t> &vtClassSize, uint64_t &iWaste)
+        {
+            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            this->_t.getSizeClassInfo(vtHist, vtClassSize, iWaste);
+        }
+
+        /**
+         * 清空请求分配的尺寸直方图
+         */
+        void resetSizeHist()
+        {
+            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            this->_t.resetSizeHist();
+        }
+
+        /**
+         * 整块内存被替换后按内存中保存的尺寸类别重新连接数据区
+         */
+        void reconnectData()
+        {
+            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            this->_t.reconnectData();
+        }
+
         /**
          * 获取hash桶的个数
          *
@@ -1273,21 +1405,30 @@ namespace DCache
          *          其他返回值: 错误
          */
         int get(const string& k, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire = false, uint32_t iNowTime = -1)
+        {
+            return get(k, this->_t.getHashIndex(k), v, iSyncTime, iExpireTime, iVersion, bCheckExpire, iNowTime);
+        }
+
+        /**
+         * 同上，index为getHashIndex(k)或getHashIndexByHash(hash)的结果，已算好hash时不用再计算
+         */
+        int get(const string& k, uint32_t index, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire, uint32_t iNowTime)
         {
             iSyncTime = 0;
             iExpireTime = 0;
             iVersion = 1;
             int ret = TC_HashMapMalloc::RT_OK;
+            uint32_t iDictId;
 
             {
                 TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
-                ret = this->_t.get(k, v, iSyncTime, iExpireTime, iVersion, bCheckExpire, iNowTime);
+                ret = this->_t.get(k, index, v, iDictId, iSyncTime, iExpireTime, iVersion, bCheckExpire, iNowTime);
             }
 
-            //读取到数据了, 解包
+            //读取到数据了, 释放锁后解压
             if (ret == TC_HashMapMalloc::RT_OK)
             {
-                return ret;
+                return this->_t.decodeValue(v, iDictId) ? ret : (int)TC_HashMapMalloc::RT_DECODE_ERR;
             }
 
             if (ret != TC_HashMapMalloc::RT_NO_DATA || _todo_of == NULL)
@@ -1349,16 +1490,17 @@ namespace DCache
             iExpireTime = 0;
             iVersion = 1;
             int ret = TC_HashMapMalloc::RT_OK;
+            uint32_t iDictId;
 
             {
                 TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
-                ret = this->_t.get(k, v, iSyncTime, iExpireTime, iVersion, bDirty, bCheckExpire, iNowTime);
+                ret = this->_t.get(k, v, iDictId, iSyncTime, iExpireTime, iVersion, bDirty, bCheckExpire, iNowTime);
             }
 
-            //读取到数据了, 解包
+            //读取到数据了, 释放锁后解压
             if (ret == TC_HashMapMalloc::RT_OK)
             {
-                return ret;
+                return this->_t.decodeValue(v, iDictId) ? ret : (int)TC_HashMapMalloc::RT_DECODE_ERR;
             }
 
             if (ret != TC_HashMapMalloc::RT_NO_DATA || _todo_of == NULL)
@@ -1419,6 +1561,98 @@ namespace DCache
             return get(k, v, iSyncTime, iExpireTime, iVer, bCheckExpire, iNowTime);
         }
 
+        /**
+         * 由hash_functor计算好的hash值得到hash索引，hash桶个数创建后不变，不用加锁
+         */
+        uint32_t getHashIndexByHash(size_t hash)
+        {
+            return this->_t.getHashIndexByHash(hash);
+        }
+
+        /**
+         * 批量获取数据, 修改GET时间链，结果写在各BatchGetItem中。
+         * 每BATCH_LOCK_KEYS个key加一次锁，持锁期间提前预取后面几个key的hash桶和数据块，
+         * 使各key的内存访问重叠；hash桶下标在加锁前由BatchGetItem::hash计算。
+         * 没有数据且设置了自定义Get函数的key，再逐个按get加载
+         * @param vtItem
+         * @param bCheckDirty, 为true时同checkDirty只检查数据状态，不读取数据
+         */
+        void getBatch(vector<BatchGetItem*> &vtItem, bool bCheckDirty, bool bCheckExpire = false, uint32_t iNowTime = -1)
+        {
+            size_t n = vtItem.size();
+            vector<uint32_t> vtDictId(bCheckDirty ? 0 : n, TC_HashMapMalloc::UNCOMPRESSED);
+            for (size_t i = 0; i < n; ++i)
+            {
+                vtItem[i]->index = this->_t.getHashIndexByHash(vtItem[i]->hash);
+            }
+
+            for (size_t begin = 0; begin < n; begin += BATCH_LOCK_KEYS)
+            {
+                size_t end = min(n, begin + BATCH_LOCK_KEYS);
+
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+
+                // 先预取hash桶，隔BATCH_PREFETCH个key后再读桶中的地址预取数据块
+                for (size_t i = begin; i < end && i < begin + 2 * BATCH_PREFETCH; ++i)
+                {
+                    this->_t.prefetchHash(vtItem[i]->index);
+                }
+                for (size_t i = begin; i < end && i < begin + BATCH_PREFETCH; ++i)
+                {
+                    this->_t.prefetchBlock(vtItem[i]->index);
+                }
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (i + 2 * BATCH_PREFETCH < end)
+                    {
+                        this->_t.prefetchHash(vtItem[i + 2 * BATCH_PREFETCH]->index);
+                    }
+                    if (i + BATCH_PREFETCH < end)
+                    {
+                        this->_t.prefetchBlock(vtItem[i + BATCH_PREFETCH]->index);
+                    }
+
+                    BatchGetItem &item = *vtItem[i];
+                    if (bCheckDirty)
+                    {
+                        item.ret = this->_t.checkDirty(*item.key, item.index, bCheckExpire, iNowTime);
+                    }
+                    else
+                    {
+                        item.syncTime = 0;
+                        item.expireTime = 0;
+                        item.version = 1;
+                        item.ret = this->_t.get(*item.key, item.index, item.value, vtDictId[i], item.syncTime, item.expireTime, item.version, bCheckExpire, iNowTime);
+                    }
+                }
+            }
+
+            //全部读完、释放锁后再解压
+            for (size_t i = 0; i < vtDictId.size(); ++i)
+            {
+                BatchGetItem &item = *vtItem[i];
+                if (item.ret == TC_HashMapMalloc::RT_OK && !this->_t.decodeValue(item.value, vtDictId[i]))
+                {
+                    item.ret = TC_HashMapMalloc::RT_DECODE_ERR;
+                }
+            }
+
+            if (bCheckDirty || _todo_of == NULL)
+            {
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                BatchGetItem &item = *vtItem[i];
+                if (item.ret == TC_HashMapMalloc::RT_NO_DATA)
+                {
+                    item.ret = get(*item.key, item.value, item.syncTime, item.expireTime, item.version, bCheckExpire, iNowTime);
+                }
+            }
+        }
+
         /**
          * 根据key, 获取相同hash值的所有数据
          * 注意:c匹配对象操作中, map是加锁的, 需要注意
@@ -1432,36 +1666,48 @@ namespace DCache
         int getHash(size_t h, vector<pair<string, string> > &vv, C c)
         {
             int ret = TC_HashMapMalloc::RT_OK;
+            vector<TC_HashMapMalloc::BlockData> vtData;
 
-            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            {
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
 
-            TC_HashMapMalloc::FailureRecover check(&this->_t);
+                TC_HashMapMalloc::FailureRecover check(&this->_t);
 
-            size_t index = h % this->_t.getHashCount();
-            size_t iAddr = this->_t.item(index)->_iBlockAddr;
+                size_t index = h % this->_t.getHashCount();
+                size_t iAddr = this->_t.item(index)->_iBlockAddr;
 
-            TC_HashMapMalloc::Block block(&this->_t, iAddr);
+                TC_HashMapMalloc::Block block(&this->_t, iAddr);
 
-            while (block.getHead() != 0)
-            {
-                TC_HashMapMalloc::BlockData data;
-                ret = block.getBlockData(data);
-                if (ret == TC_HashMapMalloc::RT_OK)
+                while (block.getHead() != 0)
                 {
-                    try
+                    TC_HashMapMalloc::BlockData data;
+                    ret = block.getBlockData(data);
+                    if (ret == TC_HashMapMalloc::RT_OK)
                     {
-                        if (c(data._key))
+                        try
+                        {
+                            if (c(data._key))
+                            {
+                                vtData.push_back(data);
+                            }
+                        }
+                        catch (exception &ex)
                         {
-                            vv.push_back(make_pair(data._key, data._value));
                         }
                     }
-                    catch (exception &ex)
+                    if (!block.nextBlock())
                     {
+                        break;
                     }
                 }
-                if (!block.nextBlock())
+            }
+
+            //释放锁后再解压
+            for (size_t i = 0; i < vtData.size(); i++)
+            {
+                if (this->_t.decodeValue(vtData[i]._value, vtData[i]._dictId))
                 {
-                    break;
+                    vv.push_back(make_pair(vtData[i]._key, vtData[i]._value));
                 }
             }
 
@@ -1481,45 +1727,60 @@ namespace DCache
         int getHash(size_t h, vector<DataRecord> &vv, C c)
         {
             int ret = TC_HashMapMalloc::RT_OK;
+            vector<TC_HashMapMalloc::BlockData> vtData;
 
-            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            {
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
 
-            TC_HashMapMalloc::FailureRecover check(&this->_t);
+                TC_HashMapMalloc::FailureRecover check(&this->_t);
 
-            size_t index = h % this->_t.getHashCount();
-            size_t iAddr = this->_t.item(index)->_iBlockAddr;
+                size_t index = h % this->_t.getHashCount();
+                size_t iAddr = this->_t.item(index)->_iBlockAddr;
 
-            TC_HashMapMalloc::Block block(&this->_t, iAddr);
+                TC_HashMapMalloc::Block block(&this->_t, iAddr);
 
-            while (block.getHead() != 0)
-            {
-                TC_HashMapMalloc::BlockData data;
-                ret = block.getBlockData(data);
-                if (ret == TC_HashMapMalloc::RT_OK)
+                while (block.getHead() != 0)
                 {
-                    try
+                    TC_HashMapMalloc::BlockData data;
+                    ret = block.getBlockData(data);
+                    if (ret == TC_HashMapMalloc::RT_OK)
                     {
-                        if (c(data._key))
+                        try
+                        {
+                            if (c(data._key))
+                            {
+                                vtData.push_back(data);
+                            }
+                        }
+                        catch (exception &ex)
                         {
-                            DataRecord stDataRecord;
-                            stDataRecord._key = data._key;
-                            stDataRecord._value = data._value;
-                            stDataRecord._ver = data._ver;
-                            stDataRecord._dirty = data._dirty;
-                            stDataRecord._expiret = data._expiret;
-                            stDataRecord._iSyncTime = data._synct;
-
-                            vv.push_back(stDataRecord);
                         }
                     }
-                    catch (exception &ex)
+                    if (!block.nextBlock())
                     {
+                        break;
                     }
                 }
-                if (!block.nextBlock())
+            }
+
+            //释放锁后再解压
+            for (size_t i = 0; i < vtData.size(); i++)
+            {
+                TC_HashMapMalloc::BlockData &data = vtData[i];
+                if (!this->_t.decodeValue(data._value, data._dictId))
                 {
-                    break;
+                    continue;
                 }
+
+                DataRecord stDataRecord;
+                stDataRecord._key = data._key;
+                stDataRecord._value = data._value;
+                stDataRecord._ver = data._ver;
+                stDataRecord._dirty = data._dirty;
+                stDataRecord._expiret = data._expiret;
+                stDataRecord._iSyncTime = data._synct;
+
+                vv.push_back(stDataRecord);
             }
 
             return TC_HashMapMalloc::RT_OK;
@@ -1539,59 +1800,74 @@ namespace DCache
         int getHashWithOnlyKey(size_t h, vector<DataRecord> &vv, C c)
         {
             int ret = TC_HashMapMalloc::RT_OK;
+            vector<DataRecord> vtRecord;
+            vector<uint32_t> vtDictId;
 
-            TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+            {
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
 
-            TC_HashMapMalloc::FailureRecover check(&this->_t);
+                TC_HashMapMalloc::FailureRecover check(&this->_t);
 
-            size_t index = h % this->_t.getHashCount();
-            size_t iAddr = this->_t.item(index)->_iBlockAddr;
+                size_t index = h % this->_t.getHashCount();
+                size_t iAddr = this->_t.item(index)->_iBlockAddr;
 
-            TC_HashMapMalloc::Block block(&this->_t, iAddr);
+                TC_HashMapMalloc::Block block(&this->_t, iAddr);
 
-            while (block.getHead() != 0)
-            {
-                TC_HashMapMalloc::BlockData data;
-                ret = block.getBlockData(data);
-                if (ret == TC_HashMapMalloc::RT_OK)
+                while (block.getHead() != 0)
                 {
-                    try
+                    TC_HashMapMalloc::BlockData data;
+                    ret = block.getBlockData(data);
+                    if (ret == TC_HashMapMalloc::RT_OK)
                     {
-                        if (c(data._key))
+                        try
+                        {
+                            if (c(data._key))
+                            {
+                                DataRecord stDataRecord;
+                                stDataRecord._key = data._key;
+                                stDataRecord._value = data._value;
+                                stDataRecord._ver = data._ver;
+                                stDataRecord._dirty = data._dirty;
+                                stDataRecord._expiret = data._expiret;
+                                stDataRecord._iSyncTime = data._synct;
+                                vtRecord.push_back(stDataRecord);
+                                vtDictId.push_back(data._dictId);
+                            }
+                        }
+                        catch (exception &ex)
                         {
-                            DataRecord stDataRecord;
-                            stDataRecord._key = data._key;
-                            stDataRecord._value = data._value;
-                            stDataRecord._ver = data._ver;
-                            stDataRecord._dirty = data._dirty;
-                            stDataRecord._expiret = data._expiret;
-                            stDataRecord._iSyncTime = data._synct;
-                            vv.push_back(stDataRecord);
                         }
                     }
-                    catch (exception &ex)
-                    {
-                    }
-                }
-                else if (ret == TC_HashMapMalloc::RT_ONLY_KEY)
-                {
-                    try
+                    else if (ret == TC_HashMapMalloc::RT_ONLY_KEY)
                     {
-                        if (c(data._key))
+                        try
+                        {
+                            if (c(data._key))
+                            {
+                                DataRecord stDataRecord;
+                                stDataRecord._key = data._key;
+                                stDataRecord._onlyKey = true;
+                                vtRecord.push_back(stDataRecord);
+                                vtDictId.push_back(TC_HashMapMalloc::UNCOMPRESSED);
+                            }
+                        }
+                        catch (exception &ex)
                         {
-                            DataRecord stDataRecord;
-                            stDataRecord._key = data._key;
-                            stDataRecord._onlyKey = true;
-                            vv.push_back(stDataRecord);
                         }
                     }
-                    catch (exception &ex)
+                    if (!block.nextBlock())
                     {
+                        break;
                     }
                 }
-                if (!block.nextBlock())
+            }
+
+            //释放锁后再解压
+            for (size_t i = 0; i < vtRecord.size(); i++)
+            {
+                if (this->_t.decodeValue(vtRecord[i]._value, vtDictId[i]))
                 {
-                    break;
+                    vv.push_back(vtRecord[i]);
                 }
             }
 
@@ -1634,13 +1910,26 @@ namespace DCache
          *          其他返回值: 错误
          */
         int set(const string& k, const string& v, bool bDirty = true, uint32_t iExpireTime = 0, uint8_t iVersion = 0, bool bCheckExpire = false, uint32_t iNowTime = -1)
+        {
+            return set(k, this->_t.getHashIndex(k), v, bDirty, iExpireTime, iVersion, bCheckExpire, iNowTime);
+        }
+
+        /**
+         * 同上，index为getHashIndex(k)或getHashIndexByHash(hash)的结果
+         */
+        int set(const string& k, uint32_t index, const string& v, bool bDirty, uint32_t iExpireTime, uint8_t iVersion, bool bCheckExpire, uint32_t iNowTime)
         {
             int ret = TC_HashMapMalloc::RT_OK;
             vector<TC_HashMapMalloc::BlockData> vtData;
 
+            //压缩在加锁前完成
+            string sCompress;
+            uint32_t iDictId;
+            const string &sValue = this->_t.encodeValue(v, sCompress, iDictId);
+
             {
                 TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
-                ret = this->_t.set(k, v, iExpireTime, iVersion, bDirty, bCheckExpire, iNowTime, vtData);
+                ret = this->_t.set(k, index, sValue, iDictId, iExpireTime, iVersion, bDirty, bCheckExpire, iNowTime, vtData);
             }
 
             //操作淘汰数据
@@ -1648,6 +1937,11 @@ namespace DCache
             {
                 for (size_t i = 0; i < vtData.size(); i++)
                 {
+                    if (!this->_t.decodeValue(vtData[i]._value, vtData[i]._dictId))
+                    {
+                        continue;
+                    }
+
                     try
                     {
                         typename ToDoFunctor::DataRecord stDataRecord;
@@ -1692,6 +1986,11 @@ namespace DCache
             {
                 for (size_t i = 0; i < vtData.size(); i++)
                 {
+                    if (!this->_t.decodeValue(vtData[i]._value, vtData[i]._dictId))
+                    {
+                        continue;
+                    }
+
                     try
                     {
                         typename ToDoFunctor::DataRecord stDataRecord;
@@ -1729,9 +2028,25 @@ namespace DCache
             int ret = TC_HashMapMalloc::RT_OK;
             vector<TC_HashMapMalloc::BlockData> vtData;
 
+            //原value是压缩保存的, 先在锁外解压改为不压缩保存再重试, 期间被其他线程改写时最多重试3次
+            for (int i = 0; i < 3; ++i)
             {
-                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
-                ret = this->_t.update(k, v, option, bDirty, iExpireTime, bCheckExpire, iNowTime, retValue, vtData);
+                {
+                    TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+                    ret = this->_t.update(k, v, option, bDirty, iExpireTime, bCheckExpire, iNowTime, retValue, vtData);
+                }
+
+                if (ret != TC_HashMapMalloc::RT_VALUE_COMPRESSED)
+                {
+                    break;
+                }
+
+                ret = uncompressValue(k, vtData);
+                if (ret != TC_HashMapMalloc::RT_OK)
+                {
+                    break;
+                }
+                ret = TC_HashMapMalloc::RT_VALUE_COMPRESSED;
             }
 
             //操作淘汰数据
@@ -1739,6 +2054,11 @@ namespace DCache
             {
                 for (size_t i = 0; i < vtData.size(); i++)
                 {
+                    if (!this->_t.decodeValue(vtData[i]._value, vtData[i]._dictId))
+                    {
+                        continue;
+                    }
+
                     try
                     {
                         typename ToDoFunctor::DataRecord stDataRecord;
@@ -1759,6 +2079,54 @@ namespace DCache
             return ret;
         }
 
+        /**
+         * 把压缩保存的value改为不压缩保存, 供update使用
+         * 读取和写回分别加锁, 解压在锁外进行, 写回时校验版本号, 期间数据被改写则放弃写回
+         * @param k: 关键字
+         * @param vtData: 淘汰的数据
+         * @return int:
+         *          TC_HashMapMalloc::RT_OK: 已改为不压缩保存, 或数据已被改写, 需要重新update
+         *          TC_HashMapMalloc::RT_DECODE_ERR: 解压失败
+         *          其他返回值: 错误
+         */
+        int uncompressValue(const string& k, vector<TC_HashMapMalloc::BlockData> &vtData)
+        {
+            string v;
+            uint32_t iDictId;
+            uint32_t iSyncTime;
+            uint32_t iExpireTime;
+            uint8_t iVersion;
+            bool bDirty;
+            int ret;
+
+            {
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+                ret = this->_t.get(k, v, iDictId, iSyncTime, iExpireTime, iVersion, bDirty, false, -1);
+            }
+
+            if (ret < 0)
+            {
+                return ret;
+            }
+
+            if (ret != TC_HashMapMalloc::RT_OK || iDictId == TC_HashMapMalloc::UNCOMPRESSED)
+            {
+                return TC_HashMapMalloc::RT_OK;
+            }
+
+            if (!this->_t.decodeValue(v, iDictId))
+            {
+                return TC_HashMapMalloc::RT_DECODE_ERR;
+            }
+
+            {
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+                ret = this->_t.set(k, v, TC_HashMapMalloc::UNCOMPRESSED, iExpireTime, iVersion, bDirty, vtData);
+            }
+
+            return ret == TC_HashMapMalloc::RT_DATA_VER_MISMATCH ? (int)TC_HashMapMalloc::RT_OK : ret;
+        }
+
         /**
          * 删除数据
          * 无论cache是否有数据,todo的del都被调用
@@ -1831,7 +2199,7 @@ namespace DCache
                 typename ToDoFunctor::DataRecord stDataRecord;
                 stDataRecord._key = k;
 
-                if (ret == TC_HashMapMalloc::RT_OK)
+                if (ret == TC_HashMapMalloc::RT_OK && this->_t.decodeValue(data._value, data._dictId))
                 {
                     stDataRecord._value = data._value;
                     stDataRecord._dirty = data._dirty;
@@ -1873,6 +2241,11 @@ namespace DCache
                 return ret;
             }
 
+            if (!this->_t.decodeValue(data._value, data._dictId))
+            {
+                return TC_HashMapMalloc::RT_DECODE_ERR;
+            }
+
             if (_todo_of)
             {
                 typename ToDoFunctor::DataRecord stDataRecord;
@@ -1904,6 +2277,11 @@ namespace DCache
                 return ret;
             }
 
+            if (!this->_t.decodeValue(data._value, data._dictId))
+            {
+                return TC_HashMapMalloc::RT_DECODE_ERR;
+            }
+
             if (_todo_of)
             {
                 typename ToDoFunctor::DataRecord stDataRecord;
@@ -2097,6 +2475,11 @@ namespace DCache
                     }
                 }
 
+                if (!this->_t.decodeValue(data._value, data._dictId))
+                {
+                    continue;
+                }
+
                 if (_todo_of)
                 {
                     typename ToDoFunctor::DataRecord stDataRecord;
@@ -2137,6 +2520,11 @@ namespace DCache
                     ++uEraseCount;
                 }
 
+                if (!this->_t.decodeValue(data._value, data._dictId))
+                {
+                    continue;
+                }
+
                 if (_todo_of)
                 {
                     typename ToDoFunctor::DataRecord stDataRecord;
@@ -2229,6 +2617,11 @@ namespace DCache
                     }
                 }
 
+                if (!this->_t.decodeValue(data._value, data._dictId))
+                {
+                    continue;
+                }
+
                 if (_todo_of)
                 {
                     typename ToDoFunctor::DataRecord stDataRecord;
@@ -2308,6 +2701,14 @@ namespace DCache
                 }
             }
 
+            if (!this->_t.decodeValue(data._value, data._dictId))
+            {
+                //解压失败, 恢复为脏数据
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+                this->_t.setDirtyAfterSync(data._key);
+                return TC_HashMapMalloc::RT_DECODE_ERR;
+            }
+
             typename ToDoFunctor::DataRecord stDataRecord;
             stDataRecord._key = data._key;
             stDataRecord._value = data._value;
@@ -2361,6 +2762,14 @@ namespace DCache
                 }
             }
 
+            if (!this->_t.decodeValue(data._value, data._dictId))
+            {
+                //解压失败, 恢复为脏数据
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+                this->_t.setDirtyAfterSync(data._key);
+                return TC_HashMapMalloc::RT_DECODE_ERR;
+            }
+
             if (_todo_of)
             {
                 typename ToDoFunctor::DataRecord stDataRecord;
@@ -2413,6 +2822,11 @@ namespace DCache
                     }
                 }
 
+                if (!this->_t.decodeValue(data._value, data._dictId))
+                {
+                    continue;
+                }
+
                 if (_todo_of)
                 {
                     typename ToDoFunctor::DataRecord stDataRecord;
@@ -2598,6 +3012,11 @@ namespace DCache
         }
 
     protected:
+        // getBatch每次加锁处理的key个数，避免一个大批量长时间持锁
+        static const size_t BATCH_LOCK_KEYS = 64;
+
+        // getBatch预取的距离(key个数)
+        static const size_t BATCH_PREFETCH = 4;
 
         /**
          * 删除数据的函数对象
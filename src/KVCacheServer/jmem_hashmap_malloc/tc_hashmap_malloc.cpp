@@ -12,10 +12,19 @@
 * and limitations under the License.
 */
 #include "tc_hashmap_malloc.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include "util/tc_pack.h"
 #include "util/tc_common.h"
 #include "util/tc_timeprovider.h"
 
+//x中为0的字节置为0x80，其余字节为0，逐字节精确判断，没有借位造成的误判
+inline static uint64_t ZeroBytes(uint64_t x)
+{
+    const uint64_t LOW7 = 0x7F7F7F7F7F7F7F7FULL;
+    return ~(((x & LOW7) + LOW7) | x | LOW7);
+}
+
 inline static bool IsDigit(const string &key)
 {
     string::const_iterator iter = key.begin();
@@ -80,8 +89,28 @@ inline static bool IsDigit(const string &key)
     return true;
 }
 
+//按IsDigit的规则检查并取整数部分，小数部分截掉，和strto<Int64>结果一致
+//计数器每次更新都要解析和格式化，不经过stringstream
+inline static bool ParseDigit(const string &s, tars::Int64 &n)
+{
+    if (!IsDigit(s))
+    {
+        return false;
+    }
+    n = strtoll(s.c_str(), NULL, 10);
+    return true;
+}
+
+inline static string Int64ToStr(tars::Int64 n)
+{
+    char buf[32];
+    int len = snprintf(buf, sizeof(buf), "%lld", (long long)n);
+    return string(buf, len);
+}
+
 namespace DCache
 {
+    const uint32_t TC_HashMapMalloc::UNCOMPRESSED;
 
     int TC_HashMapMalloc::Block::getBlockData(TC_HashMapMalloc::BlockData &data)
     {
@@ -89,6 +118,7 @@ namespace DCache
         data._synct = getSyncTime();
         data._expiret = getExpireTime();
         data._ver = getVersion();
+        data._dictId = UNCOMPRESSED;
 
         int ret;
         uint32_t iGetLen;
@@ -108,6 +138,7 @@ namespace DCache
             if (!isOnlyKey())
             {
                 po >> data._value;
+                _pMap->unpackValue(po, data._value, data._dictId);
             }
             else
             {
@@ -200,6 +231,45 @@ namespace DCache
         return TC_HashMapMalloc::RT_OK;
     }
 
+    bool TC_HashMapMalloc::Block::startWith(const char *pData, uint32_t iLen)
+    {
+        tagBlockHead *pHead = getBlockHead();
+
+        //没有下一个chunk
+        if (!pHead->_bNextChunk)
+        {
+            return pHead->_iDataLen >= iLen && memcmp(pHead->_cData, pData, iLen) == 0;
+        }
+
+        uint32_t iCmpLen = min(pHead->_iSize - (uint32_t)sizeof(tagBlockHead), iLen);
+        if (memcmp(pHead->_cData, pData, iCmpLen) != 0)
+        {
+            return false;
+        }
+
+        //已经比较的长度
+        uint32_t iHasLen = iCmpLen;
+        tagChunkHead *pChunk = getChunkHead(pHead->_iNextChunk);
+        while (iHasLen < iLen)
+        {
+            uint32_t iUseSize = pChunk->_bNextChunk ? pChunk->_iSize - (uint32_t)sizeof(tagChunkHead) : pChunk->_iDataLen;
+            iCmpLen = min(iUseSize, iLen - iHasLen);
+            if (memcmp(pChunk->_cData, pData + iHasLen, iCmpLen) != 0)
+            {
+                return false;
+            }
+            iHasLen += iCmpLen;
+
+            if (!pChunk->_bNextChunk)
+            {
+                break;
+            }
+            pChunk = getChunkHead(pChunk->_iNextChunk);
+        }
+
+        return iHasLen == iLen;
+    }
+
     int TC_HashMapMalloc::Block::get(string &s)
     {
         uint32_t iLen = getDataLen();
@@ -612,6 +682,7 @@ namespace DCache
         _pMap->incDirtyCount();
         _pMap->incElementCount();
         _pMap->incListCount(index);
+        _pMap->pushFingerprint(index);
 
         //挂在block链表上
         if (_pMap->item(index)->_iBlockAddr == 0)
@@ -837,6 +908,19 @@ namespace DCache
 
         ///////////////////从block链表中去掉///////////
         //
+        //指纹只记录链表前8个block，往前数到第8个为止
+        if (_pMap->hasFingerprint())
+        {
+            uint32_t iPos = 0;
+            uint32_t iPrev = getBlockHead()->_iBlockPrev;
+            while (iPrev != 0 && iPos < 8)
+            {
+                ++iPos;
+                iPrev = getBlockHead(iPrev)->_iBlockPrev;
+            }
+            _pMap->popFingerprint(getBlockHead()->_iIndex, iPos);
+        }
+
         //上一个block指向下一个block
         if (getBlockHead()->_iBlockPrev != 0)
         {
@@ -1024,6 +1108,185 @@ namespace DCache
         }
     }
 
+    uint32_t TC_HashMapMalloc::Block::defrag(uint32_t iSparseRatio)
+    {
+        uint32_t iMoved = 0;
+
+        if (moveHead(iSparseRatio))
+        {
+            ++iMoved;
+        }
+
+        if (getBlockHead()->_bNextChunk)
+        {
+            iMoved += moveChunks(iSparseRatio);
+        }
+
+        return iMoved;
+    }
+
+    bool TC_HashMapMalloc::Block::moveHead(uint32_t iSparseRatio)
+    {
+        if (!_pMap->_pDataAllocator->isSparse(_iHead, iSparseRatio))
+        {
+            return false;
+        }
+
+        tagBlockHead *pOld = getBlockHead();
+
+        //有后续chunk时block头的容量已写满, 新block的容量必须相同; 否则只需容纳已使用的数据
+        uint32_t iUsedSize = pOld->_bNextChunk ? pOld->_iSize : (uint32_t)sizeof(tagBlockHead) + pOld->_iDataLen;
+        uint32_t iMaxSize = pOld->_bNextChunk ? pOld->_iSize : (uint32_t)(-1);
+        uint32_t iAllocSize = 0;
+        uint32_t iNew = _pMap->_pDataAllocator->allocateForMove(_iHead, iUsedSize, iMaxSize, iAllocSize);
+        if (iNew == 0)
+        {
+            return false;
+        }
+
+        //新block还没有挂到任何链上, 直接拷贝
+        tagBlockHead *pNew = getBlockHead(iNew);
+        memcpy(pNew, pOld, iUsedSize);
+        pNew->_iSize = iAllocSize;
+
+        //hash桶
+        if (pOld->_iBlockPrev == 0)
+        {
+            assert(_pMap->item(pOld->_iIndex)->_iBlockAddr == _iHead);
+            _pMap->saveValue(&_pMap->item(pOld->_iIndex)->_iBlockAddr, iNew);
+        }
+        else
+        {
+            _pMap->saveValue(&getBlockHead(pOld->_iBlockPrev)->_iBlockNext, iNew);
+        }
+        if (pOld->_iBlockNext != 0)
+        {
+            _pMap->saveValue(&getBlockHead(pOld->_iBlockNext)->_iBlockPrev, iNew);
+        }
+
+        //Set链
+        if (pOld->_iSetPrev == 0)
+        {
+            _pMap->saveValue(&_pMap->_pHead->_iSetHead, iNew);
+        }
+        else
+        {
+            _pMap->saveValue(&getBlockHead(pOld->_iSetPrev)->_iSetNext, iNew);
+        }
+        if (pOld->_iSetNext == 0)
+        {
+            _pMap->saveValue(&_pMap->_pHead->_iSetTail, iNew);
+        }
+        else
+        {
+            _pMap->saveValue(&getBlockHead(pOld->_iSetNext)->_iSetPrev, iNew);
+        }
+
+        //Get链
+        if (pOld->_iGetPrev == 0)
+        {
+            _pMap->saveValue(&_pMap->_pHead->_iGetHead, iNew);
+        }
+        else
+        {
+            _pMap->saveValue(&getBlockHead(pOld->_iGetPrev)->_iGetNext, iNew);
+        }
+        if (pOld->_iGetNext == 0)
+        {
+            _pMap->saveValue(&_pMap->_pHead->_iGetTail, iNew);
+        }
+        else
+        {
+            _pMap->saveValue(&getBlockHead(pOld->_iGetNext)->_iGetPrev, iNew);
+        }
+
+        //脏数据、回写、备份尾指针
+        if (_pMap->_pHead->_iDirtyTail == _iHead)
+        {
+            _pMap->saveValue(&_pMap->_pHead->_iDirtyTail, iNew);
+        }
+        if (_pMap->_pHead->_iSyncTail == _iHead)
+        {
+            _pMap->saveValue(&_pMap->_pHead->_iSyncTail, iNew);
+        }
+        if (_pMap->_pHead->_iBackupTail == _iHead)
+        {
+            _pMap->saveValue(&_pMap->_pHead->_iBackupTail, iNew);
+        }
+
+        //统计指针
+        if (_pMap->_iReadP == _iHead)
+        {
+            _pMap->_iReadP = iNew;
+        }
+        if (_pMap->_iReadPBak == _iHead)
+        {
+            _pMap->_iReadPBak = iNew;
+        }
+
+        //使修改生效后再释放旧block, 即使这时程序退出也只是丢失一个内存块
+        _pMap->doUpdate();
+        _pMap->_pDataAllocator->deallocateMemBlock(_iHead);
+
+        _iHead = iNew;
+        _pHead = pNew;
+
+        return true;
+    }
+
+    uint32_t TC_HashMapMalloc::Block::moveChunks(uint32_t iSparseRatio)
+    {
+        uint32_t iMoved = 0;
+
+        //前一个chunk的地址, 0表示前一个是block头
+        uint32_t iPrev = 0;
+        uint32_t iChunk = getBlockHead()->_iNextChunk;
+
+        while (true)
+        {
+            tagChunkHead *pChunk = getChunkHead(iChunk);
+
+            if (_pMap->_pDataAllocator->isSparse(iChunk, iSparseRatio))
+            {
+                uint32_t iUsedSize = pChunk->_bNextChunk ? pChunk->_iSize : (uint32_t)sizeof(tagChunkHead) + pChunk->_iDataLen;
+                uint32_t iMaxSize = pChunk->_bNextChunk ? pChunk->_iSize : (uint32_t)(-1);
+                uint32_t iAllocSize = 0;
+                uint32_t iNew = _pMap->_pDataAllocator->allocateForMove(iChunk, iUsedSize, iMaxSize, iAllocSize);
+                if (iNew != 0)
+                {
+                    tagChunkHead *pNew = getChunkHead(iNew);
+                    memcpy(pNew, pChunk, iUsedSize);
+                    pNew->_iSize = iAllocSize;
+
+                    if (iPrev == 0)
+                    {
+                        _pMap->saveValue(&getBlockHead()->_iNextChunk, iNew);
+                    }
+                    else
+                    {
+                        _pMap->saveValue(&getChunkHead(iPrev)->_iNextChunk, iNew);
+                    }
+                    _pMap->doUpdate();
+                    _pMap->_pDataAllocator->deallocateChunk(iChunk);
+
+                    iChunk = iNew;
+                    pChunk = pNew;
+                    ++iMoved;
+                }
+            }
+
+            if (!pChunk->_bNextChunk)
+            {
+                break;
+            }
+
+            iPrev = iChunk;
+            iChunk = pChunk->_iNextChunk;
+        }
+
+        return iMoved;
+    }
+
     void TC_HashMapMalloc::Block::deallocate(uint32_t iChunk)
     {
         tagChunkHead *pChunk = getChunkHead(iChunk);
@@ -1299,8 +1562,9 @@ namespace DCache
         }
 
         size_t iTmp1 = (size_t)((iAllocSize > _pMap->_iMinChunkSize) ? iAllocSize : _pMap->_iMinChunkSize);
-        size_t iClassSize = Static::sizemap()->SizeClass(iTmp1);
-        size_t size = Static::sizemap()->ByteSizeForClass(iClassSize);
+        SizeMap *pSizeMap = _pChunkAllocator->getSizeMap();
+        size_t iClassSize = pSizeMap->SizeClass(iTmp1);
+        size_t size = pSizeMap->ByteSizeForClass(iClassSize);
 
         //先查看数据是否变化
         if (iAllocSize == block.getBlockHead()->_iSize)
@@ -1343,6 +1607,30 @@ namespace DCache
         return iAddr;
     }
 
+    uint32_t TC_HashMapMalloc::BlockAllocator::allocateForMove(uint32_t iAddr, uint32_t iMinSize, uint32_t iMaxSize, uint32_t &iAllocSize)
+    {
+        size_t iPageId, iChunkIndex;
+        size_t iTmp1 = 0;
+        void* pAddr = _pChunkAllocator->allocateForMove((size_t)((iAddr >> 9) - 1), iTmp1, iPageId, iChunkIndex);
+        if (pAddr == NULL)
+        {
+            return 0;
+        }
+
+        //span末尾的内存块比同类别的其他内存块大, 大小不合适时不搬迁
+        if (iTmp1 < iMinSize || iTmp1 > iMaxSize)
+        {
+            _pChunkAllocator->deallocate(iPageId, iChunkIndex);
+            return 0;
+        }
+
+        iAllocSize = (uint32_t)iTmp1;
+        _pMap->incUsedDataMemSize(iAllocSize);
+        _pMap->incChunkCount();
+
+        return (uint32_t)(((iPageId + 1) << 9) | iChunkIndex);
+    }
+
     uint32_t TC_HashMapMalloc::BlockAllocator::allocateChunk(uint32_t iAddr, uint32_t &iAllocSize, vector<TC_HashMapMalloc::BlockData> &vtData)
     {
     begin:
@@ -1462,6 +1750,19 @@ namespace DCache
 
     int TC_HashMapMalloc::HashMapLockItem::get(string& k, string& v)
     {
+        //lock_iterator遍历期间一直持有锁，只能在这里解压
+        uint32_t iDictId;
+        int ret = get(k, v, iDictId);
+        if (ret == TC_HashMapMalloc::RT_OK && !_pMap->decodeValue(v, iDictId))
+        {
+            return TC_HashMapMalloc::RT_DECODE_ERR;
+        }
+        return ret;
+    }
+
+    int TC_HashMapMalloc::HashMapLockItem::get(string& k, string& v, uint32_t &iDictId)
+    {
+        iDictId = UNCOMPRESSED;
         Block block(_pMap, _iAddr);
 
         int ret = block.get(k);
@@ -1477,6 +1778,7 @@ namespace DCache
             if (!block.isOnlyKey())
             {
                 po >> v;
+                _pMap->unpackValue(po, v, iDictId);
             }
             else
             {
@@ -1515,11 +1817,11 @@ namespace DCache
         return TC_HashMapMalloc::RT_OK;
     }
 
-    int TC_HashMapMalloc::HashMapLockItem::set(const string& k, const string& v, uint32_t iExpireTime, uint8_t iVersion, bool bNewBlock, vector<TC_HashMapMalloc::BlockData> &vtData)
+    int TC_HashMapMalloc::HashMapLockItem::set(const string& k, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bNewBlock, vector<TC_HashMapMalloc::BlockData> &vtData)
     {
 	    tars::TC_PackIn pi;
         pi << k;
-        pi << v;
+        _pMap->packValue(pi, v, iDictId);
 
         Block block(_pMap, _iAddr);
 
@@ -1550,30 +1852,44 @@ namespace DCache
         return block.set(packData, bOnlyKey, iExpireTime, iVersion, bNewBlock, bCheckExpire, iNowTime, vtData);
     }
 
-    bool TC_HashMapMalloc::HashMapLockItem::equal(const string &k, string &v, int &ret)
+    bool TC_HashMapMalloc::HashMapLockItem::equal(const string &k, string &v, uint32_t &iDictId, int &ret)
     {
-        string k1;
-        ret = get(k1, v);
-
-        if ((ret == TC_HashMapMalloc::RT_OK || ret == TC_HashMapMalloc::RT_ONLY_KEY) && k == k1)
-        {
-            return true;
-        }
+        tars::TC_PackIn pi;
+        pi << k;
 
-        return false;
+        return equalPacked(pi.topacket(), v, iDictId, ret);
     }
 
     bool TC_HashMapMalloc::HashMapLockItem::equal(const string& k, int &ret)
     {
-        string k1;
-        ret = get(k1);
+        tars::TC_PackIn pi;
+        pi << k;
+
+        return equalPacked(pi.topacket(), ret);
+    }
+
+    bool TC_HashMapMalloc::HashMapLockItem::equalPacked(const string &sPackKey, string &v, uint32_t &iDictId, int &ret)
+    {
+        ret = TC_HashMapMalloc::RT_OK;
 
-        if (ret == TC_HashMapMalloc::RT_OK && k == k1)
+        Block block(_pMap, _iAddr);
+        if (!block.startWith(sPackKey.c_str(), sPackKey.length()))
         {
-            return true;
+            return false;
         }
 
-        return false;
+        string k1;
+        ret = get(k1, v, iDictId);
+
+        return ret == TC_HashMapMalloc::RT_OK || ret == TC_HashMapMalloc::RT_ONLY_KEY;
+    }
+
+    bool TC_HashMapMalloc::HashMapLockItem::equalPacked(const string &sPackKey, int &ret)
+    {
+        ret = TC_HashMapMalloc::RT_OK;
+
+        Block block(_pMap, _iAddr);
+        return block.startWith(sPackKey.c_str(), sPackKey.length());
     }
 
     void TC_HashMapMalloc::HashMapLockItem::nextItem(int iType)
@@ -1947,6 +2263,30 @@ namespace DCache
 
         return RT_OK;
     }
+
+    int TC_HashMapMalloc::HashMapItem::defrag(uint32_t iSparseRatio, uint32_t &iMoved)
+    {
+        iMoved = 0;
+
+        if (_pMap->getMapHead()._bReadOnly) return RT_READONLY;
+
+        uint32_t iAddr = _pMap->item(_iIndex)->_iBlockAddr;
+
+        while (iAddr != 0)
+        {
+            Block block(_pMap, iAddr);
+
+            {
+                TC_HashMapMalloc::FailureRecover check(_pMap);
+                iMoved += block.defrag(iSparseRatio);
+            }
+
+            //搬迁后block的地址可能已改变, 从新地址取下一个
+            iAddr = block.getBlockHead()->_iBlockNext;
+        }
+
+        return RT_OK;
+    }
     ///////////////////////////////////////////////////////////////////
 
     TC_HashMapMalloc::HashMapIterator::HashMapIterator()
@@ -2026,12 +2366,45 @@ namespace DCache
         _iAvgDataSize = iAvgDataSize;
     }
 
+    bool TC_HashMapMalloc::initSizeClass(const vector<size_t> &vtClassSize)
+    {
+        if (!vtClassSize.empty())
+        {
+            SizeMap sizeMap;
+            if (!sizeMap.Init(vtClassSize))
+            {
+                return false;
+            }
+        }
+
+        _vtClassSize = vtClassSize;
+
+        return true;
+    }
+
+    void TC_HashMapMalloc::getSizeClassInfo(vector<uint64_t> &vtHist, vector<size_t> &vtClassSize, uint64_t &iWaste)
+    {
+        const vector<uint64_t> &vtMyHist = _pDataAllocator->getSizeHist();
+        if (vtHist.size() < vtMyHist.size())
+        {
+            vtHist.resize(vtMyHist.size(), 0);
+        }
+        for (size_t i = 0; i < vtMyHist.size(); ++i)
+        {
+            vtHist[i] += vtMyHist[i];
+        }
+
+        SizeMap *pSizeMap = _pDataAllocator->getSizeMap();
+        pSizeMap->GetClassSize(vtClassSize);
+        iWaste += pSizeMap->EstimateWaste(vtMyHist);
+    }
+
     void TC_HashMapMalloc::create(void *pAddr, size_t iSize)
     {
         if (sizeof(tagHashItem) * 1
             + sizeof(tagMapHead)
             + sizeof(tagModifyHead)
-            + sizeof(TC_MallocChunkAllocator::tagChunkAllocatorHead)
+            + TC_MallocChunkAllocator::getHeadSize(true)
             + 10 > iSize)
         {
             throw TC_HashMapMalloc_Exception("[TC_HashMapMalloc::create] mem size not enougth.");
@@ -2069,6 +2442,9 @@ namespace DCache
         _pHead->_iHitCount = 0;
         _pHead->_iBackupTail = 0;
         _pHead->_iSyncTail = 0;
+        _pHead->_cHashType = _cHashType;
+        _pHead->_bSizeClassTable = true;
+        _pHead->_bFingerprint = _bFingerprint;
         memset(_pHead->_cReserve, 0, sizeof(_pHead->_cReserve));
 
         _pstModifyHead->_cModifyStatus = 0;
@@ -2077,8 +2453,9 @@ namespace DCache
         //计算平均block大小
         uint32_t iBlockSize = ((_pHead->_iAvgDataSize + sizeof(Block::tagBlockHead)) > _iMinChunkSize) ? (_pHead->_iAvgDataSize + sizeof(Block::tagBlockHead)) : _iMinChunkSize;
 
-        //Hash个数
-        uint32_t iHashCount = (iSize - sizeof(tagMapHead) - sizeof(tagModifyHead) - sizeof(TC_MallocChunkAllocator::tagChunkAllocatorHead)) / ((uint32_t)(iBlockSize*_fRadio) + sizeof(tagHashItem));
+        //Hash个数, 带指纹数组时每个hash桶多8个字节
+        uint32_t iHashItemSize = sizeof(tagHashItem) + (_bFingerprint ? sizeof(uint64_t) : 0);
+        uint32_t iHashCount = (iSize - sizeof(tagMapHead) - sizeof(tagModifyHead) - TC_MallocChunkAllocator::getHeadSize(true) - (_bFingerprint ? 64 : 0)) / ((uint32_t)(iBlockSize*_fRadio) + iHashItemSize);
         //采用最近的素数作为hash值
         iHashCount = getMinPrimeNumber(iHashCount);
 
@@ -2087,9 +2464,13 @@ namespace DCache
         uint32_t iHashMemSize = tars::TC_MemVector<tagHashItem>::calcMemSize(iHashCount);
         _hash.create(pHashAddr, iHashMemSize);
 
-        void *pDataAddr = (char*)pHashAddr + _hash.getMemSize();
+        void *pDataAddr = initFingerprintAddr((char*)pHashAddr + _hash.getMemSize());
+        if (_pFingerprint != NULL)
+        {
+            memset(_pFingerprint, 0, _hash.size() * sizeof(uint64_t));
+        }
 
-        _pDataAllocator->create(pDataAddr, iSize - ((char*)pDataAddr - (char*)_pHead));
+        _pDataAllocator->create(pDataAddr, iSize - ((char*)pDataAddr - (char*)_pHead), _vtClassSize);
 
         if ((uint64_t)_pDataAllocator->getAllCapacity() > ((uint64_t)((uint32_t)(-1) >> 9)*(1 << 9)*_iMinChunkSize))
         {
@@ -2131,12 +2512,17 @@ namespace DCache
             throw TC_HashMapMalloc_Exception("[TC_HashMapMalloc::connect] hash map MinChunkSize not equal:" + tars::TC_Common::tostr(_pHead->_iMinChunkSize) + "!=" + tars::TC_Common::tostr(_iMinChunkSize) + " (data != code)");
         }
 
+        if (_pHead->_cHashType != _cHashType)
+        {
+            throw TC_HashMapMalloc_Exception("[TC_HashMapMalloc::connect] hash map HashType not equal:" + tars::TC_Common::tostr((int)_pHead->_cHashType) + "!=" + tars::TC_Common::tostr((int)_cHashType) + " (data != code)");
+        }
+
         void *pHashAddr = (char*)_pHead + sizeof(tagMapHead) + sizeof(tagModifyHead);
         _hash.connect(pHashAddr);
 
-        void *pDataAddr = (char*)pHashAddr + _hash.getMemSize();
+        void *pDataAddr = initFingerprintAddr((char*)pHashAddr + _hash.getMemSize());
 
-        _pDataAllocator->connect(pDataAddr);
+        _pDataAllocator->connect(pDataAddr, _pHead->_bSizeClassTable);
 
         _iAvgDataSize = _pHead->_iAvgDataSize;
         _fRadio = _pHead->_fRadio;
@@ -2180,11 +2566,16 @@ namespace DCache
             throw TC_HashMapMalloc_Exception("[TC_HashMapMalloc::append] hash map MinChunkSize not equal:" + tars::TC_Common::tostr(_pHead->_iMinChunkSize) + "!=" + tars::TC_Common::tostr(_iMinChunkSize) + " (data != code)");
         }
 
+        if (_pHead->_cHashType != _cHashType)
+        {
+            throw TC_HashMapMalloc_Exception("[TC_HashMapMalloc::append] hash map HashType not equal:" + tars::TC_Common::tostr((int)_pHead->_cHashType) + "!=" + tars::TC_Common::tostr((int)_cHashType) + " (data != code)");
+        }
+
         void *pHashAddr = (char*)_pHead + sizeof(tagMapHead) + sizeof(tagModifyHead);
         _hash.connect(pHashAddr);
 
-        void *pDataAddr = (char*)pHashAddr + _hash.getMemSize();
-        _pDataAllocator->connect(pDataAddr);
+        void *pDataAddr = initFingerprintAddr((char*)pHashAddr + _hash.getMemSize());
+        _pDataAllocator->connect(pDataAddr, _pHead->_bSizeClassTable);
         if ((uint64_t)(_pDataAllocator->getAllCapacity() + (iSize - _pHead->_iMemSize)) > ((uint64_t)((uint32_t)(-1) >> 9)*(1 << 9)*_iMinChunkSize))
         {
             throw TC_HashMapMalloc_Exception("[TC_HashMapMalloc::append] append mem size too large");
@@ -2219,8 +2610,16 @@ namespace DCache
         _pHead->_iSyncTail = 0;
 
         _hash.clear();
+        if (_pFingerprint != NULL)
+        {
+            memset(_pFingerprint, 0, _hash.size() * sizeof(uint64_t));
+        }
 
-        _pDataAllocator->rebuild();
+        //数据已清空, 可以更换尺寸类别
+        if (!_pHead->_bSizeClassTable || !_pDataAllocator->rebuild(_vtClassSize))
+        {
+            _pDataAllocator->rebuild();
+        }
         _pHead->_bInit = true;
     }
 
@@ -2287,6 +2686,13 @@ namespace DCache
                     delete[] pBuffer;
                     return RT_VERSION_MISMATCH_ERR;
                 }
+
+                // hash类型不同，数据所在的hash桶不对
+                if (((tagMapHead*)pBuffer)->_cHashType != _cHashType)
+                {
+                    delete[] pBuffer;
+                    return RT_VERSION_MISMATCH_ERR;
+                }
             }
 
             memcpy((char*)_pHead + iLen, pBuffer, ret);
@@ -2298,12 +2704,19 @@ namespace DCache
         delete[] pBuffer;
         if (iLen == _pHead->_iMemSize)
         {
+            reconnectData();
             return RT_OK;
         }
 
         return RT_LOAL_FILE_ERR;
     }
 
+    void TC_HashMapMalloc::reconnectData()
+    {
+        void *pDataAddr = (char*)_pHead + sizeof(tagMapHead) + sizeof(tagModifyHead) + _hash.getMemSize();
+        _pDataAllocator->connect(pDataAddr, _pHead->_bSizeClassTable);
+    }
+
     int TC_HashMapMalloc::recover(size_t i, bool bRepair)
     {
         doUpdate();
@@ -2346,12 +2759,16 @@ namespace DCache
     }
 
     int TC_HashMapMalloc::checkDirty(const string &k, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
+    {
+        return checkDirty(k, hashIndex(k), bCheckExpire, iNowTime);
+    }
+
+    int TC_HashMapMalloc::checkDirty(const string &k, uint32_t index, bool bCheckExpire, uint32_t iNowTime)
     {
         FailureRecover check(this);
         incGetCount();
 
         int ret = TC_HashMapMalloc::RT_OK;
-        uint32_t index = hashIndex(k);
         lock_iterator it = find(k, index, ret);
         if (ret != TC_HashMapMalloc::RT_OK)
         {
@@ -2492,15 +2909,20 @@ namespace DCache
         return TC_HashMapMalloc::RT_OK;
     }
 
-    int TC_HashMapMalloc::get(const string& k, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
+    int TC_HashMapMalloc::get(const string& k, string &v, uint32_t &iDictId, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
+    {
+        return get(k, hashIndex(k), v, iDictId, iSyncTime, iExpireTime, iVersion, bCheckExpire, iNowTime);
+    }
+
+    int TC_HashMapMalloc::get(const string& k, uint32_t index, string &v, uint32_t &iDictId, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire, uint32_t iNowTime)
     {
         FailureRecover check(this);
         incGetCount();
 
         int ret = TC_HashMapMalloc::RT_OK;
+        iDictId = UNCOMPRESSED;
 
-        uint32_t index = hashIndex(k);
-        lock_iterator it = find(k, index, v, ret);
+        lock_iterator it = find(k, index, v, iDictId, ret);
 
         if (ret != TC_HashMapMalloc::RT_OK && ret != TC_HashMapMalloc::RT_ONLY_KEY)
         {
@@ -2541,15 +2963,16 @@ namespace DCache
         return TC_HashMapMalloc::RT_OK;
     }
 
-    int TC_HashMapMalloc::get(const string& k, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool& bDirty, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
+    int TC_HashMapMalloc::get(const string& k, string &v, uint32_t &iDictId, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool& bDirty, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
     {
         FailureRecover check(this);
         incGetCount();
 
         int ret = TC_HashMapMalloc::RT_OK;
+        iDictId = UNCOMPRESSED;
 
         uint32_t index = hashIndex(k);
-        lock_iterator it = find(k, index, v, ret);
+        lock_iterator it = find(k, index, v, iDictId, ret);
 
         if (ret != TC_HashMapMalloc::RT_OK && ret != TC_HashMapMalloc::RT_ONLY_KEY)
         {
@@ -2591,27 +3014,27 @@ namespace DCache
         return TC_HashMapMalloc::RT_OK;
     }
 
-    int TC_HashMapMalloc::get(const string& k, string &v, uint32_t &iSyncTime, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
+    int TC_HashMapMalloc::get(const string& k, string &v, uint32_t &iDictId, uint32_t &iSyncTime, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
     {
         uint32_t iExpireTime;
         uint8_t iVersion;
-        return get(k, v, iSyncTime, iExpireTime, iVersion);
+        return get(k, v, iDictId, iSyncTime, iExpireTime, iVersion);
     }
 
-    int TC_HashMapMalloc::get(const string& k, string &v, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
+    int TC_HashMapMalloc::get(const string& k, string &v, uint32_t &iDictId, bool bCheckExpire /*= false*/, uint32_t iNowTime /*= -1*/)
     {
         uint32_t iSyncTime;
         uint32_t iExpireTime;
         uint8_t iVersion;
-        return get(k, v, iSyncTime, iExpireTime, iVersion);
+        return get(k, v, iDictId, iSyncTime, iExpireTime, iVersion);
     }
 
-    int TC_HashMapMalloc::set(const string& k, const string& v, bool bDirty, vector<BlockData> &vtData)
+    int TC_HashMapMalloc::set(const string& k, const string& v, uint32_t iDictId, bool bDirty, vector<BlockData> &vtData)
     {
-        return set(k, v, 0, 0, bDirty, vtData);
+        return set(k, v, iDictId, 0, 0, bDirty, vtData);
     }
 
-    int TC_HashMapMalloc::set(const string& k, const string& v, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, vector<BlockData> &vtData)
+    int TC_HashMapMalloc::set(const string& k, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, vector<BlockData> &vtData)
     {
         FailureRecover check(this);
         incGetCount();
@@ -2629,7 +3052,7 @@ namespace DCache
 
 	    tars::TC_PackIn pi;
         pi << k;
-        pi << v;
+        packValue(pi, v, iDictId);
         uint32_t iAllocSize = sizeof(Block::tagBlockHead) + pi.topacket().length();
 
         uint32_t iOldAddr;
@@ -2681,6 +3104,9 @@ namespace DCache
             block.erase();
         }
 
+        //新写入的block在hash链开头
+        setFingerprint(index, it->getAddr(), k);
+
         Block block(this, it->getAddr());
         if (bNewBlock)
         {
@@ -2692,14 +3118,18 @@ namespace DCache
         return TC_HashMapMalloc::RT_OK;
     }
 
-    int TC_HashMapMalloc::set(const string& k, const string& v, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, bool bCheckExpire, uint32_t iNowTime, vector<BlockData> &vtData)
+    int TC_HashMapMalloc::set(const string& k, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, bool bCheckExpire, uint32_t iNowTime, vector<BlockData> &vtData)
+    {
+        return set(k, hashIndex(k), v, iDictId, iExpireTime, iVersion, bDirty, bCheckExpire, iNowTime, vtData);
+    }
+
+    int TC_HashMapMalloc::set(const string& k, uint32_t index, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, bool bCheckExpire, uint32_t iNowTime, vector<BlockData> &vtData)
     {
         FailureRecover check(this);
         incGetCount();
 
         if (_pHead->_bReadOnly) return RT_READONLY;
         int ret = TC_HashMapMalloc::RT_OK;
-        uint32_t index = hashIndex(k);
         lock_iterator it = find(k, index, ret);
         bool bNewBlock = false;
 
@@ -2710,7 +3140,7 @@ namespace DCache
 
         tars::TC_PackIn pi;
         pi << k;
-        pi << v;
+        packValue(pi, v, iDictId);
         uint32_t iAllocSize = sizeof(Block::tagBlockHead) + pi.topacket().length();
 
         uint32_t iOldAddr;
@@ -2762,6 +3192,9 @@ namespace DCache
             block.erase();
         }
 
+        //新写入的block在hash链开头
+        setFingerprint(index, it->getAddr(), k);
+
         Block block(this, it->getAddr());
         if (bNewBlock)
         {
@@ -2825,6 +3258,9 @@ namespace DCache
             return ret;
         }
 
+        //新写入的block在hash链开头
+        setFingerprint(index, it->getAddr(), k);
+
         Block block(this, it->getAddr());
         if (bNewBlock)
         {
@@ -2843,18 +3279,22 @@ namespace DCache
         if (_pHead->_bReadOnly) return RT_READONLY;
         int ret = TC_HashMapMalloc::RT_OK;
         string oldValue;
+        uint32_t iOldDictId = UNCOMPRESSED;
         uint32_t index = hashIndex(k);
-        lock_iterator it = find(k, index, oldValue, ret);
+        lock_iterator it = find(k, index, oldValue, iOldDictId, ret);
 
         if (ret != TC_HashMapMalloc::RT_OK && ret != TC_HashMapMalloc::RT_ONLY_KEY)
         {
             return ret;
         }
 
+        tars::Int64 iDelta = 0;
         if (option == ADD || option == SUB || option == ADD_INSERT || option == SUB_INSERT)
         {
-            if (!IsDigit(v))
+            if (!ParseDigit(v, iDelta))
                 return TC_HashMapMalloc::RT_DATATYPE_ERR;
+            if (option == SUB || option == SUB_INSERT)
+                iDelta = -iDelta;
         }
 
         bool bNeedNew = false;
@@ -2901,6 +3341,12 @@ namespace DCache
             }
         }
 
+        //不在锁内解压，由jmem在锁外改为不压缩保存后重试
+        if (!bNeedNew && iOldDictId != UNCOMPRESSED)
+        {
+            return TC_HashMapMalloc::RT_VALUE_COMPRESSED;
+        }
+
         if (bNeedNew)
         {
 	        tars::TC_PackIn pi;
@@ -2926,21 +3372,17 @@ namespace DCache
         switch (option)
         {
         case ADD:
-            if (IsDigit(oldValue))
-            {
-                retValue = tars::TC_Common::tostr(tars::TC_Common::strto<tars::Int64>(oldValue) + tars::TC_Common::strto<tars::Int64>(v));
-            }
-            else
-                return TC_HashMapMalloc::RT_DATATYPE_ERR;
-            break;
         case SUB:
-            if (IsDigit(oldValue))
-            {
-                retValue = tars::TC_Common::tostr(tars::TC_Common::strto<tars::Int64>(oldValue) - tars::TC_Common::strto<tars::Int64>(v));
-            }
-            else
+        case ADD_INSERT:
+        case SUB_INSERT:
+        {
+            tars::Int64 iOld = 0;
+            if (!ParseDigit(oldValue, iOld))
                 return TC_HashMapMalloc::RT_DATATYPE_ERR;
-            break;
+            //结果长度不超过原来分配的空间时，Block::set在原block内覆盖写，不重新分配
+            retValue = Int64ToStr(iOld + iDelta);
+        }
+        break;
         case APPEND:
         {
             retValue = oldValue + v;
@@ -2951,22 +3393,6 @@ namespace DCache
             retValue = v + oldValue;
         }
         break;
-        case ADD_INSERT:
-            if (IsDigit(oldValue))
-            {
-                retValue = tars::TC_Common::tostr(tars::TC_Common::strto<tars::Int64>(oldValue) + tars::TC_Common::strto<tars::Int64>(v));
-            }
-            else
-                return TC_HashMapMalloc::RT_DATATYPE_ERR;
-            break;
-        case SUB_INSERT:
-            if (IsDigit(oldValue))
-            {
-                retValue = tars::TC_Common::tostr(tars::TC_Common::strto<tars::Int64>(oldValue) - tars::TC_Common::strto<tars::Int64>(v));
-            }
-            else
-                return TC_HashMapMalloc::RT_DATATYPE_ERR;
-            break;
         default:
             return TC_HashMapMalloc::RT_DECODE_ERR;
 
@@ -2974,7 +3400,7 @@ namespace DCache
 
 	    tars::TC_PackIn pi;
         pi << k;
-        pi << retValue;
+        packValue(pi, retValue, UNCOMPRESSED);
 
         ret = it->set(pi.topacket(), false, iExpireTime, 0, false, vtData);
 
@@ -2989,6 +3415,8 @@ namespace DCache
             return ret;
         }
 
+        setFingerprint(index, it->getAddr(), k);
+
         //Block block(this, it->getAddr());
         block.setDirty(bDirty);
         block.refreshSetList();
@@ -3008,7 +3436,7 @@ namespace DCache
 
         data._key = k;
 
-        lock_iterator it = find(k, index, data._value, ret);
+        lock_iterator it = find(k, index, data._value, data._dictId, ret);
         if (ret != TC_HashMapMalloc::RT_OK && ret != TC_HashMapMalloc::RT_ONLY_KEY)
         {
             return ret;
@@ -3038,7 +3466,7 @@ namespace DCache
 
         data._key = k;
 
-        lock_iterator it = find(k, index, data._value, ret);
+        lock_iterator it = find(k, index, data._value, data._dictId, ret);
         if (ret != TC_HashMapMalloc::RT_OK && ret != TC_HashMapMalloc::RT_ONLY_KEY)
         {
             return ret;
@@ -3263,19 +3691,42 @@ namespace DCache
         uint32_t index = hashIndex(k);
         int ret = TC_HashMapMalloc::RT_OK;
 
-        if (item(index)->_iBlockAddr == 0)
+        //指纹都不匹配时不用访问hash链
+        uint64_t iMatch = matchFingerprint(index, _pFingerprint != NULL ? fingerprint(k) : 0);
+        if (iMatch == 0 || item(index)->_iBlockAddr == 0)
         {
             return end();
         }
 
+        //key只打包一次, 链表上的block只比较打包后的key
+        tars::TC_PackIn pi;
+        pi << k;
+        const string &sPackKey = pi.topacket();
+
         Block mb(this, item(index)->_iBlockAddr);
+        uint32_t iPos = 0;
         while (true)
         {
-            HashMapLockItem mcmdi(this, mb.getHead());
-            if (mcmdi.equal(k, ret))
+            //指纹不匹配的位置不比较key
+            if (iMatch & 0x80)
             {
-                incHitCount();
-                return lock_iterator(this, mb.getHead(), lock_iterator::IT_BLOCK, lock_iterator::IT_NEXT);
+                HashMapLockItem mcmdi(this, mb.getHead());
+                if (mcmdi.equalPacked(sPackKey, ret))
+                {
+                    incHitCount();
+                    return lock_iterator(this, mb.getHead(), lock_iterator::IT_BLOCK, lock_iterator::IT_NEXT);
+                }
+            }
+
+            //第7个之后的block都用最后一个字节
+            if (iPos < 7)
+            {
+                ++iPos;
+                iMatch >>= 8;
+                if (iMatch == 0)
+                {
+                    return end();
+                }
             }
 
             if (!mb.nextBlock())
@@ -3374,6 +3825,8 @@ namespace DCache
             s << "[AvgDataSize      = " << _pHead->_iAvgDataSize << "]" << endl;
             s << "[HashCount        = " << _hash.size() << "]" << endl;
             s << "[HashRadio        = " << _pHead->_fRadio << "]" << endl;
+            s << "[HashType         = " << (int)_pHead->_cHashType << "]" << endl;
+            s << "[SizeClassNum     = " << _pDataAllocator->getSizeMap()->NumClasses() - 1 << "]" << endl;
             s << "[ElementCount     = " << _pHead->_iElementCount << "]" << endl;
             s << "[SetHead          = " << _pHead->_iSetHead << "]" << endl;
             s << "[SetTail          = " << _pHead->_iSetTail << "]" << endl;
@@ -3483,23 +3936,134 @@ namespace DCache
         return _hashf(k) % _hash.size();
     }
 
-    TC_HashMapMalloc::lock_iterator TC_HashMapMalloc::find(const string& k, uint32_t index, string &v, int &ret)
+    uint8_t TC_HashMapMalloc::fingerprint(const string &k)
+    {
+        //FNV-1a
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < k.length(); ++i)
+        {
+            h = (h ^ (uint8_t)k[i]) * 16777619u;
+        }
+        return (uint8_t)(1 + (h ^ (h >> 16)) % 254);
+    }
+
+    uint64_t TC_HashMapMalloc::matchFingerprint(uint32_t index, uint8_t iTag)
+    {
+        if (_pFingerprint == NULL)
+        {
+            return 0x8080808080808080ULL;
+        }
+
+        //8个指纹按字节同时比较，等于iTag或未知的位置需要比较key
+        uint64_t iTags = _pFingerprint[index];
+        return ZeroBytes(iTags ^ (0x0101010101010101ULL * iTag)) | ZeroBytes(~iTags);
+    }
+
+    void TC_HashMapMalloc::pushFingerprint(uint32_t index)
+    {
+        if (_pFingerprint == NULL)
+        {
+            return;
+        }
+
+        uint64_t iTags = _pFingerprint[index];
+        uint64_t iNewTags = (iTags << 8) | FP_UNKNOWN;
+
+        //原来已有8个block，移出去的block之后只能按未知处理
+        if ((iTags >> 56) != FP_EMPTY)
+        {
+            iNewTags |= (uint64_t)FP_UNKNOWN << 56;
+        }
+        saveValue(&_pFingerprint[index], iNewTags);
+    }
+
+    void TC_HashMapMalloc::setFingerprint(uint32_t index, uint32_t iAddr, const string &k)
+    {
+        if (_pFingerprint == NULL || item(index)->_iBlockAddr != iAddr)
+        {
+            return;
+        }
+
+        uint64_t iTags = _pFingerprint[index];
+        if ((iTags & 0xFF) == FP_UNKNOWN)
+        {
+            saveValue(&_pFingerprint[index], (iTags & ~0xFFULL) | fingerprint(k));
+        }
+    }
+
+    void TC_HashMapMalloc::popFingerprint(uint32_t index, uint32_t iPos)
+    {
+        //第8个之后的block没有单独的指纹
+        if (_pFingerprint == NULL || iPos >= 8)
+        {
+            return;
+        }
+
+        uint64_t iTags = _pFingerprint[index];
+        uint64_t iLowMask = (1ULL << (iPos * 8)) - 1;
+        uint64_t iNewTags = (iTags & iLowMask) | ((iTags >> 8) & ~iLowMask);
+
+        //最后一位是未知时, 后面可能还有block
+        if ((iTags >> 56) == FP_UNKNOWN)
+        {
+            iNewTags |= (uint64_t)FP_UNKNOWN << 56;
+        }
+        saveValue(&_pFingerprint[index], iNewTags);
+    }
+
+    void *TC_HashMapMalloc::initFingerprintAddr(char *pAddr)
+    {
+        if (!_pHead->_bFingerprint)
+        {
+            _pFingerprint = NULL;
+            return pAddr;
+        }
+
+        //共享内存按页对齐，按绝对地址对齐后各进程的偏移相同，一个hash桶的指纹不跨cache line
+        _pFingerprint = (uint64_t*)(((size_t)pAddr + 63) & ~(size_t)63);
+        return _pFingerprint + _hash.size();
+    }
+
+    TC_HashMapMalloc::lock_iterator TC_HashMapMalloc::find(const string& k, uint32_t index, string &v, uint32_t &iDictId, int &ret)
     {
         ret = TC_HashMapMalloc::RT_OK;
 
-        if (item(index)->_iBlockAddr == 0)
+        //指纹都不匹配时不用访问hash链
+        uint64_t iMatch = matchFingerprint(index, _pFingerprint != NULL ? fingerprint(k) : 0);
+        if (iMatch == 0 || item(index)->_iBlockAddr == 0)
         {
             return end();
         }
 
+        //key只打包一次, 链表上的block只比较打包后的key
+        tars::TC_PackIn pi;
+        pi << k;
+        const string &sPackKey = pi.topacket();
+
         Block mb(this, item(index)->_iBlockAddr);
+        uint32_t iPos = 0;
         while (true)
         {
-            HashMapLockItem mcmdi(this, mb.getHead());
-            if (mcmdi.equal(k, v, ret))
+            //指纹不匹配的位置不比较key
+            if (iMatch & 0x80)
             {
-                incHitCount();
-                return lock_iterator(this, mb.getHead(), lock_iterator::IT_BLOCK, lock_iterator::IT_NEXT);
+                HashMapLockItem mcmdi(this, mb.getHead());
+                if (mcmdi.equalPacked(sPackKey, v, iDictId, ret))
+                {
+                    incHitCount();
+                    return lock_iterator(this, mb.getHead(), lock_iterator::IT_BLOCK, lock_iterator::IT_NEXT);
+                }
+            }
+
+            //第7个之后的block都用最后一个字节
+            if (iPos < 7)
+            {
+                ++iPos;
+                iMatch >>= 8;
+                if (iMatch == 0)
+                {
+                    return end();
+                }
             }
 
             if (!mb.nextBlock())
@@ -3515,19 +4079,42 @@ namespace DCache
     {
         ret = TC_HashMapMalloc::RT_OK;
 
-        if (item(index)->_iBlockAddr == 0)
+        //指纹都不匹配时不用访问hash链
+        uint64_t iMatch = matchFingerprint(index, _pFingerprint != NULL ? fingerprint(k) : 0);
+        if (iMatch == 0 || item(index)->_iBlockAddr == 0)
         {
             return end();
         }
 
+        //key只打包一次, 链表上的block只比较打包后的key
+        tars::TC_PackIn pi;
+        pi << k;
+        const string &sPackKey = pi.topacket();
+
         Block mb(this, item(index)->_iBlockAddr);
+        uint32_t iPos = 0;
         while (true)
         {
-            HashMapLockItem mcmdi(this, mb.getHead());
-            if (mcmdi.equal(k, ret))
+            //指纹不匹配的位置不比较key
+            if (iMatch & 0x80)
+            {
+                HashMapLockItem mcmdi(this, mb.getHead());
+                if (mcmdi.equalPacked(sPackKey, ret))
+                {
+                    incHitCount();
+                    return lock_iterator(this, mb.getHead(), lock_iterator::IT_BLOCK, lock_iterator::IT_NEXT);
+                }
+            }
+
+            //第7个之后的block都用最后一个字节
+            if (iPos < 7)
             {
-                incHitCount();
-                return lock_iterator(this, mb.getHead(), lock_iterator::IT_BLOCK, lock_iterator::IT_NEXT);
+                ++iPos;
+                iMatch >>= 8;
+                if (iMatch == 0)
+                {
+                    return end();
+                }
             }
 
             if (!mb.nextBlock())
@@ -3722,5 +4309,50 @@ namespace DCache
         _pDataAllocator->deallocateMemBlock(iHead);
     }
 
+    void TC_HashMapMalloc::packValue(tars::TC_PackIn &pi, const string &v, uint32_t iDictId)
+    {
+        pi << v;
+        if (iDictId != UNCOMPRESSED)
+        {
+            pi << iDictId;
+        }
+    }
+
+    void TC_HashMapMalloc::unpackValue(tars::TC_PackOut &po, string &v, uint32_t &iDictId)
+    {
+        //value后没有字典id的是未压缩的数据
+        iDictId = UNCOMPRESSED;
+        if (!po.isEnd())
+        {
+            po >> iDictId;
+        }
+    }
+
+    const string &TC_HashMapMalloc::encodeValue(const string &v, string &sCompress, uint32_t &iDictId)
+    {
+        if (_pValueCodec != NULL && _pValueCodec->compress(v, sCompress, iDictId))
+        {
+            return sCompress;
+        }
+        iDictId = UNCOMPRESSED;
+        return v;
+    }
+
+    bool TC_HashMapMalloc::decodeValue(string &v, uint32_t iDictId)
+    {
+        if (iDictId == UNCOMPRESSED)
+        {
+            return true;
+        }
+
+        string sRaw;
+        if (_pValueCodec == NULL || !_pValueCodec->uncompress(v, iDictId, sRaw))
+        {
+            return false;
+        }
+        v.swap(sRaw);
+        return true;
+    }
+
 }
 
@@ -63,11 +63,13 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
             uint32_t _synct;     //sync time, 不一定是真正的回写时间
             uint32_t _expiret;	// 数据过期的绝对时间，由设置或更新数据时提供，0表示不关心此时间
             uint8_t	_ver;		// 数据版本，1为初始版本，0为保留
+            uint32_t _dictId;   // value压缩使用的字典，UNCOMPRESSED表示未压缩，由jmem在释放锁后解压
             BlockData()
                 : _dirty(false)
                 , _synct(0)
                 , _expiret(0)
                 , _ver(1)
+                , _dictId(UNCOMPRESSED)
             {
             }
         };
@@ -244,6 +246,15 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              */
             int get(void *pData, uint32_t &iDataLen);
 
+            /**
+             * 数据是否以pData开头, 逐个chunk比较, 不拷贝数据,
+             * 不匹配时一般只访问block头所在的cache line
+             * @param pData
+             * @param iLen
+             * @return bool
+             */
+            bool startWith(const char *pData, uint32_t iLen);
+
             /**
              * 获取数据
              * @param s
@@ -357,8 +368,28 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              */
             void refreshGetList();
 
+            /**
+             * 碎片整理, 把位于稀疏span上的block头和chunk搬到同类别中更满的span上
+             * 搬迁后block的地址会改变, 通过getHead()获取新地址
+             * @param iSparseRatio, span的使用率(百分比)低于该值时搬迁
+             * @return uint32_t, 搬迁的内存块个数
+             */
+            uint32_t defrag(uint32_t iSparseRatio);
+
         protected:
 
+            /**
+             * 搬迁block头, 并修改hash桶、Set链、Get链以及脏数据、回写、备份尾指针
+             * @return bool, 是否搬迁了
+             */
+            bool moveHead(uint32_t iSparseRatio);
+
+            /**
+             * 搬迁后续的chunk, 修改前一个内存块的_iNextChunk
+             * @return uint32_t, 搬迁的chunk个数
+             */
+            uint32_t moveChunks(uint32_t iSparseRatio);
+
             Block& operator=(const Block &mb);
             bool operator==(const Block &mb) const;
             bool operator!=(const Block &mb) const;
@@ -485,13 +516,23 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
                 _pChunkAllocator->create(pHeadAddr, iSize);
             }
 
+            /**
+             * 初始化, 带尺寸类别表
+             * @param vtClassSize, 尺寸列表, 为空时使用默认尺寸类别
+             */
+            void create(void *pHeadAddr, size_t iSize, const vector<size_t> &vtClassSize)
+            {
+                _pChunkAllocator->create(pHeadAddr, iSize, vtClassSize);
+            }
+
             /**
              * 连接上
              * @param pAddr, 地址, 换到应用程序的绝对地址
+             * @param bSizeClassTable, 是否带尺寸类别表
              */
-            void connect(void *pHeadAddr)
+            void connect(void *pHeadAddr, bool bSizeClassTable = false)
             {
-                _pChunkAllocator->connect(pHeadAddr);
+                _pChunkAllocator->connect(pHeadAddr, bSizeClassTable);
             }
 
             /**
@@ -512,6 +553,30 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
                 _pChunkAllocator->rebuild();
             }
 
+            /**
+             * 重建并更换尺寸类别
+             * @return bool, 没有尺寸类别表或尺寸列表不合法时返回false, 不做重建
+             */
+            bool rebuild(const vector<size_t> &vtClassSize)
+            {
+                return _pChunkAllocator->rebuild(vtClassSize);
+            }
+
+            /**
+             * 当前使用的尺寸类别
+             */
+            SizeMap* getSizeMap() { return _pChunkAllocator->getSizeMap(); }
+
+            /**
+             * 请求分配的尺寸直方图
+             */
+            const vector<uint64_t>& getSizeHist() const { return _pChunkAllocator->getSizeHist(); }
+
+            /**
+             * 清空尺寸直方图
+             */
+            void resetSizeHist() { _pChunkAllocator->resetSizeHist(); }
+
             /**
              * 获取每种数据块头部信息
              *
@@ -552,6 +617,28 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
 
             uint32_t relocateMemBlock(uint32_t srcAddr, uint8_t iVersion, uint32_t index, uint32_t &iAllocSize, vector<TC_HashMapMalloc::BlockData> &vtData);
 
+            /**
+             * 为碎片整理搬迁内存块分配一个同类别的新内存块, 不会淘汰数据
+             * @param iAddr, 被搬迁的内存块地址
+             * @param iMinSize, 新内存块的最小大小
+             * @param iMaxSize, 新内存块的最大大小
+             * @param iAllocSize, out/分配的块大小
+             * @return uint32_t, 相对地址, 0表示没有合适的内存块
+             */
+            uint32_t allocateForMove(uint32_t iAddr, uint32_t iMinSize, uint32_t iMaxSize, uint32_t &iAllocSize);
+
+            /**
+             * 内存块是否在稀疏span上
+             * @param iAddr, 内存块地址
+             * @param iSparseRatio, span的使用率阈值(百分比)
+             */
+            bool isSparse(uint32_t iAddr, uint32_t iSparseRatio) { return _pChunkAllocator->isSparse((size_t)((iAddr >> 9) - 1), iSparseRatio); }
+
+            /**
+             * 按尺寸类别统计内存块的使用情况
+             */
+            void getSizeClassStat(uint32_t iSparseRatio, vector<TC_Page::tagSizeClassStat> &vtStat, size_t &iFreePageNum) { _pChunkAllocator->getSizeClassStat(iSparseRatio, vtStat, iFreePageNum); }
+
             /**
              * 为地址为iAddr的Block分配一个chunk
              *
@@ -680,6 +767,12 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              */
             int get(string& k, string& v);
 
+            /**
+             * 同上，v为hashmap中按原样保存的value，不解压
+             * @param iDictId, value压缩使用的字典，UNCOMPRESSED表示未压缩
+             */
+            int get(string& k, string& v, uint32_t &iDictId);
+
             /**
              * 获取值
              * @return int
@@ -701,12 +794,13 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              * 设置数据
              * @param k
              * @param v
+             * @param iDictId, v压缩使用的字典，UNCOMPRESSED表示未压缩
              * @param iExpiretime, 数据过期时间，单位为秒，0表示不设置过期时间
              * @param iVersion, 数据版本, 应该根据get出的数据版本写回，为0表示不关心数据版本
              * @param vtData, 淘汰的数据
              * @return int
              */
-            int set(const string& k, const string& v, uint32_t iExpireTime, uint8_t iVersion, bool bNewBlock, vector<TC_HashMapMalloc::BlockData> &vtData);
+            int set(const string& k, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bNewBlock, vector<TC_HashMapMalloc::BlockData> &vtData);
 
             /**
              * 设置Key, 无数据
@@ -750,7 +844,7 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              *
              * @return bool
              */
-            bool equal(const string &k, string &v, int &ret);
+            bool equal(const string &k, string &v, uint32_t &iDictId, int &ret);
 
             /**
              *
@@ -761,6 +855,23 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              */
             bool equal(const string& k, int &ret);
 
+            /**
+             * 比较打包后的key(TC_PackIn << k), 数据以打包后的key开头即为同一个key,
+             * key不同时不读取整个数据, 查找时链表上每个block都要比较一次
+             * @param sPackKey
+             * @param v, key相同时返回按原样保存的value
+             * @param iDictId, value压缩使用的字典
+             * @param ret
+             *
+             * @return bool
+             */
+            bool equalPacked(const string &sPackKey, string &v, uint32_t &iDictId, int &ret);
+
+            /**
+             * 同上, 不返回value
+             */
+            bool equalPacked(const string &sPackKey, int &ret);
+
             /**
              * 下一个item
              *
@@ -963,6 +1074,12 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              */
             void getAllData(vector<TC_HashMapMalloc::BlockData> &vtData);
 
+            /**
+             * 解压get/getAllData/getExpire取出的value，不访问共享内存，在释放锁后调用
+             * @return bool, 解压失败返回false
+             */
+            bool decodeValue(TC_HashMapMalloc::BlockData &data) { return _pMap->decodeValue(data._value, data._dictId); }
+
             /**
              * 获取当前hash桶的所有key
              *
@@ -1022,6 +1139,14 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
              * @return int
              */
             int delOnlyKey();
+
+            /**
+             * 碎片整理, 搬迁当前hash桶下位于稀疏span上的内存块
+             * @param iSparseRatio, span的使用率(百分比)低于该值时搬迁
+             * @param iMoved, 搬迁的内存块个数
+             * @return int
+             */
+            int defrag(uint32_t iSparseRatio, uint32_t &iMoved);
             friend class TC_HashMapMalloc;
             friend struct TC_HashMapMalloc::HashMapIterator;
 
@@ -1162,7 +1287,10 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
             uint32_t    _iSyncTail;          //回写链表
             uint32_t    _iOnlyKeyCount;		 // OnlyKey个数
             bool 		_bInit;				 //是否已经完成初始化
-            char		_cReserve[16]; 		 //保留
+            char		_cHashType;			 //key的hash类型，见HashType，旧数据为0
+            bool		_bSizeClassTable;	 //数据区分配器头部后面是否带尺寸类别表，旧数据为false
+            bool		_bFingerprint;		 //hash桶后面是否带指纹数组，旧数据为false
+            char		_cReserve[13]; 		 //保留
         }__attribute__((packed));
 
         /**
@@ -1247,8 +1375,14 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
             RT_LOAL_FILE_ERR = -6,   //load文件到内存失败
             RT_NOTALL_ERR = -7,   //没有复制完全
             RT_DATATYPE_ERR = -8,   //数据类型错误
+            RT_VALUE_COMPRESSED = -9,   //value压缩保存，update需要先由jmem在锁外解压
         };
 
+        /**
+         * value未压缩时的字典id，ValueCodec使用的字典id不能为该值
+         */
+        static const uint32_t UNCOMPRESSED = (uint32_t)-1;
+
         //定义迭代器
         typedef HashMapIterator     hash_iterator;
         typedef HashMapLockIterator lock_iterator;
@@ -1257,6 +1391,30 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
 //        typedef TC_Functor<size_t, TL::TLMaker<const string &>::Result> hash_functor;
 	    typedef std::function<size_t(const string &)> hash_functor;
 
+        /**
+         * value压缩接口，由setValueCodec设置，所有jmem共用同一个对象，须线程安全。
+         * 压缩过的记录在value后追加一个uint32_t的字典id，没有追加的为原始value，兼容已有数据。
+         * hashmap只按原样保存，由jmem在加锁前调用encodeValue压缩、释放锁后调用decodeValue解压
+         */
+        class ValueCodec
+        {
+        public:
+            virtual ~ValueCodec() {}
+
+            /**
+             * 压缩value
+             * @param iDictId, 返回压缩使用的字典, 0表示没有使用字典
+             * @return bool, 未开启压缩或压缩后没有变小时返回false, 按原始value保存
+             */
+            virtual bool compress(const string &v, string &out, uint32_t &iDictId) = 0;
+
+            /**
+             * 解压value
+             * @return bool, 数据损坏或找不到字典时返回false
+             */
+            virtual bool uncompress(const string &in, uint32_t iDictId, string &out) = 0;
+        };
+
 	    //////////////////////////////////////////////////////////////////////////////////////////////
         //map的接口定义
 
@@ -1267,10 +1425,14 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
             : _iMinChunkSize(64)
             , _iAvgDataSize(0)
             , _fRadio(2)
+            , _cHashType(0)
+            , _bFingerprint(false)
+            , _pFingerprint(NULL)
             , _pDataAllocator(new BlockAllocator(this))
             , _lock_end(this, 0, 0, 0)
             , _end(this, (uint32_t)(-1))
             , _hashf(tars::hash_new<string>())
+            , _pValueCodec(NULL)
         {
         }
 
@@ -1287,6 +1449,36 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         void initHashRadio(float fRadio) { _fRadio = fRadio; }
 
+        /**
+         * 设置key的hash类型，create时写入头部，connect时校验，
+         * 必须在create/connect之前调用，且与setHashFunctor设置的hash一致
+         *
+         * @param cHashType
+         */
+        void initHashType(char cHashType) { _cHashType = cHashType; }
+
+        /**
+         * 设置数据区的尺寸类别，create时写入数据区分配器，clear重建时更换，connect时使用内存中保存的
+         *
+         * @param vtClassSize, 尺寸列表，要求见SizeMap::Init，为空时使用默认尺寸类别
+         * @return bool, vtClassSize不合法时返回false，原有设置不变
+         */
+        bool initSizeClass(const vector<size_t> &vtClassSize);
+
+        /**
+         * 是否在hash桶后面建指纹数组，每个hash桶8个字节，记录hash链上前8个block的key指纹，
+         * 查找时8个指纹一次比较，指纹都不匹配时不用遍历hash链。
+         * create时写入头部，connect时按内存头部的记录，已有的内存不受影响
+         *
+         * @param bFingerprint
+         */
+        void initFingerprint(bool bFingerprint) { _bFingerprint = bFingerprint; }
+
+        /**
+         * 内存中是否带指纹数组
+         */
+        bool hasFingerprint() { return _pFingerprint != NULL; }
+
         /**
          * 初始化, 之前需要调用:initDataAvgSize和initHashRadio
          * @param pAddr 绝对地址
@@ -1324,6 +1516,32 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
           */
         size_t getDataMemSize() { return _pDataAllocator->getAllCapacity(); }
 
+        /**
+         * 按尺寸类别统计数据内存的使用情况, 用于观察碎片
+         * @param iSparseRatio, 还有空闲内存块且使用率(百分比)低于该值的span计为稀疏span
+         * @param vtStat, 下标为尺寸类别
+         * @param iFreePageNum, 空闲的页数
+         */
+        void getSizeClassStat(uint32_t iSparseRatio, vector<TC_Page::tagSizeClassStat> &vtStat, size_t &iFreePageNum) { _pDataAllocator->getSizeClassStat(iSparseRatio, vtStat, iFreePageNum); }
+
+        /**
+         * 尺寸类别的使用情况
+         * @param vtHist, 累加进程启动以来请求分配的尺寸直方图, 下标见SizeMap::HistIndex
+         * @param vtClassSize, 当前使用的尺寸列表
+         * @param iWaste, 累加按直方图估算的内部碎片字节数
+         */
+        void getSizeClassInfo(vector<uint64_t> &vtHist, vector<size_t> &vtClassSize, uint64_t &iWaste);
+
+        /**
+         * 清空请求分配的尺寸直方图
+         */
+        void resetSizeHist() { _pDataAllocator->resetSizeHist(); }
+
+        /**
+         * 整块内存被替换后(如从文件load), 按内存中保存的尺寸类别重新连接数据区
+         */
+        void reconnectData();
+
         /**
          * 获取hash桶的个数
          *
@@ -1440,6 +1658,27 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         hash_functor &getHashFunctor() { return _hashf; }
 
+        /**
+         * 设置value压缩，不设置时只能读取未压缩的数据
+         * @param pCodec, 不负责释放
+         */
+        void setValueCodec(ValueCodec *pCodec) { _pValueCodec = pCodec; }
+
+        /**
+         * 压缩value，不访问共享内存，在加锁前调用
+         * @param sCompress, 压缩后的数据
+         * @param iDictId, 返回压缩使用的字典，不压缩时为UNCOMPRESSED
+         * @return const string&, 压缩时返回sCompress，否则返回v
+         */
+        const string &encodeValue(const string &v, string &sCompress, uint32_t &iDictId);
+
+        /**
+         * 解压get取出的value，不访问共享内存，在释放锁后调用
+         * @param iDictId, get返回的字典，UNCOMPRESSED时不做处理
+         * @return bool, 数据损坏或找不到字典时返回false
+         */
+        bool decodeValue(string &v, uint32_t iDictId);
+
         /**
          * hash item
          * @param index
@@ -1448,6 +1687,48 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         tagHashItem *item(uint32_t iIndex) { return &_hash[iIndex]; }
 
+        /**
+         * key所在的hash桶下标，hash桶个数在创建后不再变化，可以在加锁前计算
+         * @param k
+         *
+         * @return uint32_t
+         */
+        uint32_t getHashIndex(const string& k) { return hashIndex(k); }
+
+        /**
+         * 由hash_functor计算好的hash值得到hash索引，与getHashIndex(k)结果相同
+         * @param hash
+         *
+         * @return uint32_t
+         */
+        uint32_t getHashIndexByHash(size_t hash) { return hash % _hash.size(); }
+
+        /**
+         * 预取hash桶，批量读时提前几个key调用
+         * @param iIndex
+         */
+        void prefetchHash(uint32_t iIndex)
+        {
+            __builtin_prefetch(item(iIndex));
+            if (_pFingerprint != NULL)
+            {
+                __builtin_prefetch(&_pFingerprint[iIndex]);
+            }
+        }
+
+        /**
+         * 预取hash桶上第一个数据块的头部，须在该桶的prefetchHash之后调用
+         * @param iIndex
+         */
+        void prefetchBlock(uint32_t iIndex)
+        {
+            uint32_t iAddr = item(iIndex)->_iBlockAddr;
+            if (iAddr != 0)
+            {
+                __builtin_prefetch(getAbsolute(iAddr));
+            }
+        }
+
         /**
          * dump到文件
          * @param sFile
@@ -1497,6 +1778,11 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         int checkDirty(const string &k, bool bCheckExpire = false, uint32_t iNowTime = -1);
 
+        /**
+         * 检查数据干净状态，index为getHashIndex(k)的结果
+         */
+        int checkDirty(const string &k, uint32_t index, bool bCheckExpire, uint32_t iNowTime);
+
         /**
          * 设置为脏数据, 修改SET时间链, 会导致数据回写
          * @param k
@@ -1538,8 +1824,10 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
 
         /**
          * 获取数据, 修改GET时间链
+         * 以下get返回的v都是按原样保存的value，由调用者按iDictId调用decodeValue解压
          * @param k
          * @param v
+         * @param iDictId: value压缩使用的字典，UNCOMPRESSED表示未压缩
          * @param iSyncTime:数据上次回写的时间
          * @param iExpiretime: 数据过期时间，单位为秒，0表示不设置过期时间
          * @param iVersion: 数据版本, 应该根据get出的数据版本写回，为0表示不关心数据版本
@@ -1550,7 +1838,7 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          *          RT_OK:获取数据成功
          *          其他返回值: 错误
          */
-        int get(const string& k, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire = false, uint32_t iNowTime = -1);
+        int get(const string& k, string &v, uint32_t &iDictId, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire = false, uint32_t iNowTime = -1);
 
         /**
         * 获取数据, 修改GET时间链
@@ -1566,7 +1854,7 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
         *          RT_OK:获取数据成功
         *          其他返回值: 错误
         */
-        int get(const string& k, string &v, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool& bDirty, bool bCheckExpire = false, uint32_t iNowTime = -1);
+        int get(const string& k, string &v, uint32_t &iDictId, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool& bDirty, bool bCheckExpire = false, uint32_t iNowTime = -1);
 
         /**
          * 获取数据, 修改GET时间链
@@ -1581,7 +1869,7 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          *          RT_OK:获取数据成功
          *          其他返回值: 错误
          */
-        int get(const string& k, string &v, uint32_t &iSyncTime, bool bCheckExpire = false, uint32_t iNowTime = -1);
+        int get(const string& k, string &v, uint32_t &iDictId, uint32_t &iSyncTime, bool bCheckExpire = false, uint32_t iNowTime = -1);
 
         /**
          * 获取数据, 修改GET时间链
@@ -1594,12 +1882,19 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          *          RT_OK:获取数据成功
          *          其他返回值: 错误
          */
-        int get(const string& k, string &v, bool bCheckExpire = false, uint32_t iNowTime = -1);
+        int get(const string& k, string &v, uint32_t &iDictId, bool bCheckExpire = false, uint32_t iNowTime = -1);
+
+        /**
+         * 获取数据, 修改GET时间链，index为getHashIndex(k)的结果，供批量读使用
+         */
+        int get(const string& k, uint32_t index, string &v, uint32_t &iDictId, uint32_t &iSyncTime, uint32_t& iExpireTime, uint8_t& iVersion, bool bCheckExpire, uint32_t iNowTime);
 
         /**
          * 设置数据, 修改时间链, 内存不够时会自动淘汰老的数据
+         * 以下set的v都按原样保存，需要压缩时由调用者先调用encodeValue
          * @param k: 关键字
          * @param v: 值
+         * @param iDictId: v压缩使用的字典，UNCOMPRESSED表示未压缩
          * @param bDirty: 是否是脏数据
          * @param vtData: 被淘汰的记录
          * @return int:
@@ -1608,7 +1903,7 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          *          RT_OK: 设置成功
          *          其他返回值: 错误
          */
-        int set(const string& k, const string& v, bool bDirty, vector<BlockData> &vtData);
+        int set(const string& k, const string& v, uint32_t iDictId, bool bDirty, vector<BlockData> &vtData);
 
         /*
          * 设置数据, 修改时间链, 内存不够时会自动淘汰老的数据
@@ -1624,7 +1919,7 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          *          RT_OK: 设置成功
          *          其他返回值: 错误
          */
-        int set(const string& k, const string& v, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, vector<BlockData> &vtData);
+        int set(const string& k, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, vector<BlockData> &vtData);
 
         /*
          * 设置数据, 修改时间链, 内存不够时会自动淘汰老的数据
@@ -1642,7 +1937,12 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          *          RT_OK: 设置成功
          *          其他返回值: 错误
          */
-        int set(const string& k, const string& v, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, bool bCheckExpire, uint32_t iNowTime, vector<BlockData> &vtData);
+        int set(const string& k, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, bool bCheckExpire, uint32_t iNowTime, vector<BlockData> &vtData);
+
+        /**
+         * 设置数据，index为getHashIndex(k)的结果
+         */
+        int set(const string& k, uint32_t index, const string& v, uint32_t iDictId, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, bool bCheckExpire, uint32_t iNowTime, vector<BlockData> &vtData);
 
         /**
          * 设置key, 但无数据
@@ -1667,7 +1967,8 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          * @return int:
          *          RT_READONLY: map只读
          *          RT_NO_MEMORY: 没有空间(不淘汰数据情况下会出现)
-         *          RT_OK: 设置成功
+         *          RT_VALUE_COMPRESSED: 原value压缩保存，没有更新，不在锁内解压
+         *          RT_OK: 设置成功，结果不压缩保存
          *          其他返回值: 错误
          */
         int update(const string& k, const string& v, Op option, bool bDirty, uint32_t iExpireTime, bool bCheckExpire, uint32_t iNowTime, string &retValue, vector<BlockData> &vtData);
@@ -2009,6 +2310,62 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         void delListCount(uint32_t index) { saveValue(&item(index)->_iListCount, item(index)->_iListCount - 1); }
 
+        /**
+         * 指纹数组中每个字节的取值，key的指纹为1~254
+         */
+        enum
+        {
+            FP_EMPTY = 0x00,      //hash链上没有这个位置的block
+            FP_UNKNOWN = 0xFF,    //有block但指纹未知，查找时需要比较key
+        };
+
+        /**
+         * key的指纹，与选hash桶的hash_functor无关
+         * @param k
+         *
+         * @return uint8_t, 1~254
+         */
+        static uint8_t fingerprint(const string &k);
+
+        /**
+         * hash链上可能是iTag的位置，第i个字节为0x80表示链上第i个block需要比较key，
+         * 第7个字节同时代表之后所有的block；没有指纹数组时所有位置都需要比较
+         * @param index
+         * @param iTag
+         *
+         * @return uint64_t
+         */
+        uint64_t matchFingerprint(uint32_t index, uint8_t iTag);
+
+        /**
+         * 新block挂到hash链开头，原有的指纹后移一位，开头的指纹在写入key后由setFingerprint填上
+         * @param index
+         */
+        void pushFingerprint(uint32_t index);
+
+        /**
+         * iAddr在hash链开头且指纹未知时填上key的指纹
+         * @param index
+         * @param iAddr
+         * @param k
+         */
+        void setFingerprint(uint32_t index, uint32_t iAddr, const string &k);
+
+        /**
+         * hash链上第iPos个block摘除，之后的指纹前移一位
+         * @param index
+         * @param iPos
+         */
+        void popFingerprint(uint32_t index, uint32_t iPos);
+
+        /**
+         * 头部带指纹数组时，指纹数组从pAddr之后按cache line对齐开始
+         * @param pAddr, hash桶之后的地址
+         *
+         * @return void*, 数据区的开始地址
+         */
+        void *initFingerprintAddr(char *pAddr);
+
         /**
          * 相对地址换成绝对地址
          * @param iAddr
@@ -2039,7 +2396,7 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          * 根据Key查找数据
          *
          */
-        lock_iterator find(const string& k, uint32_t index, string &v, int &ret);
+        lock_iterator find(const string& k, uint32_t index, string &v, uint32_t &iDictId, int &ret);
 
         /**
          * 根据Key查找数据
@@ -2128,6 +2485,17 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         void deallocate2(uint32_t iHead);
 
+        /**
+         * 组包value，压缩过的value后追加字典id
+         */
+        void packValue(tars::TC_PackIn &pi, const string &v, uint32_t iDictId);
+
+        /**
+         * 解包value，不解压
+         * @param iDictId, 返回字典id，没有追加字典id的为UNCOMPRESSED
+         */
+        void unpackValue(tars::TC_PackOut &po, string &v, uint32_t &iDictId);
+
     protected:
 
         /**
@@ -2150,11 +2518,31 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         float                       _fRadio;
 
+        /**
+         * key的hash类型
+         */
+        char                        _cHashType;
+
+        /**
+         * 创建或重建时使用的尺寸列表
+         */
+        vector<size_t>              _vtClassSize;
+
+        /**
+         * create时是否建指纹数组
+         */
+        bool                        _bFingerprint;
+
         /**
          * hash对象
          */
         tars::TC_MemVector<tagHashItem>   _hash;
 
+        /**
+         * 指纹数组，与_hash一一对应，按cache line对齐，没有时为NULL
+         */
+        uint64_t                    *_pFingerprint;
+
         /**
          * 修改数据块
          */
@@ -2180,6 +2568,11 @@ struct TC_HashMapMalloc_Exception : public tars::TC_Exception
          */
         hash_functor                _hashf;
 
+        /**
+         * value压缩
+         */
+        ValueCodec                  *_pValueCodec;
+
         //用于Block中get 的临时缓存，避免内存的频繁分配和释放
         size_t _tmpBufSize;
         char* _tmpBuf;
@@ -11,6 +11,7 @@
 * either express or implied. See the License for the specific language governing permissions
 * and limitations under the License.
 */
+#include <map>
 #include "tc_malloc_chunk.h"
 
 namespace DCache
@@ -55,6 +56,38 @@ namespace DCache
         return num;
     }
 
+    size_t SizeMap::PagesForSize(size_t size)
+    {
+        size_t blocks_to_move = NumMoveSize(size) / 4;
+        size_t psize = 0;
+        do
+        {
+            psize += kPageSize;
+
+            while ((psize % size) > (psize >> 3))
+            {
+                psize += kPageSize;
+            }
+
+        } while ((psize / size) < (blocks_to_move));
+
+        return psize >> kPageShift;
+    }
+
+    void SizeMap::BuildClassArray()
+    {
+        int next_size = 0;
+        for (size_t c = 1; c < num_classes_; c++)
+        {
+            const int max_size_in_class = class_to_size_[c];
+            for (int s = next_size; s <= max_size_in_class; s += kAlignment)
+            {
+                class_array_[ClassIndex(s)] = c;
+            }
+            next_size = max_size_in_class + kAlignment;
+        }
+    }
+
     void SizeMap::Init()
     {
         if (ClassIndex(0) < 0)
@@ -66,25 +99,16 @@ namespace DCache
             assert(false);
         }
 
+        class_to_size_[0] = 0;
+        class_to_pages_[0] = 0;
+
         size_t sc = 1;
         size_t alignment = kAlignment;
         for (size_t size = kAlignment; size <= kMaxSize; size += alignment)
         {
             alignment = AlignmentForSize(size);
 
-            size_t blocks_to_move = NumMoveSize(size) / 4;
-            size_t psize = 0;
-            do
-            {
-                psize += kPageSize;
-
-                while ((psize % size) > (psize >> 3))
-                {
-                    psize += kPageSize;
-                }
-
-            } while ((psize / size) < (blocks_to_move));
-            const size_t my_pages = psize >> kPageShift;
+            const size_t my_pages = PagesForSize(size);
 
             if (sc > 1 && my_pages == class_to_pages_[sc - 1])
             {
@@ -106,16 +130,8 @@ namespace DCache
             assert(false);
         }
 
-        int next_size = 0;
-        for (size_t c = 1; c < kNumClasses; c++)
-        {
-            const int max_size_in_class = class_to_size_[c];
-            for (int s = next_size; s <= max_size_in_class; s += kAlignment)
-            {
-                class_array_[ClassIndex(s)] = c;
-            }
-            next_size = max_size_in_class + kAlignment;
-        }
+        num_classes_ = sc;
+        BuildClassArray();
 
         for (size_t size = 0; size <= kMaxSize; size++)
         {
@@ -139,6 +155,162 @@ namespace DCache
             }
         }
     }
+
+    bool SizeMap::Init(const vector<size_t> &vtClassSize)
+    {
+        if (vtClassSize.empty() || vtClassSize.size() >= kNumClasses || vtClassSize.back() != kMaxSize)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < vtClassSize.size(); ++i)
+        {
+            const size_t size = vtClassSize[i];
+            const size_t alignment = (size > (size_t)kMaxSmallSize) ? 128 : kAlignment;
+            if (size == 0 || (size % alignment) != 0 || (i > 0 && size <= vtClassSize[i - 1]))
+            {
+                return false;
+            }
+        }
+
+        size_t sc = 1;
+        for (size_t i = 0; i < vtClassSize.size(); ++i)
+        {
+            const size_t size = vtClassSize[i];
+            const size_t my_pages = PagesForSize(size);
+
+            if (sc > 1 && my_pages == class_to_pages_[sc - 1])
+            {
+                const size_t my_objects = (my_pages << kPageShift) / size;
+                const size_t prev_objects = (class_to_pages_[sc - 1] << kPageShift) / class_to_size_[sc - 1];
+                if (my_objects == prev_objects)
+                {
+                    class_to_size_[sc - 1] = size;
+                    continue;
+                }
+            }
+
+            class_to_pages_[sc] = my_pages;
+            class_to_size_[sc] = size;
+            sc++;
+        }
+
+        for (size_t c = sc; c < kNumClasses; ++c)
+        {
+            class_to_size_[c] = 0;
+            class_to_pages_[c] = 0;
+        }
+
+        num_classes_ = sc;
+        BuildClassArray();
+
+        return true;
+    }
+
+    void SizeMap::GetClassSize(vector<size_t> &vtClassSize) const
+    {
+        vtClassSize.clear();
+        for (size_t c = 1; c < num_classes_; ++c)
+        {
+            vtClassSize.push_back(class_to_size_[c]);
+        }
+    }
+
+    uint64_t SizeMap::EstimateWaste(const vector<uint64_t> &vtHist)
+    {
+        uint64_t iWaste = 0;
+        for (size_t i = 0; i < vtHist.size() && i < kClassArraySize; ++i)
+        {
+            if (vtHist[i] == 0)
+            {
+                continue;
+            }
+
+            const size_t size = HistBucketSize(i);
+            iWaste += vtHist[i] * (class_to_size_[SizeClass(size)] - size);
+        }
+
+        return iWaste;
+    }
+
+    size_t SizeMap::HistBucketSize(size_t iIndex)
+    {
+        size_t size = (iIndex <= ClassIndex(kMaxSmallSize)) ? (iIndex << 3) : ((iIndex << 7) - (120 << 7));
+        return size > kMaxSize ? kMaxSize : size;
+    }
+
+    void SizeMap::LearnClassSize(const vector<uint64_t> &vtHist, uint32_t iMaxWaste, vector<size_t> &vtClassSize)
+    {
+        vector<size_t> vtDefault;
+        Static::sizemap()->GetClassSize(vtDefault);
+
+        //尺寸 -> (是否为默认尺寸类别, 落在该尺寸上的分配次数)
+        map<size_t, pair<bool, uint64_t> > mCandidate;
+        for (size_t i = 0; i < vtDefault.size(); ++i)
+        {
+            mCandidate[vtDefault[i]].first = true;
+        }
+        for (size_t i = 0; i < vtHist.size() && i < kClassArraySize; ++i)
+        {
+            if (vtHist[i] > 0)
+            {
+                mCandidate[max(HistBucketSize(i), kAlignment)].second += vtHist[i];
+            }
+        }
+
+        vector<size_t> vtSize;
+        vector<bool> vtFixed;
+        vector<uint64_t> vtCount;
+        //(前一个尺寸, 该尺寸]区间内是否去掉过默认尺寸类别
+        vector<bool> vtMerged;
+        for (map<size_t, pair<bool, uint64_t> >::const_iterator it = mCandidate.begin(); it != mCandidate.end(); ++it)
+        {
+            vtSize.push_back(it->first);
+            vtFixed.push_back(it->second.first);
+            vtCount.push_back(it->second.second);
+            vtMerged.push_back(false);
+        }
+
+        //第一个和kMaxSize始终保留
+        while (vtSize.size() >= kNumClasses)
+        {
+            size_t iBest = 0;
+            uint64_t iBestCost = 0;
+            for (size_t k = 1; k + 1 < vtSize.size(); ++k)
+            {
+                //去掉后新的间距不超过默认尺寸类别原有的间距, 或者不超过iMaxWaste
+                bool bInDefault = !vtFixed[k] && !vtMerged[k] && !vtMerged[k + 1];
+                if (!bInDefault && (vtSize[k + 1] - vtSize[k - 1]) * 100 > vtSize[k - 1] * iMaxWaste)
+                {
+                    continue;
+                }
+
+                //落在该尺寸上的分配都改用下一个尺寸
+                uint64_t iCost = vtCount[k] * (vtSize[k + 1] - vtSize[k]);
+                if (iBest == 0 || iCost < iBestCost)
+                {
+                    iBest = k;
+                    iBestCost = iCost;
+                }
+            }
+
+            if (iBest == 0)
+            {
+                //没有可以去掉的尺寸, 使用默认尺寸类别
+                vtClassSize = vtDefault;
+                return;
+            }
+
+            vtCount[iBest + 1] += vtCount[iBest];
+            vtMerged[iBest + 1] = vtMerged[iBest + 1] || vtMerged[iBest] || vtFixed[iBest];
+            vtSize.erase(vtSize.begin() + iBest);
+            vtFixed.erase(vtFixed.begin() + iBest);
+            vtCount.erase(vtCount.begin() + iBest);
+            vtMerged.erase(vtMerged.begin() + iBest);
+        }
+
+        vtClassSize = vtSize;
+    }
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     void TC_SpanAllocator::init(void *pAddr)
     {
@@ -794,8 +966,14 @@ namespace DCache
 
         TC_Span* span = reinterpret_cast<TC_Span*>(iBeginAddr + _pCenterCache[iClassSize].nonempty.next);
 
+        return FetchFromSpan(span, iClassSize, iAllocSize, iPageId, iIndex);
+    }
+
+    void* TC_Page::FetchFromSpan(TC_Span* span, size_t iClassSize, size_t &iAllocSize, size_t &iPageId, size_t &iIndex)
+    {
+        size_t iBeginAddr = reinterpret_cast<size_t>(_pShmFlagHead);
         void* result = reinterpret_cast<void*>(iBeginAddr + span->objects);
-        size_t _size = Static::sizemap()->ByteSizeForClass(iClassSize);
+        size_t _size = _pSizeMap->ByteSizeForClass(iClassSize);
         iPageId = span->start;
         iIndex = (span->objects - (_pShmFlagHead->_iShmPageAddr + (iPageId << kPageShift))) / _size;
         size_t last = (span->length << kPageShift) / _size;
@@ -874,7 +1052,7 @@ namespace DCache
 
     int TC_Page::Populate(size_t iClassSize)
     {
-        const size_t npages = Static::sizemap()->class_to_pages(iClassSize);
+        const size_t npages = _pSizeMap->class_to_pages(iClassSize);
         bool      flag = _pShmFlagHead->_bShmProtectedArea;
 
         TC_Span* span = New(npages);
@@ -905,7 +1083,7 @@ namespace DCache
 
         size_t* tail = &(span->objects);
         char*  ptr = reinterpret_cast<char*>(iBeginAddr + _pShmFlagHead->_iShmPageAddr + (span->start << kPageShift));
-        const  size_t size = Static::sizemap()->ByteSizeForClass(iClassSize);
+        const  size_t size = _pSizeMap->ByteSizeForClass(iClassSize);
         size_t num = ((span->length) << kPageShift) / size;
         char*  _ptr = ptr + size * (num - 1);
         size_t* temp = reinterpret_cast<size_t*>(_ptr);
@@ -988,7 +1166,7 @@ namespace DCache
         }
         else
         {
-            void*  ptr = reinterpret_cast<void*>(iBeginAddr + _pShmFlagHead->_iShmPageAddr + (iPageId << kPageShift) + iIndex *  Static::sizemap()->ByteSizeForClass(_size_class));
+            void*  ptr = reinterpret_cast<void*>(iBeginAddr + _pShmFlagHead->_iShmPageAddr + (iPageId << kPageShift) + iIndex *  _pSizeMap->ByteSizeForClass(_size_class));
             if (flag)
             {
                 update(ptr, span->objects);
@@ -1160,7 +1338,114 @@ namespace DCache
         const size_t _size_class = span->sizeclass;
         assert(_size_class > 0);
 
-        return reinterpret_cast<void*>(reinterpret_cast<size_t>(_pShmFlagHead) + _pShmFlagHead->_iShmPageAddr + (iPageId << kPageShift) + iIndex *  Static::sizemap()->ByteSizeForClass(_size_class));
+        return reinterpret_cast<void*>(reinterpret_cast<size_t>(_pShmFlagHead) + _pShmFlagHead->_iShmPageAddr + (iPageId << kPageShift) + iIndex *  _pSizeMap->ByteSizeForClass(_size_class));
+    }
+
+    void TC_Page::getSizeClassStat(uint32_t iSparseRatio, vector<tagSizeClassStat> &vtStat, size_t &iFreePageNum)
+    {
+        size_t iBeginAddr = reinterpret_cast<size_t>(_pShmFlagHead);
+
+        if (vtStat.size() < kNumClasses)
+        {
+            vtStat.resize(kNumClasses);
+        }
+
+        for (size_t cl = 1; cl < _pSizeMap->NumClasses(); ++cl)
+        {
+            tagSizeClassStat &stat = vtStat[cl];
+            stat._iObjectSize = _pSizeMap->ByteSizeForClass(cl);
+
+            //empty链上的span已经分配满, nonempty链上的span还有空闲内存块
+            TC_Span* lists[2] = { &(_pCenterCache[cl].empty), &(_pCenterCache[cl].nonempty) };
+            for (size_t i = 0; i < 2; ++i)
+            {
+                TC_Span* list = lists[i];
+                for (TC_Span* span = reinterpret_cast<TC_Span*>(iBeginAddr + list->next); span != list; span = reinterpret_cast<TC_Span*>(iBeginAddr + span->next))
+                {
+                    size_t num = SpanObjectNum(span);
+                    ++stat._iSpanNum;
+                    stat._iPageNum += span->length;
+                    stat._iObjectNum += num;
+                    stat._iUsedObjectNum += span->refcount;
+                    if (span->refcount < num && span->refcount * 100 < num * iSparseRatio)
+                    {
+                        ++stat._iSparseSpanNum;
+                    }
+                }
+            }
+        }
+
+        //还没有开始使用时所有的页都是空闲的
+        if (_pShmFlagHead->_iShmFlag == 0)
+        {
+            iFreePageNum += _pShmFlagHead->_iShmPageNum;
+            return;
+        }
+
+        for (size_t s = 0; s < kMaxPages; ++s)
+        {
+            TC_Span* list = &_pFree[s];
+            for (TC_Span* span = reinterpret_cast<TC_Span*>(iBeginAddr + list->next); span != list; span = reinterpret_cast<TC_Span*>(iBeginAddr + span->next))
+            {
+                iFreePageNum += span->length;
+            }
+        }
+
+        for (TC_Span* span = reinterpret_cast<TC_Span*>(iBeginAddr + _pLarge->next); span != _pLarge; span = reinterpret_cast<TC_Span*>(iBeginAddr + span->next))
+        {
+            iFreePageNum += span->length;
+        }
+    }
+
+    bool TC_Page::isSparseSpan(size_t iPageId, uint32_t iSparseRatio)
+    {
+        TC_Span* span = GetDescriptor(iPageId);
+        if (span == NULL || span->sizeclass == 0)
+        {
+            return false;
+        }
+
+        size_t num = SpanObjectNum(span);
+        return span->refcount < num && span->refcount * 100 < num * iSparseRatio;
+    }
+
+    void* TC_Page::fetchForMove(size_t iSrcPageId, size_t &iAllocSize, size_t &iPageId, size_t &iIndex)
+    {
+        //查找目标span时最多检查的span个数, 避免在span很多的类别上长时间遍历
+        static const size_t kMaxSearchSpans = 64;
+
+        TC_Span* src = GetDescriptor(iSrcPageId);
+        if (src == NULL || src->sizeclass == 0)
+        {
+            return NULL;
+        }
+
+        const size_t iClassSize = src->sizeclass;
+        size_t iBeginAddr = reinterpret_cast<size_t>(_pShmFlagHead);
+        TC_Span* list = &(_pCenterCache[iClassSize].nonempty);
+
+        //选已分配个数最多的span, 内存块只会从少的span搬到多的span, 稀疏的span最终被搬空并归还到页堆
+        TC_Span* best = NULL;
+        size_t n = 0;
+        for (TC_Span* span = reinterpret_cast<TC_Span*>(iBeginAddr + list->next); span != list && n < kMaxSearchSpans; span = reinterpret_cast<TC_Span*>(iBeginAddr + span->next), ++n)
+        {
+            if (span == src || span->refcount < src->refcount)
+            {
+                continue;
+            }
+
+            if (best == NULL || span->refcount > best->refcount)
+            {
+                best = span;
+            }
+        }
+
+        if (best == NULL)
+        {
+            return NULL;
+        }
+
+        return FetchFromSpan(best, iClassSize, iAllocSize, iPageId, iIndex);
     }
 
     void TC_Page::doUpdate(bool bUpdate)
@@ -1336,16 +1621,17 @@ namespace DCache
     }
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    void TC_MallocChunkAllocator::init(void *pAddr)
+    void TC_MallocChunkAllocator::init(void *pAddr, bool bSizeClassTable)
     {
         _pHead = static_cast<tagChunkAllocatorHead*>(pAddr);
-        _pChunk = (char*)_pHead + sizeof(tagChunkAllocatorHead);
+        _pSizeClassHead = bSizeClassTable ? (tagSizeClassHead*)((char*)_pHead + sizeof(tagChunkAllocatorHead)) : NULL;
+        _pChunk = (char*)_pHead + getHeadSize(bSizeClassTable);
     }
 
     void TC_MallocChunkAllocator::create(void *pAddr, size_t iSize, bool bProtectedArea)
     {
         assert(iSize > (sizeof(tagChunkAllocatorHead) + TC_Page::getMinMemSize()));
-        init(pAddr);
+        init(pAddr, false);
 
         _pHead->_bProtectedArea = bProtectedArea;
         _pHead->_iSize = iSize;
@@ -1357,11 +1643,31 @@ namespace DCache
         _page.create(_pChunk, iChunkCapacity, bProtectedArea);
     }
 
-    void TC_MallocChunkAllocator::connect(void *pAddr)
+    void TC_MallocChunkAllocator::create(void *pAddr, size_t iSize, const vector<size_t> &vtClassSize, bool bProtectedArea)
+    {
+        assert(iSize > (getHeadSize(true) + TC_Page::getMinMemSize()));
+        init(pAddr, true);
+
+        _pHead->_bProtectedArea = bProtectedArea;
+        _pHead->_iSize = iSize;
+        _pHead->_iTotalSize = iSize;
+        _pHead->_iNext = 0;
+
+        saveSizeClass(vtClassSize);
+        loadSizeClass();
+
+        size_t iChunkCapacity = iSize - getHeadSize(true);
+
+        _page.create(_pChunk, iChunkCapacity, bProtectedArea);
+    }
+
+    void TC_MallocChunkAllocator::connect(void *pAddr, bool bSizeClassTable)
     {
         clear();
 
-        init(pAddr);
+        init(pAddr, bSizeClassTable);
+
+        loadSizeClass();
 
         _page.connect(_pChunk);
 
@@ -1375,6 +1681,7 @@ namespace DCache
 
         tagChunkAllocatorHead  *pNextHead = (tagChunkAllocatorHead   *)((char*)_pHead + _pHead->_iNext);
         _nallocator = new TC_MallocChunkAllocator();
+        _nallocator->setSizeMap(_pSizeMap);
         _nallocator->connect(pNextHead);
 
         doUpdate();
@@ -1390,6 +1697,85 @@ namespace DCache
         }
     }
 
+    bool TC_MallocChunkAllocator::rebuild(const vector<size_t> &vtClassSize)
+    {
+        if (_pSizeClassHead == NULL)
+        {
+            return false;
+        }
+
+        if (!vtClassSize.empty())
+        {
+            SizeMap sizeMap;
+            if (!sizeMap.Init(vtClassSize))
+            {
+                return false;
+            }
+        }
+
+        saveSizeClass(vtClassSize);
+        loadSizeClass();
+        rebuild();
+
+        return true;
+    }
+
+    void TC_MallocChunkAllocator::setSizeMap(SizeMap *pSizeMap)
+    {
+        _pSizeMap = pSizeMap;
+        _page.setSizeMap(pSizeMap);
+
+        if (_nallocator)
+        {
+            _nallocator->setSizeMap(pSizeMap);
+        }
+    }
+
+    void TC_MallocChunkAllocator::saveSizeClass(const vector<size_t> &vtClassSize)
+    {
+        assert(_pSizeClassHead != NULL && vtClassSize.size() < kNumClasses);
+
+        //先清空个数, 写到一半时按默认尺寸类别处理
+        _pSizeClassHead->_iClassNum = 0;
+        for (size_t i = 0; i < vtClassSize.size(); ++i)
+        {
+            _pSizeClassHead->_iClassSize[i] = vtClassSize[i];
+        }
+        _pSizeClassHead->_iClassNum = vtClassSize.size();
+    }
+
+    void TC_MallocChunkAllocator::loadSizeClass()
+    {
+        if (_pSizeClassHead == NULL || _pSizeClassHead->_iClassNum == 0)
+        {
+            //后续分配器沿用第一个分配器设置的尺寸类别
+            if (_pSizeClassHead != NULL || _pSizeMap == _pOwnSizeMap)
+            {
+                setSizeMap(Static::sizemap());
+            }
+            return;
+        }
+
+        assert(_pSizeClassHead->_iClassNum < kNumClasses);
+
+        vector<size_t> vtClassSize;
+        for (size_t i = 0; i < _pSizeClassHead->_iClassNum; ++i)
+        {
+            vtClassSize.push_back(_pSizeClassHead->_iClassSize[i]);
+        }
+
+        if (_pOwnSizeMap == NULL)
+        {
+            _pOwnSizeMap = new SizeMap();
+        }
+
+        bool bInit = _pOwnSizeMap->Init(vtClassSize);
+        assert(bInit);
+        (void)bInit;
+
+        setSizeMap(_pOwnSizeMap);
+    }
+
     TC_MallocChunkAllocator * TC_MallocChunkAllocator::lastAlloc()
     {
         if (_nallocator == NULL)
@@ -1407,13 +1793,14 @@ namespace DCache
 
     void TC_MallocChunkAllocator::append(void *pAddr, size_t iSize)
     {
-        connect(pAddr);
+        connect(pAddr, _pSizeClassHead != NULL);
 
         assert(iSize > _pHead->_iTotalSize);
 
         void *pAppendAddr = (char*)pAddr + _pHead->_iTotalSize;
 
         TC_MallocChunkAllocator *p = new TC_MallocChunkAllocator();
+        p->setSizeMap(_pSizeMap);
         p->create(pAppendAddr, iSize - _pHead->_iTotalSize, _pHead->_bProtectedArea);
 
         TC_MallocChunkAllocator *palloc = lastAlloc();
@@ -1467,7 +1854,20 @@ namespace DCache
             iNeedSize = kMaxSize;
             //return NULL;
         }
-        size_t iClassSize = Static::sizemap()->SizeClass(iNeedSize);
+
+        //统计请求的尺寸分布, 用于推导尺寸类别
+        if (_vtSizeHist.empty())
+        {
+            _vtSizeHist.resize(SizeMap::HistSize(), 0);
+        }
+        ++_vtSizeHist[SizeMap::HistIndex(iNeedSize)];
+
+        return allocateFromPage(iNeedSize, iAllocSize, iPageId, iIndex);
+    }
+
+    void* TC_MallocChunkAllocator::allocateFromPage(size_t iNeedSize, size_t &iAllocSize, size_t &iPageId, size_t &iIndex)
+    {
+        size_t iClassSize = _pSizeMap->SizeClass(iNeedSize);
         void* p = NULL;
 
         p = _page.fetchFromSpansSafe(iClassSize, iAllocSize, iPageId, iIndex);
@@ -1477,7 +1877,7 @@ namespace DCache
             return p;
         }
 
-        for (size_t i = iClassSize + 1; i < kNumClasses; ++i)
+        for (size_t i = iClassSize + 1; i < _pSizeMap->NumClasses(); ++i)
         {
             p = _page.fetchFromSpansSafe(i, iAllocSize, iPageId, iIndex);
 
@@ -1500,7 +1900,7 @@ namespace DCache
         if (_nallocator)
         {
             size_t prev = _page.getPageNumber();
-            p = _nallocator->allocate(iNeedSize, iAllocSize, iPageId, iIndex);
+            p = _nallocator->allocateFromPage(iNeedSize, iAllocSize, iPageId, iIndex);
             iPageId += prev;
             if (p != NULL)
             {
@@ -1554,6 +1954,43 @@ namespace DCache
         return NULL;
     }
 
+    void TC_MallocChunkAllocator::getSizeClassStat(uint32_t iSparseRatio, vector<TC_Page::tagSizeClassStat> &vtStat, size_t &iFreePageNum)
+    {
+        vtStat.clear();
+        iFreePageNum = 0;
+
+        TC_MallocChunkAllocator *p = this;
+        while (p)
+        {
+            p->_page.getSizeClassStat(iSparseRatio, vtStat, iFreePageNum);
+            p = p->_nallocator;
+        }
+    }
+
+    bool TC_MallocChunkAllocator::isSparse(size_t iPageId, uint32_t iSparseRatio)
+    {
+        size_t prev = _page.getPageNumber();
+        if (_nallocator && iPageId >= prev)
+        {
+            return _nallocator->isSparse(iPageId - prev, iSparseRatio);
+        }
+
+        return _page.isSparseSpan(iPageId, iSparseRatio);
+    }
+
+    void* TC_MallocChunkAllocator::allocateForMove(size_t iSrcPageId, size_t &iAllocSize, size_t &iPageId, size_t &iIndex)
+    {
+        size_t prev = _page.getPageNumber();
+        if (_nallocator && iSrcPageId >= prev)
+        {
+            void* p = _nallocator->allocateForMove(iSrcPageId - prev, iAllocSize, iPageId, iIndex);
+            iPageId += prev;
+            return p;
+        }
+
+        return _page.fetchForMove(iSrcPageId, iAllocSize, iPageId, iIndex);
+    }
+
     size_t TC_MallocChunkAllocator::getAllCapacity()
     {
 
@@ -17,6 +17,7 @@
 #include "MKCacheGlobe.h"
 #include "util/tc_encoder.h"
 #include "BinLogEncodeComm.h"
+#include "jmem_multi_hashmap_malloc/MKCompactRecord.h"
 #include <sstream>
 using namespace std;
 using namespace tars;
@@ -140,10 +141,12 @@ public:
         uint32_t iUKLen = uk.length();
         string sUKLen((char *)&iUKLen, sizeof(uint32_t));
 
-        uint32_t iValueLen = value.length();
+        //binlog中的value统一为tars编码
+        const string sValue = HashMap::CompactRecord::getInstance()->normalize(value);
+        uint32_t iValueLen = sValue.length();
         string sValueLen((char *)&iValueLen, sizeof(uint32_t));
 
-        sBinLog = sBinLog + " " + sExpireTime + sMKLen + mk + sUKLen + uk + sValueLen + value;
+        sBinLog = sBinLog + " " + sExpireTime + sMKLen + mk + sUKLen + uk + sValueLen + sValue;
 
         //不进行特殊字符转义，增加头部SERA+BinlogLength
         EncodeAddHead(sBinLog, ResultBinlog);
@@ -215,7 +218,7 @@ public:
             uint32_t iUKLen = sUK.length();
             string sUKLen((char *)&iUKLen, sizeof(uint32_t));
 
-            string sValue = vs[i]._value;
+            string sValue = HashMap::CompactRecord::getInstance()->normalize(vs[i]._value);
             uint32_t iValueLen = sValue.length();
             string sValueLen((char *)&iValueLen, sizeof(uint32_t));
             sBinLog = sDirty + sExpireTime + sUKLen + sUK + sValueLen + sValue;
@@ -274,7 +277,7 @@ public:
             uint32_t iUKLen = sUK.length();
             string sUKLen((char *)&iUKLen, sizeof(uint32_t));
 
-            string sValue = vs[i]._value;
+            string sValue = HashMap::CompactRecord::getInstance()->normalize(vs[i]._value);
             uint32_t iValueLen = sValue.length();
             string sValueLen((char *)&iValueLen, sizeof(uint32_t));
             sBinLog = sDirty + sExpireTime + sUKLen + sUK + sValueLen + sValue;
@@ -288,6 +291,21 @@ public:
         return sBinLog;
     }
 
+    //每条记录按单条set/del编码，备机逐条执行时与单条写接口的效果相同
+    void EncodeSetDel(const string &mk, const vector<MultiHashMap::Value> &vs, vector<string> &vtBinLog, const enum BinLogType logType = BINLOG_NORMAL)
+    {
+        for (size_t i = 0; i < vs.size(); i++)
+        {
+            if (mk != vs[i]._mkey)
+                throw BinLogException("encode error, mk not match");
+
+            if (vs[i]._isDelete == TC_Multi_HashMap_Malloc::DELETE_TRUE)
+                vtBinLog.push_back(EncodeDel(mk, vs[i]._ukey, logType));
+            else
+                vtBinLog.push_back(EncodeSet(mk, vs[i]._ukey, vs[i]._value, vs[i]._iExpireTime, vs[i]._dirty, logType));
+        }
+    }
+
     string EncodePushList(const string &mk, const vector<pair<uint32_t, string> > &vtvalue, bool bHead, const enum BinLogType logType = BINLOG_NORMAL)
     {
         string sBinLog;
@@ -14,6 +14,7 @@
 #include "MKCacheComm.h"
 #include "TimerThread.h"
 #include "MKCacheServer.h"
+#include "jmem_multi_hashmap_malloc/MKCompactRecord.h"
 
 
 #define TYPE_BYTE "byte"
@@ -1020,8 +1021,20 @@ const double EPSILON = 1.00e-07;
 
 bool judgeValue(TarsDecode &decode, const string &value, Op op, const string &type, uint8_t tag, const string &sDefault, bool isRequire)
 {
+    if (HashMap::CompactRecord::isCompact(decode.getBuffer()))
+    {
+        if (HashMap::CompactRecord::getInstance()->isCurrent(decode.getBuffer()))
+        {
+            return HashMap::CompactRecord::getInstance()->judge(decode.getBuffer(), tag, op, value);
+        }
+        //字段配置修改前写入的数据按原布局转回tars编码后比较
+        decode.setBuffer(HashMap::CompactRecord::getInstance()->toTars(decode.getBuffer()));
+    }
+
+    //getBuffer返回的是拷贝，需保存下来，否则isk指向已释放的临时串
+    const string sBuf = decode.getBuffer();
     TarsInputStream<BufferReader> isk;
-    isk.setBuffer(decode.getBuffer().c_str(), decode.getBuffer().length());
+    isk.setBuffer(sBuf.c_str(), sBuf.length());
 
     if (type == TYPE_BYTE)
     {
@@ -1359,8 +1372,10 @@ string updateValueForInsert(const pair<string, UpdateFieldInfo> &upValue)
         throw MKDCacheException("updateValue: type error");
     }
 }
-string updateValue(const map<string, DCache::UpdateValue> &mpValue, const string &sStreamValue)
+string updateValue(const map<string, DCache::UpdateValue> &mpValue, const string &sValue)
 {
+    //紧凑编码先转回tars编码，更新后写入cache时再按配置转换
+    string sStreamValue = HashMap::CompactRecord::getInstance()->normalize(sValue);
     TarsInputStream<BufferReader> isk;
     isk.setBuffer(sStreamValue.c_str(), sStreamValue.length());
     TarsOutputStream<BufferWriter> osk;
@@ -2367,7 +2382,7 @@ int getSelectResult(const vector<MultiHashMap::Value> &vtValue, const vector<DCa
 
                 osk.write(vtValue[i]._mkey, 0);
                 osk.write(vtValue[i]._ukey, 1);
-                osk.write(vtValue[i]._value, 2);
+                osk.write(HashMap::CompactRecord::getInstance()->normalize(vtValue[i]._value), 2);
                 osk.write((char)vtValue[i]._iVersion, 3);
                 osk.write(vtValue[i]._iExpireTime, 4);
 
@@ -2401,7 +2416,7 @@ int getSelectResult(const vector<MultiHashMap::Value> &vtValue, const vector<DCa
 
                             osk.write(vtValue[i]._mkey, 0);
                             osk.write(vtValue[i]._ukey, 1);
-                            osk.write(vtValue[i]._value, 2);
+                            osk.write(HashMap::CompactRecord::getInstance()->normalize(vtValue[i]._value), 2);
                             osk.write((char)vtValue[i]._iVersion, 3);
                             osk.write(vtValue[i]._iExpireTime, 4);
 
@@ -2436,7 +2451,7 @@ int getSelectResult(const vector<MultiHashMap::Value> &vtValue, const vector<DCa
 
                     osk.write(vtValue[i]._mkey, 0);
                     osk.write(vtValue[i]._ukey, 1);
-                    osk.write(vtValue[i]._value, 2);
+                    osk.write(HashMap::CompactRecord::getInstance()->normalize(vtValue[i]._value), 2);
                     osk.write((char)vtValue[i]._iVersion, 3);
                     osk.write(vtValue[i]._iExpireTime, 4);
 
@@ -2944,6 +2959,16 @@ int DelResult(const string &mk, const vector<MultiHashMap::Value> &vtValue, cons
 
 string TarsDecode::read(uint8_t tag, const string& type, const string &sDefault, bool isRequire)
 {
+    if (HashMap::CompactRecord::isCompact(_buf))
+    {
+        if (HashMap::CompactRecord::getInstance()->isCurrent(_buf))
+        {
+            return HashMap::CompactRecord::getInstance()->read(_buf, tag, sDefault, isRequire);
+        }
+        //字段配置修改前写入的数据按原布局转回tars编码后读取
+        _buf = HashMap::CompactRecord::getInstance()->toTars(_buf);
+    }
+
     TarsInputStream<BufferReader> isk;
     isk.setBuffer(_buf.c_str(), _buf.length());
     string s;
@@ -3126,6 +3151,22 @@ void WriteBinLog::set(const string &mk, const vector<MultiHashMap::Value> &vs, b
         g_app.gstat()->setBinlogTime(0, TNOW);
 }
 
+void WriteBinLog::setDel(const string &mk, const vector<MultiHashMap::Value> &vs, const string &logfile)
+{
+    //一组记录一次写入文件，保证在binlog中连续
+    vector<string> vtBinLog;
+    MKBinLogEncode logEncode;
+    logEncode.EncodeSetDel(mk, vs, vtBinLog);
+    string sBinLog;
+    for (size_t i = 0; i < vtBinLog.size(); i++)
+    {
+        sBinLog += vtBinLog[i] + "\n";
+    }
+    writeToFile(sBinLog, logfile);
+    if (g_app.gstat()->serverType() == MASTER)
+        g_app.gstat()->setBinlogTime(0, TNOW);
+}
+
 void WriteBinLog::erase(const string &mk, const string &logfile, const enum BinLogType logType)
 {
     string sBinLog;
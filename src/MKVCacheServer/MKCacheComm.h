@@ -230,6 +230,7 @@ public:
     static void set(const string &mk, const string &uk, const string &value, uint32_t expireTime, bool dirty, const string &logfile, const enum BinLogType logType = BINLOG_NORMAL);
     static void set(const string &mk, const string &uk, const string &logfile, const enum BinLogType logType = BINLOG_NORMAL);
     static void set(const string &mk, const vector<MultiHashMap::Value> &vs, bool full, const string &logfile, bool fromDB = false, const enum BinLogType logType = BINLOG_NORMAL);
+    static void setDel(const string &mk, const vector<MultiHashMap::Value> &vs, const string &logfile);
     static void erase(const string &mk, const string &logfile, const enum BinLogType logType = BINLOG_NORMAL);
     static void del(const string &mk, const string &logfile, const enum BinLogType logType = BINLOG_NORMAL);
     static void setMKOnlyKey(const string &mk, const string &logfile, const enum BinLogType logType = BINLOG_NORMAL);
@@ -21,6 +21,7 @@
 #include "UnpackTable.h"
 #include "StringUtil.h"
 #include "Common.h"
+#include "TrafficCapture.h"
 
 using namespace std;
 using namespace tars;
@@ -171,23 +171,23 @@ tars::Int32 MKCacheImp::getMKV(const DCache::GetMKVReq &req, DCache::GetMKVRsp &
         vector<string> vtField;
         convertField(field, vtField);
 
+        int iRet;
         if (bUKey)
         {
-            int iRet = procSelectUK(current, vtField, mainKey, vtUKCond, vtValueCond, stLimit, bGetMKCout, vtData, iMKRecord);
-            if (iRet < 0)
-                return iRet;
-            else if (iRet == 1)
-                return 0;
+            iRet = procSelectUK(current, vtField, mainKey, vtUKCond, vtValueCond, stLimit, bGetMKCout, vtData, iMKRecord);
         }
         else
         {
-            int iRet = procSelectMK(current, vtField, mainKey, vtUKCond, vtValueCond, stLimit, bGetMKCout, vtData, iMKRecord);
-            if (iRet < 0)
-                return iRet;
-            else if (iRet == 1)
-                return 0;
-
+            iRet = procSelectMK(current, vtField, mainKey, vtUKCond, vtValueCond, stLimit, bGetMKCout, vtData, iMKRecord);
         }
+
+        //异步查询DB时数据不在内存中，按未命中记录
+        TrafficCapture::getInstance()->record(TOP_GET_MK, mainKey, 0, iRet < 0 ? TRS_ERROR : (vtData.empty() ? TRS_MISS : TRS_HIT));
+
+        if (iRet < 0)
+            return iRet;
+        else if (iRet == 1)
+            return 0;
     }
     catch (const std::exception &ex)
     {
@@ -265,10 +265,6 @@ tars::Int32 MKCacheImp::getMKVBatch(const DCache::MKVBatchReq &req, DCache::MKVB
             }
             sUK.assign(uKeyEncode.getBuffer(), uKeyEncode.getLength());
 
-
-
-
-
             for (i = 0; i < MainkeyCount; ++i)
             {
                 if (!g_route_table.isMySelf(vtMainKey[i]))
@@ -295,9 +291,26 @@ tars::Int32 MKCacheImp::getMKVBatch(const DCache::MKVBatchReq &req, DCache::MKVB
                     }
                     return ET_KEY_AREA_ERR;
                 }
+            }
+
+            //按jmem分组批量读取，每个jmem只加一次锁
+            vector<string> vtUKey(MainkeyCount, sUK);
+            vector<MKBatchGetItem> vtItem;
+            if (g_app.gstat()->isExpireEnabled())
+            {
+                g_HashMap.getBatch(vtMainKey, vtUKey, vtItem, true, TC_TimeProvider::getInstance()->getNow());
+            }
+            else
+            {
+                g_HashMap.getBatch(vtMainKey, vtUKey, vtItem);
+            }
+            g_app.ppReport(PPReport::SRP_GET_CNT, MainkeyCount);
 
+            for (i = 0; i < MainkeyCount; ++i)
+            {
+                g_app.gstat()->tryHit(_hitIndex);
                 DCache::MainKeyValue keyValue;
-                tars::Int32 iRet = selectUKCache(current, vtField, vtMainKey[i], sUK, vtUKCond, vtValueCond, stLimit, false, keyValue.value, keyValue.ret);
+                tars::Int32 iRet = selectUKResult(vtItem[i].ret, vtItem[i].value, vtField, vtMainKey[i], vtUKCond, vtValueCond, stLimit, false, keyValue.value, keyValue.ret);
                 if (iRet != 0)
                 {
                     if (iRet == 1)
@@ -553,9 +566,12 @@ tars::Int32 MKCacheImp::getMUKBatch(const DCache::MUKBatchReq &req, DCache::MUKB
 
     try
     {
+        vector<string> vtMainKey(MUKeyCount);
+        vector<string> vtUKey(MUKeyCount);
+        vector<vector<Condition> > vtAllUKCond(MUKeyCount);
         for (size_t i = 0; i < MUKeyCount; ++i)
         {
-            vector<Condition> vtUKCond;
+            vector<Condition> &vtUKCond = vtAllUKCond[i];
             int iRetCode;
             if (!checkRecord(vtMUKey[i], sMainKey, vtUKCond, iRetCode))
             {
@@ -573,16 +589,16 @@ tars::Int32 MKCacheImp::getMUKBatch(const DCache::MUKBatchReq &req, DCache::MUKB
                 //API直连模式，返回增量更新路由
                 if (VALUE_YES == context[GET_ROUTE])
                 {
-                    vector<string> vtMainKey;
+                    vector<string> vtRouteMainKey;
                     for (size_t j = 0; j < MUKeyCount; j++)
                     {
-                        vtMainKey.push_back(vtMUKey[j].mainKey);
+                        vtRouteMainKey.push_back(vtMUKey[j].mainKey);
                     }
 
                     RspUpdateServant updateServant;
                     map<string, string> rspContext;
                     rspContext[ROUTER_UPDATED] = "";
-                    int ret = RouterHandle::getInstance()->getUpdateServant(vtMainKey, false, context[API_IDC], updateServant);
+                    int ret = RouterHandle::getInstance()->getUpdateServant(vtRouteMainKey, false, context[API_IDC], updateServant);
                     if (ret != 0)
                     {
                         TLOGERROR(__FUNCTION__ << ":getUpdatedRoute error:" << ret << endl);
@@ -596,7 +612,6 @@ tars::Int32 MKCacheImp::getMUKBatch(const DCache::MUKBatchReq &req, DCache::MUKB
                 return ET_KEY_AREA_ERR;
             }
 
-            string sUK;
             TarsEncode uKeyEncode;
             for (size_t k = 0; k < vtUKCond.size(); ++k)
             {
@@ -604,19 +619,37 @@ tars::Int32 MKCacheImp::getMUKBatch(const DCache::MUKBatchReq &req, DCache::MUKB
                 const FieldInfo &fieldInfo = _fieldConf.mpFieldInfo[cond.fieldName];
                 uKeyEncode.write(cond.value, fieldInfo.tag, fieldInfo.type);
             }
-            sUK.assign(uKeyEncode.getBuffer(), uKeyEncode.getLength());
+            vtMainKey[i] = sMainKey;
+            vtUKey[i].assign(uKeyEncode.getBuffer(), uKeyEncode.getLength());
+        }
 
+        //按jmem分组批量读取，每个jmem只加一次锁
+        vector<MKBatchGetItem> vtItem;
+        if (g_app.gstat()->isExpireEnabled())
+        {
+            g_HashMap.getBatch(vtMainKey, vtUKey, vtItem, true, TC_TimeProvider::getInstance()->getNow());
+        }
+        else
+        {
+            g_HashMap.getBatch(vtMainKey, vtUKey, vtItem);
+        }
+        g_app.ppReport(PPReport::SRP_GET_CNT, MUKeyCount);
+
+        for (size_t i = 0; i < MUKeyCount; ++i)
+        {
+            sMainKey = vtMainKey[i];
             Record record;
             record = vtMUKey[i];
 
+            g_app.gstat()->tryHit(_hitIndex);
             DCache::MainKeyValue keyValue;
-            tars::Int32 iRet = selectUKCache(current, vtField, sMainKey, sUK, vtUKCond, vtValueCond, stLimit, false, keyValue.value, keyValue.ret);
+            tars::Int32 iRet = selectUKResult(vtItem[i].ret, vtItem[i].value, vtField, sMainKey, vtAllUKCond[i], vtValueCond, stLimit, false, keyValue.value, keyValue.ret);
             if (iRet != 0)
             {
                 if (iRet == 1)
                 {
 
-                    mpNeedDBAccess[sMainKey].push_back(vtUKCond);
+                    mpNeedDBAccess[sMainKey].push_back(vtAllUKCond[i]);
 
                 }
                 else
@@ -987,6 +1020,81 @@ tars::Int32 MKCacheImp::getAllMainKey(const DCache::GetAllKeysReq &req, DCache::
     return ET_SUCC;
 }
 
+tars::Int32 MKCacheImp::scanMainKey(const DCache::ScanKeysReq &req, DCache::ScanKeysRsp &rsp, tars::TarsCurrentPtr current)
+{
+    TLOGDEBUG("MKCacheImp::scanMainKey: cursor:" << req.cursor << " count:" << req.count << " match:" << req.match << " timeLimit:" << req.timeLimit << endl);
+
+    if (req.moduleName != _moduleName)
+    {
+        //返回模块错误
+        TLOGERROR("MKCacheImp::scanMainKey: moduleName error!" << req.moduleName << endl);
+        return ET_MODULE_NAME_INVALID;
+    }
+
+    //cursor为下一个要遍历的hash桶的位置，各jmem的桶依次排列
+    if ((req.cursor < 0) || (req.cursor > UINT32_MAX) || (req.count <= 0) || (req.timeLimit < 0))
+    {
+        TLOGERROR("[MKCacheImp::scanMainKey]: condition error" << endl);
+        return ET_INPUT_PARAM_ERROR;
+    }
+
+    rsp.cursor = 0;
+
+    try
+    {
+        MultiHashMap::mk_hash_iterator it = g_HashMap.mHashByPos(req.cursor);
+
+        int64_t iBeginMs = TC_TimeProvider::getInstance()->getNowMs();
+        tars::Int64 iPos = req.cursor;
+        vector<string> vtKey;
+        while (it != g_HashMap.mHashEnd())
+        {
+            vtKey.clear();
+            it->getKey(vtKey);
+            it++;
+            ++iPos;
+
+            for (size_t i = 0; i < vtKey.size(); ++i)
+            {
+                if (req.match.empty() || StringUtil::matchPattern(vtKey[i], req.match))
+                {
+                    rsp.keys.push_back(vtKey[i]);
+                }
+            }
+
+            if (iPos - req.cursor >= req.count)
+            {
+                break;
+            }
+
+            //每遍历64个桶检查一次耗时
+            if ((req.timeLimit > 0) && ((iPos - req.cursor) % 64 == 0) && (TC_TimeProvider::getInstance()->getNowMs() - iBeginMs >= req.timeLimit))
+            {
+                break;
+            }
+        }
+
+        if (it != g_HashMap.mHashEnd())
+        {
+            rsp.cursor = iPos;
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        TLOGERROR("MKCacheImp::scanMainKey exception: " << ex.what() << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
+    catch (...)
+    {
+        TLOGERROR("MKCacheImp::scanMainKey unkown exception" << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
+
+    return ET_SUCC;
+}
+
 tars::Int32 MKCacheImp::getMKVBatchEx(const DCache::MKVBatchExReq &req, DCache::MKVBatchExRsp &rsp, tars::TarsCurrentPtr current)
 {
     const vector<DCache::MainKeyCondition> & vtKey = req.cond;
@@ -2465,7 +2573,11 @@ int MKCacheImp::selectUKCache(tars::TarsCurrentPtr current, const vector<string>
         iRet = g_HashMap.get(mk, uk, v);
     }
 
+    return selectUKResult(iRet, v, vtField, mk, vtUKCond, vtValueCond, stLimit, bGetMKCout, vtData, iMKRecord);
+}
 
+int MKCacheImp::selectUKResult(int iRet, const MultiHashMap::Value &v, const vector<string> &vtField, const string &mk, const vector<DCache::Condition> & vtUKCond, const vector<DCache::Condition> &vtValueCond, const Limit &stLimit, tars::Bool bGetMKCout, vector<map<std::string, std::string> > &vtData, int &iMKRecord)
+{
     if (iRet == TC_Multi_HashMap_Malloc::RT_OK)
     {
         g_app.gstat()->hit(_hitIndex);
@@ -2531,6 +2643,39 @@ int MKCacheImp::selectMKCache(tars::TarsCurrentPtr current, const vector<string>
 
     g_app.gstat()->tryHit(_hitIndex);
 
+    //条件命中索引字段时，只取候选记录进行过滤
+    MKValueIndex *pValueIndex = g_app.valueIndex();
+    if ((vtUKCond.size() > 0 || vtValueCond.size() > 0) && pValueIndex->isEnable())
+    {
+        bool bCheckExpire = g_app.gstat()->isExpireEnabled();
+        uint32_t iNowTime = bCheckExpire ? TC_TimeProvider::getInstance()->getNow() : 0;
+        size_t iLimit = stLimit.bLimit ? stLimit.iIndex + stLimit.iCount : size_t(-1);
+        if (pValueIndex->select(mk, vtUKCond, vtValueCond, bCheckExpire, iNowTime, iLimit, vtValue) == 0)
+        {
+            if (!stLimit.bLimit && vtValue.size() > _mkeyMaxSelectCount)
+            {
+                FDLOG("MainKeyDataCount") << "[selectMKCache] mainKey=" << mk << " indexDataCount=" << vtValue.size() << endl;
+                TLOGERROR("MKCacheImp::selectMKCache: value index select too much data, mainKey = " << mk << " iDataCount = " << vtValue.size() << endl);
+                g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
+                return -2;
+            }
+
+            g_app.gstat()->hit(_hitIndex);
+            getSelectResult(vtField, mk, vtValue, vtUKCond, vtValueCond, stLimit, vtData);
+            if (bGetMKCout)
+            {
+                iMKRecord = g_HashMap.count(mk);
+            }
+            else
+            {
+                iMKRecord = vtData.size();
+            }
+            TLOGDEBUG("MKCacheImp::selectMKCache by value index. Get " << vtData.size() << " result|candidate=" << vtValue.size() << "|mk=" << mk << endl);
+            return 0;
+        }
+        vtValue.clear();
+    }
+
     size_t iCount = -1;
     size_t iStart = 0;
     size_t iDataCount = 0;
@@ -63,6 +63,8 @@ public:
 
     virtual tars::Int32 getAllMainKey(const DCache::GetAllKeysReq &req, DCache::GetAllKeysRsp &rsp, tars::TarsCurrentPtr current);
 
+    virtual tars::Int32 scanMainKey(const DCache::ScanKeysReq &req, DCache::ScanKeysRsp &rsp, tars::TarsCurrentPtr current);
+
     //List/Set/ZSet
     virtual tars::Int32 getList(const DCache::GetListReq &req, DCache::GetListRsp &rsp, tars::TarsCurrentPtr current);
     virtual tars::Int32 getRangeList(const DCache::GetRangeListReq &req, DCache::BatchEntry &rsp, tars::TarsCurrentPtr current);
@@ -89,6 +91,8 @@ protected:
     int procSelectMK(tars::TarsCurrentPtr current, const vector<string> &vtField, const string &mk, const vector<DCache::Condition> & vtUKCond, const vector<DCache::Condition> &vtValueCond, const Limit &stLimit, tars::Bool bGetMKCout, vector<map<std::string, std::string> > &vtData, int &iMKRecord);
 
     int selectUKCache(tars::TarsCurrentPtr current, const vector<string> &vtField, const string &mk, const string &uk, const vector<DCache::Condition> & vtUKCond, const vector<DCache::Condition> &vtValueCond, const Limit &stLimit, tars::Bool bGetMKCout, vector<map<std::string, std::string> > &vtData, int &iMKRecord);
+    //处理按联合key读取的结果，iRet和v为g_HashMap.get(mk, uk, v)的返回，供批量读复用
+    int selectUKResult(int iRet, const MultiHashMap::Value &v, const vector<string> &vtField, const string &mk, const vector<DCache::Condition> & vtUKCond, const vector<DCache::Condition> &vtValueCond, const Limit &stLimit, tars::Bool bGetMKCout, vector<map<std::string, std::string> > &vtData, int &iMKRecord);
     int selectMKCache(tars::TarsCurrentPtr current, const vector<string> &vtField, const string &mk, const vector<DCache::Condition> & vtUKCond, const vector<DCache::Condition> &vtValueCond, const Limit &stLimit, tars::Bool bGetMKCout, vector<map<std::string, std::string> > &vtData, int &iMKRecord);
     int selectMKCache(const vector<string> &vtField, const string &mk, const vector<vector<DCache::Condition> > & vtCond, const Limit &stLimit, tars::Bool bGetMKCout, vector<map<std::string, std::string> > &vtData, int &iMKRecord);
 
@@ -19,6 +19,7 @@
 #include "RouterClientImp.h"
 #include "MKBackUpImp.h"
 #include "MKControlAckImp.h"
+#include "jmem_multi_hashmap_malloc/MKCompactRecord.h"
 
 MKCacheServer g_app;
 
@@ -674,11 +675,16 @@ MKCacheServer::initialize()
     TARS_ADD_ADMIN_CMD_NORMAL("servertype", MKCacheServer::showServerType);
     TARS_ADD_ADMIN_CMD_NORMAL("key", MKCacheServer::showKey);
     TARS_ADD_ADMIN_CMD_NORMAL("dirtystatic", MKCacheServer::dirtyStatic);
+    TARS_ADD_ADMIN_CMD_NORMAL("valueindex", MKCacheServer::showValueIndex);
+    TARS_ADD_ADMIN_CMD_NORMAL("compactrecord", MKCacheServer::showCompactRecord);
+    TARS_ADD_ADMIN_CMD_NORMAL("capture", MKCacheServer::showCapture);
 
 
     int iRet = _ppReport.init();
     assert(iRet == 0);
 
+    TrafficCapture::getInstance()->init(_tcConf, TST_MKV);
+
     iRet = _gStat.init();
     assert(iRet == 0);
 
@@ -766,6 +772,13 @@ MKCacheServer::initialize()
     }
     _gStat.setFieldConfig(fieldConfig);
 
+    string sCompactRecord = _tcConf.get("/Main/Cache<CompactRecord>", "N");
+    //用过的布局记录在数据目录下，修改value字段配置后仍可读取共享内存中按原布局编码的数据
+    HashMap::CompactRecord::getInstance()->init(*reinterpret_cast<TC_Multi_HashMap_Malloc::FieldConf*>(&fieldConfig), sCompactRecord == "Y" || sCompactRecord == "y", ServerConfig::DataPath + "/CompactLayout.dat");
+    TLOGDEBUG("[MKCacheServer::initialize] " << HashMap::CompactRecord::getInstance()->desc() << endl);
+
+    _valueIndex.init(_tcConf);
+
     //生成binlog文件
     string sRecordBinLog = _tcConf.get("/Main/BinLog<Record>", "Y");
     bool _recordBinLog = (sRecordBinLog == "Y" || sRecordBinLog == "y") ? true : false;
@@ -804,9 +817,10 @@ MKCacheServer::initialize()
     //启动定时生成binlog文件线程
     _createBinlogFileThread.createThread();
 
-    //hashmap初始化
-    MKHash *pHash = new MKHash();
-//    typedef uint32_t(MKHash::*TpMem)(const string &);
+    //hashmap初始化，hash函数使用路由中模块的hash类型，与proxy路由时一致
+    int iHashType = g_route_table.getHashType();
+    P_Hash *pHash = HashFactory::getHash(iHashType);
+    TLOGDEBUG("MKCacheServer::initialize hash type:" << HashFactory::getHashName(iHashType) << endl);
 
     bool bCreate = false;
     string sSemKeyFile = ServerConfig::DataPath + "/SemKey.dat", sSemKey = "";
@@ -961,6 +975,7 @@ MKCacheServer::initialize()
     g_HashMap.initHashRatio(TC_Common::strto<float>(_tcConf["/Main/Cache<HashRadio>"]));
     g_HashMap.initMainKeyHashRatio(TC_Common::strto<float>(_tcConf["/Main/Cache<MKHashRadio>"]));
     g_HashMap.initDataSize(TC_Common::strto<size_t>(_tcConf["/Main/Cache<AvgDataSize>"]));
+    g_HashMap.initHashType(iHashType);
     g_HashMap.initLock(key, iShmNum, -1);
 
 
@@ -983,10 +998,9 @@ MKCacheServer::initialize()
 
     g_HashMap.setToDoFunctor(&_todoFunctor);
 
-//    TC_Multi_HashMap_Malloc::hash_functor cmd_mk(pHash, static_cast<TpMem>(&MKHash::HashMK));
-//    TC_Multi_HashMap_Malloc::hash_functor cmd_mkuk(pHash, static_cast<TpMem>(&MKHash::HashMKUK));
-    g_HashMap.setHashFunctorM(std::bind(&MKHash::HashMK, pHash, std::placeholders::_1));
-    g_HashMap.setHashFunctor(std::bind(&MKHash::HashMKUK, pHash, std::placeholders::_1));
+    //主key的hash与路由一致，迁移时按hash值遍历主key
+    g_HashMap.setHashFunctorM(std::bind(&P_Hash::HashRawString, pHash, std::placeholders::_1));
+    g_HashMap.setHashFunctor(std::bind(&P_Hash::HashRawString, pHash, std::placeholders::_1));
     g_HashMap.setAutoErase(false);
 
     _gStat.setSlaveCreating(false);
@@ -1124,6 +1138,9 @@ bool MKCacheServer::help(const string& command, const string& params, string& re
     result += "calculateData: 统计未被访问数据大小\n";
     result += "setalldirty：将cache内全部数据设置成脏数据\n";
     result += "clearcache：清空cache，危险操作，请三思\n";
+    result += "valueindex: 显示value字段索引的状态\n";
+    result += "compactrecord: 显示value紧凑编码的状态\n";
+    result += "capture: 流量采集状态\n";
 
     return true;
 }
@@ -1273,6 +1290,8 @@ bool MKCacheServer::reloadConf(const string& command, const string& params, stri
     _syncAllThread.reload();
     _eraseDataInPageFunc.reload(_tcConf);
     _binlogTimeThread.reload();
+    _valueIndex.reload(_tcConf);
+    TrafficCapture::getInstance()->init(_tcConf, TST_MKV);
     if ((_tcConf["/Main/Cache<StartExpireThread>"] == "Y" || _tcConf["/Main/Cache<StartExpireThread>"] == "y"))
     {
         _expireThread.reload();
@@ -1312,12 +1331,30 @@ bool MKCacheServer::showServerType(const string& command, const string& params,
     return true;
 }
 
+bool MKCacheServer::showCapture(const string& command, const string& params, string& result)
+{
+    result = TrafficCapture::getInstance()->status();
+    return true;
+}
+
 bool MKCacheServer::showKey(const string& command, const string& params, string& result)
 {
     result = _shmKey;
     return true;
 }
 
+bool MKCacheServer::showValueIndex(const string& command, const string& params, string& result)
+{
+    result = _valueIndex.desc();
+    return true;
+}
+
+bool MKCacheServer::showCompactRecord(const string& command, const string& params, string& result)
+{
+    result = HashMap::CompactRecord::getInstance()->desc();
+    return true;
+}
+
 bool MKCacheServer::setAllDirty(const string& command, const string& params, string& result)
 {
     ostringstream os;
@@ -1901,6 +1938,11 @@ SlaveCreateThread* MKCacheServer::slaveCreateThread()
     return &_slaveCreateThread;
 }
 
+MKValueIndex* MKCacheServer::valueIndex()
+{
+    return &_valueIndex;
+}
+
 /////////////////////////////////////////////////////////////////
 void
 MKCacheServer::destroyApp()
@@ -1917,6 +1959,7 @@ MKCacheServer::destroyApp()
     _slaveCreateThread.stop();
     _deleteThread.stop();
     _heartBeatThread.stop();
+    TrafficCapture::getInstance()->terminate();
 
     if ((_tcConf["/Main/Cache<StartExpireThread>"] == "Y" || _tcConf["/Main/Cache<StartExpireThread>"] == "y"))
     {
@@ -1936,23 +1979,3 @@ MKCacheServer::destroyApp()
     }
     TLOGERROR("MKCacheServer::destroyApp Succ" << endl);
 }
-/////////////////////////////////////////////////////////////////
-int
-main(int argc, char* argv[])
-{
-    try
-    {
-        g_app.main(argc, argv);
-        g_app.waitForShutdown();
-    }
-    catch (std::exception& e)
-    {
-        cerr << "std::exception:" << e.what() << std::endl;
-    }
-    catch (...)
-    {
-        cerr << "unknown exception." << std::endl;
-    }
-    return -1;
-}
-/////////////////////////////////////////////////////////////////
@@ -26,12 +26,12 @@
 #include "ExpireThread.h"
 #include "DeleteThread.h"
 #include "MKBinLogEncode.h"
-#include "MKHash.h"
 #include "MKCacheGlobe.h"
 #include "MKBinLogTimeThread.h"
 #include "RouterHandle.h"
 #include "SlaveCreateThread.h"
 #include "DumpThread.h"
+#include "MKValueIndex.h"
 #include "../ConfigServer/Config.h"
 
 using namespace std;
@@ -263,6 +263,30 @@ public:
     */
     bool showKey(const string& command, const string& params, string& result);
 
+    /**
+    *通过admin端口查看流量采集状态，采集通过/Main/Capture配置开关，reload生效
+    *   command: 命令字为 "capture"
+    *	params:	空
+    *	result:	采集状态
+    */
+    bool showCapture(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口查看value字段索引的状态
+    *   command: 命令字为 "valueindex"
+    *	params:	空
+    *	result:	操作结果
+    */
+    bool showValueIndex(const string& command, const string& params, string& result);
+
+    /**
+    *通过admin端口查看value紧凑编码的状态
+    *   command: 命令字为 "compactrecord"
+    *	params:	空
+    *	result:	操作结果
+    */
+    bool showCompactRecord(const string& command, const string& params, string& result);
+
     /**
     *通过admin端口查看服务状态
     *   command: 命令字为 "servertype"
@@ -330,6 +354,8 @@ public:
 
     SlaveCreateThread* slaveCreateThread();
 
+    MKValueIndex* valueIndex();
+
     void enableConnectHb(bool enable)
     {
         _heartBeatThread.enableConHb(enable);
@@ -456,6 +482,9 @@ protected:
 
     GlobalStat _gStat;
 
+    //value字段的二级索引
+    MKValueIndex _valueIndex;
+
     // 信号量或者共享内存key
     string _shmKey;
 
@@ -0,0 +1,586 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "MKValueIndex.h"
+#include "MKCacheServer.h"
+#include "jmem_multi_hashmap_malloc/MKCompactRecord.h"
+
+#define TYPE_BYTE "byte"
+#define TYPE_SHORT "short"
+#define TYPE_INT "int"
+#define TYPE_LONG "long"
+#define TYPE_STRING "string"
+#define TYPE_UINT32 "unsigned int"
+#define TYPE_UINT16 "unsigned short"
+
+//有符号整数翻转符号位后按大端存放，字节序与数值大小顺序一致
+static void appendOrderInt(string &s, int64_t n)
+{
+    uint64_t u = (uint64_t)n ^ 0x8000000000000000ULL;
+    for (int i = 7; i >= 0; --i)
+    {
+        s.push_back((char)((u >> (i * 8)) & 0xFF));
+    }
+}
+
+static void appendOrderUInt(string &s, uint64_t u)
+{
+    for (int i = 7; i >= 0; --i)
+    {
+        s.push_back((char)((u >> (i * 8)) & 0xFF));
+    }
+}
+
+template<typename T>
+static T readField(TarsInputStream<BufferReader> &isk, const FieldInfo &info)
+{
+    T n = TC_Common::strto<T>(info.defValue);
+    isk.read(n, info.tag, info.bRequire);
+    return n;
+}
+
+MKValueIndex::MKValueIndex()
+    : _conf(std::make_shared<const IndexConf>())
+    , _hitCount(0)
+    , _buildCount(0)
+    , _fallbackCount(0)
+    , _unstableCount(0)
+{
+}
+
+void MKValueIndex::init(TC_Config &conf)
+{
+    loadConf(conf);
+    IndexConfPtr pConf = this->conf();
+    TLOGDEBUG("MKValueIndex::init enable:" << pConf->bEnable << "|field:" << TC_Common::tostr(pConf->vtIndexField.begin(), pConf->vtIndexField.end(), "|") << endl);
+}
+
+void MKValueIndex::reload(TC_Config &conf)
+{
+    loadConf(conf);
+    //索引字段可能变化，已有索引全部丢弃，并发查询按旧配置建立的索引也会因配置不同而失效
+    clear();
+    IndexConfPtr pConf = this->conf();
+    TLOGDEBUG("MKValueIndex::reload enable:" << pConf->bEnable << "|field:" << TC_Common::tostr(pConf->vtIndexField.begin(), pConf->vtIndexField.end(), "|") << endl);
+}
+
+void MKValueIndex::loadConf(TC_Config &conf)
+{
+    std::shared_ptr<IndexConf> pConf = std::make_shared<IndexConf>();
+    pConf->iMinRecord = TC_Common::strto<size_t>(conf.get("/Main/Cache<IndexMinRecord>", "1000"));
+    pConf->iMaxRecord = TC_Common::strto<size_t>(conf.get("/Main/Cache<IndexMaxRecord>", "200000"));
+    pConf->iMaxMainKey = TC_Common::strto<size_t>(conf.get("/Main/Cache<IndexMaxMainKey>", "1000"));
+    pConf->iStableQuery = TC_Common::strto<uint32_t>(conf.get("/Main/Cache<IndexStableQuery>", "3"));
+
+    const FieldConf &fieldConfig = g_app.gstat()->fieldconfig();
+
+    vector<string> vtIndexField;
+    set<string> stIndexField;
+    set<string> stUKField;
+    vector<string> vtField = TC_Common::sepstr<string>(conf.get("/Main/Cache<IndexField>", ""), "|");
+    for (size_t i = 0; i < vtField.size(); i++)
+    {
+        string sField = TC_Common::trim(vtField[i]);
+        map<string, int>::const_iterator itType = fieldConfig.mpFieldType.find(sField);
+        map<string, FieldInfo>::const_iterator itInfo = fieldConfig.mpFieldInfo.find(sField);
+        if (itType == fieldConfig.mpFieldType.end() || itType->second == 0 || itInfo == fieldConfig.mpFieldInfo.end())
+        {
+            TLOGERROR("MKValueIndex::loadConf " << sField << " is not a ukey or value field, ignored" << endl);
+            continue;
+        }
+
+        string sKey;
+        if (!encodeCondValue(itInfo->second.type, itInfo->second.defValue, sKey))
+        {
+            TLOGERROR("MKValueIndex::loadConf " << sField << " type " << itInfo->second.type << " can not be indexed, ignored" << endl);
+            continue;
+        }
+
+        if (stIndexField.insert(sField).second)
+        {
+            vtIndexField.push_back(sField);
+            if (itType->second == 1)
+            {
+                stUKField.insert(sField);
+            }
+        }
+    }
+
+    string sKeyType = conf.get("/Main/Cache<MainKeyType>", "hash");
+    if (sKeyType != "hash" && !vtIndexField.empty())
+    {
+        TLOGERROR("MKValueIndex::loadConf index only support hash MainKeyType, disabled" << endl);
+        vtIndexField.clear();
+        stIndexField.clear();
+        stUKField.clear();
+    }
+
+    pConf->vtIndexField.swap(vtIndexField);
+    pConf->stIndexField.swap(stIndexField);
+    pConf->stUKField.swap(stUKField);
+    pConf->bEnable = !pConf->vtIndexField.empty() && pConf->iMaxMainKey > 0;
+    std::atomic_store(&_conf, IndexConfPtr(pConf));
+}
+
+bool MKValueIndex::encodeCondValue(const string &sType, const string &sValue, string &sKey)
+{
+    //与judgeValue中条件值的转换方式保持一致
+    if (sType == TYPE_BYTE)
+    {
+        appendOrderInt(sKey, TC_Common::strto<tars::Char>(sValue));
+    }
+    else if (sType == TYPE_SHORT)
+    {
+        appendOrderInt(sKey, TC_Common::strto<tars::Short>(sValue));
+    }
+    else if (sType == TYPE_INT)
+    {
+        appendOrderInt(sKey, TC_Common::strto<tars::Int32>(sValue));
+    }
+    else if (sType == TYPE_LONG)
+    {
+        appendOrderInt(sKey, TC_Common::strto<tars::Int64>(sValue));
+    }
+    else if (sType == TYPE_UINT32)
+    {
+        appendOrderUInt(sKey, TC_Common::strto<tars::UInt32>(sValue));
+    }
+    else if (sType == TYPE_UINT16)
+    {
+        appendOrderUInt(sKey, TC_Common::strto<tars::UInt16>(sValue));
+    }
+    else if (sType == TYPE_STRING)
+    {
+        sKey += sValue;
+    }
+    else
+    {
+        //float和double比较带误差，不走索引
+        return false;
+    }
+    return true;
+}
+
+string MKValueIndex::encodeFieldValue(const string &sRawValue, const FieldInfo &info)
+{
+    string sValue = HashMap::CompactRecord::getInstance()->normalize(sRawValue);
+    TarsInputStream<BufferReader> isk;
+    isk.setBuffer(sValue.c_str(), sValue.length());
+
+    string sKey;
+    if (info.type == TYPE_BYTE)
+    {
+        appendOrderInt(sKey, readField<tars::Char>(isk, info));
+    }
+    else if (info.type == TYPE_SHORT)
+    {
+        appendOrderInt(sKey, readField<tars::Short>(isk, info));
+    }
+    else if (info.type == TYPE_INT)
+    {
+        appendOrderInt(sKey, readField<tars::Int32>(isk, info));
+    }
+    else if (info.type == TYPE_LONG)
+    {
+        appendOrderInt(sKey, readField<tars::Int64>(isk, info));
+    }
+    else if (info.type == TYPE_UINT32)
+    {
+        appendOrderUInt(sKey, readField<tars::UInt32>(isk, info));
+    }
+    else if (info.type == TYPE_UINT16)
+    {
+        appendOrderUInt(sKey, readField<tars::UInt16>(isk, info));
+    }
+    else if (info.type == TYPE_STRING)
+    {
+        sKey = info.defValue;
+        isk.read(sKey, info.tag, info.bRequire);
+    }
+    else
+    {
+        throw MKDCacheException("MKValueIndex::encodeFieldValue type error");
+    }
+    return sKey;
+}
+
+bool MKValueIndex::plan(const IndexConf &indexConf, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond, string &sField, IndexRange &range, bool &bExact)
+{
+    const FieldConf &fieldConfig = g_app.gstat()->fieldconfig();
+
+    size_t iCondCount = vtUKCond.size() + vtValueCond.size();
+    map<string, IndexRange> mpRange;
+    map<string, size_t> mpRangeCondCount;
+    string sRangeField;
+    for (size_t i = 0; i < iCondCount; i++)
+    {
+        //联合key的条件在前，范围条件优先走联合key字段
+        const DCache::Condition &cond = i < vtUKCond.size() ? vtUKCond[i] : vtValueCond[i - vtUKCond.size()];
+        if (indexConf.stIndexField.find(cond.fieldName) == indexConf.stIndexField.end())
+        {
+            continue;
+        }
+        if (cond.op != DCache::EQ && cond.op != DCache::GT && cond.op != DCache::GE && cond.op != DCache::LT && cond.op != DCache::LE)
+        {
+            continue;
+        }
+
+        map<string, FieldInfo>::const_iterator itInfo = fieldConfig.mpFieldInfo.find(cond.fieldName);
+        if (itInfo == fieldConfig.mpFieldInfo.end())
+        {
+            continue;
+        }
+
+        string sKey;
+        if (!encodeCondValue(itInfo->second.type, cond.value, sKey))
+        {
+            continue;
+        }
+
+        if (cond.op == DCache::EQ)
+        {
+            sField = cond.fieldName;
+            range.bLower = range.bUpper = true;
+            range.bLowerInclude = range.bUpperInclude = true;
+            range.sLower = range.sUpper = sKey;
+            bExact = (iCondCount == 1);
+            return true;
+        }
+
+        IndexRange &r = mpRange[cond.fieldName];
+        mpRangeCondCount[cond.fieldName]++;
+        if (sRangeField.empty())
+        {
+            sRangeField = cond.fieldName;
+        }
+
+        if (cond.op == DCache::GT || cond.op == DCache::GE)
+        {
+            bool bInclude = (cond.op == DCache::GE);
+            if (!r.bLower || sKey > r.sLower || (sKey == r.sLower && !bInclude))
+            {
+                r.bLower = true;
+                r.sLower = sKey;
+                r.bLowerInclude = bInclude;
+            }
+        }
+        else
+        {
+            bool bInclude = (cond.op == DCache::LE);
+            if (!r.bUpper || sKey < r.sUpper || (sKey == r.sUpper && !bInclude))
+            {
+                r.bUpper = true;
+                r.sUpper = sKey;
+                r.bUpperInclude = bInclude;
+            }
+        }
+    }
+
+    if (sRangeField.empty())
+    {
+        return false;
+    }
+
+    sField = sRangeField;
+    range = mpRange[sRangeField];
+    //所有条件都落在该字段的范围内时，候选记录即为最终结果
+    bExact = (mpRangeCondCount[sRangeField] == iCondCount);
+    return true;
+}
+
+MKValueIndex::IndexEntryPtr MKValueIndex::build(const IndexConfPtr &pConf, const vector<MultiHashMap::Value> &vtValue, uint32_t iGeneration)
+{
+    const FieldConf &fieldConfig = g_app.gstat()->fieldconfig();
+
+    IndexEntryPtr entry = new IndexEntry(iGeneration, true);
+    entry->pConf = pConf;
+    entry->vtUKey.reserve(vtValue.size());
+
+    for (size_t i = 0; i < pConf->vtIndexField.size(); i++)
+    {
+        const string &sField = pConf->vtIndexField[i];
+        const FieldInfo &info = fieldConfig.mpFieldInfo.find(sField)->second;
+        bool bUKField = (pConf->stUKField.find(sField) != pConf->stUKField.end());
+        multimap<string, uint32_t> &index = entry->mpFieldIndex[sField];
+        for (size_t j = 0; j < vtValue.size(); j++)
+        {
+            index.insert(make_pair(encodeFieldValue(bUKField ? vtValue[j]._ukey : vtValue[j]._value, info), (uint32_t)j));
+        }
+    }
+
+    for (size_t j = 0; j < vtValue.size(); j++)
+    {
+        entry->vtUKey.push_back(vtValue[j]._ukey);
+    }
+
+    return entry;
+}
+
+void MKValueIndex::scan(const IndexEntryPtr &entry, const string &sField, const IndexRange &range, vector<uint32_t> &vtPos)
+{
+    map<string, multimap<string, uint32_t> >::const_iterator itField = entry->mpFieldIndex.find(sField);
+    if (itField == entry->mpFieldIndex.end())
+    {
+        return;
+    }
+
+    if (range.bLower && range.bUpper)
+    {
+        if (range.sLower > range.sUpper)
+            return;
+        if (range.sLower == range.sUpper && !(range.bLowerInclude && range.bUpperInclude))
+            return;
+    }
+
+    const multimap<string, uint32_t> &index = itField->second;
+    multimap<string, uint32_t>::const_iterator it = index.begin();
+    multimap<string, uint32_t>::const_iterator itEnd = index.end();
+    if (range.bLower)
+    {
+        it = range.bLowerInclude ? index.lower_bound(range.sLower) : index.upper_bound(range.sLower);
+    }
+    if (range.bUpper)
+    {
+        itEnd = range.bUpperInclude ? index.upper_bound(range.sUpper) : index.lower_bound(range.sUpper);
+    }
+
+    //按数据链的顺序返回，与按主key全部查询的结果顺序一致，分页时不受索引状态影响
+    for (; it != itEnd; ++it)
+    {
+        vtPos.push_back(it->second);
+    }
+    sort(vtPos.begin(), vtPos.end());
+}
+
+int MKValueIndex::select(const string &mk, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond, bool bCheckExpire, uint32_t iNowTime, size_t iLimit, vector<MultiHashMap::Value> &vtValue)
+{
+    //整个查询使用同一份配置，reload不影响进行中的查询
+    IndexConfPtr pConf = conf();
+    if (!pConf->bEnable)
+    {
+        return 1;
+    }
+
+    string sField;
+    IndexRange range;
+    bool bExact = false;
+    if (!plan(*pConf, vtUKCond, vtValueCond, sField, range, bExact))
+    {
+        return 1;
+    }
+    //候选记录不是最终结果时，不能提前结束
+    if (!bExact)
+    {
+        iLimit = size_t(-1);
+    }
+
+    try
+    {
+        //代数必须在读取数据之前获取，读取过程中有修改则索引随即失效
+        uint32_t iGeneration = g_HashMap.getMainKeyGeneration(mk);
+
+        IndexEntryPtr entry = find(mk);
+        if (entry && entry->bBuilt && entry->iGeneration == iGeneration && entry->pConf == pConf)
+        {
+            //主key可能已被淘汰或数据不完整
+            if (g_HashMap.checkMainKey(mk) != TC_Multi_HashMap_Malloc::RT_OK)
+            {
+                ++_fallbackCount;
+                return 1;
+            }
+
+            vector<uint32_t> vtPos;
+            scan(entry, sField, range, vtPos);
+
+            for (size_t i = 0; i < vtPos.size() && vtValue.size() < iLimit; i++)
+            {
+                MultiHashMap::Value v;
+                int iRet = g_HashMap.get(mk, entry->vtUKey[vtPos[i]], v, bCheckExpire, iNowTime);
+                if (iRet == TC_Multi_HashMap_Malloc::RT_OK)
+                {
+                    vtValue.push_back(v);
+                }
+                else if (iRet != TC_Multi_HashMap_Malloc::RT_DATA_DEL && iRet != TC_Multi_HashMap_Malloc::RT_DATA_EXPIRED && iRet != TC_Multi_HashMap_Malloc::RT_ONLY_KEY)
+                {
+                    //查询过程中主key被淘汰
+                    vtValue.clear();
+                    ++_fallbackCount;
+                    return 1;
+                }
+            }
+            ++_hitCount;
+            return 0;
+        }
+
+        size_t iDataCount = 0;
+        if (g_HashMap.get(mk, iDataCount) != TC_Multi_HashMap_Malloc::RT_OK || iDataCount < pConf->iMinRecord || iDataCount > pConf->iMaxRecord)
+        {
+            if (entry)
+            {
+                erase(mk);
+            }
+            return 1;
+        }
+
+        //索引不存在或已失效，代数在连续IndexStableQuery次查询中不变才建立，
+        //否则按主key全部查询，代价与不使用索引时相同
+        if (!entry || entry->iGeneration != iGeneration || (entry->bBuilt && entry->pConf != pConf))
+        {
+            if (pConf->iStableQuery > 1)
+            {
+                //同时替换掉失效的索引
+                insert(mk, new IndexEntry(iGeneration, false), pConf->iMaxMainKey);
+                ++_unstableCount;
+                return 1;
+            }
+        }
+        else if (++entry->iStableQuery < pConf->iStableQuery)
+        {
+            ++_unstableCount;
+            return 1;
+        }
+
+        vector<MultiHashMap::Value> vtAll;
+        if (g_HashMap.get(mk, vtAll) != TC_Multi_HashMap_Malloc::RT_OK)
+        {
+            ++_fallbackCount;
+            return 1;
+        }
+
+        entry = build(pConf, vtAll, iGeneration);
+        insert(mk, entry, pConf->iMaxMainKey);
+        ++_buildCount;
+
+        vector<uint32_t> vtPos;
+        scan(entry, sField, range, vtPos);
+
+        for (size_t i = 0; i < vtPos.size() && vtValue.size() < iLimit; i++)
+        {
+            const MultiHashMap::Value &v = vtAll[vtPos[i]];
+            if (!bCheckExpire || v._iExpireTime == 0 || v._iExpireTime > iNowTime)
+            {
+                vtValue.push_back(v);
+            }
+        }
+        return 0;
+    }
+    catch (const std::exception &ex)
+    {
+        TLOGERROR("MKValueIndex::select exception: " << ex.what() << ", mainKey = " << mk << endl);
+    }
+    catch (...)
+    {
+        TLOGERROR("MKValueIndex::select unknown exception, mainKey = " << mk << endl);
+    }
+
+    vtValue.clear();
+    erase(mk);
+    ++_fallbackCount;
+    return 1;
+}
+
+MKValueIndex::IndexShard &MKValueIndex::shard(const string &mk)
+{
+    return _shard[g_route_table.hashKey(mk) % INDEX_SHARD_NUM];
+}
+
+MKValueIndex::IndexEntryPtr MKValueIndex::find(const string &mk)
+{
+    IndexShard &s = shard(mk);
+    TC_LockT<TC_ThreadMutex> lock(s.mutex);
+
+    map<string, pair<IndexEntryPtr, list<string>::iterator> >::iterator it = s.mpEntry.find(mk);
+    if (it == s.mpEntry.end())
+    {
+        return NULL;
+    }
+
+    s.lsLru.splice(s.lsLru.begin(), s.lsLru, it->second.second);
+    return it->second.first;
+}
+
+void MKValueIndex::insert(const string &mk, const IndexEntryPtr &entry, size_t iMaxMainKey)
+{
+    IndexShard &s = shard(mk);
+    TC_LockT<TC_ThreadMutex> lock(s.mutex);
+
+    map<string, pair<IndexEntryPtr, list<string>::iterator> >::iterator it = s.mpEntry.find(mk);
+    if (it != s.mpEntry.end())
+    {
+        it->second.first = entry;
+        s.lsLru.splice(s.lsLru.begin(), s.lsLru, it->second.second);
+        return;
+    }
+
+    s.lsLru.push_front(mk);
+    s.mpEntry[mk] = make_pair(entry, s.lsLru.begin());
+
+    size_t iMaxShardCount = iMaxMainKey / INDEX_SHARD_NUM;
+    if (iMaxShardCount == 0)
+    {
+        iMaxShardCount = 1;
+    }
+    while (s.mpEntry.size() > iMaxShardCount)
+    {
+        s.mpEntry.erase(s.lsLru.back());
+        s.lsLru.pop_back();
+    }
+}
+
+void MKValueIndex::erase(const string &mk)
+{
+    IndexShard &s = shard(mk);
+    TC_LockT<TC_ThreadMutex> lock(s.mutex);
+
+    map<string, pair<IndexEntryPtr, list<string>::iterator> >::iterator it = s.mpEntry.find(mk);
+    if (it != s.mpEntry.end())
+    {
+        s.lsLru.erase(it->second.second);
+        s.mpEntry.erase(it);
+    }
+}
+
+void MKValueIndex::clear()
+{
+    for (size_t i = 0; i < INDEX_SHARD_NUM; i++)
+    {
+        TC_LockT<TC_ThreadMutex> lock(_shard[i].mutex);
+        _shard[i].mpEntry.clear();
+        _shard[i].lsLru.clear();
+    }
+}
+
+string MKValueIndex::desc()
+{
+    size_t iMainKeyCount = 0;
+    for (size_t i = 0; i < INDEX_SHARD_NUM; i++)
+    {
+        TC_LockT<TC_ThreadMutex> lock(_shard[i].mutex);
+        iMainKeyCount += _shard[i].mpEntry.size();
+    }
+
+    IndexConfPtr pConf = conf();
+    ostringstream os;
+    os << "enable: " << (pConf->bEnable ? "Y" : "N") << endl;
+    os << "field: " << TC_Common::tostr(pConf->vtIndexField.begin(), pConf->vtIndexField.end(), "|") << endl;
+    os << "min record: " << pConf->iMinRecord << endl;
+    os << "max record: " << pConf->iMaxRecord << endl;
+    os << "max mainkey: " << pConf->iMaxMainKey << endl;
+    os << "stable query: " << pConf->iStableQuery << endl;
+    os << "indexed mainkey: " << iMainKeyCount << endl;
+    os << "hit: " << _hitCount << endl;
+    os << "build: " << _buildCount << endl;
+    os << "fallback: " << _fallbackCount << endl;
+    os << "unstable: " << _unstableCount << endl;
+    return os.str();
+}
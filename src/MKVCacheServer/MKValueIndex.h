@@ -0,0 +1,199 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _MKVALUEINDEX_H_
+#define _MKVALUEINDEX_H_
+
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <memory>
+
+#include "util/tc_config.h"
+#include "util/tc_thread_mutex.h"
+#include "util/tc_autoptr.h"
+
+#include "MKCacheGlobe.h"
+
+using namespace tars;
+using namespace std;
+using namespace DCache;
+
+/*
+ * 主key下联合key/value字段的二级索引
+ * 对配置的字段(/Main/Cache<IndexField>)按主key建立有序索引，用于等值和范围(>、<、between)条件的查询，
+ * 查询代价与命中的记录数相关，而不是主key下的记录总数
+ * 候选记录始终保持数据链顺序，与未建索引、索引失效时按主key全部查询的结果顺序一致，分页查询不会重复或遗漏；
+ * 条件全部由索引覆盖时读满Limit即停止读取记录
+ *
+ * 索引缓存在进程内，以MultiHashMap::getMainKeyGeneration判断是否失效:
+ * 主key下的数据发生任何修改(写接口、binlog同步、从DB加载等)后索引失效，
+ * 修改代数在连续IndexStableQuery次查询中不变才重建，频繁修改的主key按主key全部查询，不会每次写后都重建
+ * 只支持hash类型的主key，float/double字段不建索引
+ * 配置以不可修改的快照发布，reload时整体替换，每次查询只取一次快照
+ */
+class MKValueIndex
+{
+public:
+    MKValueIndex();
+    ~MKValueIndex() {}
+
+    /*
+     * 初始化，必须在字段配置(GlobalStat::setFieldConfig)之后调用
+     */
+    void init(TC_Config &conf);
+
+    void reload(TC_Config &conf);
+
+    bool isEnable() const
+    {
+        return conf()->bEnable;
+    }
+
+    /*
+     * 通过索引获取主key下满足条件的候选记录
+     * 候选记录按主key下数据链的顺序返回，调用者仍需用全部条件进行过滤
+     * @param mk: 主key
+     * @param vtUKCond: 联合key字段的条件
+     * @param vtValueCond: value字段的条件
+     * @param bCheckExpire: 是否过滤过期数据
+     * @param iNowTime: 当前时间
+     * @param iLimit: 最多返回的候选记录数，只在条件全部由索引覆盖时生效，用于分页查询提前结束读取
+     * @param vtValue: 候选记录
+     * @return int:
+     *          0: 成功
+     *          1: 无法使用索引，需要按主key全部查询
+     */
+    int select(const string &mk, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond, bool bCheckExpire, uint32_t iNowTime, size_t iLimit, vector<MultiHashMap::Value> &vtValue);
+
+    /*
+     * 清空所有索引
+     */
+    void clear();
+
+    /*
+     * 索引状态，用于admin命令
+     */
+    string desc();
+
+protected:
+    //索引配置，发布后不再修改
+    struct IndexConf
+    {
+        bool bEnable;
+        //建立索引的字段
+        vector<string> vtIndexField;
+        set<string> stIndexField;
+        //建立索引的字段中属于联合key的字段
+        set<string> stUKField;
+        //主key下记录数达到该值才建立索引
+        size_t iMinRecord;
+        //主key下记录数超过该值不建立索引
+        size_t iMaxRecord;
+        //最多缓存索引的主key个数
+        size_t iMaxMainKey;
+        //修改代数连续该次数查询不变才建立索引
+        uint32_t iStableQuery;
+
+        IndexConf() : bEnable(false), iMinRecord(1000), iMaxRecord(200000), iMaxMainKey(1000), iStableQuery(3) {}
+    };
+    typedef std::shared_ptr<const IndexConf> IndexConfPtr;
+
+    //主key的索引
+    struct IndexEntry : public TC_HandleBase
+    {
+        //建立索引时使用的配置，配置变化后索引失效
+        IndexConfPtr pConf;
+        //建立索引时主key的修改代数
+        uint32_t iGeneration;
+        //是否已建立索引，未建立时只用于统计代数不变的查询次数
+        bool bBuilt;
+        //代数不变的连续查询次数
+        std::atomic<uint32_t> iStableQuery;
+        //数据链顺序的联合key
+        vector<string> vtUKey;
+        //字段名 -> (字段有序编码 -> 记录在数据链中的位置)
+        map<string, multimap<string, uint32_t> > mpFieldIndex;
+
+        IndexEntry(uint32_t generation, bool built) : iGeneration(generation), bBuilt(built), iStableQuery(1) {}
+    };
+    typedef TC_AutoPtr<IndexEntry> IndexEntryPtr;
+
+    //索引的扫描范围
+    struct IndexRange
+    {
+        bool bLower;
+        bool bLowerInclude;
+        string sLower;
+        bool bUpper;
+        bool bUpperInclude;
+        string sUpper;
+
+        IndexRange() : bLower(false), bLowerInclude(true), bUpper(false), bUpperInclude(true) {}
+    };
+
+    //按主key hash分片的索引缓存，各分片独立做LRU淘汰
+    struct IndexShard
+    {
+        TC_ThreadMutex mutex;
+        list<string> lsLru;
+        map<string, pair<IndexEntryPtr, list<string>::iterator> > mpEntry;
+    };
+
+    void loadConf(TC_Config &conf);
+
+    IndexConfPtr conf() const
+    {
+        return std::atomic_load(&_conf);
+    }
+
+    /*
+     * 从条件中选出走索引的字段及其扫描范围，等值条件优先
+     * bExact表示所有条件都已由该扫描范围覆盖
+     */
+    bool plan(const IndexConf &indexConf, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond, string &sField, IndexRange &range, bool &bExact);
+
+    /*
+     * 将字段值编码成按字节序比较即可保持字段类型大小顺序的串
+     */
+    bool encodeCondValue(const string &sType, const string &sValue, string &sKey);
+    string encodeFieldValue(const string &sValue, const FieldInfo &info);
+
+    IndexEntryPtr build(const IndexConfPtr &pConf, const vector<MultiHashMap::Value> &vtValue, uint32_t iGeneration);
+
+    /*
+     * 取出索引字段扫描范围内的记录位置，按数据链顺序排序
+     */
+    void scan(const IndexEntryPtr &entry, const string &sField, const IndexRange &range, vector<uint32_t> &vtPos);
+
+    IndexEntryPtr find(const string &mk);
+    void insert(const string &mk, const IndexEntryPtr &entry, size_t iMaxMainKey);
+    void erase(const string &mk);
+
+    IndexShard &shard(const string &mk);
+
+protected:
+    static const size_t INDEX_SHARD_NUM = 16;
+
+    //只能通过conf()/std::atomic_store原子地读写
+    IndexConfPtr _conf;
+
+    IndexShard _shard[INDEX_SHARD_NUM];
+
+    std::atomic<size_t> _hitCount;
+    std::atomic<size_t> _buildCount;
+    std::atomic<size_t> _fallbackCount;
+    std::atomic<size_t> _unstableCount;
+};
+
+#endif
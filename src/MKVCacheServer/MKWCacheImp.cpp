@@ -353,6 +353,7 @@ tars::Int32 MKWCacheImp::insertMKV(const DCache::InsertMKVReq &req, tars::TarsCu
         {
             iRet = g_HashMap.set(mainKey, uk, value, expireTimeSecond, ver, TC_Multi_HashMap_Malloc::DELETE_FALSE, dirty, TC_Multi_HashMap_Malloc::AUTO_DATA, _insertAtHead, _updateInOrder, _mkeyMaxDataCount, _deleteDirty);
         }
+        TrafficCapture::getInstance()->record(TOP_INSERT, mainKey, uk, value.size(), iRet == TC_Multi_HashMap_Malloc::RT_OK ? TRS_HIT : TRS_ERROR);
 
         if (iRet != TC_Multi_HashMap_Malloc::RT_OK)
         {
@@ -1442,6 +1443,7 @@ tars::Int32 MKWCacheImp::updateMKV(const DCache::UpdateMKVReq &req, tars::TarsCu
         if (bUKey)
         {
             int iRet = procUpdateUK(current, mainKey, mpValue, vtUKCond, vtValueCond, stLimit, ver, dirty, expireTimeSecond, iUpdateCount, insert);
+            TrafficCapture::getInstance()->record(TOP_UPDATE_MK, mainKey, 0, iRet < 0 ? TRS_ERROR : (iRet == 1 || iUpdateCount == 0 ? TRS_MISS : TRS_HIT));
             if (iRet < 0)
             {
                 TLOGERROR("MKWCacheImp::" << __FUNCTION__ << "|" << mainKey << "|" << sLogValue << "|" << sLogCond << "|" << (int)ver << "|" << dirty << "|" << expireTimeSecond << "|" << insert << "|failed|procUpdateUK error , ret =" << iRet << endl);
@@ -1453,6 +1455,7 @@ tars::Int32 MKWCacheImp::updateMKV(const DCache::UpdateMKVReq &req, tars::TarsCu
         else
         {
             int iRet = procUpdateMK(current, mainKey, mpValue, vtUKCond, vtValueCond, stLimit, ver, dirty, expireTimeSecond, iUpdateCount);
+            TrafficCapture::getInstance()->record(TOP_UPDATE_MK, mainKey, 0, iRet < 0 ? TRS_ERROR : (iRet == 1 || iUpdateCount == 0 ? TRS_MISS : TRS_HIT));
             if (iRet < 0)
             {
                 TLOGERROR("MKWCacheImp::" << __FUNCTION__ << "|" << mainKey << "|" << sLogValue << "|" << sLogCond << "|" << (int)ver << "|" << dirty << "|" << expireTimeSecond << "|" << insert << "|failed|procUpdateMK error , ret =" << iRet << endl);
@@ -1663,6 +1666,7 @@ tars::Int32 MKWCacheImp::eraseMKV(const DCache::MainKeyReq &req, tars::TarsCurre
         }
 
         int iRet = g_HashMap.erase(mainKey);
+        TrafficCapture::getInstance()->record(TOP_ERASE_MK, mainKey, 0, iRet == TC_Multi_HashMap_Malloc::RT_OK ? TRS_HIT : TRS_MISS);
 
         if (iRet != TC_Multi_HashMap_Malloc::RT_OK && iRet != TC_Multi_HashMap_Malloc::RT_ONLY_KEY && iRet != TC_Multi_HashMap_Malloc::RT_NO_DATA && iRet != TC_Multi_HashMap_Malloc::RT_DATA_DEL)
         {
@@ -1771,6 +1775,7 @@ tars::Int32 MKWCacheImp::delMKV(const DCache::DelMKVReq &req, tars::TarsCurrentP
             if (bUKey)
             {
                 int iRet = procDelUK(current, mainKey, vtUKCond, vtValueCond, stLimit);
+                TrafficCapture::getInstance()->record(TOP_DEL_MK, mainKey, 0, iRet < 0 ? TRS_ERROR : TRS_HIT);
                 if (iRet < 0)
                 {
                     TLOGERROR("MKWCacheImp::" << __FUNCTION__ << "|" << mainKey << "|" << sLogCond << "|failed|procDelUK error, ret = " << iRet << endl);
@@ -1782,6 +1787,7 @@ tars::Int32 MKWCacheImp::delMKV(const DCache::DelMKVReq &req, tars::TarsCurrentP
             else
             {
                 int iRet = procDelMK(current, mainKey, vtUKCond, vtValueCond, stLimit);
+                TrafficCapture::getInstance()->record(TOP_DEL_MK, mainKey, 0, iRet < 0 ? TRS_ERROR : TRS_HIT);
                 if (iRet < 0)
                 {
                     TLOGERROR("MKWCacheImp::" << __FUNCTION__ << "|" << mainKey << "|" << sLogCond << "|failed|procDelMK error, ret = " << iRet << endl);
@@ -2183,6 +2189,127 @@ tars::Int32 MKWCacheImp::delMKVBatch(const DCache::DelMKVBatchReq &req, DCache::
     return ET_SUCC;
 }
 
+tars::Int32 MKWCacheImp::execMKV(const DCache::ExecMKVReq &req, DCache::MKVBatchWriteRsp &rsp, tars::TarsCurrentPtr current)
+{
+    const std::string &mainKey = req.mainKey;
+    map<tars::Int32, tars::Int32> &mpFail = rsp.rspData;
+
+    TLOGDEBUG("MKWCacheImp::" << __FUNCTION__ << " recv : " << mainKey << "|" << req.ops.size() << endl);
+    try
+    {
+        if (g_app.gstat()->serverType() != MASTER)
+        {
+            //SLAVE状态下不提供接口服务
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": ServerType is not Master" << endl);
+            return ET_SERVER_TYPE_ERR;
+        }
+        if (req.moduleName != _moduleName)
+        {
+            //返回模块错误
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": moduleName error" << endl);
+            return ET_MODULE_NAME_INVALID;
+        }
+        if (g_route_table.isTransfering(mainKey))
+        {
+            int iPageNo = g_route_table.getPageNo(mainKey);
+            if (isTransSrc(iPageNo))
+            {
+                TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": " << mainKey << " forbid exec" << endl);
+                return ET_FORBID_OPT;
+            }
+        }
+        //检查key是否是在自己服务范围内
+        if (!g_route_table.isMySelf(mainKey))
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": " << mainKey << " is not in self area" << endl);
+            map<string, string>& context = current->getContext();
+            //API直连模式，返回增量更新路由
+            if (VALUE_YES == context[GET_ROUTE])
+            {
+                RspUpdateServant updateServant;
+                map<string, string> rspContext;
+                rspContext[ROUTER_UPDATED] = "";
+                int ret = RouterHandle::getInstance()->getUpdateServant(mainKey, true, "", updateServant);
+                if (ret != 0)
+                {
+                    TLOGERROR(__FUNCTION__ << ":getUpdatedRoute error:" << ret << endl);
+                }
+                else
+                {
+                    RouterHandle::getInstance()->updateServant2Str(updateServant, rspContext[ROUTER_UPDATED]);
+                    current->setResponseContext(rspContext);
+                }
+            }
+            return ET_KEY_AREA_ERR;
+        }
+
+        g_app.ppReport(PPReport::SRP_SET_CNT, 1);
+        int iRetCode;
+        if (!checkMK(mainKey, _mkIsInteger, iRetCode))
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": param error, retcode = " << iRetCode << endl);
+            return iRetCode;
+        }
+        if (req.ops.empty())
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": ops is empty, mainKey = " << mainKey << endl);
+            return ET_INPUT_PARAM_ERROR;
+        }
+
+        //先检查全部操作的参数，有一个不合法则整组不执行
+        vector<ExecOp> vtOp(req.ops.size());
+        for (size_t i = 0; i < req.ops.size(); i++)
+        {
+            int iRet = parseExecOp(mainKey, req.ops[i], vtOp[i]);
+            if (iRet != ET_SUCC)
+            {
+                mpFail[i] = iRet;
+            }
+        }
+        if (!mpFail.empty())
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": param error, fail count = " << mpFail.size() << ", mainKey = " << mainKey << endl);
+            return ET_PARTIAL_FAIL;
+        }
+
+        vector<MultiHashMap::Value> vtBinLog;
+        ExecMKVFunctor f(this, mainKey, vtOp, vtBinLog, mpFail);
+        int iRet = g_HashMap.transaction(mainKey, f);
+        if (iRet != ET_SUCC)
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": exec failed, ret = " << iRet << ", mainKey = " << mainKey << endl);
+            return iRet;
+        }
+
+        //每个操作按单条set/del记录binlog，备机按单条写的方式逐条执行，覆盖已存在的记录并处理删除
+        if (_recordBinLog)
+            WriteBinLog::setDel(mainKey, vtBinLog, _binlogFile);
+        if (_recordKeyBinLog)
+        {
+            for (size_t i = 0; i < vtBinLog.size(); i++)
+            {
+                if (vtBinLog[i]._isDelete == TC_Multi_HashMap_Malloc::DELETE_TRUE)
+                    WriteBinLog::del(mainKey, vtBinLog[i]._ukey, _keyBinlogFile);
+                else
+                    WriteBinLog::set(mainKey, vtBinLog[i]._ukey, _keyBinlogFile);
+            }
+        }
+    }
+    catch (const std::exception &ex)
+    {
+        TLOGERROR("MKWCacheImp::" << __FUNCTION__ << " exception: " << ex.what() << ", mkey = " << mainKey << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
+    catch (...)
+    {
+        TLOGERROR("MKWCacheImp::" << __FUNCTION__ << " unkown exception, mkey = " << mainKey << endl);
+        g_app.ppReport(PPReport::SRP_EX, 1);
+        return ET_SYS_ERR;
+    }
+    return ET_SUCC;
+}
+
 tars::Int32 MKWCacheImp::pushList(const DCache::PushListReq &req, tars::TarsCurrentPtr current)
 {
     const std::string & mainKey = req.mainKey;
@@ -4804,6 +4931,289 @@ int MKWCacheImp::procDelMKVer(tars::TarsCurrentPtr current, const string &mk, co
     return 0;
 }
 
+int MKWCacheImp::parseExecOp(const string &mk, const DCache::MKVOp &op, ExecOp &execOp)
+{
+    int iRetCode = ET_SUCC;
+    map<string, DCache::UpdateValue> mpUK;
+    map<string, DCache::UpdateValue> mpJValue;
+
+    execOp.type = op.type;
+    execOp.ver = op.ver;
+    execOp.dirty = op.dirty;
+    execOp.replace = op.replace;
+    execOp.expireTime = op.expireTimeSecond;
+    if (!execOp.dirty)
+    {
+        if (_existDB)
+            execOp.dirty = true;
+    }
+
+    if (op.type == DCache::MKV_OP_INSERT)
+    {
+        if (!checkSetValue(op.mpValue, mpUK, mpJValue, iRetCode))
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": insert param error, retcode = " << iRetCode << endl);
+            return iRetCode;
+        }
+    }
+    else if (op.type == DCache::MKV_OP_UPDATE || op.type == DCache::MKV_OP_DELETE)
+    {
+        //mpValue中的联合key字段用于定位记录，其余为要更新的value字段
+        for (map<string, DCache::UpdateValue>::const_iterator it = op.mpValue.begin(); it != op.mpValue.end(); ++it)
+        {
+            map<string, int>::const_iterator itType = _fieldConf.mpFieldType.find(it->first);
+            if (itType == _fieldConf.mpFieldType.end())
+            {
+                TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": field not exist: " << it->first << endl);
+                return ET_PARAM_NOT_EXIST;
+            }
+            if (itType->second == 0)
+                continue;
+            if (itType->second == 1)
+            {
+                if (it->second.op != DCache::SET)
+                {
+                    TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": uk op not set: " << it->first << endl);
+                    return ET_PARAM_OP_ERR;
+                }
+                mpUK.insert(*it);
+            }
+            else
+            {
+                mpJValue.insert(*it);
+            }
+        }
+        if (mpUK.size() != _fieldConf.vtUKeyName.size())
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": uk missing" << endl);
+            return ET_PARAM_UKEY_MISSING;
+        }
+        if (op.type == DCache::MKV_OP_DELETE)
+        {
+            if (!mpJValue.empty())
+            {
+                TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": delete with value field" << endl);
+                return ET_PARAM_REDUNDANT;
+            }
+        }
+        else
+        {
+            if (mpJValue.empty())
+            {
+                TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": update without value field" << endl);
+                return ET_PARAM_MISSING;
+            }
+            if (!checkUpdateValue(mpJValue, iRetCode))
+            {
+                TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": update param error, retcode = " << iRetCode << endl);
+                return iRetCode;
+            }
+            execOp.mpUpdate = mpJValue;
+        }
+    }
+    else
+    {
+        TLOGERROR("MKWCacheImp::" << __FUNCTION__ << ": op type error: " << (int)op.type << endl);
+        return ET_PARAM_OP_ERR;
+    }
+
+    TarsEncode uKeyEncode;
+    size_t KeyLengthInDB = mk.size();
+    for (size_t i = 0; i < _fieldConf.vtUKeyName.size(); i++)
+    {
+        const string &sUKName = _fieldConf.vtUKeyName[i];
+        const FieldInfo &fieldInfo = _fieldConf.mpFieldInfo[sUKName];
+        uKeyEncode.write(mpUK[sUKName].value, fieldInfo.tag, fieldInfo.type);
+
+        KeyLengthInDB += mpUK[sUKName].value.size();
+    }
+    if (KeyLengthInDB > _maxKeyLengthInDB)
+    {
+        TLOGERROR("MKWCacheImp::" << __FUNCTION__ << " keyLength > " << _maxKeyLengthInDB << endl);
+        return ET_PARAM_TOO_LONG;
+    }
+    execOp.uk.assign(uKeyEncode.getBuffer(), uKeyEncode.getLength());
+
+    if (op.type == DCache::MKV_OP_INSERT)
+    {
+        TarsEncode vEncode;
+        for (size_t i = 0; i < _fieldConf.vtValueName.size(); i++)
+        {
+            const string &sValueName = _fieldConf.vtValueName[i];
+            const FieldInfo &fieldInfo = _fieldConf.mpFieldInfo[sValueName];
+            vEncode.write(mpJValue[sValueName].value, fieldInfo.tag, fieldInfo.type);
+        }
+        execOp.value.assign(vEncode.getBuffer(), vEncode.getLength());
+    }
+
+    return ET_SUCC;
+}
+
+/*
+ * 在g_HashMap锁内按顺序执行一组操作，任一操作失败时按相反顺序恢复已执行操作修改过的记录
+ * 主key数据在cache中不完整且需要读DB时，记录是否存在无法在cache内判断，此时返回ET_CACHE_ERR
+ */
+int MKWCacheImp::applyExecOp(TC_Multi_HashMap_Malloc &t, const string &mk, const vector<ExecOp> &vtOp, vector<TC_Multi_HashMap_Malloc::Value> &vtErased, vector<MultiHashMap::Value> &vtBinLog, map<tars::Int32, tars::Int32> &mpFail)
+{
+    //执行前记录的完整状态，用于失败时恢复
+    struct UndoRecord
+    {
+        int iState;
+        TC_Multi_HashMap_Malloc::Value old;
+    };
+    vector<UndoRecord> vtUndo;
+
+    bool bCheckExpire = g_app.gstat()->isExpireEnabled();
+    uint32_t iNowTime = TC_TimeProvider::getInstance()->getNow();
+    //主key原来不存在时，恢复后变空的主key头一并删除
+    bool bEraseMainKey = (t.checkMainKey(mk) == TC_Multi_HashMap_Malloc::RT_NO_DATA);
+
+    int iRet = ET_SUCC;
+    size_t i = 0;
+    for (; i < vtOp.size(); i++)
+    {
+        const ExecOp &op = vtOp[i];
+        uint32_t unHash = t.getHashFunctor()(mk + op.uk);
+
+        UndoRecord undo;
+        undo.iState = t.getForRestore(mk, op.uk, undo.old);
+        if (undo.iState != TC_Multi_HashMap_Malloc::RT_OK
+                && undo.iState != TC_Multi_HashMap_Malloc::RT_ONLY_KEY
+                && undo.iState != TC_Multi_HashMap_Malloc::RT_NO_DATA)
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << " getForRestore error, ret = " << undo.iState << ", mainKey = " << mk << endl);
+            iRet = ET_SYS_ERR;
+            break;
+        }
+
+        TC_Multi_HashMap_Malloc::Value cur;
+        int iGetRet = t.get(mk, op.uk, unHash, cur, bCheckExpire, iNowTime);
+        if (iGetRet != TC_Multi_HashMap_Malloc::RT_OK
+                && iGetRet != TC_Multi_HashMap_Malloc::RT_NO_DATA
+                && iGetRet != TC_Multi_HashMap_Malloc::RT_ONLY_KEY
+                && iGetRet != TC_Multi_HashMap_Malloc::RT_DATA_EXPIRED
+                && iGetRet != TC_Multi_HashMap_Malloc::RT_DATA_DEL)
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << " get error, ret = " << iGetRet << ", mainKey = " << mk << endl);
+            iRet = ET_SYS_ERR;
+            break;
+        }
+        bool bExist = (iGetRet == TC_Multi_HashMap_Malloc::RT_OK);
+        bool bUnknown = (iGetRet == TC_Multi_HashMap_Malloc::RT_NO_DATA && _existDB && _readDB);
+
+        if (op.ver != 0 && bExist && cur._iVersion != op.ver)
+        {
+            iRet = ET_DATA_VER_MISMATCH;
+            break;
+        }
+
+        MultiHashMap::Value v;
+        v._mkey = mk;
+        v._ukey = op.uk;
+        v._dirty = op.dirty;
+        v._iExpireTime = op.expireTime;
+
+        int iSetRet = TC_Multi_HashMap_Malloc::RT_OK;
+        if (op.type == DCache::MKV_OP_DELETE)
+        {
+            if (bUnknown && op.ver != 0)
+            {
+                iRet = ET_CACHE_ERR;
+                break;
+            }
+            if (!bExist && op.ver != 0)
+            {
+                iRet = ET_NO_DATA;
+                break;
+            }
+            iSetRet = t.delSetBit(mk, op.uk, time(NULL));
+            if (iSetRet == TC_Multi_HashMap_Malloc::RT_NO_DATA || iSetRet == TC_Multi_HashMap_Malloc::RT_ONLY_KEY || iSetRet == TC_Multi_HashMap_Malloc::RT_DATA_DEL)
+            {
+                //有db并且没有数据，就插入一条onlykey
+                iSetRet = TC_Multi_HashMap_Malloc::RT_OK;
+                if (_existDB && iGetRet == TC_Multi_HashMap_Malloc::RT_NO_DATA)
+                    iSetRet = t.setForDel(mk, op.uk, time(NULL), TC_Multi_HashMap_Malloc::AUTO_DATA, true, vtErased);
+            }
+            v._value = cur._value;
+            v._isDelete = TC_Multi_HashMap_Malloc::DELETE_TRUE;
+        }
+        else
+        {
+            if (bUnknown)
+            {
+                iRet = ET_CACHE_ERR;
+                break;
+            }
+            if (op.type == DCache::MKV_OP_INSERT)
+            {
+                if (bExist && !op.replace)
+                {
+                    iRet = ET_DATA_EXIST;
+                    break;
+                }
+                v._value = op.value;
+            }
+            else
+            {
+                if (!bExist)
+                {
+                    iRet = ET_NO_DATA;
+                    break;
+                }
+                v._value = updateValue(op.mpUpdate, cur._value);
+            }
+            iSetRet = t.set(mk, op.uk, unHash, v._value, v._iExpireTime, 0, v._dirty, TC_Multi_HashMap_Malloc::AUTO_DATA, _insertAtHead, _updateInOrder, TC_Multi_HashMap_Malloc::DELETE_FALSE, bCheckExpire, iNowTime, vtErased);
+        }
+
+        if (iSetRet != TC_Multi_HashMap_Malloc::RT_OK)
+        {
+            TLOGERROR("MKWCacheImp::" << __FUNCTION__ << " set error, ret = " << iSetRet << ", mainKey = " << mk << endl);
+            if (iSetRet == TC_Multi_HashMap_Malloc::RT_NO_MEMORY)
+                iRet = ET_MEM_FULL;
+            else
+                iRet = ET_SYS_ERR;
+            //该操作可能已部分生效，同样需要恢复
+            vtUndo.push_back(undo);
+            break;
+        }
+
+        vtUndo.push_back(undo);
+        vtBinLog.push_back(v);
+    }
+
+    if (iRet != ET_SUCC)
+    {
+        mpFail[i] = iRet;
+        vtBinLog.clear();
+
+        for (size_t j = vtUndo.size(); j > 0; j--)
+        {
+            const ExecOp &op = vtOp[j - 1];
+            const UndoRecord &undo = vtUndo[j - 1];
+            int iUndoRet = t.restore(mk, op.uk, undo.iState, undo.old, bEraseMainKey, vtErased);
+            if (iUndoRet != TC_Multi_HashMap_Malloc::RT_OK)
+            {
+                TLOGERROR("MKWCacheImp::" << __FUNCTION__ << " undo error, ret = " << iUndoRet << ", mainKey = " << mk << endl);
+                g_app.ppReport(PPReport::SRP_CACHE_ERR, 1);
+            }
+        }
+        return (iRet == ET_MEM_FULL || iRet == ET_SYS_ERR) ? iRet : ET_PARTIAL_FAIL;
+    }
+
+    if (_mkeyMaxDataCount > 0)
+    {
+        int iDelCount = t.count(mk) - _mkeyMaxDataCount;
+        if (iDelCount > 0)
+        {
+            //删除的顺序与插入的顺序相反，以删除最老记录
+            vector<TC_Multi_HashMap_Malloc::Value> value;
+            t.del(mk, iDelCount, value, 0, !_insertAtHead, _deleteDirty);
+        }
+    }
+
+    return ET_SUCC;
+}
+
 bool MKWCacheImp::isTransSrc(int pageNo)
 {
     ServerInfo srcServer;
@@ -63,6 +63,8 @@ public:
 
     virtual tars::Int32 delMKVBatch(const DCache::DelMKVBatchReq &req, DCache::MKVBatchWriteRsp &rsp, tars::TarsCurrentPtr current);
 
+    virtual tars::Int32 execMKV(const DCache::ExecMKVReq &req, DCache::MKVBatchWriteRsp &rsp, tars::TarsCurrentPtr current);
+
     //List/Set/ZSet
     virtual tars::Int32 pushList(const DCache::PushListReq &req, tars::TarsCurrentPtr current);
     virtual tars::Int32 popList(const DCache::PopListReq &req, DCache::PopListRsp &rsp, tars::TarsCurrentPtr current);
@@ -96,6 +98,44 @@ protected:
     int procDelMK(tars::TarsCurrentPtr current, const string &mk, const vector<DCache::Condition> & vtUKCond, const vector<DCache::Condition> &vtValueCond, const Limit &stLimit);
     int procDelMKVer(tars::TarsCurrentPtr current, const string &mk, const vector<DCache::Condition> & vtUKCond, const vector<DCache::Condition> &vtValueCond, const Limit &stLimit, int &ret);
 
+    //execMKV中解析后的单个操作
+    struct ExecOp
+    {
+        DCache::MKVOpType type;
+        string uk;
+        //插入时的记录值
+        string value;
+        //更新时要修改的value字段
+        map<string, DCache::UpdateValue> mpUpdate;
+        uint8_t ver;
+        bool dirty;
+        bool replace;
+        uint32_t expireTime;
+    };
+
+    //execMKV在g_HashMap的一次加锁内执行的操作
+    struct ExecMKVFunctor
+    {
+        ExecMKVFunctor(MKWCacheImp *pImp, const string &mk, const vector<ExecOp> &vtOp, vector<MultiHashMap::Value> &vtBinLog, map<tars::Int32, tars::Int32> &mpFail)
+            : _pImp(pImp), _mk(mk), _vtOp(vtOp), _vtBinLog(vtBinLog), _mpFail(mpFail)
+        {
+        }
+
+        int operator()(TC_Multi_HashMap_Malloc &t, vector<TC_Multi_HashMap_Malloc::Value> &vtErased)
+        {
+            return _pImp->applyExecOp(t, _mk, _vtOp, vtErased, _vtBinLog, _mpFail);
+        }
+
+        MKWCacheImp *_pImp;
+        const string &_mk;
+        const vector<ExecOp> &_vtOp;
+        vector<MultiHashMap::Value> &_vtBinLog;
+        map<tars::Int32, tars::Int32> &_mpFail;
+    };
+
+    int parseExecOp(const string &mk, const DCache::MKVOp &op, ExecOp &execOp);
+    int applyExecOp(TC_Multi_HashMap_Malloc &t, const string &mk, const vector<ExecOp> &vtOp, vector<TC_Multi_HashMap_Malloc::Value> &vtErased, vector<MultiHashMap::Value> &vtBinLog, map<tars::Int32, tars::Int32> &mpFail);
+
 protected:
     string _moduleName;
     string _config;
@@ -37,6 +37,9 @@ void RouterHandle::init(TC_Config& conf)
 
     _routePrx = Application::getCommunicator()->stringToProxy<RouterPrx>(_routeObj);
 
+    string heartbeatObj = conf.get("/Main/Router<HeartbeatObjName>", "");
+    _heartbeatPrx = heartbeatObj.empty() ? _routePrx : Application::getCommunicator()->stringToProxy<RouterPrx>(heartbeatObj);
+
     string sTransferCompress = TC_Common::trim(conf.get("/Main/Cache<transferCompress>", "Y"));
     if (sTransferCompress == "Y" || sTransferCompress == "y")
         _transferCompress = true;
@@ -632,6 +635,35 @@ tars::Int32 RouterHandle::initRoute(bool forbidFromFile, bool &syncFromRouterSuc
     return 0;
 }
 
+int RouterHandle::getRouterByDelta(int fromVersion, PackTable &packTable)
+{
+    try
+    {
+        RouterDelta delta;
+        int iRet = _routePrx->getRouterDelta(_moduleName, fromVersion, delta);
+        if (iRet != ROUTER_SUCC)
+        {
+            TLOGDEBUG("[RouterHandle::getRouterByDelta] no delta from version: " << fromVersion << ", ret: " << iRet << endl);
+            return -1;
+        }
+
+        TC_ThreadLock::Lock lock(_lock);
+        iRet = UnpackTable::applyDelta(g_route_table.getPackTable(), delta, packTable);
+        if (iRet != UnpackTable::RET_SUCC)
+        {
+            TLOGERROR("[RouterHandle::getRouterByDelta] apply delta from version: " << fromVersion << " error: " << iRet << endl);
+            return -1;
+        }
+        return 0;
+    }
+    catch (const TarsException & ex)
+    {
+        // 不支持增量路由的RouterServer也会走到这里，退回全量拉取
+        TLOGERROR("[RouterHandle::getRouterByDelta] exception: " << ex.what() << endl);
+    }
+    return -1;
+}
+
 void RouterHandle::syncRoute()
 {
     try
@@ -704,7 +736,11 @@ void RouterHandle::syncRoute()
                     }
                 }
                 struct PackTable packTable;
-                int iRet = _routePrx->getRouterInfoFromCache(_moduleName, packTable);
+                int iRet = getRouterByDelta(iCurVer, packTable);
+                if (iRet != 0)
+                {
+                    iRet = _routePrx->getRouterInfoFromCache(_moduleName, packTable);
+                }
                 if (iRet != 0)
                 {
                     TLOGERROR("[RouterHandle::syncRoute] getRouterInfo fail" << endl);
@@ -1186,7 +1222,7 @@ void RouterHandle::heartBeat()
     try
     {
         string serverName = ServerConfig::Application + "." + ServerConfig::ServerName;
-        _routePrx->heartBeatReport(_moduleName, g_app.gstat()->groupName(), serverName);
+        _heartbeatPrx->heartBeatReport(_moduleName, g_app.gstat()->groupName(), serverName);
     }
     catch (const TarsException & ex)
     {
@@ -1194,7 +1230,7 @@ void RouterHandle::heartBeat()
         try
         {
             string serverName = ServerConfig::Application + "." + ServerConfig::ServerName;
-            _routePrx->heartBeatReport(_moduleName, g_app.gstat()->groupName(), serverName);
+            _heartbeatPrx->heartBeatReport(_moduleName, g_app.gstat()->groupName(), serverName);
         }
         catch (const TarsException & ex)
         {
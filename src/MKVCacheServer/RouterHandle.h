@@ -140,6 +140,12 @@ protected:
     */
     void updateCSyncKeyLimit();
 
+    /*
+    *拉取相对fromVersion的增量路由，并在当前路由上生成新版本的路由表
+    *返回0成功，失败时调用者需全量拉取
+    */
+    int getRouterByDelta(int fromVersion, PackTable &packTable);
+
     /*
     *Get 迁移目的服务器时的数据大小限制
     */
@@ -164,6 +170,7 @@ protected:
 
     string _routeObj;
     RouterPrx _routePrx;
+    RouterPrx _heartbeatPrx; // 上报心跳使用的proxy，Router配置了独立的心跳obj时与_routePrx不同
 
     //路由分页大小
     unsigned int _pageSize;
@@ -281,7 +281,12 @@ void TimerThread::handleConnectHbTimeout()
     {
         //检测是否能正常访问router
         bool succ = false;
-        string sRouteObj = _tcConf["/Main/Router<ObjName>"];
+        //配置了独立的心跳obj时，兜底的心跳也发往心跳obj，否则Router的故障检测收不到这次心跳
+        string sRouteObj = _tcConf.get("/Main/Router<HeartbeatObjName>", "");
+        if (sRouteObj.empty())
+        {
+            sRouteObj = _tcConf["/Main/Router<ObjName>"];
+        }
         RouterPrx routePrx;
         vector<TC_Endpoint> vtRouterEndpoint;
         int reTry = 2;
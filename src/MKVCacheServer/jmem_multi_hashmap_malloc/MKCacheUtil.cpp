@@ -12,6 +12,7 @@
 * and limitations under the License.
 */
 #include "MKCacheUtil.h"
+#include "MKCompactRecord.h"
 #include "util/tc_common.h"
 
 #define TYPE_BYTE "byte"
@@ -31,8 +32,20 @@ namespace HashMap
 {
     bool judgeValue(TarsDecode &decode, const string &value, Op op, const string &type, uint8_t tag, const string &sDefault, bool isRequire)
     {
+        if (CompactRecord::isCompact(decode.getBuffer()))
+        {
+            if (CompactRecord::getInstance()->isCurrent(decode.getBuffer()))
+            {
+                return CompactRecord::getInstance()->judge(decode.getBuffer(), tag, op, value);
+            }
+            //字段配置修改前写入的数据按原布局转回tars编码后比较
+            decode.setBuffer(CompactRecord::getInstance()->toTars(decode.getBuffer()));
+        }
+
+        //getBuffer返回的是拷贝，需保存下来，否则isk指向已释放的临时串
+        const string sBuf = decode.getBuffer();
         tars::TarsInputStream<tars::BufferReader> isk;
-        isk.setBuffer(decode.getBuffer().c_str(), decode.getBuffer().length());
+        isk.setBuffer(sBuf.c_str(), sBuf.length());
 
         if (type == TYPE_BYTE)
         {
@@ -220,8 +233,10 @@ namespace HashMap
         }
         return false;
     }
-    string updateValue(const map<string, DCache::UpdateValue> &mpValue, const TC_Multi_HashMap_Malloc::FieldConf &fieldConf, const string &sStreamValue)
+    string updateValue(const map<string, DCache::UpdateValue> &mpValue, const TC_Multi_HashMap_Malloc::FieldConf &fieldConf, const string &sValue)
     {
+        //紧凑编码先转回tars编码，更新后写入cache时再按配置转换
+        string sStreamValue = CompactRecord::getInstance()->normalize(sValue);
 	    tars::TarsInputStream<tars::BufferReader> isk;
         isk.setBuffer(sStreamValue.c_str(), sStreamValue.length());
 	    tars::TarsOutputStream<tars::BufferWriter> osk;
@@ -491,6 +506,16 @@ namespace HashMap
 
     string TarsDecode::read(uint8_t tag, const string& type, const string &sDefault, bool isRequire)
     {
+        if (CompactRecord::isCompact(m_sBuf))
+        {
+            if (CompactRecord::getInstance()->isCurrent(m_sBuf))
+            {
+                return CompactRecord::getInstance()->read(m_sBuf, tag, sDefault, isRequire);
+            }
+            //字段配置修改前写入的数据按原布局转回tars编码后读取
+            m_sBuf = CompactRecord::getInstance()->toTars(m_sBuf);
+        }
+
 	    tars::TarsInputStream<tars::BufferReader> isk;
         isk.setBuffer(m_sBuf.c_str(), m_sBuf.length());
         string s;
@@ -0,0 +1,591 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <string.h>
+#include "MKCompactRecord.h"
+#include "MKCacheUtil.h"
+#include "util/tc_common.h"
+#include "util/tc_file.h"
+#include "util/tc_hash_fun.h"
+
+#define TYPE_BYTE "byte"
+#define TYPE_SHORT "short"
+#define TYPE_INT "int"
+#define TYPE_LONG "long"
+#define TYPE_STRING "string"
+#define TYPE_FLOAT "float"
+#define TYPE_DOUBLE "double"
+#define TYPE_UINT32 "unsigned int"
+#define TYPE_UINT16 "unsigned short"
+
+namespace HashMap
+{
+    static const double COMPACT_EPSILON = 1.00e-07;
+    #define COMPACT_FLOAT_EQ(x,v) (((v - COMPACT_EPSILON) < x) && (x <( v + COMPACT_EPSILON)))
+
+    template<typename T>
+    static void encodeFixed(tars::TarsInputStream<tars::BufferReader> &isk, uint8_t tag, const string &sDefault, char *p)
+    {
+        T n = tars::TC_Common::strto<T>(sDefault);
+        isk.read(n, tag, false);
+        memcpy(p, &n, sizeof(T));
+    }
+
+    template<typename T>
+    static void decodeFixed(tars::TarsOutputStream<tars::BufferWriter> &osk, uint8_t tag, const char *p)
+    {
+        T n;
+        memcpy(&n, p, sizeof(T));
+        osk.write(n, tag);
+    }
+
+    template<typename T>
+    static T getFixed(const char *p)
+    {
+        T n;
+        memcpy(&n, p, sizeof(T));
+        return n;
+    }
+
+    template<typename T>
+    static bool compare(const T &n, const T &m, Op op)
+    {
+        if (op == DCache::EQ)
+            return n == m;
+        else if (op == DCache::NE)
+            return n != m;
+        else if (op == DCache::GT)
+            return n > m;
+        else if (op == DCache::LT)
+            return n < m;
+        else if (op == DCache::LE)
+            return n <= m;
+        else if (op == DCache::GE)
+            return n >= m;
+        else
+            throw HashMap::MKDCacheException("CompactRecord::judge: op error");
+    }
+
+    template<typename T>
+    static bool compareFloat(T n, T m, Op op)
+    {
+        if (op == DCache::EQ)
+            return COMPACT_FLOAT_EQ(n, m);
+        else if (op == DCache::NE)
+            return !COMPACT_FLOAT_EQ(n, m);
+        else if (op == DCache::GT)
+            return n > m;
+        else if (op == DCache::LT)
+            return n < m;
+        else if (op == DCache::LE)
+            return n < m || COMPACT_FLOAT_EQ(n, m);
+        else if (op == DCache::GE)
+            return n > m || COMPACT_FLOAT_EQ(n, m);
+        else
+            throw HashMap::MKDCacheException("CompactRecord::judge: op error");
+    }
+
+    static void appendVarint(string &s, uint32_t n)
+    {
+        while (n >= 0x80)
+        {
+            s += (char)((n & 0x7F) | 0x80);
+            n >>= 7;
+        }
+        s += (char)n;
+    }
+
+    static uint32_t readVarint(const string &s, size_t &pos)
+    {
+        uint32_t n = 0;
+        for (uint32_t shift = 0; pos < s.size() && shift < 35; shift += 7)
+        {
+            uint8_t c = (uint8_t)s[pos++];
+            n |= (uint32_t)(c & 0x7F) << shift;
+            if ((c & 0x80) == 0)
+                return n;
+        }
+        throw HashMap::MKDCacheException("CompactRecord: varint error");
+    }
+
+    bool CompactRecord::buildLayout(const vector<pair<uint8_t, string> > &vtTagType, Layout &layout)
+    {
+        layout.vtField.clear();
+        for (size_t i = 0; i < 256; i++)
+        {
+            layout.tagIndex[i] = -1;
+        }
+        layout.iFixedSize = 0;
+
+        uint32_t iVarCount = 0;
+        for (size_t i = 0; i < vtTagType.size(); i++)
+        {
+            const string &sType = vtTagType[i].second;
+            FieldLayout field;
+            field.tag = vtTagType[i].first;
+            field.index = i;
+            field.bRequire = false;
+            if (sType == TYPE_BYTE)
+            {
+                field.kind = KIND_BYTE;
+                field.width = sizeof(tars::Char);
+            }
+            else if (sType == TYPE_SHORT)
+            {
+                field.kind = KIND_SHORT;
+                field.width = sizeof(tars::Short);
+            }
+            else if (sType == TYPE_INT)
+            {
+                field.kind = KIND_INT;
+                field.width = sizeof(tars::Int32);
+            }
+            else if (sType == TYPE_LONG)
+            {
+                field.kind = KIND_LONG;
+                field.width = sizeof(tars::Int64);
+            }
+            else if (sType == TYPE_FLOAT)
+            {
+                field.kind = KIND_FLOAT;
+                field.width = sizeof(tars::Float);
+            }
+            else if (sType == TYPE_DOUBLE)
+            {
+                field.kind = KIND_DOUBLE;
+                field.width = sizeof(tars::Double);
+            }
+            else if (sType == TYPE_UINT32)
+            {
+                field.kind = KIND_UINT32;
+                field.width = sizeof(tars::UInt32);
+            }
+            else if (sType == TYPE_UINT16)
+            {
+                field.kind = KIND_UINT16;
+                field.width = sizeof(tars::UInt16);
+            }
+            else if (sType == TYPE_STRING)
+            {
+                field.kind = KIND_STRING;
+                field.width = 0;
+            }
+            else
+            {
+                return false;
+            }
+
+            if (field.kind == KIND_STRING)
+            {
+                field.offset = iVarCount++;
+            }
+            else
+            {
+                field.offset = layout.iFixedSize;
+                layout.iFixedSize += field.width;
+            }
+
+            layout.tagIndex[field.tag] = layout.vtField.size();
+            layout.vtField.push_back(field);
+        }
+        layout.iBitmapSize = (layout.vtField.size() + 7) / 8;
+        layout.iId = (uint32_t)tars::hash_new<string>()(layoutDesc(vtTagType));
+        return true;
+    }
+
+    string CompactRecord::layoutDesc(const vector<pair<uint8_t, string> > &vtTagType)
+    {
+        string s;
+        for (size_t i = 0; i < vtTagType.size(); i++)
+        {
+            if (i > 0)
+                s += ",";
+            s += tars::TC_Common::tostr((int)vtTagType[i].first) + ":" + vtTagType[i].second;
+        }
+        return s;
+    }
+
+    void CompactRecord::init(const TC_Multi_HashMap_Malloc::FieldConf &fieldConf, bool bEnable, const string &sLayoutFile)
+    {
+        vector<pair<uint8_t, string> > vtTagType;
+        for (size_t i = 0; i < fieldConf.vtValueName.size(); i++)
+        {
+            map<string, TC_Multi_HashMap_Malloc::FieldInfo>::const_iterator it = fieldConf.mpFieldInfo.find(fieldConf.vtValueName[i]);
+            if (it == fieldConf.mpFieldInfo.end())
+            {
+                throw HashMap::MKDCacheException("CompactRecord::init mpFieldInfo find error: " + fieldConf.vtValueName[i]);
+            }
+            vtTagType.push_back(make_pair((uint8_t)it->second.tag, it->second.type));
+        }
+
+        if (!buildLayout(vtTagType, _current))
+        {
+            throw HashMap::MKDCacheException("CompactRecord::init type error: " + layoutDesc(vtTagType));
+        }
+        for (size_t i = 0; i < _current.vtField.size(); i++)
+        {
+            const TC_Multi_HashMap_Malloc::FieldInfo &info = fieldConf.mpFieldInfo.find(fieldConf.vtValueName[i])->second;
+            _current.vtField[i].bRequire = info.bRequire;
+            _current.vtField[i].defValue = info.defValue;
+        }
+
+        _mpOldLayout.clear();
+        if (!sLayoutFile.empty())
+        {
+            loadLayoutFile(sLayoutFile, layoutDesc(vtTagType));
+        }
+
+        _enable = bEnable && !_current.vtField.empty();
+    }
+
+    void CompactRecord::loadLayoutFile(const string &sLayoutFile, const string &sCurrentDesc)
+    {
+        bool bFound = false;
+        if (tars::TC_File::isFileExist(sLayoutFile))
+        {
+            vector<string> vtLine = tars::TC_Common::sepstr<string>(tars::TC_File::load2str(sLayoutFile), "\n");
+            for (size_t i = 0; i < vtLine.size(); i++)
+            {
+                //每行为一个布局的描述串
+                string sDesc = tars::TC_Common::trim(vtLine[i]);
+                if (sDesc == sCurrentDesc)
+                {
+                    bFound = true;
+                    continue;
+                }
+
+                vector<pair<uint8_t, string> > vtTagType;
+                vector<string> vtField = tars::TC_Common::sepstr<string>(sDesc, ",");
+                for (size_t j = 0; j < vtField.size(); j++)
+                {
+                    string::size_type pos = vtField[j].find(':');
+                    if (pos == string::npos)
+                    {
+                        throw HashMap::MKDCacheException("CompactRecord::init layout file error: " + sDesc);
+                    }
+                    vtTagType.push_back(make_pair((uint8_t)tars::TC_Common::strto<int>(vtField[j].substr(0, pos)), vtField[j].substr(pos + 1)));
+                }
+
+                Layout layout;
+                if (vtTagType.empty() || !buildLayout(vtTagType, layout))
+                {
+                    throw HashMap::MKDCacheException("CompactRecord::init layout file error: " + sDesc);
+                }
+                if (layout.iId == _current.iId)
+                {
+                    throw HashMap::MKDCacheException("CompactRecord::init layout id conflict: " + sDesc + " vs " + sCurrentDesc);
+                }
+                _mpOldLayout[layout.iId] = layout;
+            }
+        }
+
+        if (!bFound && !_current.vtField.empty())
+        {
+            ofstream ofs(sLayoutFile.c_str(), ios::out | ios::app);
+            if (!ofs)
+            {
+                throw HashMap::MKDCacheException("CompactRecord::init open layout file error: " + sLayoutFile);
+            }
+            ofs << sCurrentDesc << endl;
+        }
+    }
+
+    string CompactRecord::fromTars(const string &sTars) const
+    {
+        tars::TarsInputStream<tars::BufferReader> isk;
+        isk.setBuffer(sTars.c_str(), sTars.length());
+
+        string sBitmap(_current.iBitmapSize, '\0');
+        string sFixed(_current.iFixedSize, '\0');
+        string sVar;
+
+        for (size_t i = 0; i < _current.vtField.size(); i++)
+        {
+            const FieldLayout &field = _current.vtField[i];
+            if (!isk.skipToTag(field.tag))
+            {
+                sBitmap[i / 8] |= (char)(1 << (i % 8));
+            }
+
+            char *p = &sFixed[0] + field.offset;
+            switch (field.kind)
+            {
+            case KIND_BYTE:
+                encodeFixed<tars::Char>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_SHORT:
+                encodeFixed<tars::Short>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_INT:
+                encodeFixed<tars::Int32>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_LONG:
+                encodeFixed<tars::Int64>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_FLOAT:
+                encodeFixed<tars::Float>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_DOUBLE:
+                encodeFixed<tars::Double>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_UINT32:
+                encodeFixed<tars::UInt32>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_UINT16:
+                encodeFixed<tars::UInt16>(isk, field.tag, field.defValue, p);
+                break;
+            case KIND_STRING:
+            {
+                string n = field.defValue;
+                isk.read(n, field.tag, false);
+                appendVarint(sVar, n.size());
+                sVar += n;
+            }
+            break;
+            }
+        }
+
+        string s;
+        s.reserve(_current.fixedBegin() + _current.iFixedSize + sVar.size());
+        s += (char)COMPACT_MAGIC;
+        s += (char)COMPACT_VERSION;
+        s.append((const char *)&_current.iId, sizeof(_current.iId));
+        s += sBitmap;
+        s += sFixed;
+        s += sVar;
+        return s;
+    }
+
+    string CompactRecord::toTars(const string &sCompact) const
+    {
+        const Layout &layout = checkHead(sCompact);
+
+        tars::TarsOutputStream<tars::BufferWriter> osk;
+        size_t iVarPos = layout.fixedBegin() + layout.iFixedSize;
+        for (size_t i = 0; i < layout.vtField.size(); i++)
+        {
+            const FieldLayout &field = layout.vtField[i];
+            bool bNull = isNull(sCompact, i);
+
+            if (field.kind == KIND_STRING)
+            {
+                //变长字段需按顺序跳过
+                uint32_t iLen = readVarint(sCompact, iVarPos);
+                if (iVarPos + iLen > sCompact.size())
+                    throw HashMap::MKDCacheException("CompactRecord::toTars length error");
+                if (!bNull)
+                    osk.write(sCompact.substr(iVarPos, iLen), field.tag);
+                iVarPos += iLen;
+                continue;
+            }
+            if (bNull)
+                continue;
+
+            const char *p = sCompact.c_str() + layout.fixedBegin() + field.offset;
+            switch (field.kind)
+            {
+            case KIND_BYTE:
+                decodeFixed<tars::Char>(osk, field.tag, p);
+                break;
+            case KIND_SHORT:
+                decodeFixed<tars::Short>(osk, field.tag, p);
+                break;
+            case KIND_INT:
+                decodeFixed<tars::Int32>(osk, field.tag, p);
+                break;
+            case KIND_LONG:
+                decodeFixed<tars::Int64>(osk, field.tag, p);
+                break;
+            case KIND_FLOAT:
+                decodeFixed<tars::Float>(osk, field.tag, p);
+                break;
+            case KIND_DOUBLE:
+                decodeFixed<tars::Double>(osk, field.tag, p);
+                break;
+            case KIND_UINT32:
+                decodeFixed<tars::UInt32>(osk, field.tag, p);
+                break;
+            case KIND_UINT16:
+                decodeFixed<tars::UInt16>(osk, field.tag, p);
+                break;
+            default:
+                break;
+            }
+        }
+
+        return string(osk.getBuffer(), osk.getLength());
+    }
+
+    string CompactRecord::read(const string &sCompact, uint8_t tag, const string &sDefault, bool isRequire) const
+    {
+        if (&checkHead(sCompact) != &_current)
+        {
+            throw HashMap::MKDCacheException("CompactRecord::read record is not in current layout");
+        }
+
+        const FieldLayout &field = currentField(tag);
+        if (isNull(sCompact, field.index))
+        {
+            if (isRequire)
+                throw HashMap::MKDCacheException("CompactRecord::read require field not exist, tag: " + tars::TC_Common::tostr((int)tag));
+        }
+
+        string s;
+        switch (field.kind)
+        {
+        case KIND_BYTE:
+        {
+            //与TarsDecode::read一致，不用TC_Common::tostr
+            ostringstream sBuffer;
+            sBuffer << getFixed<tars::Char>(fixedField(sCompact, field));
+            s = sBuffer.str();
+        }
+        break;
+        case KIND_SHORT:
+            s = tars::TC_Common::tostr(getFixed<tars::Short>(fixedField(sCompact, field)));
+            break;
+        case KIND_INT:
+            s = tars::TC_Common::tostr(getFixed<tars::Int32>(fixedField(sCompact, field)));
+            break;
+        case KIND_LONG:
+            s = tars::TC_Common::tostr(getFixed<tars::Int64>(fixedField(sCompact, field)));
+            break;
+        case KIND_FLOAT:
+            s = tars::TC_Common::tostr(getFixed<tars::Float>(fixedField(sCompact, field)));
+            break;
+        case KIND_DOUBLE:
+            s = tars::TC_Common::tostr(getFixed<tars::Double>(fixedField(sCompact, field)));
+            break;
+        case KIND_UINT32:
+            s = tars::TC_Common::tostr(getFixed<tars::UInt32>(fixedField(sCompact, field)));
+            break;
+        case KIND_UINT16:
+            s = tars::TC_Common::tostr(getFixed<tars::UInt16>(fixedField(sCompact, field)));
+            break;
+        case KIND_STRING:
+            varField(sCompact, field, s);
+            break;
+        }
+        return s;
+    }
+
+    bool CompactRecord::judge(const string &sCompact, uint8_t tag, Op op, const string &value) const
+    {
+        if (&checkHead(sCompact) != &_current)
+        {
+            throw HashMap::MKDCacheException("CompactRecord::judge record is not in current layout");
+        }
+
+        const FieldLayout &field = currentField(tag);
+        switch (field.kind)
+        {
+        case KIND_BYTE:
+            return compare(getFixed<tars::Char>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::Char>(value), op);
+        case KIND_SHORT:
+            return compare(getFixed<tars::Short>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::Short>(value), op);
+        case KIND_INT:
+            return compare(getFixed<tars::Int32>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::Int32>(value), op);
+        case KIND_LONG:
+            return compare(getFixed<tars::Int64>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::Int64>(value), op);
+        case KIND_FLOAT:
+            return compareFloat(getFixed<tars::Float>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::Float>(value), op);
+        case KIND_DOUBLE:
+            return compareFloat(getFixed<tars::Double>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::Double>(value), op);
+        case KIND_UINT32:
+            return compare(getFixed<tars::UInt32>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::UInt32>(value), op);
+        case KIND_UINT16:
+            return compare(getFixed<tars::UInt16>(fixedField(sCompact, field)), tars::TC_Common::strto<tars::UInt16>(value), op);
+        case KIND_STRING:
+        {
+            string s;
+            varField(sCompact, field, s);
+            return compare(s, value, op);
+        }
+        }
+        return false;
+    }
+
+    string CompactRecord::desc() const
+    {
+        size_t iVarCount = 0;
+        for (size_t i = 0; i < _current.vtField.size(); i++)
+        {
+            if (_current.vtField[i].kind == KIND_STRING)
+                iVarCount++;
+        }
+
+        ostringstream os;
+        os << "compact record enable: " << (_enable ? "Y" : "N") << endl;
+        os << "layout id: " << _current.iId << ", old layout count: " << _mpOldLayout.size() << endl;
+        os << "value field count: " << _current.vtField.size() << ", fixed field size: " << _current.iFixedSize << ", string field count: " << iVarCount << endl;
+        return os.str();
+    }
+
+    const CompactRecord::FieldLayout &CompactRecord::currentField(uint8_t tag) const
+    {
+        int iIndex = _current.tagIndex[tag];
+        if (iIndex < 0)
+        {
+            throw HashMap::MKDCacheException("CompactRecord: tag not found: " + tars::TC_Common::tostr((int)tag));
+        }
+        return _current.vtField[iIndex];
+    }
+
+    const char *CompactRecord::fixedField(const string &sCompact, const FieldLayout &field) const
+    {
+        return sCompact.c_str() + _current.fixedBegin() + field.offset;
+    }
+
+    void CompactRecord::varField(const string &sCompact, const FieldLayout &field, string &s) const
+    {
+        size_t pos = _current.fixedBegin() + _current.iFixedSize;
+        for (uint32_t i = 0; ; i++)
+        {
+            uint32_t iLen = readVarint(sCompact, pos);
+            if (pos + iLen > sCompact.size())
+                throw HashMap::MKDCacheException("CompactRecord::varField length error");
+            if (i == field.offset)
+            {
+                s.assign(sCompact, pos, iLen);
+                return;
+            }
+            pos += iLen;
+        }
+    }
+
+    const CompactRecord::Layout &CompactRecord::checkHead(const string &sCompact) const
+    {
+        if (sCompact.size() < COMPACT_HEAD_SIZE || (uint8_t)sCompact[1] != COMPACT_VERSION)
+        {
+            throw HashMap::MKDCacheException("CompactRecord: record version error");
+        }
+
+        uint32_t iId = layoutId(sCompact);
+        const Layout *layout = &_current;
+        if (iId != _current.iId)
+        {
+            map<uint32_t, Layout>::const_iterator it = _mpOldLayout.find(iId);
+            if (it == _mpOldLayout.end())
+            {
+                throw HashMap::MKDCacheException("CompactRecord: unknown layout id: " + tars::TC_Common::tostr(iId));
+            }
+            layout = &it->second;
+        }
+
+        if (sCompact.size() < layout->fixedBegin() + layout->iFixedSize)
+        {
+            throw HashMap::MKDCacheException("CompactRecord: record length error");
+        }
+        return *layout;
+    }
+}
@@ -0,0 +1,209 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef _MK_COMPACT_RECORD_H
+#define _MK_COMPACT_RECORD_H
+
+#include <string.h>
+#include "util/tc_singleton.h"
+#include "tc_multi_hashmap_malloc.h"
+#include "CacheShare.h"
+
+using namespace DCache;
+
+namespace HashMap
+{
+    /*
+     * 按字段配置(FieldConf)生成的value紧凑编码
+     *
+     * 格式: 0xFF | 版本 | 布局id(4字节) | 缺省位图 | 定长区 | 变长区
+     *   定长区: 数值字段按配置顺序以固定宽度存放，可按偏移直接读取
+     *   变长区: string字段按配置顺序存放，每个字段为varint长度+内容
+     *   缺省位图: 原tars编码中不存在的字段置位，转换回tars编码时不写出该字段，定长区中存放其默认值
+     *   布局id: 由各value字段的tag和类型计算，字段增删、类型修改后id随之变化
+     * tars编码的第一个字节是字段头，类型不会是15，因此以0xFF开头即可区分两种编码，cache中两种编码可以共存
+     *
+     * 用过的布局记录在布局文件中，修改value字段配置重启后，旧布局的数据按原布局转回tars编码再读取，
+     * 与tars编码的数据修改字段配置后的行为一致；只有当前布局的数据按偏移直接读取
+     *
+     * 只在内存中使用，binlog、回写DB、返回给调用方的数据仍为tars编码
+     */
+    class CompactRecord : public tars::TC_Singleton<CompactRecord>
+    {
+    public:
+        CompactRecord() : _enable(false) {}
+
+        /*
+         * 根据value字段配置生成布局
+         * @param fieldConf: 字段配置
+         * @param bEnable: 写入cache时是否转成紧凑编码，关闭时仍可读取已有的紧凑编码数据
+         * @param sLayoutFile: 布局文件，加载以前用过的布局，当前布局不在文件中时追加；为空时只识别当前布局
+         */
+        void init(const TC_Multi_HashMap_Malloc::FieldConf &fieldConf, bool bEnable, const string &sLayoutFile);
+
+        bool isEnable() const
+        {
+            return _enable;
+        }
+
+        static bool isCompact(const string &sValue)
+        {
+            return !sValue.empty() && (uint8_t)sValue[0] == COMPACT_MAGIC;
+        }
+
+        /*
+         * 是否为当前布局的紧凑编码，只有当前布局可以用read/judge直接读取
+         */
+        bool isCurrent(const string &sCompact) const
+        {
+            return sCompact.size() >= COMPACT_HEAD_SIZE && (uint8_t)sCompact[1] == COMPACT_VERSION && layoutId(sCompact) == _current.iId;
+        }
+
+        /*
+         * 写入cache前是否需要转换
+         */
+        bool needEncode(const string &sValue) const
+        {
+            return _enable && !sValue.empty() && !isCompact(sValue);
+        }
+
+        /*
+         * tars编码转成紧凑编码
+         */
+        string fromTars(const string &sTars) const;
+
+        /*
+         * 紧凑编码转成tars编码，旧布局的数据按其原布局转换
+         */
+        string toTars(const string &sCompact) const;
+
+        /*
+         * 返回tars编码的value，tars编码的数据原样返回
+         */
+        string normalize(const string &sValue) const
+        {
+            return isCompact(sValue) ? toTars(sValue) : sValue;
+        }
+
+        /*
+         * 直接从当前布局的紧凑编码中读出字段，返回值的格式与TarsDecode::read一致
+         */
+        string read(const string &sCompact, uint8_t tag, const string &sDefault, bool isRequire) const;
+
+        /*
+         * 直接在当前布局的紧凑编码上判断字段是否满足条件，比较规则与judgeValue一致
+         */
+        bool judge(const string &sCompact, uint8_t tag, Op op, const string &value) const;
+
+        string desc() const;
+
+    protected:
+        enum FieldKind
+        {
+            KIND_BYTE,
+            KIND_SHORT,
+            KIND_INT,
+            KIND_LONG,
+            KIND_FLOAT,
+            KIND_DOUBLE,
+            KIND_UINT32,
+            KIND_UINT16,
+            KIND_STRING
+        };
+
+        struct FieldLayout
+        {
+            uint8_t tag;
+            FieldKind kind;
+            //在缺省位图中的位置
+            uint32_t index;
+            //定长字段的宽度，string字段为0
+            uint32_t width;
+            //定长字段为在定长区中的偏移，string字段为在变长区中的序号
+            uint32_t offset;
+            bool bRequire;
+            string defValue;
+        };
+
+        //一种字段配置对应的布局
+        struct Layout
+        {
+            uint32_t iId;
+            //按配置顺序的value字段布局
+            vector<FieldLayout> vtField;
+            //tag -> 字段在vtField中的下标
+            int tagIndex[256];
+            size_t iFixedSize;
+            size_t iBitmapSize;
+
+            Layout() : iId(0), iFixedSize(0), iBitmapSize(0) {}
+
+            //定长区的起始位置
+            size_t fixedBegin() const
+            {
+                return COMPACT_HEAD_SIZE + iBitmapSize;
+            }
+        };
+
+        /*
+         * 由(tag, 类型)列表生成布局，类型为字段配置中的类型名
+         * @return bool: 类型不支持时返回false
+         */
+        static bool buildLayout(const vector<pair<uint8_t, string> > &vtTagType, Layout &layout);
+
+        /*
+         * 布局的描述串，格式为tag:类型,tag:类型，写入布局文件，布局id由其计算
+         */
+        static string layoutDesc(const vector<pair<uint8_t, string> > &vtTagType);
+
+        void loadLayoutFile(const string &sLayoutFile, const string &sCurrentDesc);
+
+        static uint32_t layoutId(const string &sCompact)
+        {
+            uint32_t iId;
+            memcpy(&iId, sCompact.c_str() + 2, sizeof(iId));
+            return iId;
+        }
+
+        const FieldLayout &currentField(uint8_t tag) const;
+
+        static bool isNull(const string &sCompact, size_t iIndex)
+        {
+            return ((uint8_t)sCompact[COMPACT_HEAD_SIZE + iIndex / 8] >> (iIndex % 8)) & 0x01;
+        }
+
+        const char *fixedField(const string &sCompact, const FieldLayout &field) const;
+
+        void varField(const string &sCompact, const FieldLayout &field, string &s) const;
+
+        /*
+         * 返回数据所属的布局，布局未知或数据长度不足时抛异常
+         */
+        const Layout &checkHead(const string &sCompact) const;
+
+    protected:
+        static const uint8_t COMPACT_MAGIC = 0xFF;
+        static const uint8_t COMPACT_VERSION = 2;
+        //0xFF | 版本 | 布局id
+        static const size_t COMPACT_HEAD_SIZE = 6;
+
+        bool _enable;
+
+        //当前字段配置的布局
+        Layout _current;
+        //布局文件中记录的其他布局，布局id -> 布局
+        map<uint32_t, Layout> _mpOldLayout;
+    };
+}
+
+#endif
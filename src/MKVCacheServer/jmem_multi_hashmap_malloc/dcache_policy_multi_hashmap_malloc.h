@@ -18,9 +18,11 @@
 #include "policy_multi_hashmap_malloc.h"
 #include "tc_multi_hashmap_malloc.h"
 #include "dcache_jmem_policy.h"
-#include "NormalHash.h"
+#include "HashFactory.h"
 #include "util/tc_shm.h"
 #include <math.h>
+#include <atomic>
+#include <memory>
 namespace DCache
 {
     template<typename LockPolicy,
@@ -337,7 +339,12 @@ namespace DCache
     public:
         MultiHashMapMallocDCache()
         {
-            _pHash = new NormalHash();
+            _pHash = HashFactory::getHash(HASH_TYPE_NORMAL);
+            _mkGeneration.reset(new std::atomic<uint32_t>[MK_GENERATION_SLOT]);
+            for (size_t i = 0; i < MK_GENERATION_SLOT; i++)
+            {
+                _mkGeneration[i] = 0;
+            }
         }
         ~MultiHashMapMallocDCache()
         {
@@ -348,10 +355,6 @@ namespace DCache
                     delete _multiHashMapVec[i];
                 }
             }
-            if (_pHash != NULL)
-            {
-                delete _pHash;
-            }
         }
         void init(unsigned int jmemNum)
         {
@@ -474,6 +477,25 @@ namespace DCache
             }
         }
 
+        /**
+         * 设置key的hash类型，用于选择jmem并写入各jmem的头部，须在initStore之前调用
+         * @return 不支持的hash类型返回false
+         */
+        bool initHashType(int iHashType)
+        {
+            P_Hash *pHash = HashFactory::getHash(iHashType);
+            if (pHash == NULL)
+            {
+                return false;
+            }
+            _pHash = pHash;
+            for (unsigned int i = 0; i < _jmemNum; ++i)
+            {
+                _multiHashMapVec[i]->initHashType((char)iHashType);
+            }
+            return true;
+        }
+
         /**
          * 设置hash方式，这个hash函数将作为联合主键的hash函数
          * @param hash_of
@@ -959,6 +981,7 @@ namespace DCache
             }
             fclose(fp);
             delete[] pBuffer;
+            touchAllMainKey();
             if (iLen == _shm.size())
             {
                 return TC_Multi_HashMap_Malloc::RT_OK;
@@ -979,6 +1002,7 @@ namespace DCache
             {
                 _multiHashMapVec[i]->clear();
             }
+            touchAllMainKey();
         }
 
 
@@ -1034,6 +1058,32 @@ namespace DCache
             return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->get(mk, uk, v, iSyncTime, iDateExpireTime, iVersion, bDirty, bCheckExpire, iExpireTime);
         }
 
+        /**
+         * 批量获取(主key, 联合key)的数据，vtItem[i]为(vtMainKey[i], vtUKey[i])的结果，返回值与get相同。
+         * 按jmem分组后每组只加一次锁(大批量时分段加锁)，见PolicyMultiHashMapMalloc::getBatch
+         */
+        void getBatch(const vector<string> &vtMainKey, const vector<string> &vtUKey, vector<MKBatchGetItem> &vtItem, bool bCheckExpire = false, uint32_t iExpireTime = -1)
+        {
+            vtItem.clear();
+            vtItem.resize(vtMainKey.size());
+
+            vector<vector<MKBatchGetItem*> > vtJmemItem(_jmemNum);
+            for (size_t i = 0; i < vtMainKey.size(); ++i)
+            {
+                vtItem[i].mk = &vtMainKey[i];
+                vtItem[i].uk = &vtUKey[i];
+                vtJmemItem[_pHash->HashRawString(vtMainKey[i]) % _jmemNum].push_back(&vtItem[i]);
+            }
+
+            for (unsigned int i = 0; i < _jmemNum; ++i)
+            {
+                if (!vtJmemItem[i].empty())
+                {
+                    _multiHashMapVec[i]->getBatch(vtJmemItem[i], bCheckExpire, iExpireTime);
+                }
+            }
+        }
+
         int get(const string& mk, vector<Value> &vs, size_t iCount = -1, size_t iStart = 0, bool bHead = true, bool bCheckExpire = false, uint32_t iExpireTime = -1)
         {
             return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->get(mk, vs, iCount, iStart, bHead, bCheckExpire, iExpireTime);
@@ -1086,21 +1136,33 @@ namespace DCache
         //插入一个onlykey数据，用于删除数据库
         int setForDel(const string &mk, const string &uk, const time_t t, TC_Multi_HashMap_Malloc::DATATYPE eType = TC_Multi_HashMap_Malloc::AUTO_DATA, bool bHead = true)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->setForDel(mk, uk, t, eType, bHead);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->setForDel(mk, uk, t, eType, bHead);
+            touchMainKey(hash);
+            return iRet;
         }
         int set(const string &mk, const string &uk, const string &v, uint32_t iExpireTime, uint8_t iVersion, TC_Multi_HashMap_Malloc::DELETETYPE deleteType, bool bDirty = true, TC_Multi_HashMap_Malloc::DATATYPE eType = TC_Multi_HashMap_Malloc::AUTO_DATA, bool bHead = true, bool bUpdateOrder = false, const uint32_t iMaxDataCount = 0, bool bDelDirty = false, bool bCheckExpire = false, uint32_t iNowTime = -1)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->set(mk, uk, v, iExpireTime, iVersion, bDirty, eType, bHead, bUpdateOrder, iMaxDataCount, deleteType, bDelDirty, bCheckExpire, iNowTime);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->set(mk, uk, v, iExpireTime, iVersion, bDirty, eType, bHead, bUpdateOrder, iMaxDataCount, deleteType, bDelDirty, bCheckExpire, iNowTime);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int set(const string &mk, const string &uk, TC_Multi_HashMap_Malloc::DELETETYPE deleteType, TC_Multi_HashMap_Malloc::DATATYPE eType = TC_Multi_HashMap_Malloc::AUTO_DATA, bool bHead = true, bool bUpdateOrder = false)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->set(mk, uk, eType, bHead, bUpdateOrder, deleteType);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->set(mk, uk, eType, bHead, bUpdateOrder, deleteType);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int set(const string &mk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->set(mk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->set(mk);
+            touchMainKey(hash);
+            return iRet;
         }
 
         //对此接口的调用必须保障vs中所有的主key完全相同
@@ -1108,47 +1170,81 @@ namespace DCache
         {
             if (vs.empty())
                 return TC_Multi_HashMap_Malloc::RT_OK;
-            return _multiHashMapVec[_pHash->HashRawString(vs[0]._mkey) % _jmemNum]->set(vs, eType, bHead, bUpdateOrder, bOrderByItem, bForce);
+            size_t hash = _pHash->HashRawString(vs[0]._mkey);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->set(vs, eType, bHead, bUpdateOrder, bOrderByItem, bForce);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int update(const string &mk, const string &uk, const map<std::string, DCache::UpdateValue> &mpValue,
             const vector<DCache::Condition> & vtUKCond, const TC_Multi_HashMap_Malloc::FieldConf *fieldInfo, bool bLimit, size_t iIndex, size_t iCount, string &retValue, bool bCheckExpire, uint32_t iNowTime, uint32_t iExpireTime,
             bool bDirty = true, TC_Multi_HashMap_Malloc::DATATYPE eType = TC_Multi_HashMap_Malloc::AUTO_DATA, bool bHead = true, bool bUpdateOrder = false, const uint32_t iMaxDataCount = 0, bool bDelDirty = false)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->update(mk, uk, mpValue, vtUKCond, fieldInfo, bLimit, iIndex, iCount, retValue, bCheckExpire, iNowTime, iExpireTime, bDirty, eType, bHead, bUpdateOrder, iMaxDataCount, bDelDirty);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->update(mk, uk, mpValue, vtUKCond, fieldInfo, bLimit, iIndex, iCount, retValue, bCheckExpire, iNowTime, iExpireTime, bDirty, eType, bHead, bUpdateOrder, iMaxDataCount, bDelDirty);
+            touchMainKey(hash);
+            return iRet;
+        }
+
+        //在一次加锁内对主key下的数据执行一组操作，f的形式见PolicyMultiHashMapMalloc::transaction
+        template<typename F>
+        int transaction(const string &mk, F &f)
+        {
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->transaction(f);
+            touchMainKey(hash);
+            return iRet;
         }
 
         //不是真正的删除数据，只是把标记位设置
         int delSetBit(const string &mk, const string &uk, const time_t t)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delSetBit(mk, uk, t);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delSetBit(mk, uk, t);
+            touchMainKey(hash);
+            return iRet;
         }
         //不是真正的删除数据，只是把标记位设置
         int delSetBit(const string &mk, const string &uk, uint8_t iVersion, const time_t t)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delSetBit(mk, uk, iVersion, t);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delSetBit(mk, uk, iVersion, t);
+            touchMainKey(hash);
+            return iRet;
         }
         //不是真正的删除数据，只是把标记位设置
         int delSetBit(const string &mk, const time_t t, uint64_t &delCount)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delSetBit(mk, t, delCount);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delSetBit(mk, t, delCount);
+            touchMainKey(hash);
+            return iRet;
         }
 
         //真正删除数据，并且删除的时候检查删除标记是否设置
         int delReal(const string &mk, const string &uk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delReal(mk, uk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delReal(mk, uk);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int erase(const string &mk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->erase(mk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->erase(mk);
+            touchMainKey(hash);
+            return iRet;
         }
 
 
         int erase(const string &mk, const string &uk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->erase(mk, uk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->erase(mk, uk);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int erase(int ratio, unsigned int uJmemIndex, unsigned int uMaxEraseOneTime, bool bCheckDirty = false)
@@ -1164,13 +1260,19 @@ namespace DCache
         //强制删除数据，包括标记为del的数据
         int eraseByForce(const string &mk, const string &uk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->eraseByForce(mk, uk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->eraseByForce(mk, uk);
+            touchMainKey(hash);
+            return iRet;
         }
 
         //强制删除主key下的所有数据，包括标记为del的数据
         int eraseByForce(const string &mk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->eraseByForce(mk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->eraseByForce(mk);
+            touchMainKey(hash);
+            return iRet;
         }
 
         /**
@@ -1191,7 +1293,9 @@ namespace DCache
         template<typename C>
         int eraseHashMByForce(uint32_t h, C c, vector<string>& vDelMK)
         {
-            return _multiHashMapVec[h%_jmemNum]->eraseHashMByForce(h, c, vDelMK);
+            int iRet = _multiHashMapVec[h%_jmemNum]->eraseHashMByForce(h, c, vDelMK);
+            touchMainKey(h);
+            return iRet;
         }
 
         /**
@@ -1215,12 +1319,18 @@ namespace DCache
 
         int pushList(const string &mk, const vector<pair<uint32_t, string> > &v, const bool bHead, const bool bReplace, const uint64_t iPos, const uint32_t iNowTime)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->pushList(mk, v, bHead, bReplace, iPos, iNowTime);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->pushList(mk, v, bHead, bReplace, iPos, iNowTime);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int pushList(const string &mk, const vector<Value> &vt)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->pushList(mk, vt);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->pushList(mk, vt);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int getList(const string &mk, const uint64_t iStart, const uint64_t iEnd, const uint32_t iNowTime, vector<string> &vs)
@@ -1230,22 +1340,34 @@ namespace DCache
 
         int trimList(const string &mk, const bool bPop, const bool bHead, const bool bTrim, const uint64_t iStart, const uint64_t iCount, const uint32_t iNowTime, string &value, uint64_t &delSize)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->trimList(mk, bPop, bHead, bTrim, iStart, iCount, iNowTime, value, delSize);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->trimList(mk, bPop, bHead, bTrim, iStart, iCount, iNowTime, value, delSize);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int addSet(const string &mk, const string &v, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, TC_Multi_HashMap_Malloc::DELETETYPE deleteType)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->addSet(mk, v, iExpireTime, iVersion, bDirty, deleteType);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->addSet(mk, v, iExpireTime, iVersion, bDirty, deleteType);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int addSet(const string &mk, const vector<Value> &vt, TC_Multi_HashMap_Malloc::DATATYPE eType)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->addSet(mk, vt, eType);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->addSet(mk, vt, eType);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int addSet(const string &mk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->addSet(mk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->addSet(mk);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int getSet(const string &mk, const uint32_t iNowTime, vector<Value> &vtData)
@@ -1255,32 +1377,50 @@ namespace DCache
 
         int delSetSetBit(const string &mk, const string &v, const time_t t)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delSetSetBit(mk, v, t);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delSetSetBit(mk, v, t);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int delSetSetBit(const string &mk, const time_t t)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delSetSetBit(mk, t);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delSetSetBit(mk, t);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int delSetReal(const string &mk, const string &v)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delSetReal(mk, v);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delSetReal(mk, v);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int addZSet(const string &mk, const string &v, double iScore, uint32_t iExpireTime, uint8_t iVersion, bool bDirty, bool bInc, TC_Multi_HashMap_Malloc::DELETETYPE deleteType)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->addZSet(mk, v, iScore, iExpireTime, iVersion, bDirty, bInc, deleteType);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->addZSet(mk, v, iScore, iExpireTime, iVersion, bDirty, bInc, deleteType);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int addZSet(const string &mk, const vector<Value> &vt, TC_Multi_HashMap_Malloc::DATATYPE eType)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->addZSet(mk, vt, eType);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->addZSet(mk, vt, eType);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int addZSet(const string &mk)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->addZSet(mk);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->addZSet(mk);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int getZSet(const string &mk, const uint64_t iStart, const uint64_t iEnd, const bool bUp, const uint32_t iNowTime, list<Value> &vtData)
@@ -1315,27 +1455,42 @@ namespace DCache
 
         int delZSetSetBit(const string &mk, const string &v, const time_t t)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delZSetSetBit(mk, v, t);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delZSetSetBit(mk, v, t);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int delRangeZSetSetBit(const string &mk, const double iMin, const double iMax, const uint32_t iNowTime, const time_t t)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delRangeZSetSetBit(mk, iMin, iMax, iNowTime, t);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delRangeZSetSetBit(mk, iMin, iMax, iNowTime, t);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int delZSetReal(const string &mk, const string &v)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delZSetReal(mk, v);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delZSetReal(mk, v);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int delZSetSetBit(const string &mk, const time_t t)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->delZSetSetBit(mk, t);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->delZSetSetBit(mk, t);
+            touchMainKey(hash);
+            return iRet;
         }
 
         int updateZSet(const string &mk, const string &sOldValue, const string &sNewValue, double iScore, uint32_t iExpireTime, char iVersion, bool bDirty, bool bOnlyScore)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->updateZSet(mk, sOldValue, sNewValue, iScore, iExpireTime, iVersion, bDirty, bOnlyScore);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->updateZSet(mk, sOldValue, sNewValue, iScore, iExpireTime, iVersion, bDirty, bOnlyScore);
+            touchMainKey(hash);
+            return iRet;
         }
 
         /**
@@ -1589,6 +1744,21 @@ namespace DCache
             return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->checkMainKey(mk);
         }
 
+        /**
+        * 获取主key的修改代数
+        * 每次通过本类修改主key下的数据后代数都会增加，按主key hash分槽计数，
+        * hash冲突只会导致误判为已修改，不会漏判。
+        * 用于判断在共享内存之外缓存的主key派生数据(如二级索引)是否过期，
+        * 读取代数必须在读取数据之前
+        * @param mk, 主key
+        *
+        * @return uint32_t, 当前代数
+        */
+        uint32_t getMainKeyGeneration(const string& mk)
+        {
+            return _mkGeneration[_pHash->HashRawString(mk) % MK_GENERATION_SLOT];
+        }
+
         int getMainKeyType(TC_Multi_HashMap_Malloc::MainKey::KEYTYPE &keyType)
         {
             return _multiHashMapVec[0]->getMainKeyType(keyType);
@@ -1607,7 +1777,10 @@ namespace DCache
         */
         int setFullData(const string &mk, bool bFull)
         {
-            return _multiHashMapVec[_pHash->HashRawString(mk) % _jmemNum]->setFullData(mk, bFull);
+            size_t hash = _pHash->HashRawString(mk);
+            int iRet = _multiHashMapVec[hash % _jmemNum]->setFullData(mk, bFull);
+            touchMainKey(hash);
+            return iRet;
         }
 
         /**
@@ -1694,7 +1867,25 @@ namespace DCache
 
 
 
+    protected:
+        //主key数据修改完成后增加代数，必须在数据修改之后调用
+        void touchMainKey(size_t hash)
+        {
+            ++_mkGeneration[hash % MK_GENERATION_SLOT];
+        }
+
+        void touchAllMainKey()
+        {
+            for (size_t i = 0; i < MK_GENERATION_SLOT; i++)
+            {
+                ++_mkGeneration[i];
+            }
+        }
+
     private:
+        //主key修改代数的分槽数
+        static const size_t MK_GENERATION_SLOT = 65536;
+
         vector<JmemMultiHashMap *> _multiHashMapVec;
         //jmem个数
         unsigned int _jmemNum;
@@ -1703,7 +1894,11 @@ namespace DCache
         //信号量集
         typename LockPolicy::Mutex _Mutex;
 
-        NormalHash * _pHash;
+        // HashFactory的共享实例，不用释放
+        P_Hash * _pHash;
+
+        //主key修改代数，见getMainKeyGeneration
+        std::unique_ptr<std::atomic<uint32_t>[]> _mkGeneration;
     };
 }
 
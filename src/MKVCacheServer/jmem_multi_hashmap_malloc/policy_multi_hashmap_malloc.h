@@ -142,6 +142,22 @@ namespace DCache
      > 注意:hash_iterator对应的其实是一个hash桶链, 每次获取数据其实会获取桶链上面的所有数据
     */
 
+    /**
+     * 批量读中的一条(主key, 联合key)，PolicyMultiHashMapMalloc::getBatch的输入和输出
+     */
+    struct MKBatchGetItem
+    {
+        MKBatchGetItem() : mk(NULL), uk(NULL), hash(0), ret(TC_Multi_HashMap_Malloc::RT_OK) {}
+
+        const string *mk;
+        const string *uk;
+        // 主key加联合key的哈希值
+        uint32_t hash;
+        // 与get的返回值相同
+        int ret;
+        TC_Multi_HashMap_Malloc::Value value;
+    };
+
     template<typename LockPolicy,
         template<class, class> class StorePolicy>
     class PolicyMultiHashMapMalloc : public StorePolicy<TC_Multi_HashMap_Malloc, LockPolicy>
@@ -1182,6 +1198,13 @@ namespace DCache
          */
         void initMainKeyHashRatio(float fratio) { this->_t.initMainKeyHashRatio(fratio); }
 
+        /**
+         * 设置key的hash类型, 必须在create/connect之前调用
+         *
+         * @param cHashType
+         */
+        void initHashType(char cHashType) { this->_t.initHashType(cHashType); }
+
         /**
          * 设置hash方式，这个hash函数将作为联合主键的hash函数
          * @param hash_of
@@ -1698,6 +1721,67 @@ namespace DCache
 
             return TC_Multi_HashMap_Malloc::RT_LOAD_DATA_ERR;
         }
+        /**
+         * 批量获取数据, 修改GET时间链，结果写在各MKBatchGetItem中。
+         * 哈希值在加锁前计算，每BATCH_LOCK_KEYS条加一次锁，持锁期间提前预取后面几条的hash桶和数据块；
+         * 没有数据且设置了自定义Get函数的，再逐条按get加载
+         * @param vtItem
+         */
+        void getBatch(vector<MKBatchGetItem*> &vtItem, bool bCheckExpire = false, uint32_t iExpireTime = -1)
+        {
+            size_t n = vtItem.size();
+            for (size_t i = 0; i < n; ++i)
+            {
+                vtItem[i]->hash = this->_t.getHashFunctor()(*vtItem[i]->mk + *vtItem[i]->uk);
+            }
+
+            for (size_t begin = 0; begin < n; begin += BATCH_LOCK_KEYS)
+            {
+                size_t end = min(n, begin + BATCH_LOCK_KEYS);
+
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+
+                // 先预取hash桶，隔BATCH_PREFETCH条后再读桶中的地址预取数据块
+                for (size_t i = begin; i < end && i < begin + 2 * BATCH_PREFETCH; ++i)
+                {
+                    this->_t.prefetchHash(vtItem[i]->hash);
+                }
+                for (size_t i = begin; i < end && i < begin + BATCH_PREFETCH; ++i)
+                {
+                    this->_t.prefetchBlock(vtItem[i]->hash);
+                }
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (i + 2 * BATCH_PREFETCH < end)
+                    {
+                        this->_t.prefetchHash(vtItem[i + 2 * BATCH_PREFETCH]->hash);
+                    }
+                    if (i + BATCH_PREFETCH < end)
+                    {
+                        this->_t.prefetchBlock(vtItem[i + BATCH_PREFETCH]->hash);
+                    }
+
+                    MKBatchGetItem &item = *vtItem[i];
+                    item.ret = this->_t.get(*item.mk, *item.uk, item.hash, item.value, bCheckExpire, iExpireTime);
+                }
+            }
+
+            if (_todo_of == NULL)
+            {
+                return;
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                MKBatchGetItem &item = *vtItem[i];
+                if (item.ret == TC_Multi_HashMap_Malloc::RT_NO_DATA)
+                {
+                    item.ret = get(*item.mk, *item.uk, item.value, bCheckExpire, iExpireTime);
+                }
+            }
+        }
+
         int get(const string &mk, const string &uk, Value &v, uint32_t &iSyncTime, uint32_t& iDateExpireTime, uint8_t& iVersion, bool& bDirty, bool bCheckExpire = false, uint32_t iExpireTime = -1)
         {
             int ret = TC_Multi_HashMap_Malloc::RT_OK;
@@ -2365,6 +2449,39 @@ namespace DCache
             return ret;
         }
 
+        /**
+         * 在一次加锁内执行一组操作，用于同一主key下多条记录的原子修改
+         * @param f: 操作函数，形式为int f(TC_Multi_HashMap_Malloc &t, vector<TC_Multi_HashMap_Malloc::Value> &vtErased)
+         *           vtErased为操作过程中被淘汰的数据
+         * @return int: f的返回值
+         */
+        template<typename F>
+        int transaction(F &f)
+        {
+            int ret = TC_Multi_HashMap_Malloc::RT_OK;
+            vector<TC_Multi_HashMap_Malloc::Value> vtErased;
+            {
+                TC_LockT<typename LockPolicy::Mutex> lock(LockPolicy::mutex());
+                ret = f(this->_t, vtErased);
+            }
+
+            //操作淘汰数据
+            if (_todo_of)
+            {
+                for (size_t i = 0; i < vtErased.size(); i++)
+                {
+                    try
+                    {
+                        _todo_of->del((ret == TC_Multi_HashMap_Malloc::RT_OK), vtErased[i]);
+                    }
+                    catch (exception &ex)
+                    {
+                    }
+                }
+            }
+            return ret;
+        }
+
         /**
          * 不是真正删除数据，只是把标记位设置
          *
@@ -3849,6 +3966,11 @@ namespace DCache
             return JMKhmIterator(this->_t.mHashEnd(), jlock);
         }
     protected:
+        // getBatch每次加锁处理的条数，避免一个大批量长时间持锁
+        static const size_t BATCH_LOCK_KEYS = 64;
+
+        // getBatch预取的距离(条数)
+        static const size_t BATCH_PREFETCH = 4;
 
         /**
          * 删除数据的函数对象
@@ -17,6 +17,7 @@
 #include <iostream>
 #include <cassert>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <vector>
 
@@ -67,6 +68,63 @@ namespace DCache
             return class_to_pages_[cl];
         }
 
+        /*
+        *尺寸类别的个数, 包括不使用的0类别
+        */
+        inline size_t NumClasses() const
+        {
+            return num_classes_;
+        }
+
+        /*
+        *按指定的尺寸列表初始化尺寸类别
+        *列表须递增、最后一个为kMaxSize、个数小于kNumClasses, 不超过kMaxSmallSize的按8字节对齐, 超过的按128字节对齐
+        *划分出的内存块个数相同的相邻尺寸会合并为较大的一个
+        *@return bool, 列表不合法时返回false, 原有的尺寸类别不变
+        */
+        bool Init(const vector<size_t> &vtClassSize);
+
+        /*
+        *当前的尺寸列表, 不含0类别
+        */
+        void GetClassSize(vector<size_t> &vtClassSize) const;
+
+        /*
+        *按直方图估算内部碎片的字节数, 桶中的请求都按桶内最大尺寸计算
+        */
+        uint64_t EstimateWaste(const vector<uint64_t> &vtHist);
+
+        /*
+        *尺寸直方图中size所在的桶, 桶的粒度与尺寸类别能区分的粒度一致
+        */
+        static inline size_t HistIndex(size_t size)
+        {
+            return ClassIndex(size);
+        }
+
+        /*
+        *尺寸直方图的桶数
+        */
+        static inline size_t HistSize()
+        {
+            return kClassArraySize;
+        }
+
+        /*
+        *桶iIndex中的最大尺寸
+        */
+        static size_t HistBucketSize(size_t iIndex);
+
+        /*
+        *根据尺寸直方图推导内部碎片最小的尺寸列表
+        *以默认尺寸类别加上直方图中出现过的尺寸为候选, 每次去掉合并代价最小的一个, 直到个数小于kNumClasses
+        *去掉后相邻尺寸的间距要么不超过默认尺寸类别原有的间距, 要么不超过iMaxWaste(百分比), 保证没统计到的尺寸浪费也有上限
+        *@param vtHist, 按HistIndex统计的分配次数
+        *@param iMaxWaste, 允许的最大间距(百分比)
+        *@param vtClassSize, 推导出的尺寸列表, 可直接用于Init
+        */
+        static void LearnClassSize(const vector<uint64_t> &vtHist, uint32_t iMaxWaste, vector<size_t> &vtClassSize);
+
     private:
         static inline size_t ClassIndex(int s)
         {
@@ -101,9 +159,20 @@ namespace DCache
         size_t AlignmentForSize(size_t size);
 
         int NumMoveSize(size_t size);
+
+        /*
+        *尺寸为size的类别每个span需要的页数, 保证页尾浪费不超过1/8
+        */
+        size_t PagesForSize(size_t size);
+
+        /*
+        *根据class_to_size_生成class_array_
+        */
+        void BuildClassArray();
     private:
         static const int kMaxSmallSize = 1024;
         static const size_t kClassArraySize = ((kMaxSize + 127 + (120 << 7)) >> 7) + 1;
+        size_t			num_classes_;
         size_t			class_to_size_[kNumClasses];
         size_t			class_to_pages_[kNumClasses];
         unsigned char	class_array_[kClassArraySize];
@@ -264,8 +333,28 @@ namespace DCache
             TC_Span      nonempty;				/*非空闲链表*/
         }__attribute__((packed));
 
+        /**
+         * 按尺寸类别统计的内存块使用情况，用于观察碎片
+         */
+        struct tagSizeClassStat
+        {
+            size_t       _iObjectSize;			/*该类别的内存块大小*/
+            size_t       _iSpanNum;				/*该类别占用的span个数*/
+            size_t       _iPageNum;				/*该类别占用的页数*/
+            size_t       _iObjectNum;			/*span按该类别划分后的内存块总数*/
+            size_t       _iUsedObjectNum;		/*已分配出去的内存块个数*/
+            size_t       _iSparseSpanNum;		/*使用率低于阈值的span个数*/
+
+            tagSizeClassStat() : _iObjectSize(0), _iSpanNum(0), _iPageNum(0), _iObjectNum(0), _iUsedObjectNum(0), _iSparseSpanNum(0) {}
+        };
+
     public:
-        TC_Page() : _pShmFlagHead(NULL), _pCenterCache(NULL), _pLarge(NULL), _pFree(NULL), _pSpanMemHead(NULL), _pPageMap(NULL), _pData(NULL) {}
+        TC_Page() : _pShmFlagHead(NULL), _pCenterCache(NULL), _pLarge(NULL), _pFree(NULL), _pSpanMemHead(NULL), _pPageMap(NULL), _pData(NULL), _pSizeMap(Static::sizemap()) {}
+
+        /**
+         * 设置使用的尺寸类别, 默认为Static::sizemap()
+         */
+        void setSizeMap(SizeMap *pSizeMap) { _pSizeMap = pSizeMap; }
 
         /**
          * 初始化
@@ -316,6 +405,29 @@ namespace DCache
          */
         void* getAbsolute(size_t iPageId, size_t iIndex);
 
+        /**
+         * 按尺寸类别统计内存块的使用情况, 结果累加到vtStat中
+         * @param iSparseRatio, 还有空闲内存块且使用率(百分比)低于该值的span计为稀疏span
+         * @param vtStat, 下标为尺寸类别, 大小不足kNumClasses时会扩充
+         * @param iFreePageNum, 累加空闲的页数
+         */
+        void getSizeClassStat(uint32_t iSparseRatio, vector<tagSizeClassStat> &vtStat, size_t &iFreePageNum);
+
+        /**
+         * 页iPageId所属的span是否为稀疏span
+         * @param iPageId, 内存块所属的TC_Span的起始页号
+         * @param iSparseRatio, 使用率阈值(百分比)
+         */
+        bool isSparseSpan(size_t iPageId, uint32_t iSparseRatio);
+
+        /**
+         * 为搬迁页iPageId所属span上的内存块分配一个同类别的内存块
+         * 只从同类别中已分配个数不少于源span的其他span上分配, 不会切分新的页, 找不到时返回NULL
+         * @param iSrcPageId, 被搬迁内存块所属的TC_Span的起始页号
+         * 其余参数同fetchFromSpansSafe
+         */
+        void* fetchForMove(size_t iSrcPageId, size_t &iAllocSize, size_t &iPageId, size_t &iIndex);
+
         /**
          * 修改更新到内存中
          */
@@ -479,6 +591,19 @@ namespace DCache
          */
         void* FetchFromSpans(size_t iClassSize, size_t &iAllocSize, size_t &iPageId, size_t &iIndex);
 
+        /**
+         * 从指定的span上分配一个区块, span必须在iClassSize类别的非空闲链表上
+         */
+        void* FetchFromSpan(TC_Span* span, size_t iClassSize, size_t &iAllocSize, size_t &iPageId, size_t &iIndex);
+
+        /**
+         * span按所属尺寸类别划分后的内存块个数
+         */
+        size_t SpanObjectNum(const TC_Span* span)
+        {
+            return (span->length << kPageShift) / _pSizeMap->ByteSizeForClass(span->sizeclass);
+        }
+
         /**
          * 按iClassSize类别的内存大小分割内存页
          */
@@ -541,17 +666,28 @@ namespace DCache
          * 用于分配TC_Span的内存分配器
          */
         TC_SpanAllocator		  _spanAlloc;
+
+        /**
+         * 尺寸类别
+         */
+        SizeMap                   *_pSizeMap;
     };
 
     ////////////////////////////////////////////////////////////////////////////////////////////////////
     class TC_MallocChunkAllocator
     {
     public:
-        TC_MallocChunkAllocator() :_pHead(NULL), _pChunk(NULL), _nallocator(NULL) {}
+        TC_MallocChunkAllocator() :_pHead(NULL), _pSizeClassHead(NULL), _pChunk(NULL), _nallocator(NULL), _pSizeMap(Static::sizemap()), _pOwnSizeMap(NULL) {}
 
         ~TC_MallocChunkAllocator()
         {
             clear();
+
+            if (_pOwnSizeMap)
+            {
+                delete _pOwnSizeMap;
+                _pOwnSizeMap = NULL;
+            }
         }
 
         void clear()
@@ -575,11 +711,21 @@ namespace DCache
          */
         void create(void *pAddr, size_t iSize, bool bProtectedArea = true);
 
+        /**
+         * 初始化, 头部后面带尺寸类别表, 尺寸类别随内存一起保存, connect时bSizeClassTable要为true
+         * @param pAddr, 地址, 换到应用程序的绝对地址
+         * @param iSize, 内存大小
+         * @param vtClassSize, 尺寸列表, 要求见SizeMap::Init, 为空时使用默认尺寸类别
+         * @param bProtectedArea, 是否使用保护区,默认使用
+         */
+        void create(void *pAddr, size_t iSize, const vector<size_t> &vtClassSize, bool bProtectedArea = true);
+
         /**
          * 连接上
          * @param pAddr, 地址, 换到应用程序的绝对地址
+         * @param bSizeClassTable, 头部后面是否带尺寸类别表
          */
-        void connect(void *pAddr);
+        void connect(void *pAddr, bool bSizeClassTable = false);
 
         /**
          * 扩展空间
@@ -658,11 +804,63 @@ namespace DCache
          */
         void  deallocate(size_t iPageId, size_t iIndex);
 
+        /**
+         * 按尺寸类别统计内存块的使用情况, 包括后续增加的内存块
+         * @param iSparseRatio, 还有空闲内存块且使用率(百分比)低于该值的span计为稀疏span
+         * @param vtStat, 下标为尺寸类别
+         * @param iFreePageNum, 空闲的页数
+         */
+        void getSizeClassStat(uint32_t iSparseRatio, vector<TC_Page::tagSizeClassStat> &vtStat, size_t &iFreePageNum);
+
+        /**
+         * 内存块是否在稀疏span上
+         * @param iPageId, 该内存所属的TC_Span的起始页号
+         * @param iSparseRatio, 使用率阈值(百分比)
+         */
+        bool isSparse(size_t iPageId, uint32_t iSparseRatio);
+
+        /**
+         * 为搬迁内存块分配一个同类别的内存块, 与源内存块在同一块内存分区中
+         * @param iSrcPageId, 被搬迁内存块所属的TC_Span的起始页号
+         * @param iAllocSize, 分配的数据块大小
+         * @param iPageId, 新内存块所属的TC_Span的起始页号
+         * @param iIndex, 新内存块在TC_Span中的序号
+         * @return void*, 没有合适的span时返回NULL
+         */
+        void* allocateForMove(size_t iSrcPageId, size_t &iAllocSize, size_t &iPageId, size_t &iIndex);
+
         /**
          * 重建
          */
         void rebuild();
 
+        /**
+         * 重建并更换尺寸类别, 所有数据都会被清除
+         * @param vtClassSize, 尺寸列表, 为空时使用默认尺寸类别
+         * @return bool, 没有尺寸类别表或者尺寸列表不合法时返回false, 此时不做重建
+         */
+        bool rebuild(const vector<size_t> &vtClassSize);
+
+        /**
+         * 头部后面是否带尺寸类别表
+         */
+        bool hasSizeClassTable() const { return _pSizeClassHead != NULL; }
+
+        /**
+         * 当前使用的尺寸类别
+         */
+        SizeMap* getSizeMap() { return _pSizeMap; }
+
+        /**
+         * 进程启动以来请求分配的尺寸直方图, 下标见SizeMap::HistIndex
+         */
+        const vector<uint64_t>& getSizeHist() const { return _vtSizeHist; }
+
+        /**
+         * 清空尺寸直方图
+         */
+        void resetSizeHist() { _vtSizeHist.clear(); }
+
         /**
          * 修改更新到内存中
          */
@@ -679,20 +877,50 @@ namespace DCache
             size_t _iNext;
         }__attribute__((packed));
 
+        /**
+         * 尺寸类别表, 跟在头部内存块后面, 旧版本创建的内存中没有
+         */
+        struct tagSizeClassHead
+        {
+            uint32_t _iClassNum;                 /*尺寸个数, 0表示使用默认尺寸类别*/
+            uint32_t _iClassSize[kNumClasses];   /*递增的尺寸列表*/
+        }__attribute__((packed));
+
         /**
          * 头部内存块大小
+         * @param bSizeClassTable, 是否带尺寸类别表
          */
-        static size_t getHeadSize() { return sizeof(tagChunkAllocatorHead); }
+        static size_t getHeadSize(bool bSizeClassTable = false) { return sizeof(tagChunkAllocatorHead) + (bSizeClassTable ? sizeof(tagSizeClassHead) : 0); }
 
         /**
          * 传递给此内存分配器的内存块大小要不小于函数的返回值
          */
         static size_t getNeedMinSize() { return sizeof(tagChunkAllocatorHead) + TC_Page::getMinMemSize(); }
     protected:
-        void init(void *pAddr);
+        void init(void *pAddr, bool bSizeClassTable);
 
         TC_MallocChunkAllocator *lastAlloc();
 
+        /**
+         * 从本分配器及后续的分配器中分配, 参数同allocate
+         */
+        void* allocateFromPage(size_t iNeedSize, size_t &iAllocSize, size_t &iPageId, size_t &iIndex);
+
+        /**
+         * 设置本分配器及后续分配器使用的尺寸类别
+         */
+        void setSizeMap(SizeMap *pSizeMap);
+
+        /**
+         * 把尺寸列表写入尺寸类别表
+         */
+        void saveSizeClass(const vector<size_t> &vtClassSize);
+
+        /**
+         * 按尺寸类别表初始化使用的尺寸类别, 没有表或表为空时使用默认尺寸类别
+         */
+        void loadSizeClass();
+
         //禁止copy构造
         TC_MallocChunkAllocator(const TC_MallocChunkAllocator &);
 
@@ -704,6 +932,10 @@ namespace DCache
          * 头指针
          */
         tagChunkAllocatorHead   *_pHead;
+        /**
+         * 尺寸类别表, 没有时为NULL
+         */
+        tagSizeClassHead        *_pSizeClassHead;
         /**
          *  chunk开始的指针
          */
@@ -716,6 +948,18 @@ namespace DCache
          * 后续的多块分配器
          */
         TC_MallocChunkAllocator *_nallocator;
+        /**
+         * 使用的尺寸类别, 后续的分配器与第一个分配器相同
+         */
+        SizeMap                 *_pSizeMap;
+        /**
+         * 按尺寸类别表初始化的尺寸类别
+         */
+        SizeMap                 *_pOwnSizeMap;
+        /**
+         * 请求分配的尺寸直方图, 只在第一个分配器上统计
+         */
+        vector<uint64_t>        _vtSizeHist;
     };
 
 }
@@ -17,6 +17,7 @@
 #include "util/tc_timeprovider.h"
 
 #include "MKCacheUtil.h"
+#include "MKCompactRecord.h"
 
 namespace DCache
 {
@@ -3645,7 +3646,11 @@ namespace DCache
 
 	    tars::TC_PackIn pi;
         pi << uk;		// 数据区只存放uk，不存mk，节省空间
-        pi << v;
+        // 开启紧凑编码时value以紧凑编码存放
+        if (HashMap::CompactRecord::getInstance()->needEncode(v))
+            pi << HashMap::CompactRecord::getInstance()->fromTars(v);
+        else
+            pi << v;
 
         return block.set(pi.topacket().c_str(), pi.topacket().length(), false, iExpireTime, iVersion, vtData);
     }
@@ -3657,7 +3662,11 @@ namespace DCache
 
 	    tars::TC_PackIn pi;
         pi << uk;		// 数据区只存放uk，不存mk，节省空间
-        pi << v;
+        // 开启紧凑编码时value以紧凑编码存放
+        if (HashMap::CompactRecord::getInstance()->needEncode(v))
+            pi << HashMap::CompactRecord::getInstance()->fromTars(v);
+        else
+            pi << v;
 
         return block.set(pi.topacket().c_str(), pi.topacket().length(), false, iExpireTime, iVersion, bCheckExpire, iNowTime, vtData);
     }
@@ -5043,6 +5052,7 @@ namespace DCache
         _pHead->_iMaxBlockCount = 0;
         _pHead->_iMaxLevel = 12;
         _pHead->_iKeyType = _iKeyType;
+        _pHead->_cHashType = _cHashType;
         memset(_pHead->_cReserve, 0, sizeof(_pHead->_cReserve));
 
         _prev = new uint32_t[_pHead->_iMaxLevel];
@@ -5201,6 +5211,11 @@ namespace DCache
             throw TC_Multi_HashMap_Malloc_Exception("[TC_Multi_HashMap_Malloc::connect] keyType not equal:" + tars::TC_Common::tostr(int(_pHead->_iKeyType)) + "!=" + tars::TC_Common::tostr(int(_iKeyType)));
         }
 
+        if (_pHead->_cHashType != _cHashType)
+        {
+            throw TC_Multi_HashMap_Malloc_Exception("[TC_Multi_HashMap_Malloc::connect] hash map HashType not equal:" + tars::TC_Common::tostr(int(_pHead->_cHashType)) + "!=" + tars::TC_Common::tostr(int(_cHashType)) + " (data != code)");
+        }
+
         _pstCurrModify = _pstOuterModify;
 
         _iMainKeySize = _pHead->_iMainKeySize;
@@ -5274,6 +5289,11 @@ namespace DCache
             throw TC_Multi_HashMap_Malloc_Exception("[TC_Multi_HashMap_Malloc::append] hash map MinChunkSize not equal:" + tars::TC_Common::tostr(_pHead->_iMinChunkSize) + "!=" + tars::TC_Common::tostr(_iMinChunkSize) + " (data != code)");
         }
 
+        if (_pHead->_cHashType != _cHashType)
+        {
+            throw TC_Multi_HashMap_Malloc_Exception("[TC_Multi_HashMap_Malloc::append] hash map HashType not equal:" + tars::TC_Common::tostr(int(_pHead->_cHashType)) + "!=" + tars::TC_Common::tostr(int(_cHashType)) + " (data != code)");
+        }
+
         _pstCurrModify = _pstOuterModify;
 
         _iMainKeySize = _pHead->_iMainKeySize;
@@ -5421,6 +5441,13 @@ namespace DCache
                     delete[] pBuffer;
                     return RT_VERSION_MISMATCH_ERR;
                 }
+
+                // hash类型不同，数据所在的hash桶不对
+                if (((tagMapHead*)pBuffer)->_cHashType != _cHashType)
+                {
+                    delete[] pBuffer;
+                    return RT_VERSION_MISMATCH_ERR;
+                }
             }
 
             memcpy((char*)_pHead + iLen, pBuffer, ret);
@@ -6059,6 +6086,70 @@ namespace DCache
         return RT_OK;
     }
 
+    uint32_t TC_Multi_HashMap_Malloc::seekZSetByRank(MainKey &mainKey, uint64_t iRank, uint64_t &iPassed)
+    {
+        iPassed = 0;
+
+        Node *curr = &mainKey;
+        Block currBlock(this, mainKey.getNext(0));
+
+        for (int level = mainKey.getLevel() - 1; level >= 0; level--)
+        {
+            //标记删除的数据不占跨度，跳过的节点都排在iRank之前
+            while (curr->getNext(level) != 0 && iPassed + curr->getSpan(level) <= iRank)
+            {
+                iPassed += curr->getSpan(level);
+                Block nextBlock(this, curr->getNext(level));
+                currBlock = nextBlock;
+                curr = &currBlock;
+            }
+        }
+
+        return curr->getNext(0);
+    }
+
+    uint32_t TC_Multi_HashMap_Malloc::seekZSetByScore(MainKey &mainKey, double iMin)
+    {
+        Node *curr = &mainKey;
+        Block currBlock(this, mainKey.getNext(0));
+
+        for (int level = mainKey.getLevel() - 1; level >= 0; level--)
+        {
+            while (curr->getNext(level) != 0)
+            {
+                Block nextBlock(this, curr->getNext(level));
+                if (nextBlock.getScore() >= iMin)
+                    break;
+
+                currBlock = nextBlock;
+                curr = &currBlock;
+            }
+        }
+
+        return curr->getNext(0);
+    }
+
+    uint64_t TC_Multi_HashMap_Malloc::getZSetLiveCount(MainKey &mainKey)
+    {
+        uint64_t iCount = 0;
+
+        Node *curr = &mainKey;
+        Block currBlock(this, mainKey.getNext(0));
+
+        for (int level = mainKey.getLevel() - 1; level >= 0; level--)
+        {
+            while (curr->getNext(level) != 0)
+            {
+                iCount += curr->getSpan(level);
+                Block nextBlock(this, curr->getNext(level));
+                currBlock = nextBlock;
+                curr = &currBlock;
+            }
+        }
+
+        return iCount;
+    }
+
     int TC_Multi_HashMap_Malloc::delSkipListSpan(MainKey &mainKey, uint32_t blockAddr)
     {
         //_pstCurrModify = _pstInnerModify;
@@ -8271,6 +8362,130 @@ namespace DCache
         return TC_Multi_HashMap_Malloc::RT_NO_DATA;
     }
 
+    int TC_Multi_HashMap_Malloc::getForRestore(const string &mk, const string &uk, Value &v)
+    {
+        TC_Multi_HashMap_Malloc::FailureRecover recover(this);
+        MainKey::KEYTYPE keyType = (MainKey::KEYTYPE)(_pHead->_iKeyType);
+        if (MainKey::HASH_TYPE != keyType)
+            return TC_Multi_HashMap_Malloc::RT_EXCEPTION_ERR;
+
+        int ret = RT_OK;
+        lock_iterator it = find(mk, uk, hashIndex(mk, uk), v, ret);
+        if (ret != TC_Multi_HashMap_Malloc::RT_OK && ret != TC_Multi_HashMap_Malloc::RT_ONLY_KEY)
+        {
+            return ret;
+        }
+
+        if (it == end())
+        {
+            return TC_Multi_HashMap_Malloc::RT_NO_DATA;
+        }
+
+        // 只有key的记录不会填充头部信息，统一从block头读取
+        Block block(this, it->getAddr());
+        v._mkey = mk;
+        v._ukey = uk;
+        v._isDelete = block.isDelete() ? DELETE_TRUE : DELETE_FALSE;
+        v._dirty = block.isDirty();
+        v._iVersion = block.getVersion();
+        v._iSyncTime = block.getSyncTime();
+        v._iExpireTime = block.getExpireTime();
+
+        return block.isOnlyKey() ? TC_Multi_HashMap_Malloc::RT_ONLY_KEY : TC_Multi_HashMap_Malloc::RT_OK;
+    }
+
+    int TC_Multi_HashMap_Malloc::restore(const string &mk, const string &uk, int iState, const Value &v, bool bEraseMainKey, vector<Value> &vtData)
+    {
+        {
+            TC_Multi_HashMap_Malloc::FailureRecover recover(this);
+            MainKey::KEYTYPE keyType = (MainKey::KEYTYPE)(_pHead->_iKeyType);
+            if (MainKey::HASH_TYPE != keyType)
+                return TC_Multi_HashMap_Malloc::RT_EXCEPTION_ERR;
+
+            if (_pHead->_bReadOnly) return RT_READONLY;
+
+            int ret = RT_OK;
+            lock_iterator it = find(mk, uk, hashIndex(mk, uk), ret);
+            if (ret != TC_Multi_HashMap_Malloc::RT_OK && ret != TC_Multi_HashMap_Malloc::RT_ONLY_KEY)
+            {
+                return ret;
+            }
+
+            if (iState == TC_Multi_HashMap_Malloc::RT_NO_DATA)
+            {
+                // 原来没有该记录，不论当前记录是否标记删除都直接删除
+                if (it == end())
+                {
+                    return TC_Multi_HashMap_Malloc::RT_OK;
+                }
+
+                Block block(this, it->getAddr());
+                MainKey mainKey(this, block.getBlockHead()->_iMainKey);
+                if (block.isDelete())
+                {
+                    // 把主key下数据个数增加一个，因为后面的block.erase()会把这个计数减一
+                    saveValue(&mainKey.getHeadPtr()->_iBlockCount, mainKey.getHeadPtr()->_iBlockCount + 1);
+                }
+                block.erase(false);
+
+                if (bEraseMainKey && mainKey.getHeadPtr()->_iBlockHead == 0)
+                {
+                    mainKey.erase(vtData);
+                }
+                return TC_Multi_HashMap_Malloc::RT_OK;
+            }
+
+            if (it != end())
+            {
+                Block block(this, it->getAddr());
+                if (iState == TC_Multi_HashMap_Malloc::RT_ONLY_KEY)
+                {
+                    ret = it->set(mk, uk, vtData);
+                    if (ret != TC_Multi_HashMap_Malloc::RT_OK)
+                    {
+                        return ret;
+                    }
+                    block.setDirty(v._dirty);
+                    block.setDelete(v._isDelete == DELETE_TRUE);
+                    saveValue(&block.getBlockHead()->_iVersion, v._iVersion);
+                    saveValue(&block.getBlockHead()->_iSyncTime, v._iSyncTime);
+                    saveValue(&block.getBlockHead()->_iExpireTime, v._iExpireTime);
+                    return TC_Multi_HashMap_Malloc::RT_OK;
+                }
+
+                // 先清除删除标记，否则set会把记录当作新插入的重新排序
+                block.setDelete(false);
+            }
+        }
+
+        int ret;
+        if (iState == TC_Multi_HashMap_Malloc::RT_ONLY_KEY)
+        {
+            ret = set(mk, uk, AUTO_DATA, true, false, v._isDelete, vtData);
+            return ret == RT_DATA_EXIST ? TC_Multi_HashMap_Malloc::RT_OK : ret;
+        }
+
+        ret = set(mk, uk, _hashf(mk + uk), v._value, v._iExpireTime, 0, v._dirty, AUTO_DATA, true, false, v._isDelete, vtData);
+        if (ret != TC_Multi_HashMap_Malloc::RT_OK)
+        {
+            return ret;
+        }
+
+        // set会递增版本号，过期时间为0时也不会覆盖，这里恢复为原值
+        TC_Multi_HashMap_Malloc::FailureRecover recover(this);
+        lock_iterator it = find(mk, uk, hashIndex(mk, uk), ret);
+        if (it == end())
+        {
+            return TC_Multi_HashMap_Malloc::RT_NO_DATA;
+        }
+        Block block(this, it->getAddr());
+        saveValue(&block.getBlockHead()->_iVersion, v._iVersion);
+        saveValue(&block.getBlockHead()->_iSyncTime, v._iSyncTime);
+        saveValue(&block.getBlockHead()->_iExpireTime, v._iExpireTime);
+
+        return TC_Multi_HashMap_Malloc::RT_OK;
+    }
+
     int TC_Multi_HashMap_Malloc::del(const string &mk, const string &uk, Value &data)
     {
         TC_Multi_HashMap_Malloc::FailureRecover recover(this);
@@ -9959,6 +10174,12 @@ namespace DCache
 
         uint64_t iIndex = 0;
 
+        //不检查过期时跨度与遍历计数一致，可直接按排名定位起始位置；检查过期时已过期的数据不占排名，只能从头逐个遍历
+        if (iNowTime == 0 && iStart > 0)
+        {
+            iAddr = seekZSetByRank(mainKey, iStart, iIndex);
+        }
+
         while (iAddr != 0 && iIndex <= iEnd)
         {
             Block block(this, iAddr);
@@ -10111,6 +10332,12 @@ namespace DCache
         uint64_t iRealDataCount = 0;
         uint64_t iIndex = 0;
 
+        //不检查过期时跨度与遍历计数一致，可直接按排名定位起始位置；检查过期时已过期的数据不占排名，只能从头逐个遍历
+        if (iNowTime == 0 && iStart > 0)
+        {
+            iAddr = seekZSetByRank(mainKey, iStart, iIndex);
+        }
+
         while (iAddr != 0 && iRealDataCount < iDataCount)
         {
             Block block(this, iAddr);
@@ -10307,7 +10534,8 @@ namespace DCache
                         iPos--;
                         if (!order)
                         {
-                            iPos = mainKey.getHeadPtr()->_iBlockCount - iPos - 1;
+                            //_iBlockCount包含标记删除的数据，倒序排名按跨度统计的个数计算
+                            iPos = getZSetLiveCount(mainKey) - iPos - 1;
                         }
                         return TC_Multi_HashMap_Malloc::RT_OK;
                     }
@@ -10338,7 +10566,7 @@ namespace DCache
                                 iPos--;
                                 if (!order)
                                 {
-                                    iPos = mainKey.getHeadPtr()->_iBlockCount - iPos - 1;
+                                    iPos = getZSetLiveCount(mainKey) - iPos - 1;
                                 }
                                 return TC_Multi_HashMap_Malloc::RT_OK;
                             }
@@ -10391,50 +10619,15 @@ namespace DCache
         }
 
         //先定位第一个数据
-        int ilevel = mainKey.getLevel() - 1;
-        uint32_t iAddr = 0;
-        for (; ilevel > 0; ilevel--)
-        {
-            iAddr = mainKey.getNext(ilevel);
-            if (iAddr == 0)
-                continue;
-            else
-            {
-                Block block(this, iAddr);
-                double score = block.getScore();
-                if (score < iMin)
-                    break;
-                else
-                    continue;
-            }
-        }
-
-        iAddr = mainKey.getNext(ilevel);
-
-        for (; iAddr != 0 && ilevel > 0; ilevel--)
-        {
-            Block block(this, iAddr);
-            double score = block.getScore();
-            uint32_t nextAddr = block.getNext(ilevel);
-
-            while (nextAddr != 0)
-            {
-                Block nextBlock(this, nextAddr);
-                score = nextBlock.getScore();
-                if (score < iMin)
-                {
-                    iAddr = nextAddr;
-                    nextAddr = nextBlock.getNext(ilevel);
-                }
-                else
-                    break;
-            }
-        }
-
+        uint32_t iAddr = seekZSetByScore(mainKey, iMin);
 
         while (iAddr != 0)
         {
             Block block(this, iAddr);
+            //按分值有序，超出范围即可结束
+            if (block.getScore() > iMax)
+                break;
+
             if (block.isDelete() == false && (iNowTime == 0 || block.getBlockHead()->_iExpireTime == 0 || (iNowTime != 0 && block.getBlockHead()->_iExpireTime > iNowTime)))
             {
                 double score = block.getScore();
@@ -10557,12 +10750,15 @@ namespace DCache
         {
             return RT_ONLY_KEY;
         }
-        uint32_t iAddr = mainKey.getNext(0);
+        uint32_t iAddr = seekZSetByScore(mainKey, iMin);
 
         while (iAddr != 0)
         {
             Block block(this, iAddr);
             uint32_t nextAddr = block.getNext(0);
+            if (block.getScore() > iMax)
+                break;
+
             if (iNowTime == 0 || block.getBlockHead()->_iExpireTime == 0 || (iNowTime != 0 && block.getBlockHead()->_iExpireTime > iNowTime))
             {
                 double score = block.getScore();
@@ -11288,6 +11484,7 @@ namespace DCache
             s << "[HashCount        = " << _hash.size() << "]" << endl;
             s << "[MainKeyRatio     = " << _pHead->_fMainKeyRatio << "]" << endl;
             s << "[HashRatio        = " << _pHead->_fHashRatio << "]" << endl;
+            s << "[HashType         = " << int(_pHead->_cHashType) << "]" << endl;
             s << "[MainKeyCount     = " << _pHead->_iMainKeyCount << "]" << endl;
             s << "[ElementCount     = " << _pHead->_iElementCount << "]" << endl;
             s << "[SetHead          = " << _pHead->_iSetHead << "]" << endl;
@@ -11358,6 +11555,7 @@ namespace DCache
             s << "[HashCount        = " << _hash.size() << "]" << endl;
             s << "[MainKeyRatio     = " << _pHead->_fMainKeyRatio << "]" << endl;
             s << "[HashRatio        = " << _pHead->_fHashRatio << "]" << endl;
+            s << "[HashType         = " << int(_pHead->_cHashType) << "]" << endl;
             s << "[MainKeyCount     = " << _pHead->_iMainKeyCount << "]" << endl;
             s << "[ElementCount     = " << _pHead->_iElementCount << "]" << endl;
             s << "[SetHead          = " << _pHead->_iSetHead << "]" << endl;
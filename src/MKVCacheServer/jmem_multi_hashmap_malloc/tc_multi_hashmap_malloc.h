@@ -2312,7 +2312,8 @@ namespace DCache
             bool		_bInit;				 //是否已经完成初始化
             uint8_t     _iKeyType;           //主key类型
             uint8_t     _iMaxLevel;          //用于zset结构的最大层数
-            char		_cReserve[30];       //保留
+            char		_cHashType;			 //key的hash类型，见HashType，旧数据为0
+            char		_cReserve[29];       //保留
         }__attribute__((packed));
 
         /**
@@ -2438,6 +2439,7 @@ namespace DCache
             , _iDataSize(0)
             , _fHashRatio(2.0)
             , _fMainKeyRatio(1.0)
+            , _cHashType(0)
             , _pMainKeyAllocator(NULL)
             , _pDataAllocator(new BlockAllocator(this))
             , _lock_end(this, 0, 0, 0)
@@ -2477,6 +2479,14 @@ namespace DCache
          */
         void initMainKeyHashRatio(float fRatio) { _fMainKeyRatio = fRatio; }
 
+        /**
+         * 设置key的hash类型，create时写入头部，connect时校验，
+         * 必须在create/connect之前调用，且与setHashFunctor/setHashFunctorM设置的hash一致
+         *
+         * @param cHashType
+         */
+        void initHashType(char cHashType) { _cHashType = cHashType; }
+
         /**
          * 初始化, 之前需要调用:initDataAvgSize和initHashRatio
          * @param pAddr 外部分配好的存储的绝对地址
@@ -2683,6 +2693,25 @@ namespace DCache
          */
         tagHashItem *item(size_t iIndex) { return &_hash[iIndex]; }
 
+        /**
+         * 预取(主key+联合key)所在的hash桶，批量读时提前几个key调用
+         * @param unHash, 主key加联合key的哈希值
+         */
+        void prefetchHash(uint32_t unHash) { __builtin_prefetch(item(unHash % _hash.size())); }
+
+        /**
+         * 预取hash桶上第一个数据块的头部，须在该桶的prefetchHash之后调用
+         * @param unHash, 主key加联合key的哈希值
+         */
+        void prefetchBlock(uint32_t unHash)
+        {
+            uint32_t iAddr = item(unHash % _hash.size())->_iBlockAddr;
+            if (iAddr != 0)
+            {
+                __builtin_prefetch(getAbsolute(iAddr));
+            }
+        }
+
         /**
         * 根据主key hash索引取主key item
         * @param iIndex, 主key的hash索引
@@ -3163,6 +3192,35 @@ namespace DCache
          */
         int delForce(const string &mk, vector<Value> &data);
 
+        /**
+         * 获取记录的完整状态，用于批量操作失败后恢复，不检查过期、不刷新get链
+         * @param mk: 主key
+         * @param uk: 除主key外的联合主键
+         * @param v: 记录的数据及删除标记、脏标记、版本号、回写时间和过期时间
+         * @return int:
+         *          RT_OK: cache中有该记录(包括已标记删除和已过期的记录)
+         *          RT_ONLY_KEY: cache中是只有key的记录
+         *          RT_NO_DATA: cache中没有该记录
+         *          其他返回值: 错误
+         */
+        int getForRestore(const string &mk, const string &uk, Value &v);
+
+        /**
+         * 把记录恢复为getForRestore取得的状态，版本号、回写时间和过期时间同样恢复，不按更新重新排序
+         * @param mk: 主key
+         * @param uk: 除主key外的联合主键
+         * @param iState: getForRestore的返回值，RT_NO_DATA时删除该记录
+         * @param v: getForRestore取得的记录
+         * @param bEraseMainKey: 主key原来不存在，删除记录后主key下没有数据时一并删除主key
+         * @param vtData: 被淘汰的记录
+         * @return int:
+         *          RT_READONLY: map只读
+         *          RT_NO_MEMORY: 没有空间
+         *          RT_OK: 恢复成功
+         *          其他返回值: 错误
+         */
+        int restore(const string &mk, const string &uk, int iState, const Value &v, bool bEraseMainKey, vector<Value> &vtData);
+
         /**
         * 删除主key下指定范围的数据
         * @param mk: 主key
@@ -3784,6 +3842,26 @@ namespace DCache
 
         int delSkipListSpan(MainKey &mainKey, uint32_t blockAddr);
 
+        /**
+         * 按排名定位zset数据，跨度(span)只统计未标记删除的数据，定位代价为O(log n)
+         * @param mainKey, 主key
+         * @param iRank, 排名(从0开始)
+         * @param iPassed, 返回地址之前未标记删除的数据个数
+         * @return uint32_t, 从该地址开始顺序遍历，0表示没有数据
+         */
+        uint32_t seekZSetByRank(MainKey &mainKey, uint64_t iRank, uint64_t &iPassed);
+
+        /**
+         * 定位zset中第一个分值不小于iMin的数据
+         * @return uint32_t, 数据地址，0表示没有数据
+         */
+        uint32_t seekZSetByScore(MainKey &mainKey, double iMin);
+
+        /**
+         * 通过跨度统计zset中未标记删除的数据个数，代价为O(log n)
+         */
+        uint64_t getZSetLiveCount(MainKey &mainKey);
+
         /**
          * 增加hit次数
          */
@@ -4086,6 +4164,11 @@ namespace DCache
         */
         float						_fMainKeyRatio;
 
+        /**
+         * key的hash类型
+         */
+        char						_cHashType;
+
         /**
          * 联合主键hash索引区
          */
@@ -11,26 +11,24 @@
 * either express or implied. See the License for the specific language governing permissions
 * and limitations under the License.
 */
+#include "MKCacheServer.h"
 
-#ifndef _MKHASH_H
-#define _MKHASH_H
+extern MKCacheServer g_app;
 
-#include <string>
-
-using namespace std;
-
-class MKHash// : public NormalHash
+int main(int argc, char *argv[])
 {
-public:
-
-    MKHash() {};
-    virtual ~MKHash() {};
-
-    virtual unsigned int HashRawString(const string &key);
-    virtual unsigned int HashMK(const string &key);
-    virtual unsigned int HashMKUK(const string &key);
-private:
-
-};
-
-#endif
+    try
+    {
+        g_app.main(argc, argv);
+        g_app.waitForShutdown();
+    }
+    catch (std::exception &e)
+    {
+        cerr << "std::exception:" << e.what() << std::endl;
+    }
+    catch (...)
+    {
+        cerr << "unknown exception." << std::endl;
+    }
+    return -1;
+}
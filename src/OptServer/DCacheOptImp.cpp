@@ -25,6 +25,7 @@
 #include "Assistance.h"
 #include "ReleaseThread.h"
 #include "UninstallThread.h"
+#include "HashFactory.h"
 
 using namespace std;
 
@@ -777,7 +778,7 @@ tars::Int32 DCacheOptImp::installKVCacheModule(const InstallKVCacheReq & kvCache
             return -1;
         }
 
-        if (insertCache2RouterDb(kvCacheReq.moduleName, "", routerDbInfo, vtCacheHost, kvCacheReq.replace, err) != 0)
+        if (insertCache2RouterDb(kvCacheReq.moduleName, "", routerDbInfo, vtCacheHost, kvCacheReq.replace, kvCacheReq.hashType, err) != 0)
         {
             if (err.empty())
             {
@@ -886,7 +887,7 @@ tars::Int32 DCacheOptImp::installMKVCacheModule(const InstallMKVCacheReq & mkvCa
             return -1;
         }
 
-        if (insertCache2RouterDb(mkvCacheReq.moduleName, "", routerDbInfo, vtCacheHost, mkvCacheReq.replace, err) != 0)
+        if (insertCache2RouterDb(mkvCacheReq.moduleName, "", routerDbInfo, vtCacheHost, mkvCacheReq.replace, mkvCacheReq.hashType, err) != 0)
         {
             if (err.empty())
             {
@@ -3284,6 +3285,7 @@ int DCacheOptImp::createRouterDB(const RouterParam &param, string &errmsg)
                                 "`POSTTIME` datetime default NULL," +
                                 "`LASTUSER` varchar(60) default NULL," +
                                 "`switch_status` int(11) default '0'," +
+                                "`hash_type` int(11) NOT NULL default '0'," +
                                 "PRIMARY KEY  (`id`)," +
                                 "UNIQUE KEY `module_name` (`module_name`)" +
                                 ") ENGINE=MyISAM DEFAULT CHARSET=utf8";
@@ -4072,9 +4074,16 @@ void DCacheOptImp::insertConfigItem2Vector(const string& sItem, const string &sP
     vtConfig.push_back(mMap);
 }
 
-int DCacheOptImp::insertCache2RouterDb(const string& sModuleName, const string &sRemark, const TC_DBConf &routerDbInfo, const vector<DCache::CacheHostParam> & vtCacheHost, bool bReplace, string& errmsg)
+int DCacheOptImp::insertCache2RouterDb(const string& sModuleName, const string &sRemark, const TC_DBConf &routerDbInfo, const vector<DCache::CacheHostParam> & vtCacheHost, bool bReplace, int iHashType, string& errmsg)
 {
-    TLOGDEBUG(FUN_LOG << "insert module name and cache server info to router db table|module name:" << sModuleName << endl);
+    TLOGDEBUG(FUN_LOG << "insert module name and cache server info to router db table|module name:" << sModuleName << "|hash type:" << iHashType << endl);
+
+    if (!HashFactory::isValidHashType(iHashType))
+    {
+        errmsg = "invalid hash type:" + TC_Common::tostr(iHashType);
+        TLOGERROR(FUN_LOG << errmsg << endl);
+        return -1;
+    }
 
     TC_Mysql tcMysql;
     try
@@ -4089,6 +4098,11 @@ int DCacheOptImp::insertCache2RouterDb(const string& sModuleName, const string &
             mpModule["remark"]      = make_pair(TC_Mysql::DB_STR, sRemark);
             mpModule["POSTTIME"]    = make_pair(TC_Mysql::DB_STR, TC_Common::now2str("%Y-%m-%d %H:%M:%S"));
             mpModule["LASTUSER"]    = make_pair(TC_Mysql::DB_STR, "sys");
+            // 旧的router db没有hash_type字段，默认hash时不写入
+            if (iHashType != HASH_TYPE_NORMAL)
+            {
+                mpModule["hash_type"] = make_pair(TC_Mysql::DB_INT, TC_Common::tostr(iHashType));
+            }
 
             if (bReplace)
                 tcMysql.replaceRecord("t_router_module", mpModule);
@@ -275,7 +275,7 @@ private:
     /**
     * 生成cache在router表的记录
     */
-    int insertCache2RouterDb(const string& sModuleName, const string &sRemark, const TC_DBConf &routerDbInfo, const vector<DCache::CacheHostParam> & vtCacheHost, bool bReplace, string& errmsg);
+    int insertCache2RouterDb(const string& sModuleName, const string &sRemark, const TC_DBConf &routerDbInfo, const vector<DCache::CacheHostParam> & vtCacheHost, bool bReplace, int iHashType, string& errmsg);
 
     /**
     * 保存cache信息到tars db
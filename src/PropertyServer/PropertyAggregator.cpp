@@ -0,0 +1,264 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <algorithm>
+#include "util/tc_hash_fun.h"
+#include "PropertyAggregator.h"
+
+void PropertyAggregator::Accumulator::init(const DCache::StatPropInfo &info)
+{
+    policy = info.policy;
+    raw = info.value;
+    merged = false;
+
+    if (policy == "Count")
+    {
+        type = POLICY_COUNT;
+    }
+    else if (policy == "Sum")
+    {
+        type = POLICY_SUM;
+    }
+    else if (policy == "Min")
+    {
+        type = POLICY_MIN;
+    }
+    else if (policy == "Max")
+    {
+        type = POLICY_MAX;
+    }
+    else if (policy == "Avg")
+    {
+        type = POLICY_AVG;
+    }
+    else if (policy == "Distr")
+    {
+        type = POLICY_DISTR;
+    }
+    else
+    {
+        type = POLICY_OTHER;
+    }
+
+    switch (type)
+    {
+    case POLICY_COUNT:
+    case POLICY_SUM:
+    case POLICY_MIN:
+    case POLICY_MAX:
+        llValue = TC_Common::strto<long long>(raw);
+        break;
+    case POLICY_AVG:
+    {
+        vector<string> vTmp = TC_Common::sepstr<string>(raw, "=");
+        avgSum = vTmp.empty() ? 0 : TC_Common::strto<double>(vTmp[0]);
+        avgCount = (2 == vTmp.size()) ? TC_Common::strto<long>(vTmp[1]) : 1;
+        break;
+    }
+    case POLICY_DISTR:
+    {
+        distrBounds.clear();
+        distrCounts.clear();
+        vector<string> vFields = TC_Common::sepstr<string>(raw, ",");
+        for (size_t i = 0; i < vFields.size(); ++i)
+        {
+            vector<string> vTmp = TC_Common::sepstr<string>(vFields[i], "|");
+            distrBounds.push_back(vTmp.empty() ? "" : vTmp[0]);
+            distrCounts.push_back(vTmp.size() < 2 ? 0 : TC_Common::strto<long long>(vTmp[1]));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void PropertyAggregator::Accumulator::merge(const string &value)
+{
+    switch (type)
+    {
+    case POLICY_COUNT:
+    case POLICY_SUM:
+        llValue += TC_Common::strto<long long>(value);
+        break;
+    case POLICY_MIN:
+        llValue = std::min(llValue, TC_Common::strto<long long>(value));
+        break;
+    case POLICY_MAX:
+        llValue = std::max(llValue, TC_Common::strto<long long>(value));
+        break;
+    case POLICY_AVG:
+    {
+        vector<string> vTmp = TC_Common::sepstr<string>(value, "=");
+        if (vTmp.empty())
+        {
+            return;
+        }
+        avgSum += TC_Common::strto<double>(vTmp[0]);
+        avgCount += (2 == vTmp.size()) ? TC_Common::strto<long>(vTmp[1]) : 1;
+        break;
+    }
+    case POLICY_DISTR:
+    {
+        vector<string> vFields = TC_Common::sepstr<string>(value, ",");
+        for (size_t i = 0; i < vFields.size() && i < distrCounts.size(); ++i)
+        {
+            string::size_type pos = vFields[i].find('|');
+            if (pos != string::npos)
+            {
+                distrCounts[i] += TC_Common::strto<long long>(vFields[i].substr(pos + 1));
+            }
+        }
+        break;
+    }
+    default:
+        // 未知的policy保留第一次上报的值
+        return;
+    }
+
+    merged = true;
+}
+
+void PropertyAggregator::Accumulator::toInfo(DCache::StatPropInfo &info) const
+{
+    info.policy = policy;
+    if (!merged)
+    {
+        info.value = raw;
+        return;
+    }
+
+    switch (type)
+    {
+    case POLICY_COUNT:
+    case POLICY_SUM:
+    case POLICY_MIN:
+    case POLICY_MAX:
+        info.value = TC_Common::tostr(llValue);
+        break;
+    case POLICY_AVG:
+        info.value = TC_Common::tostr(avgSum) + "=" + TC_Common::tostr(avgCount);
+        break;
+    case POLICY_DISTR:
+    {
+        info.value.clear();
+        for (size_t i = 0; i < distrBounds.size(); ++i)
+        {
+            if (i != 0)
+            {
+                info.value += ",";
+            }
+            info.value += distrBounds[i] + "|" + TC_Common::tostr(distrCounts[i]);
+        }
+        break;
+    }
+    default:
+        info.value = raw;
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////
+//
+PropertyAggregator::PropertyAggregator()
+{
+    init(1);
+}
+
+PropertyAggregator::~PropertyAggregator()
+{
+    for (size_t i = 0; i < _shards.size(); ++i)
+    {
+        delete _shards[i];
+    }
+    _shards.clear();
+}
+
+void PropertyAggregator::init(size_t shardNum)
+{
+    shardNum = shardNum > 0 ? shardNum : 1;
+
+    for (size_t i = 0; i < _shards.size(); ++i)
+    {
+        delete _shards[i];
+    }
+    _shards.clear();
+
+    for (size_t i = 0; i < shardNum; ++i)
+    {
+        _shards.push_back(new Shard());
+    }
+}
+
+size_t PropertyAggregator::shardIndex(const PropKey &key) const
+{
+    size_t h = tars::hash_new<string>()(key.moduleName) ^ (tars::hash_new<string>()(key.ip) << 1);
+    return h % _shards.size();
+}
+
+void PropertyAggregator::add(const PropHead &head, const DCache::StatPropInfo &info)
+{
+    PropKey key;
+    key.moduleName = head.moduleName;
+    key.setName    = head.setName;
+    key.setArea    = head.setArea;
+    key.setID      = head.setID;
+    key.ip         = head.ip;
+
+    Shard *shard = _shards[shardIndex(key)];
+
+    TC_LockT<TC_ThreadMutex> lock(shard->lock);
+
+    AccumulatorMap &props = shard->data[key];
+    AccumulatorMap::iterator it = props.find(head.propertyName);
+    if (it == props.end())
+    {
+        props[head.propertyName].init(info);
+    }
+    else
+    {
+        it->second.merge(info.value);
+    }
+}
+
+size_t PropertyAggregator::flush(PropertyHashMap &hashMap)
+{
+    size_t iCount = 0;
+    for (size_t i = 0; i < _shards.size(); ++i)
+    {
+        // 只在交换时持有分片锁，合并到hashmap时不阻塞上报
+        map<PropKey, AccumulatorMap> data;
+        {
+            TC_LockT<TC_ThreadMutex> lock(_shards[i]->lock);
+            data.swap(_shards[i]->data);
+        }
+
+        for (map<PropKey, AccumulatorMap>::const_iterator it = data.begin(); it != data.end(); ++it)
+        {
+            PropValue value;
+            for (AccumulatorMap::const_iterator itProp = it->second.begin(); itProp != it->second.end(); ++itProp)
+            {
+                itProp->second.toInfo(value.statInfo[itProp->first]);
+            }
+
+            int iRet = hashMap.merge(it->first, value);
+            if (iRet != TC_HashMap::RT_OK)
+            {
+                TLOGERROR("PropertyAggregator::flush merge hashmap record return:" << iRet << endl);
+            }
+            ++iCount;
+        }
+    }
+
+    return iCount;
+}
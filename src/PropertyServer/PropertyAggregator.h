@@ -0,0 +1,107 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __PROPERTY_AGGREGATOR_H_
+#define __PROPERTY_AGGREGATOR_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "util/tc_monitor.h"
+#include "servant/Application.h"
+#include "Property.h"
+#include "PropertyHashMap.h"
+
+using namespace tars;
+using namespace std;
+
+/**
+ * 特性上报的内存预聚合。
+ * 按StatPropMsgKey散列到多个分片，每个分片一把锁，上报线程只在所属分片内用数值累加，
+ * 不需要编解码，也不会争抢PropertyHashMap的全局锁。
+ * 由后台线程定期将聚合结果合并到PropertyHashMap。
+ */
+class PropertyAggregator
+{
+public:
+    // 单个特性的累加器，合并规则与PropertyHashMap::mergeInfo一致
+    struct Accumulator
+    {
+        Accumulator() : type(POLICY_OTHER), merged(false), llValue(0), avgSum(0), avgCount(0) {}
+
+        void init(const DCache::StatPropInfo &info);
+
+        void merge(const string &value);
+
+        void toInfo(DCache::StatPropInfo &info) const;
+
+        int type;
+        string policy;
+        bool merged;                // 是否合并过，只有一次上报时原样输出
+        string raw;                 // 第一次上报的原始值
+        long long llValue;          // Count/Sum/Min/Max
+        double avgSum;              // Avg的总值
+        long avgCount;              // Avg的记录数
+        vector<string> distrBounds; // Distr的区间
+        vector<long long> distrCounts;
+    };
+
+    typedef map<string, Accumulator> AccumulatorMap;
+
+    PropertyAggregator();
+
+    ~PropertyAggregator();
+
+    /**
+     * 设置分片数，只能在上报开始前调用
+     */
+    void init(size_t shardNum);
+
+    /**
+     * 累加一条上报
+     */
+    void add(const PropHead &head, const DCache::StatPropInfo &info);
+
+    /**
+     * 将所有分片的聚合结果合并到hashmap并清空
+     * @return size_t, 合并的记录数
+     */
+    size_t flush(PropertyHashMap &hashMap);
+
+    size_t getShardNum() const { return _shards.size(); }
+
+private:
+    enum
+    {
+        POLICY_OTHER = 0,
+        POLICY_COUNT,
+        POLICY_SUM,
+        POLICY_MIN,
+        POLICY_MAX,
+        POLICY_AVG,
+        POLICY_DISTR,
+    };
+
+    struct Shard
+    {
+        TC_ThreadMutex lock;
+        map<PropKey, AccumulatorMap> data;
+    };
+
+    size_t shardIndex(const PropKey &key) const;
+
+private:
+    vector<Shard *> _shards;
+};
+
+#endif
@@ -0,0 +1,114 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "PropertyFlushThread.h"
+#include "PropertyServer.h"
+
+PropertyFlushThread::~PropertyFlushThread()
+{
+    if (isAlive())
+    {
+        terminate();
+
+        getThreadControl().join();
+    }
+}
+
+void PropertyFlushThread::terminate()
+{
+    TLOGDEBUG("PropertyFlushThread::terminate");
+
+    _terminate = true;
+
+    TC_ThreadLock::Lock lock(*this);
+
+    notifyAll();
+}
+
+void PropertyFlushThread::run()
+{
+    TLOGDEBUG("PropertyFlushThread::run once in " << _flushInterval << " ms" << endl);
+
+    while (!_terminate)
+    {
+        {
+            TC_ThreadLock::Lock lock(*this);
+            timedWait(_flushInterval);
+        }
+
+        try
+        {
+            flush();
+
+            dump2file();
+        }
+        catch (exception &ex)
+        {
+            TLOGERROR("PropertyFlushThread::run exception:" << ex.what() << endl);
+        }
+        catch (...)
+        {
+            TLOGERROR("PropertyFlushThread::run unkown exception" << endl);
+        }
+    }
+
+    // 退出前将剩余的数据合并到hashmap，hashmap是文件存储，重启后不会丢失
+    flush();
+}
+
+void PropertyFlushThread::flush()
+{
+    PropertyHashMap &propHashMap = g_app.getHashMap();
+    float rate = (propHashMap.getMapHead()._iUsedChunk) * 1.0/propHashMap.allBlockChunkCount();
+
+    if (rate > 0.9)
+    {
+        propHashMap.expand(propHashMap.getMapHead()._iMemSize * 2);
+        TLOGERROR("PropertyFlushThread::flush hashmap expand to " << propHashMap.getMapHead()._iMemSize << endl);
+    }
+
+    int64_t iBegin = TNOWMS;
+    size_t iCount = g_app.getAggregator().flush(propHashMap);
+    if (iCount > 0)
+    {
+        TLOGDEBUG("PropertyFlushThread::flush|" << iCount << "|" << (TNOWMS - iBegin) << endl);
+    }
+}
+
+void PropertyFlushThread::dump2file()
+{
+    time_t tNow         = TNOW;
+    time_t tInsertIntev = g_app.getInsertInterval() * 60; // second
+
+    string sDate, sFlag;
+    if (_lastDumpTime == 0)
+    {
+        g_app.getTimeInfo(_lastDumpTime, sDate, sFlag);
+    }
+
+    if (tNow - _lastDumpTime > tInsertIntev)
+    {
+        g_app.getTimeInfo(_lastDumpTime, sDate, sFlag);
+        string sFile = g_app.getClonePath() + "/" + sDate + sFlag + ".txt";
+        int iRet = g_app.getHashMap().dump2file(sFile, true);
+        if(iRet != 0)
+        {
+            TC_File::removeFile(sFile, false);
+            TLOGERROR("PropertyFlushThread::dump2file |" << iRet << "|" << sFile << endl);
+        }
+        else
+        {
+            TLOGDEBUG("PropertyFlushThread::dump2file |" << sFile << endl);
+        }
+    }
+}
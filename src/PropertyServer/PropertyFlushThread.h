@@ -0,0 +1,70 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __FLUSH_THREAD_H_
+#define __FLUSH_THREAD_H_
+
+#include <iostream>
+#include "util/tc_thread.h"
+#include "util/tc_common.h"
+#include "servant/Application.h"
+
+using namespace tars;
+
+/**
+ * 定时将内存预聚合的上报数据合并到hashmap，并按入库间隔将hashmap转储为clone文件的线程类
+ */
+class PropertyFlushThread : public TC_Thread, public TC_ThreadLock
+{
+public:
+
+    PropertyFlushThread(int iFlushInterval)
+    : _terminate(false), _flushInterval(iFlushInterval), _lastDumpTime(0)
+    {}
+
+    ~PropertyFlushThread();
+
+    /**
+     * 结束线程
+     */
+    void terminate();
+
+    /**
+     * 轮询函数
+     */
+    virtual void run();
+
+private:
+
+    void flush();
+
+    void dump2file();
+
+private:
+    /**
+     * 结束线程标识
+     */
+    bool _terminate;
+
+    /**
+     * 合并的时间间隔，单位毫秒
+     */
+    int _flushInterval;
+
+    /**
+     * 上次转储的时间
+     */
+    time_t _lastDumpTime;
+};
+
+#endif
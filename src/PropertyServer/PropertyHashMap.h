@@ -38,22 +38,15 @@ class PropertyHashMap : public PropHashMap
 {
 public:
     /**
-    * 添加数据
-    * @param PropHead(Key)
-    * @param PropBody(Value)
+    * 合并数据，已有记录时按特性的policy逐个合并
+    * @param PropKey
+    * @param PropValue
     *
     * @return int, 0表示成功，其他失败
     */
-    int add(const PropHead &head, const PropBody &body)
+    int merge(const PropKey &key, const PropValue &inValue)
     {
-        PropKey key;
         PropValue value;
-
-        key.moduleName    = head.moduleName;
-        key.setName       = head.setName;
-        key.setArea       = head.setArea;
-        key.setID         = head.setID;
-        key.ip            = head.ip;
         TarsOutputStream<BufferWriter> osk;
         key.writeTo(osk);
 
@@ -64,7 +57,7 @@ public:
         int ret = this->_t.get(sk, sv, t);
         if (ret < 0 || ret == TC_HashMap::RT_NO_DATA)
         {
-            value.statInfo.insert(pair<string, DCache::StatPropInfo>(head.propertyName, body.vInfo[0]));
+            value = inValue;
         }
         // 读取到数据了, 解包
         else if (ret == TC_HashMap::RT_OK)
@@ -81,77 +74,17 @@ public:
                 TLOGINFO("read hash body|" << os.str() << endl);
             }
 
-            map<string, DCache::StatPropInfo>::iterator it = value.statInfo.find(head.propertyName);
-            if (it == value.statInfo.end())
-            {
-                value.statInfo.insert(pair<string, DCache::StatPropInfo>(head.propertyName, body.vInfo[0]));
-            }
-            else
+            map<string, DCache::StatPropInfo>::const_iterator itIn = inValue.statInfo.begin();
+            for (; itIn != inValue.statInfo.end(); ++itIn)
             {
-                const string &policy = it->second.policy;
-                const string &inValue = body.vInfo[0].value;
-
-                if (policy == "Count" )
-                {
-                    long long count = TC_Common::strto<long long>(it->second.value) + TC_Common::strto<long long>(inValue);
-                    it->second.value = TC_Common::tostr(count);
-                }
-                else if (policy == "Sum")
-                {
-                    long long sum =  TC_Common::strto<long long>(it->second.value) + TC_Common::strto<long long>(inValue);
-                    it->second.value = TC_Common::tostr(sum);
-
-                }
-                else if (policy == "Min")
-                {
-                    long long cur = TC_Common::strto<long long>(it->second.value);
-                    long long in  = TC_Common::strto<long long>(inValue);
-                    long long min = (cur < in) ? cur: in;
-                    it->second.value = TC_Common::tostr(min);
-                }			
-                else if (policy == "Max")
-                {
-                    long long cur = TC_Common::strto<long long>(it->second.value);
-                    long long in  = TC_Common::strto<long long>(inValue);
-                    long long max = (cur > in) ? cur : in;
-                    it->second.value = TC_Common::tostr(max);
-                }
-                else if (policy == "Distr")
+                map<string, DCache::StatPropInfo>::iterator it = value.statInfo.find(itIn->first);
+                if (it == value.statInfo.end())
                 {
-                    vector<string> fields = TC_Common::sepstr<string>(it->second.value, ",");
-                    vector<string> fieldsIn = TC_Common::sepstr<string>(inValue, ",");
-                    string tmpValue = "";
-                    for (size_t k = 0; k < fields.size(); ++k)
-                    {
-                        vector<string> sTmp	 = TC_Common::sepstr<string>(fields[k], "|");
-                        vector<string> inTmp = TC_Common::sepstr<string>(fieldsIn[k], "|");
-                        long long tmp = TC_Common::strto<long long>(sTmp[1]) + TC_Common::strto<long long>(inTmp[1]);
-                        sTmp[1] = TC_Common::tostr(tmp);
-                        fields[k] = sTmp[0] + "|" + sTmp[1];
-
-                        if (k == 0)
-                        {
-                            tmpValue = fields[k];
-                        }
-                        else
-                        {
-                            tmpValue = tmpValue + "," + fields[k];
-                        }
-                    }
-                    it->second.value = tmpValue;
+                    value.statInfo.insert(*itIn);
                 }
-                else if (policy == "Avg")
+                else
                 {
-                    vector<string> sTmp  = TC_Common::sepstr<string>(it->second.value, "=");
-                    vector<string> inTmp = TC_Common::sepstr<string>(inValue, "=");
-
-                    // 总值求和
-                    double tmpValueSum = TC_Common::strto<double>(sTmp[0]) + TC_Common::strto<double>(inTmp[0]);
-                    // 新版本平均值带有记录数,记录求和
-                    long tmpCntSum = ((2 == inTmp.size()) ? (TC_Common::strto<long>(inTmp[1])) : 1) +
-                        ((2 == sTmp.size()) ? (TC_Common::strto<long>(sTmp[1])) : 1);
-
-                    it->second.value = TC_Common::tostr(tmpValueSum) + "=" + TC_Common::tostr(tmpCntSum);
+                    mergeInfo(it->second, itIn->second.value);
                 }
             }
 
@@ -175,6 +108,87 @@ public:
         vector<TC_HashMap::BlockData> data;
         return this->_t.set(sk, sv, true, data);
     }
+
+    /**
+    * 将inValue按info的policy合并到info
+    */
+    static void mergeInfo(DCache::StatPropInfo &info, const string &inValue)
+    {
+        const string &policy = info.policy;
+
+        if (policy == "Count" )
+        {
+            long long count = TC_Common::strto<long long>(info.value) + TC_Common::strto<long long>(inValue);
+            info.value = TC_Common::tostr(count);
+        }
+        else if (policy == "Sum")
+        {
+            long long sum =  TC_Common::strto<long long>(info.value) + TC_Common::strto<long long>(inValue);
+            info.value = TC_Common::tostr(sum);
+
+        }
+        else if (policy == "Min")
+        {
+            long long cur = TC_Common::strto<long long>(info.value);
+            long long in  = TC_Common::strto<long long>(inValue);
+            long long min = (cur < in) ? cur: in;
+            info.value = TC_Common::tostr(min);
+        }
+        else if (policy == "Max")
+        {
+            long long cur = TC_Common::strto<long long>(info.value);
+            long long in  = TC_Common::strto<long long>(inValue);
+            long long max = (cur > in) ? cur : in;
+            info.value = TC_Common::tostr(max);
+        }
+        else if (policy == "Distr")
+        {
+            vector<string> fields = TC_Common::sepstr<string>(info.value, ",");
+            vector<string> fieldsIn = TC_Common::sepstr<string>(inValue, ",");
+            string tmpValue = "";
+            for (size_t k = 0; k < fields.size() && k < fieldsIn.size(); ++k)
+            {
+                vector<string> sTmp	 = TC_Common::sepstr<string>(fields[k], "|");
+                vector<string> inTmp = TC_Common::sepstr<string>(fieldsIn[k], "|");
+                if (sTmp.size() < 2 || inTmp.size() < 2)
+                {
+                    continue;
+                }
+                long long tmp = TC_Common::strto<long long>(sTmp[1]) + TC_Common::strto<long long>(inTmp[1]);
+                sTmp[1] = TC_Common::tostr(tmp);
+                fields[k] = sTmp[0] + "|" + sTmp[1];
+            }
+            for (size_t k = 0; k < fields.size(); ++k)
+            {
+                if (k == 0)
+                {
+                    tmpValue = fields[k];
+                }
+                else
+                {
+                    tmpValue = tmpValue + "," + fields[k];
+                }
+            }
+            info.value = tmpValue;
+        }
+        else if (policy == "Avg")
+        {
+            vector<string> sTmp  = TC_Common::sepstr<string>(info.value, "=");
+            vector<string> inTmp = TC_Common::sepstr<string>(inValue, "=");
+            if (sTmp.empty() || inTmp.empty())
+            {
+                return;
+            }
+
+            // 总值求和
+            double tmpValueSum = TC_Common::strto<double>(sTmp[0]) + TC_Common::strto<double>(inTmp[0]);
+            // 新版本平均值带有记录数,记录求和
+            long tmpCntSum = ((2 == inTmp.size()) ? (TC_Common::strto<long>(inTmp[1])) : 1) +
+                ((2 == sTmp.size()) ? (TC_Common::strto<long>(sTmp[1])) : 1);
+
+            info.value = TC_Common::tostr(tmpValueSum) + "=" + TC_Common::tostr(tmpCntSum);
+        }
+    }
 };
 
 #endif
@@ -14,6 +14,7 @@
 #include "PropertyImp.h"
 #include "PropertyServer.h"
 #include "PropertyDbManager.h"
+#include "PropertyTsdbManager.h"
 
 
 ///////////////////////////////////////////////////////////
@@ -52,17 +53,6 @@ int PropertyImp::reportPropMsg(const map<DCache::StatPropMsgHead, DCache::StatPr
             continue;
         }
 
-        dump2file();
-
-        PropertyHashMap &propHashMap = g_app.getHashMap();
-        float rate = (propHashMap.getMapHead()._iUsedChunk) * 1.0/propHashMap.allBlockChunkCount();
-
-        if (rate > 0.9)
-        {
-            propHashMap.expand(propHashMap.getMapHead()._iMemSize * 2);
-            TLOGERROR("PropertyImp::reportPropMsg hashmap expand to " << propHashMap.getMapHead()._iMemSize << endl);
-        }
-
         PropHead tHead;
         vector<string> v = TC_Common::sepstr<string>(head.propertyName, ".");
         string sPropertyName;
@@ -103,11 +93,8 @@ int PropertyImp::reportPropMsg(const map<DCache::StatPropMsgHead, DCache::StatPr
         tHead.setID         = head.setID;
         tHead.ip            = current->getIp();
 
-        int iRet = propHashMap.add(tHead, body);
-        if (iRet != TC_HashMap::RT_OK)
-        {
-            TLOGERROR("PropertyImp::reportPropMsg add hashmap record return:" << iRet << endl);
-        }
+        // 先在内存中分片聚合，由PropertyFlushThread定期合并到hashmap
+        g_app.getAggregator().add(tHead, body.vInfo[0]);
     }
     
     return 0;
@@ -118,7 +105,20 @@ int PropertyImp::queryPropData(const DCache::QueryPropCond & req,vector<DCache::
     int ret = 0;
     try
     {
-        return PropertyDbManager::getInstance()->queryPropData(req, rsp);
+        if (!PropertyTsdbManager::getInstance()->isEnable())
+        {
+            return PropertyDbManager::getInstance()->queryPropData(req, rsp);
+        }
+
+        // 优先从本地时序存储查询，本地没有的日期再查db
+        DCache::QueryPropCond missCond = req;
+        missCond.date.clear();
+        ret = PropertyTsdbManager::getInstance()->queryPropData(req, rsp, missCond.date);
+        if (ret != 0 || missCond.date.empty() || !g_app.isDbSinkEnable())
+        {
+            return ret;
+        }
+        return PropertyDbManager::getInstance()->queryPropData(missCond, rsp);
     }
     catch(const std::exception& e)
     {
@@ -133,40 +133,3 @@ int PropertyImp::queryPropData(const DCache::QueryPropCond & req,vector<DCache::
 
     return ret;
 }
-
-void PropertyImp::dump2file()
-{
-    static string g_sDate;
-    static string g_sFlag;
-
-    time_t tNow			= TNOW;
-    time_t tInsertIntev = g_app.getInsertInterval() * 60; // second
-
-    static time_t g_tLastDumpTime = 0;
-
-    if (g_tLastDumpTime == 0)
-    {
-        g_app.getTimeInfo(g_tLastDumpTime, g_sDate, g_sFlag);
-    }
-
-    if (tNow - g_tLastDumpTime > tInsertIntev)
-    {
-        static TC_ThreadLock g_mutex;
-        TC_ThreadLock::Lock lock(g_mutex);
-        if (tNow - g_tLastDumpTime > tInsertIntev)
-        {
-            g_app.getTimeInfo(g_tLastDumpTime, g_sDate, g_sFlag);
-            string sFile = g_app.getClonePath() + "/" + g_sDate + g_sFlag + ".txt";
-            int iRet = g_app.getHashMap().dump2file(sFile, true);
-            if(iRet != 0)
-            {
-                TC_File::removeFile(sFile, false);
-                TLOGERROR("PropertyImp::dump2file |" << iRet << "|" << sFile << endl);
-            }
-            else
-            {
-                TLOGDEBUG("PropertyImp::dump2file |" << sFile << endl);
-            }
-        }
-    }
-}
@@ -58,10 +58,6 @@ public:
     virtual int reportPropMsg(const map<DCache::StatPropMsgHead, DCache::StatPropMsgBody> &propMsg, tars::TarsCurrentPtr current);
 
     virtual int queryPropData(const DCache::QueryPropCond &req, vector<DCache::QueriedResult> &rsp, tars::TarsCurrentPtr current);
-
-  private:
-
-    void dump2file();
 };
 
 #endif
@@ -14,6 +14,7 @@
 #include "PropertyReapThread.h"
 #include "PropertyServer.h"
 #include "PropertyDbManager.h"
+#include "PropertyTsdbManager.h"
 
 ///////////////////////////////////////////////////////////
 //
@@ -73,7 +74,12 @@ void PropertyReapThread::run()
                 getPropertyMsg(vCloneFiles[i], mPropMsg);
                 if (!mPropMsg.empty())
                 {
-                    PropertyDbManager::getInstance()->insert2Db(mPropMsg, sDate, sFlag);
+                    PropertyTsdbManager::getInstance()->ingest(mPropMsg, sDate, sFlag);
+
+                    if (g_app.isDbSinkEnable())
+                    {
+                        PropertyDbManager::getInstance()->insert2Db(mPropMsg, sDate, sFlag);
+                    }
                 }
 
                 if (_terminate)
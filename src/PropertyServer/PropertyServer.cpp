@@ -16,6 +16,7 @@
 #include "CacheInfo.h"
 #include "CacheInfoManager.h"
 #include "PropertyDbManager.h"
+#include "PropertyTsdbManager.h"
 
 PropertyServer g_app;
 
@@ -52,11 +53,27 @@ void PropertyServer::initialize()
                 ++it;
         }
 
+        string sSinkEnable = _conf.get("/Main/DB<SinkEnable>", "Y");
+        _dbSinkEnable = (sSinkEnable == "Y" || sSinkEnable == "y");
+
         CacheInfoManager::getInstance()->init(_conf);
         PropertyDbManager::getInstance()->init(_conf);
+        PropertyTsdbManager::getInstance()->init(_conf);
 
         initHashMap();
 
+        // 上报数据预聚合的分片数及合并到hashmap的时间间隔(毫秒)
+        size_t iShardNum = TC_Common::strto<size_t>(_conf.get("/Main/HashMap<AggShardNum>", "16"));
+        _aggregator.init(iShardNum);
+
+        int iFlushInterval = TC_Common::strto<int>(_conf.get("/Main/HashMap<FlushInterval>", "1000"));
+        if (iFlushInterval <= 0)
+        {
+            iFlushInterval = 1000;
+        }
+        _flushThread = new PropertyFlushThread(iFlushInterval);
+        _flushThread->start();
+
         // 读取cache服务信息更新时间间隔，单位秒
         _updateInterval = TC_Common::strto<int>(_conf.get("/Main/CacheInfo<UpdateInterval>", "600")); 
         
@@ -136,13 +153,29 @@ const map<string, string> & PropertyServer::getPropertyNameMap() const
     return _propertyNameMap;
 }
 
+bool PropertyServer::isDbSinkEnable() const
+{
+    return _dbSinkEnable;
+}
+
 PropertyHashMap & PropertyServer::getHashMap()
 {
     return _hashMap;
 }
 
+PropertyAggregator & PropertyServer::getAggregator()
+{
+    return _aggregator;
+}
+
 void PropertyServer::destroyApp()
 {
+    if (_flushThread)
+    {
+        delete _flushThread;
+        _flushThread = NULL;
+    }
+
     if (_reapThread)
     {
         delete _reapThread;
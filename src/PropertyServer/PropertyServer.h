@@ -17,6 +17,8 @@
 #include "servant/Application.h"
 #include "PropertyHashMap.h"
 #include "PropertyReapThread.h"
+#include "PropertyFlushThread.h"
+#include "PropertyAggregator.h"
 #include "CacheInfoUpdateThread.h"
 
 using namespace tars;
@@ -28,7 +30,9 @@ public:
      * 构造函数
      **/
     PropertyServer()
-    : _reapThread(NULL)
+    : _dbSinkEnable(true)
+    , _reapThread(NULL)
+    , _flushThread(NULL)
     , _updateThread(NULL) 
     {}
 
@@ -45,7 +49,11 @@ public:
 
     const map<string, string> & getPropertyNameMap() const;
 
+    bool isDbSinkEnable() const;
+
     PropertyHashMap & getHashMap();
+
+    PropertyAggregator & getAggregator();
         
 protected:
     /**
@@ -75,8 +83,14 @@ private:
     // 特性名到db字段名的映射关系
     map<string, string> _propertyNameMap;
 
+    // 是否将特性数据写入db
+    bool _dbSinkEnable;
+
   PropertyReapThread* _reapThread;
 
+    // 上报数据合并线程
+    PropertyFlushThread* _flushThread;
+
     // cache服务信息更新时间间隔
     int _updateInterval;
     
@@ -84,6 +98,9 @@ private:
     CacheInfoUpdateThread* _updateThread;
 
     PropertyHashMap _hashMap;
+
+    // 上报数据的内存预聚合
+    PropertyAggregator _aggregator;
 };
 
 extern PropertyServer g_app;
@@ -0,0 +1,281 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "PropertyTsdbManager.h"
+#include "PropertyServer.h"
+#include "CacheInfoManager.h"
+
+void PropertyTsdbManager::init(TC_Config &conf)
+{
+    TLOGDEBUG("PropertyTsdbManager::init begin ..." << endl);
+
+    string sEnable = conf.get("/Main/TSDB<Enable>", "Y");
+    _enable = (sEnable == "Y" || sEnable == "y");
+    if (!_enable)
+    {
+        TLOGDEBUG("PropertyTsdbManager::init tsdb disabled" << endl);
+        return;
+    }
+
+    string sPath = ServerConfig::DataPath + "/" + conf.get("/Main/TSDB<Path>", "tsdb");
+    _retentionDays = TC_Common::strto<int>(conf.get("/Main/TSDB<RetentionDays>", "8"));
+    if (_retentionDays <= 0)
+    {
+        _retentionDays = 8;
+    }
+    vector<uint32_t> vRollup = TC_Common::sepstr<uint32_t>(conf.get("/Main/TSDB<Rollup>", "10|60"), "|");
+    _compactInterval = TC_Common::strto<int>(conf.get("/Main/TSDB<CompactInterval>", "3600"));
+
+    _store.init(sPath, _retentionDays, vRollup);
+    if (_store.load() != 0)
+    {
+        throw runtime_error("PropertyTsdbManager::init load tsdb failed, path:" + sPath);
+    }
+
+    TLOGDEBUG("PropertyTsdbManager::init ok|" << _store.desc() << endl);
+}
+
+int PropertyTsdbManager::ingest(const PropertyMsg &mPropMsg, const string &sDate, const string &sFlag)
+{
+    if (!_enable)
+    {
+        return 0;
+    }
+
+    int iMinute = TimeSeriesStore::flagToMinute(sFlag);
+    if (iMinute <= 0)
+    {
+        TLOGERROR("PropertyTsdbManager::ingest invalid flag:" << sFlag << endl);
+        return -1;
+    }
+
+    int64_t iBegin = TNOWMS;
+
+    // 同一时刻同一序列可能有多条上报(如不同ip)，先累加再写入
+    map<string, double> mValues;
+    const map<string, string> &nameMap = g_app.getPropertyNameMap();
+    for (PropertyMsg::const_iterator it = mPropMsg.begin(); it != mPropMsg.end(); ++it)
+    {
+        const PropKey &key = it->first;
+
+        string::size_type pos = key.moduleName.find('.');
+        if (pos == string::npos)
+        {
+            TLOGERROR("PropertyTsdbManager::ingest invalid server name:" << key.moduleName << endl);
+            continue;
+        }
+
+        CacheModuleInfo stInfo;
+        if (!CacheInfoManager::getInstance()->getModuleInfo(key.moduleName.substr(pos + 1), stInfo))
+        {
+            TLOGERROR("PropertyTsdbManager::ingest no module info for server:" << key.moduleName << endl);
+            continue;
+        }
+
+        bool bMaster = (stInfo._serverStatus == "M");
+        for (map<string, string>::const_iterator itName = nameMap.begin(); itName != nameMap.end(); ++itName)
+        {
+            map<string, DCache::StatPropInfo>::const_iterator itInfo = it->second.statInfo.find(itName->second);
+            if (itInfo == it->second.statInfo.end())
+            {
+                continue;
+            }
+
+            double value = toValue(itInfo->second);
+            mValues[seriesKey(stInfo._moduleName, key.moduleName, itName->first)] += value;
+            if (bMaster)
+            {
+                mValues[seriesKey(stInfo._moduleName, "", itName->first)] += value;
+            }
+        }
+    }
+
+    if (sDate > _lastDate)
+    {
+        rollover(sDate);
+    }
+
+    // 每批数据只追加到日志，定期整理为数据文件
+    size_t iCount = _store.append(sDate, uint32_t(iMinute), mValues);
+
+    int iRet = 0;
+    if (TNOW - _lastCompactTime >= _compactInterval)
+    {
+        iRet = _store.save(sDate);
+        if (iRet != 0)
+        {
+            TLOGERROR("PropertyTsdbManager::ingest save failed, date:" << sDate << endl);
+        }
+        _lastCompactTime = TNOW;
+    }
+
+    TLOGDEBUG("PropertyTsdbManager::ingest|" << sDate << "|" << sFlag << "|" << mValues.size() << "|" << iCount << "|"
+                                             << (TNOWMS - iBegin) << endl);
+    return iRet;
+}
+
+void PropertyTsdbManager::rollover(const string &sDate)
+{
+    if (!_lastDate.empty())
+    {
+        if (_store.save(_lastDate) != 0)
+        {
+            TLOGERROR("PropertyTsdbManager::rollover save failed, date:" << _lastDate << endl);
+        }
+
+        // 启动后第一次写入的日期可能缺少之前的数据，之后的日期都是从0点起写入的
+        if (_store.isComplete(_lastDate))
+        {
+            _store.markComplete(_lastDate);
+        }
+        _store.markLive(sDate);
+    }
+    _lastDate = sDate;
+    _lastCompactTime = TNOW;
+
+    _store.prune(TC_Common::tm2str(TNOW - _retentionDays * 86400, "%Y%m%d"));
+
+    TLOGDEBUG("PropertyTsdbManager::rollover|" << sDate << "|" << _store.desc() << endl);
+}
+
+int PropertyTsdbManager::queryPropData(const DCache::QueryPropCond &req,
+                                       vector<DCache::QueriedResult> &rsp,
+                                       vector<string> &missDates)
+{
+    int iBegin = TimeSeriesStore::flagToMinute(req.startTime);
+    int iEnd = TimeSeriesStore::flagToMinute(req.endTime);
+    uint32_t begin = iBegin < 0 ? 0 : uint32_t(iBegin);
+    uint32_t end = iEnd < 0 ? 1440 : uint32_t(iEnd);
+
+    bool bLocalOnly = !g_app.isDbSinkEnable();
+    const map<string, string> &nameMap = g_app.getPropertyNameMap();
+    for (size_t i = 0; i < req.date.size(); ++i)
+    {
+        const string &date = req.date[i];
+        if (!(_store.isComplete(date) || (bLocalOnly && _store.hasDate(date))))
+        {
+            missDates.push_back(date);
+            continue;
+        }
+
+        if (req.serverName != "*")
+        {
+            QueriedResult result;
+            result.moduleName = req.moduleName;
+            result.serverName = req.serverName;
+            result.date = date;
+            queryServer(req, date, req.serverName, begin, end, result);
+            rsp.push_back(result);
+            continue;
+        }
+
+        // 列出模块下所有服务，按服务汇总查询时间段内的数据
+        string sPrefix = req.moduleName + "\t";
+        vector<string> vKeys;
+        _store.listSeries(date, sPrefix, vKeys);
+
+        map<string, QueriedProp> svrSum;
+        for (size_t j = 0; j < vKeys.size(); ++j)
+        {
+            string::size_type pos = vKeys[j].find('\t', sPrefix.size());
+            if (pos == string::npos || pos == sPrefix.size())
+            {
+                continue;
+            }
+
+            double value = 0;
+            if (_store.sum(date, vKeys[j], begin, end, value))
+            {
+                string sServerName = vKeys[j].substr(sPrefix.size(), pos - sPrefix.size());
+                svrSum[sServerName].propData[vKeys[j].substr(pos + 1)] += value;
+            }
+        }
+
+        for (map<string, QueriedProp>::iterator it = svrSum.begin(); it != svrSum.end(); ++it)
+        {
+            for (map<string, string>::const_iterator itName = nameMap.begin(); itName != nameMap.end(); ++itName)
+            {
+                it->second.propData.insert(make_pair(itName->first, 0.0));
+            }
+
+            QueriedResult result;
+            result.moduleName = req.moduleName;
+            result.serverName = it->first;
+            result.date = date;
+            result.data.push_back(it->second);
+            rsp.push_back(result);
+        }
+    }
+
+    return 0;
+}
+
+void PropertyTsdbManager::queryServer(const DCache::QueryPropCond &req,
+                                      const string &date,
+                                      const string &serverName,
+                                      uint32_t begin,
+                                      uint32_t end,
+                                      DCache::QueriedResult &result)
+{
+    uint32_t interval = req.interval > 0 ? uint32_t(req.interval) : 0;
+
+    map<uint32_t, QueriedProp> timeData;
+    const map<string, string> &nameMap = g_app.getPropertyNameMap();
+    map<string, string>::const_iterator itName;
+    for (itName = nameMap.begin(); itName != nameMap.end(); ++itName)
+    {
+        vector<TsPoint> vPoints;
+        _store.query(date, seriesKey(req.moduleName, serverName, itName->first), begin, end, interval, vPoints);
+        for (size_t i = 0; i < vPoints.size(); ++i)
+        {
+            QueriedProp &prop = timeData[vPoints[i].time];
+            prop.timeStamp = TimeSeriesStore::minuteToFlag(vPoints[i].time);
+            prop.propData[itName->first] = vPoints[i].value;
+        }
+    }
+
+    // 与db查询结果一致，每个时刻都带上全部特性
+    for (map<uint32_t, QueriedProp>::iterator it = timeData.begin(); it != timeData.end(); ++it)
+    {
+        for (itName = nameMap.begin(); itName != nameMap.end(); ++itName)
+        {
+            it->second.propData.insert(make_pair(itName->first, 0.0));
+        }
+        result.data.push_back(it->second);
+    }
+}
+
+string PropertyTsdbManager::seriesKey(const string &moduleName, const string &serverName, const string &propName)
+{
+    return moduleName + "\t" + serverName + "\t" + propName;
+}
+
+double PropertyTsdbManager::toValue(const DCache::StatPropInfo &info)
+{
+    // 与写入db时一致，Avg上报的是"总和=次数"
+    if (info.policy == "Avg")
+    {
+        vector<string> vTmp = TC_Common::sepstr<string>(info.value, "=");
+        if (vTmp.empty())
+        {
+            return 0;
+        }
+        if (2 == vTmp.size() && TC_Common::strto<long>(vTmp[1]) != 0)
+        {
+            return TC_Common::strto<double>(vTmp[0]) / TC_Common::strto<long>(vTmp[1]);
+        }
+        return TC_Common::strto<double>(vTmp[0]);
+    }
+
+    return TC_Common::strto<double>(info.value);
+}
@@ -0,0 +1,79 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#ifndef __PROPERTY_TSDB_MANAGER_H_
+#define __PROPERTY_TSDB_MANAGER_H_
+
+#include "util/tc_singleton.h"
+#include "util/tc_config.h"
+#include "servant/Application.h"
+#include "Property.h"
+#include "PropertyHashMap.h"
+#include "TimeSeriesStore.h"
+
+using namespace tars;
+
+// 特性数据的本地时序存储，每个模块保存两类序列:
+// 每个服务的特性数据，以及模块内所有主机数据之和(与db中按server_status='M'汇总一致)
+// 只有从0点起一直在写入的日期才从本地查询，服务中途启用或重启的当天仍到db查询
+class PropertyTsdbManager : public TC_Singleton<PropertyTsdbManager>
+{
+public:
+    PropertyTsdbManager() : _enable(false), _retentionDays(8), _compactInterval(3600), _lastCompactTime(0) {}
+
+    void init(TC_Config &conf);
+
+    bool isEnable() const { return _enable; }
+
+    /**
+     * 将一个时间段的特性上报信息写入时序存储，只由PropertyReapThread调用
+     *
+     * @return int
+     */
+    int ingest(const PropertyMsg &mPropMsg, const string &sDate, const string &sFlag);
+
+    /**
+     * 查询特性数据，本地数据不完整的日期放入missDates，由调用者到db查询。
+     * 不写db时没有其他数据来源，本地有数据的日期都从本地查询
+     *
+     * @return int
+     */
+    int queryPropData(const DCache::QueryPropCond &req, vector<DCache::QueriedResult> &rsp, vector<string> &missDates);
+
+    string desc() const { return _store.desc(); }
+
+private:
+    // 开始写入新的一天：整理前一天的数据文件，前一天从0点起一直在写入时标记为完整，清理过期数据
+    void rollover(const string &sDate);
+
+    static string seriesKey(const string &moduleName, const string &serverName, const string &propName);
+
+    static double toValue(const DCache::StatPropInfo &info);
+
+    void queryServer(const DCache::QueryPropCond &req,
+                     const string &date,
+                     const string &serverName,
+                     uint32_t begin,
+                     uint32_t end,
+                     DCache::QueriedResult &result);
+
+private:
+    bool _enable;
+    int _retentionDays;
+    int _compactInterval;    // 将当天的日志整理为数据文件的间隔(秒)
+    time_t _lastCompactTime;
+    string _lastDate;        // 最近写入的日期
+    TimeSeriesStore _store;
+};
+
+#endif
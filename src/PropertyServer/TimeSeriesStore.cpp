@@ -0,0 +1,972 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include "util/tc_common.h"
+#include "util/tc_file.h"
+#include "servant/Application.h"
+#include "TimeSeriesStore.h"
+
+namespace
+{
+const char TSDB_MAGIC[] = "DTSD";
+const uint32_t TSDB_VERSION = 1;
+const char TSDB_FILE_EXT[] = "tsdb";
+const char TSDB_LOG_EXT[] = "log";
+const char TSDB_COMPLETE_EXT[] = "done";
+
+bool isTsdbFile(const string &file, string &date, string &ext)
+{
+    date = TC_File::extractFileName(TC_File::excludeFileExt(file));
+    ext = TC_File::extractFileExt(file);
+    if (ext != TSDB_FILE_EXT && ext != TSDB_LOG_EXT && ext != TSDB_COMPLETE_EXT)
+    {
+        return false;
+    }
+    return date.length() == 8 && TC_Common::isdigit(date);
+}
+
+void appendUInt32(string &buf, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        buf.push_back(char((value >> (i * 8)) & 0xff));
+    }
+}
+
+void appendUInt64(string &buf, uint64_t value)
+{
+    appendUInt32(buf, uint32_t(value & 0xffffffff));
+    appendUInt32(buf, uint32_t(value >> 32));
+}
+
+bool readUInt32(const string &buf, size_t &pos, uint32_t &value)
+{
+    if (pos + 4 > buf.size())
+    {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        value |= uint32_t(uint8_t(buf[pos + i])) << (i * 8);
+    }
+    pos += 4;
+    return true;
+}
+
+bool readUInt64(const string &buf, size_t &pos, uint64_t &value)
+{
+    uint32_t low = 0, high = 0;
+    if (!readUInt32(buf, pos, low) || !readUInt32(buf, pos, high))
+    {
+        return false;
+    }
+    value = (uint64_t(high) << 32) | low;
+    return true;
+}
+
+uint64_t doubleToBits(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double bitsToDouble(uint64_t bits)
+{
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+}  // namespace
+
+///////////////////////////////////////////////////////////
+//
+void BitWriter::writeBits(uint64_t value, int bits)
+{
+    for (int i = bits - 1; i >= 0; --i)
+    {
+        if (_bitCount % 8 == 0)
+        {
+            _bytes.push_back(0);
+        }
+        if ((value >> i) & 1)
+        {
+            _bytes.back() |= uint8_t(0x80 >> (_bitCount % 8));
+        }
+        ++_bitCount;
+    }
+}
+
+bool BitReader::readBits(int bits, uint64_t &value)
+{
+    if (_pos + bits > _bitCount)
+    {
+        return false;
+    }
+
+    value = 0;
+    for (int i = 0; i < bits; ++i, ++_pos)
+    {
+        value = (value << 1) | ((_bytes[_pos / 8] >> (7 - _pos % 8)) & 1);
+    }
+    return true;
+}
+
+bool BitReader::readBit(bool &bit)
+{
+    uint64_t value = 0;
+    if (!readBits(1, value))
+    {
+        return false;
+    }
+    bit = (value != 0);
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+//
+SeriesChunk::SeriesChunk()
+    : _count(0), _lastTime(0), _lastDelta(0), _lastValue(0), _leading(-1), _trailing(0)
+{
+}
+
+bool SeriesChunk::append(uint32_t time, double value)
+{
+    if (_count > 0 && time <= _lastTime)
+    {
+        return false;
+    }
+
+    if (_count == 0)
+    {
+        _writer.writeBits(time, 32);
+        _lastValue = doubleToBits(value);
+        _writer.writeBits(_lastValue, 64);
+    }
+    else
+    {
+        // 时间戳写入与上一个间隔的差值，固定间隔上报时只需1个bit
+        int64_t delta = int64_t(time) - int64_t(_lastTime);
+        int64_t dod = delta - _lastDelta;
+        if (dod == 0)
+        {
+            _writer.writeBit(false);
+        }
+        else if (dod >= -63 && dod <= 64)
+        {
+            _writer.writeBits(0x2, 2);
+            _writer.writeBits(uint64_t(dod + 63), 7);
+        }
+        else if (dod >= -255 && dod <= 256)
+        {
+            _writer.writeBits(0x6, 3);
+            _writer.writeBits(uint64_t(dod + 255), 9);
+        }
+        else if (dod >= -2047 && dod <= 2048)
+        {
+            _writer.writeBits(0xe, 4);
+            _writer.writeBits(uint64_t(dod + 2047), 12);
+        }
+        else
+        {
+            _writer.writeBits(0xf, 4);
+            _writer.writeBits(uint32_t(int32_t(dod)), 32);
+        }
+        _lastDelta = delta;
+
+        appendValue(value);
+    }
+
+    _lastTime = time;
+    ++_count;
+
+    return true;
+}
+
+void SeriesChunk::appendValue(double value)
+{
+    uint64_t bits = doubleToBits(value);
+    uint64_t xorValue = bits ^ _lastValue;
+    _lastValue = bits;
+
+    if (xorValue == 0)
+    {
+        _writer.writeBit(false);
+        return;
+    }
+    _writer.writeBit(true);
+
+    int leading = std::min(__builtin_clzll(xorValue), 31);
+    int trailing = __builtin_ctzll(xorValue);
+    if (_leading >= 0 && leading >= _leading && trailing >= _trailing)
+    {
+        // 有效位落在上一个值的窗口内，沿用窗口只写有效位
+        _writer.writeBit(false);
+        _writer.writeBits(xorValue >> _trailing, 64 - _leading - _trailing);
+    }
+    else
+    {
+        int significant = 64 - leading - trailing;
+        _writer.writeBit(true);
+        _writer.writeBits(uint64_t(leading), 5);
+        _writer.writeBits(uint64_t(significant - 1), 6);
+        _writer.writeBits(xorValue >> trailing, significant);
+        _leading = leading;
+        _trailing = trailing;
+    }
+}
+
+bool SeriesChunk::decode(vector<TsPoint> &points) const
+{
+    return decode(_writer.bytes(), _writer.bitCount(), _count, points);
+}
+
+bool SeriesChunk::decode(const vector<uint8_t> &bytes, uint64_t bitCount, size_t count, vector<TsPoint> &points)
+{
+    BitReader reader(bytes, bitCount);
+
+    uint64_t time = 0, value = 0;
+    int64_t delta = 0;
+    int leading = 0, trailing = 0;
+    points.reserve(points.size() + count);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i == 0)
+        {
+            if (!reader.readBits(32, time) || !reader.readBits(64, value))
+            {
+                return false;
+            }
+            points.push_back(TsPoint(uint32_t(time), bitsToDouble(value)));
+            continue;
+        }
+
+        int ones = 0;
+        bool bit = false;
+        while (ones < 4)
+        {
+            if (!reader.readBit(bit))
+            {
+                return false;
+            }
+            if (!bit)
+            {
+                break;
+            }
+            ++ones;
+        }
+
+        uint64_t raw = 0;
+        int64_t dod = 0;
+        switch (ones)
+        {
+        case 0:
+            break;
+        case 1:
+            if (!reader.readBits(7, raw)) return false;
+            dod = int64_t(raw) - 63;
+            break;
+        case 2:
+            if (!reader.readBits(9, raw)) return false;
+            dod = int64_t(raw) - 255;
+            break;
+        case 3:
+            if (!reader.readBits(12, raw)) return false;
+            dod = int64_t(raw) - 2047;
+            break;
+        default:
+            if (!reader.readBits(32, raw)) return false;
+            dod = int32_t(uint32_t(raw));
+            break;
+        }
+        delta += dod;
+        time += delta;
+
+        if (!reader.readBit(bit))
+        {
+            return false;
+        }
+        if (bit)
+        {
+            if (!reader.readBit(bit))
+            {
+                return false;
+            }
+            if (bit)
+            {
+                uint64_t lead = 0, significant = 0;
+                if (!reader.readBits(5, lead) || !reader.readBits(6, significant))
+                {
+                    return false;
+                }
+                leading = int(lead);
+                trailing = 64 - leading - int(significant + 1);
+                if (trailing < 0)
+                {
+                    return false;
+                }
+            }
+            if (!reader.readBits(64 - leading - trailing, raw))
+            {
+                return false;
+            }
+            value ^= (raw << trailing);
+        }
+        points.push_back(TsPoint(uint32_t(time), bitsToDouble(value)));
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+//
+const uint32_t TimeSeriesStore::MINUTES_PER_DAY;
+
+TimeSeriesStore::TimeSeriesStore() : _retentionDays(8)
+{
+}
+
+void TimeSeriesStore::init(const string &path, int retentionDays, const vector<uint32_t> &rollups)
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    _path = path;
+    _retentionDays = retentionDays > 0 ? retentionDays : 1;
+
+    _rollupSizes.clear();
+    for (size_t i = 0; i < rollups.size(); ++i)
+    {
+        if (rollups[i] > 0 && rollups[i] <= MINUTES_PER_DAY)
+        {
+            _rollupSizes.push_back(rollups[i]);
+        }
+    }
+    std::sort(_rollupSizes.begin(), _rollupSizes.end());
+    _rollupSizes.erase(std::unique(_rollupSizes.begin(), _rollupSizes.end()), _rollupSizes.end());
+}
+
+int TimeSeriesStore::load()
+{
+    if (_path.empty())
+    {
+        return 0;
+    }
+
+    if (!TC_File::makeDirRecursive(_path))
+    {
+        TLOGERROR("TimeSeriesStore::load can not create path " << _path << endl);
+        return -1;
+    }
+
+    string sCutoff = TC_Common::tm2str(TNOW - _retentionDays * 86400, "%Y%m%d");
+
+    vector<string> vFiles;
+    vector<pair<string, string> > vLogFiles;
+    TC_File::listDirectory(_path, vFiles, false);
+    for (size_t i = 0; i < vFiles.size(); ++i)
+    {
+        string sDate, sExt;
+        if (!isTsdbFile(vFiles[i], sDate, sExt))
+        {
+            continue;
+        }
+
+        if (sDate < sCutoff)
+        {
+            TC_File::removeFile(vFiles[i], false);
+            continue;
+        }
+
+        if (sExt == TSDB_LOG_EXT)
+        {
+            // 日志要在数据文件之后重放
+            vLogFiles.push_back(make_pair(sDate, vFiles[i]));
+        }
+        else if (sExt == TSDB_COMPLETE_EXT)
+        {
+            TC_ThreadLock::Lock lock(_lock);
+            _completeDays.insert(sDate);
+        }
+        else if (loadFile(sDate, vFiles[i]) != 0)
+        {
+            TLOGERROR("TimeSeriesStore::load load file failed:" << vFiles[i] << endl);
+        }
+    }
+
+    for (size_t i = 0; i < vLogFiles.size(); ++i)
+    {
+        if (loadLog(vLogFiles[i].first, vLogFiles[i].second) != 0)
+        {
+            TLOGERROR("TimeSeriesStore::load load log failed:" << vLogFiles[i].second << endl);
+        }
+    }
+
+    TLOGDEBUG("TimeSeriesStore::load " << desc() << endl);
+
+    return 0;
+}
+
+int TimeSeriesStore::loadFile(const string &date, const string &file)
+{
+    string sBuf = TC_File::load2str(file);
+
+    size_t pos = 4;
+    uint32_t version = 0, seriesCount = 0;
+    if (sBuf.compare(0, 4, TSDB_MAGIC) != 0 || !readUInt32(sBuf, pos, version) || version != TSDB_VERSION
+        || !readUInt32(sBuf, pos, seriesCount))
+    {
+        return -1;
+    }
+
+    TC_ThreadLock::Lock lock(_lock);
+
+    DayData &day = _days[date];
+    for (uint32_t i = 0; i < seriesCount; ++i)
+    {
+        uint32_t keyLen = 0, count = 0, byteLen = 0;
+        uint64_t bitCount = 0;
+        if (!readUInt32(sBuf, pos, keyLen) || pos + keyLen > sBuf.size())
+        {
+            return -1;
+        }
+        string sKey = sBuf.substr(pos, keyLen);
+        pos += keyLen;
+
+        if (!readUInt32(sBuf, pos, count) || !readUInt64(sBuf, pos, bitCount) || !readUInt32(sBuf, pos, byteLen)
+            || pos + byteLen > sBuf.size() || bitCount > uint64_t(byteLen) * 8)
+        {
+            return -1;
+        }
+        vector<uint8_t> bytes(sBuf.begin() + pos, sBuf.begin() + pos + byteLen);
+        pos += byteLen;
+
+        // 重新追加一遍，同时恢复编码状态和预聚合结果
+        vector<TsPoint> points;
+        if (!SeriesChunk::decode(bytes, bitCount, count, points))
+        {
+            TLOGERROR("TimeSeriesStore::loadFile corrupted series:" << sKey << "|" << file << endl);
+            continue;
+        }
+        for (size_t j = 0; j < points.size(); ++j)
+        {
+            appendNoLock(day, sKey, points[j].time, points[j].value);
+        }
+    }
+
+    return 0;
+}
+
+int TimeSeriesStore::loadLog(const string &date, const string &file)
+{
+    string sBuf = TC_File::load2str(file);
+
+    TC_ThreadLock::Lock lock(_lock);
+
+    DayData &day = _days[date];
+    size_t pos = 0;
+    while (pos < sBuf.size())
+    {
+        // 每条记录为同一时刻的一批数据，整条读出后再追加
+        uint32_t time = 0, count = 0;
+        if (!readUInt32(sBuf, pos, time) || !readUInt32(sBuf, pos, count))
+        {
+            break;
+        }
+
+        vector<pair<string, double> > vValues;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t keyLen = 0;
+            uint64_t bits = 0;
+            if (!readUInt32(sBuf, pos, keyLen) || pos + keyLen > sBuf.size())
+            {
+                break;
+            }
+            string sKey = sBuf.substr(pos, keyLen);
+            pos += keyLen;
+            if (!readUInt64(sBuf, pos, bits))
+            {
+                break;
+            }
+            vValues.push_back(make_pair(sKey, bitsToDouble(bits)));
+        }
+        if (vValues.size() != count)
+        {
+            TLOGERROR("TimeSeriesStore::loadLog truncated record at " << pos << "|" << file << endl);
+            break;
+        }
+
+        // 整理数据文件后、清空日志前退出时，日志中的点已在数据文件中，时间不递增会被忽略
+        for (size_t i = 0; i < vValues.size(); ++i)
+        {
+            appendNoLock(day, vValues[i].first, time, vValues[i].second);
+        }
+    }
+
+    return 0;
+}
+
+size_t TimeSeriesStore::append(const string &date, uint32_t time, const map<string, double> &values)
+{
+    if (time == 0 || time > MINUTES_PER_DAY)
+    {
+        return 0;
+    }
+
+    size_t count = 0;
+    {
+        TC_ThreadLock::Lock lock(_lock);
+
+        DayData &day = _days[date];
+        for (map<string, double>::const_iterator it = values.begin(); it != values.end(); ++it)
+        {
+            if (appendNoLock(day, it->first, time, it->second))
+            {
+                ++count;
+            }
+        }
+    }
+
+    // 只追加这一批数据，不重写整天的文件
+    if (count > 0 && !_path.empty())
+    {
+        appendLog(date, time, values);
+    }
+    return count;
+}
+
+int TimeSeriesStore::appendLog(const string &date, uint32_t time, const map<string, double> &values)
+{
+    string sBuf;
+    appendUInt32(sBuf, time);
+    appendUInt32(sBuf, uint32_t(values.size()));
+    for (map<string, double>::const_iterator it = values.begin(); it != values.end(); ++it)
+    {
+        appendUInt32(sBuf, uint32_t(it->first.size()));
+        sBuf += it->first;
+        appendUInt64(sBuf, doubleToBits(it->second));
+    }
+
+    string sFile = logFile(date);
+    FILE *fp = fopen(sFile.c_str(), "ab");
+    if (fp == NULL)
+    {
+        TLOGERROR("TimeSeriesStore::appendLog open failed:" << sFile << "|" << strerror(errno) << endl);
+        return -1;
+    }
+    size_t iWrite = fwrite(sBuf.c_str(), 1, sBuf.size(), fp);
+    fclose(fp);
+    if (iWrite != sBuf.size())
+    {
+        TLOGERROR("TimeSeriesStore::appendLog write failed:" << sFile << "|" << iWrite << "|" << sBuf.size() << endl);
+        return -1;
+    }
+    return 0;
+}
+
+bool TimeSeriesStore::appendNoLock(DayData &day, const string &key, uint32_t time, double value)
+{
+    Series &series = day[key];
+    if (series.rollups.size() != _rollupSizes.size())
+    {
+        series.rollups.resize(_rollupSizes.size());
+        for (size_t i = 0; i < _rollupSizes.size(); ++i)
+        {
+            Rollup &rollup = series.rollups[i];
+            rollup.size = _rollupSizes[i];
+            rollup.sums.assign((MINUTES_PER_DAY + rollup.size - 1) / rollup.size, 0);
+            rollup.counts.assign(rollup.sums.size(), 0);
+        }
+    }
+
+    if (!series.chunk.append(time, value))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < series.rollups.size(); ++i)
+    {
+        Rollup &rollup = series.rollups[i];
+        size_t idx = (time - 1) / rollup.size;
+        rollup.sums[idx] += value;
+        ++rollup.counts[idx];
+    }
+    return true;
+}
+
+int TimeSeriesStore::save(const string &date)
+{
+    if (_path.empty())
+    {
+        return 0;
+    }
+
+    string sBuf(TSDB_MAGIC, 4);
+    {
+        TC_ThreadLock::Lock lock(_lock);
+
+        map<string, DayData>::const_iterator itDay = _days.find(date);
+        if (itDay == _days.end())
+        {
+            return 0;
+        }
+
+        appendUInt32(sBuf, TSDB_VERSION);
+        appendUInt32(sBuf, uint32_t(itDay->second.size()));
+        for (DayData::const_iterator it = itDay->second.begin(); it != itDay->second.end(); ++it)
+        {
+            const BitWriter &writer = it->second.chunk.writer();
+            appendUInt32(sBuf, uint32_t(it->first.size()));
+            sBuf += it->first;
+            appendUInt32(sBuf, uint32_t(it->second.chunk.count()));
+            appendUInt64(sBuf, writer.bitCount());
+            appendUInt32(sBuf, uint32_t(writer.bytes().size()));
+            sBuf.append(writer.bytes().begin(), writer.bytes().end());
+        }
+    }
+
+    // 先写临时文件再改名，避免进程退出时留下不完整的文件
+    string sFile = dataFile(date);
+    string sTmpFile = sFile + ".tmp";
+    try
+    {
+        TC_File::save2file(sTmpFile, sBuf);
+    }
+    catch (exception &ex)
+    {
+        TLOGERROR("TimeSeriesStore::save exception:" << ex.what() << "|" << sTmpFile << endl);
+        return -1;
+    }
+
+    if (::rename(sTmpFile.c_str(), sFile.c_str()) != 0)
+    {
+        TLOGERROR("TimeSeriesStore::save rename failed:" << sTmpFile << "|" << strerror(errno) << endl);
+        TC_File::removeFile(sTmpFile, false);
+        return -1;
+    }
+
+    // 日志中的数据都已在数据文件中。append与save由同一线程调用，其间不会有新的日志
+    TC_File::removeFile(logFile(date), false);
+
+    return 0;
+}
+
+void TimeSeriesStore::markComplete(const string &date)
+{
+    {
+        TC_ThreadLock::Lock lock(_lock);
+        _completeDays.insert(date);
+    }
+
+    if (_path.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        TC_File::save2file(completeFile(date), "");
+    }
+    catch (exception &ex)
+    {
+        TLOGERROR("TimeSeriesStore::markComplete exception:" << ex.what() << "|" << date << endl);
+    }
+}
+
+void TimeSeriesStore::markLive(const string &date)
+{
+    TC_ThreadLock::Lock lock(_lock);
+    _liveDate = date;
+}
+
+bool TimeSeriesStore::isComplete(const string &date) const
+{
+    TC_ThreadLock::Lock lock(_lock);
+    return date == _liveDate || _completeDays.find(date) != _completeDays.end();
+}
+
+void TimeSeriesStore::prune(const string &cutoffDate)
+{
+    {
+        TC_ThreadLock::Lock lock(_lock);
+        _days.erase(_days.begin(), _days.lower_bound(cutoffDate));
+        _completeDays.erase(_completeDays.begin(), _completeDays.lower_bound(cutoffDate));
+    }
+
+    if (_path.empty())
+    {
+        return;
+    }
+
+    vector<string> vFiles;
+    TC_File::listDirectory(_path, vFiles, false);
+    for (size_t i = 0; i < vFiles.size(); ++i)
+    {
+        string sDate, sExt;
+        if (isTsdbFile(vFiles[i], sDate, sExt) && sDate < cutoffDate)
+        {
+            TLOGDEBUG("TimeSeriesStore::prune remove " << vFiles[i] << endl);
+            TC_File::removeFile(vFiles[i], false);
+        }
+    }
+}
+
+bool TimeSeriesStore::hasDate(const string &date) const
+{
+    TC_ThreadLock::Lock lock(_lock);
+    return _days.find(date) != _days.end();
+}
+
+const TimeSeriesStore::Series *TimeSeriesStore::findNoLock(const string &date, const string &key) const
+{
+    map<string, DayData>::const_iterator itDay = _days.find(date);
+    if (itDay == _days.end())
+    {
+        return NULL;
+    }
+
+    DayData::const_iterator it = itDay->second.find(key);
+    if (it == itDay->second.end())
+    {
+        return NULL;
+    }
+    return &(it->second);
+}
+
+bool TimeSeriesStore::query(const string &date,
+                            const string &key,
+                            uint32_t begin,
+                            uint32_t end,
+                            uint32_t interval,
+                            vector<TsPoint> &points) const
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    const Series *series = findNoLock(date, key);
+    if (series == NULL)
+    {
+        return false;
+    }
+    return queryNoLock(*series, begin, end, interval, points);
+}
+
+bool TimeSeriesStore::sum(const string &date, const string &key, uint32_t begin, uint32_t end, double &value) const
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    const Series *series = findNoLock(date, key);
+    if (series == NULL)
+    {
+        return false;
+    }
+
+    // 用最粗粒度的预聚合结果汇总，只有两端不完整的时间段需要解码原始数据
+    vector<TsPoint> points;
+    uint32_t interval = _rollupSizes.empty() ? 0 : _rollupSizes.back();
+    if (!queryNoLock(*series, begin, end, interval, points))
+    {
+        return false;
+    }
+
+    value = 0;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        value += points[i].value;
+    }
+    return true;
+}
+
+bool TimeSeriesStore::queryNoLock(const Series &series,
+                                  uint32_t begin,
+                                  uint32_t end,
+                                  uint32_t interval,
+                                  vector<TsPoint> &points) const
+{
+    begin = std::max(begin, uint32_t(1));
+    end = std::min(end, MINUTES_PER_DAY);
+    if (begin > end)
+    {
+        return true;
+    }
+
+    if (interval == 0)
+    {
+        vector<TsPoint> raw;
+        if (!series.chunk.decode(raw))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < raw.size(); ++i)
+        {
+            if (raw[i].time >= begin && raw[i].time <= end)
+            {
+                points.push_back(raw[i]);
+            }
+        }
+        return true;
+    }
+
+    const Rollup *rollup = NULL;
+    for (size_t i = 0; i < series.rollups.size(); ++i)
+    {
+        if (series.rollups[i].size == interval)
+        {
+            rollup = &series.rollups[i];
+            break;
+        }
+    }
+
+    uint32_t first = (begin - 1) / interval;
+    uint32_t last = (end - 1) / interval;
+    vector<double> sums(last - first + 1, 0);
+    vector<uint32_t> counts(sums.size(), 0);
+    vector<bool> fromRaw(sums.size(), true);
+    bool needRaw = false;
+
+    // 完整落在查询范围内的时间段直接取预聚合结果
+    for (uint32_t idx = first; idx <= last; ++idx)
+    {
+        if (rollup != NULL && idx * interval + 1 >= begin && (idx + 1) * interval <= end)
+        {
+            sums[idx - first] = rollup->sums[idx];
+            counts[idx - first] = rollup->counts[idx];
+            fromRaw[idx - first] = false;
+        }
+        else
+        {
+            needRaw = true;
+        }
+    }
+
+    if (needRaw)
+    {
+        vector<TsPoint> raw;
+        if (!series.chunk.decode(raw))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < raw.size(); ++i)
+        {
+            if (raw[i].time < begin || raw[i].time > end)
+            {
+                continue;
+            }
+            uint32_t idx = (raw[i].time - 1) / interval - first;
+            if (fromRaw[idx])
+            {
+                sums[idx] += raw[i].value;
+                ++counts[idx];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < sums.size(); ++i)
+    {
+        if (counts[i] > 0)
+        {
+            uint32_t time = std::min(uint32_t((first + i + 1) * interval), MINUTES_PER_DAY);
+            points.push_back(TsPoint(time, sums[i]));
+        }
+    }
+    return true;
+}
+
+void TimeSeriesStore::listSeries(const string &date, const string &prefix, vector<string> &keys) const
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    map<string, DayData>::const_iterator itDay = _days.find(date);
+    if (itDay == _days.end())
+    {
+        return;
+    }
+
+    DayData::const_iterator it = itDay->second.lower_bound(prefix);
+    for (; it != itDay->second.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+    {
+        keys.push_back(it->first);
+    }
+}
+
+string TimeSeriesStore::desc() const
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    ostringstream os;
+    os << "path:" << _path << "|retention days:" << _retentionDays << "|live:" << _liveDate
+       << "|complete days:" << _completeDays.size() << "|rollups:";
+    for (size_t i = 0; i < _rollupSizes.size(); ++i)
+    {
+        os << (i == 0 ? "" : ",") << _rollupSizes[i];
+    }
+
+    map<string, DayData>::const_iterator itDay;
+    for (itDay = _days.begin(); itDay != _days.end(); ++itDay)
+    {
+        size_t points = 0, bytes = 0;
+        for (DayData::const_iterator it = itDay->second.begin(); it != itDay->second.end(); ++it)
+        {
+            points += it->second.chunk.count();
+            bytes += it->second.chunk.writer().bytes().size();
+        }
+        os << "|" << itDay->first << ":" << itDay->second.size() << " series," << points << " points," << bytes
+           << " bytes";
+    }
+    return os.str();
+}
+
+string TimeSeriesStore::dataFile(const string &date) const
+{
+    return _path + "/" + date + "." + TSDB_FILE_EXT;
+}
+
+string TimeSeriesStore::logFile(const string &date) const
+{
+    return _path + "/" + date + "." + TSDB_LOG_EXT;
+}
+
+string TimeSeriesStore::completeFile(const string &date) const
+{
+    return _path + "/" + date + "." + TSDB_COMPLETE_EXT;
+}
+
+int TimeSeriesStore::flagToMinute(const string &flag)
+{
+    if (flag.length() != 4 || !TC_Common::isdigit(flag))
+    {
+        return -1;
+    }
+
+    int hour = TC_Common::strto<int>(flag.substr(0, 2));
+    int minute = TC_Common::strto<int>(flag.substr(2, 2));
+    if (minute > 60 || hour * 60 + minute > int(MINUTES_PER_DAY))
+    {
+        return -1;
+    }
+    return hour * 60 + minute;
+}
+
+string TimeSeriesStore::minuteToFlag(uint32_t minute)
+{
+    // 整点写作上一小时的60分，如9点写作0860
+    uint32_t hour = minute > 0 ? (minute - 1) / 60 : 0;
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%02u%02u", hour, minute - hour * 60);
+    return buf;
+}
@@ -0,0 +1,215 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// 本地的特性数据时序存储。
+// 数据按天组织，每条序列(模块/服务/特性)的时间戳为当天的分钟数(1~1440，与f_tflag一致，0860即540)。
+// 时间戳采用delta-of-delta编码，数值采用Gorilla的XOR编码，固定间隔上报时每个点只需几个bit。
+// 每条序列同时维护若干粒度(如10分钟、1小时)的预聚合结果，按时间段汇总时优先使用预聚合结果。
+// 落盘时每批数据追加到当天的日志文件，定期整理为完整的数据文件并清空日志，加载时先读数据文件再重放日志。
+
+#ifndef __TIME_SERIES_STORE_H_
+#define __TIME_SERIES_STORE_H_
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "util/tc_monitor.h"
+
+using namespace tars;
+using namespace std;
+
+struct TsPoint
+{
+    TsPoint() : time(0), value(0) {}
+    TsPoint(uint32_t t, double v) : time(t), value(v) {}
+
+    uint32_t time;  // 当天的分钟数，数据所属时间段的结束时刻
+    double value;
+};
+
+class BitWriter
+{
+public:
+    BitWriter() : _bitCount(0) {}
+
+    void writeBits(uint64_t value, int bits);
+
+    void writeBit(bool bit) { writeBits(bit ? 1 : 0, 1); }
+
+    const vector<uint8_t> &bytes() const { return _bytes; }
+
+    uint64_t bitCount() const { return _bitCount; }
+
+private:
+    vector<uint8_t> _bytes;
+    uint64_t _bitCount;
+};
+
+class BitReader
+{
+public:
+    BitReader(const vector<uint8_t> &bytes, uint64_t bitCount) : _bytes(bytes), _bitCount(bitCount), _pos(0) {}
+
+    // 读取bits个bit，数据不足时返回false
+    bool readBits(int bits, uint64_t &value);
+
+    bool readBit(bool &bit);
+
+private:
+    const vector<uint8_t> &_bytes;
+    uint64_t _bitCount;
+    uint64_t _pos;
+};
+
+// 一条序列一天内的压缩数据，只能按时间递增追加
+class SeriesChunk
+{
+public:
+    SeriesChunk();
+
+    // 追加一个点，时间不大于最后一个点时返回false
+    bool append(uint32_t time, double value);
+
+    // 解码全部数据点，数据损坏时返回false
+    bool decode(vector<TsPoint> &points) const;
+
+    // 解码从文件中读出的压缩数据
+    static bool decode(const vector<uint8_t> &bytes, uint64_t bitCount, size_t count, vector<TsPoint> &points);
+
+    size_t count() const { return _count; }
+
+    uint32_t lastTime() const { return _lastTime; }
+
+    const BitWriter &writer() const { return _writer; }
+
+private:
+    void appendValue(double value);
+
+private:
+    BitWriter _writer;
+    size_t _count;
+    uint32_t _lastTime;
+    int64_t _lastDelta;
+    uint64_t _lastValue;
+    int _leading;   // 上一个XOR值的前导0个数
+    int _trailing;  // 上一个XOR值的后缀0个数
+};
+
+class TimeSeriesStore
+{
+public:
+    TimeSeriesStore();
+
+    // path: 数据文件目录，为空时不落盘
+    // retentionDays: 保留的天数
+    // rollups: 预聚合粒度(分钟)
+    void init(const string &path, int retentionDays, const vector<uint32_t> &rollups);
+
+    // 加载数据目录中保留期内的数据文件、日志文件和完整标记
+    int load();
+
+    // 追加某天同一时刻的一批数据，key为序列名，返回成功追加的点数。数据同时追加到当天的日志文件
+    size_t append(const string &date, uint32_t time, const map<string, double> &values);
+
+    // 将某天的数据整理为完整的数据文件，成功后清空当天的日志
+    int save(const string &date);
+
+    // 标记某天的数据是完整的(从0点起到次日都在写入)，标记会落盘
+    void markComplete(const string &date);
+
+    // 标记从0点起就在写入的当天，只在内存中记录，进程重启后当天不再完整
+    void markLive(const string &date);
+
+    // 是否有某天完整的数据，不完整的日期应到db查询
+    bool isComplete(const string &date) const;
+
+    // 清除早于cutoffDate(YYYYMMDD)的数据及文件
+    void prune(const string &cutoffDate);
+
+    bool hasDate(const string &date) const;
+
+    // 查询[begin, end]内的数据点，interval为0时返回原始数据，否则按interval分钟汇总
+    // 汇总后的时间戳为所在时间段的结束时刻
+    bool query(const string &date,
+               const string &key,
+               uint32_t begin,
+               uint32_t end,
+               uint32_t interval,
+               vector<TsPoint> &points) const;
+
+    // 汇总[begin, end]内的数据，序列不存在时返回false
+    bool sum(const string &date, const string &key, uint32_t begin, uint32_t end, double &value) const;
+
+    // 列出某天以prefix开头的序列名
+    void listSeries(const string &date, const string &prefix, vector<string> &keys) const;
+
+    string desc() const;
+
+    // 由f_tflag(如0860)得到分钟数，非法时返回-1
+    static int flagToMinute(const string &flag);
+
+    static string minuteToFlag(uint32_t minute);
+
+protected:
+    struct Rollup
+    {
+        uint32_t size;
+        vector<double> sums;
+        vector<uint32_t> counts;
+    };
+
+    struct Series
+    {
+        SeriesChunk chunk;
+        vector<Rollup> rollups;
+    };
+
+    typedef map<string, Series> DayData;
+
+    bool appendNoLock(DayData &day, const string &key, uint32_t time, double value);
+
+    bool queryNoLock(const Series &series,
+                     uint32_t begin,
+                     uint32_t end,
+                     uint32_t interval,
+                     vector<TsPoint> &points) const;
+
+    const Series *findNoLock(const string &date, const string &key) const;
+
+    int loadFile(const string &date, const string &file);
+
+    // 重放日志文件，末尾不完整的记录(写入时进程退出)忽略
+    int loadLog(const string &date, const string &file);
+
+    int appendLog(const string &date, uint32_t time, const map<string, double> &values);
+
+    string dataFile(const string &date) const;
+
+    string logFile(const string &date) const;
+
+    string completeFile(const string &date) const;
+
+protected:
+    static const uint32_t MINUTES_PER_DAY = 1440;
+
+    mutable TC_ThreadLock _lock;
+    string _path;
+    int _retentionDays;
+    vector<uint32_t> _rollupSizes;
+    map<string, DayData> _days;
+    set<string> _completeDays;  // 数据完整的日期
+    string _liveDate;           // 从0点起就在写入的当天
+};
+
+#endif
@@ -828,6 +828,108 @@ struct GetAllKeysCallback : public CachePrxCallback, public CacheCallbackComm
     BatchCallParamPtr _param;
 };
 
+struct ScanKeysCallback : public CachePrxCallback, public CacheCallbackComm
+{
+    ScanKeysCallback(TarsCurrentPtr &current,
+                     BatchCallParamPtr &param,
+                     const ScanKeysReq &req,
+                     const string &objectName,
+                     const string &groupName,
+                     const int64_t beginTime,
+                     const string &idcArea = "",
+                     const bool repeatFlag = false)
+        : CacheCallbackComm(current, req.moduleName, objectName, beginTime, repeatFlag), _req(req), _groupName(groupName), _idcArea(idcArea), _param(param)
+    {
+    }
+    virtual ~ScanKeysCallback() {}
+
+    virtual void callback_scanKeys(int ret, const ScanKeysRsp &rsp)
+    {
+        CacheBatchCallParam<ScanKeysRsp> *param = (CacheBatchCallParam<ScanKeysRsp> *)_param.get();
+        const string &caller = _current->getContext()[CONTEXT_CALLER];
+
+        if (param->_end)
+        {
+            return;
+        }
+
+        if (ret == ET_SUCC)
+        {
+            {
+                TC_ThreadLock::Lock lock(_param->_lock);
+                param->_rsp.keys.insert(param->_rsp.keys.end(), rsp.keys.begin(), rsp.keys.end());
+                //cursor为0表示该组已遍历完
+                if (rsp.cursor != 0)
+                {
+                    param->_rsp.groupCursor[_groupName] = rsp.cursor;
+                }
+            }
+
+            if ((--param->_count) <= 0)
+            {
+                param->_rsp.isEnd = param->_rsp.groupCursor.empty();
+                ResponserPtr responser = make_responser(&Proxy::async_response_scanKeys, param->_rsp);
+
+                doResponse(ret, caller, SUCC, responser);
+
+                param->_end = true;
+            }
+        }
+        else
+        {
+            FDLOG("CBError") << caller << "|module:" << _req.moduleName << "|object:" << _objectName << "|ret:" << ret << endl;
+
+            reportException("CBError");
+
+            if (param->setEnd())
+            {
+                ScanKeysRsp tmpRsp;
+                ResponserPtr responser = make_responser(&Proxy::async_response_scanKeys, tmpRsp);
+
+                ret = (ret == ET_SYS_ERR) ? ET_CACHE_ERR : ret;
+
+                doResponse(ret, caller, SUCC, responser);
+            }
+        }
+    }
+
+    virtual void callback_scanKeys_exception(int ret)
+    {
+        CacheBatchCallbackExcDo(_req.moduleName, _objectName, ret, &Proxy::async_response_scanKeys);
+    }
+
+    void procExceptionCall(const int ret, void (*resmf)(TarsCurrentPtr, int, const ScanKeysRsp &))
+    {
+        const string &caller = _current->getContext()[CONTEXT_CALLER];
+
+        FDLOG("CBError") << caller << "|module:" << _req.moduleName << "|object:" << _objectName << "|errno:" << ret << endl;
+
+        reportException("CBError");
+
+        CacheBatchCallParam<ScanKeysRsp> *param = (CacheBatchCallParam<ScanKeysRsp> *)_param.get();
+        if (param->setEnd())
+        {
+            ScanKeysRsp rsp;
+            ResponserPtr responser = make_responser(resmf, rsp);
+
+            if (ret == CALLTIMEOUT)
+            {
+                doResponse(ET_CACHE_ERR, caller, TIME_OUT, responser);
+            }
+            else
+            {
+                doResponse(ET_CACHE_ERR, caller, EXCE, responser);
+            }
+        }
+    }
+
+  private:
+    ScanKeysReq _req;
+    string _groupName;
+    string _idcArea;
+    BatchCallParamPtr _param;
+};
+
 //////////////////////////////////////////////////////////////////////////
 
 template <typename Response>
@@ -842,10 +944,21 @@ struct WCacheBatchCallParam : public BatchCallParamComm
         _rsp.keyResult.insert(keyResult.begin(), keyResult.end());
     }
 
+    // 合并keyResult以外的返回字段，默认没有
+    void addExtra(const Response &rsp) {}
+
     bool allWriteSucc;
     Response _rsp;
 };
 
+template <>
+inline void WCacheBatchCallParam<UpdateKVBatchRsp>::addExtra(const UpdateKVBatchRsp &rsp)
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    _rsp.retValue.insert(rsp.retValue.begin(), rsp.retValue.end());
+}
+
 template <typename Request, typename Response, typename ClassName>
 struct ProcWCacheBatchCallback : public CacheCallbackComm
 {
@@ -917,6 +1030,7 @@ struct ProcWCacheBatchCallback : public CacheCallbackComm
         }
 
         param->addResult(keyResult);
+        param->addExtra(rsp);
 
         if ((--param->_count) <= 0)
         {
@@ -1094,6 +1208,30 @@ struct SetKVBatchCallback : public ProcWCacheBatchCallback<SetKVBatchReq, SetKVB
     }
 };
 
+struct UpdateKVBatchCallback : public ProcWCacheBatchCallback<UpdateKVBatchReq, UpdateKVBatchRsp, UpdateKVBatchCallback>, public WCachePrxCallback
+{
+
+    UpdateKVBatchCallback(TarsCurrentPtr &current,
+                          BatchCallParamPtr &param,
+                          const UpdateKVBatchReq &req,
+                          const string &objectName,
+                          const int64_t beginTime,
+                          const bool repeatFlag = false)
+        : ProcWCacheBatchCallback<UpdateKVBatchReq, UpdateKVBatchRsp, UpdateKVBatchCallback>(current, param, req, objectName, beginTime, repeatFlag)
+    {
+    }
+    virtual ~UpdateKVBatchCallback() {}
+    virtual void callback_updateKVBatch(int ret, const UpdateKVBatchRsp &rsp)
+    {
+        WCacheBatchCallbackDo(ret, rsp, &WCacheProxy::async_updateKVBatch, &Proxy::async_response_updateKVBatch);
+    }
+
+    virtual void callback_updateKVBatch_exception(int ret)
+    {
+        WCacheBatchCallbackExcDo(_req.moduleName, _objectName, ret, &Proxy::async_response_updateKVBatch);
+    }
+};
+
 struct EraseKVBatchCallback : public ProcWCacheBatchCallback<RemoveKVBatchReq, RemoveKVBatchRsp, EraseKVBatchCallback>, public WCachePrxCallback
 {
 
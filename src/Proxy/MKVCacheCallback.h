@@ -684,6 +684,37 @@ struct PopListCallback : public ProcMKWCacheCallback<PopListReq, PopListCallback
     }
 };
 
+struct ExecMKVCallback : public ProcMKWCacheCallback<ExecMKVReq, ExecMKVCallback>, public MKWCachePrxCallback
+{
+    ExecMKVCallback(TarsCurrentPtr &current,
+                    const ExecMKVReq &req,
+                    const string &objectName,
+                    const int64_t beginTime,
+                    const bool repeatFlag = false)
+        : ProcMKWCacheCallback<ExecMKVReq, ExecMKVCallback>(current, req, req.mainKey, objectName, beginTime, repeatFlag)
+    {
+    }
+    virtual ~ExecMKVCallback() {}
+    virtual void callback_execMKV(int ret, const MKVBatchWriteRsp &rsp)
+    {
+        MKCacheCallbackLog(MKWCacheCallback, _req.moduleName, _mainKey, _objectName, ret);
+
+        ResponserPtr responser = make_responser(&Proxy::async_response_execMKV, rsp);
+
+        procCallback(_mainKey, ret, &MKWCacheProxy::async_execMKV, responser);
+    }
+
+    virtual void callback_execMKV_exception(int ret)
+    {
+        MKCacheCallbackExcLog(MKWCacheCallback, _req.moduleName, _mainKey, _objectName, ret);
+
+        MKVBatchWriteRsp rsp;
+        ResponserPtr responser = make_responser(&Proxy::async_response_execMKV, rsp);
+
+        procExceptionCall(_mainKey, ret, responser);
+    }
+};
+
 struct ReplaceListCallback : public ProcMKWCacheCallback<ReplaceListReq, ReplaceListCallback>, public MKWCachePrxCallback
 {
     ReplaceListCallback(TarsCurrentPtr &current,
@@ -1423,6 +1454,81 @@ struct GetAllMainKeyCallback : public ProcMKCacheBatchCallback<GetAllKeysReq, Ge
     }
 };
 
+struct ScanMainKeyCallback : public ProcMKCacheBatchCallback<ScanKeysReq, ScanKeysRsp, ScanMainKeyCallback>, public MKCachePrxCallback
+{
+
+    ScanMainKeyCallback(TarsCurrentPtr &current,
+                        BatchCallParamPtr &param,
+                        const ScanKeysReq &req,
+                        const string &objectName,
+                        const string &groupName,
+                        const int64_t beginTime,
+                        const string &idcArea = "",
+                        const bool repeatFlag = false)
+        : ProcMKCacheBatchCallback<ScanKeysReq, ScanKeysRsp, ScanMainKeyCallback>(current, param, req, objectName, beginTime, idcArea, repeatFlag), _groupName(groupName)
+    {
+    }
+    virtual ~ScanMainKeyCallback() {}
+
+    virtual void callback_scanMainKey(int ret, const ScanKeysRsp &rsp)
+    {
+        MKCacheBatchCallParam<ScanKeysRsp> *param = (MKCacheBatchCallParam<ScanKeysRsp> *)(_param.get());
+
+        if (param->_end)
+        {
+            return;
+        }
+
+        const string &caller = _current->getContext()[CONTEXT_CALLER];
+
+        if (ret == ET_SUCC)
+        {
+            {
+                TC_ThreadLock::Lock lock(param->_lock);
+                param->_rsp.keys.insert(param->_rsp.keys.end(), rsp.keys.begin(), rsp.keys.end());
+                //cursor为0表示该组已遍历完
+                if (rsp.cursor != 0)
+                {
+                    param->_rsp.groupCursor[_groupName] = rsp.cursor;
+                }
+            }
+
+            if ((--param->_count) <= 0)
+            {
+                param->_rsp.isEnd = param->_rsp.groupCursor.empty();
+                ResponserPtr responser = make_responser(&Proxy::async_response_scanMainKey, param->_rsp);
+                doResponse(ret, caller, SUCC, responser);
+
+                param->_end = true;
+            }
+        }
+        else
+        {
+            FDLOG("CBError") << caller << "|module:" << _req.moduleName << "|object:" << _objectName << "|ret:" << ret << endl;
+
+            reportException("CBError");
+
+            if (param->setEnd())
+            {
+                ScanKeysRsp tmpRsp;
+                ResponserPtr responser = make_responser(&Proxy::async_response_scanMainKey, tmpRsp);
+
+                ret = (ret == ET_SYS_ERR) ? ET_CACHE_ERR : ret;
+
+                doResponse(ret, caller, SUCC, responser);
+            }
+        }
+    }
+
+    virtual void callback_scanMainKey_exception(int ret)
+    {
+        MKCacheBatchCallbackExcDo(_req.moduleName, _objectName, ret, &Proxy::async_response_scanMainKey);
+    }
+
+  private:
+    string _groupName;
+};
+
 //////////////////////////////////////////////////////////////////////////
 
 template <typename Request>
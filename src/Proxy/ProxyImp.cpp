@@ -499,6 +499,105 @@ int ProxyImp::setKVBatch(const SetKVBatchReq &req, SetKVBatchRsp &rsp, TarsCurre
     return ET_SUCC;
 }
 
+int ProxyImp::updateKVBatch(const UpdateKVBatchReq &req, UpdateKVBatchRsp &rsp, TarsCurrentPtr current)
+{
+    const string moduleName = req.moduleName;
+    const vector<SSetKeyValue> &keyValue = req.data;
+
+    map<string, string> &context = current->getContext();
+    if (!context.count(CONTEXT_CALLER))
+    {
+        context[CONTEXT_CALLER] = "updateKVBatch";
+        if (_printWriteLog && _printLogModules.count(moduleName) && keyValue.size() > 0)
+        {
+            FDLOG("updateKV") << keyValue[0].keyItem << "|" << __FUNCTION__ << "|" << keyValue.size() << "|" << moduleName << endl;
+        }
+    }
+
+    //检查key的数量在限制范围内
+    size_t keyCount = keyValue.size();
+    logBatchCount(moduleName, context[CONTEXT_CALLER], keyCount);
+    if (checkKeyCount(keyCount))
+    {
+        TLOGERROR("[ProxyImp::updateKVBatch] keyCount for batch  out of limit, moduleName:" << moduleName << " keyCount:" << keyCount << endl);
+        return ET_INPUT_PARAM_ERROR;
+    }
+
+    map<string, UpdateKVBatchReq> mProxyKeyItem;
+    map<string, WCachePrx> mProxyCachePrx;
+    string objectName;
+    WCachePrx prxWCache;
+    for (size_t i = 0; i < keyValue.size(); i++)
+    {
+        string key = keyValue[i].keyItem;
+        if (key.empty())
+        {
+            TLOGERROR("The Key can not be empty.|moduleName=" << moduleName << "|CALLER=" << context[CONTEXT_CALLER] << endl);
+            return ET_INPUT_PARAM_ERROR;
+        }
+        int ret = _cacheProxyFactory->getWCacheProxy(moduleName, key, objectName, prxWCache);
+        if (ret != ET_SUCC)
+        {
+            rsp.keyResult[key] = ret;
+            continue;
+        }
+        mProxyKeyItem[objectName].data.push_back(keyValue[i]);
+        mProxyCachePrx[objectName] = prxWCache;
+    }
+
+    if (mProxyKeyItem.empty())
+    {
+        rsp.keyResult.clear();
+        return ET_KEY_INVALID;
+    }
+
+    BatchCallParamPtr pParam = new WCacheBatchCallParam<UpdateKVBatchRsp>(mProxyKeyItem.size());
+
+    if (!rsp.keyResult.empty())
+    {
+        ((WCacheBatchCallParam<UpdateKVBatchRsp> *)(pParam.get()))->addResult(rsp.keyResult);
+    }
+
+    current->setResponse(false);
+    map<string, UpdateKVBatchReq>::iterator mIt = mProxyKeyItem.begin();
+    for (; mIt != mProxyKeyItem.end(); ++mIt)
+    {
+        try
+        {
+            string objectName = mIt->first;
+            UpdateKVBatchReq &partReq = mIt->second;
+            partReq.moduleName = moduleName;
+            partReq.option = req.option;
+            WCachePrxCallbackPtr cb = new UpdateKVBatchCallback(current, pParam, partReq, objectName, TNOWMS);
+            mProxyCachePrx[objectName]->async_updateKVBatch(cb, partReq);
+            continue;
+        }
+        catch (exception &e)
+        {
+            TLOGERROR("[ProxyImp::updateKVBatch] exception:" << e.what() << endl);
+        }
+        catch (...)
+        {
+            TLOGERROR("[ProxyImp::updateKVBatch] UnkownException" << endl);
+        }
+
+        UpdateKVBatchRsp tempRsp;
+        for (size_t i = 0; i < mIt->second.data.size(); i++)
+        {
+            tempRsp.keyResult[(mIt->second.data)[i].keyItem] = ET_SYS_ERR;
+        }
+        WCacheBatchCallParam<UpdateKVBatchRsp> *tmpParam = (WCacheBatchCallParam<UpdateKVBatchRsp> *)(pParam.get());
+        tmpParam->addResult(tempRsp.keyResult);
+
+        if ((--pParam->_count) <= 0)
+        {
+            Proxy::async_response_updateKVBatch(current, ET_PARTIAL_FAIL, tmpParam->_rsp);
+        }
+    }
+
+    return ET_SUCC;
+}
+
 int ProxyImp::updateKV(const UpdateKVReq &req, UpdateKVRsp &rsp, TarsCurrentPtr current)
 {
     const string &moduleName = req.moduleName;
@@ -1837,6 +1936,102 @@ int ProxyImp::getAllKeys(const GetAllKeysReq &req, GetAllKeysRsp &rsp, TarsCurre
     return ET_SYS_ERR;
 }
 
+int ProxyImp::scanKeys(const ScanKeysReq &req, ScanKeysRsp &rsp, TarsCurrentPtr current)
+{
+    const string &moduleName = req.moduleName;
+
+    TLOGDEBUG("ProxyImp::" << __FUNCTION__ << ", moduleName = " << moduleName << ", count = " << req.count << ", match = " << req.match << ", groupCursor size = " << req.groupCursor.size() << ", from ip = " << current->getIp() << endl);
+
+    map<string, string> &context = current->getContext();
+    if (!context.count(CONTEXT_CALLER))
+    {
+        context[CONTEXT_CALLER] = "scanKeys";
+    }
+
+    string idcArea = _idcArea;
+    if (!req.idcSpecified.empty())
+    {
+        idcArea = req.idcSpecified;
+    }
+
+    RouterTableInfo *pRouterTableInfo = g_app._routerTableInfoFactory->getRouterTableInfo(moduleName);
+    if (pRouterTableInfo == NULL)
+    {
+        TLOGDEBUG("[ProxyImp::scanKeys] do not support moduleName: " << moduleName << endl);
+        return ET_MODULE_NAME_INVALID;
+    }
+    RouterTable &routerTable = pRouterTableInfo->getRouterTable();
+
+    vector<ServerInfo> servers;
+    if (routerTable.getAllIdcServer(idcArea, servers) < 0)
+    {
+        TLOGERROR("[ProxyImp::scanKeys] get idc server error!" << endl);
+        return ET_SYS_ERR;
+    }
+
+    //groupCursor为空表示第一次调用，所有组都从头开始；否则只继续遍历还没结束的组
+    vector<pair<ServerInfo, int64_t> > targets;
+    for (size_t i = 0; i < servers.size(); i++)
+    {
+        const string &groupName = servers[i].groupName.empty() ? servers[i].serverName : servers[i].groupName;
+        if (req.groupCursor.empty())
+        {
+            targets.push_back(make_pair(servers[i], 0));
+        }
+        else
+        {
+            map<string, int64_t>::const_iterator it = req.groupCursor.find(groupName);
+            if (it != req.groupCursor.end())
+            {
+                targets.push_back(make_pair(servers[i], it->second));
+            }
+        }
+    }
+
+    if (targets.empty())
+    {
+        rsp.isEnd = true;
+        return ET_SUCC;
+    }
+
+    BatchCallParamPtr pParam = new CacheBatchCallParam<ScanKeysRsp>(targets.size());
+
+    current->setResponse(false);
+    try
+    {
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            const ServerInfo &server = targets[i].first;
+            const string &groupName = server.groupName.empty() ? server.serverName : server.groupName;
+            string objectName = server.CacheServant;
+
+            ScanKeysReq subReq = req;
+            subReq.cursor = targets[i].second;
+            subReq.groupCursor.clear();
+
+            CachePrxCallbackPtr cb = new ScanKeysCallback(current, pParam, subReq, objectName, groupName, TNOWMS, idcArea);
+            CachePrx prxCache = _cacheProxyFactory->getProxy<CachePrx>(objectName);
+            prxCache->async_scanKeys(cb, subReq);
+        }
+        return ET_SUCC;
+    }
+    catch (exception &ex)
+    {
+        TLOGERROR("[ProxyImp::scanKeys] exception: " << ex.what() << endl);
+    }
+    catch (...)
+    {
+        TLOGERROR("[ProxyImp::scanKeys] unkown exception" << endl);
+    }
+    CacheBatchCallParam<ScanKeysRsp> *tmpParam = (CacheBatchCallParam<ScanKeysRsp> *)(pParam.get());
+    if (tmpParam->setEnd())
+    {
+        ScanKeysRsp tempRsp;
+        Proxy::async_response_scanKeys(current, ET_SYS_ERR, tempRsp);
+    }
+    return ET_SYS_ERR;
+}
+
 int ProxyImp::getAllMainKey(const GetAllKeysReq &req, GetAllKeysRsp &rsp, TarsCurrentPtr current)
 {
     const string &moduleName = req.moduleName;
@@ -1903,6 +2098,102 @@ int ProxyImp::getAllMainKey(const GetAllKeysReq &req, GetAllKeysRsp &rsp, TarsCu
     return ET_SYS_ERR;
 }
 
+int ProxyImp::scanMainKey(const ScanKeysReq &req, ScanKeysRsp &rsp, TarsCurrentPtr current)
+{
+    const string &moduleName = req.moduleName;
+
+    TLOGDEBUG("ProxyImp::" << __FUNCTION__ << ", moduleName = " << moduleName << ", count = " << req.count << ", match = " << req.match << ", groupCursor size = " << req.groupCursor.size() << ", from ip = " << current->getIp() << endl);
+
+    map<string, string> &context = current->getContext();
+    if (!context.count(CONTEXT_CALLER))
+    {
+        context[CONTEXT_CALLER] = "scanMainKey";
+    }
+
+    string idcArea = _idcArea;
+    if (!req.idcSpecified.empty())
+    {
+        idcArea = req.idcSpecified;
+    }
+
+    RouterTableInfo *pRouterTableInfo = g_app._routerTableInfoFactory->getRouterTableInfo(moduleName);
+    if (pRouterTableInfo == NULL)
+    {
+        TLOGDEBUG("[ProxyImp::scanMainKey] do not support moduleName: " << moduleName << endl);
+        return ET_MODULE_NAME_INVALID;
+    }
+    RouterTable &routerTable = pRouterTableInfo->getRouterTable();
+
+    vector<ServerInfo> servers;
+    if (routerTable.getAllIdcServer(idcArea, servers) < 0)
+    {
+        TLOGERROR("[ProxyImp::scanMainKey] get idc server error!" << endl);
+        return ET_SYS_ERR;
+    }
+
+    //groupCursor为空表示第一次调用，所有组都从头开始；否则只继续遍历还没结束的组
+    vector<pair<ServerInfo, int64_t> > targets;
+    for (size_t i = 0; i < servers.size(); i++)
+    {
+        const string &groupName = servers[i].groupName.empty() ? servers[i].serverName : servers[i].groupName;
+        if (req.groupCursor.empty())
+        {
+            targets.push_back(make_pair(servers[i], 0));
+        }
+        else
+        {
+            map<string, int64_t>::const_iterator it = req.groupCursor.find(groupName);
+            if (it != req.groupCursor.end())
+            {
+                targets.push_back(make_pair(servers[i], it->second));
+            }
+        }
+    }
+
+    if (targets.empty())
+    {
+        rsp.isEnd = true;
+        return ET_SUCC;
+    }
+
+    BatchCallParamPtr pParam = new MKCacheBatchCallParam<ScanKeysRsp>(targets.size());
+
+    current->setResponse(false);
+    try
+    {
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            const ServerInfo &server = targets[i].first;
+            const string &groupName = server.groupName.empty() ? server.serverName : server.groupName;
+            string objectName = server.CacheServant;
+
+            ScanKeysReq subReq = req;
+            subReq.cursor = targets[i].second;
+            subReq.groupCursor.clear();
+
+            MKCachePrxCallbackPtr cb = new ScanMainKeyCallback(current, pParam, subReq, objectName, groupName, TNOWMS, idcArea);
+            MKCachePrx prxMKCache = _cacheProxyFactory->getProxy<MKCachePrx>(objectName);
+            prxMKCache->async_scanMainKey(cb, subReq);
+        }
+        return ET_SUCC;
+    }
+    catch (exception &ex)
+    {
+        TLOGERROR("[ProxyImp::scanMainKey] exception: " << ex.what() << endl);
+    }
+    catch (...)
+    {
+        TLOGERROR("[ProxyImp::scanMainKey] unkown exception" << endl);
+    }
+    MKCacheBatchCallParam<ScanKeysRsp> *tmpParam = (MKCacheBatchCallParam<ScanKeysRsp> *)(pParam.get());
+    if (tmpParam->setEnd())
+    {
+        ScanKeysRsp tempRsp;
+        Proxy::async_response_scanMainKey(current, ET_SYS_ERR, tempRsp);
+    }
+    return ET_SYS_ERR;
+}
+
 int ProxyImp::getRangeList(const GetRangeListReq &req, BatchEntry &rsp, TarsCurrentPtr current)
 {
     const string &moduleName = req.moduleName;
@@ -2260,6 +2551,51 @@ int ProxyImp::getZSetByScore(const GetZsetByScoreReq &req, BatchEntry &rsp, Tars
     return ET_SUCC;
 }
 
+int ProxyImp::execMKV(const ExecMKVReq &req, MKVBatchWriteRsp &rsp, TarsCurrentPtr current)
+{
+    const string &moduleName = req.moduleName;
+    const string &mainKey = req.mainKey;
+    TLOGDEBUG("ProxyImp::execMKV: " << moduleName << "|" << mainKey << "|" << req.ops.size() << " masterip: " << current->getIp() << endl);
+
+    map<string, string> &context = current->getContext();
+    if (!context.count(CONTEXT_CALLER))
+    {
+        context[CONTEXT_CALLER] = "execMKV";
+        if (_printWriteLog && _printLogModules.count(moduleName))
+        {
+            FDLOG("execMKV") << mainKey << "|" << __FUNCTION__ << "|" << req.ops.size() << "|" << moduleName << endl;
+        }
+    }
+
+    if (mainKey.empty())
+    {
+        TLOGERROR("The Key can not be empty.|moduleName=" << moduleName << "|CALLER=" << context[CONTEXT_CALLER] << endl);
+        return ET_INPUT_PARAM_ERROR;
+    }
+
+    MKWCachePrx prxMKWCache;
+    string objectName;
+    int ret = _cacheProxyFactory->getWCacheProxy(moduleName, mainKey, objectName, prxMKWCache);
+    if (ret != ET_SUCC)
+    {
+        return ret;
+    }
+
+    current->setResponse(false);
+    try
+    {
+        MKWCachePrxCallbackPtr cb = new ExecMKVCallback(current, req, objectName, TNOWMS);
+        prxMKWCache->async_execMKV(cb, req);
+    }
+    catch (exception &ex)
+    {
+        TLOGERROR("[ProxyImp::execMKV] async_execMKV exception: " << ex.what() << endl);
+        current->setResponse(true);
+        return ET_SYS_ERR;
+    }
+    return ET_SUCC;
+}
+
 int ProxyImp::pushList(const PushListReq &req, TarsCurrentPtr current)
 {
     const string &moduleName = req.moduleName;
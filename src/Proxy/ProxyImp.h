@@ -56,6 +56,8 @@ class ProxyImp : public Proxy
 
     virtual int getAllKeys(const GetAllKeysReq &req, GetAllKeysRsp &rsp, TarsCurrentPtr current);
 
+    virtual int scanKeys(const ScanKeysReq &req, ScanKeysRsp &rsp, TarsCurrentPtr current);
+
     virtual int setKV(const SetKVReq &req, TarsCurrentPtr current);
 
     virtual int updateKV(const UpdateKVReq &req, UpdateKVRsp &rsp, TarsCurrentPtr current);
@@ -68,6 +70,8 @@ class ProxyImp : public Proxy
 
     virtual int setKVBatch(const SetKVBatchReq &req, SetKVBatchRsp &rsp, TarsCurrentPtr current);
 
+    virtual int updateKVBatch(const UpdateKVBatchReq &req, UpdateKVBatchRsp &rsp, TarsCurrentPtr current);
+
     virtual int delKVBatch(const RemoveKVBatchReq &req, RemoveKVBatchRsp &rsp, TarsCurrentPtr current);
 
     virtual int eraseKVBatch(const RemoveKVBatchReq &req, RemoveKVBatchRsp &rsp, TarsCurrentPtr current);
@@ -85,6 +89,8 @@ class ProxyImp : public Proxy
 
     virtual int getAllMainKey(const GetAllKeysReq &req, GetAllKeysRsp &rsp, TarsCurrentPtr current);
 
+    virtual int scanMainKey(const ScanKeysReq &req, ScanKeysRsp &rsp, TarsCurrentPtr current);
+
     virtual int getList(const GetListReq &req, GetListRsp &rsp, TarsCurrentPtr current);
 
     virtual int getRangeList(const GetRangeListReq &req, BatchEntry &rsp, TarsCurrentPtr current);
@@ -115,6 +121,8 @@ class ProxyImp : public Proxy
 
     virtual int delMKVBatch(const DelMKVBatchReq &req, MKVBatchWriteRsp &rsp, TarsCurrentPtr current);
 
+    virtual int execMKV(const ExecMKVReq &req, MKVBatchWriteRsp &rsp, TarsCurrentPtr current);
+
     virtual int pushList(const PushListReq &req, TarsCurrentPtr current);
 
     virtual int popList(const PopListReq &req, PopListRsp &rsp, TarsCurrentPtr current);
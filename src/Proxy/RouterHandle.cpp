@@ -102,6 +102,33 @@ int RouterHandle::getRouterInfo(const string &moduleName, PackTable &packTable,
     return 0;
 }
 
+int RouterHandle::getRouterDelta(const string &moduleName, int fromVersion, RouterDelta &delta)
+{
+    RouterPrx routerPrx;
+    if (getRouterPrx(routerPrx) != 0)
+    {
+        TLOGERROR("[RouterHandle::getRouterDelta] have no useful end_point for " << _routeObj << endl);
+        return -1;
+    }
+
+    try
+    {
+        int iRet = routerPrx->getRouterDelta(moduleName, fromVersion, delta);
+        if (iRet != ROUTER_SUCC && iRet != ROUTER_NEED_FULL)
+        {
+            TLOGERROR("[RouterHandle::getRouterDelta] from " << _routeObj << "@" << routerPrx->tars_invoke_endpoint().getHost() << " for module: " << moduleName << " failed, ret = " << iRet << endl);
+        }
+        return iRet;
+    }
+    catch (const exception &ex)
+    {
+        // 不支持增量路由的RouterServer也会走到这里，由调用者退回全量拉取
+        TLOGERROR("[RouterHandle::getRouterDelta] exception:" << ex.what() << endl);
+    }
+
+    return -1;
+}
+
 int RouterHandle::getRouterVersion(const string &moduleName, int &version, bool needRetry)
 {
 
@@ -37,6 +37,10 @@ class RouterHandle : public TC_Singleton<RouterHandle>
     // 从路由服务获取某模块的路由表(压缩后)
     virtual int getRouterInfo(const string &moduleName, PackTable &packTable, bool needRetry = false);
 
+    // 从路由服务获取某模块的路由表相对fromVersion的增量
+    // 返回0成功，ROUTER_NEED_FULL表示需要全量拉取，其他失败
+    virtual int getRouterDelta(const string &moduleName, int fromVersion, RouterDelta &delta);
+
     // 从路由服务获取某模块的路由表的最新版本号
     virtual int getRouterVersion(const string &moduleName, int &version, bool needRetry = false);
 
@@ -140,7 +140,24 @@ int RouterTableInfo::updateRouterTableByVersion(int iVersion)
         else
         {
             PackTable packTable;
-            int iRet = _pRouterHandle->getRouterInfo(_moduleName, packTable);
+            int iRet = -1;
+
+            // 优先拉取增量路由，失败时再全量拉取
+            RouterDelta delta;
+            if (_pRouterHandle->getRouterDelta(_moduleName, iCurVersion, delta) == ROUTER_SUCC && delta.toVersion != iCurVersion)
+            {
+                iRet = UnpackTable::applyDelta(_routerTable.getPackTable(), delta, packTable);
+                if (iRet != UnpackTable::RET_SUCC)
+                {
+                    TLOGERROR("[RouterTableInfo::updateRouterTable] apply router delta for module: " << _moduleName << " from version: " << iCurVersion << " failed, ret=" << iRet << endl);
+                }
+            }
+
+            if (iRet != 0)
+            {
+                iRet = _pRouterHandle->getRouterInfo(_moduleName, packTable);
+            }
+
             if (iRet != 0)
             {
                 TLOGERROR("[RouterTableInfo::updateRouterTable] get router info for module: " << _moduleName << " failed" << endl);
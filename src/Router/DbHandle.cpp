@@ -14,6 +14,7 @@
 #include "RouterServer.h"
 #include "SwitchThread.h"
 #include "util/tc_encoder.h"
+#include "BaseHash.h"
 
 extern RouterServer g_app;
 
@@ -402,6 +403,7 @@ int DbHandle::loadRouteToMem()
         _mapPackTables1 = _mapPackTables;
         _mapPackTables = tmpPackTables;
         delete delPackTables;
+        _snapshot.publishAll(*_mapPackTables);
 
         _lastLoadTime = TC_Common::now2us();
     }
@@ -438,6 +440,7 @@ int DbHandle::loadRouteToMem(const string &moduleName)
         {
             TC_ThreadLock::Lock lock(_lock);
             (*_mapPackTables).erase(moduleName);
+            _snapshot.remove(moduleName);
             TLOGERROR(FILE_FUN << "DbHandle::loadRouteToMem no group find moduleName " << moduleName
                                << endl);
             return 0;
@@ -452,6 +455,7 @@ int DbHandle::loadRouteToMem(const string &moduleName)
         (*_mapPackTables)[moduleName].recordList = vRecords;
         (*_mapPackTables)[moduleName].groupList = groupList;
         (*_mapPackTables)[moduleName].serverList = serverList;
+        publishSnapshot(moduleName);
         _lastLoadTime = TC_Common::now2us();
     }
     catch (TC_Mysql_Exception &ex)
@@ -472,7 +476,8 @@ vector<ModuleInfo> DbHandle::getDBModuleList()
 {
     TC_ThreadLock::Lock lock(_dbLock);
 
-    string sSql = "select id, module_name, version, switch_status from t_router_module";
+    // 旧的t_router_module没有hash_type字段，用select *兼容
+    string sSql = "select * from t_router_module";
     TC_Mysql::MysqlData sqlData = _mysql->queryRecord(sSql);
 
     vector<ModuleInfo> vModules;
@@ -483,6 +488,7 @@ vector<ModuleInfo> DbHandle::getDBModuleList()
         info.moduleName = sqlData[i]["module_name"];
         info.version = S2I(sqlData[i]["version"]);
         info.switch_status = S2I(sqlData[i]["switch_status"]);
+        info.hashType = getHashType(sqlData.data()[i]);
         vModules.push_back(info);
     }
 
@@ -494,7 +500,7 @@ ModuleInfo DbHandle::getDBModuleList(const string &moduleName)
     TC_ThreadLock::Lock lock(_dbLock);
 
     string sSql =
-        "select id, module_name, version, switch_status from t_router_module where "
+        "select * from t_router_module where "
         "module_name = '" +
         moduleName + "' order by id asc";
     TC_Mysql::MysqlData sqlData = _mysql->queryRecord(sSql);
@@ -506,11 +512,23 @@ ModuleInfo DbHandle::getDBModuleList(const string &moduleName)
         info.moduleName = moduleName;
         info.version = S2I(sqlData[0]["version"]);
         info.switch_status = S2I(sqlData[0]["switch_status"]);
+        info.hashType = getHashType(sqlData.data()[0]);
     }
 
     return info;
 }
 
+int DbHandle::getHashType(const map<string, string> &record)
+{
+    map<string, string>::const_iterator it = record.find("hash_type");
+    if (it == record.end() || it->second.empty())
+    {
+        return HASH_TYPE_NORMAL;
+    }
+
+    return S2I(it->second);
+}
+
 vector<RecordInfo> DbHandle::getDBRecordList()
 {
     TC_ThreadLock::Lock lock(_dbLock);
@@ -749,15 +767,14 @@ int DbHandle::getRouterInfo(const string &sModuleName,
     int iRet = -1;
 
     version = TRANSFER_CLEAN_VERSION;
-    map<string, PackTable>::const_iterator it;
 
+    // 路由表取快照，无需再持有_lock；持有_transLock保证路由与迁移信息一致
     TC_ThreadLock::Lock lock(_transLock);
-    TC_ThreadLock::Lock lock1(_lock);
 
-    it = _mapPackTables->find(sModuleName);
-    if (it != _mapPackTables->end())
+    RouterSnapshot::PackTablePtr table = _snapshot.get(sModuleName);
+    if (table)
     {
-        packTable = it->second;
+        packTable = *table;
         map<string, ModuleTransferingInfo>::iterator it2 = _mapTransferingInfos.find(sModuleName);
         if (it2 != _mapTransferingInfos.end())
         {
@@ -775,27 +792,13 @@ int DbHandle::getRouterInfo(const string &sModuleName,
 
 int DbHandle::getVersion(const string &sModuleName)
 {
-    int iRet = -1;  // 业务模块不存在
-
-    TC_ThreadLock::Lock lock(_lock);
-    map<string, PackTable>::const_iterator it = _mapPackTables->find(sModuleName);
-    if (it != _mapPackTables->end())
-    {
-        iRet = (it->second).info.version;
-    }
-
-    return iRet;
+    // 业务模块不存在时返回-1
+    return _snapshot.getVersion(sModuleName);
 }
 
 int DbHandle::getVersion(map<string, int> &version)
 {
-    TC_ThreadLock::Lock lock(_lock);
-    map<string, PackTable>::const_iterator it;
-    for (it = _mapPackTables->begin(); it != _mapPackTables->end(); it++)
-    {
-        version[it->first] = it->second.info.version;
-    }
-
+    _snapshot.getVersion(version);
     return 0;
 }
 
@@ -820,16 +823,32 @@ int DbHandle::getSwitchType(const string &sModuleName)
 
 int DbHandle::getPackTable(const string &sModuleName, PackTable &packTable)
 {
-    int iRet = -1;  // 业务模块不存在
-    TC_ThreadLock::Lock lock(_lock);
-    map<string, PackTable>::const_iterator it = _mapPackTables->find(sModuleName);
-    if (it != _mapPackTables->end())
+    RouterSnapshot::PackTablePtr table = _snapshot.get(sModuleName);
+    if (!table)
     {
-        packTable = it->second;
-        iRet = 0;
+        return -1;  // 业务模块不存在
     }
 
-    return iRet;
+    packTable = *table;
+    return 0;
+}
+
+RouterSnapshot::PackTablePtr DbHandle::getPackTablePtr(const string &sModuleName)
+{
+    return _snapshot.get(sModuleName);
+}
+
+void DbHandle::publishSnapshot(const string &moduleName)
+{
+    map<string, PackTable>::const_iterator it = _mapPackTables->find(moduleName);
+    if (it != _mapPackTables->end())
+    {
+        _snapshot.publish(it->second);
+    }
+    else
+    {
+        _snapshot.remove(moduleName);
+    }
 }
 
 bool DbHandle::checkModule(const string &sModuleName)
@@ -1269,6 +1288,7 @@ int DbHandle::insertRouterRecord(const RecordInfo &record)
 int DbHandle::modifyMemRecord(const TransferInfo &transferInfo)
 {
     TC_ThreadLock::Lock lock(_lock);
+    SnapshotPublisher publisher(this, transferInfo.moduleName);
 
     map<string, PackTable>::iterator it = _mapPackTables->find(transferInfo.moduleName);
 
@@ -1318,6 +1338,7 @@ int DbHandle::modifyMemRecord(const TransferInfo &transferInfo)
 int DbHandle::modifyMemRecord2(const TransferInfo &transferInfo)
 {
     TC_ThreadLock::Lock lock(_lock);
+    SnapshotPublisher publisher(this, transferInfo.moduleName);
 
     map<string, PackTable>::iterator it = _mapPackTables->find(transferInfo.moduleName);
 
@@ -1655,6 +1676,7 @@ int DbHandle::defragDbRecord(string &moduleNames,
 int DbHandle::defragMemRecord(const TransferInfo &transferInfo)
 {
     TC_ThreadLock::Lock lock(_lock);
+    SnapshotPublisher publisher(this, transferInfo.moduleName);
 
     map<string, PackTable>::iterator it = _mapPackTables->find(transferInfo.moduleName);
 
@@ -2334,6 +2356,7 @@ int DbHandle::switchMasterAndSlaveInDbAndMem(const string &moduleName,
     {
         TC_ThreadLock::Lock lock(_dbLock);
         TC_ThreadLock::Lock lock1(_lock);
+        SnapshotPublisher publisher(this, moduleName);
         TC_Mysql::RECORD_DATA updateData;
 
         updateData["server_status"] = make_pair(TC_Mysql::DB_STR, "S");
@@ -2613,6 +2636,7 @@ int DbHandle::switchRWDbAndMem(const string &moduleName,
     {
         TC_ThreadLock::Lock lock(_dbLock);
         TC_ThreadLock::Lock lock1(_lock);
+        SnapshotPublisher publisher(this, moduleName);
         TC_Mysql::RECORD_DATA updateData;
 
         updateData["server_status"] = make_pair(TC_Mysql::DB_STR, "S");
@@ -2792,6 +2816,7 @@ int DbHandle::switchReadOnlyInDbAndMem(const string &moduleName, const string &g
     {
         TC_ThreadLock::Lock lock(_dbLock);
         TC_ThreadLock::Lock lock1(_lock);
+        SnapshotPublisher publisher(this, moduleName);
         TC_Mysql::RECORD_DATA updateData;
 
         updateData["access_status"] = make_pair(TC_Mysql::DB_INT, "1");
@@ -2861,6 +2886,7 @@ int DbHandle::switchMirrorInDbAndMem(const string &moduleName,
     {
         TC_ThreadLock::Lock lock(_dbLock);
         TC_ThreadLock::Lock lock1(_lock);
+        SnapshotPublisher publisher(this, moduleName);
         TC_Mysql::RECORD_DATA updateData;
 
         //更新服务组状态
@@ -2966,6 +2992,7 @@ int DbHandle::recoverMirrorInDbAndMem(const string &moduleName,
     {
         TC_ThreadLock::Lock lock(_dbLock);
         TC_ThreadLock::Lock lock1(_lock);
+        SnapshotPublisher publisher(this, moduleName);
         TC_Mysql::RECORD_DATA updateData;
 
         updateData["access_status"] = make_pair(TC_Mysql::DB_INT, "0");
@@ -3068,6 +3095,7 @@ int DbHandle::setServerstatus(const string &moduleName,
 
         TC_ThreadLock::Lock lock(_dbLock);
         TC_ThreadLock::Lock lock1(_lock);
+        SnapshotPublisher publisher(this, moduleName);
         TC_Mysql::RECORD_DATA updateData;
 
         sSql = "where server_name = '" + serverName + "'";
@@ -3159,6 +3187,7 @@ int DbHandle::switchMirrorInDbAndMemByIdc(const string &moduleName,
     {
         TC_ThreadLock::Lock lock(_dbLock);
         TC_ThreadLock::Lock lock1(_lock);
+        SnapshotPublisher publisher(this, moduleName);
         string mirrorMaster, mirrorSlave, masterServer;
         map<string, PackTable>::iterator it = _mapPackTables->find(moduleName);
         if (it != _mapPackTables->end())
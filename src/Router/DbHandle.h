@@ -17,6 +17,7 @@
 #include <pthread.h>
 #include "RouterServerConfig.h"
 #include "RouterShare.h"
+#include "RouterSnapshot.h"
 #include "global.h"
 #include "servant/Application.h"
 #include "util/tc_common.h"
@@ -206,6 +207,12 @@ public:
     /*获取路由信息*/
     virtual int getPackTable(const string &sModuleName, PackTable &packTable);
 
+    /*获取路由信息的只读快照，不加锁也不复制路由表，模块不存在时返回空指针*/
+    virtual RouterSnapshot::PackTablePtr getPackTablePtr(const string &sModuleName);
+
+    /*获取路由快照，备机用它保存从主机同步的路由*/
+    virtual RouterSnapshot &getRouterSnapshot() { return _snapshot; }
+
     /*查看模块是否存在*/
     virtual bool checkModule(const string &sModuleName);
 
@@ -409,6 +416,9 @@ public:
     virtual vector<ModuleInfo> getDBModuleList();
     virtual ModuleInfo getDBModuleList(const string &moduleName);
 
+    /*t_router_module记录中的hash类型，没有hash_type字段时为HASH_TYPE_NORMAL*/
+    static int getHashType(const map<string, string> &record);
+
     /*从数据库获取所有路由记录*/
     virtual vector<RecordInfo> getDBRecordList();
     virtual vector<RecordInfo> getDBRecordList(const string &moduleName);
@@ -451,8 +461,29 @@ public:
     /* Router从SLAVE升级为MASTER时调用，用来重新加载路由信息*/
     virtual void upgrade();
 
+private:
+    /*把模块当前的路由信息发布到快照，调用方需持有_lock*/
+    void publishSnapshot(const string &moduleName);
+
+    /*作用域结束时发布模块的路由快照，定义在_lock的Lock之后，保证发布时仍持有_lock*/
+    class SnapshotPublisher
+    {
+    public:
+        SnapshotPublisher(DbHandle *dbHandle, const string &moduleName)
+            : _dbHandle(dbHandle), _moduleName(moduleName)
+        {
+        }
+
+        ~SnapshotPublisher() { _dbHandle->publishSnapshot(_moduleName); }
+
+    private:
+        DbHandle *_dbHandle;
+        string _moduleName;
+    };
+
 private:
     map<string, PackTable> *_mapPackTables;  // 业务模块名，打包的路由信息
+    RouterSnapshot _snapshot;                // _mapPackTables的只读快照，在_lock内随修改发布
     TC_ThreadLock _lock;                     // 数据库配置加载锁
     map<string, map<string, TransferInfo>> _mapTransferInfos;  // 每个模块当前的迁移记录
     map<string, ModuleTransferingInfo> _mapTransferingInfos;  // 每个模块当前处于迁移状态信息
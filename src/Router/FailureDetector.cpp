@@ -0,0 +1,132 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include "FailureDetector.h"
+
+FailureDetector::FailureDetector()
+    : _windowSize(DEFAULT_WINDOW_SIZE), _minStdDevMs(100), _maxIntervalMs(60000)
+{
+}
+
+void FailureDetector::setParam(size_t windowSize, int64_t minStdDevMs, int64_t maxIntervalMs)
+{
+    TC_ThreadLock::Lock lock(_lock);
+    _windowSize = windowSize > MIN_SAMPLES ? windowSize : DEFAULT_WINDOW_SIZE;
+    _minStdDevMs = minStdDevMs > 0 ? minStdDevMs : 1;
+    _maxIntervalMs = maxIntervalMs;
+}
+
+void FailureDetector::heartbeat(const string &serverName, int64_t nowMs)
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    History &history = _history[serverName];
+    if (history.lastMs > 0 && nowMs > history.lastMs)
+    {
+        int64_t interval = nowMs - history.lastMs;
+        if (_maxIntervalMs > 0 && interval > _maxIntervalMs)
+        {
+            // 服务停止过一段时间后重新上报，之前的间隔已不能反映现在的心跳规律
+            history.intervals.clear();
+            history.sum = history.sumSquare = 0;
+        }
+        else
+        {
+            history.intervals.push_back(interval);
+            history.sum += interval;
+            history.sumSquare += double(interval) * interval;
+            while (history.intervals.size() > _windowSize)
+            {
+                int64_t oldest = history.intervals.front();
+                history.intervals.pop_front();
+                history.sum -= oldest;
+                history.sumSquare -= double(oldest) * oldest;
+            }
+        }
+    }
+
+    if (nowMs > history.lastMs)
+    {
+        history.lastMs = nowMs;
+    }
+}
+
+double FailureDetector::phi(const string &serverName, int64_t nowMs) const
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    map<string, History>::const_iterator it = _history.find(serverName);
+    if (it == _history.end())
+    {
+        return 0;
+    }
+    return phiNoLock(it->second, nowMs);
+}
+
+void FailureDetector::remove(const string &serverName)
+{
+    TC_ThreadLock::Lock lock(_lock);
+    _history.erase(serverName);
+}
+
+string FailureDetector::desc(int64_t nowMs) const
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    ostringstream os;
+    map<string, History>::const_iterator it;
+    for (it = _history.begin(); it != _history.end(); ++it)
+    {
+        const History &history = it->second;
+        os << it->first << ": samples " << history.intervals.size();
+        if (!history.intervals.empty())
+        {
+            os << ", mean " << int64_t(history.sum / history.intervals.size()) << "ms";
+        }
+        os << ", last " << (nowMs - history.lastMs) << "ms ago, phi " << phiNoLock(history, nowMs)
+           << endl;
+    }
+    return os.str();
+}
+
+double FailureDetector::phi(double elapsedMs, double meanMs, double stdDevMs)
+{
+    // 用logistic函数近似正态分布的累积分布函数
+    double y = (elapsedMs - meanMs) / stdDevMs;
+    double e = exp(-y * (1.5976 + 0.070566 * y * y));
+    if (elapsedMs > meanMs)
+    {
+        return -log10(e / (1.0 + e));
+    }
+    return -log10(1.0 - 1.0 / (1.0 + e));
+}
+
+double FailureDetector::phiNoLock(const History &history, int64_t nowMs) const
+{
+    size_t n = history.intervals.size();
+    if (n < MIN_SAMPLES || nowMs <= history.lastMs)
+    {
+        return 0;
+    }
+
+    double mean = history.sum / n;
+    double variance = std::max(history.sumSquare / n - mean * mean, 0.0);
+    // 心跳间隔越长，网络、调度引起的绝对延迟越大，下限随均值放大
+    double minStdDev = std::max(double(_minStdDevMs), mean / MIN_STDDEV_DIVISOR);
+    double stdDev = std::max(sqrt(variance), minStdDev);
+
+    return phi(double(nowMs - history.lastMs), mean, stdDev);
+}
@@ -0,0 +1,82 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// 基于心跳到达间隔的phi-accrual故障检测。
+// 按服务记录最近若干次心跳的间隔，用其均值和标准差估计"到现在还收不到心跳"的概率P，
+// phi = -log10(P)。phi越大服务越可能已经故障，阈值8约等于误判概率1e-8。
+// 与固定的超时时间相比，检测时间随心跳的实际间隔和抖动自适应，心跳稳定时可以在几个心跳周期内发现故障。
+
+#ifndef __FAILUREDETECTOR_H__
+#define __FAILUREDETECTOR_H__
+
+#include <deque>
+#include <map>
+#include <string>
+#include "util/tc_monitor.h"
+
+using namespace tars;
+using namespace std;
+
+class FailureDetector
+{
+public:
+    FailureDetector();
+
+    virtual ~FailureDetector() = default;
+
+    // windowSize: 每个服务保留的心跳间隔个数
+    // minStdDevMs: 标准差的下限(毫秒)，避免心跳过于规律时一次轻微延迟就被判为故障；
+    //             实际下限还不小于心跳间隔均值的1/4，秒级的心跳偶尔晚到几百毫秒很常见
+    // maxIntervalMs: 超过该间隔(毫秒)的心跳视为服务重新上线，丢弃之前的记录
+    virtual void setParam(size_t windowSize, int64_t minStdDevMs, int64_t maxIntervalMs);
+
+    // 记录服务在nowMs收到的一次心跳
+    virtual void heartbeat(const string &serverName, int64_t nowMs);
+
+    // 计算服务在nowMs的phi值，心跳记录不足时返回0
+    virtual double phi(const string &serverName, int64_t nowMs) const;
+
+    // 清除服务的心跳记录
+    virtual void remove(const string &serverName);
+
+    virtual string desc(int64_t nowMs) const;
+
+    // 根据心跳间隔的均值、标准差计算距上次心跳elapsedMs时的phi值
+    static double phi(double elapsedMs, double meanMs, double stdDevMs);
+
+protected:
+    struct History
+    {
+        History() : lastMs(0), sum(0), sumSquare(0) {}
+
+        int64_t lastMs;            // 最近一次心跳的时间
+        deque<int64_t> intervals;  // 最近的心跳间隔
+        double sum;                // intervals之和
+        double sumSquare;          // intervals的平方和
+    };
+
+    double phiNoLock(const History &history, int64_t nowMs) const;
+
+protected:
+    static const size_t DEFAULT_WINDOW_SIZE = 100;
+    static const size_t MIN_SAMPLES = 3;  // 至少有这么多个间隔才计算phi
+    static const int MIN_STDDEV_DIVISOR = 4;  // 标准差不小于间隔均值的1/MIN_STDDEV_DIVISOR
+
+    mutable TC_ThreadLock _lock;
+    size_t _windowSize;
+    int64_t _minStdDevMs;
+    int64_t _maxIntervalMs;
+    map<string, History> _history;
+};
+
+#endif  // __FAILUREDETECTOR_H__
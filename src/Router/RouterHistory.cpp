@@ -0,0 +1,214 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <algorithm>
+#include <iterator>
+#include "RouterHistory.h"
+#include "global.h"
+
+namespace
+{
+// 路由记录的排序规则，用于比较两个版本的路由记录集合
+struct RecordLess
+{
+    bool operator()(const RecordInfo &a, const RecordInfo &b) const
+    {
+        if (a.fromPageNo != b.fromPageNo) return a.fromPageNo < b.fromPageNo;
+        if (a.toPageNo != b.toPageNo) return a.toPageNo < b.toPageNo;
+        if (a.id != b.id) return a.id < b.id;
+        if (a.groupName != b.groupName) return a.groupName < b.groupName;
+        return a.moduleName < b.moduleName;
+    }
+};
+
+template <typename T>
+void diffMap(const map<string, T> &from,
+             const map<string, T> &to,
+             map<string, T> &update,
+             vector<string> &del)
+{
+    typename map<string, T>::const_iterator it;
+    for (it = to.begin(); it != to.end(); ++it)
+    {
+        typename map<string, T>::const_iterator itFrom = from.find(it->first);
+        if (itFrom == from.end() || !(itFrom->second == it->second))
+        {
+            update.insert(*it);
+        }
+    }
+
+    for (it = from.begin(); it != from.end(); ++it)
+    {
+        if (to.find(it->first) == to.end())
+        {
+            del.push_back(it->first);
+        }
+    }
+}
+}  // namespace
+
+void RouterHistory::setMaxVersion(size_t maxVersion)
+{
+    TC_ThreadLock::Lock lock(_lock);
+    _maxVersion = maxVersion > 0 ? maxVersion : DEFAULT_MAX_VERSION;
+}
+
+void RouterHistory::record(const PackTable &packTable)
+{
+    record(std::make_shared<const PackTable>(packTable));
+}
+
+void RouterHistory::record(const RouterSnapshot::PackTablePtr &packTable)
+{
+    TC_ThreadLock::Lock lock(_lock);
+    recordNoLock(packTable);
+}
+
+void RouterHistory::recordNoLock(const RouterSnapshot::PackTablePtr &packTable)
+{
+    ModuleHistory &history = _history[packTable->info.moduleName];
+    int version = packTable->info.version;
+
+    map<int, RouterSnapshot::PackTablePtr>::iterator it = history.tables.find(version);
+    if (it != history.tables.end())
+    {
+        if (it->second == packTable)
+        {
+            return;
+        }
+
+        if (*(it->second) == *packTable)
+        {
+            // 内容相同的新快照，换成新指针使之后的记录走上面的快速路径
+            it->second = packTable;
+            return;
+        }
+
+        TLOGDEBUG(FILE_FUN << "router of " << packTable->info.moduleName << " changed without version change: "
+                           << version << ", clear history" << endl);
+        history.tables.clear();
+        history.deltas.clear();
+    }
+    else if (!history.tables.empty() && version < history.tables.rbegin()->first)
+    {
+        TLOGDEBUG(FILE_FUN << "router version of " << packTable->info.moduleName << " rolled back from "
+                           << history.tables.rbegin()->first << " to " << version << ", clear history" << endl);
+        history.tables.clear();
+        history.deltas.clear();
+    }
+
+    history.tables[version] = packTable;
+    while (history.tables.size() > _maxVersion)
+    {
+        history.tables.erase(history.tables.begin());
+    }
+}
+
+int RouterHistory::getDelta(int fromVersion, const PackTable &current, RouterDelta &delta)
+{
+    return getDelta(fromVersion, std::make_shared<const PackTable>(current), delta);
+}
+
+int RouterHistory::getDelta(int fromVersion,
+                            const RouterSnapshot::PackTablePtr &current,
+                            RouterDelta &delta)
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    recordNoLock(current);
+
+    ModuleHistory &history = _history[current->info.moduleName];
+    if (history.deltaVersion != current->info.version)
+    {
+        history.deltas.clear();
+        history.deltaVersion = current->info.version;
+    }
+
+    map<int, RouterDelta>::const_iterator itDelta = history.deltas.find(fromVersion);
+    if (itDelta != history.deltas.end())
+    {
+        delta = itDelta->second;
+        return ROUTER_SUCC;
+    }
+
+    map<int, RouterSnapshot::PackTablePtr>::const_iterator itFrom = history.tables.find(fromVersion);
+    if (itFrom == history.tables.end())
+    {
+        return ROUTER_NEED_FULL;
+    }
+
+    makeDelta(*(itFrom->second), *current, delta);
+    history.deltas[fromVersion] = delta;
+
+    return ROUTER_SUCC;
+}
+
+void RouterHistory::clear(const string &moduleName)
+{
+    TC_ThreadLock::Lock lock(_lock);
+    if (moduleName.empty())
+    {
+        _history.clear();
+    }
+    else
+    {
+        _history.erase(moduleName);
+    }
+}
+
+string RouterHistory::desc()
+{
+    TC_ThreadLock::Lock lock(_lock);
+
+    ostringstream os;
+    os << "max version per module: " << _maxVersion << endl;
+    map<string, ModuleHistory>::const_iterator it;
+    for (it = _history.begin(); it != _history.end(); ++it)
+    {
+        os << it->first << ": versions [";
+        map<int, RouterSnapshot::PackTablePtr>::const_iterator itTable;
+        for (itTable = it->second.tables.begin(); itTable != it->second.tables.end(); ++itTable)
+        {
+            os << (itTable == it->second.tables.begin() ? "" : " ") << itTable->first;
+        }
+        os << "], cached delta: " << it->second.deltas.size() << endl;
+    }
+    return os.str();
+}
+
+void RouterHistory::makeDelta(const PackTable &from, const PackTable &to, RouterDelta &delta)
+{
+    delta.fromVersion = from.info.version;
+    delta.toVersion = to.info.version;
+    delta.info = to.info;
+    delta.delRecordList.clear();
+    delta.addRecordList.clear();
+    delta.updateGroupList.clear();
+    delta.delGroupList.clear();
+    delta.updateServerList.clear();
+    delta.delServerList.clear();
+
+    vector<RecordInfo> vFrom = from.recordList;
+    vector<RecordInfo> vTo = to.recordList;
+    std::sort(vFrom.begin(), vFrom.end(), RecordLess());
+    std::sort(vTo.begin(), vTo.end(), RecordLess());
+
+    // 排序规则包含路由记录的所有字段，两个方向的集合差即为删除和新增的记录
+    std::set_difference(vFrom.begin(), vFrom.end(), vTo.begin(), vTo.end(),
+                        std::back_inserter(delta.delRecordList), RecordLess());
+    std::set_difference(vTo.begin(), vTo.end(), vFrom.begin(), vFrom.end(),
+                        std::back_inserter(delta.addRecordList), RecordLess());
+
+    diffMap(from.groupList, to.groupList, delta.updateGroupList, delta.delGroupList);
+    diffMap(from.serverList, to.serverList, delta.updateServerList, delta.delServerList);
+}
@@ -0,0 +1,83 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// 保留各模块最近下发过的若干个版本的路由表，用于计算增量路由(getRouterDelta)。
+// 路由表在通过getRouterInfo等接口下发时记录，因此客户端持有的版本一般都能在这里找到；
+// 找不到时(Router重启、版本过旧)客户端退回全量拉取。
+
+#ifndef __ROUTERHISTORY_H__
+#define __ROUTERHISTORY_H__
+
+#include <map>
+#include <string>
+#include "Router.h"
+#include "RouterShare.h"
+#include "RouterSnapshot.h"
+#include "util/tc_monitor.h"
+
+using namespace tars;
+using namespace DCache;
+using namespace std;
+
+class RouterHistory
+{
+public:
+    RouterHistory() : _maxVersion(DEFAULT_MAX_VERSION) {}
+
+    virtual ~RouterHistory() = default;
+
+    // 设置每个模块最多保留的路由表版本数
+    virtual void setMaxVersion(size_t maxVersion);
+
+    // 记录下发给客户端的路由表
+    // 同一版本号的路由内容发生变化或版本号回退(如重载路由)时，丢弃该模块已有的历史
+    virtual void record(const PackTable &packTable);
+
+    // 同上，记录路由快照时只保存指针，同一快照重复记录时不再比较路由内容
+    virtual void record(const RouterSnapshot::PackTablePtr &packTable);
+
+    // 计算从fromVersion到当前路由表current的增量
+    // 返回ROUTER_SUCC成功，ROUTER_NEED_FULL表示没有保留fromVersion的路由表
+    virtual int getDelta(int fromVersion, const PackTable &current, RouterDelta &delta);
+
+    virtual int getDelta(int fromVersion, const RouterSnapshot::PackTablePtr &current, RouterDelta &delta);
+
+    // 清除模块的历史，模块名为空时清除所有模块
+    virtual void clear(const string &moduleName);
+
+    virtual string desc();
+
+    // 比较两个版本的路由表生成增量
+    static void makeDelta(const PackTable &from, const PackTable &to, RouterDelta &delta);
+
+protected:
+    struct ModuleHistory
+    {
+        ModuleHistory() : deltaVersion(-1) {}
+
+        map<int, RouterSnapshot::PackTablePtr> tables;  // 版本号 -> 路由表
+        map<int, RouterDelta> deltas;                   // 起始版本号 -> 到deltaVersion的增量，大量客户端从同一版本更新时只计算一次
+        int deltaVersion;                               // deltas的目标版本号
+    };
+
+    void recordNoLock(const RouterSnapshot::PackTablePtr &packTable);
+
+protected:
+    static const size_t DEFAULT_MAX_VERSION = 16;
+
+    TC_ThreadLock _lock;
+    size_t _maxVersion;
+    map<string, ModuleHistory> _history;
+};
+
+#endif  // __ROUTERHISTORY_H__
@@ -75,6 +75,7 @@ int RouterImp::queryMirrorInfo(const string &moduleName,
 void RouterImp::initialize()
 {
     _dbHandle = g_app.getDbHandle();
+    _routerHistory = g_app.getRouterHistory();
 
     int ret = _dbHandle->getIdcMap(_cityToIDC);
     if (ret != 0)
@@ -98,7 +99,7 @@ tars::Int32 RouterImp::getRouterInfo(const string &moduleName,
                                      PackTable &packTable,
                                      tars::TarsCurrentPtr current)
 {
-    if (!isMaster())
+    if (!serveRouteLocally())
     {
         TLOGDEBUG(FILE_FUN << "This is slave, request will proxy to master" << endl);
         if (updateMasterPrx() != 0)
@@ -108,11 +109,18 @@ tars::Int32 RouterImp::getRouterInfo(const string &moduleName,
         return _prx->getRouterInfo(moduleName, packTable);
     }
 
-    int rc = _dbHandle->getPackTable(moduleName, packTable);
+    RouterSnapshot::PackTablePtr table = _dbHandle->getPackTablePtr(moduleName);
     TLOGDEBUG(current->getIp() << "|" << current->getPort() << "|" << __FUNCTION__ << "|"
-                               << moduleName << "|" << rc << endl);
+                               << moduleName << "|" << (table ? 0 : -1) << endl);
+    if (!table)
+    {
+        return ROUTER_INFO_ERR;
+    }
 
-    return rc == 0 ? ROUTER_SUCC : ROUTER_INFO_ERR;
+    _routerHistory->record(table);
+    packTable = *table;
+
+    return ROUTER_SUCC;
 }
 
 tars::Int32 RouterImp::getRouterInfoFromCache(const string &moduleName,
@@ -137,11 +145,18 @@ tars::Int32 RouterImp::getRouterInfoFromCache(const string &moduleName,
         return ROUTER_INFO_ERR;
     }
 
-    int rc = _dbHandle->getPackTable(moduleName, packTable);
+    RouterSnapshot::PackTablePtr table = _dbHandle->getPackTablePtr(moduleName);
     TLOGDEBUG(current->getIp() << "|" << current->getPort() << "|" << __FUNCTION__ << "|"
-                               << moduleName << "|" << rc << endl);
+                               << moduleName << "|" << (table ? 0 : -1) << endl);
+    if (!table)
+    {
+        return ROUTER_INFO_ERR;
+    }
 
-    return rc == 0 ? ROUTER_SUCC : ROUTER_INFO_ERR;
+    _routerHistory->record(table);
+    packTable = *table;
+
+    return ROUTER_SUCC;
 }
 
 tars::Int32 RouterImp::getTransRouterInfo(const string &moduleName,
@@ -164,10 +179,53 @@ tars::Int32 RouterImp::getTransRouterInfo(const string &moduleName,
     int rc = _dbHandle->getRouterInfo(moduleName, transInfoListVer, transferingInfoList, packTable);
     TLOGDEBUG(current->getIp() << "|" << current->getPort() << "|" << __FUNCTION__ << "|"
                                << moduleName << "|" << rc << endl);
+    if (rc == 0)
+    {
+        _routerHistory->record(packTable);
+    }
 
     return rc == 0 ? ROUTER_SUCC : ROUTER_INFO_ERR;
 }
 
+tars::Int32 RouterImp::getRouterDelta(const string &moduleName,
+                                      tars::Int32 fromVersion,
+                                      RouterDelta &delta,
+                                      tars::TarsCurrentPtr current)
+{
+    if (!serveRouteLocally())
+    {
+        TLOGDEBUG(FILE_FUN << "This is slave, request will proxy to master" << endl);
+        if (updateMasterPrx() != 0)
+        {
+            return ROUTER_INFO_ERR;
+        }
+        return _prx->getRouterDelta(moduleName, fromVersion, delta);
+    }
+
+    if (g_app.isModuleSwitching(moduleName))
+    {
+        TLOGDEBUG(current->getIp()
+                  << "|" << current->getPort() << "|" << __FUNCTION__ << "|" << moduleName << "|"
+                  << "SWICTHING" << endl);
+        return ROUTER_INFO_ERR;
+    }
+
+    RouterSnapshot::PackTablePtr table = _dbHandle->getPackTablePtr(moduleName);
+    if (!table)
+    {
+        TLOGDEBUG(current->getIp() << "|" << current->getPort() << "|" << __FUNCTION__ << "|"
+                                   << moduleName << "|module not found" << endl);
+        return ROUTER_INFO_ERR;
+    }
+
+    int rc = _routerHistory->getDelta(fromVersion, table, delta);
+    TLOGDEBUG(current->getIp() << "|" << current->getPort() << "|" << __FUNCTION__ << "|"
+                               << moduleName << "|" << fromVersion << "|"
+                               << table->info.version << "|" << rc << endl);
+
+    return rc;
+}
+
 tars::Int32 RouterImp::getVersion(const std::string &moduleName, tars::TarsCurrentPtr current)
 {
     int version = _dbHandle->getVersion(moduleName);
@@ -180,7 +238,7 @@ tars::Int32 RouterImp::getRouterVersion(const string &moduleName,
                                         tars::Int32 &version,
                                         tars::TarsCurrentPtr current)
 {
-    if (!isMaster())
+    if (!serveRouteLocally())
     {
         TLOGDEBUG(FILE_FUN << "This is slave, request will proxy to master" << endl);
         if (updateMasterPrx() != 0)
@@ -206,7 +264,7 @@ tars::Int32 RouterImp::getRouterVersionBatch(const vector<string> &moduleList,
                                              map<string, tars::Int32> &mapModuleVersion,
                                              tars::TarsCurrentPtr current)
 {
-    if (!isMaster())
+    if (!serveRouteLocally())
     {
         TLOGDEBUG(FILE_FUN << "This is slave, request will proxy to master" << endl);
         if (updateMasterPrx() != 0)
@@ -265,6 +323,9 @@ tars::Int32 RouterImp::heartBeatReport(const string &moduleName,
                                                  << "|server:" << serverName << "|ip"
                                                  << current->getIp() << endl);
 
+    // 故障检测使用独立的锁记录毫秒级的到达时间，不受切换检查持有心跳锁的影响
+    g_app.getFailureDetector()->heartbeat(serverName, TNOWMS);
+
     TC_ThreadLock::Lock lock1(g_app.getHeartbeatInfoLock());
     GroupHeartBeatInfo *info = NULL;
     string errMsg;
@@ -933,3 +994,8 @@ int RouterImp::updateMasterPrx()
 }
 
 inline bool RouterImp::isMaster() const { return g_app.getRouterType() == ROUTER_MASTER; }
+
+inline bool RouterImp::serveRouteLocally() const
+{
+    return isMaster() || g_app.canSlaveServeRoute();
+}
@@ -53,6 +53,11 @@ public:
                                            PackTable &packTable,
                                            tars::TarsCurrentPtr current);
 
+    virtual tars::Int32 getRouterDelta(const string &moduleName,
+                                       tars::Int32 fromVersion,
+                                       RouterDelta &delta,
+                                       tars::TarsCurrentPtr current);
+
     virtual tars::Int32 getVersion(const std::string &moduleName, tars::TarsCurrentPtr current);
 
     virtual tars::Int32 getRouterVersion(const string &moduleName,
@@ -106,6 +111,9 @@ private:
     // 当前机器是否是主机
     bool isMaster() const;
 
+    // 是否用本机的路由快照响应读路由请求：主机，或开启了本地读路由且快照足够新的备机
+    bool serveRouteLocally() const;
+
     int queryGroupHeartBeatInfo(const string &moduleName,
                                 const string &groupName,
                                 string &errMsg,
@@ -119,6 +127,7 @@ private:
 
 private:
     std::shared_ptr<DbHandle> _dbHandle;  // 数据库操作的句柄
+    std::shared_ptr<RouterHistory> _routerHistory;  // 下发过的路由表，用于计算增量路由
     map<string, string> _cityToIDC;       // idc_city到idc的映射
     std::string _masterRouterObj;         // Router master的OBJ字符串
     RouterPrx _prx;                       // 和Router master通信的proxy
@@ -46,6 +46,13 @@ void RouterServer::initialize()
     {
         addServant<RouterImp>(ServerConfig::Application + "." + ServerConfig::ServerName +
                               ".RouterObj");
+        // 配置了HeartbeatObj的adapter时，cache服务的心跳走独立的adapter和线程，不与路由请求争抢
+        string heartbeatObj =
+            ServerConfig::Application + "." + ServerConfig::ServerName + ".HeartbeatObj";
+        if (!ServantHelperManager::getInstance()->getServantAdapter(heartbeatObj).empty())
+        {
+            addServant<RouterImp>(heartbeatObj);
+        }
         if (!addConfig(ServerConfig::ServerName + ".conf"))
         {
             TLOGERROR(FILE_FUN << "add config error." << endl);
@@ -69,6 +76,11 @@ void RouterServer::initialize()
         _outerProxy->init(_conf.getProxyMaxSilentTime(1800));
         _transfer->init(_dbHandle);
         _dbHandle->loadSwitchInfo();
+        _routerHistory->setMaxVersion(_conf.getRouterHistorySize(16));
+        _slaveServeRoute = _conf.checkSlaveServeRoute();
+        _slaveRouteMaxLag = _conf.getSlaveRouteMaxLag(10);
+        _failureDetector->setParam(
+            0, _conf.getHeartbeatMinStdDev(100), _conf.getSwitchTimeOut(300) * 1000);
 
         ADD_ADMIN_CMD_NORMAL("router.reloadRouter", RouterServer::reloadRouter);
         ADD_ADMIN_CMD_NORMAL("router.reloadRouterByModule", RouterServer::reloadRouterByModule);
@@ -86,6 +98,8 @@ void RouterServer::initialize()
         ADD_ADMIN_CMD_NORMAL("router.heartBeat", RouterServer::showHeartBeatInfo);
         ADD_ADMIN_CMD_NORMAL("router.resetServerStatus", RouterServer::resetServerStatus);
         ADD_ADMIN_CMD_NORMAL("router.checkModule", RouterServer::checkModule);
+        ADD_ADMIN_CMD_NORMAL("router.showRouterHistory", RouterServer::showRouterHistory);
+        ADD_ADMIN_CMD_NORMAL("router.showFailureDetector", RouterServer::showFailureDetector);
         ADD_ADMIN_CMD_NORMAL("help", RouterServer::help);
 
         //启动线程
@@ -152,6 +166,7 @@ bool RouterServer::reloadRouter(const string &command, const string &params, str
             if (rc == 0)
             {
                 os << "reload router ok!" << endl;
+                _routerHistory->clear("");
                 FDLOG("switch") << "RouterServer::reloadRouter doLoadSwitcInfo() now" << endl;
                 TC_ThreadLock::Lock lock(_moduleSwitchingLock);
                 if (_moduleSwitching.size() == 0)
@@ -222,6 +237,7 @@ bool RouterServer::reloadRouterByModule(const string &command, const string &par
             if (rc == 0)
             {
                 os << "reload router ok!" << endl;
+                _routerHistory->clear(params);
                 FDLOG("switch") << "RouterServer::reloadRouter doLoadSwitcInfo() now" << endl;
                 TC_ThreadLock::Lock lock(_moduleSwitchingLock);
                 if (_moduleSwitching.size() == 0)
@@ -297,6 +313,11 @@ bool RouterServer::reloadConf(const string &command, const string &params, strin
             _outerProxy->reloadConf(_conf);
             _dbHandle->reloadConf(_conf);
             _transfer->reloadConf();
+            _routerHistory->setMaxVersion(_conf.getRouterHistorySize(16));
+            _slaveServeRoute = _conf.checkSlaveServeRoute();
+            _slaveRouteMaxLag = _conf.getSlaveRouteMaxLag(10);
+            _failureDetector->setParam(
+                0, _conf.getHeartbeatMinStdDev(100), _conf.getSwitchTimeOut(300) * 1000);
 
             //先停止定时线程
             _timerThread.terminate();
@@ -1760,6 +1781,18 @@ bool RouterServer::procAdminCommand(const string &command, const string &params,
     return false;
 }
 
+bool RouterServer::showRouterHistory(const string &command, const string &params, string &result)
+{
+    result = _routerHistory->desc();
+    return true;
+}
+
+bool RouterServer::showFailureDetector(const string &command, const string &params, string &result)
+{
+    result = _failureDetector->desc(TNOWMS);
+    return true;
+}
+
 bool RouterServer::help(const string &command, const string &params, string &result)
 {
     ostringstream os;
@@ -1781,6 +1814,8 @@ bool RouterServer::help(const string &command, const string &params, string &res
            << endl;
         os << "router.resetServerStatus moduleName groupName serverName 重置服务状态" << endl;
         os << "router.checkModule moduleName                检查模块路由加载结果" << endl;
+        os << "router.showRouterHistory                     列出用于增量路由的历史版本" << endl;
+        os << "router.showFailureDetector                   列出各cache服务的心跳间隔和phi值" << endl;
         os << "help succ!" << endl;
     }
     catch (TarsException &e)
@@ -2409,6 +2444,9 @@ void RouterServer::downgrade()
         _masterRouterObj = "";
     }
 
+    // 降级后要先从新的主机同步一轮路由，才能用本地快照响应读路由请求
+    _slaveRouteSyncTime = 0;
+
     terminateSwitchThreads();
     clearSwitchThreads();
     _dbHandle->downgrade();
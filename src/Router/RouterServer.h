@@ -19,6 +19,8 @@
 //#include "EtcdThread.h"
 #include "SwitchThread.h"
 #include "TimerThread.h"
+#include "RouterHistory.h"
+#include "FailureDetector.h"
 #include "global.h"
 #include "servant/Application.h"
 
@@ -64,8 +66,13 @@ public:
         : _dbHandle(std::make_shared<DbHandle>()),
           _outerProxy(std::make_shared<OuterProxyFactory>()),
           _transfer(std::make_shared<DCache::Transfer>(_outerProxy)),
+          _routerHistory(std::make_shared<RouterHistory>()),
+          _failureDetector(std::make_shared<FailureDetector>()),
 //          _enableEtcd(false),
-          _routerType(ROUTER_SLAVE)
+          _routerType(ROUTER_SLAVE),
+          _slaveServeRoute(false),
+          _slaveRouteMaxLag(10),
+          _slaveRouteSyncTime(0)
     {
     }
 
@@ -107,6 +114,10 @@ public:
 
     virtual bool checkModule(const string &command, const string &params, string &result);
 
+    virtual bool showRouterHistory(const string &command, const string &params, string &result);
+
+    virtual bool showFailureDetector(const string &command, const string &params, string &result);
+
     virtual bool procAdminCommand(const string &command, const string &params, string &result);
 
 //    virtual bool isEnableEtcd() const { return _enableEtcd; }
@@ -211,6 +222,22 @@ public:
 
     virtual std::shared_ptr<DCache::Transfer> getTransfer() { return _transfer; }
 
+    virtual std::shared_ptr<RouterHistory> getRouterHistory() { return _routerHistory; }
+
+    virtual std::shared_ptr<FailureDetector> getFailureDetector() { return _failureDetector; }
+
+    // 备机是否开启了用本地路由快照响应读路由请求
+    virtual bool isSlaveServeRoute() const { return _slaveServeRoute; }
+
+    // 备机从主机同步完一轮路由快照后调用
+    virtual void setSlaveRouteSyncTime(time_t t) { _slaveRouteSyncTime = t; }
+
+    // 备机的路由快照是否足够新，可以不转发给主机直接响应读路由请求
+    virtual bool canSlaveServeRoute() const
+    {
+        return _slaveServeRoute && TNOW - _slaveRouteSyncTime <= _slaveRouteMaxLag;
+    }
+
 private:
     // 启动ETCD相关的流程。
    int setUpEtcd();
@@ -233,9 +260,14 @@ private:
     std::shared_ptr<DbHandle> _dbHandle;               // 数据库操作句柄
     std::shared_ptr<OuterProxyFactory> _outerProxy;    // 代理工厂
     std::shared_ptr<DCache::Transfer> _transfer;
+    std::shared_ptr<RouterHistory> _routerHistory;     // 最近下发的路由表，用于计算增量路由
+    std::shared_ptr<FailureDetector> _failureDetector; // 按cache服务心跳间隔做故障检测
 //    std::shared_ptr<EtcdHandle> _etcdHandle;
 //    bool _enableEtcd;                                  // 是否开启ETCD
     std::atomic<enum RouterType> _routerType;          // router的类型(主机或备机)
+    std::atomic<bool> _slaveServeRoute;                // 备机是否用本地路由快照响应读路由请求
+    std::atomic<int> _slaveRouteMaxLag;                // 备机路由快照允许落后的最长时间(秒)
+    std::atomic<time_t> _slaveRouteSyncTime;           // 备机最近一次从主机同步完路由快照的时间
     RouterServerConfig _conf;                          // 配置文件管理
     std::string _masterRouterObj;                      // master主机的obj
     mutable tars::TC_ThreadLock _objLock;              // 对_masterRouterObj的锁
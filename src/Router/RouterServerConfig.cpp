@@ -118,6 +118,27 @@ int RouterServerConfig::getMaxTransferThreadEachGroup(int defaultVal) const
     return getConfig("/Main/Transfer<MaxTransferThreadEachGroup>", defaultVal);
 }
 
+int RouterServerConfig::getMaxTransferThreadEachDestGroup(int defaultVal) const
+{
+    return getConfig("/Main/Transfer<MaxTransferThreadEachDestGroup>", defaultVal);
+}
+
+int RouterServerConfig::getTransferBinlogLagLimit(int defaultVal) const
+{
+    return getConfig("/Main/Transfer<TransferBinlogLagLimit>", defaultVal);
+}
+
+int RouterServerConfig::getTransferLoadCheckInterval(int defaultTime) const
+{
+    return getConfig("/Main/Transfer<TransferLoadCheckInterval>", defaultTime);
+}
+
+bool RouterServerConfig::checkParallelNotifyTransStart() const
+{
+    string s = _conf.get("/Main/Transfer<ParallelNotifyStart>", "Y");
+    return (s == "Y" || s == "y");
+}
+
 int RouterServerConfig::getSwitchCheckInterval(int defaultTime) const
 {
     return getConfig("/Main/Switch<SwitchCheckInterval>", defaultTime);
@@ -152,3 +173,40 @@ int RouterServerConfig::getDowngradeTimeout(int defaultTime) const
 {
     return getConfig("/Main/Switch<DowngradeTimeout>", defaultTime);
 }
+
+bool RouterServerConfig::checkFastFailover() const
+{
+    string s = _conf.get("/Main/Switch<FastFailover>", "N");
+    return (s == "Y" || s == "y");
+}
+
+int RouterServerConfig::getPhiThreshold(int defaultVal) const
+{
+    return getConfig("/Main/Switch<PhiThreshold>", defaultVal);
+}
+
+int RouterServerConfig::getFailureCheckInterval(int defaultTime) const
+{
+    return getConfig("/Main/Switch<FailureCheckInterval>", defaultTime);
+}
+
+int RouterServerConfig::getHeartbeatMinStdDev(int defaultTime) const
+{
+    return getConfig("/Main/Switch<HeartbeatMinStdDev>", defaultTime);
+}
+
+int RouterServerConfig::getRouterHistorySize(int defaultVal) const
+{
+    return getConfig("/Main<RouterHistorySize>", defaultVal);
+}
+
+bool RouterServerConfig::checkSlaveServeRoute() const
+{
+    string s = _conf.get("/Main<SlaveServeRoute>", "N");
+    return (s == "Y" || s == "y");
+}
+
+int RouterServerConfig::getSlaveRouteMaxLag(int defaultTime) const
+{
+    return getConfig("/Main<SlaveRouteMaxLag>", defaultTime);
+}
@@ -80,6 +80,18 @@ public:
     // 获取每个组的最大迁移线程数
     virtual int getMaxTransferThreadEachGroup(int defaultVal) const;
 
+    // 获取每个迁移目的组同时进行的最大迁移任务数，0表示不限制
+    virtual int getMaxTransferThreadEachDestGroup(int defaultVal) const;
+
+    // 获取允许发起迁移的源组备机binlog延迟上限(单位：秒)，0表示不检查
+    virtual int getTransferBinlogLagLimit(int defaultVal) const;
+
+    // 获取迁移前检查源组负载的最小间隔(单位：秒)
+    virtual int getTransferLoadCheckInterval(int defaultTime) const;
+
+    // 检查是否同时通知迁移的源和目的服务器开始迁移
+    virtual bool checkParallelNotifyTransStart() const;
+
     // 获取检查自动切换的间隔时间(单位:秒)
     virtual int getSwitchCheckInterval(int defaultTime) const;
 
@@ -100,6 +112,27 @@ public:
     // 获取主备切换时，主机降级的等待时间(单位：秒)
     virtual int getDowngradeTimeout(int defaultTime) const;
 
+    // 检查是否开启基于phi-accrual故障检测的快速主备切换
+    virtual bool checkFastFailover() const;
+
+    // 获取判定主机故障的phi阈值
+    virtual int getPhiThreshold(int defaultVal) const;
+
+    // 获取快速切换时检查主机心跳的间隔(单位：毫秒)
+    virtual int getFailureCheckInterval(int defaultTime) const;
+
+    // 获取故障检测时心跳间隔标准差的下限(单位：毫秒)
+    virtual int getHeartbeatMinStdDev(int defaultTime) const;
+
+    // 获取每个模块为增量路由保留的路由表版本数
+    virtual int getRouterHistorySize(int defaultVal) const;
+
+    // 检查备机是否用从主机同步的路由快照直接响应读路由请求
+    virtual bool checkSlaveServeRoute() const;
+
+    // 获取备机路由快照允许落后于主机的最长时间(单位：秒)，超过后读路由请求仍转发给主机
+    virtual int getSlaveRouteMaxLag(int defaultTime) const;
+
     // 获取数据库连接信息
     virtual std::map<std::string, std::string> getDbConnInfo() const;
 
@@ -0,0 +1,89 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include "RouterSnapshot.h"
+
+RouterSnapshot::RouterSnapshot() : _snapshots(std::make_shared<SnapshotMap>()) {}
+
+RouterSnapshot::PackTablePtr RouterSnapshot::get(const string &moduleName) const
+{
+    std::shared_ptr<const SnapshotMap> snapshots = load();
+    SnapshotMap::const_iterator it = snapshots->find(moduleName);
+    return it != snapshots->end() ? it->second : PackTablePtr();
+}
+
+int RouterSnapshot::getVersion(const string &moduleName) const
+{
+    std::shared_ptr<const SnapshotMap> snapshots = load();
+    SnapshotMap::const_iterator it = snapshots->find(moduleName);
+    return it != snapshots->end() ? it->second->info.version : -1;
+}
+
+void RouterSnapshot::getVersion(map<string, int> &version) const
+{
+    std::shared_ptr<const SnapshotMap> snapshots = load();
+    for (SnapshotMap::const_iterator it = snapshots->begin(); it != snapshots->end(); ++it)
+    {
+        version[it->first] = it->second->info.version;
+    }
+}
+
+size_t RouterSnapshot::size() const { return load()->size(); }
+
+void RouterSnapshot::publish(const PackTable &packTable)
+{
+    PackTablePtr table = std::make_shared<const PackTable>(packTable);
+
+    TC_ThreadLock::Lock lock(_writeLock);
+    // 只复制模块名到快照指针的映射，其他模块的路由表仍然共享
+    std::shared_ptr<SnapshotMap> snapshots = std::make_shared<SnapshotMap>(*load());
+    (*snapshots)[packTable.info.moduleName] = table;
+    store(snapshots);
+}
+
+void RouterSnapshot::publishAll(const map<string, PackTable> &packTables)
+{
+    std::shared_ptr<SnapshotMap> snapshots = std::make_shared<SnapshotMap>();
+    for (map<string, PackTable>::const_iterator it = packTables.begin(); it != packTables.end();
+         ++it)
+    {
+        (*snapshots)[it->first] = std::make_shared<const PackTable>(it->second);
+    }
+
+    TC_ThreadLock::Lock lock(_writeLock);
+    store(snapshots);
+}
+
+void RouterSnapshot::remove(const string &moduleName)
+{
+    TC_ThreadLock::Lock lock(_writeLock);
+    std::shared_ptr<const SnapshotMap> old = load();
+    if (old->find(moduleName) == old->end())
+    {
+        return;
+    }
+
+    std::shared_ptr<SnapshotMap> snapshots = std::make_shared<SnapshotMap>(*old);
+    snapshots->erase(moduleName);
+    store(snapshots);
+}
+
+std::shared_ptr<const RouterSnapshot::SnapshotMap> RouterSnapshot::load() const
+{
+    return std::atomic_load(&_snapshots);
+}
+
+void RouterSnapshot::store(const std::shared_ptr<const SnapshotMap> &snapshots)
+{
+    std::atomic_store(&_snapshots, snapshots);
+}
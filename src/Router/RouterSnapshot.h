@@ -0,0 +1,73 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+// 各模块路由表的只读快照，供getRouterInfo、getRouterVersion等高频读接口使用。
+// 快照发布后不再修改，写者复制一份新的模块表后整体替换指针，读者只需原子地取一次指针，
+// 不再与DbHandle中的迁移、切换等操作争用_lock。
+
+#ifndef __ROUTERSNAPSHOT_H__
+#define __ROUTERSNAPSHOT_H__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RouterShare.h"
+#include "util/tc_monitor.h"
+
+using namespace tars;
+using namespace DCache;
+using namespace std;
+
+class RouterSnapshot
+{
+public:
+    typedef std::shared_ptr<const PackTable> PackTablePtr;
+
+    RouterSnapshot();
+
+    virtual ~RouterSnapshot() = default;
+
+    // 获取模块的路由表快照，模块不存在时返回空指针
+    virtual PackTablePtr get(const string &moduleName) const;
+
+    // 获取模块的路由版本号，模块不存在时返回-1
+    virtual int getVersion(const string &moduleName) const;
+
+    // 获取所有模块的路由版本号
+    virtual void getVersion(map<string, int> &version) const;
+
+    virtual size_t size() const;
+
+    // 发布一个模块的路由表
+    virtual void publish(const PackTable &packTable);
+
+    // 用packTables替换所有模块的路由表
+    virtual void publishAll(const map<string, PackTable> &packTables);
+
+    // 删除一个模块的路由表
+    virtual void remove(const string &moduleName);
+
+protected:
+    typedef map<string, PackTablePtr> SnapshotMap;
+
+    std::shared_ptr<const SnapshotMap> load() const;
+
+    void store(const std::shared_ptr<const SnapshotMap> &snapshots);
+
+protected:
+    TC_ThreadLock _writeLock;                     // 写者之间互斥，读者不加锁
+    std::shared_ptr<const SnapshotMap> _snapshots;  // 只能通过load/store原子地读写
+};
+
+#endif  // __ROUTERSNAPSHOT_H__
@@ -19,6 +19,46 @@ using namespace tars;
 
 extern RouterServer g_app;
 
+namespace
+{
+// 并行发送心跳时等待所有应答
+struct HeartBeatWaiter : public TC_HandleBase, public TC_ThreadLock
+{
+    HeartBeatWaiter() : pending(0) {}
+
+    void done(size_t index, int ret)
+    {
+        TC_ThreadLock::Lock lock(*this);
+        rets[index] = ret;
+        if (--pending == 0)
+        {
+            notifyAll();
+        }
+    }
+
+    vector<int> rets;
+    int pending;
+};
+typedef TC_AutoPtr<HeartBeatWaiter> HeartBeatWaiterPtr;
+
+class HeartBeatCallback : public RouterClientPrxCallback
+{
+public:
+    HeartBeatCallback(const HeartBeatWaiterPtr &waiter, size_t index)
+        : _waiter(waiter), _index(index)
+    {
+    }
+
+    virtual void callback_helloBaby(tars::Int32 ret) { _waiter->done(_index, 0); }
+
+    virtual void callback_helloBaby_exception(tars::Int32 ret) { _waiter->done(_index, -1); }
+
+private:
+    HeartBeatWaiterPtr _waiter;
+    size_t _index;
+};
+}  // namespace
+
 map<string, time_t> DoCheckTransThread::_isCheckTransDown;
 TC_ThreadLock lockForInsertCheckTrans;
 
@@ -299,6 +339,7 @@ SwitchThread::SwitchThread()
 {
     _enable    = false;
     _terminate = false;
+    _fastFailover = false;
     _lastNotifyTime = 0;
 }
 
@@ -331,6 +372,10 @@ void SwitchThread::init(AdminProxyWrapperPtr adminProxy, std::shared_ptr<DbHandl
         _switchCheckInterval = g_app.getGlobalConfig().getSwitchCheckInterval(10);
         _switchTimeout = g_app.getGlobalConfig().getSwitchTimeOut(300);
         _slaveTimeout = g_app.getGlobalConfig().getSlaveTimeOut(60);
+        _fastFailover = g_app.getGlobalConfig().checkFastFailover();
+        _phiThreshold = g_app.getGlobalConfig().getPhiThreshold(8);
+        _failureCheckInterval = g_app.getGlobalConfig().getFailureCheckInterval(200);
+        _suspectMasters.clear();
         _dbHandle = dbHandle;
         _adminProxy = adminProxy;
         _adminProxy->tars_timeout(3000);
@@ -411,10 +456,7 @@ void SwitchThread::run()
 
         doSlaveCheck();
 
-        {
-            TC_ThreadLock::Lock sync(*this);
-            timedWait(_switchCheckInterval * 1000);
-        }
+        waitNextCheck();
 
         g_app.removeFinishedSwitchThreads();
 
@@ -493,6 +535,7 @@ void SwitchThread::doSwitchCheck()
     //持续告警逻辑
     bool isTarsNotify = false;
     time_t nowTime = TC_TimeProvider::getInstance()->getNow();
+    int64_t nowMs = TNOWMS;
 
     if (nowTime - _lastNotifyTime >= 300)
     {
@@ -661,8 +704,9 @@ void SwitchThread::doSwitchCheck()
                              " masterServerName:" + itrGroupInfo->second.masterServer;
                     FDLOG("switch") << __LINE__ << "|" << __FUNCTION__ << "|" << errMsg << endl;
                 }
-                else if ((int(nowTime) - int(itrGroupInfo->second.masterLastReportTime)) >
-                         _switchTimeout)
+                else if (((int(nowTime) - int(itrGroupInfo->second.masterLastReportTime)) >
+                          _switchTimeout) ||
+                         isMasterSuspected(itrGroupInfo->second.masterServer, nowMs))
                 {
                     errMsg = "SwitchThread::doSwitchCheck find TimeOut groupName:" +
                              itrGroupInfo->first +
@@ -941,6 +985,83 @@ void SwitchThread::doSlaveCheck()
 
 /////////////////////////////////////////////
 
+bool SwitchThread::isMasterSuspected(const string &serverName, int64_t nowMs) const
+{
+    if (!_fastFailover)
+    {
+        return false;
+    }
+
+    double phi = g_app.getFailureDetector()->phi(serverName, nowMs);
+    if (phi < _phiThreshold)
+    {
+        return false;
+    }
+
+    FDLOG("switch") << __LINE__ << "|" << __FUNCTION__ << "|master: " << serverName
+                    << " phi: " << phi << " >= " << _phiThreshold << endl;
+    return true;
+}
+
+bool SwitchThread::hasNewSuspectMaster()
+{
+    int64_t nowMs = TNOWMS;
+    bool bFound = false;
+    set<string> suspectMasters;
+
+    TC_ThreadLock::Lock lock(g_app.getHeartbeatInfoLock());
+    const HeartbeatInfo &heartbeat = g_app.getHeartbeatInfo();
+    HeartbeatInfo::const_iterator itr;
+    for (itr = heartbeat.begin(); itr != heartbeat.end(); ++itr)
+    {
+        map<string, GroupHeartBeatInfo>::const_iterator itrGroupInfo;
+        for (itrGroupInfo = itr->second.begin(); itrGroupInfo != itr->second.end(); ++itrGroupInfo)
+        {
+            const string &masterServer = itrGroupInfo->second.masterServer;
+            if (itrGroupInfo->second.status != 0 || masterServer.empty() ||
+                g_app.getFailureDetector()->phi(masterServer, nowMs) < _phiThreshold)
+            {
+                continue;
+            }
+
+            suspectMasters.insert(masterServer);
+            if (_suspectMasters.find(masterServer) == _suspectMasters.end())
+            {
+                bFound = true;
+            }
+        }
+    }
+
+    // 恢复心跳的主机移出集合，之后再次故障时能立即发现
+    _suspectMasters.swap(suspectMasters);
+    return bFound;
+}
+
+void SwitchThread::waitNextCheck()
+{
+    if (!_fastFailover)
+    {
+        TC_ThreadLock::Lock sync(*this);
+        timedWait(_switchCheckInterval * 1000);
+        return;
+    }
+
+    // 按较短的间隔检查主机的phi值，发现新的故障主机时立即进行切换检查，而不是等到下一个检查周期
+    int64_t beginMs = TNOWMS;
+    while (!_terminate)
+    {
+        {
+            TC_ThreadLock::Lock sync(*this);
+            timedWait(_failureCheckInterval);
+        }
+
+        if (TNOWMS - beginMs >= int64_t(_switchCheckInterval) * 1000 || hasNewSuspectMaster())
+        {
+            break;
+        }
+    }
+}
+
 int SwitchThread::checkServerSettingState(const string &serverName)
 {
     try
@@ -1176,7 +1297,8 @@ DoSwitchThread::DoSwitchThread(AdminProxyWrapperPtr adminProxy,
 //      _switchTimeout(switchTimeOut),
       _switchBlogDifLimit(switchBinLogDiffLimit),
       _switchMaxTimes(switchMaxTimes),
-      _downGradeTimeout(downGradeTimeout)
+      _downGradeTimeout(downGradeTimeout),
+      _fastFailover(g_app.getGlobalConfig().checkFastFailover())
 {
     string _locator = Application::getCommunicator()->getProperty("locator");
 
@@ -1431,9 +1553,20 @@ void DoSwitchThread::doSwitchMaterSlave(const SwitchWork &switchWork)
             break;
         }
 
-        //向主机发送心跳
-        FDLOG("switch") << "heartBeatSend to masterName:" << masterName << endl;
-        int iRet = heartBeatSend(masterName);
+        //向主机发送心跳，快速切换时同时向备机发送
+        int iRet = 0;
+        int slaveRet = 0;
+        if (_fastFailover)
+        {
+            FDLOG("switch") << "heartBeatSend to masterName:" << masterName
+                            << " and slaveName:" << slaveName << endl;
+            heartBeatSendBoth(masterName, slaveName, iRet, slaveRet);
+        }
+        else
+        {
+            FDLOG("switch") << "heartBeatSend to masterName:" << masterName << endl;
+            iRet = heartBeatSend(masterName);
+        }
         if (iRet == 0)
         {
             errMsg = "heartBeatSend to masterName ok:" + masterName;
@@ -1444,8 +1577,12 @@ void DoSwitchThread::doSwitchMaterSlave(const SwitchWork &switchWork)
         }
 
         //向备机发送心跳
-        FDLOG("switch") << "heartBeatSend to slaveName:" << slaveName << endl;
-        iRet = heartBeatSend(slaveName);
+        if (!_fastFailover)
+        {
+            FDLOG("switch") << "heartBeatSend to slaveName:" << slaveName << endl;
+            slaveRet = heartBeatSend(slaveName);
+        }
+        iRet = slaveRet;
         if (iRet == -1)
         {
             //检查备机是否因为下线导致心跳超时
@@ -1549,10 +1686,13 @@ void DoSwitchThread::doSwitchMaterSlave(const SwitchWork &switchWork)
 
         //通知主机降级，不关心是否成功，
         TLOGDEBUG(FILE_FUN << "notify master downgrade." << endl);
-        notifyMasterDowngrade(moduleName, masterName);
+        iRet = notifyMasterDowngrade(moduleName, masterName);
 
-        //等待30s，目的是等待主机降级
-        sleep(_downGradeTimeout);
+        //等待30s，目的是等待主机降级；快速切换时主机已确认降级就不用等了
+        if (!_fastFailover || iRet != 0)
+        {
+            sleep(_downGradeTimeout);
+        }
 
         if (switchType == 1)
         {
@@ -1637,6 +1777,21 @@ int DoSwitchThread::notifyMasterDowngrade(const string &moduleName, const string
     RouterClientPrx pRouterClientPrx =
         Application::getCommunicator()->stringToProxy<RouterClientPrx>(ServerObj);
     pRouterClientPrx->tars_timeout(3000);
+    if (_fastFailover)
+    {
+        try
+        {
+            int iRet = pRouterClientPrx->notifyMasterDowngrade(moduleName);
+            FDLOG("switch") << "notifyMasterDowngrade " << serverName << " ret:" << iRet << endl;
+            return iRet == 0 ? 0 : -1;
+        }
+        catch (const TarsException &ex)
+        {
+            TLOGERROR(FILE_FUN << " invoke " << serverName << " exception:" << ex.what() << endl);
+            return -1;
+        }
+    }
+
     try
     {
         pRouterClientPrx->async_notifyMasterDowngrade(NULL, moduleName);
@@ -1729,6 +1884,13 @@ int DoSwitchThread::setRouter4Switch(const string &moduleName,
         pRouterClientPrx->tars_timeout(3000);
         try
         {
+            if (_fastFailover)
+            {
+                // 旧主机多半已经故障，不等它超时
+                pRouterClientPrx->async_setRouterInfoForSwitch(NULL, moduleName, packTable);
+                return 0;
+            }
+
             iRet = pRouterClientPrx->setRouterInfoForSwitch(moduleName, packTable);
             if (iRet != 0)
             {
@@ -1915,6 +2077,80 @@ int DoSwitchThread::heartBeatSend(const string &serverName)
     }
     return -1;
 }
+void DoSwitchThread::heartBeatSendBoth(const string &masterName,
+                                       const string &slaveName,
+                                       int &masterRet,
+                                       int &slaveRet)
+{
+    const size_t SERVER_NUM = 2;
+    string serverNames[SERVER_NUM] = {masterName, slaveName};
+    int rets[SERVER_NUM] = {-1, -1};
+
+    // 与heartBeatSend一样，失败的服务再重试一次
+    for (int tryTimes = 0; tryTimes < 2; ++tryTimes)
+    {
+        HeartBeatWaiterPtr waiter = new HeartBeatWaiter();
+        waiter->rets.assign(rets, rets + SERVER_NUM);
+        for (size_t i = 0; i < SERVER_NUM; ++i)
+        {
+            if (rets[i] != 0)
+            {
+                ++waiter->pending;
+            }
+        }
+        if (waiter->pending == 0)
+        {
+            break;
+        }
+
+        for (size_t i = 0; i < SERVER_NUM; ++i)
+        {
+            if (rets[i] == 0)
+            {
+                continue;
+            }
+
+            try
+            {
+                RouterClientPrx pRouterClientPrx =
+                    Application::getCommunicator()->stringToProxy<RouterClientPrx>(
+                        serverNames[i] + ".RouterClientObj");
+                pRouterClientPrx->tars_timeout(3000);
+                pRouterClientPrx->async_helloBaby(new HeartBeatCallback(waiter, i));
+            }
+            catch (const TarsException &ex)
+            {
+                FDLOG("switch") << "SwitchThread::doSwitch catch exception: " << ex.what() << endl;
+                waiter->done(i, -1);
+            }
+        }
+
+        {
+            TC_ThreadLock::Lock lock(*waiter);
+            while (waiter->pending > 0)
+            {
+                if (!waiter->timedWait(6000))
+                {
+                    break;
+                }
+            }
+            for (size_t i = 0; i < SERVER_NUM; ++i)
+            {
+                rets[i] = waiter->rets[i];
+            }
+        }
+    }
+
+    for (size_t i = 0; i < SERVER_NUM; ++i)
+    {
+        FDLOG("switch") << "SwitchThread::doSwitch send heartBeat "
+                        << (rets[i] == 0 ? "ok" : "fail") << "  ServerName:" << serverNames[i]
+                        << endl;
+    }
+    masterRet = rets[0];
+    slaveRet = rets[1];
+}
+
 int DoSwitchThread::slaveBinlogdif(const string &serverName, int &diffBinlogTime)
 {
     string ServerObj = serverName + ".RouterClientObj";
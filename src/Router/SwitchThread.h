@@ -15,6 +15,7 @@
 #define _SWITCHTHREAD_H_
 
 #include <sys/time.h>
+#include <set>
 #include <string>
 #include <vector>
 #include "framework/AdminReg.h"
@@ -139,6 +140,12 @@ protected:
     /*向指定server发送心跳*/
     int heartBeatSend(const string &serverName);
 
+    /*同时向主机和备机发送心跳，失败的一方再重试一次*/
+    void heartBeatSendBoth(const string &masterName,
+                           const string &slaveName,
+                           int &masterRet,
+                           int &slaveRet);
+
     /*查询备机的同步差异*/
     int slaveBinlogdif(const string &serverName, int &diffBinlogTime);
 
@@ -185,7 +192,7 @@ protected:
                          const string &oldMaster,
                          const string &newMaster);
 
-    //通知主机降级
+    //通知主机降级，快速切换时等待主机应答，主机确认降级返回0
     int notifyMasterDowngrade(const string &moduleName, const string &serverName);
 
 private:
@@ -197,6 +204,7 @@ private:
     int _switchBlogDifLimit;
     int _switchMaxTimes;    //每天最多切换次数
     int _downGradeTimeout;  //主机降级的等待时间
+    bool _fastFailover;     //快速切换：并行探测主备机，主机确认降级后不再等待
     bool _isFinish;
     bool _start;
     SwitchWork _work;
@@ -235,6 +243,15 @@ protected:
     //检查备机是否可用
     void doSlaveCheck();
 
+    //主机是否被故障检测判定为故障
+    bool isMasterSuspected(const string &serverName, int64_t nowMs) const;
+
+    //是否有新的主机被判定为故障，已经发现过的主机不重复计入
+    bool hasNewSuspectMaster();
+
+    //等待下一次切换检查，快速切换时发现主机故障立即返回
+    void waitNextCheck();
+
 private:
     // 重新加载路由信息
     int reloadRouter();
@@ -245,6 +262,10 @@ private:
 	bool _enable;
     int _switchTimeout;
     int _switchCheckInterval;  //自动切换check间隔
+    bool _fastFailover;        //是否开启快速切换
+    int _phiThreshold;         //判定主机故障的phi阈值
+    int _failureCheckInterval; //快速切换时检查主机心跳的间隔(毫秒)
+    set<string> _suspectMasters;  //已经发现故障的主机
     time_t _lastNotifyTime;
     vector<DoCheckTransThreadPtr> _doCheckTransThreads;
     int _slaveTimeout;
@@ -50,7 +50,10 @@ void TimerThread::init(const RouterServerConfig &conf,
         _threadPollSize = conf.getTimerThreadSize(3);
         _minSizeEachGroup = conf.getMinTransferThreadEachGroup(5);
         _maxSizeEachGroup = conf.getMaxTransferThreadEachGroup(8);
+        _maxSizeEachDestGroup = conf.getMaxTransferThreadEachDestGroup(0);
         _dbHandle = dbHandle;
+        _transferThrottle = std::make_shared<TransferThrottle>(
+            dbHandle, conf.getTransferBinlogLagLimit(0), conf.getTransferLoadCheckInterval(10));
         FDLOG("TimeThread") << __LINE__ << "|" << __FUNCTION__ << "|"
                             << " thread pool size init: " << _threadPollSize << endl;
 
@@ -61,7 +64,11 @@ void TimerThread::init(const RouterServerConfig &conf,
                                                            std::placeholders::_2),
                                                  _threadPollSize,
                                                  _minSizeEachGroup,
-                                                 _maxSizeEachGroup);
+                                                 _maxSizeEachGroup,
+                                                 _maxSizeEachDestGroup,
+                                                 std::bind(&TransferThrottle::canTransfer,
+                                                           _transferThrottle,
+                                                           std::placeholders::_1));
     }
     catch (TC_Config_Exception &e)
     {
@@ -101,6 +108,11 @@ void TimerThread::run()
                 lastType = ROUTER_SLAVE;
             }
 
+            if (g_app.isSlaveServeRoute())
+            {
+                doSyncRouterSnapshot();
+            }
+
             TLOGDEBUG(FILE_FUN << "this is slave, just sleep" << endl);
 
             {
@@ -157,11 +169,83 @@ void TimerThread::doTransferParallel()
 		auto transTask = std::make_shared<TransferInfo>(transInfo);
 
         _transferDispatcher->addTransferTask(transTask);
+        _transferThrottle->watch(transInfo);
     }
 
+    // 源组负载在调度器的锁外查询，调度时只读取缓存结果
+    _transferThrottle->refresh();
     _transferDispatcher->doTransferTask();
 }
 
+void TimerThread::doSyncRouterSnapshot()
+{
+    string masterRouterObj = g_app.getMasterRouterObj();
+    if (masterRouterObj == "")
+    {
+        return;
+    }
+
+    try
+    {
+        if (_masterRouterObj != masterRouterObj)
+        {
+            _masterRouterObj = masterRouterObj;
+            _masterPrx = Application::getCommunicator()->stringToProxy<RouterPrx>(_masterRouterObj);
+        }
+
+        vector<string> moduleList;
+        map<string, tars::Int32> mapModuleVersion;
+        if (_masterPrx->getModuleList(moduleList) != 0 ||
+            _masterPrx->getRouterVersionBatch(moduleList, mapModuleVersion) != ROUTER_SUCC)
+        {
+            TLOGERROR(FILE_FUN << "get module version from master failed: " << _masterRouterObj << endl);
+            return;
+        }
+
+        RouterSnapshot &snapshot = _dbHandle->getRouterSnapshot();
+        map<string, int> localVersion;
+        snapshot.getVersion(localVersion);
+
+        // 只拉取版本号变化的模块
+        map<string, tars::Int32>::const_iterator it;
+        for (it = mapModuleVersion.begin(); it != mapModuleVersion.end(); ++it)
+        {
+            map<string, int>::const_iterator itLocal = localVersion.find(it->first);
+            if (itLocal != localVersion.end())
+            {
+                if (itLocal->second == it->second)
+                {
+                    localVersion.erase(itLocal);
+                    continue;
+                }
+                localVersion.erase(itLocal);
+            }
+
+            PackTable packTable;
+            if (it->second == -1 || _masterPrx->getRouterInfo(it->first, packTable) != ROUTER_SUCC)
+            {
+                TLOGERROR(FILE_FUN << "get router of " << it->first << " from master failed" << endl);
+                return;
+            }
+            snapshot.publish(packTable);
+        }
+
+        // 主机上已经下线的模块
+        map<string, int>::const_iterator itLocal;
+        for (itLocal = localVersion.begin(); itLocal != localVersion.end(); ++itLocal)
+        {
+            snapshot.remove(itLocal->first);
+        }
+
+        g_app.setSlaveRouteSyncTime(TC_TimeProvider::getInstance()->getNow());
+    }
+    catch (exception &e)
+    {
+        TLOGERROR(FILE_FUN << "sync router snapshot from " << _masterRouterObj
+                           << " exception: " << e.what() << endl);
+    }
+}
+
 void TimerThread::downgrade()
 {
     assert(g_app.getRouterType() == ROUTER_SLAVE);
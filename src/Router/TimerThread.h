@@ -19,6 +19,7 @@
 #include <string>
 #include <vector>
 #include "OuterProxyFactory.h"
+#include "Router.h"
 #include "RouterServerConfig.h"
 #include "Transfer.h"
 #include "global.h"
@@ -55,6 +56,9 @@ protected:
     // 做组并行的迁移任务
     void doTransferParallel();
 
+    // 备机从主机同步有变化的模块路由到本地快照
+    void doSyncRouterSnapshot();
+
 private:
     std::atomic<bool> _stop;
     int _transferInterval;                // 轮询迁移数据库的时间
@@ -62,11 +66,15 @@ private:
     int _threadPollSize;                  // 线程池大小
     int _minSizeEachGroup;                // 每个组的最小迁移线程数
     int _maxSizeEachGroup;                // 每个组的最大迁移线程数
+    int _maxSizeEachDestGroup;            // 每个迁移目的组的最大迁移线程数
     time_t _lastTransferTime;             // 最近轮询迁移数据库的时间
     time_t _lastClearProxyTime;           // 最近清理代理的间隔时间
     std::shared_ptr<DbHandle> _dbHandle;  // 数据库操作句柄
     std::shared_ptr<OuterProxyFactory> _outerProxy;
     std::shared_ptr<TransferDispatcher> _transferDispatcher;
+    std::shared_ptr<TransferThrottle> _transferThrottle;  // 按源组负载控制迁移任务的发起
+    std::string _masterRouterObj;         // 同步路由快照时使用的主机obj
+    RouterPrx _masterPrx;                 // 同步路由快照时使用的主机proxy
 };
 
 #endif
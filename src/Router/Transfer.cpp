@@ -31,6 +31,7 @@ void Transfer::init(std::shared_ptr<DbHandle> dbHandle)
     _transferPagesOnceMax = g_app.getGlobalConfig().getTransferPagesOnce(5);
     if (_transferPagesOnceMax > 10) _transferPagesOnceMax = 10;
     _transferPagesOnce = _transferPagesOnceMax;
+    _parallelNotifyStart = g_app.getGlobalConfig().checkParallelNotifyTransStart();
     _dbHandle = dbHandle;
 }
 
@@ -420,6 +421,122 @@ int Transfer::notifyTransSrcServerDo(const TransferInfo &transferInfo)
     return ret;
 }
 
+void Transfer::notifyTransServersStart(const TransferInfo &transferInfo, int &destRet, int &srcRet)
+{
+    destRet = e_Unknown;
+    srcRet = e_Unknown;
+
+    PackTable packTable;
+    vector<TransferInfo> transferingInfoList;
+    int version;
+
+    int rc =
+        _dbHandle->getRouterInfo(transferInfo.moduleName, version, transferingInfoList, packTable);
+    if (rc != 0)
+    {
+        DAY_ERROR << "Transfer::notifyTransServersStart cant find moduleName: "
+                  << transferInfo.moduleName << endl;
+        TARS_NOTIFY_WARN(string("Transfer::notifyTransServersStart|cant find moduleName: ") +
+                         transferInfo.moduleName);
+        _outerProxy->reportException("TransError");
+        destRet = srcRet = e_ModuleName_Not_Found;
+        return;
+    }
+
+    string destAddr, srcAddr;
+    destRet = getRouterClientJceAddr(packTable, transferInfo.transGroupName, destAddr);
+    srcRet = getRouterClientJceAddr(packTable, transferInfo.groupName, srcAddr);
+    if (destRet != e_Succ || srcRet != e_Succ)
+    {
+        return;
+    }
+
+    pthread_mutex_t *mutex = NULL;
+    pthread_cond_t *cond = NULL;
+    if (_dbHandle->getTransferMutexCond(transferInfo.moduleName,
+                                        TC_Common::tostr<pthread_t>(pthread_self()),
+                                        &mutex,
+                                        &cond) != 0)
+    {
+        destRet = e_toTransferStart_Fail;
+        srcRet = e_fromTransferStart_Fail;
+        return;
+    }
+
+    TransferParamPtr destParam = new TransferParam(mutex, cond, e_toTransfer_RestartSwitch_Fail);
+    TransferParamPtr srcParam = new TransferParam(mutex, cond, e_fromTransfer_RestartSwitch_Fail);
+    bool destSent = false, srcSent = false;
+
+    try
+    {
+        RouterClientPrx routerClientPrx;
+        if (_outerProxy->getProxy(destAddr, routerClientPrx) != 0)
+        {
+            destRet = e_getProxy_Fail;
+        }
+        else
+        {
+            routerClientPrx->tars_async_timeout(_transTo);
+            RouterClientPrxCallbackPtr cb = new RouterClientCallback(destParam);
+            routerClientPrx->async_toTransferStart(
+                cb, transferInfo.moduleName, version, transferingInfoList, transferInfo, packTable);
+            destSent = true;
+        }
+    }
+    catch (const TarsException &ex)
+    {
+        DAY_ERROR << "Transfer::notifyTransServersStart catch exception: " << ex.what()
+                  << " at: " << destAddr << endl;
+        TARS_NOTIFY_WARN(string("Transfer::notifyTransServersStart|") + ex.what() + " at: " + destAddr);
+        _outerProxy->reportException("TransError");
+        destRet = e_toTransferStart_Get_TarsException;
+        _outerProxy->deleteProxy(destAddr);
+    }
+
+    try
+    {
+        RouterClientPrx routerClientPrx;
+        if (_outerProxy->getProxy(srcAddr, routerClientPrx) != 0)
+        {
+            srcRet = e_getProxy_Fail;
+        }
+        else
+        {
+            routerClientPrx->tars_async_timeout(_transTo);
+            RouterClientPrxCallbackPtr cb = new RouterClientCallback(srcParam);
+            routerClientPrx->async_fromTransferStart(
+                cb, transferInfo.moduleName, version, transferingInfoList, packTable);
+            srcSent = true;
+        }
+    }
+    catch (const TarsException &ex)
+    {
+        DAY_ERROR << "Transfer::notifyTransServersStart catch exception: " << ex.what()
+                  << " at: " << srcAddr << endl;
+        TARS_NOTIFY_WARN(string("Transfer::notifyTransServersStart|") + ex.what() + " at: " + srcAddr);
+        _outerProxy->reportException("TransError");
+        srcRet = e_fromTransferStart_Get_TarsException;
+        _outerProxy->deleteProxy(srcAddr);
+    }
+
+    // 两个回调共用本线程的条件变量，按各自的完成标志等待，回调先于等待返回时也不会丢失
+    pthread_mutex_lock(mutex);
+    while ((destSent && !destParam->_done) || (srcSent && !srcParam->_done))
+    {
+        pthread_cond_wait(cond, mutex);
+    }
+    pthread_mutex_unlock(mutex);
+
+    if (destSent)
+    {
+        destRet = destParam->_return;
+    }
+    if (srcSent)
+    {
+        srcRet = srcParam->_return;
+    }
+}
+
 int Transfer::modifyRouterAfterTrans(TransferInfo *transInfoComplete)
 {
     if (!transInfoComplete)
@@ -1330,10 +1447,17 @@ int Transfer::doTransfer(const TransferInfo &transferInfoIn, string &info)
             break;
         }
 
+        // 并行通知时只有失败的一方进入下面的重试，重试次数与串行通知时相同
+        int destRc = e_Unknown, srcRc = e_Unknown;
+        if (_parallelNotifyStart)
+        {
+            notifyTransServersStart(*transInfoNew, destRc, srcRc);
+        }
+
         tryTimes = 0;
         do
         {
-            rc = notifyTransDestServer(*transInfoNew);
+            rc = (tryTimes == 0 && _parallelNotifyStart) ? destRc : notifyTransDestServer(*transInfoNew);
             if (rc == e_Succ)
             {
                 break;
@@ -1364,7 +1488,7 @@ int Transfer::doTransfer(const TransferInfo &transferInfoIn, string &info)
         tryTimes = 0;
         do
         {
-            rc = notifyTransSrcServer(*transInfoNew);
+            rc = (tryTimes == 0 && _parallelNotifyStart) ? srcRc : notifyTransSrcServer(*transInfoNew);
             if (rc == e_Succ)
             {
                 break;
@@ -1765,16 +1889,152 @@ void RouterClientCallback::callback_cleanFromTransferData_exception(tars ::Int32
     wakeUpWaitingThread();
 }
 
+TransferThrottle::TransferThrottle(std::shared_ptr<DbHandle> dbHandle,
+                                   int binlogLagLimit,
+                                   int checkInterval)
+    : _dbHandle(dbHandle), _binlogLagLimit(binlogLagLimit), _checkInterval(checkInterval)
+{
+}
+
+void TransferThrottle::watch(const TransferInfo &transferInfo)
+{
+    if (_binlogLagLimit <= 0)
+    {
+        return;
+    }
+
+    string key = transferInfo.moduleName + "|" + transferInfo.groupName;
+    TC_ThreadLock::Lock lock(_lock);
+    CheckResult &result = _checkResult[key];
+    result.moduleName = transferInfo.moduleName;
+    result.groupName = transferInfo.groupName;
+    result.useTime = TC_TimeProvider::getInstance()->getNow();
+}
+
+void TransferThrottle::refresh()
+{
+    if (_binlogLagLimit <= 0)
+    {
+        return;
+    }
+
+    time_t now = TC_TimeProvider::getInstance()->getNow();
+    vector<pair<string, string>> vtGroup;
+    {
+        TC_ThreadLock::Lock lock(_lock);
+        map<string, CheckResult>::iterator it = _checkResult.begin();
+        while (it != _checkResult.end())
+        {
+            // 队列中还有任务的组每次调度都会读取结果，长时间没有读取说明该组已没有待迁移的任务
+            if (now - it->second.useTime > 3 * _checkInterval)
+            {
+                _checkResult.erase(it++);
+                continue;
+            }
+            if (it->second.checkTime == 0 || now - it->second.checkTime >= _checkInterval)
+            {
+                vtGroup.push_back(make_pair(it->second.moduleName, it->second.groupName));
+            }
+            ++it;
+        }
+    }
+
+    // 逐个查询，期间不持有锁
+    for (size_t i = 0; i < vtGroup.size(); ++i)
+    {
+        bool bCanTransfer = checkGroup(vtGroup[i].first, vtGroup[i].second);
+
+        TC_ThreadLock::Lock lock(_lock);
+        map<string, CheckResult>::iterator it =
+            _checkResult.find(vtGroup[i].first + "|" + vtGroup[i].second);
+        if (it != _checkResult.end())
+        {
+            it->second.checkTime = TC_TimeProvider::getInstance()->getNow();
+            it->second.bCanTransfer = bCanTransfer;
+        }
+    }
+}
+
+bool TransferThrottle::canTransfer(const TransferInfo &transferInfo)
+{
+    if (_binlogLagLimit <= 0)
+    {
+        return true;
+    }
+
+    string key = transferInfo.moduleName + "|" + transferInfo.groupName;
+    TC_ThreadLock::Lock lock(_lock);
+    CheckResult &result = _checkResult[key];
+    if (result.checkTime == 0)
+    {
+        // 还没有检查过(或长时间未读取已被清理)的组，登记后下次refresh时检查
+        result.moduleName = transferInfo.moduleName;
+        result.groupName = transferInfo.groupName;
+    }
+    result.useTime = TC_TimeProvider::getInstance()->getNow();
+    return result.bCanTransfer;
+}
+
+bool TransferThrottle::checkGroup(const string &moduleName, const string &groupName)
+{
+    PackTable packTable;
+    if (_dbHandle->getPackTable(moduleName, packTable) != 0)
+    {
+        // 模块不存在时交给迁移流程报错
+        return true;
+    }
+
+    // 源组的任一备机延迟超限即暂缓，查询失败的备机不计入
+    map<string, ServerInfo>::const_iterator it;
+    for (it = packTable.serverList.begin(); it != packTable.serverList.end(); ++it)
+    {
+        if (it->second.groupName != groupName || it->second.ServerStatus != "S")
+        {
+            continue;
+        }
+
+        int lag = 0;
+        if (getBinlogLag(it->first, lag) == 0 && lag > _binlogLagLimit)
+        {
+            FDLOG("TransferDispatcher") << __LINE__ << "|" << __FUNCTION__ << "|" << moduleName
+                                        << "|" << groupName << "|slave: " << it->first
+                                        << " binlog lag: " << lag << "s, delay transfer" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+int TransferThrottle::getBinlogLag(const string &serverName, int &lag)
+{
+    try
+    {
+        RouterClientPrx prx =
+            Application::getCommunicator()->stringToProxy<RouterClientPrx>(serverName + ".RouterClientObj");
+        prx->tars_timeout(3000);
+        return prx->getBinlogdif(lag) == 0 ? 0 : -1;
+    }
+    catch (const TarsException &ex)
+    {
+        TLOGERROR(FILE_FUN << "get binlog lag of " << serverName << " exception: " << ex.what() << endl);
+    }
+    return -1;
+}
+
 TransferDispatcher::TransferDispatcher(DoTransfer func,
                                        int threadPoolSize,
                                        int minSizeEachGroup,
-                                       int maxSizeEachGroup)
+                                       int maxSizeEachGroup,
+                                       int maxSizeEachDestGroup,
+                                       CanTransfer canTransfer)
     : _tasksNumInQueue(0),
       _TransferingTasksNum(0),
       _idleThreadNum(threadPoolSize),
       _transferFunc(func),
       _minThreadEachGroup(minSizeEachGroup),
-      _maxThreadEachGroup(maxSizeEachGroup)
+      _maxThreadEachGroup(maxSizeEachGroup),
+      _maxThreadEachDestGroup(maxSizeEachDestGroup),
+      _canTransfer(canTransfer)
 {
     _tpool.init(_idleThreadNum);
     _tpool.start();
@@ -1808,10 +2068,31 @@ void TransferDispatcher::transferFuncWrapper(std::shared_ptr<TransferInfo> task)
         {
             _transferingTasks.erase(it);
         }
+
+        auto itDest = _transferingDestTasks.find(task->transGroupName);
+        assert(itDest != _transferingDestTasks.end());
+        if (--(itDest->second) == 0)
+        {
+            _transferingDestTasks.erase(itDest);
+        }
     }
     ++_idleThreadNum;
 }
 
+bool TransferDispatcher::canStart(const TransferInfo &task)
+{
+    if (_maxThreadEachDestGroup > 0)
+    {
+        auto it = _transferingDestTasks.find(task.transGroupName);
+        if (it != _transferingDestTasks.end() && it->second >= _maxThreadEachDestGroup)
+        {
+            return false;
+        }
+    }
+
+    return !_canTransfer || _canTransfer(task);
+}
+
 void TransferDispatcher::dispatcherTask(int maxThreadNum)
 {
     TC_ThreadLock::Lock lock(_transferingTasksLock);
@@ -1823,7 +2104,9 @@ void TransferDispatcher::dispatcherTask(int maxThreadNum)
         for (auto it = _taskQueue.begin(); it != _taskQueue.end() && _idleThreadNum > 0;)
         {
             auto t = _transferingTasks.find(it->first);
-            if (t == _transferingTasks.end() || t->second < maxThreadNum)
+            // 目的组接收的任务已满或源组负载过高时，本轮跳过该组，线程留给其他源、目的组
+            if ((t == _transferingTasks.end() || t->second < maxThreadNum) &&
+                canStart(*(it->second.front())))
             {
                 assert(it->second.size() > 0);
                 std::shared_ptr<TransferInfo> task = it->second.front();
@@ -1834,6 +2117,7 @@ void TransferDispatcher::dispatcherTask(int maxThreadNum)
                 ++_TransferingTasksNum;
                 --_idleThreadNum;
                 ++_transferingTasks[it->first];
+                ++_transferingDestTasks[task->transGroupName];
                 --remaningThreadNum;
                 TLOGDEBUG("Transfer group name : " << it->first << " | processing thread num: "
                                                    << _transferingTasks[it->first]
@@ -1908,6 +2192,14 @@ int TransferDispatcher::getQueueTaskNum(const std::string &groupName) const
     }
 }
 
+int TransferDispatcher::getTransferingDestTaskNum(const std::string &transGroupName) const
+{
+    TC_ThreadLock::Lock lock(_transferingTasksLock);
+    std::unordered_map<std::string, int>::const_iterator it =
+        _transferingDestTasks.find(transGroupName);
+    return it == _transferingDestTasks.cend() ? 0 : it->second;
+}
+
 int TransferDispatcher::getTransferingTaskNum(const std::string &groupName) const
 {
     TC_ThreadLock::Lock lock(_transferingTasksLock);
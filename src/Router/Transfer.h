@@ -52,6 +52,9 @@ private:
     // 通知迁移源服务器进行迁移
     int notifyTransSrcServerDo(const TransferInfo &transferInfo);
 
+    // 同时通知迁移目的和源服务器准备迁移，两者互不依赖，并行发出省去一次往返
+    void notifyTransServersStart(const TransferInfo &transferInfo, int &destRet, int &srcRet);
+
     // 通知迁移源、目的服务器迁移结果，加载新路由
     int notifyTransResult(const TransferInfo &transferInfo);
 
@@ -121,12 +124,58 @@ private:
     int _transferPagesOnce;           // 每次通知源和目的服务器迁移的页数
     int _transferPagesOnceMax;        // 每次通知源和目的服务器迁移的最大页数
     TC_ThreadLock _transferPageLock;  // 动态调整迁移页数锁
+    bool _parallelNotifyStart;        // 是否并行通知迁移源和目的服务器准备迁移
+};
+
+// 根据迁移源组的负载决定迁移任务现在是否可以开始。
+// 以源组备机的binlog同步延迟衡量负载。查询延迟需要访问cache服务，由TimerThread在调度前调用refresh完成，
+// canTransfer在调度器的锁内调用，只读取缓存的结果。
+class TransferThrottle
+{
+public:
+    TransferThrottle(std::shared_ptr<DbHandle> dbHandle, int binlogLagLimit, int checkInterval);
+
+    virtual ~TransferThrottle() = default;
+
+    // 登记需要检查负载的迁移任务，下次refresh时检查其源组
+    void watch(const TransferInfo &transferInfo);
+
+    // 重新检查登记的、结果超过checkInterval秒的源组，长时间没有任务的组不再检查
+    void refresh();
+
+    // 只读缓存，不访问cache服务；还没有检查过的组允许迁移
+    bool canTransfer(const TransferInfo &transferInfo);
+
+protected:
+    // 查询服务器的binlog同步延迟(秒)，成功返回0
+    virtual int getBinlogLag(const string &serverName, int &lag);
+
+private:
+    struct CheckResult
+    {
+        CheckResult() : checkTime(0), useTime(0), bCanTransfer(true) {}
+
+        string moduleName;
+        string groupName;
+        time_t checkTime;  // 最近一次检查的时间，0表示还没有检查过
+        time_t useTime;    // 最近一次登记或读取的时间
+        bool bCanTransfer;
+    };
+
+    // 检查源组的备机延迟，会访问cache服务，不能在持有调度器的锁时调用
+    bool checkGroup(const string &moduleName, const string &groupName);
+
+    std::shared_ptr<DbHandle> _dbHandle;
+    int _binlogLagLimit;                  // 源组备机binlog延迟超过该值(秒)时暂缓迁移，0不限制
+    int _checkInterval;                   // 同一个组的检查间隔(秒)
+    map<string, CheckResult> _checkResult;  // 模块名+组名 -> 最近一次检查结果
+    TC_ThreadLock _lock;
 };
 
 struct TransferParam : public TC_HandleBase
 {
     TransferParam(pthread_mutex_t *mutex, pthread_cond_t *cond, int ret)
-        : _mutex(mutex), _cond(cond), _return(ret)
+        : _mutex(mutex), _cond(cond), _return(ret), _done(false)
     {
     }
 
@@ -136,6 +185,7 @@ struct TransferParam : public TC_HandleBase
     pthread_cond_t *_cond;
 
     int _return;
+    bool _done;  // 回调是否已经返回，在_mutex内修改
 };
 typedef tars::TC_AutoPtr<TransferParam> TransferParamPtr;
 
@@ -158,6 +208,7 @@ private:
     void wakeUpWaitingThread()
     {
         pthread_mutex_lock(_param->_mutex);
+        _param->_done = true;
         pthread_cond_signal(_param->_cond);
         pthread_mutex_unlock(_param->_mutex);
     }
@@ -169,10 +220,16 @@ class TransferDispatcher : public std::enable_shared_from_this<TransferDispatche
 public:
     typedef std::function<int(const TransferInfo &, std::string &)> DoTransfer;
 
+    // 判断任务现在是否可以开始，返回false时任务留在队列中，下次调度时再判断
+    typedef std::function<bool(const TransferInfo &)> CanTransfer;
+
+    // maxSizeEachDestGroup: 每个迁移目的组同时接收的最大任务数，0不限制
     TransferDispatcher(DoTransfer func,
                        int threadPoolSize,
                        int minSizeEachGroup,
-                       int maxSizeEachGroup);
+                       int maxSizeEachGroup,
+                       int maxSizeEachDestGroup = 0,
+                       CanTransfer canTransfer = CanTransfer());
 
     // 向任务队列中增加任务
     void addTransferTask(std::shared_ptr<TransferInfo> task);
@@ -196,15 +253,21 @@ public:
     // 获取全部正在执行迁移的任务数
     int getTotalTransferingThreadNum() const { return _TransferingTasksNum; }
 
+    // 获取迁移到指定目的组的正在执行的任务数
+    int getTransferingDestTaskNum(const std::string &transGroupName) const;
+
 private:
     typedef std::unordered_map<std::string, std::queue<std::shared_ptr<TransferInfo>>>
         TransferQueue;
     // 分配任务，每个组最多分配maxThreadNum个线程
     void dispatcherTask(int maxThreadNum);
     void transferFuncWrapper(std::shared_ptr<TransferInfo> task);
+    // 任务现在是否可以开始，调用时需持有_transferingTasksLock
+    bool canStart(const TransferInfo &task);
     TransferQueue _taskQueue;  //待执行迁移的任务队列;eue;
     // mutable tars::TC_ThreadLock _taskQueueLock;
     std::unordered_map<std::string, int> _transferingTasks;  // 正在执行迁移的任务
+    std::unordered_map<std::string, int> _transferingDestTasks;  // 每个目的组正在执行迁移的任务
     mutable tars::TC_ThreadLock _transferingTasksLock;
     std::atomic<int> _tasksNumInQueue;      // 待迁移的任务数
     std::atomic<int> _TransferingTasksNum;  // 正在迁移的任务数
@@ -213,6 +276,8 @@ private:
     DoTransfer _transferFunc;               // 执行迁移任务的函数
     const int _minThreadEachGroup;          // 每组分配的最小线程数
     const int _maxThreadEachGroup;          // 每组分配的最大线程数
+    const int _maxThreadEachDestGroup;      // 每个目的组同时接收的最大任务数，0不限制
+    CanTransfer _canTransfer;               // 按源组负载限流，为空时不限制
 };
 
 }  // namespace DCache
@@ -13,6 +13,7 @@
 */
 #include <gtest/gtest.h>
 #include <unistd.h>
+#include <map>
 #include "CacheServer.h"
 
 extern SHashMap g_sHashMap;
@@ -145,6 +146,37 @@ class HashmapTest : public ::testing::Test
         return true;
     }
 
+    //一半的value有两个后续chunk(尾部chunk的前一个是chunk)，一半只有一个(前一个是block头)
+    static string bigValue(size_t i)
+    {
+        const size_t iChunkData = 256 * 1024 - sizeof(TC_HashMapMalloc::Block::tagChunkHead);
+        return string((i % 200 == 0 ? 2 : 1) * iChunkData + 40, 'b') + TC_Common::tostr(i + 100000);
+    }
+
+    static size_t spanNum(size_t &iFreePageNum)
+    {
+        vector<TC_Page::tagSizeClassStat> vtStat;
+        iFreePageNum = 0;
+        g_sHashMap.getSizeClassStat(30, vtStat, iFreePageNum);
+
+        size_t iSpanNum = 0;
+        for (size_t i = 0; i < vtStat.size(); ++i)
+        {
+            iSpanNum += vtStat[i]._iSpanNum;
+        }
+        return iSpanNum;
+    }
+
+    static uint32_t defragAll()
+    {
+        uint32_t iMoved = 0;
+        for (SHashMap::dcache_hash_iterator it = g_sHashMap.hashBegin(); it != g_sHashMap.hashEnd(); ++it)
+        {
+            iMoved += it->defrag(30);
+        }
+        return iMoved;
+    }
+
     string _cacheConf;
     TC_Config _tcConf;
 
@@ -323,6 +355,45 @@ TEST_F(HashmapTest, update)
     EXPECT_EQ(value, "-3");
 }
 
+TEST_F(HashmapTest, updateCounter)
+{
+    _key += "counter";
+    string value;
+    string retValue;
+    uint32_t iSynTime, iExpireTime;
+    uint8_t iVersion;
+
+    //位数变化时结果仍然正确
+    int ret = g_sHashMap.set(_key, "999999999", _dirty, 0, 0);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    ret = g_sHashMap.update(_key, "1", ADD, _dirty, 0, false, -1, retValue);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    EXPECT_EQ(retValue, "1000000000");
+    ret = g_sHashMap.update(_key, "1000000001", SUB, _dirty, 0, false, -1, retValue);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    EXPECT_EQ(retValue, "-1");
+    ret = g_sHashMap.get(_key, value, iSynTime, iExpireTime, iVersion);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    EXPECT_EQ(value, "-1");
+
+    //int64范围
+    ret = g_sHashMap.set(_key, "9223372036854775806", _dirty, 0, 0);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    ret = g_sHashMap.update(_key, "1", ADD_INSERT, _dirty, 0, false, -1, retValue);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    EXPECT_EQ(retValue, "9223372036854775807");
+
+    //小数部分截掉
+    ret = g_sHashMap.set(_key, "10.9", _dirty, 0, 0);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    ret = g_sHashMap.update(_key, "2.5", ADD, _dirty, 0, false, -1, retValue);
+    ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    EXPECT_EQ(retValue, "12");
+
+    ret = g_sHashMap.update(_key, "-", ADD, _dirty, 0, false, -1, retValue);
+    EXPECT_EQ(ret, TC_HashMapMalloc::RT_DATATYPE_ERR);
+}
+
 TEST_F(HashmapTest, erase)
 {
     _key += "erase";
@@ -397,6 +468,343 @@ TEST_F(HashmapTest, delWithVer)
     ASSERT_EQ(ret, TC_HashMapMalloc::RT_NO_DATA);
 }
 
+TEST_F(HashmapTest, getBatch)
+{
+    vector<string> vtKey;
+    for (int i = 0; i < 200; ++i)
+    {
+        string key = _key + "batch" + TC_Common::tostr(i);
+        if (i % 2 == 0)
+        {
+            int ret = g_sHashMap.set(key, _value + TC_Common::tostr(i), _dirty, 0, 0);
+            ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        }
+        vtKey.push_back(key);
+    }
+
+    vector<BatchGetItem> vtItem;
+    g_sHashMap.getBatch(vtKey, vtItem, false);
+    ASSERT_EQ(vtItem.size(), vtKey.size());
+    for (size_t i = 0; i < vtItem.size(); ++i)
+    {
+        EXPECT_EQ(*vtItem[i].key, vtKey[i]);
+        if (i % 2 == 0)
+        {
+            ASSERT_EQ(vtItem[i].ret, TC_HashMapMalloc::RT_OK);
+            EXPECT_EQ(vtItem[i].value, _value + TC_Common::tostr(i));
+        }
+        else
+        {
+            EXPECT_EQ(vtItem[i].ret, TC_HashMapMalloc::RT_NO_DATA);
+        }
+    }
+
+    g_sHashMap.getBatch(vtKey, vtItem, true);
+    ASSERT_EQ(vtItem.size(), vtKey.size());
+    for (size_t i = 0; i < vtItem.size(); ++i)
+    {
+        if (i % 2 == 0)
+        {
+            EXPECT_EQ(vtItem[i].ret, _dirty ? TC_HashMapMalloc::RT_DIRTY_DATA : TC_HashMapMalloc::RT_OK);
+        }
+        else
+        {
+            EXPECT_EQ(vtItem[i].ret, TC_HashMapMalloc::RT_NO_DATA);
+        }
+    }
+}
+
+//key跨多个chunk，及互为前缀的key
+TEST_F(HashmapTest, longKey)
+{
+    vector<string> vtKey;
+    vtKey.push_back(string(1000, 'k'));
+    vtKey.push_back(string(999, 'k'));
+    vtKey.push_back(string(1000, 'k') + "1");
+    vtKey.push_back(string(300, 'k') + string(700, 'x'));
+    for (size_t i = 0; i < vtKey.size(); ++i)
+    {
+        int ret = g_sHashMap.set(vtKey[i], _value + TC_Common::tostr(i), _dirty, 0, 0);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    }
+
+    for (size_t i = 0; i < vtKey.size(); ++i)
+    {
+        string value;
+        uint32_t iSynTime, iExpireTime;
+        uint8_t iVersion;
+        int ret = g_sHashMap.get(vtKey[i], value, iSynTime, iExpireTime, iVersion);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        EXPECT_EQ(value, _value + TC_Common::tostr(i));
+    }
+
+    string value;
+    uint32_t iSynTime, iExpireTime;
+    uint8_t iVersion;
+    EXPECT_EQ(g_sHashMap.get(string(1000, 'k') + "2", value, iSynTime, iExpireTime, iVersion), TC_HashMapMalloc::RT_NO_DATA);
+    EXPECT_EQ(g_sHashMap.get(string(998, 'k'), value, iSynTime, iExpireTime, iVersion), TC_HashMapMalloc::RT_NO_DATA);
+
+    for (size_t i = 0; i < vtKey.size(); ++i)
+    {
+        EXPECT_EQ(g_sHashMap.del(vtKey[i]), TC_HashMapMalloc::RT_OK);
+    }
+}
+
+//碎片整理：删除大部分数据后搬移稀疏span中的数据，span数减少且数据不变
+//超过256K的value由block头和后续chunk组成，长度凑成最后一个chunk与小数据同属一个尺寸类别，
+//小数据全部删除后尾部chunk所在的span变稀疏，只能由moveChunks搬移
+TEST_F(HashmapTest, defrag)
+{
+    const size_t iKeyNum = 20000;
+    for (size_t i = 0; i < iKeyNum; ++i)
+    {
+        int ret = g_sHashMap.set("defrag_" + TC_Common::tostr(i), _value + TC_Common::tostr(i), _dirty, 0, 0);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        if (i % 100 == 0)
+        {
+            ret = g_sHashMap.set("defrag_big_" + TC_Common::tostr(i), bigValue(i), _dirty, 0, 0);
+            ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        }
+    }
+    for (size_t i = 0; i < iKeyNum; ++i)
+    {
+        if (i % 5 != 0)
+        {
+            EXPECT_EQ(g_sHashMap.del("defrag_" + TC_Common::tostr(i)), TC_HashMapMalloc::RT_OK);
+        }
+    }
+
+    size_t iFreeBefore = 0, iFreeAfter = 0;
+    size_t iSpanBefore = spanNum(iFreeBefore);
+    uint32_t iMoved = defragAll();
+    size_t iSpanAfter = spanNum(iFreeAfter);
+    cout << "defrag moved:" << iMoved << "|span:" << iSpanBefore << "->" << iSpanAfter << endl;
+    EXPECT_GT(iMoved, 0u);
+    EXPECT_LT(iSpanAfter, iSpanBefore);
+    EXPECT_GE(iFreeAfter, iFreeBefore);
+
+    for (size_t i = 0; i < iKeyNum; i += 5)
+    {
+        string value;
+        uint32_t iSynTime, iExpireTime;
+        uint8_t iVersion;
+        int ret = g_sHashMap.get("defrag_" + TC_Common::tostr(i), value, iSynTime, iExpireTime, iVersion);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        EXPECT_EQ(value, _value + TC_Common::tostr(i));
+        EXPECT_EQ(g_sHashMap.del("defrag_" + TC_Common::tostr(i)), TC_HashMapMalloc::RT_OK);
+    }
+
+    //只剩多chunk的数据，block头和中间的chunk独占span，搬移的都是尾部chunk
+    iSpanBefore = spanNum(iFreeBefore);
+    iMoved = defragAll();
+    iSpanAfter = spanNum(iFreeAfter);
+    cout << "defrag chunks moved:" << iMoved << "|span:" << iSpanBefore << "->" << iSpanAfter << endl;
+    EXPECT_GT(iMoved, 0u);
+    EXPECT_LT(iSpanAfter, iSpanBefore);
+
+    for (size_t i = 0; i < iKeyNum; i += 100)
+    {
+        string value;
+        uint32_t iSynTime, iExpireTime;
+        uint8_t iVersion;
+        int ret = g_sHashMap.get("defrag_big_" + TC_Common::tostr(i), value, iSynTime, iExpireTime, iVersion);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        EXPECT_TRUE(value == bigValue(i)) << "defrag_big_" << i;
+        EXPECT_EQ(g_sHashMap.del("defrag_big_" + TC_Common::tostr(i)), TC_HashMapMalloc::RT_OK);
+    }
+}
+
+//尺寸类别：按数据尺寸分布推导的尺寸类别浪费更少，清空数据后生效且数据读写正常
+TEST_F(HashmapTest, sizeClass)
+{
+    const size_t iKeyNum = 20000;
+    for (size_t i = 0; i < iKeyNum; ++i)
+    {
+        int ret = g_sHashMap.set("sizeclass_" + TC_Common::tostr(i), string(310 + i % 21, 's'), _dirty, 0, 0);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    }
+
+    vector<uint64_t> vtHist;
+    vector<size_t> vtClassSize, vtLearn;
+    uint64_t iWaste = 0;
+    g_sHashMap.getSizeClassInfo(vtHist, vtClassSize, iWaste);
+    SizeMap::LearnClassSize(vtHist, 25, vtLearn);
+
+    SizeMap sizeMap;
+    ASSERT_TRUE(sizeMap.Init(vtLearn));
+    EXPECT_LT(sizeMap.EstimateWaste(vtHist), iWaste);
+
+    ASSERT_TRUE(g_sHashMap.initSizeClass(vtLearn, false, 25));
+    g_sHashMap.clear();
+
+    vtHist.clear();
+    vtClassSize.clear();
+    g_sHashMap.getSizeClassInfo(vtHist, vtClassSize, iWaste);
+    EXPECT_EQ(vtClassSize.size(), sizeMap.NumClasses() - 1);
+
+    for (size_t i = 0; i < iKeyNum; ++i)
+    {
+        int ret = g_sHashMap.set("sizeclass_" + TC_Common::tostr(i), string(310 + i % 21, 's'), _dirty, 0, 0);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    }
+    for (size_t i = 0; i < iKeyNum; ++i)
+    {
+        string value;
+        uint32_t iSynTime, iExpireTime;
+        uint8_t iVersion;
+        int ret = g_sHashMap.get("sizeclass_" + TC_Common::tostr(i), value, iSynTime, iExpireTime, iVersion);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        EXPECT_EQ(value, string(310 + i % 21, 's'));
+    }
+
+    vtLearn.clear();
+    ASSERT_TRUE(g_sHashMap.initSizeClass(vtLearn, false, 25));
+    g_sHashMap.clear();
+}
+
+//value压缩：压缩和使用训练的字典后数据不变，压缩保存的数据可以update，关闭压缩后已压缩的数据仍可读取
+TEST_F(HashmapTest, compress)
+{
+    TC_Config conf;
+    conf.parseString("<Main>\n<Compress>\nEnable=Y\nDictDir=./compress_dict_test\n</Compress>\n</Main>");
+    ValueCompressor::getInstance()->init(conf);
+    g_sHashMap.setValueCodec(ValueCompressor::getInstance());
+
+    string sValue;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        sValue += "{\"id\":" + TC_Common::tostr(i % 7) + ",\"name\":\"dcache\",\"type\":\"kv\"},";
+    }
+
+    const size_t iKeyNum = 200;
+    vector<string> vtSample;
+    for (size_t i = 0; i < iKeyNum; ++i)
+    {
+        int ret = g_sHashMap.set("compress_" + TC_Common::tostr(i), sValue + TC_Common::tostr(i), _dirty, 0, 0);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        vtSample.push_back(sValue + TC_Common::tostr(i));
+    }
+
+    uint32_t iDictId = 0;
+    string sErr;
+    ASSERT_EQ(ValueCompressor::getInstance()->trainDict(vtSample, iDictId, sErr), 0);
+    for (size_t i = 0; i < iKeyNum; i += 2)
+    {
+        int ret = g_sHashMap.set("compress_" + TC_Common::tostr(i), sValue + TC_Common::tostr(i), _dirty, 0, 0);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+    }
+
+    //压缩保存的value(不使用字典和使用字典)也可以update
+    const string sAppend = "_append";
+    for (size_t i = 0; i < 2; ++i)
+    {
+        string retValue;
+        int ret = g_sHashMap.update("compress_" + TC_Common::tostr(i), sAppend, APPEND, _dirty, 0, false, -1, retValue);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        EXPECT_EQ(retValue, sValue + TC_Common::tostr(i) + sAppend);
+    }
+
+    conf.parseString("<Main>\n<Compress>\nEnable=N\nDictDir=./compress_dict_test\n</Compress>\n</Main>");
+    ValueCompressor::getInstance()->init(conf);
+    for (size_t i = 0; i < iKeyNum; ++i)
+    {
+        string value;
+        uint32_t iSynTime, iExpireTime;
+        uint8_t iVersion;
+        int ret = g_sHashMap.get("compress_" + TC_Common::tostr(i), value, iSynTime, iExpireTime, iVersion);
+        ASSERT_EQ(ret, TC_HashMapMalloc::RT_OK);
+        EXPECT_EQ(value, sValue + TC_Common::tostr(i) + (i < 2 ? sAppend : ""));
+        EXPECT_EQ(g_sHashMap.del("compress_" + TC_Common::tostr(i)), TC_HashMapMalloc::RT_OK);
+    }
+}
+
+//指纹数组：随机增删、淘汰后查找结果与模型一致，hash比很大时同一hash桶超过8个block也能找到
+TEST(HashMapMallocFingerprint, randomOps)
+{
+    const size_t iMemSize = 8 * 1024 * 1024;
+    vector<char> vtFpMem(iMemSize), vtPlainMem(iMemSize);
+
+    TC_HashMapMalloc fpMap, plainMap;
+    fpMap.initHashRadio(64);
+    fpMap.initAvgDataSize(48);
+    fpMap.initFingerprint(true);
+    fpMap.create(&vtFpMem[0], iMemSize);
+    fpMap.setAutoErase(false);
+    plainMap.initHashRadio(64);
+    plainMap.initAvgDataSize(48);
+    plainMap.create(&vtPlainMem[0], iMemSize);
+    plainMap.setAutoErase(false);
+    ASSERT_TRUE(fpMap.hasFingerprint());
+    ASSERT_FALSE(plainMap.hasFingerprint());
+
+    map<string, string> mData;
+    vector<TC_HashMapMalloc::BlockData> vtData;
+    srand(20201019);
+    for (size_t i = 0; i < 200000; ++i)
+    {
+        string k = "fp_" + TC_Common::tostr(rand() % 20000);
+        int iOp = rand() % 10;
+        if (iOp < 5)
+        {
+            string v = string(rand() % 64, 'v') + TC_Common::tostr(i);
+            ASSERT_EQ(fpMap.set(k, v, 0, 0, true, vtData), TC_HashMapMalloc::RT_OK);
+            ASSERT_EQ(plainMap.set(k, v, 0, 0, true, vtData), TC_HashMapMalloc::RT_OK);
+            mData[k] = v;
+        }
+        else if (iOp < 8)
+        {
+            TC_HashMapMalloc::BlockData data;
+            int iRet = fpMap.del(k, data);
+            ASSERT_EQ(iRet, plainMap.del(k, data));
+            ASSERT_EQ(iRet == TC_HashMapMalloc::RT_OK, mData.erase(k) == 1);
+        }
+        else if (iOp < 9)
+        {
+            //从LRU尾部淘汰，不带指纹的map删除同一个key
+            TC_HashMapMalloc::BlockData data;
+            if (fpMap.erase(1, data) == TC_HashMapMalloc::RT_ERASE_OK)
+            {
+                ASSERT_EQ(plainMap.del(data._key, data), TC_HashMapMalloc::RT_OK);
+                ASSERT_EQ(mData.erase(data._key), 1u);
+            }
+        }
+
+        string v, sPlain;
+        map<string, string>::const_iterator it = mData.find(k);
+        int iRet = fpMap.get(k, v);
+        ASSERT_EQ(iRet, plainMap.get(k, sPlain));
+        ASSERT_EQ(iRet, it == mData.end() ? TC_HashMapMalloc::RT_NO_DATA : TC_HashMapMalloc::RT_OK) << k;
+        if (it != mData.end())
+        {
+            ASSERT_EQ(v, it->second);
+        }
+    }
+
+    uint32_t iMaxList = 0;
+    for (map<string, string>::const_iterator it = mData.begin(); it != mData.end(); ++it)
+    {
+        iMaxList = max(iMaxList, fpMap.item(fpMap.getHashIndex(it->first))->_iListCount);
+    }
+    EXPECT_GT(iMaxList, 8u);
+    EXPECT_EQ(fpMap.size(), mData.size());
+
+    //连接已有内存时按头部的记录使用指纹数组
+    TC_HashMapMalloc connMap;
+    connMap.connect(&vtFpMem[0], iMemSize);
+    ASSERT_TRUE(connMap.hasFingerprint());
+    for (map<string, string>::const_iterator it = mData.begin(); it != mData.end(); ++it)
+    {
+        string v;
+        ASSERT_EQ(connMap.get(it->first, v), TC_HashMapMalloc::RT_OK);
+        EXPECT_EQ(v, it->second);
+        EXPECT_EQ(connMap.checkDirty(it->first + "_miss"), TC_HashMapMalloc::RT_NO_DATA);
+    }
+
+    fpMap.clear();
+    string v;
+    EXPECT_EQ(fpMap.get(mData.begin()->first, v), TC_HashMapMalloc::RT_NO_DATA);
+}
+
 //Test hashmapDestory must be the last one.
 TEST_F(HashmapTest, hashmapDestory)
 {
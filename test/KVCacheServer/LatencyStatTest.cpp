@@ -0,0 +1,103 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "util/tc_config.h"
+#include "LatencyStat.h"
+
+class LatencyStatTest : public ::testing::Test
+{
+  protected:
+    LatencyStatTest() = default;
+    ~LatencyStatTest() = default;
+
+    void SetUp() override
+    {
+        TC_Config conf;
+        conf.parseString("<Main>\n<Latency>\nEnable=Y\nSlowThreshold=5\nSlowSampleRate=1\nSlowLogSize=2\n</Latency>\n</Main>\n");
+        _stat = LatencyStat::getInstance();
+        _stat->init(conf);
+        _stat->command("reset");
+        _key = "key1";
+    }
+
+    void TearDown() override
+    {
+        _stat->command("reset");
+    }
+
+    LatencyStat *_stat;
+    string _key;
+};
+
+TEST_F(LatencyStatTest, NestedTraceCountedOnce)
+{
+    for (int i = 0; i < 10; ++i)
+    {
+        OpTrace trace(LOP_SET_KV, _key);
+        OpTrace inner(LOP_GET_KV, _key);
+    }
+
+    string result = _stat->command("");
+    EXPECT_NE(result.find("setKV.total|count=10|"), string::npos);
+    EXPECT_EQ(result.find("getKV."), string::npos);
+}
+
+TEST_F(LatencyStatTest, PhaseAndSlowRecord)
+{
+    {
+        OpTrace trace(LOP_SET_KV, _key);
+        PhaseTimer timer(LPH_BINLOG);
+        usleep(10000);
+    }
+
+    string phase = _stat->command("phase");
+    EXPECT_NE(phase.find("setKV.binlog|count=1|"), string::npos);
+
+    string slow = _stat->command("slow");
+    EXPECT_NE(slow.find("|setKV|key1|"), string::npos);
+}
+
+TEST_F(LatencyStatTest, PhaseTimerWithoutTrace)
+{
+    {
+        PhaseTimer timer(LPH_BINLOG);
+    }
+    EXPECT_EQ(_stat->command("phase").find("binlog"), string::npos);
+}
+
+TEST_F(LatencyStatTest, SlowLogSizeLimit)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        _stat->recordDb(LOP_GET_KV, 10000 + i, _key);
+    }
+
+    string slow = _stat->command("slow");
+    EXPECT_EQ(slow.find("db=10000|"), string::npos);
+    EXPECT_NE(slow.find("db=10001|"), string::npos);
+    EXPECT_NE(slow.find("db=10002|"), string::npos);
+    EXPECT_NE(_stat->command("phase").find("getKV.db|count=3|"), string::npos);
+}
+
+TEST_F(LatencyStatTest, Reset)
+{
+    {
+        OpTrace trace(LOP_DEL_KV, _key);
+    }
+    EXPECT_NE(_stat->command("").find("delKV.total"), string::npos);
+
+    _stat->command("reset");
+    EXPECT_EQ(_stat->command("").find("delKV.total"), string::npos);
+}
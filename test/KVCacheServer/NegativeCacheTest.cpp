@@ -0,0 +1,171 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "util/tc_config.h"
+#include "FastHash.h"
+#include "CuckooFilter.h"
+#include "NegativeCache.h"
+
+static uint64_t keyHash(size_t i)
+{
+    string k = "user_" + TC_Common::tostr(i);
+    return FastHash::hash64(k.c_str(), k.length(), 1);
+}
+
+TEST(CuckooFilterTest, AddEraseRotate)
+{
+    CuckooFilter filter;
+    filter.init(10000);
+    ASSERT_GE(filter.capacity(), 10000u);
+
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        EXPECT_TRUE(filter.add(keyHash(i)));
+    }
+    //指纹和桶都相同的元素只保存一份
+    EXPECT_GT(filter.size(), 9990u);
+
+    //加入的元素都能查到
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        ASSERT_TRUE(filter.contains(keyHash(i)));
+    }
+
+    //未加入的元素误判率接近估算值
+    size_t iFalse = 0;
+    for (size_t i = 10000; i < 1010000; ++i)
+    {
+        iFalse += filter.contains(keyHash(i)) ? 1 : 0;
+    }
+    EXPECT_LT(double(iFalse) / 1000000, filter.fpp() * 2 + 0.0001);
+
+    EXPECT_TRUE(filter.erase(keyHash(1)));
+    EXPECT_FALSE(filter.contains(keyHash(1)));
+    EXPECT_FALSE(filter.erase(keyHash(1)));
+
+    //切换一代后仍在旧代中，再切换一代后丢弃
+    filter.rotate();
+    EXPECT_TRUE(filter.contains(keyHash(2)));
+    filter.rotate();
+    EXPECT_FALSE(filter.contains(keyHash(2)));
+    EXPECT_EQ(filter.size(), 0u);
+}
+
+TEST(CuckooFilterTest, RotateWhenFull)
+{
+    CuckooFilter filter;
+    filter.init(1000);
+
+    size_t iRotate = 0;
+    for (size_t i = 0; i < filter.capacity() * 3; ++i)
+    {
+        if (!filter.add(keyHash(i)))
+        {
+            ++iRotate;
+        }
+        ASSERT_LE(filter.size(), filter.capacity() * 2);
+    }
+    EXPECT_GE(iRotate, 2u);
+
+    //最近加入的元素一定能查到
+    EXPECT_TRUE(filter.contains(keyHash(filter.capacity() * 3 - 1)));
+}
+
+TEST(FastHashTest, Hash64FoldEqualsHash)
+{
+    for (size_t len = 0; len < 200; ++len)
+    {
+        string k(len, 'a' + len % 26);
+        uint64_t h = FastHash::hash64(k.c_str(), k.length());
+        uint32_t v = uint32_t(h ^ (h >> 32));
+        EXPECT_EQ(FastHash::hash(k.c_str(), k.length()), v == 0 ? 1 : v);
+        EXPECT_NE(FastHash::hash64(k.c_str(), k.length(), 1), h);
+    }
+}
+
+class NegativeCacheTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        _cache = NegativeCache::getInstance();
+        init("Y", "0");
+    }
+
+    void TearDown() override
+    {
+        init("N", "0");
+    }
+
+    void init(const string &sEnable, const string &sVerifyRate)
+    {
+        TC_Config conf;
+        conf.parseString("<Main>\n<NegativeFilter>\nEnable=" + sEnable + "\nCapacity=10000\nShardNum=4\nAgeSecond=0\nVerifyRate="
+                         + sVerifyRate + "\n</NegativeFilter>\n</Main>\n");
+        _cache->init(conf);
+    }
+
+    NegativeCache *_cache;
+};
+
+TEST_F(NegativeCacheTest, AddAndWrite)
+{
+    EXPECT_FALSE(_cache->check("key1"));
+
+    _cache->add("key1");
+    _cache->add("key2");
+    EXPECT_TRUE(_cache->check("key1"));
+    EXPECT_TRUE(_cache->check("key2"));
+
+    //写入后不再认为不存在
+    _cache->onWrite("key1");
+    EXPECT_FALSE(_cache->check("key1"));
+    EXPECT_TRUE(_cache->check("key2"));
+
+    _cache->clear();
+    EXPECT_FALSE(_cache->check("key2"));
+}
+
+TEST_F(NegativeCacheTest, VerifyAndWrong)
+{
+    init("Y", "2");
+
+    _cache->add("key1");
+    //两次命中有一次放过去查DB
+    int iPass = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        iPass += _cache->check("key1") ? 0 : 1;
+    }
+    EXPECT_EQ(iPass, 1);
+
+    //DB中查到说明误判
+    _cache->onDbData("key1");
+    EXPECT_FALSE(_cache->check("key1"));
+
+    string sStatus = _cache->status();
+    EXPECT_NE(sStatus.find("verified: 1, wrong: 1"), string::npos);
+}
+
+TEST_F(NegativeCacheTest, Disable)
+{
+    _cache->add("key1");
+    init("N", "0");
+    EXPECT_FALSE(_cache->isEnable());
+    EXPECT_FALSE(_cache->check("key1"));
+
+    //重新开启时已清空
+    init("Y", "0");
+    EXPECT_FALSE(_cache->check("key1"));
+}
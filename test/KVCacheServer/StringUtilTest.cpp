@@ -0,0 +1,45 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "StringUtil.h"
+
+TEST(StringUtilTest, MatchPattern)
+{
+    EXPECT_TRUE(StringUtil::matchPattern("", ""));
+    EXPECT_TRUE(StringUtil::matchPattern("", "*"));
+    EXPECT_FALSE(StringUtil::matchPattern("", "?"));
+    EXPECT_FALSE(StringUtil::matchPattern("a", ""));
+
+    EXPECT_TRUE(StringUtil::matchPattern("user_123", "user_*"));
+    EXPECT_TRUE(StringUtil::matchPattern("user_123", "*_123"));
+    EXPECT_TRUE(StringUtil::matchPattern("user_123", "u*r_1?3"));
+    EXPECT_FALSE(StringUtil::matchPattern("user_123", "user_?"));
+    EXPECT_FALSE(StringUtil::matchPattern("order_1", "user_*"));
+
+    //*需要回溯
+    EXPECT_TRUE(StringUtil::matchPattern("abcbcd", "a*bcd"));
+    EXPECT_TRUE(StringUtil::matchPattern("aaab", "*a*b"));
+    EXPECT_FALSE(StringUtil::matchPattern("aaac", "*a*b"));
+
+    //转义
+    EXPECT_TRUE(StringUtil::matchPattern("a*b", "a\\*b"));
+    EXPECT_FALSE(StringUtil::matchPattern("axb", "a\\*b"));
+    EXPECT_TRUE(StringUtil::matchPattern("a?", "a\\?"));
+
+    //key中可以包含\0
+    string sKey("ab\0cd", 5);
+    EXPECT_TRUE(StringUtil::matchPattern(sKey, "ab*"));
+    EXPECT_TRUE(StringUtil::matchPattern(sKey, string("ab\0*", 4)));
+    EXPECT_FALSE(StringUtil::matchPattern(sKey, "abcd"));
+}
@@ -0,0 +1,158 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "MKBinLogEncode.h"
+
+class MKBinLogEncodeTest : public ::testing::Test
+{
+  protected:
+    MKBinLogEncodeTest() = default;
+    ~MKBinLogEncodeTest() = default;
+
+    void SetUp() override
+    {
+        _mk = "mk001";
+        initMap(_master, _masterMem);
+        initMap(_slave, _slaveMem);
+    }
+
+    void TearDown() override
+    {
+    }
+
+    void initMap(TC_Multi_HashMap_Malloc &map, vector<char> &mem)
+    {
+        mem.resize(64 * 1024 * 1024);
+        map.initMainKeySize(0);
+        map.initHashRatio(2);
+        map.initMainKeyHashRatio(8);
+        map.initDataSize(64);
+        map.create(&mem[0], mem.size(), TC_Multi_HashMap_Malloc::MainKey::HASH_TYPE);
+        map.setAutoErase(false);
+    }
+
+    int set(TC_Multi_HashMap_Malloc &map, const string &uk, const string &value, bool bDirty)
+    {
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        return map.set(_mk, uk, map.getHashFunctor()(_mk + uk), value, 0, 0, bDirty,
+                       TC_Multi_HashMap_Malloc::AUTO_DATA, true, false, TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+    }
+
+    //与MKBinLogThread中不带DB时备机执行单条set/del的方式一致
+    void replay(TC_Multi_HashMap_Malloc &map, const string &sBinLog)
+    {
+        MKBinLogEncode encode;
+        encode.Decode(sBinLog);
+        if (encode.GetOpt() == BINLOG_SET)
+        {
+            vector<TC_Multi_HashMap_Malloc::Value> vtData;
+            int iRet = map.set(encode.GetMK(), encode.GetUK(), map.getHashFunctor()(encode.GetMK() + encode.GetUK()), encode.GetValue(),
+                               encode.GetExpireTime(), 0, encode.GetDirty(), TC_Multi_HashMap_Malloc::AUTO_DATA, true, false, TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+            ASSERT_EQ(iRet, TC_Multi_HashMap_Malloc::RT_OK);
+        }
+        else
+        {
+            ASSERT_EQ(encode.GetOpt(), BINLOG_DEL);
+            map.delSetBit(encode.GetMK(), encode.GetUK(), time(NULL));
+        }
+    }
+
+    void expectSame(const string &uk)
+    {
+        TC_Multi_HashMap_Malloc::Value vMaster, vSlave;
+        int iMasterRet = _master.getForRestore(_mk, uk, vMaster);
+        int iSlaveRet = _slave.getForRestore(_mk, uk, vSlave);
+        EXPECT_EQ(iMasterRet, iSlaveRet) << "uk:" << uk;
+        EXPECT_EQ(vMaster._value, vSlave._value) << "uk:" << uk;
+        EXPECT_EQ(vMaster._isDelete, vSlave._isDelete) << "uk:" << uk;
+        EXPECT_EQ(vMaster._dirty, vSlave._dirty) << "uk:" << uk;
+        EXPECT_EQ(vMaster._iExpireTime, vSlave._iExpireTime) << "uk:" << uk;
+    }
+
+    string _mk;
+    vector<char> _masterMem;
+    vector<char> _slaveMem;
+    TC_Multi_HashMap_Malloc _master;
+    TC_Multi_HashMap_Malloc _slave;
+};
+
+//execMKV的一组操作按记录写binlog，备机回放后与主机一致，包括覆盖已存在记录和删除
+TEST_F(MKBinLogEncodeTest, execMKVReplay)
+{
+    TC_Multi_HashMap_Malloc *maps[] = { &_master, &_slave };
+    for (size_t i = 0; i < 2; i++)
+    {
+        ASSERT_EQ(set(*maps[i], "uk1", "v1", false), TC_Multi_HashMap_Malloc::RT_OK);
+        ASSERT_EQ(set(*maps[i], "uk2", "v2", false), TC_Multi_HashMap_Malloc::RT_OK);
+        ASSERT_EQ(set(*maps[i], "uk3", "v3", false), TC_Multi_HashMap_Malloc::RT_OK);
+        ASSERT_EQ(maps[i]->delSetBit(_mk, "uk3", time(NULL)), TC_Multi_HashMap_Malloc::RT_OK);
+    }
+
+    //主机执行：更新uk1，删除uk2，重新写入已删除的uk3，插入uk4
+    vector<MultiHashMap::Value> vtBinLog;
+    MultiHashMap::Value v;
+    v._mkey = _mk;
+
+    v._ukey = "uk1";
+    v._value = "v1-new";
+    v._dirty = true;
+    ASSERT_EQ(set(_master, v._ukey, v._value, v._dirty), TC_Multi_HashMap_Malloc::RT_OK);
+    vtBinLog.push_back(v);
+
+    v._ukey = "uk2";
+    v._value = "v2";
+    v._dirty = false;
+    v._isDelete = TC_Multi_HashMap_Malloc::DELETE_TRUE;
+    ASSERT_EQ(_master.delSetBit(_mk, v._ukey, time(NULL)), TC_Multi_HashMap_Malloc::RT_OK);
+    vtBinLog.push_back(v);
+
+    v._ukey = "uk3";
+    v._value = "v3-new";
+    v._dirty = true;
+    v._isDelete = TC_Multi_HashMap_Malloc::DELETE_FALSE;
+    ASSERT_EQ(set(_master, v._ukey, v._value, v._dirty), TC_Multi_HashMap_Malloc::RT_OK);
+    vtBinLog.push_back(v);
+
+    v._ukey = "uk4";
+    v._value = "v4";
+    ASSERT_EQ(set(_master, v._ukey, v._value, v._dirty), TC_Multi_HashMap_Malloc::RT_OK);
+    vtBinLog.push_back(v);
+
+    vector<string> vtEncoded;
+    MKBinLogEncode encode;
+    encode.EncodeSetDel(_mk, vtBinLog, vtEncoded);
+    ASSERT_EQ(vtEncoded.size(), vtBinLog.size());
+
+    for (size_t i = 0; i < vtEncoded.size(); i++)
+    {
+        replay(_slave, vtEncoded[i]);
+    }
+
+    expectSame("uk1");
+    expectSame("uk2");
+    expectSame("uk3");
+    expectSame("uk4");
+    EXPECT_EQ(_master.count(_mk), _slave.count(_mk));
+}
+
+TEST_F(MKBinLogEncodeTest, encodeSetDelMkMismatch)
+{
+    vector<MultiHashMap::Value> vs(1);
+    vs[0]._mkey = "other";
+    vs[0]._ukey = "uk1";
+
+    vector<string> vtEncoded;
+    MKBinLogEncode encode;
+    EXPECT_THROW(encode.EncodeSetDel(_mk, vs, vtEncoded), BinLogException);
+}
@@ -0,0 +1,170 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "util/tc_common.h"
+#include "util/tc_file.h"
+#include "jmem_multi_hashmap_malloc/MKCacheUtil.h"
+#include "jmem_multi_hashmap_malloc/MKCompactRecord.h"
+
+using namespace tars;
+using namespace HashMap;
+
+class MKCompactRecordTest : public ::testing::Test
+{
+  protected:
+    MKCompactRecordTest() = default;
+    ~MKCompactRecordTest() = default;
+
+    void SetUp() override
+    {
+        _layoutFile = "./MKCompactRecordTest_" + TC_Common::tostr(getpid()) + ".dat";
+        unlink(_layoutFile.c_str());
+        addField("score", 1, "int");
+        addField("name", 2, "string");
+        addField("rate", 3, "double");
+    }
+
+    void TearDown() override
+    {
+        unlink(_layoutFile.c_str());
+    }
+
+    void addField(const string &sName, uint8_t tag, const string &sType)
+    {
+        TC_Multi_HashMap_Malloc::FieldInfo info;
+        info.tag = tag;
+        info.type = sType;
+        info.bRequire = false;
+        info.defValue = (sType == "string") ? "" : "0";
+        info.lengthInDB = 0;
+        if (_fieldConf.mpFieldInfo.find(sName) == _fieldConf.mpFieldInfo.end())
+        {
+            _fieldConf.vtValueName.push_back(sName);
+        }
+        _fieldConf.mpFieldType[sName] = 2;
+        _fieldConf.mpFieldInfo[sName] = info;
+    }
+
+    static string encode(tars::Int32 score, const string &name, double rate)
+    {
+        TarsOutputStream<BufferWriter> os;
+        os.write(score, 1);
+        os.write(name, 2);
+        os.write(rate, 3);
+        return string(os.getBuffer(), os.getLength());
+    }
+
+    CompactRecord *record()
+    {
+        return CompactRecord::getInstance();
+    }
+
+    string _layoutFile;
+    TC_Multi_HashMap_Malloc::FieldConf _fieldConf;
+};
+
+TEST_F(MKCompactRecordTest, roundTrip)
+{
+    record()->init(_fieldConf, true, _layoutFile);
+
+    string sTars = encode(-7, "abc", 1.5);
+    ASSERT_TRUE(record()->needEncode(sTars));
+    string sCompact = record()->fromTars(sTars);
+    EXPECT_TRUE(CompactRecord::isCompact(sCompact));
+    EXPECT_TRUE(record()->isCurrent(sCompact));
+    EXPECT_FALSE(record()->needEncode(sCompact));
+    EXPECT_EQ(record()->toTars(sCompact), sTars);
+
+    EXPECT_EQ(record()->read(sCompact, 1, "0", true), "-7");
+    EXPECT_EQ(record()->read(sCompact, 2, "", true), "abc");
+    EXPECT_TRUE(record()->judge(sCompact, 1, DCache::LT, "0"));
+    EXPECT_TRUE(record()->judge(sCompact, 2, DCache::EQ, "abc"));
+    EXPECT_TRUE(record()->judge(sCompact, 3, DCache::GE, "1.5"));
+}
+
+//不存在的字段转回tars编码时不写出
+TEST_F(MKCompactRecordTest, missingField)
+{
+    record()->init(_fieldConf, true, _layoutFile);
+
+    TarsOutputStream<BufferWriter> os;
+    os.write(string("only"), 2);
+    string sTars(os.getBuffer(), os.getLength());
+
+    string sCompact = record()->fromTars(sTars);
+    EXPECT_EQ(record()->toTars(sCompact), sTars);
+    EXPECT_THROW(record()->read(sCompact, 1, "0", true), HashMap::MKDCacheException);
+    EXPECT_EQ(record()->read(sCompact, 1, "0", false), "0");
+}
+
+//增加字段后，原布局的数据仍按原布局转回tars编码
+TEST_F(MKCompactRecordTest, fieldAdded)
+{
+    record()->init(_fieldConf, true, _layoutFile);
+    string sTars = encode(42, "old", 2.5);
+    string sOld = record()->fromTars(sTars);
+
+    addField("extra", 4, "long");
+    record()->init(_fieldConf, true, _layoutFile);
+
+    EXPECT_TRUE(CompactRecord::isCompact(sOld));
+    EXPECT_FALSE(record()->isCurrent(sOld));
+    EXPECT_EQ(record()->toTars(sOld), sTars);
+    EXPECT_THROW(record()->read(sOld, 1, "0", true), HashMap::MKDCacheException);
+
+    string sNew = record()->fromTars(sTars);
+    EXPECT_TRUE(record()->isCurrent(sNew));
+    EXPECT_EQ(record()->read(sNew, 4, "0", false), "0");
+
+    //两种布局都记录在布局文件中
+    vector<string> vtLine = TC_Common::sepstr<string>(TC_File::load2str(_layoutFile), "\n");
+    EXPECT_EQ(vtLine.size(), 2u);
+
+    //改回原配置，不重复记录
+    _fieldConf.vtValueName.pop_back();
+    _fieldConf.mpFieldInfo.erase("extra");
+    record()->init(_fieldConf, true, _layoutFile);
+    EXPECT_TRUE(record()->isCurrent(sOld));
+    EXPECT_FALSE(record()->isCurrent(sNew));
+    EXPECT_EQ(record()->toTars(sNew), sTars);
+    vtLine = TC_Common::sepstr<string>(TC_File::load2str(_layoutFile), "\n");
+    EXPECT_EQ(vtLine.size(), 2u);
+}
+
+//字段数不变只修改类型时布局id不同，原数据不会按新类型的宽度读取
+TEST_F(MKCompactRecordTest, typeChanged)
+{
+    record()->init(_fieldConf, true, _layoutFile);
+    string sTars = encode(-3, "t", 0.25);
+    string sOld = record()->fromTars(sTars);
+
+    addField("score", 1, "long");
+    record()->init(_fieldConf, true, _layoutFile);
+
+    EXPECT_FALSE(record()->isCurrent(sOld));
+    EXPECT_EQ(record()->toTars(sOld), sTars);
+}
+
+//没有布局文件时无法识别的布局抛异常，不会按当前布局解码
+TEST_F(MKCompactRecordTest, unknownLayout)
+{
+    record()->init(_fieldConf, true, "");
+    string sOld = record()->fromTars(encode(1, "x", 1.0));
+
+    addField("score", 1, "long");
+    record()->init(_fieldConf, true, "");
+
+    EXPECT_THROW(record()->toTars(sOld), HashMap::MKDCacheException);
+}
@@ -0,0 +1,395 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <sys/shm.h>
+#include "MKCacheServer.h"
+#include "MKValueIndex.h"
+#include "HashFactory.h"
+
+extern MultiHashMap g_HashMap;
+
+#define TEST_SHM_KEY 23456
+
+class MKValueIndexTest : public ::testing::Test
+{
+  protected:
+    MKValueIndexTest() = default;
+    ~MKValueIndexTest() = default;
+
+    static void SetUpTestCase()
+    {
+        //联合key: id(int)，value: score(int)、name(string)
+        FieldConf fieldConf;
+        fieldConf.sMKeyName = "mk";
+        fieldConf.vtUKeyName.push_back("id");
+        fieldConf.vtValueName.push_back("score");
+        fieldConf.vtValueName.push_back("name");
+        fieldConf.mpFieldType["mk"] = 0;
+        fieldConf.mpFieldType["id"] = 1;
+        fieldConf.mpFieldType["score"] = 2;
+        fieldConf.mpFieldType["name"] = 2;
+        addField(fieldConf, "id", 0, "int");
+        addField(fieldConf, "score", 1, "int");
+        addField(fieldConf, "name", 2, "string");
+        g_app.gstat()->setFieldConfig(fieldConf);
+
+        g_HashMap.init(1);
+        g_HashMap.initMainKeySize(0);
+        g_HashMap.initHashRatio(2);
+        g_HashMap.initMainKeyHashRatio(8);
+        g_HashMap.initDataSize(64);
+        g_HashMap.initHashType(0);
+        g_HashMap.initLock(TEST_SHM_KEY, 1, -1);
+        g_HashMap.initStore(TEST_SHM_KEY, 64 * 1024 * 1024, 0);
+
+        P_Hash *pHash = HashFactory::getHash(0);
+        g_HashMap.setHashFunctorM(std::bind(&P_Hash::HashRawString, pHash, std::placeholders::_1));
+        g_HashMap.setHashFunctor(std::bind(&P_Hash::HashRawString, pHash, std::placeholders::_1));
+        g_HashMap.setAutoErase(false);
+    }
+
+    static void TearDownTestCase()
+    {
+        int shmid = shmget(TEST_SHM_KEY, 0, 0);
+        if (shmid != -1)
+        {
+            shmctl(shmid, IPC_RMID, 0);
+        }
+    }
+
+    static void addField(FieldConf &fieldConf, const string &sName, uint8_t tag, const string &sType)
+    {
+        FieldInfo info;
+        info.tag = tag;
+        info.type = sType;
+        info.bRequire = true;
+        info.defValue = (sType == "string") ? "" : "0";
+        fieldConf.mpFieldInfo[sName] = info;
+    }
+
+    void SetUp() override
+    {
+        TC_Config conf;
+        conf.parseString(
+        R"(<Main>
+            <Cache>
+                IndexField=id|score
+                IndexMinRecord=10
+                IndexMaxRecord=10000
+                IndexMaxMainKey=100
+                IndexStableQuery=2
+            </Cache>
+        </Main>)");
+        _index.init(conf);
+    }
+
+    static string encodeUK(int id)
+    {
+        TarsOutputStream<BufferWriter> os;
+        os.write(tars::Int32(id), 0);
+        return string(os.getBuffer(), os.getLength());
+    }
+
+    static string encodeValue(int score, const string &name)
+    {
+        TarsOutputStream<BufferWriter> os;
+        os.write(tars::Int32(score), 1);
+        os.write(name, 2);
+        return string(os.getBuffer(), os.getLength());
+    }
+
+    static int decodeUK(const string &sUK)
+    {
+        TarsInputStream<BufferReader> is;
+        is.setBuffer(sUK.c_str(), sUK.length());
+        tars::Int32 id = 0;
+        is.read(id, 0, true);
+        return id;
+    }
+
+    static int decodeScore(const string &sValue)
+    {
+        TarsInputStream<BufferReader> is;
+        is.setBuffer(sValue.c_str(), sValue.length());
+        tars::Int32 score = 0;
+        is.read(score, 1, true);
+        return score;
+    }
+
+    void set(const string &mk, int id, int score)
+    {
+        int iRet = g_HashMap.set(mk, encodeUK(id), encodeValue(score, "n" + TC_Common::tostr(id)), 0, 0, TC_Multi_HashMap_Malloc::DELETE_FALSE, false, TC_Multi_HashMap_Malloc::FULL_DATA);
+        ASSERT_EQ(iRet, TC_Multi_HashMap_Malloc::RT_OK);
+    }
+
+    void fill(const string &mk, int iCount)
+    {
+        for (int i = 0; i < iCount; i++)
+        {
+            set(mk, i, i % 10);
+        }
+    }
+
+    static DCache::Condition cond(const string &sField, DCache::Op op, int n)
+    {
+        DCache::Condition c;
+        c.fieldName = sField;
+        c.op = op;
+        c.value = TC_Common::tostr(n);
+        return c;
+    }
+
+    static bool match(const DCache::Condition &c, int n)
+    {
+        int v = TC_Common::strto<int>(c.value);
+        switch (c.op)
+        {
+        case DCache::EQ: return n == v;
+        case DCache::NE: return n != v;
+        case DCache::GT: return n > v;
+        case DCache::GE: return n >= v;
+        case DCache::LT: return n < v;
+        case DCache::LE: return n <= v;
+        default: return false;
+        }
+    }
+
+    //按全部条件过滤，返回联合key的id序列
+    static vector<int> filter(const vector<MultiHashMap::Value> &vtValue, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond)
+    {
+        vector<int> vtId;
+        for (size_t i = 0; i < vtValue.size(); i++)
+        {
+            bool bMatch = true;
+            for (size_t j = 0; j < vtUKCond.size() && bMatch; j++)
+            {
+                bMatch = match(vtUKCond[j], decodeUK(vtValue[i]._ukey));
+            }
+            for (size_t j = 0; j < vtValueCond.size() && bMatch; j++)
+            {
+                bMatch = match(vtValueCond[j], decodeScore(vtValue[i]._value));
+            }
+            if (bMatch)
+            {
+                vtId.push_back(decodeUK(vtValue[i]._ukey));
+            }
+        }
+        return vtId;
+    }
+
+    //不使用索引，按主key全部查询后过滤
+    vector<int> plainScan(const string &mk, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond)
+    {
+        vector<MultiHashMap::Value> vtAll;
+        EXPECT_EQ(g_HashMap.get(mk, vtAll), TC_Multi_HashMap_Malloc::RT_OK);
+        return filter(vtAll, vtUKCond, vtValueCond);
+    }
+
+    //反复查询直到建立索引，返回走索引的结果
+    vector<int> indexScan(const string &mk, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond, size_t iLimit = size_t(-1))
+    {
+        vector<MultiHashMap::Value> vtValue;
+        int iRet = 1;
+        for (int i = 0; i < 3 && iRet != 0; i++)
+        {
+            vtValue.clear();
+            iRet = _index.select(mk, vtUKCond, vtValueCond, false, 0, iLimit, vtValue);
+        }
+        EXPECT_EQ(iRet, 0);
+        return filter(vtValue, vtUKCond, vtValueCond);
+    }
+
+    //与MKCacheImp::selectMKCache相同: 能用索引时过滤候选记录，否则按主key全部查询，再取Limit范围内的记录
+    vector<int> page(const string &mk, const vector<DCache::Condition> &vtUKCond, const vector<DCache::Condition> &vtValueCond, size_t iIndex, size_t iCount)
+    {
+        vector<MultiHashMap::Value> vtValue;
+        vector<int> vtId;
+        if (_index.select(mk, vtUKCond, vtValueCond, false, 0, iIndex + iCount, vtValue) == 0)
+        {
+            vtId = filter(vtValue, vtUKCond, vtValueCond);
+        }
+        else
+        {
+            vtId = plainScan(mk, vtUKCond, vtValueCond);
+        }
+
+        if (iIndex >= vtId.size())
+        {
+            return vector<int>();
+        }
+        return vector<int>(vtId.begin() + iIndex, vtId.begin() + min(iIndex + iCount, vtId.size()));
+    }
+
+    MKValueIndex _index;
+};
+
+TEST_F(MKValueIndexTest, equal)
+{
+    string mk = "equal";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond;
+    vector<DCache::Condition> vtValueCond(1, cond("score", DCache::EQ, 3));
+    vector<int> vtExpect = plainScan(mk, vtUKCond, vtValueCond);
+    EXPECT_EQ(vtExpect.size(), 20u);
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond), vtExpect);
+}
+
+TEST_F(MKValueIndexTest, range)
+{
+    string mk = "range";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond;
+    vtUKCond.push_back(cond("id", DCache::GE, 50));
+    vtUKCond.push_back(cond("id", DCache::LT, 120));
+    vector<DCache::Condition> vtValueCond(1, cond("score", DCache::NE, 5));
+    vector<int> vtExpect = plainScan(mk, vtUKCond, vtValueCond);
+    EXPECT_EQ(vtExpect.size(), 63u);
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond), vtExpect);
+}
+
+//条件全部由索引覆盖时读满Limit即停止，顺序与全部查询一致
+TEST_F(MKValueIndexTest, limit)
+{
+    string mk = "limit";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond;
+    vtUKCond.push_back(cond("id", DCache::GT, 100));
+    vtUKCond.push_back(cond("id", DCache::LE, 180));
+    vector<DCache::Condition> vtValueCond;
+    vector<int> vtExpect = plainScan(mk, vtUKCond, vtValueCond);
+    EXPECT_EQ(vtExpect.size(), 80u);
+    vtExpect.resize(10);
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond, 10), vtExpect);
+
+    //已删除的记录不计入Limit
+    ASSERT_EQ(g_HashMap.delSetBit(mk, encodeUK(vtExpect.front()), time(NULL)), TC_Multi_HashMap_Malloc::RT_OK);
+    vtExpect = plainScan(mk, vtUKCond, vtValueCond);
+    EXPECT_EQ(vtExpect.size(), 79u);
+    vtExpect.resize(10);
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond, 10), vtExpect);
+}
+
+//分页查询跨越索引建立、命中、写入失效和重建，各页拼起来与全部查询的结果一致
+TEST_F(MKValueIndexTest, paging)
+{
+    string mk = "paging";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond;
+    vtUKCond.push_back(cond("id", DCache::GE, 20));
+    vtUKCond.push_back(cond("id", DCache::LT, 160));
+    vector<DCache::Condition> vtValueCond;
+    vector<int> vtExpect = plainScan(mk, vtUKCond, vtValueCond);
+    ASSERT_EQ(vtExpect.size(), 140u);
+
+    //IndexStableQuery=2: 第1页记录代数，第2页建立索引，第3页命中，第4页前写入使索引失效，第5页后重建
+    vector<int> vtPaged;
+    const size_t iPageSize = 10;
+    for (size_t iPage = 0; iPage * iPageSize < vtExpect.size(); iPage++)
+    {
+        if (iPage == 3 || iPage == 8)
+        {
+            //范围之外的写入只改变代数，不改变结果
+            set(mk, 1000 + (int)iPage, 1);
+        }
+        vector<int> vtPage = page(mk, vtUKCond, vtValueCond, iPage * iPageSize, iPageSize);
+        vtPaged.insert(vtPaged.end(), vtPage.begin(), vtPage.end());
+    }
+    EXPECT_EQ(vtPaged, vtExpect);
+    EXPECT_EQ(_index.desc().find("build: 0"), string::npos);
+}
+
+//还有其他条件需要过滤时Limit不生效，候选记录保持数据链顺序
+TEST_F(MKValueIndexTest, limitNotExact)
+{
+    string mk = "limitNotExact";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond(1, cond("id", DCache::LT, 100));
+    vector<DCache::Condition> vtValueCond(1, cond("score", DCache::EQ, 4));
+    vector<int> vtExpect = plainScan(mk, vtUKCond, vtValueCond);
+    EXPECT_EQ(vtExpect.size(), 10u);
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond, 3), vtExpect);
+}
+
+//写入后不会返回旧索引的结果，代数稳定后重新建立的索引与全部查询一致
+TEST_F(MKValueIndexTest, afterWrite)
+{
+    string mk = "afterWrite";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond;
+    vector<DCache::Condition> vtValueCond(1, cond("score", DCache::EQ, 7));
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond), plainScan(mk, vtUKCond, vtValueCond));
+
+    set(mk, 3, 7);
+    set(mk, 500, 7);
+    ASSERT_EQ(g_HashMap.delSetBit(mk, encodeUK(17), time(NULL)), TC_Multi_HashMap_Malloc::RT_OK);
+
+    vector<MultiHashMap::Value> vtValue;
+    EXPECT_EQ(_index.select(mk, vtUKCond, vtValueCond, false, 0, size_t(-1), vtValue), 1);
+
+    vector<int> vtExpect = plainScan(mk, vtUKCond, vtValueCond);
+    EXPECT_EQ(vtExpect.size(), 21u);
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond), vtExpect);
+}
+
+//每次查询前都有写入的主key一直按主key全部查询，不重建索引
+TEST_F(MKValueIndexTest, unstable)
+{
+    string mk = "unstable";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond;
+    vector<DCache::Condition> vtValueCond(1, cond("score", DCache::EQ, 1));
+    for (int i = 0; i < 10; i++)
+    {
+        set(mk, 1000 + i, 1);
+        vector<MultiHashMap::Value> vtValue;
+        EXPECT_EQ(_index.select(mk, vtUKCond, vtValueCond, false, 0, size_t(-1), vtValue), 1);
+    }
+    EXPECT_NE(_index.desc().find("build: 0"), string::npos);
+}
+
+//reload替换整份配置，按旧配置建立的索引不再使用
+TEST_F(MKValueIndexTest, reload)
+{
+    string mk = "reload";
+    fill(mk, 200);
+
+    vector<DCache::Condition> vtUKCond;
+    vector<DCache::Condition> vtValueCond(1, cond("score", DCache::EQ, 2));
+    EXPECT_EQ(indexScan(mk, vtUKCond, vtValueCond), plainScan(mk, vtUKCond, vtValueCond));
+
+    TC_Config conf;
+    conf.parseString(
+    R"(<Main>
+        <Cache>
+            IndexField=id
+            IndexMinRecord=10
+            IndexStableQuery=1
+        </Cache>
+    </Main>)");
+    _index.reload(conf);
+    EXPECT_NE(_index.desc().find("field: id\n"), string::npos);
+
+    vector<MultiHashMap::Value> vtValue;
+    EXPECT_EQ(_index.select(mk, vtUKCond, vtValueCond, false, 0, size_t(-1), vtValue), 1);
+
+    vector<DCache::Condition> vtIdCond(1, cond("id", DCache::LT, 30));
+    EXPECT_EQ(indexScan(mk, vtIdCond, vtValueCond), plainScan(mk, vtIdCond, vtValueCond));
+}
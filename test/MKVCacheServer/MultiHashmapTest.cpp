@@ -0,0 +1,292 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "util/tc_common.h"
+#include "jmem_multi_hashmap_malloc/tc_multi_hashmap_malloc.h"
+
+using namespace tars;
+using namespace DCache;
+
+class MultiHashmapTest : public ::testing::Test
+{
+  protected:
+    MultiHashmapTest() = default;
+    ~MultiHashmapTest() = default;
+
+    void SetUp() override
+    {
+        _mk = "mk001";
+        _mem.resize(64 * 1024 * 1024);
+        _map.initMainKeySize(0);
+        _map.initHashRatio(2);
+        _map.initMainKeyHashRatio(8);
+        _map.initDataSize(64);
+        _map.create(&_mem[0], _mem.size(), TC_Multi_HashMap_Malloc::MainKey::HASH_TYPE);
+        _map.setAutoErase(false);
+    }
+
+    void TearDown() override
+    {
+    }
+
+    int set(const string &uk, const string &value, uint32_t iExpireTime, bool bDirty)
+    {
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        return _map.set(_mk, uk, _map.getHashFunctor()(_mk + uk), value, iExpireTime, 0, bDirty,
+                        TC_Multi_HashMap_Malloc::AUTO_DATA, true, false, TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+    }
+
+    //恢复后记录的全部状态与修改前一致
+    void expectRestored(const string &uk, int iState, const TC_Multi_HashMap_Malloc::Value &old)
+    {
+        TC_Multi_HashMap_Malloc::Value now;
+        ASSERT_EQ(_map.getForRestore(_mk, uk, now), iState);
+        EXPECT_EQ(now._value, old._value);
+        EXPECT_EQ(now._isDelete, old._isDelete);
+        EXPECT_EQ(now._dirty, old._dirty);
+        EXPECT_EQ(now._iVersion, old._iVersion);
+        EXPECT_EQ(now._iSyncTime, old._iSyncTime);
+        EXPECT_EQ(now._iExpireTime, old._iExpireTime);
+    }
+
+    string _mk;
+    vector<char> _mem;
+    TC_Multi_HashMap_Malloc _map;
+};
+
+//已标记删除的记录被重新写入后，恢复为删除状态，版本号不变
+TEST_F(MultiHashmapTest, restoreDeleted)
+{
+    ASSERT_EQ(set("uk1", "v1", 0, true), TC_Multi_HashMap_Malloc::RT_OK);
+    ASSERT_EQ(_map.delSetBit(_mk, "uk1", time(NULL)), TC_Multi_HashMap_Malloc::RT_OK);
+    size_t iDirtyCount = _map.dirtyCount();
+
+    TC_Multi_HashMap_Malloc::Value old;
+    int iState = _map.getForRestore(_mk, "uk1", old);
+    ASSERT_EQ(iState, TC_Multi_HashMap_Malloc::RT_OK);
+    EXPECT_EQ(old._isDelete, TC_Multi_HashMap_Malloc::DELETE_TRUE);
+
+    ASSERT_EQ(set("uk1", "v1-new-and-longer-than-before", 100, false), TC_Multi_HashMap_Malloc::RT_OK);
+
+    vector<TC_Multi_HashMap_Malloc::Value> vtData;
+    ASSERT_EQ(_map.restore(_mk, "uk1", iState, old, false, vtData), TC_Multi_HashMap_Malloc::RT_OK);
+    expectRestored("uk1", TC_Multi_HashMap_Malloc::RT_OK, old);
+    EXPECT_EQ(_map.dirtyCount(), iDirtyCount);
+    EXPECT_EQ(_map.count(_mk), 0u);
+}
+
+//已过期的记录被更新后，恢复原值、过期时间和版本号
+TEST_F(MultiHashmapTest, restoreExpired)
+{
+    ASSERT_EQ(set("uk1", "v1", 1, false), TC_Multi_HashMap_Malloc::RT_OK);
+    ASSERT_EQ(set("uk1", "v1", 1, false), TC_Multi_HashMap_Malloc::RT_OK);
+
+    TC_Multi_HashMap_Malloc::Value old;
+    int iState = _map.getForRestore(_mk, "uk1", old);
+    ASSERT_EQ(iState, TC_Multi_HashMap_Malloc::RT_OK);
+
+    ASSERT_EQ(set("uk1", "v2", 0, true), TC_Multi_HashMap_Malloc::RT_OK);
+
+    vector<TC_Multi_HashMap_Malloc::Value> vtData;
+    ASSERT_EQ(_map.restore(_mk, "uk1", iState, old, false, vtData), TC_Multi_HashMap_Malloc::RT_OK);
+    expectRestored("uk1", TC_Multi_HashMap_Malloc::RT_OK, old);
+
+    TC_Multi_HashMap_Malloc::Value v;
+    EXPECT_EQ(_map.get(_mk, "uk1", _map.getHashFunctor()(_mk + "uk1"), v, true, time(NULL)), TC_Multi_HashMap_Malloc::RT_DATA_EXPIRED);
+}
+
+//只有key的记录被写入数据后，恢复为只有key
+TEST_F(MultiHashmapTest, restoreOnlyKey)
+{
+    vector<TC_Multi_HashMap_Malloc::Value> vtData;
+    ASSERT_EQ(_map.set(_mk, "uk1", TC_Multi_HashMap_Malloc::AUTO_DATA, true, false, TC_Multi_HashMap_Malloc::DELETE_AUTO, vtData), TC_Multi_HashMap_Malloc::RT_OK);
+
+    TC_Multi_HashMap_Malloc::Value old;
+    int iState = _map.getForRestore(_mk, "uk1", old);
+    ASSERT_EQ(iState, TC_Multi_HashMap_Malloc::RT_ONLY_KEY);
+
+    ASSERT_EQ(set("uk1", "v1", 0, true), TC_Multi_HashMap_Malloc::RT_OK);
+
+    ASSERT_EQ(_map.restore(_mk, "uk1", iState, old, false, vtData), TC_Multi_HashMap_Malloc::RT_OK);
+    expectRestored("uk1", TC_Multi_HashMap_Malloc::RT_ONLY_KEY, old);
+}
+
+//原来不存在的记录被删除，主key原来不存在时一并删除主key
+TEST_F(MultiHashmapTest, restoreNoData)
+{
+    TC_Multi_HashMap_Malloc::Value old;
+    int iState = _map.getForRestore(_mk, "uk1", old);
+    ASSERT_EQ(iState, TC_Multi_HashMap_Malloc::RT_NO_DATA);
+    ASSERT_EQ(_map.checkMainKey(_mk), TC_Multi_HashMap_Malloc::RT_NO_DATA);
+
+    ASSERT_EQ(set("uk1", "v1", 0, true), TC_Multi_HashMap_Malloc::RT_OK);
+    ASSERT_EQ(_map.delSetBit(_mk, "uk1", time(NULL)), TC_Multi_HashMap_Malloc::RT_OK);
+
+    vector<TC_Multi_HashMap_Malloc::Value> vtData;
+    ASSERT_EQ(_map.restore(_mk, "uk1", iState, old, true, vtData), TC_Multi_HashMap_Malloc::RT_OK);
+    EXPECT_EQ(_map.getForRestore(_mk, "uk1", old), TC_Multi_HashMap_Malloc::RT_NO_DATA);
+    EXPECT_EQ(_map.checkMainKey(_mk), TC_Multi_HashMap_Malloc::RT_NO_DATA);
+    EXPECT_EQ(_map.dirtyCount(), 0u);
+}
+
+class ZSetSpanTest : public ::testing::Test
+{
+  protected:
+    ZSetSpanTest() = default;
+    ~ZSetSpanTest() = default;
+
+    void SetUp() override
+    {
+        _mk = "zset001";
+        _now = time(NULL);
+        _mem.resize(64 * 1024 * 1024);
+        _map.initMainKeySize(0);
+        _map.initHashRatio(2);
+        _map.initMainKeyHashRatio(8);
+        _map.initDataSize(32);
+        _map.create(&_mem[0], _mem.size(), TC_Multi_HashMap_Malloc::MainKey::ZSET_TYPE);
+        _map.setAutoErase(false);
+    }
+
+    void TearDown() override
+    {
+    }
+
+    static string member(int i)
+    {
+        return "m" + TC_Common::tostr(i);
+    }
+
+    int add(int i, uint32_t iExpireTime)
+    {
+        vector<TC_Multi_HashMap_Malloc::Value> vtData;
+        string v = member(i);
+        return _map.addZSet(_mk, v, _map.getHashFunctor()(_mk + v), double(i), iExpireTime, 0, false, false, TC_Multi_HashMap_Malloc::DELETE_FALSE, vtData);
+    }
+
+    int del(int i)
+    {
+        string v = member(i);
+        return _map.delZSetSetBit(_mk, v, _map.getHashFunctor()(_mk + v), _now);
+    }
+
+    static vector<string> members(const list<TC_Multi_HashMap_Malloc::Value> &vtData)
+    {
+        vector<string> vtMember;
+        for (list<TC_Multi_HashMap_Malloc::Value>::const_iterator it = vtData.begin(); it != vtData.end(); ++it)
+        {
+            vtMember.push_back(it->_value);
+        }
+        return vtMember;
+    }
+
+    string _mk;
+    uint32_t _now;
+    vector<char> _mem;
+    TC_Multi_HashMap_Malloc _map;
+};
+
+//删除的成员不占排名；getRankZSet和不检查过期的getZSet中已过期未淘汰的成员占排名，检查过期的getZSet/getZSetLimit中不占排名
+TEST_F(ZSetSpanTest, rankRange)
+{
+    const int N = 2000;
+    //vtRanked: 按跨度计算排名的成员，bExpired: 是否已过期
+    vector<pair<int, bool> > vtRanked;
+    for (int i = 0; i < N; i++)
+    {
+        uint32_t iExpireTime = (i % 7 == 3) ? _now - 10 : 0;
+        ASSERT_EQ(add(i, iExpireTime), TC_Multi_HashMap_Malloc::RT_OK);
+    }
+    for (int i = 0; i < N; i++)
+    {
+        if (i % 5 == 0)
+        {
+            ASSERT_EQ(del(i), TC_Multi_HashMap_Malloc::RT_OK);
+        }
+        else
+        {
+            vtRanked.push_back(make_pair(i, i % 7 == 3));
+        }
+    }
+
+    //排名与getRankZSet一致，正序和倒序
+    for (size_t r = 0; r < vtRanked.size(); r += 37)
+    {
+        if (vtRanked[r].second)
+            continue;
+        string v = member(vtRanked[r].first);
+        long iPos = -1;
+        ASSERT_EQ(_map.getRankZSet(_mk, v, _map.getHashFunctor()(_mk + v), true, _now, iPos), TC_Multi_HashMap_Malloc::RT_OK);
+        EXPECT_EQ(iPos, (long)r);
+        ASSERT_EQ(_map.getRankZSet(_mk, v, _map.getHashFunctor()(_mk + v), false, _now, iPos), TC_Multi_HashMap_Malloc::RT_OK);
+        EXPECT_EQ(iPos, (long)(vtRanked.size() - r - 1));
+    }
+
+    //检查过期时的排名
+    vector<int> vtLive;
+    for (size_t r = 0; r < vtRanked.size(); r++)
+    {
+        if (!vtRanked[r].second)
+        {
+            vtLive.push_back(vtRanked[r].first);
+        }
+    }
+
+    const uint64_t starts[] = { 0, 1, 17, 500, vtLive.size() - 5, vtRanked.size() - 5, vtRanked.size() + 10 };
+    for (size_t k = 0; k < sizeof(starts) / sizeof(starts[0]); k++)
+    {
+        uint64_t iStart = starts[k];
+        uint64_t iEnd = iStart + 20;
+
+        vector<string> vtAll, vtLiveRange;
+        for (uint64_t r = iStart; r <= iEnd && r < vtRanked.size(); r++)
+        {
+            vtAll.push_back(member(vtRanked[r].first));
+        }
+        for (uint64_t r = iStart; r <= iEnd && r < vtLive.size(); r++)
+        {
+            vtLiveRange.push_back(member(vtLive[r]));
+        }
+
+        list<TC_Multi_HashMap_Malloc::Value> vtData;
+        _map.getZSet(_mk, iStart, iEnd, true, 0, vtData);
+        EXPECT_EQ(members(vtData), vtAll) << "start:" << iStart;
+
+        vtData.clear();
+        _map.getZSet(_mk, iStart, iEnd, true, _now, vtData);
+        EXPECT_EQ(members(vtData), vtLiveRange) << "start:" << iStart;
+
+        vector<string> vtLimit;
+        for (uint64_t r = iStart; r < vtLive.size() && vtLimit.size() < 10; r++)
+        {
+            vtLimit.push_back(member(vtLive[r]));
+        }
+        vtData.clear();
+        _map.getZSetLimit(_mk, iStart, 10, true, _now, vtData);
+        EXPECT_EQ(members(vtData), vtLimit) << "start:" << iStart;
+    }
+
+    //按分值范围读取
+    vector<string> vtScore;
+    for (int i = 300; i <= 350; i++)
+    {
+        if (i % 5 != 0 && i % 7 != 3)
+        {
+            vtScore.push_back(member(i));
+        }
+    }
+    list<TC_Multi_HashMap_Malloc::Value> vtData;
+    _map.getZSetByScore(_mk, 300, 350, _now, vtData);
+    EXPECT_EQ(members(vtData), vtScore);
+}
@@ -0,0 +1,340 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include "util/tc_common.h"
+#include "util/tc_file.h"
+#include "TimeSeriesStore.h"
+
+namespace
+{
+const string DATE = "20201001";
+const string NEXT_DATE = "20201002";
+
+void expectRoundTrip(const vector<TsPoint> &points)
+{
+    SeriesChunk chunk;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        ASSERT_TRUE(chunk.append(points[i].time, points[i].value)) << "at " << i;
+    }
+
+    vector<TsPoint> decoded;
+    ASSERT_TRUE(chunk.decode(decoded));
+    ASSERT_EQ(decoded.size(), points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        EXPECT_EQ(decoded[i].time, points[i].time) << "at " << i;
+        // 按bit比较，区分0与-0、保留NaN
+        EXPECT_EQ(0, memcmp(&decoded[i].value, &points[i].value, sizeof(double))) << "at " << i;
+    }
+
+    // 从文件中读出的字节同样能解码
+    decoded.clear();
+    ASSERT_TRUE(SeriesChunk::decode(chunk.writer().bytes(), chunk.writer().bitCount(), chunk.count(), decoded));
+    EXPECT_EQ(decoded.size(), points.size());
+}
+}  // namespace
+
+TEST(BitWriter, edgeWidths)
+{
+    const int widths[] = {1, 7, 8, 9, 31, 32, 33, 63, 64, 1, 64};
+    const uint64_t values[] = {1,
+                               0x55,
+                               0xff,
+                               0x1ff,
+                               0x7fffffff,
+                               0x80000001,
+                               0x1ffffffffULL,
+                               0x7fffffffffffffffULL,
+                               0xffffffffffffffffULL,
+                               0,
+                               0x8000000000000001ULL};
+    const size_t n = sizeof(widths) / sizeof(widths[0]);
+
+    BitWriter writer;
+    uint64_t bits = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        writer.writeBits(values[i], widths[i]);
+        bits += widths[i];
+    }
+    EXPECT_EQ(writer.bitCount(), bits);
+    EXPECT_EQ(writer.bytes().size(), (bits + 7) / 8);
+
+    BitReader reader(writer.bytes(), writer.bitCount());
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t value = 0;
+        ASSERT_TRUE(reader.readBits(widths[i], value)) << "at " << i;
+        EXPECT_EQ(value, values[i]) << "width " << widths[i];
+    }
+
+    // 数据读完后不能再读，最后一个字节补齐的bit也不能读
+    uint64_t value = 0;
+    bool bit = false;
+    EXPECT_FALSE(reader.readBit(bit));
+    EXPECT_FALSE(reader.readBits(1, value));
+}
+
+TEST(BitWriter, highBitsIgnored)
+{
+    // 只写入低位，高位的1不影响后续数据
+    BitWriter writer;
+    writer.writeBits(0xf2, 2);
+    writer.writeBit(false);
+    writer.writeBits(0xffffffffffffffffULL, 4);
+
+    ASSERT_EQ(writer.bytes().size(), 1u);
+    EXPECT_EQ(writer.bytes()[0], 0x9e);
+
+    BitReader reader(writer.bytes(), 7);
+    uint64_t value = 0;
+    EXPECT_TRUE(reader.readBits(7, value));
+    EXPECT_EQ(value, 0x4fu);
+    EXPECT_FALSE(reader.readBits(1, value));
+}
+
+TEST(SeriesChunk, fixedInterval)
+{
+    vector<TsPoint> points;
+    for (uint32_t t = 5; t <= 1440; t += 5)
+    {
+        points.push_back(TsPoint(t, 100));
+    }
+    expectRoundTrip(points);
+
+    // 固定间隔、数值不变时每个点2个bit
+    SeriesChunk chunk;
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        chunk.append(points[i].time, points[i].value);
+    }
+    EXPECT_EQ(chunk.writer().bitCount(), 96 + 9 + 1 + 2 * (points.size() - 2));
+}
+
+TEST(SeriesChunk, deltaOfDeltaRanges)
+{
+    // 依次覆盖delta-of-delta的每个编码区间及其边界
+    const int64_t dods[] = {5, 0, 1, -1, 64, -63, 65, -64, 256, -255, 257, -256, 1000, -900};
+    vector<TsPoint> points;
+    uint32_t time = 2000;
+    int64_t delta = 0;
+    points.push_back(TsPoint(time, 0));
+    for (size_t i = 0; i < sizeof(dods) / sizeof(dods[0]); ++i)
+    {
+        delta += dods[i];
+        ASSERT_GT(delta, 0);
+        time += uint32_t(delta);
+        points.push_back(TsPoint(time, double(i)));
+    }
+    expectRoundTrip(points);
+
+    // 超过12bit区间的间隔
+    vector<TsPoint> wide;
+    wide.push_back(TsPoint(1, 1));
+    wide.push_back(TsPoint(2, 1));
+    wide.push_back(TsPoint(100000, 1));
+    wide.push_back(TsPoint(100001, 1));
+    expectRoundTrip(wide);
+}
+
+TEST(SeriesChunk, xorValues)
+{
+    const double values[] = {0.0,
+                             -0.0,
+                             1.0,
+                             1.0,
+                             1.5,
+                             -1.5,
+                             3.141592653589793,
+                             1e-300,
+                             1e300,
+                             std::numeric_limits<double>::max(),
+                             std::numeric_limits<double>::denorm_min(),
+                             std::numeric_limits<double>::infinity(),
+                             -std::numeric_limits<double>::infinity(),
+                             std::numeric_limits<double>::quiet_NaN(),
+                             123456789.0,
+                             123456790.0,
+                             123456791.5};
+    vector<TsPoint> points;
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        points.push_back(TsPoint(uint32_t(i + 1) * 5, values[i]));
+    }
+    expectRoundTrip(points);
+}
+
+TEST(SeriesChunk, rejectsOutOfOrder)
+{
+    SeriesChunk chunk;
+    EXPECT_TRUE(chunk.append(10, 1));
+    EXPECT_FALSE(chunk.append(10, 2));
+    EXPECT_FALSE(chunk.append(5, 2));
+    EXPECT_TRUE(chunk.append(15, 2));
+    EXPECT_EQ(chunk.count(), 2u);
+    EXPECT_EQ(chunk.lastTime(), 15u);
+}
+
+TEST(SeriesChunk, truncatedData)
+{
+    SeriesChunk chunk;
+    for (uint32_t t = 1; t <= 20; ++t)
+    {
+        chunk.append(t * 5, t * 1.25);
+    }
+
+    vector<TsPoint> points;
+    EXPECT_FALSE(SeriesChunk::decode(chunk.writer().bytes(), chunk.writer().bitCount() - 1, chunk.count(), points));
+    points.clear();
+    EXPECT_FALSE(SeriesChunk::decode(chunk.writer().bytes(), 64, chunk.count(), points));
+}
+
+class TimeSeriesStoreTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        _path = "./TimeSeriesStoreTest_" + TC_Common::tostr(getpid());
+        TC_File::removeFile(_path, true);
+        _rollups.push_back(10);
+        _rollups.push_back(60);
+    }
+
+    void TearDown() override { TC_File::removeFile(_path, true); }
+
+    void initStore(TimeSeriesStore &store)
+    {
+        store.init(_path, 20000, _rollups);
+        ASSERT_EQ(store.load(), 0);
+    }
+
+    static map<string, double> batch(double value)
+    {
+        map<string, double> values;
+        values["m\ts1\tqps"] = value;
+        values["m\ts2\tqps"] = value * 2;
+        return values;
+    }
+
+    string _path;
+    vector<uint32_t> _rollups;
+};
+
+// 数据只追加到日志，重启后重放日志恢复
+TEST_F(TimeSeriesStoreTest, replayLog)
+{
+    {
+        TimeSeriesStore store;
+        initStore(store);
+        for (uint32_t t = 5; t <= 60; t += 5)
+        {
+            EXPECT_EQ(store.append(DATE, t, batch(t)), 2u);
+        }
+    }
+    EXPECT_TRUE(TC_File::isFileExist(_path + "/" + DATE + ".log"));
+    EXPECT_FALSE(TC_File::isFileExist(_path + "/" + DATE + ".tsdb"));
+
+    TimeSeriesStore store;
+    initStore(store);
+    vector<TsPoint> points;
+    ASSERT_TRUE(store.query(DATE, "m\ts2\tqps", 0, 1440, 0, points));
+    ASSERT_EQ(points.size(), 12u);
+    EXPECT_EQ(points[11].time, 60u);
+    EXPECT_EQ(points[11].value, 120);
+
+    double value = 0;
+    ASSERT_TRUE(store.sum(DATE, "m\ts1\tqps", 0, 1440, value));
+    EXPECT_EQ(value, 390);
+}
+
+// 整理后清空日志，数据文件加上之后的日志能完整恢复
+TEST_F(TimeSeriesStoreTest, compactThenAppend)
+{
+    {
+        TimeSeriesStore store;
+        initStore(store);
+        store.append(DATE, 5, batch(1));
+        store.append(DATE, 10, batch(2));
+        ASSERT_EQ(store.save(DATE), 0);
+        EXPECT_FALSE(TC_File::isFileExist(_path + "/" + DATE + ".log"));
+        store.append(DATE, 15, batch(3));
+    }
+
+    TimeSeriesStore store;
+    initStore(store);
+    vector<TsPoint> points;
+    ASSERT_TRUE(store.query(DATE, "m\ts1\tqps", 0, 1440, 0, points));
+    ASSERT_EQ(points.size(), 3u);
+    EXPECT_EQ(points[2].value, 3);
+}
+
+// 日志末尾的记录不完整时忽略该记录，之前的数据不受影响
+TEST_F(TimeSeriesStoreTest, truncatedLog)
+{
+    {
+        TimeSeriesStore store;
+        initStore(store);
+        store.append(DATE, 5, batch(1));
+        store.append(DATE, 10, batch(2));
+    }
+    string sLog = _path + "/" + DATE + ".log";
+    string sBuf = TC_File::load2str(sLog);
+    TC_File::save2file(sLog, sBuf.substr(0, sBuf.size() - 3));
+
+    TimeSeriesStore store;
+    initStore(store);
+    vector<TsPoint> points;
+    ASSERT_TRUE(store.query(DATE, "m\ts1\tqps", 0, 1440, 0, points));
+    ASSERT_EQ(points.size(), 1u);
+    EXPECT_EQ(points[0].time, 5u);
+}
+
+TEST_F(TimeSeriesStoreTest, completeMarker)
+{
+    {
+        TimeSeriesStore store;
+        initStore(store);
+        store.append(DATE, 5, batch(1));
+
+        // 有数据不代表完整
+        EXPECT_TRUE(store.hasDate(DATE));
+        EXPECT_FALSE(store.isComplete(DATE));
+
+        store.markLive(NEXT_DATE);
+        EXPECT_TRUE(store.isComplete(NEXT_DATE));
+        store.markComplete(DATE);
+        EXPECT_TRUE(store.isComplete(DATE));
+    }
+
+    // 完整标记落盘，当天的标记只在内存中
+    TimeSeriesStore store;
+    initStore(store);
+    EXPECT_TRUE(store.isComplete(DATE));
+    EXPECT_FALSE(store.isComplete(NEXT_DATE));
+
+    store.prune(NEXT_DATE);
+    EXPECT_FALSE(store.isComplete(DATE));
+    EXPECT_FALSE(TC_File::isFileExist(_path + "/" + DATE + ".done"));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
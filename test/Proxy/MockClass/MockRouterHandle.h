@@ -37,6 +37,8 @@ public:
 
     MOCK_METHOD3(getRouterVersion, int(const string &moduleName, int &version, bool needRetry));
 
+    MOCK_METHOD3(getRouterDelta, int(const string &moduleName, int fromVersion, RouterDelta &delta));
+
     MOCK_METHOD3(getRouterVersionBatch, int(const vector<string> &moduleList, map<string, int> &mapModuleVersion, bool needRetry));
 
     MOCK_METHOD3(reportSwitchGroup, int(const string &moduleName, const string &groupName, const string &serverName));
@@ -22,6 +22,7 @@ using namespace std;
 
 using ::testing::_;
 using ::testing::Invoke;
+using ::testing::Return;
 using ::testing::AtLeast;
 using ::testing::InSequence;
 
@@ -77,12 +78,60 @@ TEST(RouterTableInfoTest,  update)
         .Times(1)
         .WillOnce(Invoke(getRouterVersion1));
 
+    // Router没有保留当前版本时退回全量拉取
+    EXPECT_CALL(*pMock, getRouterDelta(_, _, _))
+        .Times(1)
+        .WillOnce(Return(ROUTER_NEED_FULL));
+
     RouterTableInfo routerTableInfo(MODULE1, "Path2StoreRouterData", shared_ptr<RouterHandle>(pMock));
     EXPECT_EQ(0, routerTableInfo.initRouterTable());
     EXPECT_EQ(DCache::ET_SUCC, routerTableInfo.update());
 
 }
 
+TEST(RouterTableInfoTest,  updateByDelta)
+{
+    auto getRouterInfo1 = [] (const string &moduleName, PackTable &packTable, bool needRetry = false) -> int
+    {
+        packTable.info.moduleName = moduleName;
+        packTable.info.version = 0;
+        return 0;
+    };
+
+    auto getRouterVersion1 = [] (const string &moduleName, int &version, bool needRetry = false) -> int
+    {
+        version = 1;
+        return 0;
+    };
+
+    auto getRouterDelta1 = [] (const string &moduleName, int fromVersion, RouterDelta &delta) -> int
+    {
+        delta.fromVersion = fromVersion;
+        delta.toVersion = 1;
+        delta.info.moduleName = moduleName;
+        delta.info.version = 1;
+        return ROUTER_SUCC;
+    };
+
+    MockRouterHandle *pMock = new MockRouterHandle;
+    // 增量更新成功时不再拉取全量路由
+    EXPECT_CALL(*pMock, getRouterInfo(_, _, _))
+        .Times(1)
+        .WillOnce(Invoke(getRouterInfo1));
+
+    EXPECT_CALL(*pMock, getRouterVersion(_, _, _))
+        .Times(1)
+        .WillOnce(Invoke(getRouterVersion1));
+
+    EXPECT_CALL(*pMock, getRouterDelta(_, 0, _))
+        .Times(1)
+        .WillOnce(Invoke(getRouterDelta1));
+
+    RouterTableInfo routerTableInfo(MODULE1, "Path2StoreRouterData", shared_ptr<RouterHandle>(pMock));
+    EXPECT_EQ(0, routerTableInfo.initRouterTable());
+    EXPECT_EQ(DCache::ET_SUCC, routerTableInfo.update());
+}
+
 
 int main(int argc, char **argv)
 {
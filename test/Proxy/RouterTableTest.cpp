@@ -16,6 +16,7 @@
 #include <stdlib.h>
 
 #include "UnpackTable.h"
+#include "FastHash.h"
 #include "Router.h"
 #include "RouterShare.h"
 
@@ -373,6 +374,80 @@ TEST(RouterTableTest, getIdcServer)
     // EXPECT_EQ(2, serverInfo.id);
 }
 
+// 按hash路由要与按key路由一致
+TEST(RouterTableTest, routeByHash)
+{
+    RouterTable rt;
+    rt.init(getPackTable1(), "");
+
+    const string KEY4TEST = "Key_For_Test";
+    uint32_t hash = rt.hashKey(KEY4TEST);
+    EXPECT_NE(0u, hash);
+    EXPECT_EQ(rt.getPageNo(KEY4TEST), rt.getPageNoByHash(hash));
+
+    ServerInfo byKey, byHash;
+    EXPECT_EQ(RouterTable::RET_SUCC, rt.getIdcServer(KEY4TEST, "SH", false, byKey));
+    EXPECT_EQ(RouterTable::RET_SUCC, rt.getIdcServerByHash(hash, "SH", false, byHash));
+    EXPECT_EQ(byKey.id, byHash.id);
+
+    EXPECT_EQ(RouterTable::RET_SUCC, rt.getMaster(KEY4TEST, byKey));
+    EXPECT_EQ(RouterTable::RET_SUCC, rt.getMasterByHash(hash, byHash));
+    EXPECT_EQ(byKey.id, byHash.id);
+}
+
+// 按模块的hash类型计算key的hash
+TEST(RouterTableTest, hashType)
+{
+    PackTable packTable = getPackTable1();
+    RouterTable rt;
+    ASSERT_EQ(RouterTable::RET_SUCC, rt.init(packTable, ""));
+    EXPECT_EQ(HASH_TYPE_NORMAL, rt.getHashType());
+
+    const string KEY4TEST = "Key_For_Test";
+    NormalHash normalHash;
+    EXPECT_EQ(normalHash.HashRawString(KEY4TEST), rt.hashKey(KEY4TEST));
+
+    // proxy可以跟随路由切换hash类型
+    packTable.info.hashType = HASH_TYPE_FAST;
+    EXPECT_EQ(RouterTable::RET_SUCC, rt.reload(packTable));
+    EXPECT_EQ(HASH_TYPE_FAST, rt.getHashType());
+    FastHash fastHash;
+    EXPECT_EQ(fastHash.HashRawString(KEY4TEST), rt.hashKey(KEY4TEST));
+    EXPECT_EQ(rt.hashKey(KEY4TEST) / rt.getPageSize(), rt.getPageNo(KEY4TEST));
+
+    packTable.info.hashType = 100;
+    EXPECT_EQ(RouterTable::RET_INVALID_HASH_TYPE, rt.reload(packTable));
+    EXPECT_EQ(HASH_TYPE_FAST, rt.getHashType());
+
+    // cache server的数据依赖hash，不能切换
+    packTable = getPackTable1();
+    RouterTable serverRt;
+    ASSERT_EQ(RouterTable::RET_SUCC, serverRt.init(packTable, "m1_g1_s1"));
+    packTable.info.hashType = HASH_TYPE_FAST;
+    EXPECT_EQ(RouterTable::RET_HASH_TYPE_MISMATCH, serverRt.reload(packTable));
+    EXPECT_EQ(HASH_TYPE_NORMAL, serverRt.getHashType());
+}
+
+TEST(FastHashTest, all)
+{
+    // 与NormalHash一样不会返回0
+    EXPECT_NE(0u, FastHash::hash("", 0));
+
+    // 覆盖各长度分支，修改任一字节结果都应变化
+    for (size_t len = 1; len <= 100; ++len)
+    {
+        string key(len, 'a');
+        uint32_t hash = FastHash::hash(key.c_str(), key.size());
+        EXPECT_EQ(hash, FastHash::hash(key.c_str(), key.size()));
+        for (size_t i = 0; i < len; ++i)
+        {
+            string other = key;
+            other[i] = 'b';
+            EXPECT_NE(hash, FastHash::hash(other.c_str(), other.size())) << "len:" << len << " pos:" << i;
+        }
+    }
+}
+
 // 路由页测试
 TEST(EntryTest, all)
 {
@@ -364,6 +364,38 @@ TEST_F(DbHandleTest, getKindsOfInfo)
     // getPackTable4SwitchRW
 }
 
+TEST_F(DbHandleTest, routerSnapshot)
+{
+    init();
+    _db.init(_cfg.getDbReloadTime(100000),
+             std::move(_mysql),
+             std::move(_mysqlDBRelation),
+             std::move(_mysqlMigrate),
+             new MockPropertyReport());
+    _db.initCheck();
+
+    RouterSnapshot::PackTablePtr oldTable = _db.getPackTablePtr("module1");
+    ASSERT_TRUE(oldTable != NULL);
+    EXPECT_EQ(10, oldTable->info.version);
+    EXPECT_TRUE(_db.getPackTablePtr("not_exist_module") == NULL);
+
+    // 修改内存路由后发布新的快照，已取得的快照保持不变
+    TransferInfo transferInfo;
+    transferInfo.moduleName = "module1";
+    transferInfo.groupName = "group1";
+    transferInfo.transGroupName = "group2";
+    transferInfo.fromPageNo = 0;
+    transferInfo.toPageNo = 999;
+    EXPECT_EQ(0, _db.modifyMemRecord(transferInfo));
+
+    RouterSnapshot::PackTablePtr newTable = _db.getPackTablePtr("module1");
+    ASSERT_TRUE(newTable != NULL);
+    EXPECT_EQ(11, newTable->info.version);
+    EXPECT_EQ(11, _db.getVersion("module1"));
+    EXPECT_EQ(10, oldTable->info.version);
+    EXPECT_EQ(oldTable->recordList.size() + 1, newTable->recordList.size());
+}
+
 TEST_F(DbHandleTest, TransferInfo)
 {
     // _db.clearTransferInfos();
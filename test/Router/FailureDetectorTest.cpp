@@ -0,0 +1,153 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "FailureDetector.h"
+
+namespace
+{
+const std::string MASTER = "DCache.TestCacheServer1-1";
+const double PHI_THRESHOLD = 8;
+const int64_t HEARTBEAT_INTERVAL = 200;
+const int64_t CHECK_INTERVAL = 10;
+
+// 模拟的主机按固定间隔上报心跳，间隔有±30ms的抖动，返回最后一次心跳的时间
+int64_t reportHeartbeats(FailureDetector &detector, int64_t beginMs, int count)
+{
+    const int64_t jitter[] = {0, 30, -20, 10, -30, 20, -10};
+    int64_t nowMs = beginMs;
+    for (int i = 0; i < count; ++i)
+    {
+        nowMs += HEARTBEAT_INTERVAL + jitter[i % (sizeof(jitter) / sizeof(jitter[0]))];
+        detector.heartbeat(MASTER, nowMs);
+    }
+    return nowMs;
+}
+}  // namespace
+
+TEST(FailureDetector, noHistoryNoSuspect)
+{
+    FailureDetector detector;
+    EXPECT_EQ(0, detector.phi(MASTER, 1000));
+
+    // 心跳间隔太少时不做判断
+    detector.heartbeat(MASTER, 1000);
+    detector.heartbeat(MASTER, 1200);
+    EXPECT_EQ(0, detector.phi(MASTER, 100000));
+}
+
+TEST(FailureDetector, phiGrowsWithSilence)
+{
+    FailureDetector detector;
+    int64_t lastMs = reportHeartbeats(detector, 0, 20);
+
+    double lastPhi = detector.phi(MASTER, lastMs + 1);
+    for (int64_t elapsed = CHECK_INTERVAL; elapsed <= 2000; elapsed += CHECK_INTERVAL)
+    {
+        double phi = detector.phi(MASTER, lastMs + elapsed);
+        EXPECT_GE(phi, lastPhi);
+        lastPhi = phi;
+    }
+    EXPECT_GE(lastPhi, PHI_THRESHOLD);
+}
+
+TEST(FailureDetector, killedMasterDetectedWithinSecond)
+{
+    FailureDetector detector;
+    detector.setParam(100, 50, 60000);
+
+    // 心跳正常时不会误判
+    int64_t nowMs = 0;
+    for (int i = 0; i < 100; ++i)
+    {
+        int64_t lastMs = reportHeartbeats(detector, nowMs, 1);
+        for (; nowMs < lastMs; nowMs += CHECK_INTERVAL)
+        {
+            EXPECT_LT(detector.phi(MASTER, nowMs), PHI_THRESHOLD) << "at " << nowMs;
+        }
+        nowMs = lastMs;
+    }
+
+    // 主机被杀掉后不再有心跳，按检查间隔轮询直到判定故障
+    int64_t killMs = nowMs;
+    while (detector.phi(MASTER, nowMs) < PHI_THRESHOLD && nowMs - killMs < 10000)
+    {
+        nowMs += CHECK_INTERVAL;
+    }
+    EXPECT_LT(nowMs - killMs, 1000);
+    EXPECT_GT(nowMs - killMs, HEARTBEAT_INTERVAL);
+}
+
+TEST(FailureDetector, restartDropsOldIntervals)
+{
+    FailureDetector detector;
+    detector.setParam(100, 50, 5000);
+    int64_t lastMs = reportHeartbeats(detector, 0, 20);
+
+    // 停止超过maxIntervalMs后重新上报，之前的记录作废，重新积累心跳间隔
+    detector.heartbeat(MASTER, lastMs + 60000);
+    EXPECT_EQ(0, detector.phi(MASTER, lastMs + 70000));
+
+    lastMs = reportHeartbeats(detector, lastMs + 60000, 5);
+    EXPECT_LT(detector.phi(MASTER, lastMs + HEARTBEAT_INTERVAL), PHI_THRESHOLD);
+    EXPECT_GE(detector.phi(MASTER, lastMs + 2000), PHI_THRESHOLD);
+
+    detector.remove(MASTER);
+    EXPECT_EQ(0, detector.phi(MASTER, lastMs + 2000));
+}
+
+// 秒级心跳间隔(1s~5s)，平时只有几十毫秒的网络抖动，偶尔因为服务繁忙晚到0.6个周期，按默认阈值不应误判
+TEST(FailureDetector, slowJitteryHeartbeatNoFalseSuspect)
+{
+    const int64_t intervals[] = {1000, 2000, 3000, 5000};
+    const int64_t jitter[] = {0, 40, -30, 20, -40, 10, -20, 30};
+    for (size_t k = 0; k < sizeof(intervals) / sizeof(intervals[0]); ++k)
+    {
+        const int64_t interval = intervals[k];
+        FailureDetector detector;
+        detector.setParam(100, 100, 300 * 1000);
+
+        int64_t nowMs = 0;
+        int64_t lastMs = 0;
+        for (int i = 0; i < 200; ++i)
+        {
+            int64_t next = lastMs + interval + jitter[i % 8];
+            if (i % 25 == 24)
+            {
+                next += interval * 6 / 10;
+            }
+            for (; nowMs < next; nowMs += CHECK_INTERVAL)
+            {
+                EXPECT_LT(detector.phi(MASTER, nowMs), PHI_THRESHOLD)
+                    << "interval " << interval << " at " << nowMs;
+            }
+            detector.heartbeat(MASTER, next);
+            lastMs = nowMs = next;
+        }
+
+        // 停止心跳后仍能在几个心跳周期内判定故障
+        int64_t killMs = nowMs;
+        while (detector.phi(MASTER, nowMs) < PHI_THRESHOLD && nowMs - killMs < 10 * interval)
+        {
+            nowMs += CHECK_INTERVAL;
+        }
+        EXPECT_GT(nowMs - killMs, interval * 3 / 2) << "interval " << interval;
+        EXPECT_LT(nowMs - killMs, 4 * interval) << "interval " << interval;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
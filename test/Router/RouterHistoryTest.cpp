@@ -0,0 +1,163 @@
+/**
+* Tencent is pleased to support the open source community by making DCache available.
+* Copyright (C) 2019 THL A29 Limited, a Tencent company. All rights reserved.
+* Licensed under the BSD 3-Clause License (the "License"); you may not use this file
+* except in compliance with the License. You may obtain a copy of the License at
+*
+* https://opensource.org/licenses/BSD-3-Clause
+*
+* Unless required by applicable law or agreed to in writing, software distributed under
+* the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND,
+* either express or implied. See the License for the specific language governing permissions
+* and limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "RouterHistory.h"
+#include "UnpackTable.h"
+
+namespace
+{
+const std::string MODULE_NAME = "TestModule";
+
+RecordInfo makeRecord(int id, int fromPageNo, int toPageNo, const std::string &groupName)
+{
+    RecordInfo record;
+    record.id = id;
+    record.moduleName = MODULE_NAME;
+    record.fromPageNo = fromPageNo;
+    record.toPageNo = toPageNo;
+    record.groupName = groupName;
+    return record;
+}
+
+ServerInfo makeServer(const std::string &serverName, const std::string &groupName)
+{
+    ServerInfo server;
+    server.serverName = serverName;
+    server.groupName = groupName;
+    server.moduleName = MODULE_NAME;
+    server.ServerStatus = "M";
+    return server;
+}
+
+GroupInfo makeGroup(const std::string &groupName, const std::string &masterServer)
+{
+    GroupInfo group;
+    group.moduleName = MODULE_NAME;
+    group.groupName = groupName;
+    group.masterServer = masterServer;
+    group.accessStatus = 0;
+    return group;
+}
+
+// 版本1: 两个组各负责一半的页
+PackTable makeVersion1()
+{
+    PackTable packTable;
+    packTable.info.moduleName = MODULE_NAME;
+    packTable.info.version = 1;
+    packTable.recordList.push_back(makeRecord(1, 0, 99, "group1"));
+    packTable.recordList.push_back(makeRecord(2, 100, 199, "group2"));
+    packTable.groupList["group1"] = makeGroup("group1", "server1");
+    packTable.groupList["group2"] = makeGroup("group2", "server2");
+    packTable.serverList["server1"] = makeServer("server1", "group1");
+    packTable.serverList["server2"] = makeServer("server2", "group2");
+    return packTable;
+}
+
+// 版本2: 部分页迁移到新增的组3，组2下线一台服务器并换了主机
+PackTable makeVersion2()
+{
+    PackTable packTable = makeVersion1();
+    packTable.info.version = 2;
+    packTable.recordList[1] = makeRecord(2, 100, 149, "group2");
+    packTable.recordList.push_back(makeRecord(3, 150, 199, "group3"));
+    packTable.groupList["group2"].masterServer = "server2-bak";
+    packTable.groupList["group3"] = makeGroup("group3", "server3");
+    packTable.serverList.erase("server2");
+    packTable.serverList["server2-bak"] = makeServer("server2-bak", "group2");
+    packTable.serverList["server3"] = makeServer("server3", "group3");
+    return packTable;
+}
+}  // namespace
+
+TEST(RouterHistory, deltaRebuildsNewVersion)
+{
+    RouterHistory history;
+    PackTable v1 = makeVersion1();
+    PackTable v2 = makeVersion2();
+    history.record(v1);
+
+    RouterDelta delta;
+    EXPECT_EQ(ROUTER_SUCC, history.getDelta(1, v2, delta));
+    EXPECT_EQ(1, delta.fromVersion);
+    EXPECT_EQ(2, delta.toVersion);
+    EXPECT_EQ(1u, delta.delRecordList.size());
+    EXPECT_EQ(2u, delta.addRecordList.size());
+    EXPECT_EQ(2u, delta.updateGroupList.size());
+    EXPECT_EQ(1u, delta.delServerList.size());
+
+    PackTable rebuilt;
+    EXPECT_EQ(UnpackTable::RET_SUCC, UnpackTable::applyDelta(v1, delta, rebuilt));
+    EXPECT_EQ(v2.info, rebuilt.info);
+    EXPECT_EQ(v2.groupList, rebuilt.groupList);
+    EXPECT_EQ(v2.serverList, rebuilt.serverList);
+    EXPECT_EQ(v2.recordList.size(), rebuilt.recordList.size());
+    for (size_t i = 0; i < v2.recordList.size(); ++i)
+    {
+        EXPECT_NE(rebuilt.recordList.end(),
+                  std::find(rebuilt.recordList.begin(), rebuilt.recordList.end(), v2.recordList[i]));
+    }
+
+    // 基于其他版本的增量不能应用
+    PackTable other = v2;
+    EXPECT_EQ(UnpackTable::RET_DELTA_MISMATCH, UnpackTable::applyDelta(other, delta, rebuilt));
+}
+
+TEST(RouterHistory, unknownVersionNeedsFull)
+{
+    RouterHistory history;
+    RouterDelta delta;
+    EXPECT_EQ(ROUTER_NEED_FULL, history.getDelta(1, makeVersion2(), delta));
+
+    // 超出保留的版本数后最旧的版本被淘汰
+    history.setMaxVersion(2);
+    PackTable packTable = makeVersion1();
+    for (int version = 1; version <= 3; ++version)
+    {
+        packTable.info.version = version;
+        history.record(packTable);
+    }
+    EXPECT_EQ(ROUTER_NEED_FULL, history.getDelta(1, packTable, delta));
+    EXPECT_EQ(ROUTER_SUCC, history.getDelta(2, packTable, delta));
+}
+
+TEST(RouterHistory, changedContentClearsHistory)
+{
+    RouterHistory history;
+    PackTable v1 = makeVersion1();
+    history.record(v1);
+
+    // 同一版本号的路由内容变化(如重载路由)，之前记录的版本不再可信
+    PackTable v1Changed = v1;
+    v1Changed.groupList["group1"].accessStatus = 1;
+    history.record(v1Changed);
+
+    PackTable v2 = makeVersion2();
+    RouterDelta delta;
+    EXPECT_EQ(ROUTER_SUCC, history.getDelta(1, v2, delta));
+    EXPECT_EQ(1u, delta.updateGroupList.count("group1"));
+
+    // 版本号回退时清除历史
+    PackTable v0 = v1;
+    v0.info.version = 0;
+    history.record(v0);
+    EXPECT_EQ(ROUTER_NEED_FULL, history.getDelta(1, v2, delta));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -13,8 +13,17 @@
 */
 #include <gtest/gtest.h>
 #include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include "MockDbHandle.h"
 #include "Transfer.h"
 
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::Return;
+using ::testing::SetArgReferee;
+
 namespace
 {
 constexpr int MinThreadPerGroup = 3;
@@ -35,6 +44,105 @@ inline std::shared_ptr<TransferInfo> makeTask(const std::string &groupName)
     t->groupName = groupName;
     return t;
 }
+
+inline std::shared_ptr<TransferInfo> makeTask(const std::string &groupName,
+                                              const std::string &transGroupName)
+{
+    auto t = makeTask(groupName);
+    t->transGroupName = transGroupName;
+    return t;
+}
+
+// 模拟迁移的源、目的服务器，记录每个组同时进行的迁移数及其峰值
+class SimulatedCluster
+{
+public:
+    int doTransfer(const TransferInfo &info, std::string &)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _maxSrc[info.groupName] = std::max(_maxSrc[info.groupName], ++_src[info.groupName]);
+            _maxDest[info.transGroupName] =
+                std::max(_maxDest[info.transGroupName], ++_dest[info.transGroupName]);
+            _maxTotal = std::max(_maxTotal, ++_total);
+        }
+        ::usleep(200 * 1000);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_src[info.groupName];
+            --_dest[info.transGroupName];
+            --_total;
+            ++_done;
+        }
+        return 0;
+    }
+
+    int maxDest(const std::string &groupName)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _maxDest[groupName];
+    }
+
+    int maxTotal()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _maxTotal;
+    }
+
+    int done()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _done;
+    }
+
+private:
+    std::mutex _mutex;
+    std::map<std::string, int> _src, _dest, _maxSrc, _maxDest;
+    int _total = 0;
+    int _maxTotal = 0;
+    int _done = 0;
+};
+
+// 像TimerThread一样周期性地派发任务，直到完成taskNum个任务
+// 记录binlog延迟的查询次数，延迟由用例设置
+class FakeTransferThrottle : public TransferThrottle
+{
+public:
+    FakeTransferThrottle(std::shared_ptr<DbHandle> dbHandle, int binlogLagLimit, int checkInterval)
+        : TransferThrottle(dbHandle, binlogLagLimit, checkInterval), lag(0), queryNum(0)
+    {
+    }
+
+    int lag;
+    int queryNum;
+
+protected:
+    virtual int getBinlogLag(const string &serverName, int &serverLag) override
+    {
+        ++queryNum;
+        serverLag = lag;
+        return 0;
+    }
+};
+
+inline PackTable makePackTable(const std::string &groupName)
+{
+    PackTable packTable;
+    packTable.serverList["master"].groupName = groupName;
+    packTable.serverList["master"].ServerStatus = "M";
+    packTable.serverList["slave"].groupName = groupName;
+    packTable.serverList["slave"].ServerStatus = "S";
+    return packTable;
+}
+
+void runUntilDone(std::shared_ptr<TransferDispatcher> td, SimulatedCluster &cluster, int taskNum)
+{
+    for (int i = 0; i < 100 && cluster.done() < taskNum; ++i)
+    {
+        td->doTransferTask();
+        ::usleep(50 * 1000);
+    }
+}
 }  // namespace
 
 TEST(TransferDispatcher, sanity)
@@ -151,6 +259,131 @@ TEST(TransferDispatcher, group_num_larger_than_thread_num)
     EXPECT_EQ(td->getTransferingTaskNum("group2"), 0);
     EXPECT_EQ(td->getTransferingTaskNum("group3"), 0);
 }
+
+TEST(TransferDispatcher, dest_group_limit)
+{
+    SimulatedCluster cluster;
+    std::shared_ptr<TransferDispatcher> td = std::make_shared<TransferDispatcher>(
+        std::bind(&SimulatedCluster::doTransfer, &cluster, std::placeholders::_1, std::placeholders::_2),
+        10, MinThreadPerGroup, MaxThreadPerGroup, 2);
+    for (int i = 0; i < 2; ++i)
+    {
+        td->addTransferTask(makeTask("group1", "dest1"));
+        td->addTransferTask(makeTask("group2", "dest1"));
+        td->addTransferTask(makeTask("group3", "dest1"));
+    }
+
+    td->doTransferTask();
+    EXPECT_EQ(td->getTransferingDestTaskNum("dest1"), 2);
+    EXPECT_EQ(td->getTotalQueueTaskNum(), 4);
+
+    runUntilDone(td, cluster, 6);
+    EXPECT_EQ(cluster.done(), 6);
+    EXPECT_EQ(cluster.maxDest("dest1"), 2);
+    td->terminate();
+    EXPECT_EQ(td->getTransferingDestTaskNum("dest1"), 0);
+}
+
+TEST(TransferDispatcher, throttled_source_group)
+{
+    SimulatedCluster cluster;
+    bool busy = true;
+    std::shared_ptr<TransferDispatcher> td = std::make_shared<TransferDispatcher>(
+        std::bind(&SimulatedCluster::doTransfer, &cluster, std::placeholders::_1, std::placeholders::_2),
+        10, MinThreadPerGroup, MaxThreadPerGroup, 0,
+        [&busy](const TransferInfo &info) { return !(busy && info.groupName == "busy"); });
+    td->addTransferTask(makeTask("busy", "dest1"));
+    td->addTransferTask(makeTask("busy", "dest1"));
+    td->addTransferTask(makeTask("idle", "dest2"));
+    td->addTransferTask(makeTask("idle", "dest2"));
+
+    // 负载高的源组任务留在队列中，不影响其他组
+    td->doTransferTask();
+    EXPECT_EQ(td->getTransferingTaskNum("busy"), 0);
+    EXPECT_EQ(td->getQueueTaskNum("busy"), 2);
+    EXPECT_EQ(td->getTransferingTaskNum("idle"), 2);
+
+    runUntilDone(td, cluster, 2);
+    EXPECT_EQ(td->getQueueTaskNum("busy"), 2);
+
+    // 负载恢复后继续迁移
+    busy = false;
+    runUntilDone(td, cluster, 4);
+    EXPECT_EQ(cluster.done(), 4);
+    EXPECT_EQ(td->getTotalQueueTaskNum(), 0);
+    td->terminate();
+}
+
+TEST(TransferDispatcher, different_pairs_run_concurrently)
+{
+    SimulatedCluster cluster;
+    std::shared_ptr<TransferDispatcher> td = std::make_shared<TransferDispatcher>(
+        std::bind(&SimulatedCluster::doTransfer, &cluster, std::placeholders::_1, std::placeholders::_2),
+        10, MinThreadPerGroup, MaxThreadPerGroup, 1);
+    td->addTransferTask(makeTask("group1", "dest1"));
+    td->addTransferTask(makeTask("group1", "dest1"));
+    td->addTransferTask(makeTask("group2", "dest2"));
+    td->addTransferTask(makeTask("group2", "dest2"));
+    td->addTransferTask(makeTask("group3", "dest3"));
+
+    td->doTransferTask();
+    EXPECT_EQ(td->getTotalTransferingThreadNum(), 3);
+
+    runUntilDone(td, cluster, 5);
+    EXPECT_EQ(cluster.done(), 5);
+    EXPECT_EQ(cluster.maxTotal(), 3);
+    EXPECT_EQ(cluster.maxDest("dest1"), 1);
+    EXPECT_EQ(cluster.maxDest("dest2"), 1);
+    td->terminate();
+}
+
+// 调度时只读缓存，binlog延迟只在refresh中查询
+TEST(TransferThrottle, query_only_in_refresh)
+{
+    auto dbHandle = std::make_shared<MockDbHandle>();
+    EXPECT_CALL(*dbHandle, getPackTable("module", _))
+        .WillRepeatedly(DoAll(SetArgReferee<1>(makePackTable("group1")), Return(0)));
+
+    FakeTransferThrottle throttle(dbHandle, 5, 10);
+    TransferInfo info;
+    info.moduleName = "module";
+    info.groupName = "group1";
+    throttle.lag = 10;
+
+    // 还没有检查过的组允许迁移，且不访问cache服务
+    EXPECT_TRUE(throttle.canTransfer(info));
+    EXPECT_EQ(throttle.queryNum, 0);
+
+    throttle.watch(info);
+    throttle.refresh();
+    EXPECT_EQ(throttle.queryNum, 1);
+    EXPECT_FALSE(throttle.canTransfer(info));
+    EXPECT_FALSE(throttle.canTransfer(info));
+    EXPECT_EQ(throttle.queryNum, 1);
+
+    // 检查间隔内不重复查询
+    throttle.lag = 0;
+    throttle.refresh();
+    EXPECT_EQ(throttle.queryNum, 1);
+    EXPECT_FALSE(throttle.canTransfer(info));
+}
+
+TEST(TransferThrottle, disabled)
+{
+    auto dbHandle = std::make_shared<MockDbHandle>();
+    EXPECT_CALL(*dbHandle, getPackTable(_, _)).Times(0);
+
+    FakeTransferThrottle throttle(dbHandle, 0, 10);
+    TransferInfo info;
+    info.moduleName = "module";
+    info.groupName = "group1";
+    throttle.lag = 100;
+    throttle.watch(info);
+    throttle.refresh();
+    EXPECT_TRUE(throttle.canTransfer(info));
+    EXPECT_EQ(throttle.queryNum, 0);
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);